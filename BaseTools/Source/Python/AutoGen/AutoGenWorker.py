@@ -195,7 +195,7 @@ class AutoGenWorkerInProcess(mp.Process):
             self.Wa = WorkSpaceInfo(
                 workspacedir,active_p,target,toolchain,archlist
                 )
-            self.Wa._SrcTimeStamp = self.data_pipe.Get("Workspace_timestamp")
+            self.Wa._SrcDigest = self.data_pipe.Get("Workspace_digest")
             GlobalData.gGlobalDefines = self.data_pipe.Get("G_defines")
             GlobalData.gCommandLineDefines = self.data_pipe.Get("CL_defines")
             GlobalData.gCommandMaxLength = self.data_pipe.Get('gCommandMaxLength')
@@ -204,6 +204,7 @@ class AutoGenWorkerInProcess(mp.Process):
             GlobalData.gDisableIncludePathCheck = False
             GlobalData.gFdfParser = self.data_pipe.Get("FdfParser")
             GlobalData.gDatabasePath = self.data_pipe.Get("DatabasePath")
+            GlobalData.gMetaFileCacheDir = self.data_pipe.Get("MetaFileCacheDir")
 
             GlobalData.gUseHashCache = self.data_pipe.Get("UseHashCache")
             GlobalData.gBinCacheSource = self.data_pipe.Get("BinCacheSource")
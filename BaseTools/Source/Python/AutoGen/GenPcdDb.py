@@ -20,7 +20,15 @@ from Common import GlobalData
 from Common import EdkLogger
 import Common.LongFilePathOs as os
 
-DATABASE_VERSION = 7
+## Version 8 adds ExMapHashBucketCount, ExMapHashTableOffset and the ExMap hash tables
+DATABASE_VERSION = 8
+
+## Constants of the DynamicEx perfect hash, see PcdDataBaseSignatureGuid.h
+EX_MAP_HASH_OFFSET_BASIS = 0x811C9DC5
+EX_MAP_HASH_PRIME = 0x01000193
+EX_MAP_HASH_SEED_MULTIPLIER = 0x9E3779B9
+# Average number of DynamicEx PCDs in one bucket of the perfect hash
+EX_MAP_HASH_BUCKET_LOAD = 4
 
 gPcdDatabaseAutoGenC = TemplateString("""
 //
@@ -188,7 +196,8 @@ typedef struct {
   //UINT16                LocalTokenCount;  // LOCAL_TOKEN_NUMBER for all
   //UINT16                ExTokenCount;     // EX_TOKEN_NUMBER for DynamicEx
   //UINT16                GuidTableCount;   // The Number of Guid in GuidTable
-  //UINT8                 Pad[6];
+  //UINT16                ExMapHashBucketCount;
+  //TABLE_OFFSET          ExMapHashTableOffset;
   ${PHASE}_PCD_DATABASE_INIT    Init;
   ${PHASE}_PCD_DATABASE_UNINIT  Uninit;
 } ${PHASE}_PCD_DATABASE;
@@ -530,6 +539,78 @@ class DbStringItemList (DbComItemList):
 
 
 
+## Hash a DynamicEx PCD key for the ExMap perfect hash
+#
+#   This must match GetExMapHash() in the PCD PEIM and the PCD DXE driver.
+#
+#   @param      GuidBuffer     The token space GUID, packed as EFI_GUID
+#   @param      ExTokenNumber  The DynamicEx token number
+#   @param      Seed           0 for the bucket, displacement + 1 for the slot
+#
+#   @retval     The 32 bit hash
+#
+def GetExMapHash(GuidBuffer, ExTokenNumber, Seed):
+    Hash = EX_MAP_HASH_OFFSET_BASIS ^ ((Seed * EX_MAP_HASH_SEED_MULTIPLIER) & 0xFFFFFFFF)
+    for Byte in bytearray(GuidBuffer) + bytearray(pack('=L', ExTokenNumber)):
+        Hash = ((Hash ^ Byte) * EX_MAP_HASH_PRIME) & 0xFFFFFFFF
+    # The low bits of FNV-1a do not depend on the seed enough, mix all the bits into them
+    Hash ^= Hash >> 16
+    Hash = (Hash * 0x85EBCA6B) & 0xFFFFFFFF
+    Hash ^= Hash >> 13
+    Hash = (Hash * 0xC2B2AE35) & 0xFFFFFFFF
+    Hash ^= Hash >> 16
+    return Hash
+
+## Build the minimal perfect hash of the ExMap table
+#
+#   The keys are spread in buckets by their hash. Starting with the largest bucket, a displacement
+#   is searched for each bucket so that its keys land in free slots.
+#
+#   @param      ExMapTable     The ExMap table, a list of (ExTokenNumber, TokenNumber, GuidIndex)
+#   @param      GuidTable      The GUID table, in C structure format
+#   @param      ExTokenCount   The number of DynamicEx PCDs in ExMapTable
+#
+#   @retval     (BucketCount, Table) where Table holds the displacements and then the slots.
+#               (0, []) if there is no DynamicEx PCD or no perfect hash was found, the PCD drivers
+#               then search ExMapTable.
+#
+def BuildExMapHashTable(ExMapTable, GuidTable, ExTokenCount):
+    if ExTokenCount == 0:
+        return 0, []
+
+    Keys = []
+    for (ExTokenNumber, TokenNumber, GuidIndex) in ExMapTable[:ExTokenCount]:
+        GuidString = GuidStructureStringToGuidString(GuidTable[GetIntegerValue(GuidIndex)])
+        Keys.append((PackGUID(GuidString.split('-')), GetIntegerValue(ExTokenNumber)))
+
+    BucketCount = (ExTokenCount + EX_MAP_HASH_BUCKET_LOAD - 1) // EX_MAP_HASH_BUCKET_LOAD
+    Buckets = [[] for Bucket in range(BucketCount)]
+    for (Index, (GuidBuffer, ExTokenNumber)) in enumerate(Keys):
+        Buckets[GetExMapHash(GuidBuffer, ExTokenNumber, 0) % BucketCount].append(Index)
+
+    Displacements = [0] * BucketCount
+    Slots = [None] * ExTokenCount
+    for Bucket in sorted(range(BucketCount), key=lambda Bucket: len(Buckets[Bucket]), reverse=True):
+        if not Buckets[Bucket]:
+            break
+        for Displacement in range(0x10000):
+            Placed = {}
+            for Index in Buckets[Bucket]:
+                Slot = GetExMapHash(Keys[Index][0], Keys[Index][1], Displacement + 1) % ExTokenCount
+                if Slots[Slot] is not None or Slot in Placed:
+                    break
+                Placed[Slot] = Index
+            else:
+                for Slot in Placed:
+                    Slots[Slot] = Placed[Slot]
+                Displacements[Bucket] = Displacement
+                break
+        else:
+            EdkLogger.verbose("No perfect hash for the %d DynamicEx PCDs, the ExMap table is searched." % ExTokenCount)
+            return 0, []
+
+    return BucketCount, Displacements + Slots
+
 ##  Find the index in two list where the item matches the key separately
 #
 #   @param      Key1   The key used to search the List1
@@ -645,6 +726,8 @@ def BuildExDataBase(Dict):
 
     SizeTableValue = list(zip(Dict['SIZE_TABLE_MAXIMUM_LENGTH'], Dict['SIZE_TABLE_CURRENT_LENGTH']))
     DbSizeTableValue = DbSizeTableItemList(2, RawDataList = SizeTableValue)
+    ExMapHashBucketCount, ExMapHashTable = BuildExMapHashTable(ExMapTable, GuidTable, GetIntegerValue(Dict['EX_TOKEN_NUMBER']))
+    DbExMapHashTable = DbItemList(2, RawDataList = ExMapHashTable)
     InitValueUint16 = Dict['INIT_DB_VALUE_UINT16']
     DbInitValueUint16 = DbComItemList(2, RawDataList = InitValueUint16)
     VardefValueUint16 = Dict['VARDEF_DB_VALUE_UINT16']
@@ -677,16 +760,16 @@ def BuildExDataBase(Dict):
 
     DbNameTotle = ["SkuidValue",  "InitValueUint64", "VardefValueUint64", "InitValueUint32", "VardefValueUint32", "VpdHeadValue", "ExMapTable",
                "LocalTokenNumberTable", "GuidTable", "StringHeadValue",  "PcdNameOffsetTable", "VariableTable", "StringTableLen", "PcdTokenTable", "PcdCNameTable",
-               "SizeTableValue", "InitValueUint16", "VardefValueUint16", "InitValueUint8", "VardefValueUint8", "InitValueBoolean",
+               "SizeTableValue", "ExMapHashTable", "InitValueUint16", "VardefValueUint16", "InitValueUint8", "VardefValueUint8", "InitValueBoolean",
                "VardefValueBoolean", "UnInitValueUint64", "UnInitValueUint32", "UnInitValueUint16", "UnInitValueUint8", "UnInitValueBoolean"]
 
     DbTotal = [SkuidValue,  InitValueUint64, VardefValueUint64, InitValueUint32, VardefValueUint32, VpdHeadValue, ExMapTable,
                LocalTokenNumberTable, GuidTable, StringHeadValue,  PcdNameOffsetTable, VariableTable, StringTableLen, PcdTokenTable, PcdCNameTable,
-               SizeTableValue, InitValueUint16, VardefValueUint16, InitValueUint8, VardefValueUint8, InitValueBoolean,
+               SizeTableValue, ExMapHashTable, InitValueUint16, VardefValueUint16, InitValueUint8, VardefValueUint8, InitValueBoolean,
                VardefValueBoolean, UnInitValueUint64, UnInitValueUint32, UnInitValueUint16, UnInitValueUint8, UnInitValueBoolean]
     DbItemTotal = [DbSkuidValue,  DbInitValueUint64, DbVardefValueUint64, DbInitValueUint32, DbVardefValueUint32, DbVpdHeadValue, DbExMapTable,
                DbLocalTokenNumberTable, DbGuidTable, DbStringHeadValue,  DbPcdNameOffsetTable, DbVariableTable, DbStringTableLen, DbPcdTokenTable, DbPcdCNameTable,
-               DbSizeTableValue, DbInitValueUint16, DbVardefValueUint16, DbInitValueUint8, DbVardefValueUint8, DbInitValueBoolean,
+               DbSizeTableValue, DbExMapHashTable, DbInitValueUint16, DbVardefValueUint16, DbInitValueUint8, DbVardefValueUint8, DbInitValueBoolean,
                DbVardefValueBoolean, DbUnInitValueUint64, DbUnInitValueUint32, DbUnInitValueUint16, DbUnInitValueUint8, DbUnInitValueBoolean]
 
     # VardefValueBoolean is the last table in the init table items
@@ -765,6 +848,8 @@ def BuildExDataBase(Dict):
             StringTableOffset = DbTotalLength
         elif DbItemTotal[DbIndex] is DbSizeTableValue:
             SizeTableOffset = DbTotalLength
+        elif DbItemTotal[DbIndex] is DbExMapHashTable:
+            ExMapHashTableOffset = DbTotalLength if ExMapHashBucketCount else 0
         elif DbItemTotal[DbIndex] is DbSkuidValue:
             SkuIdTableOffset = DbTotalLength
         elif DbItemTotal[DbIndex] is DbPcdNameOffsetTable:
@@ -836,12 +921,9 @@ def BuildExDataBase(Dict):
     b = pack('=H', GuidTableCount)
 
     Buffer += b
-    b = pack('=B', Pad)
-    Buffer += b
-    Buffer += b
-    Buffer += b
-    Buffer += b
+    b = pack('=H', ExMapHashBucketCount)
     Buffer += b
+    b = pack('=L', ExMapHashTableOffset)
     Buffer += b
 
     Index = 0
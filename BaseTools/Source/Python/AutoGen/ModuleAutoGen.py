@@ -195,10 +195,6 @@ class ModuleAutoGen(AutoGen):
             self._InitWorker(Workspace, MetaFile, Target, Toolchain, Arch, *args)
             self._Init = True
 
-    ## Cache the timestamps of metafiles of every module in a class attribute
-    #
-    TimeDict = {}
-
     def __new__(cls, Workspace, MetaFile, Target, Toolchain, Arch, *args, **kwargs):
 #         check if this module is employed by active platform
         if not PlatformInfo(Workspace, args[0], Target, Toolchain, Arch,args[-1]).ValidModule(MetaFile):
@@ -1734,6 +1730,8 @@ class ModuleAutoGen(AutoGen):
     def CreateMakeFile(self, CreateLibraryMakeFile=True, GenFfsList = []):
 
         # nest this function inside it's only caller.
+        # The first line is the digest of the platform metafiles, the other lines
+        # are "<digest> <modified time> <size> <path>" of the module input files.
         def CreateTimeStamp():
             FileSet = {self.MetaFile.Path}
 
@@ -1746,10 +1744,22 @@ class ModuleAutoGen(AutoGen):
             for f in self.AutoGenDepSet:
                 FileSet.add (f.Path)
 
+            Lines = [self.Workspace._SrcDigest]
+            for File in sorted(FileSet):
+                try:
+                    Stat = os.stat(File)
+                    Digest = GetFileDigest(File)
+                except OSError:
+                    Digest = None
+                if Digest is None:
+                    Lines.append("- -1 -1 %s" % File)
+                else:
+                    Lines.append("%s %d %d %s" % (Digest, Stat.st_mtime_ns, Stat.st_size, File))
+
             if os.path.exists (self.TimeStampPath):
                 os.remove (self.TimeStampPath)
 
-            SaveFileOnChange(self.TimeStampPath, "\n".join(FileSet), False)
+            SaveFileOnChange(self.TimeStampPath, "\n".join(Lines), False)
 
         # Ignore generating makefile when it is a binary module
         if self.IsBinaryModule:
@@ -1761,7 +1771,7 @@ class ModuleAutoGen(AutoGen):
             for LibraryAutoGen in self.LibraryAutoGenList:
                 LibraryAutoGen.CreateMakeFile()
 
-        # CanSkip uses timestamps to determine build skipping
+        # CanSkip uses digests of the inputs to determine build skipping
         if self.CanSkip():
             return
 
@@ -2412,7 +2422,9 @@ class ModuleAutoGen(AutoGen):
         return False
 
     ## Decide whether we can skip the ModuleAutoGen process
-    #  If any source file is newer than the module than we cannot skip
+    #  If the content of the platform metafiles or of any input file of the module
+    #  has changed since the module was generated, we cannot skip. A file is only
+    #  read again if its modified time or size differs from the recorded one.
     #
     def CanSkip(self):
         # Don't skip if cache feature enabled
@@ -2422,22 +2434,24 @@ class ModuleAutoGen(AutoGen):
             return True
         if not os.path.exists(self.TimeStampPath):
             return False
-        #last creation time of the module
-        DstTimeStamp = os.stat(self.TimeStampPath)[8]
-
-        SrcTimeStamp = self.Workspace._SrcTimeStamp
-        if SrcTimeStamp > DstTimeStamp:
-            return False
 
         with open(self.TimeStampPath,'r') as f:
-            for source in f:
-                source = source.rstrip('\n')
-                if not os.path.exists(source):
-                    return False
-                if source not in ModuleAutoGen.TimeDict :
-                    ModuleAutoGen.TimeDict[source] = os.stat(source)[8]
-                if ModuleAutoGen.TimeDict[source] > DstTimeStamp:
-                    return False
+            Lines = f.read().splitlines()
+        if not Lines or not self.Workspace._SrcDigest or Lines[0] != self.Workspace._SrcDigest:
+            return False
+        for Line in Lines[1:]:
+            Fields = Line.split(' ', 3)
+            if len(Fields) != 4:
+                return False
+            Digest, MTime, Size, source = Fields
+            try:
+                Stat = os.stat(source)
+            except OSError:
+                return False
+            if str(Stat.st_mtime_ns) == MTime and str(Stat.st_size) == Size:
+                continue
+            if GetFileDigest(source) != Digest:
+                return False
         GlobalData.gSikpAutoGenCache.add(self.MakeFileDir)
         return True
 
@@ -257,7 +257,7 @@ class WorkSpaceInfo(AutoGenInfo):
             self.do_init(Workspace, MetaFile, Target, ToolChain, Arch)
             self._Init = True
     def do_init(self,Workspace, MetaFile, Target, ToolChain, Arch):
-        self._SrcTimeStamp = 0
+        self._SrcDigest = ''
         self.Db = BuildDB
         self.BuildDatabase = self.Db.BuildObject
         self.Target = Target
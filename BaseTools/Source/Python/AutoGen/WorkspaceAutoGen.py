@@ -560,13 +560,12 @@ class WorkspaceAutoGen(AutoGen):
         AllWorkSpaceMetaFiles = self._GetMetaFiles(self.BuildTarget, self.ToolChain)
         AllWorkSpaceMetaFileList = sorted(AllWorkSpaceMetaFiles, key=lambda x: str(x))
         #
-        # Retrieve latest modified time of all metafiles
+        # Retrieve digest of the content of all metafiles
         #
-        SrcTimeStamp = 0
-        for f in AllWorkSpaceMetaFiles:
-            if os.stat(f)[8] > SrcTimeStamp:
-                SrcTimeStamp = os.stat(f)[8]
-        self._SrcTimeStamp = SrcTimeStamp
+        m = hashlib.md5()
+        for f in AllWorkSpaceMetaFileList:
+            m.update(('%s %s\n' % (f, GetFileDigest(f))).encode('utf-8'))
+        self._SrcDigest = m.hexdigest()
 
         if GlobalData.gUseHashCache:
             FileList = []
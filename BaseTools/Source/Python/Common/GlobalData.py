@@ -120,6 +120,8 @@ gModuleCacheHit = None
 
 gEnableGenfdsMultiThread = True
 gSikpAutoGenCache = set()
+# Directory of the INF/DEC records kept across builds. None to parse every file.
+gMetaFileCacheDir = None
 # Common lock for the file access in multiple process AutoGens
 file_lock = None
 gStackCookieValues32 = []
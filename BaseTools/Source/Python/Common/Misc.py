@@ -19,6 +19,7 @@ import pickle
 import array
 import shutil
 import filecmp
+import hashlib
 from random import sample
 from struct import pack
 import uuid
@@ -57,6 +58,9 @@ StructPattern = re.compile(r'[_a-zA-Z][0-9A-Za-z_]*$')
 ## Dictionary used to store dependencies of files
 gDependencyDatabase = {}    # arch : {file path : [dependent files list]}
 
+## Dictionary used to store the digests of files
+gFileDigestDatabase = {}    # file path : (modified time in ns, size, digest)
+
 #
 # If a module is built more than once with different PCDs or library classes
 # a temporary INF file with same content is created, the temporary file is removed
@@ -522,6 +526,32 @@ def SaveFileOnChange(File, Content, IsBinaryFile=True, FileLock=None):
 
     return True
 
+## Get the digest of the content of a file
+#
+#  The digest is computed again only if the modified time or the size of the file
+#  has changed since it was last computed by this process.
+#
+#   @param      File            The path of file
+#
+#   @retval     string          The md5 digest of the file content, in hex
+#   @retval     None            The file cannot be read
+#
+def GetFileDigest(File):
+    try:
+        Stat = os.stat(File)
+    except OSError:
+        return None
+    Digest = gFileDigestDatabase.get(File)
+    if Digest and Digest[0] == Stat.st_mtime_ns and Digest[1] == Stat.st_size:
+        return Digest[2]
+    try:
+        with open(File, "rb") as f:
+            Content = f.read()
+    except IOError:
+        return None
+    gFileDigestDatabase[File] = (Stat.st_mtime_ns, Stat.st_size, hashlib.md5(Content).hexdigest())
+    return gFileDigestDatabase[File][2]
+
 ## Copy source file only if it is different from the destination file
 #
 #  This method is used to copy file only if the source file and destination
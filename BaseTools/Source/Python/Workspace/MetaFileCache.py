@@ -0,0 +1,121 @@
+## @file
+# This file is used to keep the parsed records of INF and DEC files across builds
+#
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+##
+# Import Modules
+#
+from __future__ import absolute_import
+import sys
+import mmap
+import marshal
+import tempfile
+from hashlib import md5
+
+import Common.LongFilePathOs as os
+import Common.EdkLogger as EdkLogger
+import Common.GlobalData as GlobalData
+from Common.LongFilePathSupport import OpenLongFilePath as open
+from CommonDataClass.DataClass import MODEL_FILE_INF, MODEL_FILE_DEC
+
+## Format of the cache entries. Bump it when the records stored by the parsers change.
+CACHE_VERSION = 1
+
+## Cache entry of the records parsed from one INF or DEC file
+#
+# The records of an INF or DEC file only depend on the content of the file: macros
+# are local to the file, and global macros are only checked to report errors. An
+# entry is kept in GlobalData.gMetaFileCacheDir, and is valid as long as the digest
+# of the content, the global macros and the tool match the digest it was
+# saved with. The entries are written atomically, so that the AutoGen workers of
+# one build, or concurrent builds, may share them.
+#
+class MetaFileCache(object):
+    ## Constructor
+    #
+    #   @param      MetaFile        PathClass of the INF or DEC file
+    #   @param      FileType        MODEL_FILE_INF or MODEL_FILE_DEC
+    #
+    def __init__(self, MetaFile, FileType):
+        self.MetaFile = MetaFile
+        self.EntryPath = None
+        self._Digest = None
+        if not GlobalData.gMetaFileCacheDir or FileType not in (MODEL_FILE_INF, MODEL_FILE_DEC):
+            return
+        # Usage checks of the INF comments are only done while parsing
+        if GlobalData.gOptions and getattr(GlobalData.gOptions, 'CheckUsage', False):
+            return
+        Name = md5(MetaFile.Path.encode('utf-8')).hexdigest()
+        self.EntryPath = os.path.join(GlobalData.gMetaFileCacheDir, Name + '.bin')
+
+    ## Digest of the content of the file and of what the records depend on
+    @property
+    def Digest(self):
+        if self._Digest is None:
+            with open(self.MetaFile.Path, 'rb') as File:
+                Content = File.read()
+            Hash = md5()
+            Hash.update(('%d %d %s\n' % (CACHE_VERSION, marshal.version, sys.version)).encode('utf-8'))
+            for Name in sorted(GlobalData.gGlobalDefines):
+                Hash.update(('%s=%s\n' % (Name, GlobalData.gGlobalDefines[Name])).encode('utf-8'))
+            Hash.update(('\n%s\n' % self.MetaFile.Path).encode('utf-8'))
+            Hash.update(Content)
+            self._Digest = Hash.hexdigest()
+        return self._Digest
+
+    ## Check whether the file can be cached
+    @property
+    def Enabled(self):
+        return self.EntryPath is not None
+
+    ## Fill a table with the records of the cache entry
+    #
+    #   @param      Table           MetaFileTable of the file
+    #
+    #   @retval     True            The table holds the records of the file
+    #   @retval     False           There is no valid entry for the file
+    #
+    def Load(self, Table):
+        if not self.Enabled:
+            return False
+        try:
+            # The digest is taken before the file is parsed, if there is no entry
+            if self.Digest is None or not os.path.exists(self.EntryPath):
+                return False
+            with open(self.EntryPath, 'rb') as File:
+                Map = mmap.mmap(File.fileno(), 0, access=mmap.ACCESS_READ)
+                try:
+                    Version, Digest, Records = marshal.loads(Map)
+                finally:
+                    Map.close()
+            if Version != CACHE_VERSION or Digest != self.Digest:
+                return False
+        except Exception as Exc:
+            EdkLogger.debug(EdkLogger.DEBUG_5, "Ignore cache entry of %s: %s" % (self.MetaFile, Exc))
+            return False
+        Table.CurrentContent = Records
+        Table.SetEndFlag()
+        return True
+
+    ## Save the records of a table parsed from the file
+    #
+    #   @param      Table           MetaFileTable of the file, with its end flag set
+    #
+    def Save(self, Table):
+        if not self.Enabled or not Table.IsIntegrity():
+            return
+        TempPath = None
+        try:
+            Data = marshal.dumps((CACHE_VERSION, self.Digest, Table.CurrentContent[:-1]))
+            if not os.path.isdir(GlobalData.gMetaFileCacheDir):
+                os.makedirs(GlobalData.gMetaFileCacheDir)
+            with tempfile.NamedTemporaryFile(dir=GlobalData.gMetaFileCacheDir, suffix='.tmp', delete=False) as File:
+                TempPath = File.name
+                File.write(Data)
+            os.replace(TempPath, self.EntryPath)
+        except Exception as Exc:
+            EdkLogger.debug(EdkLogger.DEBUG_5, "Cannot cache %s: %s" % (self.MetaFile, Exc))
+            if TempPath and os.path.exists(TempPath):
+                os.remove(TempPath)
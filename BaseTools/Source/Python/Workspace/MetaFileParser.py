@@ -29,6 +29,7 @@ from CommonDataClass.Exceptions import *
 from Common.LongFilePathSupport import OpenLongFilePath as open
 from collections import defaultdict
 from .MetaFileTable import MetaFileStorage
+from .MetaFileCache import MetaFileCache
 from .MetaFileCommentParser import CheckInfComment
 from Common.DataType import TAB_COMMENT_EDK_START, TAB_COMMENT_EDK_END
 
@@ -258,7 +259,13 @@ class MetaFileParser(object):
             else:
                 self._Table = self._RawTable
                 self._PostProcessed = False
+                # INF and DEC records parsed by a previous build, or another worker
+                Entry = MetaFileCache(self.MetaFile, self._FileType)
+                if Entry.Load(self._RawTable):
+                    self._Finished = True
+                    return
                 self.Start()
+                Entry.Save(self._RawTable)
     ## Data parser for the common format in different type of file
     #
     #   The common format in the meatfile is like
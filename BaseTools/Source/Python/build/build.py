@@ -797,6 +797,7 @@ class Build():
         GlobalData.gDatabasePath = os.path.normpath(os.path.join(GlobalData.gConfDirectory, GlobalData.gDatabasePath))
         if not os.path.exists(os.path.join(GlobalData.gConfDirectory, '.cache')):
             os.makedirs(os.path.join(GlobalData.gConfDirectory, '.cache'))
+        GlobalData.gMetaFileCacheDir = os.path.join(os.path.dirname(GlobalData.gDatabasePath), 'MetaFileCache')
         self.Db = BuildDB
         self.BuildDatabase = self.Db.BuildObject
         self.Platform = None
@@ -1280,7 +1281,7 @@ class Build():
                 mqueue.put(m)
             mqueue.put((None,None,None,None,None,None,None))
             AutoGenObject.DataPipe.DataContainer = {"CommandTarget": self.Target}
-            AutoGenObject.DataPipe.DataContainer = {"Workspace_timestamp": AutoGenObject.Workspace._SrcTimeStamp}
+            AutoGenObject.DataPipe.DataContainer = {"Workspace_digest": AutoGenObject.Workspace._SrcDigest}
             AutoGenObject.CreateLibModuleDirs()
             AutoGenObject.DataPipe.DataContainer = {"LibraryBuildDirectoryList":AutoGenObject.LibraryBuildDirectoryList}
             AutoGenObject.DataPipe.DataContainer = {"ModuleBuildDirectoryList":AutoGenObject.ModuleBuildDirectoryList}
@@ -1838,7 +1839,7 @@ class Build():
                             PcdMaList.append(Ma)
                         self.BuildModules.append(Ma)
                     Pa.DataPipe.DataContainer = {"FfsCommand":CmdListDict}
-                    Pa.DataPipe.DataContainer = {"Workspace_timestamp": Wa._SrcTimeStamp}
+                    Pa.DataPipe.DataContainer = {"Workspace_digest": Wa._SrcDigest}
                     self._BuildPa(self.Target, Pa, FfsCommand=CmdListDict,PcdMaList=PcdMaList)
 
                 # Create MAP file when Load Fix Address is enabled.
@@ -2198,7 +2199,7 @@ class Build():
                         continue
                     ModuleList.append(Inf)
             Pa.DataPipe.DataContainer = {"FfsCommand":CmdListDict}
-            Pa.DataPipe.DataContainer = {"Workspace_timestamp": Wa._SrcTimeStamp}
+            Pa.DataPipe.DataContainer = {"Workspace_digest": Wa._SrcDigest}
             Pa.DataPipe.DataContainer = {"CommandTarget": self.Target}
             Pa.CreateLibModuleDirs()
             # Fetch the MakeFileName.
@@ -13,8 +13,10 @@ import os
 import sys
 import unittest
 
+import GenCrc32
 import TianoCompress
 modules = (
+    GenCrc32,
     TianoCompress,
     )
 
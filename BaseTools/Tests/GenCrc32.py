@@ -0,0 +1,62 @@
+## @file
+# Unit tests for GenCrc32 utility
+#
+#  SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+##
+# Import Modules
+#
+import random
+import struct
+import unittest
+import zlib
+
+import TestTools
+
+class Tests(TestTools.BaseToolsTest):
+
+    def setUp(self):
+        TestTools.BaseToolsTest.setUp(self)
+        self.toolName = 'GenCrc32'
+
+    def testHelp(self):
+        result = self.RunTool('--help', logFile='help')
+        self.assertTrue(result == 0)
+
+    def crcTestCycle(self, data):
+        self.WriteTmpFile('input', data)
+        result = self.RunTool(
+            '-e',
+            '-o', self.GetTmpFilePath('output'),
+            self.GetTmpFilePath('input')
+            )
+        self.assertTrue(result == 0)
+        output = self.ReadTmpFile('output')
+        crc, = struct.unpack('<I', output[:4])
+        self.assertEqual(crc, zlib.crc32(data) & 0xFFFFFFFF, 'size %d' % len(data))
+        self.assertEqual(output[4:], data)
+        result = self.RunTool(
+            '-d',
+            '-o', self.GetTmpFilePath('decoded'),
+            self.GetTmpFilePath('output')
+            )
+        self.assertTrue(result == 0)
+
+    def testSizes(self):
+        #
+        # Cover the byte, 8 byte, 16 byte and 64 byte loops of the table
+        # driven and PCLMULQDQ implementations, and the transitions between
+        # them.
+        #
+        sizes = list(range(1, 160)) + [1023, 1024, 1025, 4096 + 48 + 7, 65536 + 13]
+        for size in sizes:
+            data = bytes(random.randint(0, 255) for x in range(size))
+            self.crcTestCycle(data)
+            self.CleanUpTmpDir()
+
+TheTestSuite = TestTools.MakeTheTestSuite(locals())
+
+if __name__ == '__main__':
+    allTests = TheTestSuite()
+    unittest.TextTestRunner().run(allTests)
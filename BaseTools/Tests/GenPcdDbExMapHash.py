@@ -0,0 +1,81 @@
+## @file
+# Unit tests for the perfect hash of the DynamicEx PCDs built by GenPcdDb
+#
+#  SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+##
+# Import Modules
+#
+import unittest
+
+import TestTools
+from AutoGen.GenPcdDb import GetExMapHash, BuildExMapHashTable
+from Common.Misc import GuidStringToGuidStructureString, PackGUID
+
+MDE_PKG_TOKEN_SPACE_GUID = '914AEBE7-4635-459B-AA1C-11E219B03A10'
+MDE_MODULE_PKG_TOKEN_SPACE_GUID = 'A1AFF049-FDEB-442A-B320-13AB4CB72BBC'
+ZERO_GUID = '00000000-0000-0000-0000-000000000000'
+
+#
+# (token space GUID, token number, seed, hash). The same vectors are checked
+# against GetExMapHash() of the PCD drivers by ExMapHashUnitTest in
+# MdeModulePkg/Universal/PCD/Common/UnitTest, keep them in sync.
+#
+EX_MAP_HASH_VECTORS = (
+    (ZERO_GUID,                       0x00000000, 0x00000, 0xC85D0DC8),
+    (ZERO_GUID,                       0xFFFFFFFF, 0x10000, 0x685A7EA2),
+    (MDE_PKG_TOKEN_SPACE_GUID,        0x00000001, 0x00000, 0x465EF6CA),
+    (MDE_PKG_TOKEN_SPACE_GUID,        0x30000001, 0x00001, 0xD1DF3C53),
+    (MDE_PKG_TOKEN_SPACE_GUID,        0xFFFFFFFF, 0x10000, 0xE48B946F),
+    (MDE_MODULE_PKG_TOKEN_SPACE_GUID, 0x00000000, 0x00001, 0x6AEACBFE),
+    (MDE_MODULE_PKG_TOKEN_SPACE_GUID, 0x30000001, 0x00000, 0x9DE5BBF1),
+    (MDE_MODULE_PKG_TOKEN_SPACE_GUID, 0xFFFFFFFF, 0x10000, 0x020D6ABE),
+    )
+
+class Tests(unittest.TestCase):
+
+    def testHashVectors(self):
+        for (Guid, ExTokenNumber, Seed, Hash) in EX_MAP_HASH_VECTORS:
+            self.assertEqual(
+                GetExMapHash(PackGUID(Guid.split('-')), ExTokenNumber, Seed),
+                Hash,
+                '%s %08X seed %X' % (Guid, ExTokenNumber, Seed)
+                )
+
+    def testNoDynamicExPcd(self):
+        self.assertEqual(BuildExMapHashTable([], [], 0), (0, []))
+
+    def lookUp(self, BucketCount, Table, ExTokenCount, GuidBuffer, ExTokenNumber):
+        #
+        # The lookup of GetExPcdTokenNumber() in the PCD drivers
+        #
+        Bucket = GetExMapHash(GuidBuffer, ExTokenNumber, 0) % BucketCount
+        Slot = GetExMapHash(GuidBuffer, ExTokenNumber, Table[Bucket] + 1) % ExTokenCount
+        return Table[BucketCount + Slot]
+
+    def testEveryKeyFindsItsEntry(self):
+        Guids = (MDE_PKG_TOKEN_SPACE_GUID, MDE_MODULE_PKG_TOKEN_SPACE_GUID)
+        GuidTable = [GuidStringToGuidStructureString(Guid) for Guid in Guids]
+        for ExTokenCount in (1, 2, 3, 4, 5, 17, 64, 200, 1000):
+            ExMapTable = []
+            for Index in range(ExTokenCount):
+                ExMapTable.append((str(0x30000000 + Index // 2), str(Index), str(Index % 2)))
+
+            BucketCount, Table = BuildExMapHashTable(ExMapTable, GuidTable, ExTokenCount)
+            self.assertEqual(BucketCount, (ExTokenCount + 3) // 4, 'count %d' % ExTokenCount)
+            self.assertEqual(len(Table), BucketCount + ExTokenCount)
+            self.assertEqual(sorted(Table[BucketCount:]), list(range(ExTokenCount)))
+            for (Index, (ExTokenNumber, TokenNumber, GuidIndex)) in enumerate(ExMapTable):
+                GuidBuffer = PackGUID(Guids[int(GuidIndex)].split('-'))
+                self.assertEqual(
+                    self.lookUp(BucketCount, Table, ExTokenCount, GuidBuffer, int(ExTokenNumber)),
+                    Index,
+                    'count %d key %d' % (ExTokenCount, Index)
+                    )
+
+TheTestSuite = TestTools.MakeTheTestSuite(locals())
+
+if __name__ == '__main__':
+    allTests = TheTestSuite()
+    unittest.TextTestRunner().run(allTests)
@@ -0,0 +1,98 @@
+## @file
+# Unit tests for the cache of the records parsed from INF and DEC files
+#
+#  SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+##
+# Import Modules
+#
+import os
+import shutil
+import tempfile
+import unittest
+
+import TestTools
+import Common.GlobalData as GlobalData
+from Common.Misc import PathClass
+from CommonDataClass.DataClass import MODEL_FILE_INF, MODEL_META_DATA_HEADER
+from Workspace.MetaFileCache import MetaFileCache
+from Workspace.MetaFileTable import ModuleTable
+from Workspace.WorkspaceDatabase import WorkspaceDatabase
+
+INF_CONTENT = '''[Defines]
+  INF_VERSION = 0x00010017
+  BASE_NAME   = CacheTest
+'''
+
+class Tests(unittest.TestCase):
+
+    def setUp(self):
+        self.SavedCacheDir = GlobalData.gMetaFileCacheDir
+        self.SavedDefines = GlobalData.gGlobalDefines
+        self.TempDir = tempfile.mkdtemp()
+        GlobalData.gMetaFileCacheDir = os.path.join(self.TempDir, 'MetaFileCache')
+        GlobalData.gGlobalDefines = {'TARGET': 'DEBUG', 'ARCH': 'X64'}
+        self.InfPath = os.path.join(self.TempDir, 'CacheTest.inf')
+        self.WriteInf(INF_CONTENT)
+        self.Db = WorkspaceDatabase()
+
+    def tearDown(self):
+        GlobalData.gMetaFileCacheDir = self.SavedCacheDir
+        GlobalData.gGlobalDefines = self.SavedDefines
+        shutil.rmtree(self.TempDir)
+
+    def WriteInf(self, Content):
+        with open(self.InfPath, 'w') as File:
+            File.write(Content)
+
+    def NewTable(self):
+        return ModuleTable(self.Db, PathClass(self.InfPath), True)
+
+    def SaveRecords(self):
+        Table = self.NewTable()
+        Table.Insert(MODEL_META_DATA_HEADER, 'BASE_NAME', 'CacheTest', '', 'COMMON', 'COMMON', -1, 3, 0, 3, 0, 0)
+        Table.SetEndFlag()
+        MetaFileCache(Table.MetaFile, MODEL_FILE_INF).Save(Table)
+        return Table.CurrentContent
+
+    def Load(self):
+        Table = self.NewTable()
+        Entry = MetaFileCache(Table.MetaFile, MODEL_FILE_INF)
+        self.assertTrue(Entry.Enabled)
+        return Entry.Load(Table), Table
+
+    def testHit(self):
+        Records = self.SaveRecords()
+        Loaded, Table = self.Load()
+        self.assertTrue(Loaded)
+        self.assertTrue(Table.IsIntegrity())
+        self.assertEqual([list(Record) for Record in Table.CurrentContent], [list(Record) for Record in Records])
+
+    def testNoEntry(self):
+        Loaded, Table = self.Load()
+        self.assertFalse(Loaded)
+        self.assertFalse(Table.IsIntegrity())
+
+    def testMissOnFileChange(self):
+        self.SaveRecords()
+        self.WriteInf(INF_CONTENT.replace('CacheTest', 'CacheTest2'))
+        Loaded, Table = self.Load()
+        self.assertFalse(Loaded)
+        self.assertFalse(Table.IsIntegrity())
+
+    def testMissOnMacroValueChange(self):
+        self.SaveRecords()
+        GlobalData.gGlobalDefines = {'TARGET': 'RELEASE', 'ARCH': 'X64'}
+        Loaded, Table = self.Load()
+        self.assertFalse(Loaded)
+        self.assertFalse(Table.IsIntegrity())
+        GlobalData.gGlobalDefines = {'TARGET': 'DEBUG', 'ARCH': 'X64'}
+        Loaded, Table = self.Load()
+        self.assertTrue(Loaded)
+
+TheTestSuite = TestTools.MakeTheTestSuite(locals())
+
+if __name__ == '__main__':
+    allTests = TheTestSuite()
+    unittest.TextTestRunner().run(allTests)
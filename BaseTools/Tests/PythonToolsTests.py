@@ -20,6 +20,10 @@ def TheTestSuite():
     suites.append(CheckPythonSyntax.TheTestSuite())
     import CheckUnicodeSourceFiles
     suites.append(CheckUnicodeSourceFiles.TheTestSuite())
+    import GenPcdDbExMapHash
+    suites.append(GenPcdDbExMapHash.TheTestSuite())
+    import MetaFileCache
+    suites.append(MetaFileCache.TheTestSuite())
     return unittest.TestSuite(suites)
 
 if __name__ == '__main__':
@@ -3887,6 +3887,42 @@ CryptoServicePkcs7Verify (
   return CALL_BASECRYPTLIB (Pkcs.Services.Pkcs7Verify, Pkcs7Verify, (P7Data, P7Length, TrustedCert, CertLength, InData, DataLength), FALSE);
 }
 
+/**
+  Flush the cache of the trusted certificates and of the signer certificate chains
+  verified by Pkcs7Verify() and ImageTimestampVerify().
+
+  The statistics of the cache are not reset.
+**/
+VOID
+EFIAPI
+CryptoServicePkcs7VerifyCacheFlush (
+  VOID
+  )
+{
+  CALL_VOID_BASECRYPTLIB (Pkcs.Services.Pkcs7VerifyCacheFlush, Pkcs7VerifyCacheFlush, ());
+}
+
+/**
+  Get the statistics of the cache of Pkcs7Verify() and ImageTimestampVerify().
+
+  If Statistics is NULL, then return FALSE.
+  If the cache is disabled or not supported, then return FALSE.
+
+  @param[out]  Statistics  The statistics of the cache since boot.
+
+  @retval  TRUE   The statistics have been returned.
+  @retval  FALSE  The cache is disabled or not supported.
+
+**/
+BOOLEAN
+EFIAPI
+CryptoServicePkcs7VerifyCacheGetStatistics (
+  OUT PKCS7_VERIFY_CACHE_STATISTICS  *Statistics
+  )
+{
+  return CALL_BASECRYPTLIB (Pkcs.Services.Pkcs7VerifyCacheGetStatistics, Pkcs7VerifyCacheGetStatistics, (Statistics), FALSE);
+}
+
 /**
   This function receives a PKCS7 formatted signature, and then verifies that
   the specified Enhanced or Extended Key Usages (EKU's) are present in the end-entity
@@ -7116,4 +7152,7 @@ const EDKII_CRYPTO_PROTOCOL  mEdkiiCrypto = {
   CryptoServicePkcs1v2Decrypt,
   CryptoServiceRsaOaepEncrypt,
   CryptoServiceRsaOaepDecrypt,
+  /// PKCS7 (continued)
+  CryptoServicePkcs7VerifyCacheFlush,
+  CryptoServicePkcs7VerifyCacheGetStatistics,
 };
@@ -2455,6 +2455,51 @@ Pkcs7Verify (
   IN  UINTN        DataLength
   );
 
+///
+/// Statistics of the cache of Pkcs7Verify() and ImageTimestampVerify().
+///
+typedef struct {
+  UINT64    Verifications;          ///< Signed data verified with the cache enabled.
+  UINT64    TrustedCertHits;        ///< Trusted certificates found already parsed.
+  UINT64    ChainHits;              ///< Signed data whose signer chains were already verified.
+  UINT64    SignatureChecksAvoided; ///< RSA or ECDSA verifications of certificates avoided.
+} PKCS7_VERIFY_CACHE_STATISTICS;
+
+/**
+  Flush the cache of the trusted certificates and of the signer certificate chains
+  verified by Pkcs7Verify() and ImageTimestampVerify().
+
+  A chain is only reused for the same trusted certificate, signers and certificates,
+  so the cache does not need to be flushed for the verifications to be correct. It
+  should be flushed when the trusted certificates change, such as when db, dbx or
+  dbt are updated, to release the certificates that are no longer trusted.
+
+  The statistics of the cache are not reset.
+**/
+VOID
+EFIAPI
+Pkcs7VerifyCacheFlush (
+  VOID
+  );
+
+/**
+  Get the statistics of the cache of Pkcs7Verify() and ImageTimestampVerify().
+
+  If Statistics is NULL, then return FALSE.
+  If the cache is disabled or not supported, then return FALSE.
+
+  @param[out]  Statistics  The statistics of the cache since boot.
+
+  @retval  TRUE   The statistics have been returned.
+  @retval  FALSE  The cache is disabled or not supported.
+
+**/
+BOOLEAN
+EFIAPI
+Pkcs7VerifyCacheGetStatistics (
+  OUT PKCS7_VERIFY_CACHE_STATISTICS  *Statistics
+  );
+
 /**
   This function receives a PKCS7 formatted signature, and then verifies that
   the specified Enhanced or Extended Key Usages (EKU's) are present in the end-entity
@@ -114,18 +114,20 @@ typedef struct {
   } Md5;                            // Deprecated
   union {
     struct {
-      UINT8    Pkcs1v2Encrypt             : 1;
-      UINT8    Pkcs5HashPassword          : 1;
-      UINT8    Pkcs7Verify                : 1;
-      UINT8    VerifyEKUsInPkcs7Signature : 1;
-      UINT8    Pkcs7GetSigners            : 1;
-      UINT8    Pkcs7FreeSigners           : 1;
-      UINT8    Pkcs7Sign                  : 1;
-      UINT8    Pkcs7GetAttachedContent    : 1;
-      UINT8    Pkcs7GetCertificatesList   : 1;
-      UINT8    AuthenticodeVerify         : 1;
-      UINT8    ImageTimestampVerify       : 1;
-      UINT8    Pkcs1v2Decrypt             : 1;
+      UINT8    Pkcs1v2Encrypt                : 1;
+      UINT8    Pkcs5HashPassword             : 1;
+      UINT8    Pkcs7Verify                   : 1;
+      UINT8    VerifyEKUsInPkcs7Signature    : 1;
+      UINT8    Pkcs7GetSigners               : 1;
+      UINT8    Pkcs7FreeSigners              : 1;
+      UINT8    Pkcs7Sign                     : 1;
+      UINT8    Pkcs7GetAttachedContent       : 1;
+      UINT8    Pkcs7GetCertificatesList      : 1;
+      UINT8    AuthenticodeVerify            : 1;
+      UINT8    ImageTimestampVerify          : 1;
+      UINT8    Pkcs1v2Decrypt                : 1;
+      UINT8    Pkcs7VerifyCacheFlush         : 1;
+      UINT8    Pkcs7VerifyCacheGetStatistics : 1;
     } Services;
     UINT32    Family;
   } Pkcs;
@@ -0,0 +1,367 @@
+/** @file
+  Cache of the trusted certificates and of the signer chains verified by
+  Pkcs7Verify() and ImageTimestampVerify().
+
+  Verifying a signed image or an authenticated variable parses the trusted
+  certificate, then checks the signature of every certificate of the signer
+  chain before checking the signature of the content. The same few chains are
+  verified over and over during a boot, so the cache keeps the parsed trusted
+  certificates and the chains that have been verified, and PKCS7_verify() only
+  checks the signature of the content when the chains are found.
+
+  The chains are verified with partial chains allowed, no time check, any
+  purpose and no revocation list, so whether they verify only depends on the
+  trusted certificate and the certificates of the signed data, which are the key
+  of the cache.
+
+  Caution: This module requires additional review when modified.
+  This library will have external input - signature.
+  This external input must be validated carefully to avoid security issue like
+  buffer overflow, integer overflow.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "CryptPkcs7VerifyCache.h"
+#include <Library/PcdLib.h>
+
+#include <openssl/evp.h>
+
+typedef struct {
+  UINT8    Digest[SHA256_DIGEST_SIZE];
+  X509     *Cert;
+} PKCS7_VERIFY_CACHE_CERT;
+
+typedef struct {
+  BOOLEAN    Valid;
+  UINT8      Digest[SHA256_DIGEST_SIZE];
+  UINT32     SignatureChecks;
+} PKCS7_VERIFY_CACHE_CHAINS;
+
+PKCS7_VERIFY_CACHE_CERT        *mPkcs7VerifyCacheCerts     = NULL;
+PKCS7_VERIFY_CACHE_CHAINS      *mPkcs7VerifyCacheChains    = NULL;
+UINTN                          mPkcs7VerifyCacheNextCert   = 0;
+UINTN                          mPkcs7VerifyCacheNextChains = 0;
+UINT32                         mPkcs7VerifyCacheSignatureChecks;
+PKCS7_VERIFY_CACHE_STATISTICS  mPkcs7VerifyCacheStatistics;
+
+/**
+  Allocate the cache when it is first used.
+
+  @retval  TRUE   The cache is ready.
+  @retval  FALSE  The cache is disabled or could not be allocated.
+
+**/
+STATIC
+BOOLEAN
+Pkcs7VerifyCacheReady (
+  VOID
+  )
+{
+  if (FixedPcdGet32 (PcdPkcs7VerifyCacheEntries) == 0) {
+    return FALSE;
+  }
+
+  if (mPkcs7VerifyCacheCerts == NULL) {
+    mPkcs7VerifyCacheCerts = AllocateZeroPool (FixedPcdGet32 (PcdPkcs7VerifyCacheEntries) * sizeof (PKCS7_VERIFY_CACHE_CERT));
+  }
+
+  if (mPkcs7VerifyCacheChains == NULL) {
+    mPkcs7VerifyCacheChains = AllocateZeroPool (FixedPcdGet32 (PcdPkcs7VerifyCacheEntries) * sizeof (PKCS7_VERIFY_CACHE_CHAINS));
+  }
+
+  return (BOOLEAN)((mPkcs7VerifyCacheCerts != NULL) && (mPkcs7VerifyCacheChains != NULL));
+}
+
+/**
+  Get the X509 object of a DER-encoded trusted certificate, parsing it only when
+  it is not already in the cache.
+
+  @param[in]  TrustedCert  Pointer to a trusted certificate encoded in DER.
+  @param[in]  CertLength   Length of the trusted certificate in bytes.
+
+  @return  The certificate, that the caller releases with X509_free(), or NULL if
+           the certificate is invalid.
+
+**/
+X509 *
+Pkcs7VerifyCacheGetTrustedCert (
+  IN CONST UINT8  *TrustedCert,
+  IN UINTN        CertLength
+  )
+{
+  CONST UINT8              *Temp;
+  X509                     *Cert;
+  UINT8                    Digest[SHA256_DIGEST_SIZE];
+  PKCS7_VERIFY_CACHE_CERT  *Entry;
+  UINTN                    Index;
+
+  if (!Pkcs7VerifyCacheReady () ||
+      !EVP_Digest (TrustedCert, CertLength, Digest, NULL, EVP_sha256 (), NULL))
+  {
+    Temp = TrustedCert;
+    return d2i_X509 (NULL, &Temp, (long)CertLength);
+  }
+
+  for (Index = 0; Index < FixedPcdGet32 (PcdPkcs7VerifyCacheEntries); Index++) {
+    Entry = &mPkcs7VerifyCacheCerts[Index];
+    if ((Entry->Cert != NULL) && (CompareMem (Entry->Digest, Digest, sizeof (Digest)) == 0)) {
+      if (!X509_up_ref (Entry->Cert)) {
+        return NULL;
+      }
+
+      mPkcs7VerifyCacheStatistics.TrustedCertHits++;
+      return Entry->Cert;
+    }
+  }
+
+  Temp = TrustedCert;
+  Cert = d2i_X509 (NULL, &Temp, (long)CertLength);
+  if ((Cert == NULL) || !X509_up_ref (Cert)) {
+    return Cert;
+  }
+
+  Entry = &mPkcs7VerifyCacheCerts[mPkcs7VerifyCacheNextCert];
+  X509_free (Entry->Cert);
+  CopyMem (Entry->Digest, Digest, sizeof (Digest));
+  Entry->Cert               = Cert;
+  mPkcs7VerifyCacheNextCert = (mPkcs7VerifyCacheNextCert + 1) % FixedPcdGet32 (PcdPkcs7VerifyCacheEntries);
+
+  return Cert;
+}
+
+/**
+  Count the certificate signatures checked for each chain that verifies.
+
+  The callback is called with success for the signer certificate once every
+  certificate above it in the chain has been checked.
+
+  @param[in]  Ok   Result of the verification of the current certificate.
+  @param[in]  Ctx  The verification context.
+
+  @return  Ok, the result is not changed.
+
+**/
+STATIC
+int
+Pkcs7VerifyCacheCountSignatures (
+  IN int             Ok,
+  IN X509_STORE_CTX  *Ctx
+  )
+{
+  STACK_OF (X509)  *Chain;
+
+  if (Ok && (X509_STORE_CTX_get_error_depth (Ctx) == 0)) {
+    Chain = X509_STORE_CTX_get0_chain (Ctx);
+    if ((Chain != NULL) && (sk_X509_num (Chain) > 1)) {
+      mPkcs7VerifyCacheSignatureChecks += (UINT32)(sk_X509_num (Chain) - 1);
+    }
+  }
+
+  return Ok;
+}
+
+/**
+  Add the SHA-256 digests of a stack of certificates to a digest.
+
+  @param[in]  Ctx    The digest context.
+  @param[in]  Certs  The certificates. NULL is hashed as an empty stack.
+
+  @retval  TRUE   The certificates have been hashed.
+  @retval  FALSE  A certificate could not be hashed.
+
+**/
+STATIC
+BOOLEAN
+Pkcs7VerifyCacheHashCerts (
+  IN EVP_MD_CTX       *Ctx,
+  IN STACK_OF (X509)  *Certs
+  )
+{
+  UINT32        Count;
+  UINT32        Index;
+  UINT8         Digest[SHA256_DIGEST_SIZE];
+  unsigned int  DigestSize;
+
+  Count = (Certs == NULL) ? 0 : (UINT32)sk_X509_num (Certs);
+  if (!EVP_DigestUpdate (Ctx, &Count, sizeof (Count))) {
+    return FALSE;
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    DigestSize = sizeof (Digest);
+    if (!X509_digest (sk_X509_value (Certs, (int)Index), EVP_sha256 (), Digest, &DigestSize) ||
+        !EVP_DigestUpdate (Ctx, Digest, DigestSize))
+    {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Look up the signer chains of a PKCS#7 signed data.
+
+  If the chains have already been verified against the trusted certificate, the
+  caller can skip their verification with PKCS7_NOVERIFY. Otherwise the store is
+  set up to count the certificate signatures checked, and the caller passes Key
+  to Pkcs7VerifyCacheAddChains() once the signed data has been verified.
+
+  @param[in]   Pkcs7        The PKCS#7 signed data to be verified.
+  @param[in]   TrustedCert  Pointer to the trusted certificate encoded in DER.
+  @param[in]   CertLength   Length of the trusted certificate in bytes.
+  @param[in]   CertStore    The store holding the trusted certificate.
+  @param[out]  Key          The key of the signer chains.
+
+  @retval  TRUE   The signer chains have already been verified.
+  @retval  FALSE  The signer chains have to be verified.
+
+**/
+BOOLEAN
+Pkcs7VerifyCacheFindChains (
+  IN  PKCS7                   *Pkcs7,
+  IN  CONST UINT8             *TrustedCert,
+  IN  UINTN                   CertLength,
+  IN  X509_STORE              *CertStore,
+  OUT PKCS7_VERIFY_CACHE_KEY  *Key
+  )
+{
+  EVP_MD_CTX                 *Ctx;
+  STACK_OF (X509)            *Signers;
+  PKCS7_VERIFY_CACHE_CHAINS  *Entry;
+  UINTN                      Index;
+
+  Key->Valid = FALSE;
+
+  if (!Pkcs7VerifyCacheReady ()) {
+    return FALSE;
+  }
+
+  mPkcs7VerifyCacheStatistics.Verifications++;
+
+  //
+  // The signers are looked up in the certificates of the signed data, as
+  // PKCS7_verify() does. A signed data without all of its signers fails anyway.
+  //
+  Signers = PKCS7_get0_signers (Pkcs7, NULL, 0);
+  if (Signers == NULL) {
+    return FALSE;
+  }
+
+  Ctx = EVP_MD_CTX_new ();
+  if (Ctx != NULL) {
+    Key->Valid = (BOOLEAN)(EVP_DigestInit_ex (Ctx, EVP_sha256 (), NULL) &&
+                           EVP_DigestUpdate (Ctx, TrustedCert, CertLength) &&
+                           Pkcs7VerifyCacheHashCerts (Ctx, Signers) &&
+                           Pkcs7VerifyCacheHashCerts (Ctx, Pkcs7->d.sign->cert) &&
+                           EVP_DigestFinal_ex (Ctx, Key->Digest, NULL));
+    EVP_MD_CTX_free (Ctx);
+  }
+
+  sk_X509_free (Signers);
+
+  if (!Key->Valid) {
+    return FALSE;
+  }
+
+  for (Index = 0; Index < FixedPcdGet32 (PcdPkcs7VerifyCacheEntries); Index++) {
+    Entry = &mPkcs7VerifyCacheChains[Index];
+    if (Entry->Valid && (CompareMem (Entry->Digest, Key->Digest, sizeof (Key->Digest)) == 0)) {
+      mPkcs7VerifyCacheStatistics.ChainHits++;
+      mPkcs7VerifyCacheStatistics.SignatureChecksAvoided += Entry->SignatureChecks;
+      Key->Valid = FALSE;
+      return TRUE;
+    }
+  }
+
+  mPkcs7VerifyCacheSignatureChecks = 0;
+  X509_STORE_set_verify_cb (CertStore, Pkcs7VerifyCacheCountSignatures);
+  return FALSE;
+}
+
+/**
+  Record the signer chains of a PKCS#7 signed data that has been verified.
+
+  @param[in]  Key  The key returned by Pkcs7VerifyCacheFindChains().
+
+**/
+VOID
+Pkcs7VerifyCacheAddChains (
+  IN CONST PKCS7_VERIFY_CACHE_KEY  *Key
+  )
+{
+  PKCS7_VERIFY_CACHE_CHAINS  *Entry;
+
+  if (!Key->Valid || !Pkcs7VerifyCacheReady ()) {
+    return;
+  }
+
+  Entry                       = &mPkcs7VerifyCacheChains[mPkcs7VerifyCacheNextChains];
+  Entry->Valid                = TRUE;
+  Entry->SignatureChecks      = mPkcs7VerifyCacheSignatureChecks;
+  mPkcs7VerifyCacheNextChains = (mPkcs7VerifyCacheNextChains + 1) % FixedPcdGet32 (PcdPkcs7VerifyCacheEntries);
+  CopyMem (Entry->Digest, Key->Digest, sizeof (Key->Digest));
+}
+
+/**
+  Flush the cache of the trusted certificates and of the signer certificate chains
+  verified by Pkcs7Verify() and ImageTimestampVerify().
+
+  A chain is only reused for the same trusted certificate, signers and certificates,
+  so the cache does not need to be flushed for the verifications to be correct. It
+  should be flushed when the trusted certificates change, such as when db, dbx or
+  dbt are updated, to release the certificates that are no longer trusted.
+
+  The statistics of the cache are not reset.
+**/
+VOID
+EFIAPI
+Pkcs7VerifyCacheFlush (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  if (mPkcs7VerifyCacheCerts != NULL) {
+    for (Index = 0; Index < FixedPcdGet32 (PcdPkcs7VerifyCacheEntries); Index++) {
+      X509_free (mPkcs7VerifyCacheCerts[Index].Cert);
+    }
+
+    ZeroMem (mPkcs7VerifyCacheCerts, FixedPcdGet32 (PcdPkcs7VerifyCacheEntries) * sizeof (PKCS7_VERIFY_CACHE_CERT));
+  }
+
+  if (mPkcs7VerifyCacheChains != NULL) {
+    ZeroMem (mPkcs7VerifyCacheChains, FixedPcdGet32 (PcdPkcs7VerifyCacheEntries) * sizeof (PKCS7_VERIFY_CACHE_CHAINS));
+  }
+
+  mPkcs7VerifyCacheNextCert   = 0;
+  mPkcs7VerifyCacheNextChains = 0;
+}
+
+/**
+  Get the statistics of the cache of Pkcs7Verify() and ImageTimestampVerify().
+
+  If Statistics is NULL, then return FALSE.
+  If the cache is disabled or not supported, then return FALSE.
+
+  @param[out]  Statistics  The statistics of the cache since boot.
+
+  @retval  TRUE   The statistics have been returned.
+  @retval  FALSE  The cache is disabled or not supported.
+
+**/
+BOOLEAN
+EFIAPI
+Pkcs7VerifyCacheGetStatistics (
+  OUT PKCS7_VERIFY_CACHE_STATISTICS  *Statistics
+  )
+{
+  if ((Statistics == NULL) || (FixedPcdGet32 (PcdPkcs7VerifyCacheEntries) == 0)) {
+    return FALSE;
+  }
+
+  CopyMem (Statistics, &mPkcs7VerifyCacheStatistics, sizeof (*Statistics));
+  return TRUE;
+}
@@ -0,0 +1,82 @@
+/** @file
+  Internal interface of the cache of trusted certificates and verified signer
+  chains used by Pkcs7Verify() and ImageTimestampVerify().
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef CRYPT_PKCS7_VERIFY_CACHE_H_
+#define CRYPT_PKCS7_VERIFY_CACHE_H_
+
+#include "InternalCryptLib.h"
+
+#include <openssl/x509.h>
+#include <openssl/pkcs7.h>
+
+///
+/// Identifies the signer chains of a PKCS#7 signed data: the SHA-256 digest of
+/// the trusted certificate, of the signer certificates and of all the
+/// certificates carried in the signed data.
+///
+typedef struct {
+  BOOLEAN    Valid;
+  UINT8      Digest[SHA256_DIGEST_SIZE];
+} PKCS7_VERIFY_CACHE_KEY;
+
+/**
+  Get the X509 object of a DER-encoded trusted certificate, parsing it only when
+  it is not already in the cache.
+
+  @param[in]  TrustedCert  Pointer to a trusted certificate encoded in DER.
+  @param[in]  CertLength   Length of the trusted certificate in bytes.
+
+  @return  The certificate, that the caller releases with X509_free(), or NULL if
+           the certificate is invalid.
+
+**/
+X509 *
+Pkcs7VerifyCacheGetTrustedCert (
+  IN CONST UINT8  *TrustedCert,
+  IN UINTN        CertLength
+  );
+
+/**
+  Look up the signer chains of a PKCS#7 signed data.
+
+  If the chains have already been verified against the trusted certificate, the
+  caller can skip their verification with PKCS7_NOVERIFY. Otherwise the store is
+  set up to count the certificate signatures checked, and the caller passes Key
+  to Pkcs7VerifyCacheAddChains() once the signed data has been verified.
+
+  @param[in]   Pkcs7        The PKCS#7 signed data to be verified.
+  @param[in]   TrustedCert  Pointer to the trusted certificate encoded in DER.
+  @param[in]   CertLength   Length of the trusted certificate in bytes.
+  @param[in]   CertStore    The store holding the trusted certificate.
+  @param[out]  Key          The key of the signer chains.
+
+  @retval  TRUE   The signer chains have already been verified.
+  @retval  FALSE  The signer chains have to be verified.
+
+**/
+BOOLEAN
+Pkcs7VerifyCacheFindChains (
+  IN  PKCS7                   *Pkcs7,
+  IN  CONST UINT8             *TrustedCert,
+  IN  UINTN                   CertLength,
+  IN  X509_STORE              *CertStore,
+  OUT PKCS7_VERIFY_CACHE_KEY  *Key
+  );
+
+/**
+  Record the signer chains of a PKCS#7 signed data that has been verified.
+
+  @param[in]  Key  The key returned by Pkcs7VerifyCacheFindChains().
+
+**/
+VOID
+Pkcs7VerifyCacheAddChains (
+  IN CONST PKCS7_VERIFY_CACHE_KEY  *Key
+  );
+
+#endif
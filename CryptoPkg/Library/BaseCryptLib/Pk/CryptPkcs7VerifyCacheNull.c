@@ -0,0 +1,104 @@
+/** @file
+  Cache of the trusted certificates and of the signer chains verified by
+  Pkcs7Verify() and ImageTimestampVerify() which does not cache anything.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "CryptPkcs7VerifyCache.h"
+
+/**
+  Parse a DER-encoded trusted certificate.
+
+  @param[in]  TrustedCert  Pointer to a trusted certificate encoded in DER.
+  @param[in]  CertLength   Length of the trusted certificate in bytes.
+
+  @return  The certificate, that the caller releases with X509_free(), or NULL if
+           the certificate is invalid.
+
+**/
+X509 *
+Pkcs7VerifyCacheGetTrustedCert (
+  IN CONST UINT8  *TrustedCert,
+  IN UINTN        CertLength
+  )
+{
+  CONST UINT8  *Temp;
+
+  Temp = TrustedCert;
+  return d2i_X509 (NULL, &Temp, (long)CertLength);
+}
+
+/**
+  Look up the signer chains of a PKCS#7 signed data.
+
+  Return FALSE to indicate that the signer chains have to be verified.
+
+  @param[in]   Pkcs7        The PKCS#7 signed data to be verified.
+  @param[in]   TrustedCert  Pointer to the trusted certificate encoded in DER.
+  @param[in]   CertLength   Length of the trusted certificate in bytes.
+  @param[in]   CertStore    The store holding the trusted certificate.
+  @param[out]  Key          The key of the signer chains.
+
+  @retval  FALSE  The signer chains have to be verified.
+
+**/
+BOOLEAN
+Pkcs7VerifyCacheFindChains (
+  IN  PKCS7                   *Pkcs7,
+  IN  CONST UINT8             *TrustedCert,
+  IN  UINTN                   CertLength,
+  IN  X509_STORE              *CertStore,
+  OUT PKCS7_VERIFY_CACHE_KEY  *Key
+  )
+{
+  Key->Valid = FALSE;
+  return FALSE;
+}
+
+/**
+  Record the signer chains of a PKCS#7 signed data that has been verified.
+
+  @param[in]  Key  The key returned by Pkcs7VerifyCacheFindChains().
+
+**/
+VOID
+Pkcs7VerifyCacheAddChains (
+  IN CONST PKCS7_VERIFY_CACHE_KEY  *Key
+  )
+{
+}
+
+/**
+  Flush the cache of the trusted certificates and of the signer certificate chains
+  verified by Pkcs7Verify() and ImageTimestampVerify().
+
+  Nothing is cached, so there is nothing to flush.
+**/
+VOID
+EFIAPI
+Pkcs7VerifyCacheFlush (
+  VOID
+  )
+{
+}
+
+/**
+  Get the statistics of the cache of Pkcs7Verify() and ImageTimestampVerify().
+
+  Return FALSE to indicate this interface is not supported.
+
+  @param[out]  Statistics  The statistics of the cache since boot.
+
+  @retval  FALSE  This interface is not supported.
+
+**/
+BOOLEAN
+EFIAPI
+Pkcs7VerifyCacheGetStatistics (
+  OUT PKCS7_VERIFY_CACHE_STATISTICS  *Statistics
+  )
+{
+  return FALSE;
+}
@@ -16,6 +16,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
 #include "InternalCryptLib.h"
+#include "CryptPkcs7VerifyCache.h"
 
 #include <openssl/objects.h>
 #include <openssl/x509.h>
@@ -782,15 +783,17 @@ Pkcs7Verify (
   IN  UINTN        DataLength
   )
 {
-  PKCS7        *Pkcs7;
-  BIO          *DataBio;
-  BOOLEAN      Status;
-  X509         *Cert;
-  X509_STORE   *CertStore;
-  UINT8        *SignedData;
-  CONST UINT8  *Temp;
-  UINTN        SignedDataSize;
-  BOOLEAN      Wrapped;
+  PKCS7                   *Pkcs7;
+  BIO                     *DataBio;
+  BOOLEAN                 Status;
+  X509                    *Cert;
+  X509_STORE              *CertStore;
+  UINT8                   *SignedData;
+  CONST UINT8             *Temp;
+  UINTN                   SignedDataSize;
+  BOOLEAN                 Wrapped;
+  int                     Flags;
+  PKCS7_VERIFY_CACHE_KEY  ChainsKey;
 
   //
   // Check input parameters.
@@ -863,8 +866,7 @@ Pkcs7Verify (
   //
   // Read DER-encoded root certificate and Construct X509 Certificate
   //
-  Temp = TrustedCert;
-  Cert = d2i_X509 (NULL, &Temp, (long)CertLength);
+  Cert = Pkcs7VerifyCacheGetTrustedCert (TrustedCert, CertLength);
   if (Cert == NULL) {
     goto _Exit;
   }
@@ -906,10 +908,23 @@ Pkcs7Verify (
   //
   X509_STORE_set_purpose (CertStore, X509_PURPOSE_ANY);
 
+  //
+  // The signer chains do not need to be verified again when they have already
+  // been verified against this trusted certificate. The signature of the content
+  // is always verified.
+  //
+  Flags = PKCS7_BINARY;
+  if (Pkcs7VerifyCacheFindChains (Pkcs7, TrustedCert, CertLength, CertStore, &ChainsKey)) {
+    Flags |= PKCS7_NOVERIFY;
+  }
+
   //
   // Verifies the PKCS#7 signedData structure
   //
-  Status = (BOOLEAN)PKCS7_verify (Pkcs7, NULL, CertStore, DataBio, NULL, PKCS7_BINARY);
+  Status = (BOOLEAN)PKCS7_verify (Pkcs7, NULL, CertStore, DataBio, NULL, Flags);
+  if (Status) {
+    Pkcs7VerifyCacheAddChains (&ChainsKey);
+  }
 
 _Exit:
   //
@@ -11,6 +11,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
 #include "InternalCryptLib.h"
+#include "CryptPkcs7VerifyCache.h"
 
 #include <openssl/asn1.h>
 #include <openssl/asn1t.h>
@@ -385,17 +386,18 @@ TimestampTokenVerify (
   OUT EFI_TIME     *SigningTime
   )
 {
-  BOOLEAN      Status;
-  CONST UINT8  *TokenTemp;
-  PKCS7        *Pkcs7;
-  X509         *Cert;
-  CONST UINT8  *CertTemp;
-  X509_STORE   *CertStore;
-  BIO          *OutBio;
-  UINT8        *TstData;
-  UINTN        TstSize;
-  CONST UINT8  *TstTemp;
-  TS_TST_INFO  *TstInfo;
+  BOOLEAN                 Status;
+  CONST UINT8             *TokenTemp;
+  PKCS7                   *Pkcs7;
+  X509                    *Cert;
+  X509_STORE              *CertStore;
+  BIO                     *OutBio;
+  UINT8                   *TstData;
+  UINTN                   TstSize;
+  CONST UINT8             *TstTemp;
+  TS_TST_INFO             *TstInfo;
+  int                     Flags;
+  PKCS7_VERIFY_CACHE_KEY  ChainsKey;
 
   Status = FALSE;
 
@@ -441,8 +443,7 @@ TimestampTokenVerify (
   //
   // Read the trusted TSA certificate (DER-encoded), and Construct X509 Certificate.
   //
-  CertTemp = TsaCert;
-  Cert     = d2i_X509 (NULL, &CertTemp, (long)CertSize);
+  Cert = Pkcs7VerifyCacheGetTrustedCert (TsaCert, CertSize);
   if (Cert == NULL) {
     goto _Exit;
   }
@@ -474,10 +475,21 @@ TimestampTokenVerify (
     goto _Exit;
   }
 
-  if (!PKCS7_verify (Pkcs7, NULL, CertStore, NULL, OutBio, PKCS7_BINARY)) {
+  //
+  // The TSA chain does not need to be verified again when it has already been
+  // verified against this trusted certificate.
+  //
+  Flags = PKCS7_BINARY;
+  if (Pkcs7VerifyCacheFindChains (Pkcs7, TsaCert, CertSize, CertStore, &ChainsKey)) {
+    Flags |= PKCS7_NOVERIFY;
+  }
+
+  if (!PKCS7_verify (Pkcs7, NULL, CertStore, NULL, OutBio, Flags)) {
     goto _Exit;
   }
 
+  Pkcs7VerifyCacheAddChains (&ChainsKey);
+
   //
   // Read the signed contents detached in timestamp signature.
   //
@@ -0,0 +1,42 @@
+/** @file
+  Cache of the trusted certificates and of the signer chains verified by
+  Pkcs7Verify() and ImageTimestampVerify() which does not cache anything.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "InternalCryptLib.h"
+
+/**
+  Flush the cache of the trusted certificates and of the signer certificate chains
+  verified by Pkcs7Verify() and ImageTimestampVerify().
+
+  Nothing is cached, so there is nothing to flush.
+**/
+VOID
+EFIAPI
+Pkcs7VerifyCacheFlush (
+  VOID
+  )
+{
+}
+
+/**
+  Get the statistics of the cache of Pkcs7Verify() and ImageTimestampVerify().
+
+  Return FALSE to indicate this interface is not supported.
+
+  @param[out]  Statistics  The statistics of the cache since boot.
+
+  @retval  FALSE  This interface is not supported.
+
+**/
+BOOLEAN
+EFIAPI
+Pkcs7VerifyCacheGetStatistics (
+  OUT PKCS7_VERIFY_CACHE_STATISTICS  *Statistics
+  )
+{
+  return FALSE;
+}
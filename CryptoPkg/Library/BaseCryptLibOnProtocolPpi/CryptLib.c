@@ -3112,6 +3112,42 @@ Pkcs7Verify (
   CALL_CRYPTO_SERVICE (Pkcs7Verify, (P7Data, P7Length, TrustedCert, CertLength, InData, DataLength), FALSE);
 }
 
+/**
+  Flush the cache of the trusted certificates and of the signer certificate chains
+  verified by Pkcs7Verify() and ImageTimestampVerify().
+
+  The statistics of the cache are not reset.
+**/
+VOID
+EFIAPI
+Pkcs7VerifyCacheFlush (
+  VOID
+  )
+{
+  CALL_VOID_CRYPTO_SERVICE (Pkcs7VerifyCacheFlush, ());
+}
+
+/**
+  Get the statistics of the cache of Pkcs7Verify() and ImageTimestampVerify().
+
+  If Statistics is NULL, then return FALSE.
+  If the cache is disabled or not supported, then return FALSE.
+
+  @param[out]  Statistics  The statistics of the cache since boot.
+
+  @retval  TRUE   The statistics have been returned.
+  @retval  FALSE  The cache is disabled or not supported.
+
+**/
+BOOLEAN
+EFIAPI
+Pkcs7VerifyCacheGetStatistics (
+  OUT PKCS7_VERIFY_CACHE_STATISTICS  *Statistics
+  )
+{
+  CALL_CRYPTO_SERVICE (Pkcs7VerifyCacheGetStatistics, (Statistics), FALSE);
+}
+
 /**
   This function receives a PKCS7 formatted signature, and then verifies that
   the specified Enhanced or Extended Key Usages (EKU's) are present in the end-entity
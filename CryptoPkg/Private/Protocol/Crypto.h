@@ -21,7 +21,7 @@
 /// the EDK II Crypto Protocol is extended, this version define must be
 /// increased.
 ///
-#define EDKII_CRYPTO_VERSION  17
+#define EDKII_CRYPTO_VERSION  18
 
 ///
 /// EDK II Crypto Protocol forward declaration
@@ -871,6 +871,37 @@ BOOLEAN
   IN  UINTN                          DataLength
   );
 
+/**
+  Flush the cache of the trusted certificates and of the signer certificate chains
+  verified by Pkcs7Verify() and ImageTimestampVerify().
+
+  The statistics of the cache are not reset.
+
+**/
+typedef
+VOID
+(EFIAPI *EDKII_CRYPTO_PKCS7_VERIFY_CACHE_FLUSH)(
+  VOID
+  );
+
+/**
+  Get the statistics of the cache of Pkcs7Verify() and ImageTimestampVerify().
+
+  If Statistics is NULL, then return FALSE.
+  If the cache is disabled or not supported, then return FALSE.
+
+  @param[out]  Statistics  The statistics of the cache since boot.
+
+  @retval  TRUE   The statistics have been returned.
+  @retval  FALSE  The cache is disabled or not supported.
+
+**/
+typedef
+BOOLEAN
+(EFIAPI *EDKII_CRYPTO_PKCS7_VERIFY_CACHE_GET_STATISTICS)(
+  OUT PKCS7_VERIFY_CACHE_STATISTICS  *Statistics
+  );
+
 /**
   VerifyEKUsInPkcs7Signature()
 
@@ -5710,6 +5741,9 @@ struct _EDKII_CRYPTO_PROTOCOL {
   EDKII_CRYPTO_PKCS1V2_DECRYPT                        Pkcs1v2Decrypt;
   EDKII_CRYPTO_RSA_OAEP_ENCRYPT                       RsaOaepEncrypt;
   EDKII_CRYPTO_RSA_OAEP_DECRYPT                       RsaOaepDecrypt;
+  /// PKCS7 (continued)
+  EDKII_CRYPTO_PKCS7_VERIFY_CACHE_FLUSH               Pkcs7VerifyCacheFlush;
+  EDKII_CRYPTO_PKCS7_VERIFY_CACHE_GET_STATISTICS      Pkcs7VerifyCacheGetStatistics;
 };
 
 extern GUID  gEdkiiCryptoProtocolGuid;
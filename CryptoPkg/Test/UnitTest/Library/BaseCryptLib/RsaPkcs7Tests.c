@@ -426,6 +426,92 @@ TestVerifyPkcs7SignVerify (
   return UNIT_TEST_PASSED;
 }
 
+UNIT_TEST_STATUS
+EFIAPI
+TestVerifyPkcs7VerifyCache (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  BOOLEAN                        Status;
+  UINT8                          *P7SignedData;
+  UINTN                          P7SignedDataSize;
+  UINT8                          *SignCert;
+  CHAR8                          *Tampered;
+  PKCS7_VERIFY_CACHE_STATISTICS  Before;
+  PKCS7_VERIFY_CACHE_STATISTICS  After;
+
+  if (!Pkcs7VerifyCacheGetStatistics (&Before)) {
+    UT_LOG_INFO ("PKCS#7 verification cache disabled\n");
+    return UNIT_TEST_SKIPPED;
+  }
+
+  P7SignedData = NULL;
+  SignCert     = NULL;
+
+  Status = X509ConstructCertificate (TestCert, sizeof (TestCert), (UINT8 **)&SignCert);
+  UT_ASSERT_TRUE (Status);
+  UT_ASSERT_NOT_NULL (SignCert);
+
+  Status = Pkcs7Sign (
+             TestKeyPem,
+             sizeof (TestKeyPem),
+             (CONST UINT8 *)PemPass,
+             (UINT8 *)Payload,
+             AsciiStrLen (Payload),
+             SignCert,
+             NULL,
+             &P7SignedData,
+             &P7SignedDataSize
+             );
+  UT_ASSERT_TRUE (Status);
+
+  //
+  // The first verification checks the chain, the second one finds it.
+  //
+  Pkcs7VerifyCacheFlush ();
+  UT_ASSERT_TRUE (Pkcs7VerifyCacheGetStatistics (&Before));
+  UT_ASSERT_TRUE (Pkcs7Verify (P7SignedData, P7SignedDataSize, TestCACert, sizeof (TestCACert), (UINT8 *)Payload, AsciiStrLen (Payload)));
+  UT_ASSERT_TRUE (Pkcs7Verify (P7SignedData, P7SignedDataSize, TestCACert, sizeof (TestCACert), (UINT8 *)Payload, AsciiStrLen (Payload)));
+  UT_ASSERT_TRUE (Pkcs7VerifyCacheGetStatistics (&After));
+  UT_ASSERT_EQUAL (After.Verifications - Before.Verifications, 2);
+  UT_ASSERT_EQUAL (After.TrustedCertHits - Before.TrustedCertHits, 1);
+  UT_ASSERT_EQUAL (After.ChainHits - Before.ChainHits, 1);
+  UT_ASSERT_EQUAL (After.SignatureChecksAvoided - Before.SignatureChecksAvoided, 1);
+
+  //
+  // The signature of the content is still checked when the chain is found.
+  //
+  Tampered = AllocateCopyPool (AsciiStrSize (Payload), Payload);
+  UT_ASSERT_NOT_NULL (Tampered);
+  Tampered[0] ^= 1;
+  Status = Pkcs7Verify (P7SignedData, P7SignedDataSize, TestCACert, sizeof (TestCACert), (UINT8 *)Tampered, AsciiStrLen (Tampered));
+  FreePool (Tampered);
+  UT_ASSERT_FALSE (Status);
+  UT_ASSERT_TRUE (Pkcs7VerifyCacheGetStatistics (&Before));
+  UT_ASSERT_EQUAL (Before.ChainHits - After.ChainHits, 1);
+
+  //
+  // A chain is not found for another trusted certificate.
+  //
+  UT_ASSERT_TRUE (Pkcs7Verify (P7SignedData, P7SignedDataSize, TestCert, sizeof (TestCert), (UINT8 *)Payload, AsciiStrLen (Payload)));
+  UT_ASSERT_TRUE (Pkcs7VerifyCacheGetStatistics (&After));
+  UT_ASSERT_EQUAL (After.ChainHits, Before.ChainHits);
+
+  //
+  // The chain is checked again after a flush.
+  //
+  Pkcs7VerifyCacheFlush ();
+  UT_ASSERT_TRUE (Pkcs7Verify (P7SignedData, P7SignedDataSize, TestCACert, sizeof (TestCACert), (UINT8 *)Payload, AsciiStrLen (Payload)));
+  UT_ASSERT_TRUE (Pkcs7VerifyCacheGetStatistics (&Before));
+  UT_ASSERT_EQUAL (Before.ChainHits, After.ChainHits);
+  UT_ASSERT_EQUAL (Before.TrustedCertHits, After.TrustedCertHits);
+
+  FreePool (P7SignedData);
+  X509Free (SignCert);
+
+  return UNIT_TEST_PASSED;
+}
+
 TEST_DESC  mRsaCertTest[] = {
   //
   // -----Description--------------------------------------Class----------------------Function-----------------Pre---Post--Context
@@ -440,6 +526,7 @@ TEST_DESC  mPkcs7Test[] = {
   // -----Description--------------------------------------Class----------------------Function-----------------Pre---Post--Context
   //
   { "TestVerifyPkcs7SignVerify()", "CryptoPkg.BaseCryptLib.Pkcs7", TestVerifyPkcs7SignVerify, NULL, NULL, NULL },
+  { "TestVerifyPkcs7VerifyCache()", "CryptoPkg.BaseCryptLib.Pkcs7", TestVerifyPkcs7VerifyCache, NULL, NULL, NULL },
 };
 
 UINTN  mPkcs7TestNum = ARRAY_SIZE (mPkcs7Test);
@@ -0,0 +1,371 @@
+/** @file
+  Shell application to dump the DXE performance trace.
+
+  The trace is recorded by DxeCorePerformanceLib when PcdEdkiiPerformanceTraceRecordCount
+  is not zero. Without argument, a summary of the per-processor ring buffers is shown.
+  With -c the records are written in the Chrome trace event format, which can be loaded
+  by Perfetto or chrome://tracing, for example: PerfTraceInfo -c >a trace.json
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PerformanceLib.h>
+#include <Library/PrintLib.h>
+#include <Library/PeCoffGetEntryPointLib.h>
+#include <Library/UefiLib.h>
+#include <Protocol/LoadedImage.h>
+#include <Protocol/DriverBinding.h>
+#include <Protocol/ShellParameters.h>
+#include <Guid/PerformanceMeasurement.h>
+#include <Guid/PerformanceTrace.h>
+
+#define TRACE_NAME_STRING_LENGTH  64
+
+PERFORMANCE_TRACE_TABLE  *mTraceTable;
+CHAR8                    mNameString[TRACE_NAME_STRING_LENGTH + 1];
+
+/**
+  Get the time of a record in nanoseconds since the performance counter started.
+
+  @param  TimeStamp  The time stamp of the record.
+
+  @return The time in nanoseconds.
+**/
+UINT64
+GetTraceTimeInNanoSecond (
+  IN UINT64  TimeStamp
+  )
+{
+  UINT64  Ticks;
+  UINT64  Remainder;
+  UINT64  Seconds;
+
+  if (mTraceTable->TimerStartValue > mTraceTable->TimerEndValue) {
+    Ticks = mTraceTable->TimerStartValue - TimeStamp;
+  } else {
+    Ticks = TimeStamp - mTraceTable->TimerStartValue;
+  }
+
+  Seconds = DivU64x64Remainder (Ticks, mTraceTable->Frequency, &Remainder);
+  return MultU64x32 (Seconds, 1000000000) +
+         DivU64x64Remainder (MultU64x32 (Remainder, 1000000000), mTraceTable->Frequency, NULL);
+}
+
+/**
+  Copy a string into mNameString, replacing the characters a JSON string cannot
+  hold as is.
+
+  @param  String  The string to copy.
+**/
+VOID
+SetNameString (
+  IN CONST CHAR8  *String
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; (Index < TRACE_NAME_STRING_LENGTH) && (String[Index] != 0); Index++) {
+    if ((String[Index] < 0x20) || (String[Index] > 0x7E) || (String[Index] == '"') || (String[Index] == '\\')) {
+      mNameString[Index] = '_';
+    } else {
+      mNameString[Index] = String[Index];
+    }
+  }
+
+  mNameString[Index] = 0;
+}
+
+/**
+  Get the name of the module identified by a handle, from its PDB file name.
+
+  @param  Handle  Image handle or controller handle.
+
+  @return The name in mNameString.
+**/
+CHAR8 *
+GetModuleNameString (
+  IN EFI_HANDLE  Handle
+  )
+{
+  EFI_STATUS                   Status;
+  EFI_LOADED_IMAGE_PROTOCOL    *LoadedImage;
+  EFI_DRIVER_BINDING_PROTOCOL  *DriverBinding;
+  CHAR8                        *PdbFileName;
+  UINTN                        StartIndex;
+  UINTN                        Index;
+
+  LoadedImage = NULL;
+  Status      = gBS->HandleProtocol (Handle, &gEfiLoadedImageProtocolGuid, (VOID **)&LoadedImage);
+  if (EFI_ERROR (Status)) {
+    Status = gBS->HandleProtocol (Handle, &gEfiDriverBindingProtocolGuid, (VOID **)&DriverBinding);
+    if (!EFI_ERROR (Status)) {
+      Status = gBS->HandleProtocol (DriverBinding->ImageHandle, &gEfiLoadedImageProtocolGuid, (VOID **)&LoadedImage);
+    }
+  }
+
+  PdbFileName = NULL;
+  if (!EFI_ERROR (Status)) {
+    PdbFileName = PeCoffLoaderGetPdbPointer (LoadedImage->ImageBase);
+  }
+
+  if (PdbFileName == NULL) {
+    AsciiSPrint (mNameString, sizeof (mNameString), "Handle 0x%p", Handle);
+    return mNameString;
+  }
+
+  StartIndex = 0;
+  for (Index = 0; PdbFileName[Index] != 0; Index++) {
+    if ((PdbFileName[Index] == '\\') || (PdbFileName[Index] == '/')) {
+      StartIndex = Index + 1;
+    }
+  }
+
+  SetNameString (PdbFileName + StartIndex);
+  for (Index = 0; mNameString[Index] != 0; Index++) {
+    if (mNameString[Index] == '.') {
+      mNameString[Index] = 0;
+      break;
+    }
+  }
+
+  return mNameString;
+}
+
+/**
+  Get the name of the event described by a record.
+
+  @param  Record  The trace record.
+
+  @return The name in mNameString.
+**/
+CHAR8 *
+GetRecordNameString (
+  IN PERFORMANCE_TRACE_RECORD  *Record
+  )
+{
+  if (Record->StringIndex != PERFORMANCE_TRACE_INVALID_INDEX) {
+    SetNameString (mTraceTable->String[Record->StringIndex].String);
+  } else if ((Record->Flags & PERFORMANCE_TRACE_CALLER_IS_GUID_INDEX) != 0) {
+    if (Record->Caller == PERFORMANCE_TRACE_INVALID_INDEX) {
+      SetNameString ("unknown name");
+    } else {
+      AsciiSPrint (mNameString, sizeof (mNameString), "%g", &mTraceTable->Guid[Record->Caller].Guid);
+    }
+  } else {
+    GetModuleNameString ((EFI_HANDLE)(UINTN)Record->Caller);
+  }
+
+  if (mNameString[0] == 0) {
+    SetNameString ("unknown name");
+  }
+
+  return mNameString;
+}
+
+/**
+  Get the trace event phase of a record.
+
+  @param  Record  The trace record.
+
+  @return 'B' for a begin event, 'E' for an end event or 'i' for an instant event.
+**/
+CHAR8
+GetRecordPhase (
+  IN PERFORMANCE_TRACE_RECORD  *Record
+  )
+{
+  if (Record->Attribute == PerfStartEntry) {
+    return 'B';
+  }
+
+  if (Record->Attribute == PerfEndEntry) {
+    return 'E';
+  }
+
+  if (Record->Identifier == PERF_EVENT_ID) {
+    return 'i';
+  }
+
+  //
+  // Core identifiers pair odd start with even end identifiers, the other ones
+  // use a zero low nibble for start identifiers.
+  //
+  if (Record->Identifier <= MODULE_DB_STOP_END_ID) {
+    return ((Record->Identifier & BIT0) != 0) ? 'B' : 'E';
+  }
+
+  return ((Record->Identifier & 0x000F) == 0) ? 'B' : 'E';
+}
+
+/**
+  Get the first valid record of a ring buffer, and the number of valid records.
+
+  @param  Ring   The ring buffer.
+  @param  Count  The number of valid records.
+
+  @return Index of the first valid record, counted from the first record ever written.
+**/
+UINT32
+GetRingStart (
+  IN  PERFORMANCE_TRACE_RING  *Ring,
+  OUT UINT32                  *Count
+  )
+{
+  if (Ring->Head > mTraceTable->RecordCount) {
+    *Count = mTraceTable->RecordCount;
+    return Ring->Head - mTraceTable->RecordCount;
+  }
+
+  *Count = Ring->Head;
+  return 0;
+}
+
+/**
+  Dump a summary of the trace buffers.
+**/
+VOID
+DumpTraceSummary (
+  VOID
+  )
+{
+  UINT32  Cpu;
+  UINT32  Count;
+  UINT32  Index;
+  UINT32  Used;
+
+  Print (L"Performance trace: %d processors, %d records per processor\n", mTraceTable->CpuCount, mTraceTable->RecordCount);
+  for (Cpu = 0; Cpu < mTraceTable->CpuCount; Cpu++) {
+    GetRingStart (mTraceTable->Ring[Cpu], &Count);
+    Print (
+      L"  CPU %3d: %d records, %d overwritten\n",
+      Cpu,
+      Count,
+      mTraceTable->Ring[Cpu]->Head - Count
+      );
+  }
+
+  for (Index = 0, Used = 0; Index < mTraceTable->StringCount; Index++) {
+    if (mTraceTable->String[Index].Hash != 0) {
+      Used++;
+    }
+  }
+
+  Print (L"  Strings: %d of %d\n", Used, mTraceTable->StringCount);
+
+  for (Index = 0, Used = 0; Index < mTraceTable->GuidCount; Index++) {
+    if (mTraceTable->Guid[Index].Hash != 0) {
+      Used++;
+    }
+  }
+
+  Print (L"  GUIDs:   %d of %d\n", Used, mTraceTable->GuidCount);
+}
+
+/**
+  Dump the trace records in the Chrome trace event format, one thread per processor.
+**/
+VOID
+DumpChromeTrace (
+  VOID
+  )
+{
+  UINT32                    Cpu;
+  UINT32                    Start;
+  UINT32                    Count;
+  UINT32                    Index;
+  UINT64                    NanoSeconds;
+  PERFORMANCE_TRACE_RING    *Ring;
+  PERFORMANCE_TRACE_RECORD  *Record;
+  CHAR8                     Phase;
+
+  Print (L"{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  for (Cpu = 0; Cpu < mTraceTable->CpuCount; Cpu++) {
+    Print (
+      L"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"CPU %d\"}},\n",
+      Cpu,
+      Cpu
+      );
+  }
+
+  for (Cpu = 0; Cpu < mTraceTable->CpuCount; Cpu++) {
+    Ring  = mTraceTable->Ring[Cpu];
+    Start = GetRingStart (Ring, &Count);
+    for (Index = 0; Index < Count; Index++) {
+      Record      = (PERFORMANCE_TRACE_RECORD *)(Ring + 1) + ((Start + Index) % mTraceTable->RecordCount);
+      NanoSeconds = GetTraceTimeInNanoSecond (Record->TimeStamp);
+      Phase       = GetRecordPhase (Record);
+      Print (
+        L"{\"name\":\"%a\",\"ph\":\"%c\",%a\"pid\":0,\"tid\":%d,\"ts\":%ld.%03d,\"args\":{\"id\":\"0x%x\",\"address\":\"0x%lx\"}},\n",
+        GetRecordNameString (Record),
+        (CHAR16)Phase,
+        (Phase == 'i') ? "\"s\":\"t\"," : "",
+        Cpu,
+        DivU64x32 (NanoSeconds, 1000),
+        (UINT32)ModU64x32 (NanoSeconds, 1000),
+        Record->Identifier,
+        Record->Address
+        );
+    }
+  }
+
+  //
+  // Trailing metadata event, as JSON does not allow a comma after the last element.
+  //
+  Print (L"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"DXE\"}}\n]}\n");
+}
+
+/**
+  The Entry Point for performance trace info application.
+
+  @param  ImageHandle    The firmware allocated handle for the EFI image.
+  @param  SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS    The entry point is executed successfully.
+  @retval Other          Some error occurred when executing this entry point.
+**/
+EFI_STATUS
+EFIAPI
+PerfTraceInfoEntrypoint (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL  *ShellParameters;
+  BOOLEAN                        ChromeTrace;
+
+  ChromeTrace = FALSE;
+  Status      = gBS->HandleProtocol (ImageHandle, &gEfiShellParametersProtocolGuid, (VOID **)&ShellParameters);
+  if (!EFI_ERROR (Status) && (ShellParameters->Argc > 1)) {
+    if ((ShellParameters->Argc == 2) &&
+        ((StrCmp (ShellParameters->Argv[1], L"-c") == 0) || (StrCmp (ShellParameters->Argv[1], L"-C") == 0)))
+    {
+      ChromeTrace = TRUE;
+    } else {
+      Print (L"Usage: PerfTraceInfo [-c]\n");
+      Print (L"  -c  Dump the trace in the Chrome trace event format.\n");
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  Status = EfiGetSystemConfigurationTable (&gEdkiiPerformanceTraceGuid, (VOID **)&mTraceTable);
+  if (EFI_ERROR (Status) || (mTraceTable->Signature != PERFORMANCE_TRACE_TABLE_SIGNATURE)) {
+    Print (L"PerfTraceInfo: Performance trace is not enabled - %r\n", EFI_NOT_FOUND);
+    return EFI_NOT_FOUND;
+  }
+
+  if (ChromeTrace) {
+    DumpChromeTrace ();
+  } else {
+    DumpTraceSummary ();
+  }
+
+  return EFI_SUCCESS;
+}
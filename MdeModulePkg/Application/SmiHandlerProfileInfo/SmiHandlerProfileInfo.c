@@ -629,6 +629,18 @@ DumpSmiHandler (
         }
 
         Print (L"      </Caller>\n", SmiHandlerStruct->Handler);
+        if ((SmiStruct->Header.Revision >= SMM_CORE_SMI_DATABASE_REVISION_2) &&
+            (SmiHandlerStruct->Length >= sizeof (SMM_CORE_SMI_HANDLER_STRUCTURE)) &&
+            (SmiStruct->HandlerCategory != SmmCoreSmiHandlerCategoryHardwareHandler))
+        {
+          Print (
+            L"      <Dispatch Count=\"%ld\" TotalTime=\"%ld\" MaxTime=\"%ld\" Unit=\"ns\"/>\n",
+            SmiHandlerStruct->DispatchCount,
+            SmiHandlerStruct->TotalTimeInNanoSeconds,
+            SmiHandlerStruct->MaxTimeInNanoSeconds
+            );
+        }
+
         SmiHandlerStruct = (VOID *)((UINTN)SmiHandlerStruct + SmiHandlerStruct->Length);
         Print (L"    </SmiHandler>\n");
       }
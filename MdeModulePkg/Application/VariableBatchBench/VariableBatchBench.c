@@ -0,0 +1,387 @@
+/** @file
+  Shell application to measure the SMI count and latency of the variable services,
+  one call per variable against the EDKII Variable Batch Protocol.
+
+  The SMIs are counted by wrapping the Communicate() service of the MM Communication 2
+  Protocol while the application runs. Variables are enumerated, read, created and
+  deleted both ways. The variables created are volatile and are deleted before the
+  application returns.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiApplicationEntryPoint.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/BaseLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PrintLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+
+#include <Protocol/MmCommunication2.h>
+#include <Protocol/VariableBatch.h>
+
+#define BENCH_VARIABLE_COUNT      32
+#define BENCH_VARIABLE_DATA_SIZE  16
+#define BENCH_NAME_LENGTH         16
+
+EFI_GUID  mBenchVendorGuid = {
+  0x9ed81a12, 0xa8b0, 0x4766, { 0xb6, 0x2d, 0x76, 0x6a, 0x70, 0x6c, 0x51, 0x57 }
+};
+
+EFI_MM_COMMUNICATION2_PROTOCOL  *mMmCommunication2;
+EFI_MM_COMMUNICATE2             mOriginalCommunicate;
+UINTN                           mCommunicateCount;
+UINTN                           mStartCommunicateCount;
+UINT64                          mStartTicks;
+
+/**
+  Communicate() service counting the SMIs.
+
+  @param[in]      This                The EFI_MM_COMMUNICATION2_PROTOCOL instance.
+  @param[in, out] CommBufferPhysical  Physical address of the MM communication buffer.
+  @param[in, out] CommBufferVirtual   Virtual address of the MM communication buffer.
+  @param[in, out] CommSize            The size of the data buffer being passed in.
+
+  @return The status returned by the original Communicate() service.
+**/
+EFI_STATUS
+EFIAPI
+BenchCommunicate (
+  IN CONST EFI_MM_COMMUNICATION2_PROTOCOL  *This,
+  IN OUT VOID                              *CommBufferPhysical,
+  IN OUT VOID                              *CommBufferVirtual,
+  IN OUT UINTN                             *CommSize OPTIONAL
+  )
+{
+  mCommunicateCount++;
+  return mOriginalCommunicate (This, CommBufferPhysical, CommBufferVirtual, CommSize);
+}
+
+/**
+  Start a measurement.
+**/
+VOID
+BenchStart (
+  VOID
+  )
+{
+  mStartCommunicateCount = mCommunicateCount;
+  mStartTicks            = GetPerformanceCounter ();
+}
+
+/**
+  End a measurement and print its SMI count and latency.
+
+  @param[in]  Label           The name of the measurement.
+  @param[in]  OperationCount  The number of variables the measurement worked on.
+**/
+VOID
+BenchEnd (
+  IN CONST CHAR16  *Label,
+  IN UINTN         OperationCount
+  )
+{
+  UINT64  StartValue;
+  UINT64  EndValue;
+  UINT64  Ticks;
+  UINT64  Nanoseconds;
+
+  Ticks = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&StartValue, &EndValue);
+  if (StartValue > EndValue) {
+    Ticks = mStartTicks - Ticks;
+  } else {
+    Ticks = Ticks - mStartTicks;
+  }
+
+  Nanoseconds = GetTimeInNanoSecond (Ticks);
+  Print (
+    L"%-28s %6d %8d %10ld\n",
+    Label,
+    OperationCount,
+    mCommunicateCount - mStartCommunicateCount,
+    DivU64x32 (Nanoseconds, 1000)
+    );
+}
+
+/**
+  Enumerate the variables with GetNextVariableName().
+
+  @return The number of variables.
+**/
+UINTN
+EnumerateVariables (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  CHAR16      *Name;
+  CHAR16      *NewName;
+  UINTN       NameBufferSize;
+  UINTN       NameSize;
+  EFI_GUID    Guid;
+  UINTN       Count;
+
+  NameBufferSize = 0x100;
+  Name           = AllocateZeroPool (NameBufferSize);
+  if (Name == NULL) {
+    return 0;
+  }
+
+  Count = 0;
+  while (TRUE) {
+    NameSize = NameBufferSize;
+    Status   = gRT->GetNextVariableName (&NameSize, Name, &Guid);
+    if (Status == EFI_BUFFER_TOO_SMALL) {
+      NewName = ReallocatePool (NameBufferSize, NameSize, Name);
+      if (NewName == NULL) {
+        break;
+      }
+
+      Name           = NewName;
+      NameBufferSize = NameSize;
+      continue;
+    }
+
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    Count++;
+  }
+
+  FreePool (Name);
+  return Count;
+}
+
+/**
+  Build the name of a benchmark variable.
+
+  @param[out] Name   The buffer of BENCH_NAME_LENGTH characters receiving the name.
+  @param[in]  Index  The index of the variable.
+**/
+VOID
+GetBenchVariableName (
+  OUT CHAR16  *Name,
+  IN  UINTN   Index
+  )
+{
+  UnicodeSPrint (Name, BENCH_NAME_LENGTH * sizeof (CHAR16), L"VarBatchBench%02d", Index);
+}
+
+/**
+  Measure the creation and the deletion of the benchmark variables, one call per
+  variable and then in one batch.
+
+  @param[in]  VariableBatch  The EDKII Variable Batch Protocol.
+**/
+VOID
+BenchWriteVariables (
+  IN EDKII_VARIABLE_BATCH_PROTOCOL  *VariableBatch
+  )
+{
+  EDKII_VARIABLE_BATCH_OPERATION  Operations[BENCH_VARIABLE_COUNT];
+  CHAR16                          Names[BENCH_VARIABLE_COUNT][BENCH_NAME_LENGTH];
+  UINT8                           Data[BENCH_VARIABLE_DATA_SIZE];
+  UINT32                          Attributes;
+  UINTN                           Index;
+
+  Attributes = EFI_VARIABLE_BOOTSERVICE_ACCESS;
+  SetMem (Data, sizeof (Data), 0x5A);
+  for (Index = 0; Index < BENCH_VARIABLE_COUNT; Index++) {
+    GetBenchVariableName (Names[Index], Index);
+  }
+
+  BenchStart ();
+  for (Index = 0; Index < BENCH_VARIABLE_COUNT; Index++) {
+    gRT->SetVariable (Names[Index], &mBenchVendorGuid, Attributes, sizeof (Data), Data);
+  }
+
+  BenchEnd (L"SetVariable create", BENCH_VARIABLE_COUNT);
+
+  BenchStart ();
+  for (Index = 0; Index < BENCH_VARIABLE_COUNT; Index++) {
+    gRT->SetVariable (Names[Index], &mBenchVendorGuid, Attributes, 0, NULL);
+  }
+
+  BenchEnd (L"SetVariable delete", BENCH_VARIABLE_COUNT);
+
+  for (Index = 0; Index < BENCH_VARIABLE_COUNT; Index++) {
+    Operations[Index].Type         = EdkiiVariableBatchSetVariable;
+    Operations[Index].VariableName = Names[Index];
+    Operations[Index].VendorGuid   = &mBenchVendorGuid;
+    Operations[Index].Attributes   = Attributes;
+    Operations[Index].DataSize     = sizeof (Data);
+    Operations[Index].Data         = Data;
+  }
+
+  BenchStart ();
+  VariableBatch->Execute (VariableBatch, BENCH_VARIABLE_COUNT, Operations);
+  BenchEnd (L"Batch create", BENCH_VARIABLE_COUNT);
+
+  for (Index = 0; Index < BENCH_VARIABLE_COUNT; Index++) {
+    if (EFI_ERROR (Operations[Index].Status)) {
+      Print (L"Batch create of %s failed - %r\n", Names[Index], Operations[Index].Status);
+    }
+
+    Operations[Index].DataSize = 0;
+    Operations[Index].Data     = NULL;
+  }
+
+  BenchStart ();
+  VariableBatch->Execute (VariableBatch, BENCH_VARIABLE_COUNT, Operations);
+  BenchEnd (L"Batch delete", BENCH_VARIABLE_COUNT);
+}
+
+/**
+  Measure the enumeration and the reading of all the variables, one call per
+  variable and then with the batch protocol.
+
+  @param[in]  VariableBatch  The EDKII Variable Batch Protocol.
+**/
+VOID
+BenchReadVariables (
+  IN EDKII_VARIABLE_BATCH_PROTOCOL  *VariableBatch
+  )
+{
+  EFI_STATUS                      Status;
+  EDKII_VARIABLE_BATCH_OPERATION  *Operations;
+  EDKII_VARIABLE_NAME_ENTRY       *Entry;
+  UINT8                           *Names;
+  UINT8                           *Data;
+  UINTN                           NamesSize;
+  UINTN                           NameCount;
+  UINTN                           DataSize;
+  UINTN                           Index;
+
+  BenchStart ();
+  NameCount = EnumerateVariables ();
+  BenchEnd (L"GetNextVariableName", NameCount);
+
+  BenchStart ();
+  NamesSize = 0;
+  Names     = NULL;
+  Status    = VariableBatch->GetVariableNames (VariableBatch, &NamesSize, NULL, NULL);
+  if (Status == EFI_BUFFER_TOO_SMALL) {
+    Names = AllocatePool (NamesSize);
+    if (Names != NULL) {
+      Status = VariableBatch->GetVariableNames (VariableBatch, &NamesSize, Names, &NameCount);
+    }
+  }
+
+  BenchEnd (L"Batch GetVariableNames", NameCount);
+  if (EFI_ERROR (Status) || (Names == NULL) || (NameCount == 0)) {
+    Print (L"GetVariableNames failed - %r\n", Status);
+    goto Done;
+  }
+
+  Operations = AllocateZeroPool (NameCount * sizeof (EDKII_VARIABLE_BATCH_OPERATION));
+  if (Operations == NULL) {
+    goto Done;
+  }
+
+  //
+  // Get the data sizes first, so that the reads are done with buffers of the exact size.
+  //
+  Entry = (EDKII_VARIABLE_NAME_ENTRY *)Names;
+  for (Index = 0; Index < NameCount; Index++) {
+    Operations[Index].Type         = EdkiiVariableBatchGetVariable;
+    Operations[Index].VariableName = Entry->Name;
+    Operations[Index].VendorGuid   = &Entry->VendorGuid;
+    Entry                          = (EDKII_VARIABLE_NAME_ENTRY *)((UINT8 *)Entry + EDKII_VARIABLE_NAME_ENTRY_SIZE (Entry->NameSize));
+  }
+
+  VariableBatch->Execute (VariableBatch, NameCount, Operations);
+
+  DataSize = 0;
+  for (Index = 0; Index < NameCount; Index++) {
+    DataSize += Operations[Index].DataSize;
+  }
+
+  Data = AllocatePool (MAX (DataSize, 1));
+  if (Data == NULL) {
+    FreePool (Operations);
+    goto Done;
+  }
+
+  BenchStart ();
+  DataSize = 0;
+  for (Index = 0; Index < NameCount; Index++) {
+    Operations[Index].Data = Data + DataSize;
+    gRT->GetVariable (
+           Operations[Index].VariableName,
+           Operations[Index].VendorGuid,
+           NULL,
+           &Operations[Index].DataSize,
+           Operations[Index].Data
+           );
+    DataSize += Operations[Index].DataSize;
+  }
+
+  BenchEnd (L"GetVariable", NameCount);
+
+  BenchStart ();
+  VariableBatch->Execute (VariableBatch, NameCount, Operations);
+  BenchEnd (L"Batch GetVariable", NameCount);
+
+  FreePool (Data);
+  FreePool (Operations);
+
+Done:
+  if (Names != NULL) {
+    FreePool (Names);
+  }
+}
+
+/**
+  The user Entry Point for Application. The user code starts with this function
+  as the real entry point for the application.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       The entry point is executed successfully.
+  @retval other             Some error occurs when executing this entry point.
+
+**/
+EFI_STATUS
+EFIAPI
+VariableBatchBenchEntrypoint (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                     Status;
+  EDKII_VARIABLE_BATCH_PROTOCOL  *VariableBatch;
+
+  Status = gBS->LocateProtocol (&gEdkiiVariableBatchProtocolGuid, NULL, (VOID **)&VariableBatch);
+  if (EFI_ERROR (Status)) {
+    Print (L"Variable Batch Protocol not found - %r\n", Status);
+    return Status;
+  }
+
+  Status = gBS->LocateProtocol (&gEfiMmCommunication2ProtocolGuid, NULL, (VOID **)&mMmCommunication2);
+  if (EFI_ERROR (Status)) {
+    Print (L"SMIs are not counted, MM Communication 2 Protocol not found - %r\n", Status);
+    mMmCommunication2 = NULL;
+  } else {
+    mOriginalCommunicate           = mMmCommunication2->Communicate;
+    mMmCommunication2->Communicate = BenchCommunicate;
+  }
+
+  Print (L"%-28s %6s %8s %10s\n", L"Operation", L"Vars", L"SMIs", L"Time(us)");
+  BenchReadVariables (VariableBatch);
+  BenchWriteVariables (VariableBatch);
+
+  if (mMmCommunication2 != NULL) {
+    mMmCommunication2->Communicate = mOriginalCommunicate;
+  }
+
+  return EFI_SUCCESS;
+}
@@ -103,6 +103,33 @@ typedef struct {
   PEI_PPI_LIST_POINTERS    *NotifyPtrs;
 } PEI_DISPATCH_NOTIFY_LIST;
 
+///
+/// Minimum number of slots in a PPI database GUID index.
+///
+#define PPI_GUID_INDEX_MIN_SLOTS  64
+
+///
+/// Open-addressed GUID index over one list of the PPI database.
+/// It is only used when PcdPeiCorePpiGuidIndex is TRUE.
+///
+/// Each non-zero slot holds the upper 16 bits of the GUID hash in its upper
+/// half and the list index plus one in its lower half. Slots refer to list
+/// entries by index rather than by address, so the index stays valid when
+/// the PPI descriptors are migrated from temporary memory; only the Slots
+/// buffer itself has to be relocated with the heap.
+///
+typedef struct {
+  ///
+  /// Number of slots, always a power of two. Zero if not built yet.
+  ///
+  UINTN     SlotCount;
+  ///
+  /// Number of list entries, counting from index 0, present in the index.
+  ///
+  UINTN     EntryCount;
+  UINT32    *Slots;
+} PEI_PPI_GUID_INDEX;
+
 ///
 /// PPI database structure which contains three links:
 /// PpiList, CallbackNotifyList and DispatchNotifyList.
@@ -120,8 +147,25 @@ typedef struct {
   /// Notify List at callback level.
   ///
   PEI_DISPATCH_NOTIFY_LIST    DispatchNotifyList;
+  ///
+  /// GUID indexes over PpiList, CallbackNotifyList and DispatchNotifyList.
+  ///
+  PEI_PPI_GUID_INDEX          PpiIndex;
+  PEI_PPI_GUID_INDEX          CallbackNotifyIndex;
+  PEI_PPI_GUID_INDEX          DispatchNotifyIndex;
 } PEI_PPI_DATABASE;
 
+///
+/// Time spent searching the PPI database. Only collected when
+/// PcdPeiCorePpiDatabaseProfile is TRUE.
+///
+typedef struct {
+  UINT64    LocateTicks;
+  UINTN     LocateCount;
+  UINT64    NotifyTicks;
+  UINTN     NotifyCount;
+} PEI_PPI_DATABASE_PROFILE;
+
 //
 // PEI_CORE_FV_HANDLE.PeimState
 // Do not change these values as there is code doing math to change states.
@@ -335,6 +379,11 @@ struct _PEI_CORE_INSTANCE {
   // Table of delayed dispatch requests
   //
   DELAYED_DISPATCH_TABLE            *DelayedDispatchTable;
+
+  //
+  // Time spent in PPI locate and notify matching.
+  //
+  PEI_PPI_DATABASE_PROFILE          PpiProfile;
 };
 
 ///
@@ -574,6 +623,75 @@ ConvertPeiCorePpiPointers (
   IN  PEI_CORE_FV_HANDLE  *CoreFvHandle
   );
 
+/**
+
+  Find the first entry of a PPI database list whose GUID matches Guid, with
+  list index in [StartIndex, StopIndex).
+
+  When PcdPeiCorePpiGuidIndex is TRUE, GuidIndex is brought up to date with
+  the list and probed. Otherwise, or if the index cannot be allocated, the
+  list is scanned linearly.
+
+  @param GuidIndex       GUID index over the list.
+  @param ListPtrs        Entries of the list.
+  @param ListCount       Number of valid entries in ListPtrs.
+  @param Guid            GUID to search for.
+  @param StartIndex      First list index to consider.
+  @param StopIndex       List index to stop the search at.
+
+  @return The list index of the matching entry, or -1 if there is none.
+
+**/
+INTN
+PeiPpiListFindGuid (
+  IN OUT PEI_PPI_GUID_INDEX     *GuidIndex,
+  IN     PEI_PPI_LIST_POINTERS  *ListPtrs,
+  IN     UINTN                  ListCount,
+  IN     CONST EFI_GUID         *Guid,
+  IN     INTN                   StartIndex,
+  IN     INTN                   StopIndex
+  );
+
+/**
+
+  Discard the content of a PPI database GUID index. It is rebuilt from the
+  list on its next use.
+
+  @param GuidIndex       GUID index to invalidate.
+
+**/
+VOID
+PeiPpiGuidIndexInvalidate (
+  IN OUT PEI_PPI_GUID_INDEX  *GuidIndex
+  );
+
+/**
+
+  Get the number of performance counter ticks elapsed since StartTicks,
+  taking the counting direction of the performance counter into account.
+
+  @param StartTicks      Performance counter value at the start.
+
+  @return Elapsed ticks.
+
+**/
+UINT64
+PeiPpiProfileElapsed (
+  IN UINT64  StartTicks
+  );
+
+/**
+
+  Report the time spent in PPI locate and notify matching to debug output.
+
+  @param PrivateData     Points to PeiCore's private instance data.
+
+**/
+VOID
+DumpPpiProfile (
+  IN PEI_CORE_INSTANCE  *PrivateData
+  );
+
 /**
 
   Dumps the PPI lists to debug output.
@@ -232,6 +232,18 @@ PeiCore (
           OldCoreData->PpiData.DispatchNotifyList.NotifyPtrs = (PEI_PPI_LIST_POINTERS *)((UINT8 *)OldCoreData->PpiData.DispatchNotifyList.NotifyPtrs + OldCoreData->HeapOffset);
         }
 
+        if (OldCoreData->PpiData.PpiIndex.Slots != NULL) {
+          OldCoreData->PpiData.PpiIndex.Slots = (UINT32 *)((UINT8 *)OldCoreData->PpiData.PpiIndex.Slots + OldCoreData->HeapOffset);
+        }
+
+        if (OldCoreData->PpiData.CallbackNotifyIndex.Slots != NULL) {
+          OldCoreData->PpiData.CallbackNotifyIndex.Slots = (UINT32 *)((UINT8 *)OldCoreData->PpiData.CallbackNotifyIndex.Slots + OldCoreData->HeapOffset);
+        }
+
+        if (OldCoreData->PpiData.DispatchNotifyIndex.Slots != NULL) {
+          OldCoreData->PpiData.DispatchNotifyIndex.Slots = (UINT32 *)((UINT8 *)OldCoreData->PpiData.DispatchNotifyIndex.Slots + OldCoreData->HeapOffset);
+        }
+
         OldCoreData->Fv = (PEI_CORE_FV_HANDLE *)((UINT8 *)OldCoreData->Fv + OldCoreData->HeapOffset);
         for (Index = 0; Index < OldCoreData->FvCount; Index++) {
           if (OldCoreData->Fv[Index].PeimState != NULL) {
@@ -267,6 +279,18 @@ PeiCore (
           OldCoreData->PpiData.DispatchNotifyList.NotifyPtrs = (PEI_PPI_LIST_POINTERS *)((UINT8 *)OldCoreData->PpiData.DispatchNotifyList.NotifyPtrs - OldCoreData->HeapOffset);
         }
 
+        if (OldCoreData->PpiData.PpiIndex.Slots != NULL) {
+          OldCoreData->PpiData.PpiIndex.Slots = (UINT32 *)((UINT8 *)OldCoreData->PpiData.PpiIndex.Slots - OldCoreData->HeapOffset);
+        }
+
+        if (OldCoreData->PpiData.CallbackNotifyIndex.Slots != NULL) {
+          OldCoreData->PpiData.CallbackNotifyIndex.Slots = (UINT32 *)((UINT8 *)OldCoreData->PpiData.CallbackNotifyIndex.Slots - OldCoreData->HeapOffset);
+        }
+
+        if (OldCoreData->PpiData.DispatchNotifyIndex.Slots != NULL) {
+          OldCoreData->PpiData.DispatchNotifyIndex.Slots = (UINT32 *)((UINT8 *)OldCoreData->PpiData.DispatchNotifyIndex.Slots - OldCoreData->HeapOffset);
+        }
+
         OldCoreData->Fv = (PEI_CORE_FV_HANDLE *)((UINT8 *)OldCoreData->Fv - OldCoreData->HeapOffset);
         for (Index = 0; Index < OldCoreData->FvCount; Index++) {
           if (OldCoreData->Fv[Index].PeimState != NULL) {
@@ -549,6 +573,8 @@ PeiCore (
     CpuDeadLoop ();
   }
 
+  DumpPpiProfile (&PrivateData);
+
   //
   // Enter DxeIpl to load Dxe core.
   //
@@ -625,6 +625,9 @@ PeiReInstallPpi (
   //
   DEBUG ((DEBUG_INFO, "Reinstall PPI: %g\n", NewPpi->Guid));
   PrivateData->PpiData.PpiList.PpiPtrs[Index].Ppi = (EFI_PEI_PPI_DESCRIPTOR *)NewPpi;
+  if (!CompareGuid (OldPpi->Guid, NewPpi->Guid)) {
+    PeiPpiGuidIndexInvalidate (&PrivateData->PpiData.PpiIndex);
+  }
 
   //
   // Process any callback level notifies for the newly installed PPI.
@@ -668,46 +671,51 @@ PeiLocatePpi (
   )
 {
   PEI_CORE_INSTANCE       *PrivateData;
-  UINTN                   Index;
-  EFI_GUID                *CheckGuid;
+  INTN                    Index;
   EFI_PEI_PPI_DESCRIPTOR  *TempPtr;
+  UINT64                  StartTicks;
 
   PrivateData = PEI_CORE_INSTANCE_FROM_PS_THIS (PeiServices);
 
+  StartTicks = 0;
+  if (FeaturePcdGet (PcdPeiCorePpiDatabaseProfile)) {
+    StartTicks = GetPerformanceCounter ();
+  }
+
   //
   // Search the data base for the matching instance of the GUIDed PPI.
   //
-  for (Index = 0; Index < PrivateData->PpiData.PpiList.CurrentCount; Index++) {
-    TempPtr   = PrivateData->PpiData.PpiList.PpiPtrs[Index].Ppi;
-    CheckGuid = TempPtr->Guid;
-
-    //
-    // Don't use CompareGuid function here for performance reasons.
-    // Instead we compare the GUID as INT32 at a time and branch
-    // on the first failed comparison.
-    //
-    if ((((INT32 *)Guid)[0] == ((INT32 *)CheckGuid)[0]) &&
-        (((INT32 *)Guid)[1] == ((INT32 *)CheckGuid)[1]) &&
-        (((INT32 *)Guid)[2] == ((INT32 *)CheckGuid)[2]) &&
-        (((INT32 *)Guid)[3] == ((INT32 *)CheckGuid)[3]))
-    {
-      if (Instance == 0) {
-        if (PpiDescriptor != NULL) {
-          *PpiDescriptor = TempPtr;
-        }
+  Index = -1;
+  do {
+    Index = PeiPpiListFindGuid (
+              &PrivateData->PpiData.PpiIndex,
+              PrivateData->PpiData.PpiList.PpiPtrs,
+              PrivateData->PpiData.PpiList.CurrentCount,
+              Guid,
+              Index + 1,
+              (INTN)PrivateData->PpiData.PpiList.CurrentCount
+              );
+  } while ((Index >= 0) && (Instance-- != 0));
+
+  if (FeaturePcdGet (PcdPeiCorePpiDatabaseProfile)) {
+    PrivateData->PpiProfile.LocateTicks += PeiPpiProfileElapsed (StartTicks);
+    PrivateData->PpiProfile.LocateCount++;
+  }
 
-        if (Ppi != NULL) {
-          *Ppi = TempPtr->Ppi;
-        }
+  if (Index < 0) {
+    return EFI_NOT_FOUND;
+  }
 
-        return EFI_SUCCESS;
-      }
+  TempPtr = PrivateData->PpiData.PpiList.PpiPtrs[Index].Ppi;
+  if (PpiDescriptor != NULL) {
+    *PpiDescriptor = TempPtr;
+  }
 
-      Instance--;
-    }
+  if (Ppi != NULL) {
+    *Ppi = TempPtr->Ppi;
   }
 
-  return EFI_NOT_FOUND;
+  return EFI_SUCCESS;
 }
 
 /**
@@ -971,42 +979,116 @@ ProcessNotify (
   EFI_GUID                   *SearchGuid;
   EFI_GUID                   *CheckGuid;
   EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyDescriptor;
+  PEI_PPI_GUID_INDEX         *NotifyIndex;
+  PEI_PPI_LIST_POINTERS      *NotifyPtrs;
+  UINTN                      NotifyCount;
+  UINT64                     StartTicks;
 
-  for (Index1 = NotifyStartIndex; Index1 < NotifyStopIndex; Index1++) {
-    if (NotifyType == EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK) {
-      NotifyDescriptor = PrivateData->PpiData.CallbackNotifyList.NotifyPtrs[Index1].Notify;
-    } else {
-      NotifyDescriptor = PrivateData->PpiData.DispatchNotifyList.NotifyPtrs[Index1].Notify;
-    }
+  if (NotifyType == EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK) {
+    NotifyIndex = &PrivateData->PpiData.CallbackNotifyIndex;
+  } else {
+    NotifyIndex = &PrivateData->PpiData.DispatchNotifyIndex;
+  }
 
-    CheckGuid = NotifyDescriptor->Guid;
+  StartTicks = 0;
+  if (FeaturePcdGet (PcdPeiCorePpiDatabaseProfile)) {
+    StartTicks = GetPerformanceCounter ();
+    PrivateData->PpiProfile.NotifyCount++;
+  }
 
-    for (Index2 = InstallStartIndex; Index2 < InstallStopIndex; Index2++) {
-      SearchGuid = PrivateData->PpiData.PpiList.PpiPtrs[Index2].Ppi->Guid;
+  if (FeaturePcdGet (PcdPeiCorePpiGuidIndex) && (InstallStopIndex - InstallStartIndex == 1)) {
+    //
+    // A single PPI was installed or reinstalled. Look up the notifies of its
+    // GUID in the notify index instead of checking every notify against it.
+    // The notify callbacks are invoked in the same order as below.
+    //
+    SearchGuid = PrivateData->PpiData.PpiList.PpiPtrs[InstallStartIndex].Ppi->Guid;
+    for (Index1 = NotifyStartIndex; ; Index1++) {
       //
-      // Don't use CompareGuid function here for performance reasons.
-      // Instead we compare the GUID as INT32 at a time and branch
-      // on the first failed comparison.
+      // The notify lists may grow in the notify callback, so fetch them each time.
       //
-      if ((((INT32 *)SearchGuid)[0] == ((INT32 *)CheckGuid)[0]) &&
-          (((INT32 *)SearchGuid)[1] == ((INT32 *)CheckGuid)[1]) &&
-          (((INT32 *)SearchGuid)[2] == ((INT32 *)CheckGuid)[2]) &&
-          (((INT32 *)SearchGuid)[3] == ((INT32 *)CheckGuid)[3]))
-      {
+      if (NotifyType == EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK) {
+        NotifyPtrs  = PrivateData->PpiData.CallbackNotifyList.NotifyPtrs;
+        NotifyCount = PrivateData->PpiData.CallbackNotifyList.CurrentCount;
+      } else {
+        NotifyPtrs  = PrivateData->PpiData.DispatchNotifyList.NotifyPtrs;
+        NotifyCount = PrivateData->PpiData.DispatchNotifyList.CurrentCount;
+      }
+
+      Index1 = PeiPpiListFindGuid (NotifyIndex, NotifyPtrs, NotifyCount, SearchGuid, Index1, NotifyStopIndex);
+      if (Index1 < 0) {
+        break;
+      }
+
+      NotifyDescriptor = NotifyPtrs[Index1].Notify;
+      DEBUG ((
+        DEBUG_INFO,
+        "Notify: PPI Guid: %g, Peim notify entry point: %p\n",
+        SearchGuid,
+        NotifyDescriptor->Notify
+        ));
+      if (FeaturePcdGet (PcdPeiCorePpiDatabaseProfile)) {
+        PrivateData->PpiProfile.NotifyTicks += PeiPpiProfileElapsed (StartTicks);
+      }
+
+      NotifyDescriptor->Notify (
+                          (EFI_PEI_SERVICES **)GetPeiServicesTablePointer (),
+                          NotifyDescriptor,
+                          (PrivateData->PpiData.PpiList.PpiPtrs[InstallStartIndex].Ppi)->Ppi
+                          );
+      if (FeaturePcdGet (PcdPeiCorePpiDatabaseProfile)) {
+        StartTicks = GetPerformanceCounter ();
+      }
+    }
+  } else {
+    for (Index1 = NotifyStartIndex; Index1 < NotifyStopIndex; Index1++) {
+      if (NotifyType == EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK) {
+        NotifyDescriptor = PrivateData->PpiData.CallbackNotifyList.NotifyPtrs[Index1].Notify;
+      } else {
+        NotifyDescriptor = PrivateData->PpiData.DispatchNotifyList.NotifyPtrs[Index1].Notify;
+      }
+
+      CheckGuid = NotifyDescriptor->Guid;
+
+      for (Index2 = InstallStartIndex; ; Index2++) {
+        Index2 = PeiPpiListFindGuid (
+                   &PrivateData->PpiData.PpiIndex,
+                   PrivateData->PpiData.PpiList.PpiPtrs,
+                   PrivateData->PpiData.PpiList.CurrentCount,
+                   CheckGuid,
+                   Index2,
+                   InstallStopIndex
+                   );
+        if (Index2 < 0) {
+          break;
+        }
+
+        SearchGuid = PrivateData->PpiData.PpiList.PpiPtrs[Index2].Ppi->Guid;
         DEBUG ((
           DEBUG_INFO,
           "Notify: PPI Guid: %g, Peim notify entry point: %p\n",
           SearchGuid,
           NotifyDescriptor->Notify
           ));
+        if (FeaturePcdGet (PcdPeiCorePpiDatabaseProfile)) {
+          PrivateData->PpiProfile.NotifyTicks += PeiPpiProfileElapsed (StartTicks);
+        }
+
         NotifyDescriptor->Notify (
                             (EFI_PEI_SERVICES **)GetPeiServicesTablePointer (),
                             NotifyDescriptor,
                             (PrivateData->PpiData.PpiList.PpiPtrs[Index2].Ppi)->Ppi
                             );
+        if (FeaturePcdGet (PcdPeiCorePpiDatabaseProfile)) {
+          StartTicks = GetPerformanceCounter ();
+        }
       }
     }
   }
+
+  if (FeaturePcdGet (PcdPeiCorePpiDatabaseProfile)) {
+    PrivateData->PpiProfile.NotifyTicks += PeiPpiProfileElapsed (StartTicks);
+  }
 }
 
 /**
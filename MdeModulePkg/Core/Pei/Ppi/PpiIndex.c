@@ -0,0 +1,330 @@
+/** @file
+  GUID index over the PEI Core PPI database lists.
+
+  PeiLocatePpi() and ProcessNotify() would otherwise compare every entry of
+  the PPI list against every GUID they look for. With a few hundred PPIs and
+  notifies this becomes the dominant cost of PPI services before permanent
+  memory is installed, so the lists can optionally be indexed by GUID with a
+  small open-addressed hash table.
+
+  Entries of a PPI database list are only ever appended, so the table uses
+  linear probing without deletion. Entries with the same GUID are therefore
+  met in list order along the probe sequence, which keeps the instance order
+  of PeiLocatePpi() and the callback order of ProcessNotify() unchanged.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "PeiMain.h"
+
+#define PPI_GUID_INDEX_ENTRY_MASK  0x0000FFFF
+#define PPI_GUID_INDEX_TAG_MASK    0xFFFF0000
+
+/**
+
+  Compute the hash of a GUID.
+
+  @param Guid            GUID to hash.
+
+  @return Hash value of the GUID.
+
+**/
+STATIC
+UINT32
+PpiGuidHash (
+  IN CONST EFI_GUID  *Guid
+  )
+{
+  UINT32  Hash;
+
+  Hash  = ((UINT32 *)Guid)[0] ^ ((UINT32 *)Guid)[1] ^ ((UINT32 *)Guid)[2] ^ ((UINT32 *)Guid)[3];
+  Hash *= 0x9E3779B1;
+  return Hash ^ (Hash >> 15);
+}
+
+/**
+
+  Compare two GUIDs.
+
+  Don't use CompareGuid function here for performance reasons.
+  Instead we compare the GUID as INT32 at a time and branch
+  on the first failed comparison.
+
+  @param Guid1           First GUID.
+  @param Guid2           Second GUID.
+
+  @retval TRUE           The GUIDs are equal.
+  @retval FALSE          The GUIDs are different.
+
+**/
+STATIC
+BOOLEAN
+PpiGuidEqual (
+  IN CONST EFI_GUID  *Guid1,
+  IN CONST EFI_GUID  *Guid2
+  )
+{
+  return (BOOLEAN)((((INT32 *)Guid1)[0] == ((INT32 *)Guid2)[0]) &&
+                   (((INT32 *)Guid1)[1] == ((INT32 *)Guid2)[1]) &&
+                   (((INT32 *)Guid1)[2] == ((INT32 *)Guid2)[2]) &&
+                   (((INT32 *)Guid1)[3] == ((INT32 *)Guid2)[3]));
+}
+
+/**
+
+  Insert one list entry into a GUID index that has a free slot for it.
+
+  @param GuidIndex       GUID index.
+  @param Guid            GUID of the list entry.
+  @param ListIndex       Index of the entry in the list.
+
+**/
+STATIC
+VOID
+PpiGuidIndexInsert (
+  IN OUT PEI_PPI_GUID_INDEX  *GuidIndex,
+  IN     CONST EFI_GUID      *Guid,
+  IN     UINTN               ListIndex
+  )
+{
+  UINT32  Hash;
+  UINTN   Slot;
+
+  Hash = PpiGuidHash (Guid);
+  Slot = Hash & (GuidIndex->SlotCount - 1);
+  while (GuidIndex->Slots[Slot] != 0) {
+    Slot = (Slot + 1) & (GuidIndex->SlotCount - 1);
+  }
+
+  GuidIndex->Slots[Slot] = (Hash & PPI_GUID_INDEX_TAG_MASK) | (UINT32)(ListIndex + 1);
+}
+
+/**
+
+  Bring a GUID index up to date with its list, growing it as needed so that
+  at most half of the slots are used.
+
+  @param GuidIndex       GUID index.
+  @param ListPtrs        Entries of the list.
+  @param ListCount       Number of valid entries in ListPtrs.
+
+  @retval TRUE           The GUID index covers all ListCount entries.
+  @retval FALSE          The GUID index could not be built.
+
+**/
+STATIC
+BOOLEAN
+PpiGuidIndexSync (
+  IN OUT PEI_PPI_GUID_INDEX     *GuidIndex,
+  IN     PEI_PPI_LIST_POINTERS  *ListPtrs,
+  IN     UINTN                  ListCount
+  )
+{
+  UINTN   SlotCount;
+  UINT32  *Slots;
+
+  if (ListCount >= PPI_GUID_INDEX_ENTRY_MASK) {
+    return FALSE;
+  }
+
+  if (GuidIndex->EntryCount > ListCount) {
+    //
+    // The list was rolled back after entries were indexed.
+    //
+    PeiPpiGuidIndexInvalidate (GuidIndex);
+  }
+
+  if (ListCount * 2 > GuidIndex->SlotCount) {
+    SlotCount = MAX (GuidIndex->SlotCount, PPI_GUID_INDEX_MIN_SLOTS);
+    while (ListCount * 2 > SlotCount) {
+      SlotCount *= 2;
+    }
+
+    //
+    // Memory allocated by PEI Core is never freed, the old slot buffer is
+    // left behind like the old list buffers are when a list grows.
+    //
+    Slots = AllocateZeroPool (SlotCount * sizeof (UINT32));
+    if (Slots == NULL) {
+      return FALSE;
+    }
+
+    GuidIndex->Slots      = Slots;
+    GuidIndex->SlotCount  = SlotCount;
+    GuidIndex->EntryCount = 0;
+  }
+
+  for ( ; GuidIndex->EntryCount < ListCount; GuidIndex->EntryCount++) {
+    PpiGuidIndexInsert (GuidIndex, ListPtrs[GuidIndex->EntryCount].Ppi->Guid, GuidIndex->EntryCount);
+  }
+
+  return TRUE;
+}
+
+/**
+
+  Discard the content of a PPI database GUID index. It is rebuilt from the
+  list on its next use.
+
+  @param GuidIndex       GUID index to invalidate.
+
+**/
+VOID
+PeiPpiGuidIndexInvalidate (
+  IN OUT PEI_PPI_GUID_INDEX  *GuidIndex
+  )
+{
+  if (GuidIndex->Slots != NULL) {
+    ZeroMem (GuidIndex->Slots, GuidIndex->SlotCount * sizeof (UINT32));
+  }
+
+  GuidIndex->EntryCount = 0;
+}
+
+/**
+
+  Find the first entry of a PPI database list whose GUID matches Guid, with
+  list index in [StartIndex, StopIndex).
+
+  When PcdPeiCorePpiGuidIndex is TRUE, GuidIndex is brought up to date with
+  the list and probed. Otherwise, or if the index cannot be allocated, the
+  list is scanned linearly.
+
+  @param GuidIndex       GUID index over the list.
+  @param ListPtrs        Entries of the list.
+  @param ListCount       Number of valid entries in ListPtrs.
+  @param Guid            GUID to search for.
+  @param StartIndex      First list index to consider.
+  @param StopIndex       List index to stop the search at.
+
+  @return The list index of the matching entry, or -1 if there is none.
+
+**/
+INTN
+PeiPpiListFindGuid (
+  IN OUT PEI_PPI_GUID_INDEX     *GuidIndex,
+  IN     PEI_PPI_LIST_POINTERS  *ListPtrs,
+  IN     UINTN                  ListCount,
+  IN     CONST EFI_GUID         *Guid,
+  IN     INTN                   StartIndex,
+  IN     INTN                   StopIndex
+  )
+{
+  INTN    Index;
+  UINT32  Hash;
+  UINTN   Slot;
+  UINT32  Entry;
+
+  if (StopIndex > (INTN)ListCount) {
+    StopIndex = (INTN)ListCount;
+  }
+
+  if (StartIndex >= StopIndex) {
+    return -1;
+  }
+
+  if (!FeaturePcdGet (PcdPeiCorePpiGuidIndex) ||
+      !PpiGuidIndexSync (GuidIndex, ListPtrs, ListCount))
+  {
+    for (Index = StartIndex; Index < StopIndex; Index++) {
+      if (PpiGuidEqual (Guid, ListPtrs[Index].Ppi->Guid)) {
+        return Index;
+      }
+    }
+
+    return -1;
+  }
+
+  //
+  // Entries with the same GUID are met in increasing list index order, so the
+  // first one at or above StartIndex is the answer, and the first one at or
+  // above StopIndex ends the search.
+  //
+  Hash = PpiGuidHash (Guid);
+  for (Slot = Hash & (GuidIndex->SlotCount - 1); ; Slot = (Slot + 1) & (GuidIndex->SlotCount - 1)) {
+    Entry = GuidIndex->Slots[Slot];
+    if (Entry == 0) {
+      return -1;
+    }
+
+    if ((Entry & PPI_GUID_INDEX_TAG_MASK) != (Hash & PPI_GUID_INDEX_TAG_MASK)) {
+      continue;
+    }
+
+    Index = (INTN)(Entry & PPI_GUID_INDEX_ENTRY_MASK) - 1;
+    if ((Index < StartIndex) || !PpiGuidEqual (Guid, ListPtrs[Index].Ppi->Guid)) {
+      continue;
+    }
+
+    return (Index < StopIndex) ? Index : -1;
+  }
+}
+
+/**
+
+  Get the number of performance counter ticks elapsed since StartTicks,
+  taking the counting direction of the performance counter into account.
+
+  @param StartTicks      Performance counter value at the start.
+
+  @return Elapsed ticks.
+
+**/
+UINT64
+PeiPpiProfileElapsed (
+  IN UINT64  StartTicks
+  )
+{
+  UINT64  EndTicks;
+  UINT64  StartValue;
+  UINT64  EndValue;
+
+  EndTicks = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&StartValue, &EndValue);
+  if (EndValue < StartValue) {
+    return StartTicks - EndTicks;
+  }
+
+  return EndTicks - StartTicks;
+}
+
+/**
+
+  Report the time spent in PPI locate and notify matching to debug output.
+
+  @param PrivateData     Points to PeiCore's private instance data.
+
+**/
+VOID
+DumpPpiProfile (
+  IN PEI_CORE_INSTANCE  *PrivateData
+  )
+{
+  if (!FeaturePcdGet (PcdPeiCorePpiDatabaseProfile)) {
+    return;
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "PPI database: %d PPIs, %d callback notifies, %d dispatch notifies (GUID index %a)\n",
+    (UINT32)PrivateData->PpiData.PpiList.CurrentCount,
+    (UINT32)PrivateData->PpiData.CallbackNotifyList.CurrentCount,
+    (UINT32)PrivateData->PpiData.DispatchNotifyList.CurrentCount,
+    FeaturePcdGet (PcdPeiCorePpiGuidIndex) ? "enabled" : "disabled"
+    ));
+  DEBUG ((
+    DEBUG_INFO,
+    "PPI database: %d locates took %ld ticks (%ld ns)\n",
+    (UINT32)PrivateData->PpiProfile.LocateCount,
+    PrivateData->PpiProfile.LocateTicks,
+    GetTimeInNanoSecond (PrivateData->PpiProfile.LocateTicks)
+    ));
+  DEBUG ((
+    DEBUG_INFO,
+    "PPI database: %d notify matches took %ld ticks (%ld ns)\n",
+    (UINT32)PrivateData->PpiProfile.NotifyCount,
+    PrivateData->PpiProfile.NotifyTicks,
+    GetTimeInNanoSecond (PrivateData->PpiProfile.NotifyTicks)
+    ));
+}
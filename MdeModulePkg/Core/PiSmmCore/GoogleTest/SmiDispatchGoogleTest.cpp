@@ -0,0 +1,528 @@
+/** @file
+  Unit tests of the SMI handler dispatch of the SMM Core.
+
+  Handlers are registered through SmiHandlerRegister () and dispatched through
+  SmiManage (). The tests check that the SMI entry of a handler type is found
+  through the hash table and the last hit cache, including for handler types of
+  the same hash bucket, that the status of the handlers stops the dispatch as
+  the PI specification requires, that handlers unregistered during the dispatch
+  are removed afterwards, and that the latency counters of the SMI handler
+  profile are updated.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <gtest/gtest.h>
+#include <map>
+#include <vector>
+extern "C" {
+  #include "../PiSmmCore.h"
+
+  extern LIST_ENTRY  mSmiEntryList;
+  extern SMI_ENTRY   mRootSmiEntry;
+  extern SMI_ENTRY   *mSmiEntryLastHit;
+  extern BOOLEAN     mSmiHandlerLatencyEnabled;
+  extern INTN        mSmiHandlerCounterDirection;
+
+  LIST_ENTRY *
+  SmiEntryHashBucket (
+    IN EFI_GUID  *HandlerType
+    );
+
+  SMI_ENTRY *
+  EFIAPI
+  SmmCoreFindSmiEntry (
+    IN EFI_GUID  *HandlerType,
+    IN BOOLEAN   Create
+    );
+}
+
+#define TEST_HANDLER_TYPE_COUNT  200
+#define TEST_COLLIDING_COUNT     4
+
+//
+// Handlers called by SmiManage (), in order.
+//
+STATIC std::vector<EFI_HANDLE>  mCalls;
+
+//
+// Status returned by a handler, EFI_SUCCESS if not set.
+//
+STATIC std::map<EFI_HANDLE, EFI_STATUS>  mHandlerStatus;
+
+//
+// Performance counter ticks elapsed in a handler, 0 if not set.
+//
+STATIC std::map<EFI_HANDLE, UINT64>  mHandlerTicks;
+
+STATIC UINT64   mPerformanceCounter;
+STATIC BOOLEAN  mPerformanceCounterDown;
+
+////////////////////////////////////////////////////////////////////////
+// Symbol Definitions
+// These are not directly under test - but required to link Smi.c
+////////////////////////////////////////////////////////////////////////
+extern "C" {
+  BOOLEAN
+  EFIAPI
+  LogPerformanceMeasurementEnabled (
+    IN  CONST UINTN  Type
+    )
+  {
+    return FALSE;
+  }
+
+  RETURN_STATUS
+  EFIAPI
+  LogPerformanceMeasurement (
+    IN CONST VOID   *CallerIdentifier  OPTIONAL,
+    IN CONST VOID   *Guid     OPTIONAL,
+    IN CONST CHAR8  *String   OPTIONAL,
+    IN UINT64       Address   OPTIONAL,
+    IN UINT32       Identifier
+    )
+  {
+    return RETURN_SUCCESS;
+  }
+
+  UINT64
+  EFIAPI
+  GetPerformanceCounter (
+    VOID
+    )
+  {
+    return mPerformanceCounter;
+  }
+
+  UINT64
+  EFIAPI
+  GetPerformanceCounterProperties (
+    OUT UINT64  *StartValue  OPTIONAL,
+    OUT UINT64  *EndValue    OPTIONAL
+    )
+  {
+    if (StartValue != NULL) {
+      *StartValue = mPerformanceCounterDown ? MAX_UINT64 : 0;
+    }
+
+    if (EndValue != NULL) {
+      *EndValue = mPerformanceCounterDown ? 0 : MAX_UINT64;
+    }
+
+    return 1000000000;
+  }
+}
+
+/**
+  Record the call, advance the performance counter by the ticks of the handler,
+  and return the status of the handler.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+RecordHandler (
+  IN     EFI_HANDLE  DispatchHandle,
+  IN     CONST VOID  *Context         OPTIONAL,
+  IN OUT VOID        *CommBuffer      OPTIONAL,
+  IN OUT UINTN       *CommBufferSize  OPTIONAL
+  )
+{
+  UINT64  Ticks;
+
+  mCalls.push_back (DispatchHandle);
+
+  Ticks = (mHandlerTicks.count (DispatchHandle) != 0) ? mHandlerTicks[DispatchHandle] : 0;
+  if (mPerformanceCounterDown) {
+    mPerformanceCounter -= Ticks;
+  } else {
+    mPerformanceCounter += Ticks;
+  }
+
+  return (mHandlerStatus.count (DispatchHandle) != 0) ? mHandlerStatus[DispatchHandle] : EFI_SUCCESS;
+}
+
+/**
+  Record the call and unregister the handler from within SmiManage ().
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnRegisterSelfHandler (
+  IN     EFI_HANDLE  DispatchHandle,
+  IN     CONST VOID  *Context         OPTIONAL,
+  IN OUT VOID        *CommBuffer      OPTIONAL,
+  IN OUT UINTN       *CommBufferSize  OPTIONAL
+  )
+{
+  mCalls.push_back (DispatchHandle);
+  EXPECT_EQ (SmiHandlerUnRegister (DispatchHandle), EFI_SUCCESS);
+  return EFI_WARN_INTERRUPT_SOURCE_PENDING;
+}
+
+STATIC
+EFI_GUID
+MakeHandlerType (
+  IN UINT32  Data1
+  )
+{
+  EFI_GUID  HandlerType = {
+    Data1, 0x5e1f, 0x4c2d, { 0x9a, 0x43, 0x11, 0x27, 0x6b, 0x80, 0xd5, 0x3c }
+  };
+
+  return HandlerType;
+}
+
+class SmiDispatchTest : public ::testing::Test {
+protected:
+  std::vector<EFI_HANDLE>  Handles;
+
+  void
+  SetUp (
+    ) override
+  {
+    mCalls.clear ();
+    mHandlerStatus.clear ();
+    mHandlerTicks.clear ();
+    mPerformanceCounter         = 0x100000;
+    mPerformanceCounterDown     = FALSE;
+    mSmiHandlerLatencyEnabled   = FALSE;
+    mSmiHandlerCounterDirection = 0;
+  }
+
+  void
+  TearDown (
+    ) override
+  {
+    for (EFI_HANDLE Handle : Handles) {
+      EXPECT_EQ (SmiHandlerUnRegister (Handle), EFI_SUCCESS);
+    }
+
+    EXPECT_TRUE (IsListEmpty (&mSmiEntryList));
+    EXPECT_TRUE (IsListEmpty (&mRootSmiEntry.SmiHandlers));
+    EXPECT_EQ (mSmiEntryLastHit, nullptr);
+  }
+
+  EFI_HANDLE
+  Register (
+    IN EFI_SMM_HANDLER_ENTRY_POINT2  Handler,
+    IN CONST EFI_GUID                *HandlerType
+    )
+  {
+    EFI_HANDLE  DispatchHandle;
+
+    DispatchHandle = NULL;
+    EXPECT_EQ (SmiHandlerRegister (Handler, HandlerType, &DispatchHandle), EFI_SUCCESS);
+    EXPECT_NE (DispatchHandle, nullptr);
+    Handles.push_back (DispatchHandle);
+    return DispatchHandle;
+  }
+
+  VOID
+  UnRegister (
+    IN EFI_HANDLE  DispatchHandle
+    )
+  {
+    EXPECT_EQ (SmiHandlerUnRegister (DispatchHandle), EFI_SUCCESS);
+    Handles.erase (std::find (Handles.begin (), Handles.end (), DispatchHandle));
+  }
+
+  //
+  // Get handler types of the same hash bucket.
+  //
+  VOID
+  GetCollidingHandlerTypes (
+    OUT EFI_GUID  *HandlerType,
+    IN  UINTN     Count
+    )
+  {
+    LIST_ENTRY  *Bucket;
+    EFI_GUID    Candidate;
+    UINT32      Data1;
+    UINTN       Index;
+
+    HandlerType[0] = MakeHandlerType (0);
+    Bucket         = SmiEntryHashBucket (&HandlerType[0]);
+    for (Data1 = 1, Index = 1; Index < Count; Data1++) {
+      Candidate = MakeHandlerType (Data1);
+      if (SmiEntryHashBucket (&Candidate) == Bucket) {
+        HandlerType[Index++] = Candidate;
+      }
+    }
+  }
+};
+
+TEST_F (SmiDispatchTest, UnregisteredTypeIsNotFound) {
+  EFI_GUID  Registered   = MakeHandlerType (1);
+  EFI_GUID  Unregistered = MakeHandlerType (2);
+
+  Register (RecordHandler, &Registered);
+  EXPECT_EQ (SmiManage (&Unregistered, NULL, NULL, NULL), EFI_NOT_FOUND);
+  EXPECT_TRUE (mCalls.empty ());
+  EXPECT_EQ (SmmCoreFindSmiEntry (&Unregistered, FALSE), nullptr);
+}
+
+TEST_F (SmiDispatchTest, DispatchesHandlersOfTheType) {
+  EFI_GUID    HandlerType[TEST_HANDLER_TYPE_COUNT];
+  EFI_HANDLE  Handle[TEST_HANDLER_TYPE_COUNT];
+  UINTN       Index;
+  UINTN       Type;
+
+  //
+  // More handler types than hash buckets, so most buckets hold several entries.
+  //
+  for (Index = 0; Index < TEST_HANDLER_TYPE_COUNT; Index++) {
+    HandlerType[Index] = MakeHandlerType ((UINT32)(Index * 0x9E3779B1));
+    Handle[Index]      = Register (RecordHandler, &HandlerType[Index]);
+  }
+
+  for (Index = 0; Index < 3 * TEST_HANDLER_TYPE_COUNT; Index++) {
+    //
+    // Alternate between handler types, with runs of the same type for the last
+    // hit cache.
+    //
+    Type = ((Index / 3) * 37) % TEST_HANDLER_TYPE_COUNT;
+    mCalls.clear ();
+    EXPECT_EQ (SmiManage (&HandlerType[Type], NULL, NULL, NULL), EFI_SUCCESS);
+    ASSERT_EQ (mCalls.size (), 1U);
+    EXPECT_EQ (mCalls[0], Handle[Type]);
+    ASSERT_NE (mSmiEntryLastHit, nullptr);
+    EXPECT_TRUE (CompareGuid (&mSmiEntryLastHit->HandlerType, &HandlerType[Type]));
+  }
+}
+
+TEST_F (SmiDispatchTest, CollidingTypesMoveToFront) {
+  EFI_GUID    HandlerType[TEST_COLLIDING_COUNT];
+  EFI_HANDLE  Handle[TEST_COLLIDING_COUNT];
+  LIST_ENTRY  *Bucket;
+  SMI_ENTRY   *Front;
+  UINTN       Index;
+  UINTN       Order[] = { 0, 3, 1, 3, 2, 0 };
+
+  GetCollidingHandlerTypes (HandlerType, TEST_COLLIDING_COUNT);
+  for (Index = 0; Index < TEST_COLLIDING_COUNT; Index++) {
+    Handle[Index] = Register (RecordHandler, &HandlerType[Index]);
+  }
+
+  Bucket = SmiEntryHashBucket (&HandlerType[0]);
+  for (UINTN Type : Order) {
+    mCalls.clear ();
+    EXPECT_EQ (SmiManage (&HandlerType[Type], NULL, NULL, NULL), EFI_SUCCESS);
+    ASSERT_EQ (mCalls.size (), 1U);
+    EXPECT_EQ (mCalls[0], Handle[Type]);
+
+    Front = CR (Bucket->ForwardLink, SMI_ENTRY, HashLink, SMI_ENTRY_SIGNATURE);
+    EXPECT_TRUE (CompareGuid (&Front->HandlerType, &HandlerType[Type]));
+  }
+}
+
+TEST_F (SmiDispatchTest, UnregisterForgetsLastHit) {
+  EFI_GUID    HandlerType[2];
+  EFI_HANDLE  First;
+  EFI_HANDLE  Second;
+  EFI_HANDLE  Other;
+
+  GetCollidingHandlerTypes (HandlerType, 2);
+  First = Register (RecordHandler, &HandlerType[0]);
+  Other = Register (RecordHandler, &HandlerType[1]);
+  EXPECT_EQ (SmiManage (&HandlerType[0], NULL, NULL, NULL), EFI_SUCCESS);
+  ASSERT_NE (mSmiEntryLastHit, nullptr);
+
+  //
+  // The SMI entry of the last hit is freed with its last handler.
+  //
+  UnRegister (First);
+  EXPECT_EQ (mSmiEntryLastHit, nullptr);
+  EXPECT_EQ (SmiManage (&HandlerType[0], NULL, NULL, NULL), EFI_NOT_FOUND);
+
+  Second = Register (RecordHandler, &HandlerType[0]);
+  mCalls.clear ();
+  EXPECT_EQ (SmiManage (&HandlerType[0], NULL, NULL, NULL), EFI_SUCCESS);
+  EXPECT_EQ (SmiManage (&HandlerType[1], NULL, NULL, NULL), EFI_SUCCESS);
+  ASSERT_EQ (mCalls.size (), 2U);
+  EXPECT_EQ (mCalls[0], Second);
+  EXPECT_EQ (mCalls[1], Other);
+}
+
+TEST_F (SmiDispatchTest, GuidHandlerStatusStopsDispatch) {
+  EFI_GUID    HandlerType = MakeHandlerType (7);
+  EFI_HANDLE  Handle[3];
+  UINTN       Index;
+
+  for (Index = 0; Index < 3; Index++) {
+    Handle[Index] = Register (RecordHandler, &HandlerType);
+  }
+
+  //
+  // All the handlers report a pending source.
+  //
+  mHandlerStatus[Handle[0]] = EFI_WARN_INTERRUPT_SOURCE_PENDING;
+  mHandlerStatus[Handle[1]] = EFI_WARN_INTERRUPT_SOURCE_PENDING;
+  mHandlerStatus[Handle[2]] = EFI_WARN_INTERRUPT_SOURCE_PENDING;
+  EXPECT_EQ (SmiManage (&HandlerType, NULL, NULL, NULL), EFI_WARN_INTERRUPT_SOURCE_PENDING);
+  EXPECT_EQ (mCalls.size (), 3U);
+
+  //
+  // EFI_SUCCESS stops the dispatch.
+  //
+  mCalls.clear ();
+  mHandlerStatus[Handle[1]] = EFI_SUCCESS;
+  EXPECT_EQ (SmiManage (&HandlerType, NULL, NULL, NULL), EFI_SUCCESS);
+  ASSERT_EQ (mCalls.size (), 2U);
+  EXPECT_EQ (mCalls[1], Handle[1]);
+
+  //
+  // EFI_INTERRUPT_PENDING stops the dispatch.
+  //
+  mCalls.clear ();
+  mHandlerStatus[Handle[0]] = EFI_INTERRUPT_PENDING;
+  EXPECT_EQ (SmiManage (&HandlerType, NULL, NULL, NULL), EFI_INTERRUPT_PENDING);
+  ASSERT_EQ (mCalls.size (), 1U);
+  EXPECT_EQ (mCalls[0], Handle[0]);
+
+  //
+  // A quiesced source does not stop the dispatch, but is reported as handled.
+  //
+  mCalls.clear ();
+  mHandlerStatus[Handle[0]] = EFI_WARN_INTERRUPT_SOURCE_QUIESCED;
+  mHandlerStatus[Handle[1]] = EFI_WARN_INTERRUPT_SOURCE_PENDING;
+  EXPECT_EQ (SmiManage (&HandlerType, NULL, NULL, NULL), EFI_SUCCESS);
+  EXPECT_EQ (mCalls.size (), 3U);
+}
+
+TEST_F (SmiDispatchTest, RootHandlersAllRun) {
+  EFI_HANDLE  Handle[3];
+  UINTN       Index;
+
+  for (Index = 0; Index < 3; Index++) {
+    Handle[Index] = Register (RecordHandler, NULL);
+  }
+
+  mHandlerStatus[Handle[0]] = EFI_INTERRUPT_PENDING;
+  mHandlerStatus[Handle[1]] = EFI_WARN_INTERRUPT_SOURCE_PENDING;
+  mHandlerStatus[Handle[2]] = EFI_INTERRUPT_PENDING;
+  EXPECT_EQ (SmiManage (NULL, NULL, NULL, NULL), EFI_INTERRUPT_PENDING);
+  EXPECT_EQ (mCalls.size (), 3U);
+
+  mCalls.clear ();
+  mHandlerStatus[Handle[1]] = EFI_SUCCESS;
+  EXPECT_EQ (SmiManage (NULL, NULL, NULL, NULL), EFI_SUCCESS);
+  ASSERT_EQ (mCalls.size (), 3U);
+  for (Index = 0; Index < 3; Index++) {
+    EXPECT_EQ (mCalls[Index], Handle[Index]);
+  }
+
+  //
+  // The root handlers do not change the last hit of the GUID handlers.
+  //
+  EXPECT_EQ (mSmiEntryLastHit, nullptr);
+}
+
+TEST_F (SmiDispatchTest, UnregisterInHandlerIsDeferred) {
+  EFI_GUID    HandlerType = MakeHandlerType (9);
+  EFI_HANDLE  First;
+  EFI_HANDLE  Second;
+  EFI_HANDLE  Last;
+
+  First = Register (UnRegisterSelfHandler, &HandlerType);
+  Last  = Register (RecordHandler, &HandlerType);
+  Handles.erase (Handles.begin ());
+  mHandlerStatus[Last] = EFI_WARN_INTERRUPT_SOURCE_PENDING;
+
+  //
+  // The handler unregistering itself is removed after the dispatch, and the next
+  // handler still runs.
+  //
+  EXPECT_EQ (SmiManage (&HandlerType, NULL, NULL, NULL), EFI_WARN_INTERRUPT_SOURCE_PENDING);
+  ASSERT_EQ (mCalls.size (), 2U);
+  EXPECT_EQ (mCalls[0], First);
+  EXPECT_EQ (mCalls[1], Last);
+
+  mCalls.clear ();
+  EXPECT_EQ (SmiManage (&HandlerType, NULL, NULL, NULL), EFI_WARN_INTERRUPT_SOURCE_PENDING);
+  ASSERT_EQ (mCalls.size (), 1U);
+  EXPECT_EQ (mCalls[0], Last);
+
+  //
+  // When the last handler of the type unregisters itself, the SMI entry goes
+  // away, including from the last hit cache.
+  //
+  UnRegister (Last);
+  Second = Register (UnRegisterSelfHandler, &HandlerType);
+  Handles.pop_back ();
+  EXPECT_EQ (SmiManage (&HandlerType, NULL, NULL, NULL), EFI_WARN_INTERRUPT_SOURCE_PENDING);
+  EXPECT_EQ (mCalls.back (), Second);
+  EXPECT_EQ (mSmiEntryLastHit, nullptr);
+  EXPECT_EQ (SmiManage (&HandlerType, NULL, NULL, NULL), EFI_NOT_FOUND);
+}
+
+TEST_F (SmiDispatchTest, LatencyCounters) {
+  EFI_GUID     HandlerType = MakeHandlerType (11);
+  EFI_HANDLE   Handle[2];
+  SMI_HANDLER  *SmiHandler[2];
+  EFI_HANDLE   Root;
+  UINT64       Ticks[]     = { 40, 10, 25 };
+  UINTN        Index;
+
+  Handle[0] = Register (RecordHandler, &HandlerType);
+  Handle[1] = Register (RecordHandler, &HandlerType);
+  Root      = Register (RecordHandler, NULL);
+  mHandlerStatus[Handle[0]] = EFI_WARN_INTERRUPT_SOURCE_PENDING;
+  SmiHandler[0]             = (SMI_HANDLER *)Handle[0];
+  SmiHandler[1]             = (SMI_HANDLER *)Handle[1];
+
+  //
+  // Nothing is counted until the SMI handler profile enables the counters.
+  //
+  EXPECT_EQ (SmiManage (&HandlerType, NULL, NULL, NULL), EFI_SUCCESS);
+  EXPECT_EQ (SmiHandler[0]->DispatchCount, 0U);
+
+  mSmiHandlerLatencyEnabled = TRUE;
+  for (Index = 0; Index < ARRAY_SIZE (Ticks); Index++) {
+    mHandlerTicks[Handle[0]] = Ticks[Index];
+    mHandlerTicks[Handle[1]] = 2 * Ticks[Index];
+    EXPECT_EQ (SmiManage (&HandlerType, NULL, NULL, NULL), EFI_SUCCESS);
+  }
+
+  mHandlerTicks[Root] = 5;
+  EXPECT_EQ (SmiManage (NULL, NULL, NULL, NULL), EFI_SUCCESS);
+
+  EXPECT_EQ (SmiHandler[0]->DispatchCount, 3U);
+  EXPECT_EQ (SmiHandler[0]->TotalTicks, 75U);
+  EXPECT_EQ (SmiHandler[0]->MaxTicks, 40U);
+  EXPECT_EQ (SmiHandler[1]->DispatchCount, 3U);
+  EXPECT_EQ (SmiHandler[1]->TotalTicks, 150U);
+  EXPECT_EQ (SmiHandler[1]->MaxTicks, 80U);
+  EXPECT_EQ (((SMI_HANDLER *)Root)->DispatchCount, 1U);
+  EXPECT_EQ (((SMI_HANDLER *)Root)->TotalTicks, 5U);
+}
+
+TEST_F (SmiDispatchTest, LatencyCountersCountingDown) {
+  EFI_GUID     HandlerType = MakeHandlerType (13);
+  EFI_HANDLE   Handle;
+  SMI_HANDLER  *SmiHandler;
+
+  Handle                    = Register (RecordHandler, &HandlerType);
+  SmiHandler                = (SMI_HANDLER *)Handle;
+  mPerformanceCounterDown   = TRUE;
+  mSmiHandlerLatencyEnabled = TRUE;
+
+  mHandlerTicks[Handle] = 30;
+  EXPECT_EQ (SmiManage (&HandlerType, NULL, NULL, NULL), EFI_SUCCESS);
+  mHandlerTicks[Handle] = 70;
+  EXPECT_EQ (SmiManage (&HandlerType, NULL, NULL, NULL), EFI_SUCCESS);
+
+  EXPECT_EQ (mSmiHandlerCounterDirection, -1);
+  EXPECT_EQ (SmiHandler->DispatchCount, 2U);
+  EXPECT_EQ (SmiHandler->TotalTicks, 100U);
+  EXPECT_EQ (SmiHandler->MaxTicks, 70U);
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  testing::InitGoogleTest (&argc, argv);
+  return RUN_ALL_TESTS ();
+}
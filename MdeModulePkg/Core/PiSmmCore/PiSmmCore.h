@@ -55,6 +55,7 @@
 #include <Library/HobLib.h>
 #include <Library/SmmMemLib.h>
 #include <Library/SafeIntLib.h>
+#include <Library/TimerLib.h>
 
 #include "PiSmmCorePrivateData.h"
 #include "HeapGuard.h"
@@ -81,8 +82,15 @@ typedef struct {
 
   EFI_GUID      HandlerType; // Type of interrupt
   LIST_ENTRY    SmiHandlers; // All handlers
+
+  LIST_ENTRY    HashLink; // Link on the hash bucket of HandlerType
 } SMI_ENTRY;
 
+//
+// Number of buckets of the SMI entry hash table, must be a power of 2.
+//
+#define SMI_ENTRY_HASH_BUCKETS  64
+
 #define SMI_HANDLER_SIGNATURE  SIGNATURE_32('s','m','i','h')
 
 typedef struct {
@@ -91,9 +99,13 @@ typedef struct {
   EFI_SMM_HANDLER_ENTRY_POINT2    Handler;    // The smm handler's entry point
   UINTN                           CallerAddr; // The address of caller who register the SMI handler.
   SMI_ENTRY                       *SmiEntry;
-  VOID                            *Context;    // for profile
-  UINTN                           ContextSize; // for profile
-  BOOLEAN                         ToRemove;    // To remove this SMI_HANDLER later
+  VOID                            *Context;      // for profile
+  UINTN                           ContextSize;   // for profile
+  BOOLEAN                         ToRemove;      // To remove this SMI_HANDLER later
+  UINT64                          DispatchCount; // for profile, number of calls of Handler
+  UINT64                          TotalTicks;    // for profile, performance counter ticks spent in Handler
+  UINT64                          MaxTicks;      // for profile, longest call of Handler in ticks
+  VOID                            *ProfileData;  // for profile, SMM_CORE_SMI_HANDLER_STRUCTURE of the handler
 } SMI_HANDLER;
 
 //
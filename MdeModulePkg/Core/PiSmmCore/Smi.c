@@ -15,13 +15,103 @@ UINTN  mSmiManageCallingDepth = 0;
 
 LIST_ENTRY  mSmiEntryList = INITIALIZE_LIST_HEAD_VARIABLE (mSmiEntryList);
 
+//
+// mSmiEntryHash holds the non-root SMI entries hashed by handler type, so the SMI
+// entry of a handler type is found without walking mSmiEntryList.
+//
+LIST_ENTRY  mSmiEntryHash[SMI_ENTRY_HASH_BUCKETS];
+BOOLEAN     mSmiEntryHashInitialized = FALSE;
+
+//
+// mSmiEntryLastHit caches the last SMI entry found, as successive SMIs are often of
+// the same handler type.
+//
+SMI_ENTRY  *mSmiEntryLastHit = NULL;
+
+//
+// mSmiHandlerLatencyEnabled is set by the SMI handler profile to record the
+// number of calls and the time spent in each SMI handler.
+//
+BOOLEAN  mSmiHandlerLatencyEnabled = FALSE;
+
+//
+// mSmiHandlerCounterDirection is 1 when the performance counter counts up, -1 when it
+// counts down and 0 until it is known.
+//
+INTN  mSmiHandlerCounterDirection = 0;
+
 SMI_ENTRY  mRootSmiEntry = {
   SMI_ENTRY_SIGNATURE,
   INITIALIZE_LIST_HEAD_VARIABLE (mRootSmiEntry.AllEntries),
   { 0 },
   INITIALIZE_LIST_HEAD_VARIABLE (mRootSmiEntry.SmiHandlers),
+  { NULL, NULL },
 };
 
+/**
+  Returns the hash bucket of a handler type.
+
+  @param  HandlerType            The type of the interrupt
+
+  @return The hash bucket of HandlerType.
+
+**/
+LIST_ENTRY *
+SmiEntryHashBucket (
+  IN EFI_GUID  *HandlerType
+  )
+{
+  UINT32  Hash;
+  UINTN   Index;
+
+  if (!mSmiEntryHashInitialized) {
+    for (Index = 0; Index < SMI_ENTRY_HASH_BUCKETS; Index++) {
+      InitializeListHead (&mSmiEntryHash[Index]);
+    }
+
+    mSmiEntryHashInitialized = TRUE;
+  }
+
+  Hash  = ReadUnaligned32 ((UINT32 *)HandlerType);
+  Hash ^= ReadUnaligned32 ((UINT32 *)HandlerType + 1);
+  Hash ^= ReadUnaligned32 ((UINT32 *)HandlerType + 2);
+  Hash ^= ReadUnaligned32 ((UINT32 *)HandlerType + 3);
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+
+  return &mSmiEntryHash[Hash & (SMI_ENTRY_HASH_BUCKETS - 1)];
+}
+
+/**
+  Returns the performance counter ticks elapsed between two counter values.
+
+  @param  StartTicks             The counter value before the SMI handler is called.
+  @param  EndTicks               The counter value after the SMI handler returned.
+
+  @return The elapsed ticks.
+
+**/
+UINT64
+SmiHandlerElapsedTicks (
+  IN UINT64  StartTicks,
+  IN UINT64  EndTicks
+  )
+{
+  UINT64  StartValue;
+  UINT64  EndValue;
+
+  if (mSmiHandlerCounterDirection == 0) {
+    GetPerformanceCounterProperties (&StartValue, &EndValue);
+    mSmiHandlerCounterDirection = (EndValue >= StartValue) ? 1 : -1;
+  }
+
+  if (mSmiHandlerCounterDirection > 0) {
+    return (EndTicks >= StartTicks) ? EndTicks - StartTicks : 0;
+  }
+
+  return (StartTicks >= EndTicks) ? StartTicks - EndTicks : 0;
+}
+
 /**
   Finds the SMI entry for the requested handler type.
 
@@ -38,24 +128,37 @@ SmmCoreFindSmiEntry (
   IN BOOLEAN   Create
   )
 {
+  LIST_ENTRY  *Bucket;
   LIST_ENTRY  *Link;
   SMI_ENTRY   *Item;
   SMI_ENTRY   *SmiEntry;
 
+  if ((mSmiEntryLastHit != NULL) && CompareGuid (&mSmiEntryLastHit->HandlerType, HandlerType)) {
+    return mSmiEntryLastHit;
+  }
+
   //
-  // Search the SMI entry list for the matching GUID
+  // Search the hash bucket for the matching GUID
   //
   SmiEntry = NULL;
-  for (Link = mSmiEntryList.ForwardLink;
-       Link != &mSmiEntryList;
+  Bucket   = SmiEntryHashBucket (HandlerType);
+  for (Link = Bucket->ForwardLink;
+       Link != Bucket;
        Link = Link->ForwardLink)
   {
-    Item = CR (Link, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+    Item = CR (Link, SMI_ENTRY, HashLink, SMI_ENTRY_SIGNATURE);
     if (CompareGuid (&Item->HandlerType, HandlerType)) {
       //
-      // This is the SMI entry
+      // This is the SMI entry, move it to the front of the bucket so the
+      // frequent handler types are found first.
       //
       SmiEntry = Item;
+      if (Link != Bucket->ForwardLink) {
+        RemoveEntryList (Link);
+        InsertHeadList (Bucket, Link);
+      }
+
+      mSmiEntryLastHit = SmiEntry;
       break;
     }
   }
@@ -75,9 +178,10 @@ SmmCoreFindSmiEntry (
       InitializeListHead (&SmiEntry->SmiHandlers);
 
       //
-      // Add it to SMI entry list
+      // Add it to SMI entry list and hash table
       //
       InsertTailList (&mSmiEntryList, &SmiEntry->AllEntries);
+      InsertHeadList (Bucket, &SmiEntry->HashLink);
     }
   }
 
@@ -109,7 +213,12 @@ RemoveSmiHandler (
   //
   if (SmiEntry != NULL) {
     if (IsListEmpty (&SmiEntry->SmiHandlers)) {
+      if (mSmiEntryLastHit == SmiEntry) {
+        mSmiEntryLastHit = NULL;
+      }
+
       RemoveEntryList (&SmiEntry->AllEntries);
+      RemoveEntryList (&SmiEntry->HashLink);
       FreePool (SmiEntry);
       return TRUE;
     }
@@ -149,6 +258,8 @@ SmiManage (
   EFI_STATUS   ReturnStatus;
   BOOLEAN      WillReturn;
   EFI_STATUS   Status;
+  UINT64       StartTicks;
+  UINT64       Ticks;
 
   PERF_FUNCTION_BEGIN ();
   mSmiManageCallingDepth++;
@@ -169,6 +280,7 @@ SmiManage (
       //
       // There is no handler registered for this interrupt source
       //
+      mSmiManageCallingDepth--;
       PERF_FUNCTION_END ();
       return Status;
     }
@@ -179,6 +291,11 @@ SmiManage (
   for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
     SmiHandler = CR (Link, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
 
+    StartTicks = 0;
+    if (mSmiHandlerLatencyEnabled) {
+      StartTicks = GetPerformanceCounter ();
+    }
+
     Status = SmiHandler->Handler (
                            (EFI_HANDLE)SmiHandler,
                            Context,
@@ -186,6 +303,15 @@ SmiManage (
                            CommBufferSize
                            );
 
+    if (mSmiHandlerLatencyEnabled) {
+      Ticks = SmiHandlerElapsedTicks (StartTicks, GetPerformanceCounter ());
+      SmiHandler->DispatchCount++;
+      SmiHandler->TotalTicks += Ticks;
+      if (Ticks > SmiHandler->MaxTicks) {
+        SmiHandler->MaxTicks = Ticks;
+      }
+    }
+
     switch (Status) {
       case EFI_INTERRUPT_PENDING:
         //
@@ -82,6 +82,7 @@ InternalPeCoffGetEntryPoint (
 extern LIST_ENTRY  mSmiEntryList;
 extern LIST_ENTRY  mHardwareSmiEntryList;
 extern SMI_ENTRY   mRootSmiEntry;
+extern BOOLEAN     mSmiHandlerLatencyEnabled;
 
 extern SMI_HANDLER_PROFILE_PROTOCOL  mSmiHandlerProfile;
 
@@ -743,11 +744,15 @@ GetSmmSmiHandlerDataOnSmiEntry (
       return 0;
     }
 
-    SmiHandlerStruct->Length            = (UINT32)(sizeof (SMM_CORE_SMI_HANDLER_STRUCTURE) + GET_OCCUPIED_SIZE (SmiHandler->ContextSize, sizeof (UINT64)));
-    SmiHandlerStruct->CallerAddr        = (UINTN)SmiHandler->CallerAddr;
-    SmiHandlerStruct->Handler           = (UINTN)SmiHandler->Handler;
-    SmiHandlerStruct->ImageRef          = AddressToImageRef ((UINTN)SmiHandler->Handler);
-    SmiHandlerStruct->ContextBufferSize = (UINT32)SmiHandler->ContextSize;
+    SmiHandlerStruct->Length                 = (UINT32)(sizeof (SMM_CORE_SMI_HANDLER_STRUCTURE) + GET_OCCUPIED_SIZE (SmiHandler->ContextSize, sizeof (UINT64)));
+    SmiHandlerStruct->CallerAddr             = (UINTN)SmiHandler->CallerAddr;
+    SmiHandlerStruct->Handler                = (UINTN)SmiHandler->Handler;
+    SmiHandlerStruct->ImageRef               = AddressToImageRef ((UINTN)SmiHandler->Handler);
+    SmiHandlerStruct->ContextBufferSize      = (UINT32)SmiHandler->ContextSize;
+    SmiHandlerStruct->DispatchCount          = 0;
+    SmiHandlerStruct->TotalTimeInNanoSeconds = 0;
+    SmiHandlerStruct->MaxTimeInNanoSeconds   = 0;
+    SmiHandler->ProfileData                  = SmiHandlerStruct;
     if (SmiHandler->ContextSize != 0) {
       SmiHandlerStruct->ContextBufferOffset = sizeof (SMM_CORE_SMI_HANDLER_STRUCTURE);
       CopyMem ((UINT8 *)SmiHandlerStruct + SmiHandlerStruct->ContextBufferOffset, SmiHandler->Context, SmiHandler->ContextSize);
@@ -893,6 +898,48 @@ BuildSmiHandlerProfileDatabase (
   }
 }
 
+/**
+  Update the dispatch count and time of the SMI handlers of a SMI entry list in the
+  SMI handler profile database.
+
+  @param SmiEntryList     a list of SMI entry.
+**/
+VOID
+UpdateSmiHandlerLatencyOnSmiEntryList (
+  IN LIST_ENTRY  *SmiEntryList
+  )
+{
+  SMM_CORE_SMI_HANDLER_STRUCTURE  *SmiHandlerStruct;
+  LIST_ENTRY                      *ListEntry;
+  LIST_ENTRY                      *HandlerEntry;
+  SMI_ENTRY                       *SmiEntry;
+  SMI_HANDLER                     *SmiHandler;
+
+  for (ListEntry = SmiEntryList->ForwardLink;
+       ListEntry != SmiEntryList;
+       ListEntry = ListEntry->ForwardLink)
+  {
+    SmiEntry = CR (ListEntry, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+    for (HandlerEntry = SmiEntry->SmiHandlers.ForwardLink;
+         HandlerEntry != &SmiEntry->SmiHandlers;
+         HandlerEntry = HandlerEntry->ForwardLink)
+    {
+      SmiHandler = CR (HandlerEntry, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
+      if (SmiHandler->ProfileData == NULL) {
+        //
+        // The handler is registered after the database is built.
+        //
+        continue;
+      }
+
+      SmiHandlerStruct                         = SmiHandler->ProfileData;
+      SmiHandlerStruct->DispatchCount          = SmiHandler->DispatchCount;
+      SmiHandlerStruct->TotalTimeInNanoSeconds = GetTimeInNanoSecond (SmiHandler->TotalTicks);
+      SmiHandlerStruct->MaxTimeInNanoSeconds   = GetTimeInNanoSecond (SmiHandler->MaxTicks);
+    }
+  }
+}
+
 /**
   Copy SMI handler profile data.
 
@@ -943,6 +990,13 @@ SmiHandlerProfileHandlerGetInfo (
   SmiHandlerProfileRecordingStatus  = mSmiHandlerProfileRecordingStatus;
   mSmiHandlerProfileRecordingStatus = FALSE;
 
+  //
+  // Refresh the SMI handler latency, the following GET_DATA_BY_OFFSET commands
+  // return a consistent snapshot.
+  //
+  UpdateSmiHandlerLatencyOnSmiEntryList (mSmmCoreRootSmiEntryList);
+  UpdateSmiHandlerLatencyOnSmiEntryList (mSmmCoreSmiEntryList);
+
   SmiHandlerProfileParameterGetInfo->DataSize            = mSmiHandlerProfileDatabaseSize;
   SmiHandlerProfileParameterGetInfo->Header.ReturnStatus = 0;
 
@@ -1409,6 +1463,11 @@ SmmCoreInitializeSmiHandlerProfile (
   if ((PcdGet8 (PcdSmiHandlerProfilePropertyMask) & 0x1) != 0) {
     InsertTailList (&mRootSmiEntryList, &mRootSmiEntry.AllEntries);
 
+    //
+    // Record the number of calls and the time spent in each SMI handler.
+    //
+    mSmiHandlerLatencyEnabled = TRUE;
+
     Status = gSmst->SmmRegisterProtocolNotify (
                       &gEfiSmmReadyToLockProtocolGuid,
                       SmmReadyToLockInSmiHandlerProfile,
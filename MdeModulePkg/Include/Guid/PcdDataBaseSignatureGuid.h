@@ -79,9 +79,23 @@ typedef struct {
 
 typedef UINT32 TABLE_OFFSET;
 
+//
+// DynamicEx PCDs are found through a minimal perfect hash of {token space guid: token number}.
+// The key is the 16 bytes of the GUID followed by the 4 bytes of the token number, little endian,
+// hashed with FNV-1a whose offset basis is xor'ed with Seed * PCD_EX_MAP_HASH_SEED_MULTIPLIER,
+// then mixed by the 32 bit finalizer of MurmurHash3.
+// The bucket of a key is its hash with Seed 0 modulo ExMapHashBucketCount. The slot of a key is
+// its hash with Seed ExMapHashDisplacement[Bucket] + 1 modulo ExTokenCount, and ExMapHashSlot[Slot]
+// is the index of the key in ExMapTable. A key that is not in ExMapTable also lands in a slot,
+// so the entry found must be compared with the key.
+//
+#define PCD_EX_MAP_HASH_OFFSET_BASIS     0x811C9DC5U
+#define PCD_EX_MAP_HASH_PRIME            0x01000193U
+#define PCD_EX_MAP_HASH_SEED_MULTIPLIER  0x9E3779B9U
+
 typedef struct {
   GUID            Signature;                    // PcdDataBaseGuid.
-  UINT32          BuildVersion;
+  UINT32          BuildVersion;                 // PCD_SERVICE_DXE_VERSION, version 8 adds the ExMap hash table.
   UINT32          Length;                       // Length of DEFAULT SKU PCD DB
   SKU_ID          SystemSkuId;                  // Current SkuId value.
   UINT32          LengthForAllSkus;             // Length of all SKU PCD DB
@@ -96,7 +110,8 @@ typedef struct {
   UINT16          LocalTokenCount;              // LOCAL_TOKEN_NUMBER for all.
   UINT16          ExTokenCount;                 // EX_TOKEN_NUMBER for DynamicEx.
   UINT16          GuidTableCount;               // The Number of Guid in GuidTable.
-  UINT8           Pad[6];                       // Pad bytes to satisfy the alignment.
+  UINT16          ExMapHashBucketCount;         // 0 if ExMapTable has no perfect hash.
+  TABLE_OFFSET    ExMapHashTableOffset;
 
   //
   // Default initialized external PCD database binary structure
@@ -115,9 +130,17 @@ typedef struct {
   // VARIABLE_HEAD                  VariableHead[];          // HII PCD
   // UINT8                          StringTable[];           // String for String PCD value and HII PCD Variable Name. It can be accessed by StringTableOffset.
   // SIZE_INFO                      SizeTable[];             // MaxSize and CurSize for String PCD. It can be accessed by SizeTableOffset.
+  // UINT16                         ExMapHashDisplacement[]; // ExMapHashBucketCount entries. It can be accessed by ExMapHashTableOffset.
+  // UINT16                         ExMapHashSlot[];         // ExTokenCount entries, right after ExMapHashDisplacement.
   // UINT16                         ValueUint16[];
   // UINT8                          ValueUint8[];
   // BOOLEAN                        ValueBoolean[];
+  //
+  // The binary ends at Length. The PCD drivers allocate Length + UninitDataBaseSize bytes and
+  // zero the PCDs whose default value is 0 after Length.
+  // The PCD_DATABASE_SKU_DELTA of the other SKUs follow, from the 8 byte boundary after Length
+  // up to LengthForAllSkus.
+  //
 } PCD_DATABASE_INIT;
 
 //
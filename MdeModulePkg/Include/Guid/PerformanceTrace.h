@@ -0,0 +1,103 @@
+/** @file
+  This file defines the performance trace table published by DxeCorePerformanceLib
+  when the binary trace mode is enabled by PcdEdkiiPerformanceTraceRecordCount.
+
+  Every processor appends compact records to its own ring buffer, so records can be
+  created from MP procedures without a lock. Caller strings and GUIDs are interned
+  once into shared tables and records only carry their index.
+
+  The table is installed as an EFI configuration table with gEdkiiPerformanceTraceGuid.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __PERFORMANCE_TRACE_H__
+#define __PERFORMANCE_TRACE_H__
+
+#include <Guid/ExtendedFirmwarePerformance.h>
+
+#define EDKII_PERFORMANCE_TRACE_GUID \
+  { 0x1d9ff1c1, 0x93e8, 0x4de8, { 0xbf, 0x7c, 0xdb, 0x40, 0x0e, 0xd3, 0x8e, 0x3d } }
+
+#define PERFORMANCE_TRACE_TABLE_SIGNATURE  SIGNATURE_32 ('P', 'T', 'R', 'C')
+#define PERFORMANCE_TRACE_TABLE_REVISION   1
+
+///
+/// Index used in a record when no string or GUID is associated with it.
+///
+#define PERFORMANCE_TRACE_INVALID_INDEX  MAX_UINT16
+
+///
+/// Set in PERFORMANCE_TRACE_RECORD.Flags when Caller holds a GUID index instead of
+/// the CallerIdentifier pointer.
+///
+#define PERFORMANCE_TRACE_CALLER_IS_GUID_INDEX  BIT0
+
+typedef struct {
+  ///
+  /// Raw performance counter value, or the TimeStamp passed by the caller.
+  ///
+  UINT64    TimeStamp;
+  UINT64    Address;
+  ///
+  /// Image or controller handle, or an index in the GUID table.
+  ///
+  UINT64    Caller;
+  UINT16    Identifier;
+  UINT8     Attribute;
+  UINT8     Flags;
+  UINT16    StringIndex;
+  UINT16    GuidIndex;
+} PERFORMANCE_TRACE_RECORD;
+
+typedef struct {
+  ///
+  /// Number of records ever reserved by the processor owning the ring, modulo 2^32.
+  /// The latest record is at Record[(Head - 1) % RecordCount].
+  ///
+  UINT32    Head;
+  UINT32    Reserved[15];
+  // PERFORMANCE_TRACE_RECORD    Record[RecordCount];
+} PERFORMANCE_TRACE_RING;
+
+typedef struct {
+  ///
+  /// FNV-1a hash of the string, zero when the entry is free.
+  ///
+  UINT64    Hash;
+  CHAR8     String[FPDT_STRING_EVENT_RECORD_NAME_LENGTH];
+} PERFORMANCE_TRACE_STRING;
+
+typedef struct {
+  ///
+  /// FNV-1a hash of the GUID, zero when the entry is free.
+  ///
+  UINT64      Hash;
+  EFI_GUID    Guid;
+} PERFORMANCE_TRACE_GUID;
+
+typedef struct {
+  UINT32                      Signature;
+  UINT32                      Revision;
+  UINT64                      Frequency;
+  UINT64                      TimerStartValue;
+  UINT64                      TimerEndValue;
+  ///
+  /// Number of records in each ring.
+  ///
+  UINT32                      RecordCount;
+  UINT32                      CpuCount;
+  UINT32                      StringCount;
+  UINT32                      GuidCount;
+  ///
+  /// Ring[CpuCount], indexed by the processor number of EFI_MP_SERVICES_PROTOCOL.
+  ///
+  PERFORMANCE_TRACE_RING      **Ring;
+  PERFORMANCE_TRACE_STRING    *String;
+  PERFORMANCE_TRACE_GUID      *Guid;
+} PERFORMANCE_TRACE_TABLE;
+
+extern EFI_GUID  gEdkiiPerformanceTraceGuid;
+
+#endif
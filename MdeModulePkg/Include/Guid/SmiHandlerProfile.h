@@ -42,7 +42,14 @@ typedef struct {
 } SMM_CORE_IMAGE_DATABASE_STRUCTURE;
 
 #define SMM_CORE_SMI_DATABASE_SIGNATURE  SIGNATURE_32 ('S','C','S','D')
-#define SMM_CORE_SMI_DATABASE_REVISION   0x0001
+
+//
+// Revision 0x0002 appends DispatchCount, TotalTimeInNanoSeconds and MaxTimeInNanoSeconds
+// to SMM_CORE_SMI_HANDLER_STRUCTURE. Revision 0x0001 structures end at ContextBufferSize.
+//
+#define SMM_CORE_SMI_DATABASE_REVISION_1  0x0001
+#define SMM_CORE_SMI_DATABASE_REVISION_2  0x0002
+#define SMM_CORE_SMI_DATABASE_REVISION    SMM_CORE_SMI_DATABASE_REVISION_2
 
 typedef enum {
   SmmCoreSmiHandlerCategoryRootHandler,
@@ -85,6 +92,14 @@ typedef struct {
   UINT16              ContextBufferOffset;
   UINT8               Reserved[2];
   UINT32              ContextBufferSize;
+  //
+  // Fields below are added in SMM_CORE_SMI_DATABASE_REVISION_2.
+  // They are only recorded for root and GUID SMI handlers dispatched by the SMM core,
+  // and are updated each time SMI_HANDLER_PROFILE_COMMAND_GET_INFO is received.
+  //
+  UINT64              DispatchCount;
+  UINT64              TotalTimeInNanoSeconds;
+  UINT64              MaxTimeInNanoSeconds;
   // UINT8                 ContextBuffer[];
 } SMM_CORE_SMI_HANDLER_STRUCTURE;
 
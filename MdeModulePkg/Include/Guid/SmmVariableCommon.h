@@ -11,6 +11,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include <Guid/VariableFormat.h>
 #include <Protocol/VarCheck.h>
+#include <Protocol/VariableBatch.h>
 
 #define EFI_SMM_VARIABLE_WRITE_GUID \
   { 0x93ba1826, 0xdffb, 0x45dd, { 0x82, 0xa7, 0xe7, 0xdc, 0xaa, 0x3b, 0xbd, 0xf3 } }
@@ -77,6 +78,14 @@ typedef struct {
 // The payload for this function is SMM_VARIABLE_COMMUNICATE_GET_RUNTIME_CACHE_INFO
 //
 #define SMM_VARIABLE_FUNCTION_GET_RUNTIME_CACHE_INFO  14
+//
+// The payload for this function is SMM_VARIABLE_COMMUNICATE_BATCH.
+//
+#define SMM_VARIABLE_FUNCTION_BATCH  15
+//
+// The payload for this function is SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES.
+//
+#define SMM_VARIABLE_FUNCTION_GET_NEXT_VARIABLE_NAMES  16
 
 ///
 /// Size of SMM communicate header, without including the payload.
@@ -147,4 +156,46 @@ typedef struct {
   BOOLEAN    AuthenticatedVariableUsage;
 } SMM_VARIABLE_COMMUNICATE_GET_RUNTIME_CACHE_INFO;
 
+///
+/// An operation of SMM_VARIABLE_FUNCTION_BATCH. Function is SMM_VARIABLE_FUNCTION_GET_VARIABLE
+/// or SMM_VARIABLE_FUNCTION_SET_VARIABLE. Size is the size of the operation, including
+/// the name and the data buffer, rounded up to SMM_VARIABLE_BATCH_ALIGNMENT.
+///
+typedef struct {
+  UINTN                                       Function;
+  EFI_STATUS                                  ReturnStatus;
+  UINTN                                       Size;
+  SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE    Access;
+} SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION;
+
+#define SMM_VARIABLE_BATCH_ALIGNMENT  sizeof (UINT64)
+
+///
+/// Size of a batch operation of a variable name of NameSize bytes and a data buffer
+/// of DataSize bytes.
+///
+#define SMM_VARIABLE_BATCH_OPERATION_SIZE(NameSize, DataSize) \
+  ALIGN_VALUE (OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION, Access.Name) + (NameSize) + (DataSize), SMM_VARIABLE_BATCH_ALIGNMENT)
+
+///
+/// This structure is used to communicate with SMI handler by a batch of GetVariable and
+/// SetVariable. OperationCount operations follow the header.
+///
+typedef struct {
+  UINTN    OperationCount;
+  UINTN    Reserved;
+} SMM_VARIABLE_COMMUNICATE_BATCH;
+
+///
+/// This structure is used to communicate with SMI handler to get the names following
+/// Start. On input, Start is the name to start after, an empty name to start from the
+/// first variable. On output, NameCount EDKII_VARIABLE_NAME_ENTRY entries are packed from
+/// the offset of Start. ReturnStatus is EFI_SUCCESS if the last name is in the entries,
+/// EFI_BUFFER_TOO_SMALL if more names follow the last entry.
+///
+typedef struct {
+  UINTN                        NameCount;
+  EDKII_VARIABLE_NAME_ENTRY    Start;
+} SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES;
+
 #endif // _SMM_VARIABLE_COMMON_H_
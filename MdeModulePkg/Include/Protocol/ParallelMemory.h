@@ -0,0 +1,131 @@
+/** @file
+  EDKII Parallel Memory Protocol.
+
+  Clears and tests ranges of system memory on all the enabled processors. The
+  ranges are split by NUMA proximity domain so that processors work first on the
+  memory attached to their own node.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __PARALLEL_MEMORY_PROTOCOL_H__
+#define __PARALLEL_MEMORY_PROTOCOL_H__
+
+#define EDKII_PARALLEL_MEMORY_PROTOCOL_GUID \
+  { \
+    0xaa75c138, 0xcabf, 0x4a4e, { 0x98, 0x72, 0x92, 0xd9, 0x56, 0x21, 0x1f, 0x0b } \
+  }
+
+typedef struct _EDKII_PARALLEL_MEMORY_PROTOCOL EDKII_PARALLEL_MEMORY_PROTOCOL;
+
+#define EDKII_PARALLEL_MEMORY_PROTOCOL_REVISION  0x00000001
+
+///
+/// Statistics of a NUMA node, accumulated over all the operations.
+///
+typedef struct {
+  UINT32    ProximityDomain;
+  ///
+  /// Number of enabled processors of the node.
+  ///
+  UINT32    ProcessorCount;
+  ///
+  /// Number of bytes of the node cleared or tested.
+  ///
+  UINT64    Bytes;
+  ///
+  /// Time spent on the memory of the node, in nanoseconds. Bytes divided by
+  /// ElapsedNs is the bandwidth of the node.
+  ///
+  UINT64    ElapsedNs;
+} EDKII_PARALLEL_MEMORY_NODE_STATISTICS;
+
+/**
+  Clear a range of memory.
+
+  The caller must own the range, for example by allocating it, for the duration
+  of the call.
+
+  @param[in]  This     The protocol instance.
+  @param[in]  Address  Start of the range.
+  @param[in]  Length   Length of the range in bytes.
+
+  @retval EFI_SUCCESS            The range is cleared.
+  @retval EFI_INVALID_PARAMETER  The range wraps around the address space.
+  @retval EFI_UNSUPPORTED        The range is not addressable by the processor.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_PARALLEL_MEMORY_CLEAR)(
+  IN EDKII_PARALLEL_MEMORY_PROTOCOL  *This,
+  IN EFI_PHYSICAL_ADDRESS            Address,
+  IN UINT64                          Length
+  );
+
+/**
+  Test a range of memory.
+
+  Pattern is written at Address and every Span bytes after it within the range,
+  bypassing the caches, then read back and compared.
+
+  @param[in]  This          The protocol instance.
+  @param[in]  Address       Start of the range.
+  @param[in]  Length        Length of the range in bytes.
+  @param[in]  Pattern       The pattern to write.
+  @param[in]  PatternSize   Size of Pattern in bytes, not larger than Span.
+  @param[in]  Span          Distance in bytes between two copies of Pattern.
+  @param[out] ErrorAddress  Address of a copy of Pattern that did not read back
+                            correctly, when EFI_DEVICE_ERROR is returned. The test
+                            stops at the first error found by any processor.
+
+  @retval EFI_SUCCESS            All the copies of Pattern read back correctly.
+  @retval EFI_DEVICE_ERROR       A copy of Pattern did not read back correctly.
+  @retval EFI_INVALID_PARAMETER  Pattern is NULL, PatternSize is 0 or larger than
+                                 Span, or the range wraps around the address space.
+  @retval EFI_UNSUPPORTED        The range is not addressable by the processor.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_PARALLEL_MEMORY_TEST)(
+  IN  EDKII_PARALLEL_MEMORY_PROTOCOL  *This,
+  IN  EFI_PHYSICAL_ADDRESS            Address,
+  IN  UINT64                          Length,
+  IN  CONST VOID                      *Pattern,
+  IN  UINTN                           PatternSize,
+  IN  UINTN                           Span,
+  OUT EFI_PHYSICAL_ADDRESS            *ErrorAddress OPTIONAL
+  );
+
+/**
+  Get the statistics of the NUMA nodes.
+
+  @param[in]      This        The protocol instance.
+  @param[in, out] NodeCount   On input, the number of entries of Statistics. On
+                              output, the number of NUMA nodes.
+  @param[out]     Statistics  The statistics of each node.
+
+  @retval EFI_SUCCESS            The statistics are returned.
+  @retval EFI_BUFFER_TOO_SMALL   NodeCount is too small, it is updated with the
+                                 number of NUMA nodes.
+  @retval EFI_INVALID_PARAMETER  NodeCount is NULL, or Statistics is NULL and
+                                 *NodeCount is not 0.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_PARALLEL_MEMORY_GET_STATISTICS)(
+  IN     EDKII_PARALLEL_MEMORY_PROTOCOL         *This,
+  IN OUT UINTN                                  *NodeCount,
+  OUT    EDKII_PARALLEL_MEMORY_NODE_STATISTICS  *Statistics OPTIONAL
+  );
+
+struct _EDKII_PARALLEL_MEMORY_PROTOCOL {
+  UINT64                                  Revision;
+  EDKII_PARALLEL_MEMORY_CLEAR             Clear;
+  EDKII_PARALLEL_MEMORY_TEST              Test;
+  EDKII_PARALLEL_MEMORY_GET_STATISTICS    GetStatistics;
+};
+
+extern EFI_GUID  gEdkiiParallelMemoryProtocolGuid;
+
+#endif
@@ -0,0 +1,135 @@
+/** @file
+  EDKII Variable Batch Protocol.
+
+  Runs a vector of GetVariable() and SetVariable() operations, and enumerates the
+  names of all the variables, with as few transitions to the variable service as
+  possible. When the variable service runs in MM, each transition is an SMI, so a
+  batch of operations that fits in one communicate buffer costs one SMI instead of
+  one per operation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __VARIABLE_BATCH_PROTOCOL_H__
+#define __VARIABLE_BATCH_PROTOCOL_H__
+
+#define EDKII_VARIABLE_BATCH_PROTOCOL_GUID \
+  { \
+    0x55b49b3e, 0x9211, 0x45e2, { 0x90, 0xef, 0xd7, 0x4a, 0x52, 0x07, 0x75, 0x84 } \
+  }
+
+typedef struct _EDKII_VARIABLE_BATCH_PROTOCOL EDKII_VARIABLE_BATCH_PROTOCOL;
+
+#define EDKII_VARIABLE_BATCH_PROTOCOL_REVISION  0x00000001
+
+typedef enum {
+  EdkiiVariableBatchGetVariable,
+  EdkiiVariableBatchSetVariable
+} EDKII_VARIABLE_BATCH_OPERATION_TYPE;
+
+///
+/// An operation of a batch. The fields match the parameters of GetVariable() and
+/// SetVariable().
+///
+typedef struct {
+  EDKII_VARIABLE_BATCH_OPERATION_TYPE    Type;
+  CHAR16                                 *VariableName;
+  EFI_GUID                               *VendorGuid;
+  ///
+  /// Attributes to set, or attributes of the variable read.
+  ///
+  UINT32                                 Attributes;
+  ///
+  /// Size of Data. For a GetVariable() operation, the size of the buffer on input
+  /// and the size of the data, or the size needed, on output.
+  ///
+  UINTN                                  DataSize;
+  VOID                                   *Data;
+  ///
+  /// Status the operation would have returned if it had been called alone.
+  ///
+  EFI_STATUS                             Status;
+} EDKII_VARIABLE_BATCH_OPERATION;
+
+///
+/// Name of a variable returned by GetVariableNames(). Entries are packed one after
+/// the other, each starting on a UINTN boundary.
+///
+typedef struct {
+  EFI_GUID    VendorGuid;
+  ///
+  /// Size of Name in bytes, including the Null-terminator.
+  ///
+  UINTN       NameSize;
+  CHAR16      Name[1];
+} EDKII_VARIABLE_NAME_ENTRY;
+
+///
+/// Size of a name entry holding a name of NameSize bytes.
+///
+#define EDKII_VARIABLE_NAME_ENTRY_SIZE(NameSize) \
+  ALIGN_VALUE (OFFSET_OF (EDKII_VARIABLE_NAME_ENTRY, Name) + (NameSize), sizeof (UINTN))
+
+/**
+  Run a vector of variable operations.
+
+  The operations are run in order. An operation does not stop the next ones when it
+  fails, its own status is returned in its Status field. The operations are not
+  atomic: a failure, or a reset, while the batch runs may leave the operations that
+  precede it done.
+
+  @param[in]      This            The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in]      OperationCount  Number of operations.
+  @param[in, out] Operations      The operations.
+
+  @retval EFI_SUCCESS            All the operations have been run. The status of each
+                                 is in its Status field.
+  @retval EFI_INVALID_PARAMETER  Operations is NULL and OperationCount is not zero.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_VARIABLE_BATCH_EXECUTE)(
+  IN     EDKII_VARIABLE_BATCH_PROTOCOL   *This,
+  IN     UINTN                           OperationCount,
+  IN OUT EDKII_VARIABLE_BATCH_OPERATION  *Operations
+  );
+
+/**
+  Get the names and vendor GUIDs of all the variables, in the order GetNextVariableName()
+  returns them.
+
+  @param[in]      This        The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in, out] BufferSize  On input, the size of Buffer. On output, the size of the
+                              name entries, or the size needed.
+  @param[out]     Buffer      Packed EDKII_VARIABLE_NAME_ENTRY entries.
+  @param[out]     NameCount   Number of entries returned in Buffer. OPTIONAL
+
+  @retval EFI_SUCCESS            The names have been returned.
+  @retval EFI_BUFFER_TOO_SMALL   BufferSize is too small. It has been updated with the
+                                 size needed.
+  @retval EFI_INVALID_PARAMETER  BufferSize is NULL, or Buffer is NULL and *BufferSize is
+                                 not zero.
+  @retval EFI_DEVICE_ERROR       The names could not be retrieved due to a hardware error.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_VARIABLE_BATCH_GET_VARIABLE_NAMES)(
+  IN     EDKII_VARIABLE_BATCH_PROTOCOL  *This,
+  IN OUT UINTN                          *BufferSize,
+  OUT    VOID                           *Buffer,
+  OUT    UINTN                          *NameCount OPTIONAL
+  );
+
+///
+/// Batched access to the variable services.
+///
+struct _EDKII_VARIABLE_BATCH_PROTOCOL {
+  UINT32                                     Revision;
+  EDKII_VARIABLE_BATCH_EXECUTE               Execute;
+  EDKII_VARIABLE_BATCH_GET_VARIABLE_NAMES    GetVariableNames;
+};
+
+extern EFI_GUID  gEdkiiVariableBatchProtocolGuid;
+
+#endif
@@ -1418,6 +1418,13 @@ ReportFpdtRecordBuffer (
   UINT64      BPDTAddr;
 
   if (!mFpdtBufferIsReported) {
+    //
+    // Records of the trace mode have not been added to the boot records yet.
+    //
+    if (mPerfTraceTable != NULL) {
+      PerfTraceMergeIntoFpdt ();
+    }
+
     Status = AllocateBootPerformanceTable ();
     if (!EFI_ERROR (Status)) {
       BPDTAddr = (UINT64)(UINTN)mAcpiBootPerformanceTable;
@@ -1523,6 +1530,9 @@ DxeCorePerformanceLibConstructor (
   //
   InternalGetPeiPerformance (GetHobList ());
 
+  Status = PerfTraceInitialize ();
+  ASSERT_EFI_ERROR (Status);
+
   //
   // Install the protocol interfaces for DXE performance library instance.
   //
@@ -1610,9 +1620,23 @@ CreatePerformanceMeasurement (
   )
 {
   EFI_STATUS  Status;
+  UINTN       ProcessorNumber;
 
   Status = EFI_SUCCESS;
 
+  //
+  // In trace mode, records are only appended to the ring buffer of the processor
+  // until the boot records are reported, when they are merged. Later records
+  // of the BSP are also added to the boot records.
+  //
+  if (mPerfTraceTable != NULL) {
+    ProcessorNumber = PerfTraceGetProcessorNumber ();
+    Status          = PerfTraceAppendRecord (ProcessorNumber, CallerIdentifier, Guid, String, TimeStamp, Address, Identifier, Attribute);
+    if (!mFpdtBufferIsReported || !PerfTraceIsBsp (ProcessorNumber)) {
+      return Status;
+    }
+  }
+
   if (mLockInsertRecord) {
     return EFI_INVALID_PARAMETER;
   }
@@ -21,12 +21,14 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/EventGroup.h>
 #include <Guid/FirmwarePerformance.h>
 #include <Guid/PiSmmCommunicationRegionTable.h>
+#include <Guid/PerformanceTrace.h>
 
 #include <Protocol/DriverBinding.h>
 #include <Protocol/LoadedImage.h>
 #include <Protocol/ComponentName2.h>
 #include <Protocol/DevicePathToText.h>
 #include <Protocol/SmmCommunication.h>
+#include <Protocol/MpService.h>
 
 #include <Library/PerformanceLib.h>
 #include <Library/DebugLib.h>
@@ -43,6 +45,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/ReportStatusCodeLib.h>
 #include <Library/DxeServicesLib.h>
 #include <Library/PeCoffGetEntryPointLib.h>
+#include <Library/SynchronizationLib.h>
 
 /**
   Create performance record with event description and a timestamp.
@@ -74,4 +77,111 @@ CreatePerformanceMeasurement (
   IN       PERF_MEASUREMENT_ATTRIBUTE  Attribute
   );
 
+/**
+  Add performance log to FPDT boot record table.
+
+  @param CallerIdentifier  - Image handle or pointer to caller ID GUID.
+  @param Guid              - Pointer to a GUID.
+  @param String            - Pointer to a string describing the measurement.
+  @param Ticker            - 64-bit time stamp.
+  @param Address           - Pointer to a location in memory relevant to the measurement.
+  @param PerfId            - Performance identifier describing the type of measurement.
+  @param Attribute         - The attribute of the measurement.
+
+  @retval EFI_SUCCESS           - Successfully created performance record
+  @retval EFI_OUT_OF_RESOURCES  - Ran out of space to store the records
+  @retval EFI_INVALID_PARAMETER - Invalid parameter passed to function - NULL
+                                  pointer or invalid PerfId
+**/
+EFI_STATUS
+InsertFpdtRecord (
+  IN CONST VOID                        *CallerIdentifier   OPTIONAL,
+  IN CONST VOID                        *Guid     OPTIONAL,
+  IN CONST CHAR8                       *String   OPTIONAL,
+  IN       UINT64                      Ticker,
+  IN       UINT64                      Address   OPTIONAL,
+  IN       UINT16                      PerfId,
+  IN       PERF_MEASUREMENT_ATTRIBUTE  Attribute
+  );
+
+//
+// Performance trace mode, enabled by PcdEdkiiPerformanceTraceRecordCount.
+//
+extern PERFORMANCE_TRACE_TABLE  *mPerfTraceTable;
+
+/**
+  Allocate and publish the performance trace table if trace mode is enabled.
+
+  @retval EFI_SUCCESS           Trace mode is disabled or has been initialized.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources for the trace buffers.
+**/
+EFI_STATUS
+PerfTraceInitialize (
+  VOID
+  );
+
+/**
+  Get the number of the calling processor.
+
+  The BSP owns the first ring until the MP Services protocol is installed, as no
+  AP can run DXE code before.
+
+  @return The processor number of the caller.
+**/
+UINTN
+PerfTraceGetProcessorNumber (
+  VOID
+  );
+
+/**
+  Check whether the caller runs on the BSP.
+
+  @param  ProcessorNumber  The processor number of the caller.
+
+  @retval TRUE   The caller is the BSP.
+  @retval FALSE  The caller is an AP.
+**/
+BOOLEAN
+PerfTraceIsBsp (
+  IN UINTN  ProcessorNumber
+  );
+
+/**
+  Append a performance record to the ring buffer of the calling processor.
+
+  @param ProcessorNumber   The processor number of the caller.
+  @param CallerIdentifier  Image handle or pointer to caller ID GUID.
+  @param Guid              Pointer to a GUID.
+  @param String            Pointer to a string describing the measurement.
+  @param TimeStamp         64-bit time stamp, 0 to read the performance counter.
+  @param Address           Pointer to a location in memory relevant to the measurement.
+  @param Identifier        Performance identifier describing the type of measurement.
+  @param Attribute         The attribute of the measurement.
+
+  @retval EFI_SUCCESS           The record was appended.
+  @retval EFI_OUT_OF_RESOURCES  The calling processor has no ring buffer.
+**/
+EFI_STATUS
+PerfTraceAppendRecord (
+  IN       UINTN                       ProcessorNumber,
+  IN CONST VOID                        *CallerIdentifier  OPTIONAL,
+  IN CONST VOID                        *Guid      OPTIONAL,
+  IN CONST CHAR8                       *String    OPTIONAL,
+  IN       UINT64                      TimeStamp,
+  IN       UINT64                      Address    OPTIONAL,
+  IN       UINT32                      Identifier,
+  IN       PERF_MEASUREMENT_ATTRIBUTE  Attribute
+  );
+
+/**
+  Merge the records of all the ring buffers into the FPDT boot records, in the order
+  they were taken.
+
+  @return The number of records overwritten in the ring buffers before the merge.
+**/
+UINT64
+PerfTraceMergeIntoFpdt (
+  VOID
+  );
+
 #endif
@@ -0,0 +1,565 @@
+/** @file
+  Binary performance trace mode of DxeCorePerformanceLib.
+
+  When PcdEdkiiPerformanceTraceRecordCount is not zero, every performance entry is
+  appended to a ring buffer owned by the calling processor. Appending a record does
+  not copy strings, look up module names or take a lock, so it is cheap enough for
+  fine grained instrumentation and may be done from MP procedures running on APs.
+  Strings and GUIDs are interned once into shared lock-free hash tables.
+
+  The entries created before the boot performance table is reported at EndOfDxe are
+  merged into the FPDT boot records in timestamp order. The ring buffers are also
+  published as a configuration table for tools exporting the whole trace.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeCorePerformanceLibInternal.h"
+
+#define PERF_TRACE_STRING_COUNT  0x400
+#define PERF_TRACE_GUID_COUNT    0x100
+
+#define FNV1A_64_OFFSET_BASIS  0xCBF29CE484222325ull
+#define FNV1A_64_PRIME         0x00000100000001B3ull
+
+PERFORMANCE_TRACE_TABLE   *mPerfTraceTable     = NULL;
+EFI_MP_SERVICES_PROTOCOL  *mPerfTraceMpService = NULL;
+UINTN                     mPerfTraceBspNumber  = 0;
+VOID                      *mPerfTraceMpServiceRegistration;
+
+/**
+  Get the FNV-1a hash of a buffer. The hash is never zero, as zero marks a free
+  entry of the intern tables.
+
+  @param  Buffer  Pointer to the data.
+  @param  Size    Size of the data in bytes.
+
+  @return The hash of the data.
+**/
+UINT64
+PerfTraceHash (
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Size
+  )
+{
+  UINT64  Hash;
+  UINTN   Index;
+
+  Hash = FNV1A_64_OFFSET_BASIS;
+  for (Index = 0; Index < Size; Index++) {
+    Hash = (Hash ^ Buffer[Index]) * FNV1A_64_PRIME;
+  }
+
+  return (Hash == 0) ? 1 : Hash;
+}
+
+/**
+  Find or claim the entry of an intern table with the given hash.
+
+  Entries are claimed with a compare exchange of their hash field, so several
+  processors may intern at the same time.
+
+  @param  Table      The intern table.
+  @param  EntrySize  Size of one entry, starting with its UINT64 hash.
+  @param  Count      Number of entries in the table.
+  @param  Hash       The hash to look for.
+  @param  Claimed    Set to TRUE if the entry was claimed by this call and its
+                     data must be filled in.
+
+  @return Index of the entry, or PERFORMANCE_TRACE_INVALID_INDEX if the table is full.
+**/
+UINT16
+PerfTraceIntern (
+  IN  VOID     *Table,
+  IN  UINTN    EntrySize,
+  IN  UINT32   Count,
+  IN  UINT64   Hash,
+  OUT BOOLEAN  *Claimed
+  )
+{
+  UINT32  Probe;
+  UINT32  Index;
+  UINT64  *Entry;
+  UINT64  Current;
+
+  *Claimed = FALSE;
+  Index    = (UINT32)ModU64x32 (Hash, Count);
+  for (Probe = 0; Probe < Count; Probe++) {
+    Entry   = (UINT64 *)((UINT8 *)Table + Index * EntrySize);
+    Current = *(volatile UINT64 *)Entry;
+    if (Current == 0) {
+      Current = InterlockedCompareExchange64 (Entry, 0, Hash);
+      if (Current == 0) {
+        *Claimed = TRUE;
+        return (UINT16)Index;
+      }
+    }
+
+    if (Current == Hash) {
+      return (UINT16)Index;
+    }
+
+    Index = (Index + 1 == Count) ? 0 : Index + 1;
+  }
+
+  return PERFORMANCE_TRACE_INVALID_INDEX;
+}
+
+/**
+  Intern a string, truncated to the length kept by FPDT string records.
+
+  @param  String  The string to intern.
+
+  @return Index of the string, or PERFORMANCE_TRACE_INVALID_INDEX.
+**/
+UINT16
+PerfTraceInternString (
+  IN CONST CHAR8  *String
+  )
+{
+  UINTN    Length;
+  UINT16   Index;
+  BOOLEAN  Claimed;
+
+  if (String == NULL) {
+    return PERFORMANCE_TRACE_INVALID_INDEX;
+  }
+
+  Length = AsciiStrnLenS (String, FPDT_STRING_EVENT_RECORD_NAME_LENGTH - 1);
+  Index  = PerfTraceIntern (
+             mPerfTraceTable->String,
+             sizeof (PERFORMANCE_TRACE_STRING),
+             mPerfTraceTable->StringCount,
+             PerfTraceHash ((CONST UINT8 *)String, Length),
+             &Claimed
+             );
+  if (Claimed) {
+    CopyMem (mPerfTraceTable->String[Index].String, String, Length);
+  }
+
+  return Index;
+}
+
+/**
+  Intern a GUID.
+
+  @param  Guid  The GUID to intern.
+
+  @return Index of the GUID, or PERFORMANCE_TRACE_INVALID_INDEX.
+**/
+UINT16
+PerfTraceInternGuid (
+  IN CONST EFI_GUID  *Guid
+  )
+{
+  UINT16   Index;
+  BOOLEAN  Claimed;
+
+  if (Guid == NULL) {
+    return PERFORMANCE_TRACE_INVALID_INDEX;
+  }
+
+  Index = PerfTraceIntern (
+            mPerfTraceTable->Guid,
+            sizeof (PERFORMANCE_TRACE_GUID),
+            mPerfTraceTable->GuidCount,
+            PerfTraceHash ((CONST UINT8 *)Guid, sizeof (EFI_GUID)),
+            &Claimed
+            );
+  if (Claimed) {
+    CopyGuid (&mPerfTraceTable->Guid[Index].Guid, Guid);
+  }
+
+  return Index;
+}
+
+/**
+  Allocate the ring buffer of one processor.
+
+  @return The ring buffer, or NULL if there are not enough resources.
+**/
+PERFORMANCE_TRACE_RING *
+PerfTraceAllocateRing (
+  VOID
+  )
+{
+  return AllocateZeroPool (
+           sizeof (PERFORMANCE_TRACE_RING) +
+           mPerfTraceTable->RecordCount * sizeof (PERFORMANCE_TRACE_RECORD)
+           );
+}
+
+/**
+  Get the number of the calling processor.
+
+  The BSP owns the first ring until the MP Services protocol is installed, as no
+  AP can run DXE code before.
+
+  @return The processor number of the caller.
+**/
+UINTN
+PerfTraceGetProcessorNumber (
+  VOID
+  )
+{
+  UINTN  ProcessorNumber;
+
+  if (mPerfTraceMpService == NULL) {
+    return mPerfTraceBspNumber;
+  }
+
+  if (EFI_ERROR (mPerfTraceMpService->WhoAmI (mPerfTraceMpService, &ProcessorNumber))) {
+    return mPerfTraceBspNumber;
+  }
+
+  return ProcessorNumber;
+}
+
+/**
+  Check whether the caller runs on the BSP.
+
+  @param  ProcessorNumber  The processor number of the caller.
+
+  @retval TRUE   The caller is the BSP.
+  @retval FALSE  The caller is an AP.
+**/
+BOOLEAN
+PerfTraceIsBsp (
+  IN UINTN  ProcessorNumber
+  )
+{
+  return (BOOLEAN)(ProcessorNumber == mPerfTraceBspNumber);
+}
+
+/**
+  Append a performance record to the ring buffer of the calling processor.
+
+  The slot is reserved before it is filled in, so a record created from an interrupt
+  handler on the same processor does not overwrite the interrupted one.
+
+  @param ProcessorNumber   The processor number of the caller.
+  @param CallerIdentifier  Image handle or pointer to caller ID GUID.
+  @param Guid              Pointer to a GUID.
+  @param String            Pointer to a string describing the measurement.
+  @param TimeStamp         64-bit time stamp, 0 to read the performance counter.
+  @param Address           Pointer to a location in memory relevant to the measurement.
+  @param Identifier        Performance identifier describing the type of measurement.
+  @param Attribute         The attribute of the measurement.
+
+  @retval EFI_SUCCESS           The record was appended.
+  @retval EFI_OUT_OF_RESOURCES  The calling processor has no ring buffer.
+**/
+EFI_STATUS
+PerfTraceAppendRecord (
+  IN       UINTN                       ProcessorNumber,
+  IN CONST VOID                        *CallerIdentifier  OPTIONAL,
+  IN CONST VOID                        *Guid      OPTIONAL,
+  IN CONST CHAR8                       *String    OPTIONAL,
+  IN       UINT64                      TimeStamp,
+  IN       UINT64                      Address    OPTIONAL,
+  IN       UINT32                      Identifier,
+  IN       PERF_MEASUREMENT_ATTRIBUTE  Attribute
+  )
+{
+  PERFORMANCE_TRACE_RING    *Ring;
+  PERFORMANCE_TRACE_RECORD  *Record;
+  UINT32                    Slot;
+
+  if (TimeStamp == 0) {
+    TimeStamp = GetPerformanceCounter ();
+  }
+
+  if (ProcessorNumber >= mPerfTraceTable->CpuCount) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Ring   = mPerfTraceTable->Ring[ProcessorNumber];
+  Slot   = InterlockedIncrement (&Ring->Head) - 1;
+  Record = (PERFORMANCE_TRACE_RECORD *)(Ring + 1) + (Slot % mPerfTraceTable->RecordCount);
+
+  Record->TimeStamp  = TimeStamp;
+  Record->Address    = Address;
+  Record->Identifier = (UINT16)Identifier;
+  Record->Attribute  = (UINT8)Attribute;
+  //
+  // Event signal and callback records identify the caller with a GUID, which is
+  // interned so that it is still valid if the image is unloaded.
+  //
+  if ((Identifier == PERF_EVENTSIGNAL_START_ID) || (Identifier == PERF_EVENTSIGNAL_END_ID) ||
+      (Identifier == PERF_CALLBACK_START_ID) || (Identifier == PERF_CALLBACK_END_ID))
+  {
+    Record->Caller = PerfTraceInternGuid (CallerIdentifier);
+    Record->Flags  = PERFORMANCE_TRACE_CALLER_IS_GUID_INDEX;
+  } else {
+    Record->Caller = (UINT64)(UINTN)CallerIdentifier;
+    Record->Flags  = 0;
+  }
+
+  Record->StringIndex = PerfTraceInternString (String);
+  Record->GuidIndex   = PerfTraceInternGuid (Guid);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Give every processor its own ring buffer when the MP Services protocol is installed.
+
+  @param  Event    The event of notify protocol.
+  @param  Context  Notify event context.
+**/
+VOID
+EFIAPI
+PerfTraceMpServiceNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  EFI_STATUS                Status;
+  EFI_MP_SERVICES_PROTOCOL  *MpService;
+  UINTN                     NumberOfProcessors;
+  UINTN                     NumberOfEnabledProcessors;
+  UINTN                     BspNumber;
+  UINTN                     Index;
+  PERFORMANCE_TRACE_RING    **Ring;
+
+  Status = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **)&MpService);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  gBS->CloseEvent (Event);
+
+  Status = MpService->GetNumberOfProcessors (MpService, &NumberOfProcessors, &NumberOfEnabledProcessors);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  Status = MpService->WhoAmI (MpService, &BspNumber);
+  if (EFI_ERROR (Status) || (BspNumber >= NumberOfProcessors)) {
+    return;
+  }
+
+  Ring = AllocateZeroPool (NumberOfProcessors * sizeof (PERFORMANCE_TRACE_RING *));
+  if (Ring == NULL) {
+    return;
+  }
+
+  //
+  // The BSP keeps the ring it used so far.
+  //
+  for (Index = 0; Index < NumberOfProcessors; Index++) {
+    if (Index == BspNumber) {
+      Ring[Index] = mPerfTraceTable->Ring[0];
+    } else {
+      Ring[Index] = PerfTraceAllocateRing ();
+      if (Ring[Index] == NULL) {
+        DEBUG ((DEBUG_ERROR, "DxeCorePerformanceLib: No trace buffer for processor %d\n", (UINT32)Index));
+      }
+    }
+  }
+
+  for (Index = 0; Index < NumberOfProcessors; Index++) {
+    if (Ring[Index] == NULL) {
+      NumberOfProcessors = Index;
+      break;
+    }
+  }
+
+  if (NumberOfProcessors <= BspNumber) {
+    for (Index = 0; Index < NumberOfProcessors; Index++) {
+      FreePool (Ring[Index]);
+    }
+
+    FreePool (Ring);
+    return;
+  }
+
+  FreePool (mPerfTraceTable->Ring);
+  mPerfTraceTable->Ring     = Ring;
+  mPerfTraceTable->CpuCount = (UINT32)NumberOfProcessors;
+  mPerfTraceBspNumber       = BspNumber;
+  mPerfTraceMpService       = MpService;
+}
+
+/**
+  Allocate and publish the performance trace table if trace mode is enabled.
+
+  @retval EFI_SUCCESS           Trace mode is disabled or has been initialized.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources for the trace buffers.
+**/
+EFI_STATUS
+PerfTraceInitialize (
+  VOID
+  )
+{
+  EFI_STATUS               Status;
+  PERFORMANCE_TRACE_TABLE  *Table;
+
+  if (PcdGet32 (PcdEdkiiPerformanceTraceRecordCount) == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Table = AllocateZeroPool (sizeof (PERFORMANCE_TRACE_TABLE));
+  if (Table == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Table->Signature   = PERFORMANCE_TRACE_TABLE_SIGNATURE;
+  Table->Revision    = PERFORMANCE_TRACE_TABLE_REVISION;
+  Table->Frequency   = GetPerformanceCounterProperties (&Table->TimerStartValue, &Table->TimerEndValue);
+  Table->RecordCount = PcdGet32 (PcdEdkiiPerformanceTraceRecordCount);
+  Table->CpuCount    = 1;
+  Table->StringCount = PERF_TRACE_STRING_COUNT;
+  Table->GuidCount   = PERF_TRACE_GUID_COUNT;
+  Table->Ring        = AllocateZeroPool (sizeof (PERFORMANCE_TRACE_RING *));
+  Table->String      = AllocateZeroPool (PERF_TRACE_STRING_COUNT * sizeof (PERFORMANCE_TRACE_STRING));
+  Table->Guid        = AllocateZeroPool (PERF_TRACE_GUID_COUNT * sizeof (PERFORMANCE_TRACE_GUID));
+  mPerfTraceTable    = Table;
+  if ((Table->Ring != NULL) && (Table->String != NULL) && (Table->Guid != NULL)) {
+    Table->Ring[0] = PerfTraceAllocateRing ();
+  }
+
+  if ((Table->Ring == NULL) || (Table->Ring[0] == NULL) || (Table->String == NULL) || (Table->Guid == NULL)) {
+    mPerfTraceTable = NULL;
+    if (Table->Ring != NULL) {
+      if (Table->Ring[0] != NULL) {
+        FreePool (Table->Ring[0]);
+      }
+
+      FreePool (Table->Ring);
+    }
+
+    if (Table->String != NULL) {
+      FreePool (Table->String);
+    }
+
+    if (Table->Guid != NULL) {
+      FreePool (Table->Guid);
+    }
+
+    FreePool (Table);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = gBS->InstallConfigurationTable (&gEdkiiPerformanceTraceGuid, Table);
+  ASSERT_EFI_ERROR (Status);
+
+  EfiCreateProtocolNotifyEvent (
+    &gEfiMpServiceProtocolGuid,
+    TPL_CALLBACK,
+    PerfTraceMpServiceNotify,
+    NULL,
+    &mPerfTraceMpServiceRegistration
+    );
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Check whether a trace record was taken before another one.
+
+  @param  Record1  The first record.
+  @param  Record2  The second record.
+
+  @retval TRUE   Record1 was taken before Record2.
+  @retval FALSE  Record1 was not taken before Record2.
+**/
+BOOLEAN
+PerfTraceIsEarlier (
+  IN PERFORMANCE_TRACE_RECORD  *Record1,
+  IN PERFORMANCE_TRACE_RECORD  *Record2
+  )
+{
+  if (mPerfTraceTable->TimerStartValue > mPerfTraceTable->TimerEndValue) {
+    return (BOOLEAN)(Record1->TimeStamp > Record2->TimeStamp);
+  }
+
+  return (BOOLEAN)(Record1->TimeStamp < Record2->TimeStamp);
+}
+
+/**
+  Merge the records of all the ring buffers into the FPDT boot records, in the order
+  they were taken.
+
+  @return The number of records overwritten in the ring buffers before the merge.
+**/
+UINT64
+PerfTraceMergeIntoFpdt (
+  VOID
+  )
+{
+  UINT32                    *Next;
+  UINT32                    *End;
+  UINTN                     CpuCount;
+  UINTN                     Index;
+  UINTN                     Earliest;
+  UINT64                    Lost;
+  PERFORMANCE_TRACE_RING    *Ring;
+  PERFORMANCE_TRACE_RECORD  *Record;
+  PERFORMANCE_TRACE_RECORD  *EarliestRecord;
+  CONST VOID                *Caller;
+
+  CpuCount = mPerfTraceTable->CpuCount;
+  Next     = AllocatePool (2 * CpuCount * sizeof (UINT32));
+  if (Next == NULL) {
+    return 0;
+  }
+
+  End  = Next + CpuCount;
+  Lost = 0;
+  for (Index = 0; Index < CpuCount; Index++) {
+    End[Index]  = mPerfTraceTable->Ring[Index]->Head;
+    Next[Index] = 0;
+    if (End[Index] > mPerfTraceTable->RecordCount) {
+      Next[Index] = End[Index] - mPerfTraceTable->RecordCount;
+      Lost       += Next[Index];
+    }
+  }
+
+  if (Lost != 0) {
+    DEBUG ((DEBUG_INFO, "DxeCorePerformanceLib: %ld trace records overwritten before EndOfDxe\n", Lost));
+  }
+
+  while (TRUE) {
+    Earliest       = CpuCount;
+    EarliestRecord = NULL;
+    for (Index = 0; Index < CpuCount; Index++) {
+      if (Next[Index] == End[Index]) {
+        continue;
+      }
+
+      Ring   = mPerfTraceTable->Ring[Index];
+      Record = (PERFORMANCE_TRACE_RECORD *)(Ring + 1) + (Next[Index] % mPerfTraceTable->RecordCount);
+      if ((EarliestRecord == NULL) || PerfTraceIsEarlier (Record, EarliestRecord)) {
+        Earliest       = Index;
+        EarliestRecord = Record;
+      }
+    }
+
+    if (EarliestRecord == NULL) {
+      break;
+    }
+
+    Next[Earliest]++;
+
+    if ((EarliestRecord->Flags & PERFORMANCE_TRACE_CALLER_IS_GUID_INDEX) != 0) {
+      Caller = (EarliestRecord->Caller == PERFORMANCE_TRACE_INVALID_INDEX) ? NULL : &mPerfTraceTable->Guid[EarliestRecord->Caller].Guid;
+    } else {
+      Caller = (CONST VOID *)(UINTN)EarliestRecord->Caller;
+    }
+
+    InsertFpdtRecord (
+      Caller,
+      (EarliestRecord->GuidIndex == PERFORMANCE_TRACE_INVALID_INDEX) ? NULL : &mPerfTraceTable->Guid[EarliestRecord->GuidIndex].Guid,
+      (EarliestRecord->StringIndex == PERFORMANCE_TRACE_INVALID_INDEX) ? NULL : mPerfTraceTable->String[EarliestRecord->StringIndex].String,
+      EarliestRecord->TimeStamp,
+      EarliestRecord->Address,
+      EarliestRecord->Identifier,
+      (PERF_MEASUREMENT_ATTRIBUTE)EarliestRecord->Attribute
+      );
+  }
+
+  FreePool (Next);
+  return Lost;
+}
@@ -0,0 +1,408 @@
+/** @file
+  Unit tests of the binary performance trace mode of DxeCorePerformanceLib.
+
+  A trace table with small rings and intern tables is built in memory, records
+  are appended to the rings of several processors and merged into the FPDT
+  boot records, which InsertFpdtRecord () of the test collects.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+extern "C" {
+  #include "../DxeCorePerformanceLibInternal.h"
+  #include <Library/PrintLib.h>
+
+  UINT16
+  PerfTraceInternString (
+    IN CONST CHAR8  *String
+    );
+
+  UINT16
+  PerfTraceInternGuid (
+    IN CONST EFI_GUID  *Guid
+    );
+
+  PERFORMANCE_TRACE_RING *
+  PerfTraceAllocateRing (
+    VOID
+    );
+}
+
+#define TEST_RECORD_COUNT  8
+#define TEST_CPU_COUNT     3
+#define TEST_STRING_COUNT  4
+#define TEST_GUID_COUNT    4
+
+//
+// A record merged into the FPDT boot records.
+//
+struct FPDT_TEST_RECORD {
+  CONST VOID     *Caller;
+  BOOLEAN        HasGuid;
+  EFI_GUID       Guid;
+  BOOLEAN        HasString;
+  std::string    String;
+  UINT64         TimeStamp;
+  UINT64         Address;
+  UINT16         PerfId;
+};
+
+STATIC std::vector<FPDT_TEST_RECORD>  mFpdtRecords;
+STATIC UINT64                         mPerformanceCounter;
+
+////////////////////////////////////////////////////////////////////////
+// Symbol Definitions
+// These are not directly under test - but required to link
+// DxeCorePerformanceTrace.c
+////////////////////////////////////////////////////////////////////////
+extern "C" {
+  EFI_STATUS
+  InsertFpdtRecord (
+    IN CONST VOID                        *CallerIdentifier   OPTIONAL,
+    IN CONST VOID                        *Guid     OPTIONAL,
+    IN CONST CHAR8                       *String   OPTIONAL,
+    IN       UINT64                      Ticker,
+    IN       UINT64                      Address   OPTIONAL,
+    IN       UINT16                      PerfId,
+    IN       PERF_MEASUREMENT_ATTRIBUTE  Attribute
+    )
+  {
+    FPDT_TEST_RECORD  Record;
+
+    Record.Caller    = CallerIdentifier;
+    Record.HasGuid   = (BOOLEAN)(Guid != NULL);
+    Record.HasString = (BOOLEAN)(String != NULL);
+    Record.TimeStamp = Ticker;
+    Record.Address   = Address;
+    Record.PerfId    = PerfId;
+    ZeroMem (&Record.Guid, sizeof (Record.Guid));
+    if (Guid != NULL) {
+      CopyGuid (&Record.Guid, (CONST EFI_GUID *)Guid);
+    }
+
+    if (String != NULL) {
+      Record.String = String;
+    }
+
+    mFpdtRecords.push_back (Record);
+    return EFI_SUCCESS;
+  }
+
+  UINT64
+  EFIAPI
+  GetPerformanceCounter (
+    VOID
+    )
+  {
+    return ++mPerformanceCounter;
+  }
+
+  UINT64
+  EFIAPI
+  GetPerformanceCounterProperties (
+    OUT UINT64  *StartValue  OPTIONAL,
+    OUT UINT64  *EndValue    OPTIONAL
+    )
+  {
+    if (StartValue != NULL) {
+      *StartValue = 0;
+    }
+
+    if (EndValue != NULL) {
+      *EndValue = MAX_UINT64;
+    }
+
+    return 1000000000;
+  }
+
+  EFI_EVENT
+  EFIAPI
+  EfiCreateProtocolNotifyEvent (
+    IN  EFI_GUID          *ProtocolGuid,
+    IN  EFI_TPL           NotifyTpl,
+    IN  EFI_EVENT_NOTIFY  NotifyFunction,
+    IN  VOID              *NotifyContext   OPTIONAL,
+    OUT VOID              **Registration
+    )
+  {
+    return NULL;
+  }
+}
+
+class PerformanceTraceTest : public ::testing::Test {
+protected:
+  PERFORMANCE_TRACE_TABLE  Table;
+
+  void
+  SetUp (
+    ) override
+  {
+    UINTN  Index;
+
+    ZeroMem (&Table, sizeof (Table));
+    Table.Signature     = PERFORMANCE_TRACE_TABLE_SIGNATURE;
+    Table.Revision      = PERFORMANCE_TRACE_TABLE_REVISION;
+    Table.Frequency     = GetPerformanceCounterProperties (&Table.TimerStartValue, &Table.TimerEndValue);
+    Table.RecordCount   = TEST_RECORD_COUNT;
+    Table.CpuCount      = TEST_CPU_COUNT;
+    Table.StringCount   = TEST_STRING_COUNT;
+    Table.GuidCount     = TEST_GUID_COUNT;
+    Table.Ring          = (PERFORMANCE_TRACE_RING **)AllocateZeroPool (TEST_CPU_COUNT * sizeof (PERFORMANCE_TRACE_RING *));
+    Table.String        = (PERFORMANCE_TRACE_STRING *)AllocateZeroPool (TEST_STRING_COUNT * sizeof (PERFORMANCE_TRACE_STRING));
+    Table.Guid          = (PERFORMANCE_TRACE_GUID *)AllocateZeroPool (TEST_GUID_COUNT * sizeof (PERFORMANCE_TRACE_GUID));
+    mPerfTraceTable     = &Table;
+    mPerformanceCounter = 0;
+    mFpdtRecords.clear ();
+    ASSERT_NE (Table.Ring, nullptr);
+    ASSERT_NE (Table.String, nullptr);
+    ASSERT_NE (Table.Guid, nullptr);
+    for (Index = 0; Index < TEST_CPU_COUNT; Index++) {
+      Table.Ring[Index] = PerfTraceAllocateRing ();
+      ASSERT_NE (Table.Ring[Index], nullptr);
+    }
+  }
+
+  void
+  TearDown (
+    ) override
+  {
+    UINTN  Index;
+
+    for (Index = 0; Index < TEST_CPU_COUNT; Index++) {
+      if (Table.Ring[Index] != NULL) {
+        FreePool (Table.Ring[Index]);
+      }
+    }
+
+    FreePool (Table.Ring);
+    FreePool (Table.String);
+    FreePool (Table.Guid);
+    mPerfTraceTable = NULL;
+  }
+
+  //
+  // Append a record whose Address identifies it.
+  //
+  VOID
+  Append (
+    UINTN        ProcessorNumber,
+    UINT64       TimeStamp,
+    UINT64       Address,
+    CONST CHAR8  *String = NULL
+    )
+  {
+    EXPECT_EQ (
+      PerfTraceAppendRecord (ProcessorNumber, NULL, NULL, String, TimeStamp, Address, PERF_INMODULE_START_ID, PerfStartEntry),
+      EFI_SUCCESS
+      );
+  }
+};
+
+TEST_F (PerformanceTraceTest, RingWrapReportsLostRecords) {
+  std::vector<UINT64>  Cpu0;
+  std::vector<UINT64>  Cpu1;
+  UINT64               Index;
+
+  //
+  // Processor 0 overwrites its ring twice and a half, processor 1 fills its
+  // ring exactly and processor 2 records nothing.
+  //
+  for (Index = 0; Index < 2 * TEST_RECORD_COUNT + 3; Index++) {
+    Append (0, 100 + 2 * Index, Index);
+  }
+
+  for (Index = 0; Index < TEST_RECORD_COUNT; Index++) {
+    Append (1, 101 + 2 * Index, 0x100 + Index);
+  }
+
+  EXPECT_EQ (Table.Ring[0]->Head, 2U * TEST_RECORD_COUNT + 3);
+  EXPECT_EQ (PerfTraceMergeIntoFpdt (), (UINT64)TEST_RECORD_COUNT + 3);
+  ASSERT_EQ (mFpdtRecords.size (), 2U * TEST_RECORD_COUNT);
+
+  //
+  // Only the latest records of processor 0 are left, in order.
+  //
+  for (Index = 0; Index < mFpdtRecords.size (); Index++) {
+    if (mFpdtRecords[Index].Address >= 0x100) {
+      Cpu1.push_back (mFpdtRecords[Index].Address - 0x100);
+    } else {
+      Cpu0.push_back (mFpdtRecords[Index].Address);
+    }
+  }
+
+  ASSERT_EQ (Cpu0.size (), (size_t)TEST_RECORD_COUNT);
+  ASSERT_EQ (Cpu1.size (), (size_t)TEST_RECORD_COUNT);
+  for (Index = 0; Index < TEST_RECORD_COUNT; Index++) {
+    EXPECT_EQ (Cpu0[Index], TEST_RECORD_COUNT + 3 + Index);
+    EXPECT_EQ (Cpu1[Index], Index);
+  }
+}
+
+TEST_F (PerformanceTraceTest, RecordWithoutRingIsRejected) {
+  EXPECT_EQ (
+    PerfTraceAppendRecord (TEST_CPU_COUNT, NULL, NULL, NULL, 1, 0, PERF_INMODULE_START_ID, PerfStartEntry),
+    EFI_OUT_OF_RESOURCES
+    );
+
+  //
+  // A time stamp of zero is taken from the performance counter.
+  //
+  Append (0, 0, 1);
+  EXPECT_EQ (PerfTraceMergeIntoFpdt (), 0U);
+  ASSERT_EQ (mFpdtRecords.size (), 1U);
+  EXPECT_EQ (mFpdtRecords[0].TimeStamp, mPerformanceCounter);
+}
+
+TEST_F (PerformanceTraceTest, MergeOrdersRecordsAcrossRings) {
+  //
+  // Time stamps taken on 3 processors: each ring is in order, the rings
+  // interleave and two records have the same time stamp.
+  //
+  STATIC CONST UINT64  TimeStamp[TEST_CPU_COUNT][5] = {
+    { 10, 11, 40, 41, 90 },
+    { 5,  20, 21, 60, 61 },
+    { 15, 30, 40, 50, 95 }
+  };
+  UINTN                Cpu;
+  UINTN                Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (TimeStamp[0]); Index++) {
+    for (Cpu = 0; Cpu < TEST_CPU_COUNT; Cpu++) {
+      Append (Cpu, TimeStamp[Cpu][Index], (Cpu << 8) | Index);
+    }
+  }
+
+  EXPECT_EQ (PerfTraceMergeIntoFpdt (), 0U);
+  ASSERT_EQ (mFpdtRecords.size (), TEST_CPU_COUNT * ARRAY_SIZE (TimeStamp[0]));
+  for (Index = 0; Index < mFpdtRecords.size (); Index++) {
+    Cpu = (UINTN)(mFpdtRecords[Index].Address >> 8);
+    EXPECT_EQ (mFpdtRecords[Index].TimeStamp, TimeStamp[Cpu][mFpdtRecords[Index].Address & 0xFF]);
+    if (Index > 0) {
+      EXPECT_LE (mFpdtRecords[Index - 1].TimeStamp, mFpdtRecords[Index].TimeStamp) << "Record " << Index;
+    }
+  }
+}
+
+TEST_F (PerformanceTraceTest, MergeOrdersDownCountingTimer) {
+  STATIC CONST UINT64  TimeStamp[TEST_CPU_COUNT][4] = {
+    { 1000, 900, 500, 100 },
+    { 950,  940, 300, 200 },
+    { 990,  600, 550, 10  }
+  };
+  UINTN                Cpu;
+  UINTN                Index;
+
+  Table.TimerStartValue = MAX_UINT32;
+  Table.TimerEndValue   = 0;
+  for (Index = 0; Index < ARRAY_SIZE (TimeStamp[0]); Index++) {
+    for (Cpu = 0; Cpu < TEST_CPU_COUNT; Cpu++) {
+      Append (Cpu, TimeStamp[Cpu][Index], (Cpu << 8) | Index);
+    }
+  }
+
+  EXPECT_EQ (PerfTraceMergeIntoFpdt (), 0U);
+  ASSERT_EQ (mFpdtRecords.size (), TEST_CPU_COUNT * ARRAY_SIZE (TimeStamp[0]));
+  EXPECT_EQ (mFpdtRecords.front ().TimeStamp, 1000U);
+  EXPECT_EQ (mFpdtRecords.back ().TimeStamp, 10U);
+  for (Index = 1; Index < mFpdtRecords.size (); Index++) {
+    EXPECT_GT (mFpdtRecords[Index - 1].TimeStamp, mFpdtRecords[Index].TimeStamp) << "Record " << Index;
+  }
+}
+
+TEST_F (PerformanceTraceTest, InternDuplicateStrings) {
+  std::string  Long;
+  std::string  LongOther;
+  UINT16       Index;
+
+  Index = PerfTraceInternString ("DriverA");
+  ASSERT_NE (Index, PERFORMANCE_TRACE_INVALID_INDEX);
+  EXPECT_EQ (PerfTraceInternString ("DriverA"), Index);
+  EXPECT_NE (PerfTraceInternString ("DriverB"), Index);
+  EXPECT_STREQ (Table.String[Index].String, "DriverA");
+
+  //
+  // Strings are kept to the length of an FPDT string record, strings only
+  // differing after that are the same.
+  //
+  Long.assign (FPDT_STRING_EVENT_RECORD_NAME_LENGTH - 1, 'x');
+  LongOther  = Long;
+  Long      += "1";
+  LongOther += "2";
+  Index      = PerfTraceInternString (Long.c_str ());
+  ASSERT_NE (Index, PERFORMANCE_TRACE_INVALID_INDEX);
+  EXPECT_EQ (PerfTraceInternString (LongOther.c_str ()), Index);
+  EXPECT_EQ (AsciiStrLen (Table.String[Index].String), (UINTN)FPDT_STRING_EVENT_RECORD_NAME_LENGTH - 1);
+
+  EXPECT_EQ (PerfTraceInternString (NULL), PERFORMANCE_TRACE_INVALID_INDEX);
+}
+
+TEST_F (PerformanceTraceTest, InternTableFull) {
+  CHAR8     Name[8];
+  EFI_GUID  Guid;
+  UINT16    Index[TEST_STRING_COUNT];
+  UINTN     Count;
+
+  for (Count = 0; Count < TEST_STRING_COUNT; Count++) {
+    AsciiSPrint (Name, sizeof (Name), "S%d", (UINT32)Count);
+    Index[Count] = PerfTraceInternString (Name);
+    ASSERT_NE (Index[Count], PERFORMANCE_TRACE_INVALID_INDEX);
+  }
+
+  //
+  // A new string does not fit, the ones already interned are still found.
+  //
+  EXPECT_EQ (PerfTraceInternString ("Other"), PERFORMANCE_TRACE_INVALID_INDEX);
+  for (Count = 0; Count < TEST_STRING_COUNT; Count++) {
+    AsciiSPrint (Name, sizeof (Name), "S%d", (UINT32)Count);
+    EXPECT_EQ (PerfTraceInternString (Name), Index[Count]);
+  }
+
+  ZeroMem (&Guid, sizeof (Guid));
+  for (Count = 0; Count < TEST_GUID_COUNT; Count++) {
+    Guid.Data1 = (UINT32)Count;
+    ASSERT_NE (PerfTraceInternGuid (&Guid), PERFORMANCE_TRACE_INVALID_INDEX);
+  }
+
+  Guid.Data1 = TEST_GUID_COUNT;
+  EXPECT_EQ (PerfTraceInternGuid (&Guid), PERFORMANCE_TRACE_INVALID_INDEX);
+
+  //
+  // Records whose string or caller GUID could not be interned are merged
+  // without them.
+  //
+  Append (0, 1, 1, "Other");
+  Append (0, 2, 2, "S0");
+  EXPECT_EQ (
+    PerfTraceAppendRecord (0, &Guid, &Guid, NULL, 3, 3, PERF_EVENTSIGNAL_START_ID, PerfStartEntry),
+    EFI_SUCCESS
+    );
+  Guid.Data1 = 0;
+  EXPECT_EQ (
+    PerfTraceAppendRecord (0, &Guid, NULL, NULL, 4, 4, PERF_CALLBACK_START_ID, PerfStartEntry),
+    EFI_SUCCESS
+    );
+
+  EXPECT_EQ (PerfTraceMergeIntoFpdt (), 0U);
+  ASSERT_EQ (mFpdtRecords.size (), 4U);
+  EXPECT_FALSE (mFpdtRecords[0].HasString);
+  EXPECT_TRUE (mFpdtRecords[1].HasString);
+  EXPECT_EQ (mFpdtRecords[1].String, "S0");
+  EXPECT_EQ (mFpdtRecords[2].Caller, nullptr);
+  EXPECT_FALSE (mFpdtRecords[2].HasGuid);
+  ASSERT_NE (mFpdtRecords[3].Caller, nullptr);
+  EXPECT_TRUE (CompareGuid ((CONST EFI_GUID *)mFpdtRecords[3].Caller, &Guid));
+  EXPECT_NE (mFpdtRecords[3].Caller, (CONST VOID *)&Guid);
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  testing::InitGoogleTest (&argc, argv);
+  return RUN_ALL_TESTS ();
+}
@@ -12,6 +12,7 @@
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
+#include <Library/PcdLib.h>
 #include <Library/FrameBufferBltLib.h>
 
 struct FRAME_BUFFER_CONFIGURE {
@@ -20,6 +21,7 @@ struct FRAME_BUFFER_CONFIGURE {
   UINT32                       Width;
   UINT32                       Height;
   UINT8                        *FrameBuffer;
+  UINT8                        *Shadow;        // Copy of FrameBuffer, or NULL
   EFI_GRAPHICS_PIXEL_FORMAT    PixelFormat;
   EFI_PIXEL_BITMASK            PixelMasks;
   INT8                         PixelShl[4];    // R-G-B-Rsvd
@@ -35,6 +37,243 @@ CONST EFI_PIXEL_BITMASK  mBgrPixelMasks = {
   0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000
 };
 
+//
+// The pixel conversion of PixelBitMask stores a UINT32 for every pixel into
+// the line buffer, so the last one may be written past the end of the line.
+//
+#define FRAME_BUFFER_LINE_BUFFER_PADDING  sizeof (UINT32)
+
+//
+// Surface the Blt operations read from and write to.
+//
+#define FRAME_BUFFER_SURFACE(Configure) \
+  (((Configure)->Shadow != NULL) ? (Configure)->Shadow : (Configure)->FrameBuffer)
+
+/**
+  Swap the red and blue channels of 32-bit pixels, and clear the reserved
+  channel.
+
+  This converts between PixelRedGreenBlueReserved8BitPerColor and
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL in both directions. Two pixels are converted
+  at a time when the source and destination are equally aligned.
+
+  @param[out] Destination   The converted pixels.
+  @param[in]  Source        The pixels to convert.
+  @param[in]  Count         The number of pixels to convert.
+**/
+VOID
+FrameBufferBltLibSwapRedBlue (
+  OUT UINT32        *Destination,
+  IN  CONST UINT32  *Source,
+  IN  UINTN         Count
+  )
+{
+  UINT32  Pixel;
+  UINT64  Pixels;
+
+  if ((((UINTN)Destination ^ (UINTN)Source) & (sizeof (UINT64) - 1)) == 0) {
+    if ((Count > 0) && (((UINTN)Destination & (sizeof (UINT64) - 1)) != 0)) {
+      Pixel          = *Source++;
+      *Destination++ = ((Pixel >> 16) & 0x000000ff) | (Pixel & 0x0000ff00) | ((Pixel & 0x000000ff) << 16);
+      Count--;
+    }
+
+    for ( ; Count >= 2; Count -= 2) {
+      Pixels                  = *(CONST UINT64 *)Source;
+      *(UINT64 *)Destination  = ((Pixels >> 16) & 0x000000ff000000ffULL) |
+                                (Pixels & 0x0000ff000000ff00ULL) |
+                                ((Pixels & 0x000000ff000000ffULL) << 16);
+      Source                 += 2;
+      Destination            += 2;
+    }
+  }
+
+  for ( ; Count > 0; Count--) {
+    Pixel          = *Source++;
+    *Destination++ = ((Pixel >> 16) & 0x000000ff) | (Pixel & 0x0000ff00) | ((Pixel & 0x000000ff) << 16);
+  }
+}
+
+/**
+  Convert pixels from EFI_GRAPHICS_OUTPUT_BLT_PIXEL to the pixel format of
+  the frame buffer.
+
+  For PixelBitMask, a UINT32 is stored for every pixel, so Destination must
+  have FRAME_BUFFER_LINE_BUFFER_PADDING bytes after the last pixel.
+
+  @param[in]  Configure     Pointer to a configuration which was successfully
+                            created by FrameBufferBltConfigure ().
+  @param[out] Destination   The converted pixels.
+  @param[in]  Source        The pixels to convert.
+  @param[in]  Count         The number of pixels to convert.
+**/
+VOID
+FrameBufferBltLibConvertToVideo (
+  IN  FRAME_BUFFER_CONFIGURE               *Configure,
+  OUT UINT8                                *Destination,
+  IN  CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Source,
+  IN  UINTN                                Count
+  )
+{
+  UINT32  RedMask;
+  UINT32  GreenMask;
+  UINT32  BlueMask;
+  UINT8   RedShl;
+  UINT8   RedShr;
+  UINT8   GreenShl;
+  UINT8   GreenShr;
+  UINT8   BlueShl;
+  UINT8   BlueShr;
+  UINT32  BytesPerPixel;
+  UINT32  Uint32;
+
+  switch (Configure->PixelFormat) {
+    case PixelBlueGreenRedReserved8BitPerColor:
+      CopyMem (Destination, Source, Count * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+      return;
+
+    case PixelRedGreenBlueReserved8BitPerColor:
+      FrameBufferBltLibSwapRedBlue ((UINT32 *)Destination, (CONST UINT32 *)Source, Count);
+      return;
+
+    default:
+      break;
+  }
+
+  //
+  // Keep the conversion parameters in locals so that the loop does not
+  // reload them through Configure for every pixel.
+  //
+  RedMask       = Configure->PixelMasks.RedMask;
+  GreenMask     = Configure->PixelMasks.GreenMask;
+  BlueMask      = Configure->PixelMasks.BlueMask;
+  RedShl        = (UINT8)Configure->PixelShl[0];
+  RedShr        = (UINT8)Configure->PixelShr[0];
+  GreenShl      = (UINT8)Configure->PixelShl[1];
+  GreenShr      = (UINT8)Configure->PixelShr[1];
+  BlueShl       = (UINT8)Configure->PixelShl[2];
+  BlueShr       = (UINT8)Configure->PixelShr[2];
+  BytesPerPixel = Configure->BytesPerPixel;
+
+  for ( ; Count > 0; Count--, Source++, Destination += BytesPerPixel) {
+    Uint32                   = *(CONST UINT32 *)Source;
+    *(UINT32 *)Destination   = (((Uint32 << RedShl) >> RedShr) & RedMask) |
+                               (((Uint32 << GreenShl) >> GreenShr) & GreenMask) |
+                               (((Uint32 << BlueShl) >> BlueShr) & BlueMask);
+  }
+}
+
+/**
+  Convert pixels from the pixel format of the frame buffer to
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL.
+
+  For PixelBitMask, a UINT32 is read for every pixel, so Source must have
+  FRAME_BUFFER_LINE_BUFFER_PADDING bytes after the last pixel.
+
+  @param[in]  Configure     Pointer to a configuration which was successfully
+                            created by FrameBufferBltConfigure ().
+  @param[out] Destination   The converted pixels.
+  @param[in]  Source        The pixels to convert.
+  @param[in]  Count         The number of pixels to convert.
+**/
+VOID
+FrameBufferBltLibConvertFromVideo (
+  IN  FRAME_BUFFER_CONFIGURE         *Configure,
+  OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Destination,
+  IN  CONST UINT8                    *Source,
+  IN  UINTN                          Count
+  )
+{
+  UINT32  RedMask;
+  UINT32  GreenMask;
+  UINT32  BlueMask;
+  UINT8   RedShl;
+  UINT8   RedShr;
+  UINT8   GreenShl;
+  UINT8   GreenShr;
+  UINT8   BlueShl;
+  UINT8   BlueShr;
+  UINT32  BytesPerPixel;
+  UINT32  Uint32;
+
+  switch (Configure->PixelFormat) {
+    case PixelBlueGreenRedReserved8BitPerColor:
+      CopyMem (Destination, Source, Count * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+      return;
+
+    case PixelRedGreenBlueReserved8BitPerColor:
+      FrameBufferBltLibSwapRedBlue ((UINT32 *)Destination, (CONST UINT32 *)Source, Count);
+      return;
+
+    default:
+      break;
+  }
+
+  RedMask       = Configure->PixelMasks.RedMask;
+  GreenMask     = Configure->PixelMasks.GreenMask;
+  BlueMask      = Configure->PixelMasks.BlueMask;
+  RedShl        = (UINT8)Configure->PixelShl[0];
+  RedShr        = (UINT8)Configure->PixelShr[0];
+  GreenShl      = (UINT8)Configure->PixelShl[1];
+  GreenShr      = (UINT8)Configure->PixelShr[1];
+  BlueShl       = (UINT8)Configure->PixelShl[2];
+  BlueShr       = (UINT8)Configure->PixelShr[2];
+  BytesPerPixel = Configure->BytesPerPixel;
+
+  for ( ; Count > 0; Count--, Destination++, Source += BytesPerPixel) {
+    Uint32                   = *(CONST UINT32 *)Source;
+    *(UINT32 *)Destination   = (((Uint32 & RedMask) >> RedShl) << RedShr) |
+                               (((Uint32 & GreenMask) >> GreenShl) << GreenShr) |
+                               (((Uint32 & BlueMask) >> BlueShl) << BlueShr);
+  }
+}
+
+/**
+  Write a rectangle of the shadow frame buffer to the frame buffer.
+
+  Nothing is done if the configuration has no shadow frame buffer.
+
+  @param[in]  Configure     Pointer to a configuration which was successfully
+                            created by FrameBufferBltConfigure ().
+  @param[in]  X             X location of the rectangle.
+  @param[in]  Y             Y location of the rectangle.
+  @param[in]  Width         Width (in pixels).
+  @param[in]  Height        Height.
+**/
+VOID
+FrameBufferBltLibFlush (
+  IN  FRAME_BUFFER_CONFIGURE  *Configure,
+  IN  UINTN                   X,
+  IN  UINTN                   Y,
+  IN  UINTN                   Width,
+  IN  UINTN                   Height
+  )
+{
+  UINTN  Offset;
+  UINTN  LineStride;
+  UINTN  WidthInBytes;
+
+  if (Configure->Shadow == NULL) {
+    return;
+  }
+
+  LineStride   = Configure->BytesPerPixel * Configure->PixelsPerScanLine;
+  WidthInBytes = Width * Configure->BytesPerPixel;
+  Offset       = Y * LineStride + X * Configure->BytesPerPixel;
+
+  //
+  // Full lines are contiguous, and are written with a single copy.
+  //
+  if (WidthInBytes == LineStride) {
+    CopyMem (Configure->FrameBuffer + Offset, Configure->Shadow + Offset, WidthInBytes * Height);
+    return;
+  }
+
+  for ( ; Height > 0; Height--, Offset += LineStride) {
+    CopyMem (Configure->FrameBuffer + Offset, Configure->Shadow + Offset, WidthInBytes);
+  }
+}
+
 /**
   Initialize the bit mask in frame buffer configure.
 
@@ -119,6 +358,9 @@ FrameBufferBltConfigure (
   UINT32                   BytesPerPixel;
   INT8                     PixelShl[4];
   INT8                     PixelShr[4];
+  UINTN                    RequiredSize;
+  UINTN                    ShadowOffset;
+  UINTN                    ShadowSize;
 
   if (ConfigureSize == NULL) {
     return RETURN_INVALID_PARAMETER;
@@ -152,11 +394,22 @@ FrameBufferBltConfigure (
 
   FrameBufferBltLibConfigurePixelFormat (BitMask, &BytesPerPixel, PixelShl, PixelShr);
 
-  if (*ConfigureSize < sizeof (FRAME_BUFFER_CONFIGURE)
-      + FrameBufferInfo->HorizontalResolution * BytesPerPixel)
-  {
-    *ConfigureSize = sizeof (FRAME_BUFFER_CONFIGURE)
-                     + FrameBufferInfo->HorizontalResolution * BytesPerPixel;
+  RequiredSize = sizeof (FRAME_BUFFER_CONFIGURE)
+                 + FrameBufferInfo->HorizontalResolution * BytesPerPixel;
+
+  //
+  // The shadow frame buffer follows the line buffer in the configuration.
+  //
+  ShadowOffset = 0;
+  ShadowSize   = 0;
+  if (FeaturePcdGet (PcdFrameBufferBltShadowBuffer)) {
+    ShadowOffset = ALIGN_VALUE (RequiredSize + FRAME_BUFFER_LINE_BUFFER_PADDING, sizeof (UINT64));
+    ShadowSize   = (UINTN)FrameBufferInfo->PixelsPerScanLine * FrameBufferInfo->VerticalResolution * BytesPerPixel;
+    RequiredSize = ShadowOffset + ShadowSize;
+  }
+
+  if (*ConfigureSize < RequiredSize) {
+    *ConfigureSize = RequiredSize;
     return RETURN_BUFFER_TOO_SMALL;
   }
 
@@ -173,6 +426,15 @@ FrameBufferBltConfigure (
   Configure->Width             = FrameBufferInfo->HorizontalResolution;
   Configure->Height            = FrameBufferInfo->VerticalResolution;
   Configure->PixelsPerScanLine = FrameBufferInfo->PixelsPerScanLine;
+  Configure->Shadow            = NULL;
+
+  if (ShadowSize != 0) {
+    //
+    // Start from what is on the display, for example a logo.
+    //
+    Configure->Shadow = (UINT8 *)Configure + ShadowOffset;
+    CopyMem (Configure->Shadow, FrameBuffer, ShadowSize);
+  }
 
   return RETURN_SUCCESS;
 }
@@ -285,7 +547,7 @@ FrameBufferBltLibVideoFill (
     DEBUG ((DEBUG_VERBOSE, "VideoFill (wide, one-shot)\n"));
     Offset      = DestinationY * Configure->PixelsPerScanLine;
     Offset      = Configure->BytesPerPixel * Offset;
-    Destination = Configure->FrameBuffer + Offset;
+    Destination = FRAME_BUFFER_SURFACE (Configure) + Offset;
     SizeInBytes = WidthInBytes * Height;
     if (SizeInBytes >= 8) {
       SetMem32 (Destination, SizeInBytes & ~3, (UINT32)WideFill);
@@ -301,7 +563,7 @@ FrameBufferBltLibVideoFill (
     for (IndexY = DestinationY; IndexY < (Height + DestinationY); IndexY++) {
       Offset      = (IndexY * Configure->PixelsPerScanLine) + DestinationX;
       Offset      = Configure->BytesPerPixel * Offset;
-      Destination = Configure->FrameBuffer + Offset;
+      Destination = FRAME_BUFFER_SURFACE (Configure) + Offset;
 
       if (UseWideFill && (((UINTN)Destination & 7) == 0)) {
         DEBUG ((DEBUG_VERBOSE, "VideoFill (wide)\n"));
@@ -372,11 +634,7 @@ FrameBufferBltLibVideoToBltBuffer (
 {
   UINTN                          DstY;
   UINTN                          SrcY;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Blt;
   UINT8                          *Source;
-  UINT8                          *Destination;
-  UINTN                          IndexX;
-  UINT32                         Uint32;
   UINTN                          Offset;
   UINTN                          WidthInBytes;
 
@@ -415,33 +673,25 @@ FrameBufferBltLibVideoToBltBuffer (
   {
     Offset = (SrcY * Configure->PixelsPerScanLine) + SourceX;
     Offset = Configure->BytesPerPixel * Offset;
-    Source = Configure->FrameBuffer + Offset;
+    Source = FRAME_BUFFER_SURFACE (Configure) + Offset;
 
-    if (Configure->PixelFormat == PixelBlueGreenRedReserved8BitPerColor) {
-      Destination = (UINT8 *)BltBuffer + (DstY * Delta) + (DestinationX * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
-    } else {
-      Destination = Configure->LineBuffer;
+    //
+    // Pixels are read from the frame buffer with a single copy before they
+    // are converted, and PixelBitMask conversion needs the padded line buffer.
+    //
+    if ((Configure->PixelFormat != PixelBlueGreenRedReserved8BitPerColor) &&
+        ((Configure->Shadow == NULL) || (Configure->PixelFormat == PixelBitMask)))
+    {
+      CopyMem (Configure->LineBuffer, Source, WidthInBytes);
+      Source = Configure->LineBuffer;
     }
 
-    CopyMem (Destination, Source, WidthInBytes);
-
-    if (Configure->PixelFormat != PixelBlueGreenRedReserved8BitPerColor) {
-      for (IndexX = 0; IndexX < Width; IndexX++) {
-        Blt = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)
-              ((UINT8 *)BltBuffer + (DstY * Delta) +
-               (DestinationX + IndexX) * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
-        Uint32         = *(UINT32 *)(Configure->LineBuffer + (IndexX * Configure->BytesPerPixel));
-        *(UINT32 *)Blt =
-          (UINT32)(
-                   (((Uint32 & Configure->PixelMasks.RedMask) >>
-                     Configure->PixelShl[0]) << Configure->PixelShr[0]) |
-                   (((Uint32 & Configure->PixelMasks.GreenMask) >>
-                     Configure->PixelShl[1]) << Configure->PixelShr[1]) |
-                   (((Uint32 & Configure->PixelMasks.BlueMask) >>
-                     Configure->PixelShl[2]) << Configure->PixelShr[2])
-                   );
-      }
-    }
+    FrameBufferBltLibConvertFromVideo (
+      Configure,
+      (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)((UINT8 *)BltBuffer + (DstY * Delta) + (DestinationX * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL))),
+      Source,
+      Width
+      );
   }
 
   return RETURN_SUCCESS;
@@ -480,11 +730,8 @@ FrameBufferBltLibBufferToVideo (
 {
   UINTN                          DstY;
   UINTN                          SrcY;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Blt;
-  UINT8                          *Source;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Source;
   UINT8                          *Destination;
-  UINTN                          IndexX;
-  UINT32                         Uint32;
   UINTN                          Offset;
   UINTN                          WidthInBytes;
 
@@ -520,34 +767,19 @@ FrameBufferBltLibBufferToVideo (
   {
     Offset      = (DstY * Configure->PixelsPerScanLine) + DestinationX;
     Offset      = Configure->BytesPerPixel * Offset;
-    Destination = Configure->FrameBuffer + Offset;
+    Destination = FRAME_BUFFER_SURFACE (Configure) + Offset;
+    Source      = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)((UINT8 *)BltBuffer + (SrcY * Delta) + SourceX * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
 
-    if (Configure->PixelFormat == PixelBlueGreenRedReserved8BitPerColor) {
-      Source = (UINT8 *)BltBuffer + (SrcY * Delta) + SourceX * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+    //
+    // 32-bit pixel formats are converted in place, PixelBitMask conversion
+    // needs the padded line buffer.
+    //
+    if (Configure->PixelFormat == PixelBitMask) {
+      FrameBufferBltLibConvertToVideo (Configure, Configure->LineBuffer, Source, Width);
+      CopyMem (Destination, Configure->LineBuffer, WidthInBytes);
     } else {
-      for (IndexX = 0; IndexX < Width; IndexX++) {
-        Blt =
-          (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)(
-                                            (UINT8 *)BltBuffer +
-                                            (SrcY * Delta) +
-                                            ((SourceX + IndexX) * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL))
-                                            );
-        Uint32                                                                   = *(UINT32 *)Blt;
-        *(UINT32 *)(Configure->LineBuffer + (IndexX * Configure->BytesPerPixel)) =
-          (UINT32)(
-                   (((Uint32 << Configure->PixelShl[0]) >> Configure->PixelShr[0]) &
-                    Configure->PixelMasks.RedMask) |
-                   (((Uint32 << Configure->PixelShl[1]) >> Configure->PixelShr[1]) &
-                    Configure->PixelMasks.GreenMask) |
-                   (((Uint32 << Configure->PixelShl[2]) >> Configure->PixelShr[2]) &
-                    Configure->PixelMasks.BlueMask)
-                   );
-      }
-
-      Source = Configure->LineBuffer;
+      FrameBufferBltLibConvertToVideo (Configure, Destination, Source, Width);
     }
-
-    CopyMem (Destination, Source, WidthInBytes);
   }
 
   return RETURN_SUCCESS;
@@ -612,19 +844,19 @@ FrameBufferBltLibVideoToVideo (
 
   Offset = (SourceY * Configure->PixelsPerScanLine) + SourceX;
   Offset = Configure->BytesPerPixel * Offset;
-  Source = Configure->FrameBuffer + Offset;
+  Source = FRAME_BUFFER_SURFACE (Configure) + Offset;
 
   Offset      = (DestinationY * Configure->PixelsPerScanLine) + DestinationX;
   Offset      = Configure->BytesPerPixel * Offset;
-  Destination = Configure->FrameBuffer + Offset;
+  Destination = FRAME_BUFFER_SURFACE (Configure) + Offset;
 
   LineStride = Configure->BytesPerPixel * Configure->PixelsPerScanLine;
   if (Destination > Source) {
     //
     // Copy from last line to avoid source is corrupted by copying
     //
-    Source      += Height * LineStride;
-    Destination += Height * LineStride;
+    Source      += (Height - 1) * LineStride;
+    Destination += (Height - 1) * LineStride;
     LineStride   = -LineStride;
   }
 
@@ -680,6 +912,8 @@ FrameBufferBlt (
   IN     UINTN                              Delta
   )
 {
+  RETURN_STATUS  Status;
+
   if (Configure == NULL) {
     return RETURN_INVALID_PARAMETER;
   }
@@ -699,40 +933,53 @@ FrameBufferBlt (
                );
 
     case EfiBltVideoToVideo:
-      return FrameBufferBltLibVideoToVideo (
-               Configure,
-               SourceX,
-               SourceY,
-               DestinationX,
-               DestinationY,
-               Width,
-               Height
-               );
+      Status = FrameBufferBltLibVideoToVideo (
+                 Configure,
+                 SourceX,
+                 SourceY,
+                 DestinationX,
+                 DestinationY,
+                 Width,
+                 Height
+                 );
+      break;
 
     case EfiBltVideoFill:
-      return FrameBufferBltLibVideoFill (
-               Configure,
-               BltBuffer,
-               DestinationX,
-               DestinationY,
-               Width,
-               Height
-               );
+      Status = FrameBufferBltLibVideoFill (
+                 Configure,
+                 BltBuffer,
+                 DestinationX,
+                 DestinationY,
+                 Width,
+                 Height
+                 );
+      break;
 
     case EfiBltBufferToVideo:
-      return FrameBufferBltLibBufferToVideo (
-               Configure,
-               BltBuffer,
-               SourceX,
-               SourceY,
-               DestinationX,
-               DestinationY,
-               Width,
-               Height,
-               Delta
-               );
+      Status = FrameBufferBltLibBufferToVideo (
+                 Configure,
+                 BltBuffer,
+                 SourceX,
+                 SourceY,
+                 DestinationX,
+                 DestinationY,
+                 Width,
+                 Height,
+                 Delta
+                 );
+      break;
 
     default:
       return RETURN_INVALID_PARAMETER;
   }
+
+  //
+  // The operations above only wrote the shadow frame buffer, if any. The
+  // whole destination rectangle is written to the display at once.
+  //
+  if (!RETURN_ERROR (Status)) {
+    FrameBufferBltLibFlush (Configure, DestinationX, DestinationY, Width, Height);
+  }
+
+  return Status;
 }
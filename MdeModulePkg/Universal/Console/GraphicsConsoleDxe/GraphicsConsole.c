@@ -36,6 +36,7 @@ GRAPHICS_CONSOLE_DEV  mGraphicsConsoleDevTemplate = {
     FALSE
   },
   (GRAPHICS_CONSOLE_MODE_DATA *)NULL,
+  (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)NULL,
   (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)NULL
 };
 
@@ -56,6 +57,12 @@ EFI_HII_FONT_PROTOCOL      *mHiiFont;
 EFI_HII_HANDLE             mHiiHandle;
 VOID                       *mHiiRegistration;
 
+//
+// Glyphs already rendered by the HII Font protocol, shared by all the
+// graphics consoles. Allocated on first use.
+//
+GRAPHICS_CONSOLE_GLYPH  *mGlyphCache = NULL;
+
 EFI_GUID  mFontPackageListGuid = {
   0xf5f219d3, 0x7006, 0x4648, { 0xac, 0x8d, 0xd6, 0x1d, 0xfb, 0x7b, 0xc6, 0xad }
 };
@@ -660,6 +667,10 @@ Error:
       FreePool (Private->LineBuffer);
     }
 
+    if (Private->ShadowBuffer != NULL) {
+      FreePool (Private->ShadowBuffer);
+    }
+
     if (Private->ModeData != NULL) {
       FreePool (Private->ModeData);
     }
@@ -748,6 +759,10 @@ GraphicsConsoleControllerDriverStop (
       FreePool (Private->LineBuffer);
     }
 
+    if (Private->ShadowBuffer != NULL) {
+      FreePool (Private->ShadowBuffer);
+    }
+
     if (Private->ModeData != NULL) {
       FreePool (Private->ModeData);
     }
@@ -1023,7 +1038,30 @@ GraphicsConsoleConOutOutputString (
       // down one row.
       //
       if (This->Mode->CursorRow == (INT32)(MaxRow - 1)) {
-        if (GraphicsOutput != NULL) {
+        if ((GraphicsOutput != NULL) && (Private->ShadowBuffer != NULL)) {
+          //
+          // Scroll the shadow of the text area up one row, print blank line at
+          // last line, and refresh the whole text area from the shadow.
+          //
+          CopyMem (
+            Private->ShadowBuffer,
+            Private->ShadowBuffer + Width * EFI_GLYPH_HEIGHT,
+            Height * Delta
+            );
+          FillShadowBuffer (Private, Width * Height, Width * EFI_GLYPH_HEIGHT, &Background);
+          GraphicsOutput->Blt (
+                            GraphicsOutput,
+                            Private->ShadowBuffer,
+                            EfiBltBufferToVideo,
+                            0,
+                            0,
+                            DeltaX,
+                            DeltaY,
+                            Width,
+                            Height + EFI_GLYPH_HEIGHT,
+                            Delta
+                            );
+        } else if (GraphicsOutput != NULL) {
           //
           // Scroll Screen Up One Row
           //
@@ -1320,6 +1358,7 @@ GraphicsConsoleConOutSetMode (
   GRAPHICS_CONSOLE_DEV           *Private;
   GRAPHICS_CONSOLE_MODE_DATA     *ModeData;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *NewLineBuffer;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *NewShadowBuffer;
   UINT32                         HorizontalResolution;
   UINT32                         VerticalResolution;
   EFI_GRAPHICS_OUTPUT_PROTOCOL   *GraphicsOutput;
@@ -1372,6 +1411,11 @@ GraphicsConsoleConOutSetMode (
     FlushCursor (This);
 
     FreePool (Private->LineBuffer);
+
+    if (Private->ShadowBuffer != NULL) {
+      FreePool (Private->ShadowBuffer);
+      Private->ShadowBuffer = NULL;
+    }
   }
 
   //
@@ -1394,6 +1438,17 @@ GraphicsConsoleConOutSetMode (
   Private->LineBuffer = NewLineBuffer;
 
   if (GraphicsOutput != NULL) {
+    //
+    // Attempt to allocate a shadow of the text area, the display is cleared to black below.
+    // Without it, text is still drawn and scrolled directly on the display.
+    //
+    NewShadowBuffer = AllocateZeroPool (
+                        sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL) *
+                        ModeData->Columns * EFI_GLYPH_WIDTH *
+                        ModeData->Rows * EFI_GLYPH_HEIGHT
+                        );
+    Private->ShadowBuffer = NewShadowBuffer;
+
     if (ModeData->GopModeNumber != GraphicsOutput->Mode->Mode) {
       //
       // Either no graphics mode is currently set, or it is set to the wrong resolution, so set the new graphics mode
@@ -1579,6 +1634,12 @@ GraphicsConsoleConOutClearScreen (
 
   GetTextColors (This, &Foreground, &Background);
   if (GraphicsOutput != NULL) {
+    FillShadowBuffer (
+      Private,
+      0,
+      ModeData->Columns * EFI_GLYPH_WIDTH * ModeData->Rows * EFI_GLYPH_HEIGHT,
+      &Background
+      );
     Status = GraphicsOutput->Blt (
                                GraphicsOutput,
                                &Background,
@@ -1756,6 +1817,216 @@ GetTextColors (
   return EFI_SUCCESS;
 }
 
+/**
+  Fill pixels of the shadow of the text area with a color.
+
+  Nothing is done if the Graphics Console device has no shadow buffer.
+
+  @param  Private               Graphics Console device.
+  @param  Offset                Index of the first pixel to fill.
+  @param  Count                 Number of pixels to fill.
+  @param  Color                 The fill color.
+
+**/
+VOID
+FillShadowBuffer (
+  IN  GRAPHICS_CONSOLE_DEV           *Private,
+  IN  UINTN                          Offset,
+  IN  UINTN                          Count,
+  IN  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Color
+  )
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION  Fill;
+
+  if (Private->ShadowBuffer == NULL) {
+    return;
+  }
+
+  Fill.Pixel = *Color;
+  SetMem32 (Private->ShadowBuffer + Offset, Count * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL), Fill.Raw);
+}
+
+/**
+  Get the bitmap of a narrow character rendered by the HII Font protocol.
+
+  The character is rendered once per text attribute and kept in the glyph
+  cache. Characters that do not render to exactly one narrow cell, such as
+  wide or missing glyphs, are not cached.
+
+  @param  Char                  The character to render.
+  @param  Attribute             The text attribute, without EFI_WIDE_ATTRIBUTE.
+  @param  FontInfo              Font and colors matching Attribute.
+
+  @return The cached glyph, or NULL if the character cannot be cached.
+
+**/
+STATIC
+GRAPHICS_CONSOLE_GLYPH *
+GetRenderedGlyph (
+  IN  CHAR16                 Char,
+  IN  UINT8                  Attribute,
+  IN  EFI_FONT_DISPLAY_INFO  *FontInfo
+  )
+{
+  EFI_STATUS                     Status;
+  GRAPHICS_CONSOLE_GLYPH         *Glyph;
+  CHAR16                         String[2];
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  Bitmap[EFI_GLYPH_HEIGHT][EFI_GLYPH_WIDTH * 2];
+  EFI_IMAGE_OUTPUT               Image;
+  EFI_IMAGE_OUTPUT               *Blt;
+  EFI_HII_ROW_INFO               *RowInfoArray;
+  UINTN                          RowInfoArraySize;
+  BOOLEAN                        Cacheable;
+  UINTN                          Row;
+
+  if (mGlyphCache == NULL) {
+    mGlyphCache = AllocateZeroPool (sizeof (GRAPHICS_CONSOLE_GLYPH) * GRAPHICS_CONSOLE_GLYPH_CACHE_SIZE);
+    if (mGlyphCache == NULL) {
+      return NULL;
+    }
+  }
+
+  Glyph = &mGlyphCache[((UINTN)Char + Attribute * 97) & (GRAPHICS_CONSOLE_GLYPH_CACHE_SIZE - 1)];
+  if (Glyph->Valid && (Glyph->Char == Char) && (Glyph->Attribute == Attribute)) {
+    return Glyph;
+  }
+
+  //
+  // Render the character with the same flags as the direct to screen path, into
+  // a bitmap wider than a narrow glyph so that wider glyphs are not clipped.
+  //
+  String[0]          = Char;
+  String[1]          = L'\0';
+  Image.Width        = EFI_GLYPH_WIDTH * 2;
+  Image.Height       = EFI_GLYPH_HEIGHT;
+  Image.Image.Bitmap = &Bitmap[0][0];
+  Blt                = &Image;
+  RowInfoArray       = NULL;
+  RowInfoArraySize   = 0;
+
+  Status = mHiiFont->StringToImage (
+                       mHiiFont,
+                       EFI_HII_IGNORE_IF_NO_GLYPH | EFI_HII_IGNORE_LINE_BREAK,
+                       String,
+                       FontInfo,
+                       &Blt,
+                       0,
+                       0,
+                       &RowInfoArray,
+                       &RowInfoArraySize,
+                       NULL
+                       );
+  Cacheable = (BOOLEAN)(!EFI_ERROR (Status) && (RowInfoArraySize == 1) &&
+                        (RowInfoArray[0].LineWidth == EFI_GLYPH_WIDTH) &&
+                        (RowInfoArray[0].LineHeight == EFI_GLYPH_HEIGHT));
+  if (RowInfoArray != NULL) {
+    FreePool (RowInfoArray);
+  }
+
+  if (!Cacheable) {
+    return NULL;
+  }
+
+  for (Row = 0; Row < EFI_GLYPH_HEIGHT; Row++) {
+    CopyMem (Glyph->Bitmap[Row], Bitmap[Row], sizeof (Glyph->Bitmap[Row]));
+  }
+
+  Glyph->Char      = Char;
+  Glyph->Attribute = Attribute;
+  Glyph->Valid     = TRUE;
+  return Glyph;
+}
+
+/**
+  Draw Unicode string on the Graphics Console device's screen with the
+  glyphs of the rendered glyph cache.
+
+  The row is composed in the shadow buffer, or in the line buffer if there
+  is no shadow buffer, and sent to the Graphics Output protocol in one Blt.
+
+  @param  This                  Protocol instance pointer.
+  @param  UnicodeWeight         One Unicode string to be displayed.
+  @param  Count                 The count of Unicode string.
+
+  @retval EFI_UNSUPPORTED       The string cannot be drawn from the cache, it is
+                                not drawn, or only partially in the shadow buffer.
+  @retval EFI_SUCCESS           Drawing Unicode string implemented successfully.
+  @retval Others                The Graphics Output protocol Blt failed.
+
+**/
+EFI_STATUS
+DrawCachedGlyphsAtCursorN (
+  IN  EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *This,
+  IN  CHAR16                           *UnicodeWeight,
+  IN  UINTN                            Count
+  )
+{
+  GRAPHICS_CONSOLE_DEV           *Private;
+  GRAPHICS_CONSOLE_MODE_DATA     *ModeData;
+  EFI_FONT_DISPLAY_INFO          FontInfo;
+  GRAPHICS_CONSOLE_GLYPH         *Glyph;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *BltBuffer;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Cell;
+  UINTN                          Stride;
+  UINTN                          SourceX;
+  UINTN                          SourceY;
+  UINTN                          Index;
+  UINTN                          Row;
+  UINT8                          Attribute;
+
+  if ((This->Mode->Attribute & EFI_WIDE_ATTRIBUTE) != 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (Count == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Private   = GRAPHICS_CONSOLE_CON_OUT_DEV_FROM_THIS (This);
+  ModeData  = &Private->ModeData[This->Mode->Mode];
+  Attribute = (UINT8)(This->Mode->Attribute & 0x7F);
+
+  ZeroMem (&FontInfo, sizeof (FontInfo));
+  GetTextColors (This, &FontInfo.ForegroundColor, &FontInfo.BackgroundColor);
+
+  if (Private->ShadowBuffer != NULL) {
+    BltBuffer = Private->ShadowBuffer;
+    Stride    = ModeData->Columns * EFI_GLYPH_WIDTH;
+    SourceX   = This->Mode->CursorColumn * EFI_GLYPH_WIDTH;
+    SourceY   = This->Mode->CursorRow * EFI_GLYPH_HEIGHT;
+  } else {
+    BltBuffer = Private->LineBuffer;
+    Stride    = Count * EFI_GLYPH_WIDTH;
+    SourceX   = 0;
+    SourceY   = 0;
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    Glyph = GetRenderedGlyph (UnicodeWeight[Index], Attribute, &FontInfo);
+    if (Glyph == NULL) {
+      return EFI_UNSUPPORTED;
+    }
+
+    Cell = BltBuffer + SourceY * Stride + SourceX + Index * EFI_GLYPH_WIDTH;
+    for (Row = 0; Row < EFI_GLYPH_HEIGHT; Row++, Cell += Stride) {
+      CopyMem (Cell, Glyph->Bitmap[Row], sizeof (Glyph->Bitmap[Row]));
+    }
+  }
+
+  return Private->GraphicsOutput->Blt (
+                                    Private->GraphicsOutput,
+                                    BltBuffer,
+                                    EfiBltBufferToVideo,
+                                    SourceX,
+                                    SourceY,
+                                    This->Mode->CursorColumn * EFI_GLYPH_WIDTH + ModeData->DeltaX,
+                                    This->Mode->CursorRow * EFI_GLYPH_HEIGHT + ModeData->DeltaY,
+                                    Count * EFI_GLYPH_WIDTH,
+                                    EFI_GLYPH_HEIGHT,
+                                    Stride * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+                                    );
+}
+
 /**
   Draw Unicode string on the Graphics Console device's screen.
 
@@ -1786,7 +2057,18 @@ DrawUnicodeWeightAtCursorN (
   UINTN                  RowInfoArraySize;
 
   Private = GRAPHICS_CONSOLE_CON_OUT_DEV_FROM_THIS (This);
-  Blt     = (EFI_IMAGE_OUTPUT *)AllocateZeroPool (sizeof (EFI_IMAGE_OUTPUT));
+
+  if (Private->GraphicsOutput != NULL) {
+    //
+    // Most strings are made of glyphs already rendered with the same attribute.
+    //
+    Status = DrawCachedGlyphsAtCursorN (This, UnicodeWeight, Count);
+    if (Status != EFI_UNSUPPORTED) {
+      return Status;
+    }
+  }
+
+  Blt = (EFI_IMAGE_OUTPUT *)AllocateZeroPool (sizeof (EFI_IMAGE_OUTPUT));
   if (Blt == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
@@ -1835,6 +2117,24 @@ DrawUnicodeWeightAtCursorN (
                          NULL,
                          NULL
                          );
+
+    if (Private->ShadowBuffer != NULL) {
+      //
+      // Read back what was drawn up to the end of the row into the shadow buffer.
+      //
+      Private->GraphicsOutput->Blt (
+                                 Private->GraphicsOutput,
+                                 Private->ShadowBuffer,
+                                 EfiBltVideoToBltBuffer,
+                                 This->Mode->CursorColumn * EFI_GLYPH_WIDTH + Private->ModeData[This->Mode->Mode].DeltaX,
+                                 This->Mode->CursorRow * EFI_GLYPH_HEIGHT + Private->ModeData[This->Mode->Mode].DeltaY,
+                                 This->Mode->CursorColumn * EFI_GLYPH_WIDTH,
+                                 This->Mode->CursorRow * EFI_GLYPH_HEIGHT,
+                                 (Private->ModeData[This->Mode->Mode].Columns - This->Mode->CursorColumn) * EFI_GLYPH_WIDTH,
+                                 EFI_GLYPH_HEIGHT,
+                                 Private->ModeData[This->Mode->Mode].Columns * EFI_GLYPH_WIDTH * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+                                 );
+    }
   } else if (FeaturePcdGet (PcdUgaConsumeSupport)) {
     //
     // If Graphics Output protocol cannot be found and PcdUgaConsumeSupport enabled,
@@ -1938,6 +2238,8 @@ FlushCursor (
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION  Foreground;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION  Background;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION  BltChar[EFI_GLYPH_HEIGHT][EFI_GLYPH_WIDTH];
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *ShadowCell;
+  UINTN                                Stride;
   UINTN                                PosX;
   UINTN                                PosY;
 
@@ -1959,7 +2261,26 @@ FlushCursor (
   //
   GlyphX = (CurrentMode->CursorColumn * EFI_GLYPH_WIDTH) + Private->ModeData[CurrentMode->Mode].DeltaX;
   GlyphY = (CurrentMode->CursorRow * EFI_GLYPH_HEIGHT) + Private->ModeData[CurrentMode->Mode].DeltaY;
-  if (GraphicsOutput != NULL) {
+
+  //
+  // The cursor may be right after the last column before the line wraps, the
+  // shadow buffer only covers the text area.
+  //
+  ShadowCell = NULL;
+  Stride     = Private->ModeData[CurrentMode->Mode].Columns * EFI_GLYPH_WIDTH;
+  if ((GraphicsOutput != NULL) && (Private->ShadowBuffer != NULL) &&
+      ((UINTN)CurrentMode->CursorColumn < Private->ModeData[CurrentMode->Mode].Columns) &&
+      ((UINTN)CurrentMode->CursorRow < Private->ModeData[CurrentMode->Mode].Rows))
+  {
+    ShadowCell = Private->ShadowBuffer + CurrentMode->CursorRow * EFI_GLYPH_HEIGHT * Stride +
+                 CurrentMode->CursorColumn * EFI_GLYPH_WIDTH;
+  }
+
+  if (ShadowCell != NULL) {
+    for (PosY = 0; PosY < EFI_GLYPH_HEIGHT; PosY++) {
+      CopyMem (BltChar[PosY], ShadowCell + PosY * Stride, sizeof (BltChar[PosY]));
+    }
+  } else if (GraphicsOutput != NULL) {
     GraphicsOutput->Blt (
                       GraphicsOutput,
                       (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)BltChar,
@@ -2000,6 +2321,12 @@ FlushCursor (
     }
   }
 
+  if (ShadowCell != NULL) {
+    for (PosY = 0; PosY < EFI_GLYPH_HEIGHT; PosY++) {
+      CopyMem (ShadowCell + PosY * Stride, BltChar[PosY], sizeof (BltChar[PosY]));
+    }
+  }
+
   if (GraphicsOutput != NULL) {
     GraphicsOutput->Blt (
                       GraphicsOutput,
@@ -41,6 +41,21 @@ typedef union {
   EFI_WIDE_GLYPH      WideGlyph;
 } GLYPH_UNION;
 
+//
+// Number of entries of the rendered glyph cache, must be a power of 2.
+//
+#define GRAPHICS_CONSOLE_GLYPH_CACHE_SIZE  512
+
+//
+// A narrow glyph rendered by the HII Font protocol with a given text attribute.
+//
+typedef struct {
+  CHAR16                           Char;
+  UINT8                            Attribute;
+  BOOLEAN                          Valid;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL    Bitmap[EFI_GLYPH_HEIGHT][EFI_GLYPH_WIDTH];
+} GRAPHICS_CONSOLE_GLYPH;
+
 //
 // Device Structure
 //
@@ -64,6 +79,11 @@ typedef struct {
   EFI_SIMPLE_TEXT_OUTPUT_MODE        SimpleTextOutputMode;
   GRAPHICS_CONSOLE_MODE_DATA         *ModeData;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL      *LineBuffer;
+  //
+  // Copy of the text area of the screen, used to compose rows and to scroll
+  // without reading back from the frame buffer. NULL for UGA Draw.
+  //
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL      *ShadowBuffer;
 } GRAPHICS_CONSOLE_DEV;
 
 #define GRAPHICS_CONSOLE_CON_OUT_DEV_FROM_THIS(a) \
@@ -518,6 +538,49 @@ GetTextColors (
   OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL    *Background
   );
 
+/**
+  Fill pixels of the shadow of the text area with a color.
+
+  Nothing is done if the Graphics Console device has no shadow buffer.
+
+  @param  Private               Graphics Console device.
+  @param  Offset                Index of the first pixel to fill.
+  @param  Count                 Number of pixels to fill.
+  @param  Color                 The fill color.
+
+**/
+VOID
+FillShadowBuffer (
+  IN  GRAPHICS_CONSOLE_DEV           *Private,
+  IN  UINTN                          Offset,
+  IN  UINTN                          Count,
+  IN  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Color
+  );
+
+/**
+  Draw Unicode string on the Graphics Console device's screen with the
+  glyphs of the rendered glyph cache.
+
+  The row is composed in the shadow buffer, or in the line buffer if there
+  is no shadow buffer, and sent to the Graphics Output protocol in one Blt.
+
+  @param  This                  Protocol instance pointer.
+  @param  UnicodeWeight         One Unicode string to be displayed.
+  @param  Count                 The count of Unicode string.
+
+  @retval EFI_UNSUPPORTED       The string cannot be drawn from the cache, it is
+                                not drawn, or only partially in the shadow buffer.
+  @retval EFI_SUCCESS           Drawing Unicode string implemented successfully.
+  @retval Others                The Graphics Output protocol Blt failed.
+
+**/
+EFI_STATUS
+DrawCachedGlyphsAtCursorN (
+  IN  EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *This,
+  IN  CHAR16                           *UnicodeWeight,
+  IN  UINTN                            Count
+  );
+
 /**
   Draw Unicode string on the Graphics Console device's screen.
 
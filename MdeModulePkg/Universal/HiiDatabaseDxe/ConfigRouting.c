@@ -9,6 +9,11 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "HiiDatabase.h"
 extern HII_DATABASE_PRIVATE_DATA  mPrivate;
 
+//
+// <HexAf> digits, <Number> is in lowercase in configuration strings.
+//
+STATIC CONST CHAR16  mConfigHexDigit[] = L"0123456789abcdef";
+
 /**
   Calculate the number of Unicode characters of the incoming Configuration string,
   not including NULL terminator.
@@ -446,6 +451,39 @@ AppendToMultiString (
   return EFI_SUCCESS;
 }
 
+/**
+  Check whether a configuration string continues with a keyword.
+
+  Unlike StrnCmp (), the rest of the string is not walked to check its size,
+  so that parsing the elements of a long string stays linear when ASSERT ()
+  is enabled.
+
+  @param  String                 The current position in the string.
+  @param  Keyword                The Null-terminated keyword, e.g. L"&OFFSET=".
+
+  @retval TRUE                   String starts with Keyword.
+  @retval FALSE                  String does not start with Keyword.
+
+**/
+STATIC
+BOOLEAN
+IsConfigKeyword (
+  IN CONST CHAR16  *String,
+  IN CONST CHAR16  *Keyword
+  )
+{
+  while (*Keyword != L'\0') {
+    if (*String != *Keyword) {
+      return FALSE;
+    }
+
+    String++;
+    Keyword++;
+  }
+
+  return TRUE;
+}
+
 /**
   Get the value of <Number> in <BlockConfig> format, i.e. the value of OFFSET
   or WIDTH or VALUE.
@@ -474,19 +512,15 @@ GetValueOfNumber (
 {
   EFI_STRING  TmpPtr;
   UINTN       Length;
-  EFI_STRING  Str;
   UINT8       *Buf;
-  EFI_STATUS  Status;
   UINT8       DigitUint8;
   UINTN       Index;
-  CHAR16      TemStr[2];
+  CHAR16      Char;
 
   if ((StringPtr == NULL) || (*StringPtr == L'\0') || (Number == NULL) || (Len == NULL)) {
     return EFI_INVALID_PARAMETER;
   }
 
-  Buf = NULL;
-
   TmpPtr = StringPtr;
   while (*StringPtr != L'\0' && *StringPtr != L'&') {
     StringPtr++;
@@ -495,27 +529,29 @@ GetValueOfNumber (
   *Len   = StringPtr - TmpPtr;
   Length = *Len + 1;
 
-  Str = (EFI_STRING)AllocateZeroPool (Length * sizeof (CHAR16));
-  if (Str == NULL) {
-    Status = EFI_OUT_OF_RESOURCES;
-    goto Exit;
-  }
-
-  CopyMem (Str, TmpPtr, *Len * sizeof (CHAR16));
-  *(Str + *Len) = L'\0';
-
   Length = (Length + 1) / 2;
   Buf    = (UINT8 *)AllocateZeroPool (Length);
   if (Buf == NULL) {
-    Status = EFI_OUT_OF_RESOURCES;
-    goto Exit;
+    return EFI_OUT_OF_RESOURCES;
   }
 
+  //
+  // Convert the digits from the last one, which is the least significant.
+  // A character that is not a hex digit counts as 0.
+  //
   Length = *Len;
-  ZeroMem (TemStr, sizeof (TemStr));
   for (Index = 0; Index < Length; Index++) {
-    TemStr[0]  = Str[Length - Index - 1];
-    DigitUint8 = (UINT8)StrHexToUint64 (TemStr);
+    Char = TmpPtr[Length - Index - 1];
+    if ((Char >= L'0') && (Char <= L'9')) {
+      DigitUint8 = (UINT8)(Char - L'0');
+    } else if ((Char >= L'a') && (Char <= L'f')) {
+      DigitUint8 = (UINT8)(Char - L'a' + 10);
+    } else if ((Char >= L'A') && (Char <= L'F')) {
+      DigitUint8 = (UINT8)(Char - L'A' + 10);
+    } else {
+      DigitUint8 = 0;
+    }
+
     if ((Index & 1) == 0) {
       Buf[Index/2] = DigitUint8;
     } else {
@@ -524,14 +560,7 @@ GetValueOfNumber (
   }
 
   *Number = Buf;
-  Status  = EFI_SUCCESS;
-
-Exit:
-  if (Str != NULL) {
-    FreePool (Str);
-  }
-
-  return Status;
+  return EFI_SUCCESS;
 }
 
 /**
@@ -1784,6 +1813,282 @@ GetFormPackageData (
   return Status;
 }
 
+/**
+  Free a cached default configuration.
+
+  @param  CacheEntry              The cache entry, not in any list.
+
+**/
+STATIC
+VOID
+FreeConfigDefaultCacheEntry (
+  IN HII_CONFIG_DEFAULT_CACHE  *CacheEntry
+  )
+{
+  if (CacheEntry->Request != NULL) {
+    FreePool (CacheEntry->Request);
+  }
+
+  if (CacheEntry->FullRequest != NULL) {
+    FreePool (CacheEntry->FullRequest);
+  }
+
+  if (CacheEntry->AltCfgResp != NULL) {
+    FreePool (CacheEntry->AltCfgResp);
+  }
+
+  if (CacheEntry->PlatformLang != NULL) {
+    FreePool (CacheEntry->PlatformLang);
+  }
+
+  if (CacheEntry->DevicePath != NULL) {
+    FreePool (CacheEntry->DevicePath);
+  }
+
+  FreePool (CacheEntry);
+}
+
+/**
+  Free the default configurations cached for a package list. This must be
+  called whenever the strings of the package list are changed, since default
+  string values and the names of name/value varstores are read from them.
+
+  @param  PackageList             Pointer to a package list.
+
+**/
+VOID
+InvalidateConfigDefaultCache (
+  IN OUT HII_DATABASE_PACKAGE_LIST_INSTANCE  *PackageList
+  )
+{
+  HII_CONFIG_DEFAULT_CACHE  *CacheEntry;
+
+  while (!IsListEmpty (&PackageList->ConfigDefaultCache)) {
+    CacheEntry = CR (
+                   PackageList->ConfigDefaultCache.ForwardLink,
+                   HII_CONFIG_DEFAULT_CACHE,
+                   Entry,
+                   HII_CONFIG_DEFAULT_CACHE_SIGNATURE
+                   );
+    RemoveEntryList (&CacheEntry->Entry);
+    FreeConfigDefaultCacheEntry (CacheEntry);
+  }
+
+  PackageList->ConfigDefaultCacheCount = 0;
+}
+
+/**
+  Free the varstores and the default configurations cached for a package
+  list. This must be called whenever the form packages of the package list
+  are changed.
+
+  @param  PackageList             Pointer to a package list.
+
+**/
+VOID
+InvalidateVarStoreCache (
+  IN OUT HII_DATABASE_PACKAGE_LIST_INSTANCE  *PackageList
+  )
+{
+  HII_VARSTORE_CACHE  *VarStore;
+
+  while (!IsListEmpty (&PackageList->VarStoreCache)) {
+    VarStore = CR (
+                 PackageList->VarStoreCache.ForwardLink,
+                 HII_VARSTORE_CACHE,
+                 Entry,
+                 HII_VARSTORE_CACHE_SIGNATURE
+                 );
+    RemoveEntryList (&VarStore->Entry);
+    FreePool (VarStore->ConfigHdr);
+    if (VarStore->EfiVarStore != NULL) {
+      FreePool (VarStore->EfiVarStore);
+    }
+
+    FreePool (VarStore);
+  }
+
+  PackageList->VarStoreCacheValid = FALSE;
+
+  InvalidateConfigDefaultCache (PackageList);
+}
+
+/**
+  Add a varstore opcode to the varstore cache of a package list.
+
+  @param  PackageList           Pointer to the package list.
+  @param  IfrOpHdr              The varstore opcode.
+  @param  Guid                  The GUID of the varstore.
+  @param  AsciiName             The name of the varstore, NULL for a name/value
+                                varstore.
+  @param  BeforeFirstForm       Whether the varstore is declared before the
+                                first form of the package list.
+
+  @retval EFI_SUCCESS           The varstore is added.
+  @retval EFI_OUT_OF_RESOURCES  Not enough memory for the cache entry.
+
+**/
+STATIC
+EFI_STATUS
+AddVarStoreCache (
+  IN OUT HII_DATABASE_PACKAGE_LIST_INSTANCE  *PackageList,
+  IN     EFI_IFR_OP_HEADER                   *IfrOpHdr,
+  IN     EFI_GUID                            *Guid,
+  IN     CHAR8                               *AsciiName OPTIONAL,
+  IN     BOOLEAN                             BeforeFirstForm
+  )
+{
+  HII_VARSTORE_CACHE  *VarStore;
+  CHAR16              *VarStoreName;
+  UINTN               NameSize;
+  EFI_STRING          GuidStr;
+  EFI_STRING          NameStr;
+  UINTN               LengthString;
+
+  VarStore = AllocateZeroPool (sizeof (HII_VARSTORE_CACHE));
+  if (VarStore == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  NameSize     = (AsciiName == NULL) ? 1 : AsciiStrSize (AsciiName);
+  VarStoreName = AllocateZeroPool (NameSize * sizeof (CHAR16));
+  if (VarStoreName == NULL) {
+    FreePool (VarStore);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (AsciiName != NULL) {
+    AsciiStrToUnicodeStrS (AsciiName, VarStoreName, NameSize);
+  }
+
+  //
+  // Same "GUID=...&NAME=...&" header as IsThisVarstore () matches. A name/value
+  // varstore has no name, its <ConfigHdr> has an empty NAME.
+  //
+  GenerateSubStr (L"GUID=", sizeof (EFI_GUID), (VOID *)Guid, 1, &GuidStr);
+  GenerateSubStr (L"NAME=", StrLen (VarStoreName) * sizeof (CHAR16), (VOID *)VarStoreName, 2, &NameStr);
+  FreePool (VarStoreName);
+
+  LengthString        = StrLen (GuidStr) + StrLen (NameStr) + 1;
+  VarStore->ConfigHdr = AllocatePool (LengthString * sizeof (CHAR16));
+  if (VarStore->ConfigHdr == NULL) {
+    FreePool (GuidStr);
+    FreePool (NameStr);
+    FreePool (VarStore);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  StrCpyS (VarStore->ConfigHdr, LengthString, GuidStr);
+  StrCatS (VarStore->ConfigHdr, LengthString, NameStr);
+  FreePool (GuidStr);
+  FreePool (NameStr);
+
+  if (IfrOpHdr->OpCode == EFI_IFR_VARSTORE_EFI_OP) {
+    VarStore->EfiVarStore = AllocateCopyPool (IfrOpHdr->Length, IfrOpHdr);
+    if (VarStore->EfiVarStore == NULL) {
+      FreePool (VarStore->ConfigHdr);
+      FreePool (VarStore);
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  VarStore->Signature       = HII_VARSTORE_CACHE_SIGNATURE;
+  VarStore->OpCode          = IfrOpHdr->OpCode;
+  VarStore->BeforeFirstForm = BeforeFirstForm;
+  InsertTailList (&PackageList->VarStoreCache, &VarStore->Entry);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Build the varstore cache of a package list from its form packages if it is
+  not built yet. The cache lists the varstores in the order they are declared.
+
+  @param  PackageList           Pointer to the package list.
+
+  @retval EFI_SUCCESS           The varstore cache is valid.
+  @retval EFI_OUT_OF_RESOURCES  Not enough memory to build the cache.
+
+**/
+STATIC
+EFI_STATUS
+BuildVarStoreCache (
+  IN OUT HII_DATABASE_PACKAGE_LIST_INSTANCE  *PackageList
+  )
+{
+  EFI_STATUS                   Status;
+  LIST_ENTRY                   *Link;
+  HII_IFR_PACKAGE_INSTANCE     *FormPackage;
+  UINTN                        IfrOffset;
+  UINTN                        IfrLength;
+  EFI_IFR_OP_HEADER            *IfrOpHdr;
+  EFI_IFR_VARSTORE             *IfrVarStore;
+  EFI_IFR_VARSTORE_EFI         *IfrEfiVarStore;
+  EFI_IFR_VARSTORE_NAME_VALUE  *IfrNameValueVarStore;
+  BOOLEAN                      BeforeFirstForm;
+
+  if (PackageList->VarStoreCacheValid) {
+    return EFI_SUCCESS;
+  }
+
+  Status          = EFI_SUCCESS;
+  BeforeFirstForm = TRUE;
+
+  for (Link = PackageList->FormPkgHdr.ForwardLink; Link != &PackageList->FormPkgHdr; Link = Link->ForwardLink) {
+    FormPackage = CR (Link, HII_IFR_PACKAGE_INSTANCE, IfrEntry, HII_IFR_PACKAGE_SIGNATURE);
+    IfrLength   = FormPackage->FormPkgHdr.Length - sizeof (EFI_HII_PACKAGE_HEADER);
+
+    for (IfrOffset = 0; IfrOffset < IfrLength; IfrOffset += IfrOpHdr->Length) {
+      IfrOpHdr = (EFI_IFR_OP_HEADER *)(FormPackage->IfrData + IfrOffset);
+      if (IfrOpHdr->Length == 0) {
+        break;
+      }
+
+      switch (IfrOpHdr->OpCode) {
+        case EFI_IFR_VARSTORE_OP:
+          IfrVarStore = (EFI_IFR_VARSTORE *)IfrOpHdr;
+          Status      = AddVarStoreCache (PackageList, IfrOpHdr, &IfrVarStore->Guid, (CHAR8 *)IfrVarStore->Name, BeforeFirstForm);
+          break;
+
+        case EFI_IFR_VARSTORE_EFI_OP:
+          //
+          // If the length is small than the structure, this is from old efi
+          // varstore definition, which has no name. Old efi varstore get
+          // config directly from GetVariable function.
+          //
+          if (IfrOpHdr->Length < sizeof (EFI_IFR_VARSTORE_EFI)) {
+            break;
+          }
+
+          IfrEfiVarStore = (EFI_IFR_VARSTORE_EFI *)IfrOpHdr;
+          Status         = AddVarStoreCache (PackageList, IfrOpHdr, &IfrEfiVarStore->Guid, (CHAR8 *)IfrEfiVarStore->Name, BeforeFirstForm);
+          break;
+
+        case EFI_IFR_VARSTORE_NAME_VALUE_OP:
+          IfrNameValueVarStore = (EFI_IFR_VARSTORE_NAME_VALUE *)IfrOpHdr;
+          Status               = AddVarStoreCache (PackageList, IfrOpHdr, &IfrNameValueVarStore->Guid, NULL, BeforeFirstForm);
+          break;
+
+        case EFI_IFR_FORM_OP:
+        case EFI_IFR_FORM_MAP_OP:
+          BeforeFirstForm = FALSE;
+          break;
+
+        default:
+          break;
+      }
+
+      if (EFI_ERROR (Status)) {
+        InvalidateVarStoreCache (PackageList);
+        return Status;
+      }
+    }
+  }
+
+  PackageList->VarStoreCacheValid = TRUE;
+  return EFI_SUCCESS;
+}
+
 /**
   This function parses Form Package to get the efi varstore info according to the request ConfigHdr.
 
@@ -1801,128 +2106,38 @@ GetVarStoreType (
   OUT    EFI_IFR_VARSTORE_EFI  **EfiVarStore
   )
 {
-  EFI_STATUS              Status;
-  UINTN                   IfrOffset;
-  UINTN                   PackageOffset;
-  EFI_IFR_OP_HEADER       *IfrOpHdr;
-  CHAR16                  *VarStoreName;
-  UINTN                   NameSize;
-  EFI_STRING              GuidStr;
-  EFI_STRING              NameStr;
-  EFI_STRING              TempStr;
-  UINTN                   LengthString;
-  UINT8                   *HiiFormPackage;
-  UINTN                   PackageSize;
-  EFI_IFR_VARSTORE_EFI    *IfrEfiVarStore;
-  EFI_HII_PACKAGE_HEADER  *PackageHeader;
-
-  HiiFormPackage = NULL;
-  LengthString   = 0;
-  Status         = EFI_SUCCESS;
-  GuidStr        = NULL;
-  NameStr        = NULL;
-  TempStr        = NULL;
+  EFI_STATUS          Status;
+  LIST_ENTRY          *Link;
+  HII_VARSTORE_CACHE  *VarStore;
+
   *IsEfiVarstore = FALSE;
 
-  Status = GetFormPackageData (DataBaseRecord, &HiiFormPackage, &PackageSize);
+  Status = BuildVarStoreCache (DataBaseRecord->PackageList);
   if (EFI_ERROR (Status)) {
     return Status;
   }
 
-  IfrOffset     = sizeof (EFI_HII_PACKAGE_HEADER);
-  PackageOffset = IfrOffset;
-  PackageHeader = (EFI_HII_PACKAGE_HEADER *)HiiFormPackage;
-
-  while (IfrOffset < PackageSize) {
-    //
-    // More than one form packages exist.
-    //
-    if (PackageOffset >= PackageHeader->Length) {
-      //
-      // Process the new form package.
-      //
-      PackageOffset = sizeof (EFI_HII_PACKAGE_HEADER);
-      IfrOffset    += PackageOffset;
-      PackageHeader = (EFI_HII_PACKAGE_HEADER *)(HiiFormPackage + IfrOffset);
+  for (Link = DataBaseRecord->PackageList->VarStoreCache.ForwardLink;
+       Link != &DataBaseRecord->PackageList->VarStoreCache;
+       Link = Link->ForwardLink)
+  {
+    VarStore = CR (Link, HII_VARSTORE_CACHE, Entry, HII_VARSTORE_CACHE_SIGNATURE);
+    if (VarStore->EfiVarStore == NULL) {
+      continue;
     }
 
-    IfrOpHdr       = (EFI_IFR_OP_HEADER *)(HiiFormPackage + IfrOffset);
-    IfrOffset     += IfrOpHdr->Length;
-    PackageOffset += IfrOpHdr->Length;
-
-    if (IfrOpHdr->OpCode == EFI_IFR_VARSTORE_EFI_OP ) {
-      IfrEfiVarStore = (EFI_IFR_VARSTORE_EFI *)IfrOpHdr;
-      //
-      // If the length is small than the structure, this is from old efi
-      // varstore definition. Old efi varstore get config directly from
-      // GetVariable function.
-      //
-      if (IfrOpHdr->Length < sizeof (EFI_IFR_VARSTORE_EFI)) {
-        continue;
-      }
-
-      NameSize     = AsciiStrSize ((CHAR8 *)IfrEfiVarStore->Name);
-      VarStoreName = AllocateZeroPool (NameSize * sizeof (CHAR16));
-      if (VarStoreName == NULL) {
-        Status = EFI_OUT_OF_RESOURCES;
-        goto Done;
-      }
-
-      AsciiStrToUnicodeStrS ((CHAR8 *)IfrEfiVarStore->Name, VarStoreName, NameSize);
-
-      GenerateSubStr (L"GUID=", sizeof (EFI_GUID), (VOID *)&IfrEfiVarStore->Guid, 1, &GuidStr);
-      GenerateSubStr (L"NAME=", StrLen (VarStoreName) * sizeof (CHAR16), (VOID *)VarStoreName, 2, &NameStr);
-      LengthString = StrLen (GuidStr);
-      LengthString = LengthString + StrLen (NameStr) + 1;
-      TempStr      = AllocateZeroPool (LengthString * sizeof (CHAR16));
-      if (TempStr == NULL) {
-        FreePool (GuidStr);
-        FreePool (NameStr);
-        FreePool (VarStoreName);
-        Status = EFI_OUT_OF_RESOURCES;
-        goto Done;
+    if ((ConfigHdr == NULL) || (StrnCmp (ConfigHdr, VarStore->ConfigHdr, StrLen (VarStore->ConfigHdr)) == 0)) {
+      *EfiVarStore = AllocateCopyPool (VarStore->EfiVarStore->Header.Length, VarStore->EfiVarStore);
+      if (*EfiVarStore == NULL) {
+        return EFI_OUT_OF_RESOURCES;
       }
 
-      StrCpyS (TempStr, LengthString, GuidStr);
-      StrCatS (TempStr, LengthString, NameStr);
-      if ((ConfigHdr == NULL) || (StrnCmp (ConfigHdr, TempStr, StrLen (TempStr)) == 0)) {
-        *EfiVarStore = (EFI_IFR_VARSTORE_EFI *)AllocateZeroPool (IfrOpHdr->Length);
-        if (*EfiVarStore == NULL) {
-          FreePool (VarStoreName);
-          FreePool (GuidStr);
-          FreePool (NameStr);
-          FreePool (TempStr);
-          Status = EFI_OUT_OF_RESOURCES;
-          goto Done;
-        }
-
-        *IsEfiVarstore = TRUE;
-        CopyMem (*EfiVarStore, IfrEfiVarStore, IfrOpHdr->Length);
-      }
-
-      //
-      // Free allocated temp string.
-      //
-      FreePool (VarStoreName);
-      FreePool (GuidStr);
-      FreePool (NameStr);
-      FreePool (TempStr);
-
-      //
-      // Already found the varstore, break;
-      //
-      if (*IsEfiVarstore) {
-        break;
-      }
+      *IsEfiVarstore = TRUE;
+      break;
     }
   }
 
-Done:
-  if (HiiFormPackage != NULL) {
-    FreePool (HiiFormPackage);
-  }
-
-  return Status;
+  return EFI_SUCCESS;
 }
 
 /**
@@ -2040,125 +2255,31 @@ IsThisPackageList (
   IN     EFI_STRING           ConfigHdr
   )
 {
-  EFI_STATUS                   Status;
-  UINTN                        IfrOffset;
-  UINTN                        PackageOffset;
-  EFI_IFR_OP_HEADER            *IfrOpHdr;
-  CHAR16                       *VarStoreName;
-  UINTN                        NameSize;
-  UINT8                        *HiiFormPackage;
-  UINTN                        PackageSize;
-  EFI_IFR_VARSTORE_EFI         *IfrEfiVarStore;
-  EFI_HII_PACKAGE_HEADER       *PackageHeader;
-  EFI_IFR_VARSTORE             *IfrVarStore;
-  EFI_IFR_VARSTORE_NAME_VALUE  *IfrNameValueVarStore;
-  BOOLEAN                      FindVarstore;
-
-  HiiFormPackage = NULL;
-  VarStoreName   = NULL;
-  Status         = EFI_SUCCESS;
-  FindVarstore   = FALSE;
+  LIST_ENTRY          *Link;
+  HII_VARSTORE_CACHE  *VarStore;
 
-  Status = GetFormPackageData (DataBaseRecord, &HiiFormPackage, &PackageSize);
-  if (EFI_ERROR (Status)) {
+  if (EFI_ERROR (BuildVarStoreCache (DataBaseRecord->PackageList))) {
     return FALSE;
   }
 
-  IfrOffset     = sizeof (EFI_HII_PACKAGE_HEADER);
-  PackageOffset = IfrOffset;
-  PackageHeader = (EFI_HII_PACKAGE_HEADER *)HiiFormPackage;
-
-  while (IfrOffset < PackageSize) {
+  for (Link = DataBaseRecord->PackageList->VarStoreCache.ForwardLink;
+       Link != &DataBaseRecord->PackageList->VarStoreCache;
+       Link = Link->ForwardLink)
+  {
+    VarStore = CR (Link, HII_VARSTORE_CACHE, Entry, HII_VARSTORE_CACHE_SIGNATURE);
     //
-    // More than one form packages exist.
+    // Only the varstores declared before the first form are checked.
     //
-    if (PackageOffset >= PackageHeader->Length) {
-      //
-      // Process the new form package.
-      //
-      PackageOffset = sizeof (EFI_HII_PACKAGE_HEADER);
-      IfrOffset    += PackageOffset;
-      PackageHeader = (EFI_HII_PACKAGE_HEADER *)(HiiFormPackage + IfrOffset);
+    if (!VarStore->BeforeFirstForm) {
+      break;
     }
 
-    IfrOpHdr       = (EFI_IFR_OP_HEADER *)(HiiFormPackage + IfrOffset);
-    IfrOffset     += IfrOpHdr->Length;
-    PackageOffset += IfrOpHdr->Length;
-
-    switch (IfrOpHdr->OpCode) {
-      case EFI_IFR_VARSTORE_OP:
-        IfrVarStore = (EFI_IFR_VARSTORE *)IfrOpHdr;
-
-        NameSize     = AsciiStrSize ((CHAR8 *)IfrVarStore->Name);
-        VarStoreName = AllocateZeroPool (NameSize * sizeof (CHAR16));
-        if (VarStoreName == NULL) {
-          goto Done;
-        }
-
-        AsciiStrToUnicodeStrS ((CHAR8 *)IfrVarStore->Name, VarStoreName, NameSize);
-
-        if (IsThisVarstore ((VOID *)&IfrVarStore->Guid, VarStoreName, ConfigHdr)) {
-          FindVarstore = TRUE;
-          goto Done;
-        } else {
-          FreePool (VarStoreName);
-          VarStoreName = NULL;
-        }
-
-        break;
-
-      case EFI_IFR_VARSTORE_EFI_OP:
-        IfrEfiVarStore = (EFI_IFR_VARSTORE_EFI *)IfrOpHdr;
-        NameSize       = AsciiStrSize ((CHAR8 *)IfrEfiVarStore->Name);
-        VarStoreName   = AllocateZeroPool (NameSize * sizeof (CHAR16));
-        if (VarStoreName == NULL) {
-          goto Done;
-        }
-
-        AsciiStrToUnicodeStrS ((CHAR8 *)IfrEfiVarStore->Name, VarStoreName, NameSize);
-
-        if (IsThisVarstore (&IfrEfiVarStore->Guid, VarStoreName, ConfigHdr)) {
-          FindVarstore = TRUE;
-          goto Done;
-        } else {
-          FreePool (VarStoreName);
-          VarStoreName = NULL;
-        }
-
-        break;
-
-      case EFI_IFR_VARSTORE_NAME_VALUE_OP:
-        IfrNameValueVarStore = (EFI_IFR_VARSTORE_NAME_VALUE *)IfrOpHdr;
-
-        if (IsThisVarstore (&IfrNameValueVarStore->Guid, NULL, ConfigHdr)) {
-          FindVarstore = TRUE;
-          goto Done;
-        }
-
-        break;
-
-      case EFI_IFR_FORM_OP:
-      case EFI_IFR_FORM_MAP_OP:
-        //
-        // No matched varstore is found and directly return.
-        //
-        goto Done;
-
-      default:
-        break;
+    if ((ConfigHdr == NULL) || (StrnCmp (ConfigHdr, VarStore->ConfigHdr, StrLen (VarStore->ConfigHdr)) == 0)) {
+      return TRUE;
     }
   }
 
-Done:
-  if (HiiFormPackage != NULL) {
-    FreePool (HiiFormPackage);
-  }
-
-  if (VarStoreName != NULL) {
-    FreePool (VarStoreName);
-  }
-
-  return FindVarstore;
+  return FALSE;
 }
 
 /**
@@ -3439,7 +3560,7 @@ GetBlockElement (
   // <BlockName> ::= &'OFFSET='<Number>&'WIDTH='<Number>
   //
   StringPtr = ConfigRequest;
-  while (*StringPtr != 0 && StrnCmp (StringPtr, L"&OFFSET=", StrLen (L"&OFFSET=")) == 0) {
+  while (*StringPtr != 0 && IsConfigKeyword (StringPtr, L"&OFFSET=")) {
     //
     // Skip the OFFSET string
     //
@@ -3462,7 +3583,7 @@ GetBlockElement (
     FreePool (TmpBuffer);
 
     StringPtr += Length;
-    if (StrnCmp (StringPtr, L"&WIDTH=", StrLen (L"&WIDTH=")) != 0) {
+    if (!IsConfigKeyword (StringPtr, L"&WIDTH=")) {
       goto Done;
     }
 
@@ -3504,7 +3625,7 @@ GetBlockElement (
     //
     // Skip &VALUE string if &VALUE does exists.
     //
-    if (StrnCmp (StringPtr, L"&VALUE=", StrLen (L"&VALUE=")) == 0) {
+    if (IsConfigKeyword (StringPtr, L"&VALUE=")) {
       StringPtr += StrLen (L"&VALUE=");
 
       //
@@ -4635,6 +4756,201 @@ Done:
   return Status;
 }
 
+/**
+  This function gets the full request string and full default value string by
+  parsing IFR data in HII form packages, like GetFullStringFromHiiFormPackages ().
+  The result is cached in the package list, so that requesting the same
+  <ConfigRequest> for the same device path again, as a form browser does each
+  time a form is opened, does not parse the IFR data again.
+
+  @param  DataBaseRecord         The DataBaseRecord instance contains the found Hii handle and package.
+  @param  DevicePath             Device Path which Hii Config Access Protocol is registered.
+  @param  Request                Pointer to a null-terminated Unicode string in
+                                 <ConfigRequest> format. When it doesn't contain
+                                 any RequestElement, it will be updated to return
+                                 the full RequestElement retrieved from IFR data.
+  @param  AltCfgResp             Pointer to a null-terminated Unicode string in
+                                 <ConfigAltResp> format. It must point to NULL on
+                                 input, it returns the default value string.
+  @param  PointerProgress        Optional parameter, it can be NULL.
+                                 When it is not NULL, if Request is NULL, it returns NULL.
+                                 On return, points to a character in the Request
+                                 string. Points to the string's null terminator if
+                                 request was successful. Points to the most recent
+                                 & before the first failing name / value pair (or
+                                 the beginning of the string if the failure is in
+                                 the first name / value pair) if the request was
+                                 not successful.
+  @retval EFI_SUCCESS            The Results string is set to the full request string.
+                                 And AltCfgResp contains all default value string.
+  @retval EFI_OUT_OF_RESOURCES   Not enough memory for the return string.
+  @retval EFI_NOT_FOUND          The varstore (Guid and Name) in Request string
+                                 can't be found in Form package.
+  @retval EFI_NOT_FOUND          HiiPackage can't be got on the input HiiHandle.
+  @retval EFI_INVALID_PARAMETER  Request points to NULL.
+
+**/
+EFI_STATUS
+GetCachedFullStringFromHiiFormPackages (
+  IN     HII_DATABASE_RECORD       *DataBaseRecord,
+  IN     EFI_DEVICE_PATH_PROTOCOL  *DevicePath,
+  IN OUT EFI_STRING                *Request,
+  IN OUT EFI_STRING                *AltCfgResp,
+  OUT    EFI_STRING                *PointerProgress OPTIONAL
+  )
+{
+  EFI_STATUS                          Status;
+  HII_DATABASE_PACKAGE_LIST_INSTANCE  *PackageList;
+  HII_CONFIG_DEFAULT_CACHE            *CacheEntry;
+  HII_CONFIG_DEFAULT_CACHE            *OldEntry;
+  LIST_ENTRY                          *Link;
+  CHAR8                               *PlatformLang;
+  EFI_STRING                          FullRequest;
+  UINTN                               DevicePathSize;
+
+  if ((DataBaseRecord == NULL) || (Request == NULL) || (*Request == NULL) || (AltCfgResp == NULL) || (*AltCfgResp != NULL)) {
+    return GetFullStringFromHiiFormPackages (DataBaseRecord, DevicePath, Request, AltCfgResp, PointerProgress);
+  }
+
+  PackageList    = DataBaseRecord->PackageList;
+  DevicePathSize = (DevicePath == NULL) ? 0 : GetDevicePathSize (DevicePath);
+
+  //
+  // Default strings are read in the platform language.
+  //
+  PlatformLang = NULL;
+  GetEfiGlobalVariable2 (L"PlatformLang", (VOID **)&PlatformLang, NULL);
+
+  for (Link = PackageList->ConfigDefaultCache.ForwardLink; Link != &PackageList->ConfigDefaultCache; Link = Link->ForwardLink) {
+    CacheEntry = CR (Link, HII_CONFIG_DEFAULT_CACHE, Entry, HII_CONFIG_DEFAULT_CACHE_SIGNATURE);
+    if (StrCmp (CacheEntry->Request, *Request) != 0) {
+      continue;
+    }
+
+    //
+    // The <ConfigHdr> generated for a request without elements holds the
+    // device path of the driver, so drivers that share a package list and a
+    // varstore GUID and name get results of their own.
+    //
+    if ((CacheEntry->DevicePathSize != DevicePathSize) ||
+        ((DevicePathSize != 0) && (CompareMem (CacheEntry->DevicePath, DevicePath, DevicePathSize) != 0)))
+    {
+      continue;
+    }
+
+    if ((CacheEntry->PlatformLang == NULL) != (PlatformLang == NULL)) {
+      continue;
+    }
+
+    if ((PlatformLang != NULL) && (AsciiStrCmp (CacheEntry->PlatformLang, PlatformLang) != 0)) {
+      continue;
+    }
+
+    Status = EFI_SUCCESS;
+    if (CacheEntry->AltCfgResp != NULL) {
+      *AltCfgResp = AllocateCopyPool (StrSize (CacheEntry->AltCfgResp), CacheEntry->AltCfgResp);
+      if (*AltCfgResp == NULL) {
+        Status = EFI_OUT_OF_RESOURCES;
+      }
+    }
+
+    if (!EFI_ERROR (Status) && (CacheEntry->FullRequest != NULL)) {
+      FullRequest = AllocateCopyPool (StrSize (CacheEntry->FullRequest), CacheEntry->FullRequest);
+      if (FullRequest == NULL) {
+        Status = EFI_OUT_OF_RESOURCES;
+        if (*AltCfgResp != NULL) {
+          FreePool (*AltCfgResp);
+          *AltCfgResp = NULL;
+        }
+      } else {
+        FreePool (*Request);
+        *Request = FullRequest;
+      }
+    }
+
+    if (!EFI_ERROR (Status)) {
+      //
+      // Keep the most recently used entries at the head.
+      //
+      RemoveEntryList (&CacheEntry->Entry);
+      InsertHeadList (&PackageList->ConfigDefaultCache, &CacheEntry->Entry);
+    }
+
+    if (PointerProgress != NULL) {
+      *PointerProgress = EFI_ERROR (Status) ? *Request : *Request + StrLen (*Request);
+    }
+
+    if (PlatformLang != NULL) {
+      FreePool (PlatformLang);
+    }
+
+    return Status;
+  }
+
+  CacheEntry = AllocateZeroPool (sizeof (HII_CONFIG_DEFAULT_CACHE));
+  if (CacheEntry != NULL) {
+    CacheEntry->Request = AllocateCopyPool (StrSize (*Request), *Request);
+    if (DevicePathSize != 0) {
+      CacheEntry->DevicePath     = AllocateCopyPool (DevicePathSize, DevicePath);
+      CacheEntry->DevicePathSize = DevicePathSize;
+    }
+  }
+
+  Status = GetFullStringFromHiiFormPackages (DataBaseRecord, DevicePath, Request, AltCfgResp, PointerProgress);
+
+  //
+  // Parsing the IFR data may add strings, which invalidates the cache. Add the
+  // entry afterwards.
+  //
+  if (EFI_ERROR (Status) || (CacheEntry == NULL) || (CacheEntry->Request == NULL) ||
+      ((DevicePathSize != 0) && (CacheEntry->DevicePath == NULL)))
+  {
+    goto Done;
+  }
+
+  if (StrCmp (CacheEntry->Request, *Request) != 0) {
+    CacheEntry->FullRequest = AllocateCopyPool (StrSize (*Request), *Request);
+    if (CacheEntry->FullRequest == NULL) {
+      goto Done;
+    }
+  }
+
+  if (*AltCfgResp != NULL) {
+    CacheEntry->AltCfgResp = AllocateCopyPool (StrSize (*AltCfgResp), *AltCfgResp);
+    if (CacheEntry->AltCfgResp == NULL) {
+      goto Done;
+    }
+  }
+
+  if (PackageList->ConfigDefaultCacheCount == HII_CONFIG_DEFAULT_CACHE_MAX) {
+    //
+    // Drop the least recently used entry.
+    //
+    OldEntry = CR (PackageList->ConfigDefaultCache.BackLink, HII_CONFIG_DEFAULT_CACHE, Entry, HII_CONFIG_DEFAULT_CACHE_SIGNATURE);
+    RemoveEntryList (&OldEntry->Entry);
+    FreeConfigDefaultCacheEntry (OldEntry);
+    PackageList->ConfigDefaultCacheCount--;
+  }
+
+  CacheEntry->Signature    = HII_CONFIG_DEFAULT_CACHE_SIGNATURE;
+  CacheEntry->PlatformLang = PlatformLang;
+  PlatformLang             = NULL;
+  InsertHeadList (&PackageList->ConfigDefaultCache, &CacheEntry->Entry);
+  PackageList->ConfigDefaultCacheCount++;
+  CacheEntry = NULL;
+
+Done:
+  if (CacheEntry != NULL) {
+    FreeConfigDefaultCacheEntry (CacheEntry);
+  }
+
+  if (PlatformLang != NULL) {
+    FreePool (PlatformLang);
+  }
+
+  return Status;
+}
+
 /**
   This function gets the full request resp string by
   parsing IFR data in HII form packages.
@@ -4826,11 +5142,11 @@ OffsetWidthValidate (
 
   while (1) {
     RetVal = StringPtr;
-    if (StrnCmp (StringPtr, L"&OFFSET=", StrLen (L"&OFFSET=")) != 0) {
+    if (!IsConfigKeyword (StringPtr, L"&OFFSET=")) {
       return RetVal;
     }
 
-    while (*StringPtr != L'\0' && StrnCmp (StringPtr, L"&WIDTH=", StrLen (L"&WIDTH=")) != 0) {
+    while (*StringPtr != L'\0' && !IsConfigKeyword (StringPtr, L"&WIDTH=")) {
       StringPtr++;
     }
 
@@ -4839,7 +5155,7 @@ OffsetWidthValidate (
     }
 
     StringPtr += StrLen (L"&WIDTH=");
-    while (*StringPtr != L'\0' && StrnCmp (StringPtr, L"&OFFSET=", StrLen (L"&OFFSET=")) != 0) {
+    while (*StringPtr != L'\0' && !IsConfigKeyword (StringPtr, L"&OFFSET=")) {
       StringPtr++;
     }
 
@@ -5172,7 +5488,7 @@ HiiConfigRoutingExtractConfig (
       // Get the full request string from IFR when HiiPackage is registered to HiiHandle
       //
       IfrDataParsedFlag = TRUE;
-      Status            = GetFullStringFromHiiFormPackages (Database, DevicePath, &ConfigRequest, &DefaultResults, &AccessProgress);
+      Status            = GetCachedFullStringFromHiiFormPackages (Database, DevicePath, &ConfigRequest, &DefaultResults, &AccessProgress);
       if (EFI_ERROR (Status)) {
         //
         // AccessProgress indicates the parsing progress on <ConfigRequest>.
@@ -5304,7 +5620,7 @@ HiiConfigRoutingExtractConfig (
     // Update AccessResults by getting default setting from IFR when HiiPackage is registered to HiiHandle
     //
     if (!IfrDataParsedFlag && (HiiHandle != NULL)) {
-      Status = GetFullStringFromHiiFormPackages (Database, DevicePath, &ConfigRequest, &DefaultResults, NULL);
+      Status = GetCachedFullStringFromHiiFormPackages (Database, DevicePath, &ConfigRequest, &DefaultResults, NULL);
       ASSERT_EFI_ERROR (Status);
     }
 
@@ -5796,6 +6112,57 @@ HiiConfigRoutingRouteConfig (
   return EFI_SUCCESS;
 }
 
+/**
+  Make sure the buffer of a configuration string that is built in place has
+  room to append characters. The buffer grows to at least twice its size, so
+  that building a long string one element at a time takes linear time.
+
+  @param  String                 On input, the buffer of the string. On output,
+                                 the buffer, reallocated if it was too small.
+  @param  BufferSize             On input, the size of the buffer in bytes. On
+                                 output, the new size if it was reallocated.
+  @param  Length                 The length of the string, in characters.
+  @param  AppendLength           The number of characters to append.
+
+  @retval EFI_SUCCESS            The buffer has room for Length + AppendLength
+                                 characters and a Null-terminator.
+  @retval EFI_OUT_OF_RESOURCES   The buffer could not be reallocated, the string
+                                 is freed and String is set to NULL.
+
+**/
+STATIC
+EFI_STATUS
+GrowConfigString (
+  IN OUT EFI_STRING  *String,
+  IN OUT UINTN       *BufferSize,
+  IN     UINTN       Length,
+  IN     UINTN       AppendLength
+  )
+{
+  UINTN       NewSize;
+  EFI_STRING  NewString;
+
+  NewSize = (Length + AppendLength + 1) * sizeof (CHAR16);
+  if (NewSize <= *BufferSize) {
+    return EFI_SUCCESS;
+  }
+
+  NewSize = MAX (NewSize, *BufferSize * 2);
+  //
+  // ReallocatePool() keeps the old buffer when it fails.
+  //
+  NewString = ReallocatePool (*BufferSize, NewSize, *String);
+  if (NewString == NULL) {
+    FreePool (*String);
+    *String = NULL;
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *String     = NewString;
+  *BufferSize = NewSize;
+  return EFI_SUCCESS;
+}
+
 /**
   This helper function is to be called by drivers to map configuration data
   stored in byte array ("block") formats such as UEFI Variables into current
@@ -5850,12 +6217,11 @@ HiiBlockToConfig (
   UINT8                      *TmpBuffer;
   UINTN                      Offset;
   UINTN                      Width;
-  UINT8                      *Value;
-  EFI_STRING                 ValueStr;
-  EFI_STRING                 ConfigElement;
   UINTN                      Index;
-  UINT8                      *TemBuffer;
-  CHAR16                     *TemString;
+  UINTN                      ConfigSize;
+  UINTN                      ConfigLength;
+  UINTN                      ElementLength;
+  CHAR16                     *ConfigPtr;
 
   TmpBuffer = NULL;
 
@@ -5871,16 +6237,14 @@ HiiBlockToConfig (
   Private = CONFIG_ROUTING_DATABASE_PRIVATE_DATA_FROM_THIS (This);
   ASSERT (Private != NULL);
 
-  StringPtr     = ConfigRequest;
-  ValueStr      = NULL;
-  Value         = NULL;
-  ConfigElement = NULL;
+  StringPtr = ConfigRequest;
 
   //
   // Allocate a fix length of memory to store Results. Reallocate memory for
   // Results if this fix length is insufficient.
   //
-  *Config = (EFI_STRING)AllocateZeroPool (MAX_STRING_LENGTH);
+  ConfigSize = MAX_STRING_LENGTH;
+  *Config    = (EFI_STRING)AllocateZeroPool (ConfigSize);
   if (*Config == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
@@ -5894,7 +6258,7 @@ HiiBlockToConfig (
     goto Exit;
   }
 
-  while (*StringPtr != 0 && StrnCmp (StringPtr, L"PATH=", StrLen (L"PATH=")) != 0) {
+  while (*StringPtr != 0 && !IsConfigKeyword (StringPtr, L"PATH=")) {
     StringPtr++;
   }
 
@@ -5923,23 +6287,24 @@ HiiBlockToConfig (
   StringPtr++;
 
   //
-  // Copy <ConfigHdr> and an additional '&' to <ConfigResp>
+  // Copy <ConfigHdr> and an additional '&' to <ConfigResp>. The <ConfigResp>
+  // is built in place, its length is tracked in ConfigLength.
   //
-  TemString = AllocateCopyPool (sizeof (CHAR16) * (StringPtr - ConfigRequest + 1), ConfigRequest);
-  if (TemString == NULL) {
-    return EFI_OUT_OF_RESOURCES;
+  ConfigLength = StringPtr - ConfigRequest;
+  Status       = GrowConfigString (Config, &ConfigSize, 0, ConfigLength);
+  if (EFI_ERROR (Status)) {
+    *Progress = ConfigRequest;
+    goto Exit;
   }
 
-  TemString[StringPtr - ConfigRequest] = '\0';
-  AppendToMultiString (Config, TemString);
-  FreePool (TemString);
+  CopyMem (*Config, ConfigRequest, ConfigLength * sizeof (CHAR16));
 
   //
   // Parse each <RequestElement> if exists
   // Only <BlockName> format is supported by this help function.
   // <BlockName> ::= 'OFFSET='<Number>&'WIDTH='<Number>
   //
-  while (*StringPtr != 0 && StrnCmp (StringPtr, L"OFFSET=", StrLen (L"OFFSET=")) == 0) {
+  while (*StringPtr != 0 && IsConfigKeyword (StringPtr, L"OFFSET=")) {
     //
     // Back up the header of one <BlockName>
     //
@@ -5964,7 +6329,7 @@ HiiBlockToConfig (
     FreePool (TmpBuffer);
 
     StringPtr += Length;
-    if (StrnCmp (StringPtr, L"&WIDTH=", StrLen (L"&WIDTH=")) != 0) {
+    if (!IsConfigKeyword (StringPtr, L"&WIDTH=")) {
       *Progress = TmpPtr - 1;
       Status    = EFI_INVALID_PARAMETER;
       goto Exit;
@@ -6005,64 +6370,34 @@ HiiBlockToConfig (
       goto Exit;
     }
 
-    Value = (UINT8 *)AllocateZeroPool (Width);
-    if (Value == NULL) {
+    //
+    // Build a ConfigElement: the <BlockName>, "&VALUE=", the value and the
+    // '&' that separates it from the next one.
+    //
+    ElementLength = StringPtr - TmpPtr;
+    Status        = GrowConfigString (Config, &ConfigSize, ConfigLength, ElementLength + StrLen (L"&VALUE=") + Width * 2 + 1);
+    if (EFI_ERROR (Status)) {
       *Progress = ConfigRequest;
-      Status    = EFI_OUT_OF_RESOURCES;
       goto Exit;
     }
 
-    CopyMem (Value, (UINT8 *)Block + Offset, Width);
-
-    Length   = Width * 2 + 1;
-    ValueStr = (EFI_STRING)AllocateZeroPool (Length  * sizeof (CHAR16));
-    if (ValueStr == NULL) {
-      *Progress = ConfigRequest;
-      Status    = EFI_OUT_OF_RESOURCES;
-      goto Exit;
-    }
-
-    TemString = ValueStr;
-    TemBuffer = Value + Width - 1;
-    for (Index = 0; Index < Width; Index++, TemBuffer--) {
-      UnicodeValueToStringS (
-        TemString,
-        Length  * sizeof (CHAR16) - ((UINTN)TemString - (UINTN)ValueStr),
-        PREFIX_ZERO | RADIX_HEX,
-        *TemBuffer,
-        2
-        );
-      TemString += StrnLenS (TemString, Length - ((UINTN)TemString - (UINTN)ValueStr) / sizeof (CHAR16));
-    }
-
-    FreePool (Value);
-    Value = NULL;
+    ConfigPtr = *Config + ConfigLength;
+    CopyMem (ConfigPtr, TmpPtr, ElementLength * sizeof (CHAR16));
+    ConfigPtr += ElementLength;
+    CopyMem (ConfigPtr, L"&VALUE=", StrLen (L"&VALUE=") * sizeof (CHAR16));
+    ConfigPtr += StrLen (L"&VALUE=");
 
     //
-    // Build a ConfigElement
+    // Convert Value to a hex string in "%x" format, most significant byte
+    // first.
+    // NOTE: This is in the opposite byte that GUID and PATH use
     //
-    Length       += StringPtr - TmpPtr + 1 + StrLen (L"VALUE=");
-    ConfigElement = (EFI_STRING)AllocateZeroPool (Length * sizeof (CHAR16));
-    if (ConfigElement == NULL) {
-      Status = EFI_OUT_OF_RESOURCES;
-      goto Exit;
+    for (Index = Offset + Width; Index > Offset; Index--) {
+      *(ConfigPtr++) = mConfigHexDigit[Block[Index - 1] >> 4];
+      *(ConfigPtr++) = mConfigHexDigit[Block[Index - 1] & 0x0F];
     }
 
-    CopyMem (ConfigElement, TmpPtr, (StringPtr - TmpPtr + 1) * sizeof (CHAR16));
-    if (*StringPtr == 0) {
-      *(ConfigElement + (StringPtr - TmpPtr)) = L'&';
-    }
-
-    *(ConfigElement + (StringPtr - TmpPtr) + 1) = 0;
-    StrCatS (ConfigElement, Length, L"VALUE=");
-    StrCatS (ConfigElement, Length, ValueStr);
-
-    AppendToMultiString (Config, ConfigElement);
-
-    FreePool (ConfigElement);
-    FreePool (ValueStr);
-    ConfigElement = NULL;
-    ValueStr      = NULL;
+    ConfigLength = ConfigPtr - *Config;
 
     //
     // If '\0', parsing is finished. Otherwise skip '&' to continue
@@ -6071,10 +6406,12 @@ HiiBlockToConfig (
       break;
     }
 
-    AppendToMultiString (Config, L"&");
+    (*Config)[ConfigLength++] = L'&';
     StringPtr++;
   }
 
+  (*Config)[ConfigLength] = L'\0';
+
   if (*StringPtr != 0) {
     *Progress = StringPtr - 1;
     Status    = EFI_INVALID_PARAMETER;
@@ -6091,18 +6428,6 @@ Exit:
     *Config = NULL;
   }
 
-  if (ValueStr != NULL) {
-    FreePool (ValueStr);
-  }
-
-  if (Value != NULL) {
-    FreePool (Value);
-  }
-
-  if (ConfigElement != NULL) {
-    FreePool (ConfigElement);
-  }
-
   return Status;
 }
 
@@ -6203,7 +6528,7 @@ HiiConfigToBlock (
     goto Exit;
   }
 
-  while (*StringPtr != 0 && StrnCmp (StringPtr, L"PATH=", StrLen (L"PATH=")) != 0) {
+  while (*StringPtr != 0 && !IsConfigKeyword (StringPtr, L"PATH=")) {
     StringPtr++;
   }
 
@@ -6228,7 +6553,7 @@ HiiConfigToBlock (
   // Only '&'<BlockConfig> format is supported by this help function.
   // <BlockConfig> ::= 'OFFSET='<Number>&'WIDTH='<Number>&'VALUE='<Number>
   //
-  while (*StringPtr != 0 && StrnCmp (StringPtr, L"&OFFSET=", StrLen (L"&OFFSET=")) == 0) {
+  while (*StringPtr != 0 && IsConfigKeyword (StringPtr, L"&OFFSET=")) {
     TmpPtr     = StringPtr;
     StringPtr += StrLen (L"&OFFSET=");
     //
@@ -6249,7 +6574,7 @@ HiiConfigToBlock (
     FreePool (TmpBuffer);
 
     StringPtr += Length;
-    if (StrnCmp (StringPtr, L"&WIDTH=", StrLen (L"&WIDTH=")) != 0) {
+    if (!IsConfigKeyword (StringPtr, L"&WIDTH=")) {
       *Progress = TmpPtr;
       Status    = EFI_INVALID_PARAMETER;
       goto Exit;
@@ -6275,7 +6600,7 @@ HiiConfigToBlock (
     FreePool (TmpBuffer);
 
     StringPtr += Length;
-    if (StrnCmp (StringPtr, L"&VALUE=", StrLen (L"&VALUE=")) != 0) {
+    if (!IsConfigKeyword (StringPtr, L"&VALUE=")) {
       *Progress = TmpPtr;
       Status    = EFI_INVALID_PARAMETER;
       goto Exit;
@@ -73,6 +73,8 @@ GenerateHiiDatabaseRecord (
   InitializeListHead (&PackageList->StringPkgHdr);
   InitializeListHead (&PackageList->FontPkgHdr);
   InitializeListHead (&PackageList->SimpleFontPkgHdr);
+  InitializeListHead (&PackageList->VarStoreCache);
+  InitializeListHead (&PackageList->ConfigDefaultCache);
   PackageList->ImagePkg      = NULL;
   PackageList->DevicePathPkg = NULL;
 
@@ -1251,6 +1253,8 @@ InsertFormPackage (
   //
   UpdateDefaultSettingInFormPackage (FormPackage);
 
+  InvalidateVarStoreCache (PackageList);
+
   if (NotifyType == EFI_HII_DATABASE_NOTIFY_ADD_PACK) {
     PackageList->PackageListHdr.PackageLength += FormPackage->FormPkgHdr.Length;
   }
@@ -1366,6 +1370,8 @@ RemoveFormPackages (
 
   ListHead = &PackageList->FormPkgHdr;
 
+  InvalidateVarStoreCache (PackageList);
+
   while (!IsListEmpty (ListHead)) {
     Package = CR (
                 ListHead->ForwardLink,
@@ -1525,6 +1531,8 @@ InsertStringPackage (
   InsertTailList (&PackageList->StringPkgHdr, &StringPackage->StringEntry);
   *Package = StringPackage;
 
+  InvalidateConfigDefaultCache (PackageList);
+
   if (NotifyType == EFI_HII_DATABASE_NOTIFY_ADD_PACK) {
     PackageList->PackageListHdr.PackageLength += StringPackage->StringPkgHdr->Header.Length;
   }
@@ -1618,6 +1626,7 @@ AdjustStringPackage (
       // Append a EFI_HII_SIBT_END block to the end.
       //
       *BlockPtr = EFI_HII_SIBT_END;
+      InvalidateStringIdIndex (StringPackage);
       FreePool (StringPackage->StringBlock);
       StringPackage->StringBlock                  = StringBlock;
       StringPackage->StringPkgHdr->Header.Length += Skip2BlockSize;
@@ -1738,6 +1747,8 @@ RemoveStringPackages (
 
   ListHead = &PackageList->StringPkgHdr;
 
+  InvalidateConfigDefaultCache (PackageList);
+
   while (!IsListEmpty (ListHead)) {
     Package = CR (
                 ListHead->ForwardLink,
@@ -1758,6 +1769,7 @@ RemoveStringPackages (
 
     RemoveEntryList (&Package->StringEntry);
     PackageList->PackageListHdr.PackageLength -= Package->StringPkgHdr->Header.Length;
+    InvalidateStringIdIndex (Package);
     FreePool (Package->StringBlock);
     FreePool (Package->StringPkgHdr);
     //
@@ -0,0 +1,642 @@
+/** @file
+  Unit tests of the varstore and default configuration caches
+  of the HII Config Routing protocol.
+
+  A package list with a buffer varstore of several thousand questions, each
+  with a default value, is registered the way a large platform setup formset
+  is. A driver producing the HII Config Access protocol on top of
+  BlockToConfig () and ConfigToBlock () holds the varstore. The form browser
+  flow of opening a form (ExtractConfig) and saving it (RouteConfig) is run
+  against the caches.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+extern "C" {
+  #include <Uefi.h>
+  #include <Library/BaseLib.h>
+  #include <Library/BaseMemoryLib.h>
+  #include <Library/MemoryAllocationLib.h>
+  #include <Library/DevicePathLib.h>
+  #include <Library/UefiBootServicesTableLib.h>
+  #include "../HiiDatabase.h"
+}
+
+////////////////////////////////////////////////////////////////////////
+// Symbol Definitions
+// These are not directly under test - but required to link ConfigRouting.c
+////////////////////////////////////////////////////////////////////////
+extern "C" {
+  HII_DATABASE_PRIVATE_DATA  mPrivate;
+  EFI_RUNTIME_SERVICES       *gRT = NULL;
+
+  EFI_STATUS
+  ExportFormPackages (
+    IN HII_DATABASE_PRIVATE_DATA           *Private,
+    IN EFI_HII_HANDLE                      Handle,
+    IN HII_DATABASE_PACKAGE_LIST_INSTANCE  *PackageList,
+    IN UINTN                               UsedSize,
+    IN UINTN                               BufferSize,
+    IN OUT VOID                            *Buffer,
+    IN OUT UINTN                           *ResultSize
+    )
+  {
+    LIST_ENTRY                *Link;
+    HII_IFR_PACKAGE_INSTANCE  *FormPackage;
+    UINTN                     PackageLength;
+
+    PackageLength = 0;
+    for (Link = PackageList->FormPkgHdr.ForwardLink; Link != &PackageList->FormPkgHdr; Link = Link->ForwardLink) {
+      FormPackage    = CR (Link, HII_IFR_PACKAGE_INSTANCE, IfrEntry, HII_IFR_PACKAGE_SIGNATURE);
+      PackageLength += FormPackage->FormPkgHdr.Length;
+      if ((Buffer != NULL) && (PackageLength + *ResultSize + UsedSize <= BufferSize)) {
+        CopyMem (Buffer, &FormPackage->FormPkgHdr, sizeof (EFI_HII_PACKAGE_HEADER));
+        Buffer = (UINT8 *)Buffer + sizeof (EFI_HII_PACKAGE_HEADER);
+        CopyMem (Buffer, FormPackage->IfrData, FormPackage->FormPkgHdr.Length - sizeof (EFI_HII_PACKAGE_HEADER));
+        Buffer = (UINT8 *)Buffer + FormPackage->FormPkgHdr.Length - sizeof (EFI_HII_PACKAGE_HEADER);
+      }
+    }
+
+    *ResultSize += PackageLength;
+    return EFI_SUCCESS;
+  }
+
+  EFI_STATUS
+  FindQuestionDefaultSetting (
+    IN  UINT16                   DefaultId,
+    IN  EFI_IFR_VARSTORE_EFI     *EfiVarStore,
+    IN  EFI_IFR_QUESTION_HEADER  *IfrQuestionHdr,
+    OUT VOID                     *ValueBuffer,
+    IN  UINTN                    Width,
+    IN  BOOLEAN                  BitFieldQuestion
+    )
+  {
+    return EFI_NOT_FOUND;
+  }
+
+  EFI_STATUS
+  EFIAPI
+  GetEfiGlobalVariable2 (
+    IN CONST CHAR16  *Name,
+    OUT VOID         **Value,
+    OUT UINTN        *Size OPTIONAL
+    )
+  {
+    *Value = NULL;
+    return EFI_NOT_FOUND;
+  }
+
+  CHAR8 *
+  EFIAPI
+  GetBestLanguage (
+    IN CONST CHAR8  *SupportedLanguages,
+    IN UINTN        Iso639Language,
+    ...
+    )
+  {
+    return NULL;
+  }
+
+  EFI_STATUS
+  GetCachedFullStringFromHiiFormPackages (
+    IN     HII_DATABASE_RECORD       *DataBaseRecord,
+    IN     EFI_DEVICE_PATH_PROTOCOL  *DevicePath,
+    IN OUT EFI_STRING                *Request,
+    IN OUT EFI_STRING                *AltCfgResp,
+    OUT    EFI_STRING                *PointerProgress OPTIONAL
+    );
+}
+
+#define VARSTORE_ID  1
+
+STATIC EFI_GUID  mFormSetGuid = {
+  0x5e2f9c7a, 0x3b1d, 0x4c8e, { 0x9a, 0x61, 0x0d, 0x4b, 0x7e, 0x22, 0xf3, 0x58 }
+};
+
+STATIC EFI_HII_CONFIG_ACCESS_PROTOCOL  mConfigAccess;
+STATIC std::vector<UINT8>              mVarStore;
+STATIC EFI_HANDLE                      mDriverHandle = (EFI_HANDLE)&mConfigAccess;
+STATIC EFI_HANDLE_PROTOCOL             mHandleProtocol;
+
+//
+// HII Config Access protocol of the driver owning the varstore.
+//
+STATIC
+EFI_STATUS
+EFIAPI
+TestExtractConfig (
+  IN CONST  EFI_HII_CONFIG_ACCESS_PROTOCOL  *This,
+  IN CONST  EFI_STRING                      Request,
+  OUT EFI_STRING                            *Progress,
+  OUT EFI_STRING                            *Results
+  )
+{
+  return HiiBlockToConfig (&mPrivate.ConfigRouting, Request, mVarStore.data (), mVarStore.size (), Results, Progress);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+TestRouteConfig (
+  IN CONST  EFI_HII_CONFIG_ACCESS_PROTOCOL  *This,
+  IN CONST  EFI_STRING                      Configuration,
+  OUT EFI_STRING                            *Progress
+  )
+{
+  UINTN  BlockSize;
+
+  BlockSize = mVarStore.size ();
+  return HiiConfigToBlock (&mPrivate.ConfigRouting, Configuration, mVarStore.data (), &BlockSize, Progress);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+TestHandleProtocol (
+  IN  EFI_HANDLE  UserHandle,
+  IN  EFI_GUID    *Protocol,
+  OUT VOID        **Interface
+  )
+{
+  if ((UserHandle == mDriverHandle) && CompareGuid (Protocol, &gEfiHiiConfigAccessProtocolGuid)) {
+    *Interface = &mConfigAccess;
+    return EFI_SUCCESS;
+  }
+
+  return EFI_UNSUPPORTED;
+}
+
+class HiiConfigRoutingTest : public ::testing::Test {
+protected:
+  HII_DATABASE_RECORD                 Record;
+  HII_DATABASE_PACKAGE_LIST_INSTANCE  PackageList;
+  HII_IFR_PACKAGE_INSTANCE            FormPackage;
+  std::vector<UINT8>                  Ifr;
+  std::vector<UINT8>                  DevicePathPkg;
+  std::vector<UINT16>                 DefaultOffset;
+  std::u16string                      ConfigHdr;
+  UINTN                               QuestionCount;
+
+  void
+  SetUp (
+    ) override
+  {
+    ZeroMem (&mPrivate, sizeof (mPrivate));
+    mPrivate.Signature                   = HII_DATABASE_PRIVATE_DATA_SIGNATURE;
+    mPrivate.ConfigRouting.ExtractConfig = HiiConfigRoutingExtractConfig;
+    mPrivate.ConfigRouting.RouteConfig   = HiiConfigRoutingRouteConfig;
+    mPrivate.ConfigRouting.BlockToConfig = HiiBlockToConfig;
+    mPrivate.ConfigRouting.ConfigToBlock = HiiConfigToBlock;
+    InitializeListHead (&mPrivate.DatabaseList);
+
+    mConfigAccess.ExtractConfig = TestExtractConfig;
+    mConfigAccess.RouteConfig   = TestRouteConfig;
+    mHandleProtocol             = gBS->HandleProtocol;
+    gBS->HandleProtocol         = TestHandleProtocol;
+
+    ZeroMem (&PackageList, sizeof (PackageList));
+    InitializeListHead (&PackageList.GuidPkgHdr);
+    InitializeListHead (&PackageList.FormPkgHdr);
+    InitializeListHead (&PackageList.KeyboardLayoutHdr);
+    InitializeListHead (&PackageList.StringPkgHdr);
+    InitializeListHead (&PackageList.FontPkgHdr);
+    InitializeListHead (&PackageList.SimpleFontPkgHdr);
+    InitializeListHead (&PackageList.VarStoreCache);
+    InitializeListHead (&PackageList.ConfigDefaultCache);
+
+    Record.Signature    = HII_DATABASE_RECORD_SIGNATURE;
+    Record.PackageList  = &PackageList;
+    Record.DriverHandle = mDriverHandle;
+    Record.Handle       = (EFI_HII_HANDLE)&Record;
+    InsertTailList (&mPrivate.DatabaseList, &Record.DatabaseEntry);
+
+    BuildDevicePathPackage ();
+    BuildFormPackage (4000);
+  }
+
+  void
+  TearDown (
+    ) override
+  {
+    InvalidateVarStoreCache (&PackageList);
+    gBS->HandleProtocol = mHandleProtocol;
+  }
+
+  VOID
+  Append (
+    CONST VOID  *Data,
+    UINTN       Size
+    )
+  {
+    Ifr.insert (Ifr.end (), (CONST UINT8 *)Data, (CONST UINT8 *)Data + Size);
+  }
+
+  VOID
+  AppendEnd (
+    VOID
+    )
+  {
+    EFI_IFR_END  End;
+
+    End.Header.OpCode = EFI_IFR_END_OP;
+    End.Header.Length = sizeof (End);
+    End.Header.Scope  = 0;
+    Append (&End, sizeof (End));
+  }
+
+  //
+  // A vendor hardware device path, the <ConfigHdr> of the varstore is built
+  // from it.
+  //
+  VOID
+  BuildDevicePathPackage (
+    VOID
+    )
+  {
+    EFI_HII_PACKAGE_HEADER    Header;
+    VENDOR_DEVICE_PATH        Vendor;
+    EFI_DEVICE_PATH_PROTOCOL  End;
+    EFI_STRING                GuidStr;
+    EFI_STRING                NameStr;
+    EFI_STRING                PathStr;
+    CHAR16                    *Name;
+    std::vector<UINT8>        DevicePath;
+
+    Name                  = (CHAR16 *)u"Setup";
+    Vendor.Header.Type    = HARDWARE_DEVICE_PATH;
+    Vendor.Header.SubType = HW_VENDOR_DP;
+    SetDevicePathNodeLength (&Vendor.Header, sizeof (Vendor));
+    CopyGuid (&Vendor.Guid, &mFormSetGuid);
+    End.Type    = END_DEVICE_PATH_TYPE;
+    End.SubType = END_ENTIRE_DEVICE_PATH_SUBTYPE;
+    SetDevicePathNodeLength (&End, sizeof (End));
+    DevicePath.insert (DevicePath.end (), (UINT8 *)&Vendor, (UINT8 *)&Vendor + sizeof (Vendor));
+    DevicePath.insert (DevicePath.end (), (UINT8 *)&End, (UINT8 *)&End + sizeof (End));
+
+    Header.Type   = EFI_HII_PACKAGE_DEVICE_PATH;
+    Header.Length = (UINT32)(sizeof (Header) + DevicePath.size ());
+    DevicePathPkg.assign ((UINT8 *)&Header, (UINT8 *)&Header + sizeof (Header));
+    DevicePathPkg.insert (DevicePathPkg.end (), DevicePath.begin (), DevicePath.end ());
+    PackageList.DevicePathPkg = DevicePathPkg.data ();
+
+    GenerateSubStr ((CONST EFI_STRING)u"GUID=", sizeof (EFI_GUID), &mFormSetGuid, 1, &GuidStr);
+    GenerateSubStr ((CONST EFI_STRING)u"NAME=", StrLen (Name) * sizeof (CHAR16), Name, 2, &NameStr);
+    GenerateSubStr ((CONST EFI_STRING)u"PATH=", DevicePath.size (), DevicePath.data (), 1, &PathStr);
+    ConfigHdr  = (char16_t *)GuidStr;
+    ConfigHdr += (char16_t *)NameStr;
+    ConfigHdr += (char16_t *)PathStr;
+    ConfigHdr.pop_back ();
+    FreePool (GuidStr);
+    FreePool (NameStr);
+    FreePool (PathStr);
+  }
+
+  //
+  // A formset with a buffer varstore and Count numeric questions of 1, 2, 4
+  // and 8 bytes, each with a standard default value.
+  //
+  VOID
+  BuildFormPackage (
+    UINTN  Count
+    )
+  {
+    EFI_IFR_FORM_SET      FormSet;
+    EFI_IFR_DEFAULTSTORE  DefaultStore;
+    EFI_IFR_VARSTORE      VarStore;
+    EFI_IFR_FORM          Form;
+    EFI_IFR_NUMERIC       Numeric;
+    EFI_IFR_DEFAULT       Default;
+    UINTN                 Index;
+    UINT16                Offset;
+    UINT8                 SizeFlag;
+
+    Ifr.clear ();
+    DefaultOffset.clear ();
+    QuestionCount = Count;
+
+    ZeroMem (&FormSet, sizeof (FormSet));
+    FormSet.Header.OpCode = EFI_IFR_FORM_SET_OP;
+    FormSet.Header.Length = sizeof (FormSet);
+    FormSet.Header.Scope  = 1;
+    CopyGuid (&FormSet.Guid, &mFormSetGuid);
+    Append (&FormSet, sizeof (FormSet));
+
+    ZeroMem (&DefaultStore, sizeof (DefaultStore));
+    DefaultStore.Header.OpCode = EFI_IFR_DEFAULTSTORE_OP;
+    DefaultStore.Header.Length = sizeof (DefaultStore);
+    DefaultStore.DefaultId     = EFI_HII_DEFAULT_CLASS_STANDARD;
+    Append (&DefaultStore, sizeof (DefaultStore));
+
+    //
+    // Questions use offsets up to Count * 4, the varstore is larger.
+    //
+    ZeroMem (&VarStore, sizeof (VarStore));
+    VarStore.Header.OpCode = EFI_IFR_VARSTORE_OP;
+    VarStore.Header.Length = sizeof (VarStore) + sizeof ("Setup") - 1;
+    VarStore.VarStoreId    = VARSTORE_ID;
+    VarStore.Size          = (UINT16)(Count * 4 + 8);
+    CopyGuid (&VarStore.Guid, &mFormSetGuid);
+    Append (&VarStore, OFFSET_OF (EFI_IFR_VARSTORE, Name));
+    Append ("Setup", sizeof ("Setup"));
+    mVarStore.assign (VarStore.Size, 0);
+
+    ZeroMem (&Form, sizeof (Form));
+    Form.Header.OpCode = EFI_IFR_FORM_OP;
+    Form.Header.Length = sizeof (Form);
+    Form.Header.Scope  = 1;
+    Form.FormId        = 1;
+    Append (&Form, sizeof (Form));
+
+    for (Index = 0, Offset = 0; Index < Count; Index++) {
+      SizeFlag = (UINT8)(Index % 4);
+      Offset   = (UINT16)ALIGN_VALUE (Offset, 1 << SizeFlag);
+
+      ZeroMem (&Numeric, sizeof (Numeric));
+      Numeric.Header.OpCode                   = EFI_IFR_NUMERIC_OP;
+      Numeric.Header.Length                   = sizeof (Numeric);
+      Numeric.Header.Scope                    = 1;
+      Numeric.Question.QuestionId             = (EFI_QUESTION_ID)(Index + 1);
+      Numeric.Question.VarStoreId             = VARSTORE_ID;
+      Numeric.Question.VarStoreInfo.VarOffset = Offset;
+      Numeric.Flags                           = SizeFlag;
+      Numeric.data.u64.MaxValue               = MAX_UINT8;
+      Append (&Numeric, sizeof (Numeric));
+
+      ZeroMem (&Default, sizeof (Default));
+      Default.Header.OpCode = EFI_IFR_DEFAULT_OP;
+      Default.Header.Length = (UINT8)(OFFSET_OF (EFI_IFR_DEFAULT, Value) + (1 << SizeFlag));
+      Default.DefaultId     = EFI_HII_DEFAULT_CLASS_STANDARD;
+      Default.Type          = SizeFlag;
+      Default.Value.u8      = (UINT8)(Index * 7 + 1);
+      Append (&Default, Default.Header.Length);
+      AppendEnd ();
+
+      DefaultOffset.push_back ((UINT16)(Ifr.size () - sizeof (EFI_IFR_END) - Default.Header.Length));
+      Offset = (UINT16)(Offset + (1 << SizeFlag));
+    }
+
+    AppendEnd ();
+    AppendEnd ();
+
+    FormPackage.Signature         = HII_IFR_PACKAGE_SIGNATURE;
+    FormPackage.FormPkgHdr.Type   = EFI_HII_PACKAGE_FORMS;
+    FormPackage.FormPkgHdr.Length = (UINT32)(sizeof (EFI_HII_PACKAGE_HEADER) + Ifr.size ());
+    FormPackage.IfrData           = Ifr.data ();
+    if (IsListEmpty (&PackageList.FormPkgHdr)) {
+      InsertTailList (&PackageList.FormPkgHdr, &FormPackage.IfrEntry);
+    }
+
+    InvalidateVarStoreCache (&PackageList);
+  }
+
+  //
+  // <ConfigRequest> of the questions of one form of a form browser.
+  //
+  std::u16string
+  FormRequest (
+    UINTN  First,
+    UINTN  Count
+    )
+  {
+    std::u16string  Request;
+    char            Element[32];
+    UINTN           Index;
+    UINT16          Offset;
+    UINT8           SizeFlag;
+
+    Request = ConfigHdr;
+    for (Index = 0, Offset = 0; Index < First + Count; Index++) {
+      SizeFlag = (UINT8)(Index % 4);
+      Offset   = (UINT16)ALIGN_VALUE (Offset, 1 << SizeFlag);
+      if (Index >= First) {
+        snprintf (Element, sizeof (Element), "&OFFSET=%04x&WIDTH=%04x", Offset, 1 << SizeFlag);
+        Request.append (Element, Element + strlen (Element));
+      }
+
+      Offset = (UINT16)(Offset + (1 << SizeFlag));
+    }
+
+    return Request;
+  }
+
+  std::u16string
+  Extract (
+    CONST std::u16string  &Request
+    )
+  {
+    EFI_STRING      Progress;
+    EFI_STRING      Results;
+    std::u16string  Copy;
+    std::u16string  String;
+
+    Copy = Request;
+    EXPECT_EQ (
+      mPrivate.ConfigRouting.ExtractConfig (&mPrivate.ConfigRouting, (EFI_STRING)Copy.c_str (), &Progress, &Results),
+      EFI_SUCCESS
+      );
+    if (Results == NULL) {
+      return u"";
+    }
+
+    String = (char16_t *)Results;
+    FreePool (Results);
+    return String;
+  }
+
+  VOID
+  Route (
+    CONST std::u16string  &Configuration
+    )
+  {
+    EFI_STRING      Progress;
+    std::u16string  Copy;
+
+    Copy = Configuration;
+    EXPECT_EQ (
+      mPrivate.ConfigRouting.RouteConfig (&mPrivate.ConfigRouting, (EFI_STRING)Copy.c_str (), &Progress),
+      EFI_SUCCESS
+      );
+    EXPECT_EQ (*Progress, 0);
+  }
+
+  //
+  // The current settings of a <MultiConfigAltResp>, without the defaults.
+  //
+  static std::u16string
+  CurrentSettings (
+    CONST std::u16string  &Results
+    )
+  {
+    return Results.substr (0, Results.find (u"&GUID="));
+  }
+};
+
+TEST_F (HiiConfigRoutingTest, BlockToConfigRoundTrip) {
+  std::u16string  Request;
+  EFI_STRING      Config;
+  EFI_STRING      Result;
+  EFI_STRING      Progress;
+  UINTN           Index;
+  UINTN           BlockSize;
+  char            Value[32];
+
+  for (Index = 0; Index < mVarStore.size (); Index++) {
+    mVarStore[Index] = (UINT8)(Index * 37 + 11);
+  }
+
+  Request = FormRequest (0, QuestionCount);
+  ASSERT_EQ (HiiBlockToConfig (&mPrivate.ConfigRouting, (EFI_STRING)Request.c_str (), mVarStore.data (), mVarStore.size (), &Config, &Progress), EFI_SUCCESS);
+  EXPECT_EQ (*Progress, 0);
+
+  //
+  // Values are in lowercase hex, most significant byte first.
+  //
+  std::u16string  Expected (ConfigHdr);
+  UINT16          Offset;
+  UINT8           SizeFlag;
+
+  for (Index = 0, Offset = 0; Index < QuestionCount; Index++) {
+    SizeFlag = (UINT8)(Index % 4);
+    Offset   = (UINT16)ALIGN_VALUE (Offset, 1 << SizeFlag);
+    snprintf (Value, sizeof (Value), "&OFFSET=%04x&WIDTH=%04x&VALUE=", Offset, 1 << SizeFlag);
+    Expected.append (Value, Value + strlen (Value));
+    for (UINTN Byte = (UINTN)(1 << SizeFlag); Byte > 0; Byte--) {
+      snprintf (Value, sizeof (Value), "%02x", mVarStore[Offset + Byte - 1]);
+      Expected.append (Value, Value + strlen (Value));
+    }
+
+    Offset = (UINT16)(Offset + (1 << SizeFlag));
+  }
+
+  EXPECT_TRUE (Expected == (char16_t *)Config);
+
+  std::vector<UINT8>  Block (mVarStore.size (), 0);
+
+  BlockSize = Block.size ();
+  ASSERT_EQ (HiiConfigToBlock (&mPrivate.ConfigRouting, Config, Block.data (), &BlockSize, &Progress), EFI_SUCCESS);
+  EXPECT_EQ (BlockSize, (UINTN)Offset - 1);
+  ASSERT_EQ (HiiBlockToConfig (&mPrivate.ConfigRouting, (EFI_STRING)Request.c_str (), Block.data (), Block.size (), &Result, &Progress), EFI_SUCCESS);
+  EXPECT_EQ (StrCmp (Result, Config), 0);
+  FreePool (Config);
+  FreePool (Result);
+
+  //
+  // Block too small for the request.
+  //
+  ASSERT_EQ (HiiBlockToConfig (&mPrivate.ConfigRouting, (EFI_STRING)Request.c_str (), mVarStore.data (), 16, &Config, &Progress), EFI_DEVICE_ERROR);
+  EXPECT_EQ (Config, nullptr);
+}
+
+TEST_F (HiiConfigRoutingTest, ExtractConfigCachedMatchesParsed) {
+  std::u16string  Requests[] = { ConfigHdr, FormRequest (100, 50), FormRequest (0, 1) };
+  std::u16string  Parsed[ARRAY_SIZE (Requests)];
+  UINTN           Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (Requests); Index++) {
+    InvalidateVarStoreCache (&PackageList);
+    Parsed[Index] = Extract (Requests[Index]);
+    ASSERT_NE (Parsed[Index].find (u"&ALTCFG=0000"), std::u16string::npos);
+  }
+
+  //
+  // The first extraction of each request fills the cache, the second one is
+  // served from it.
+  //
+  InvalidateVarStoreCache (&PackageList);
+  for (Index = 0; Index < 2 * ARRAY_SIZE (Requests); Index++) {
+    EXPECT_TRUE (Extract (Requests[Index % ARRAY_SIZE (Requests)]) == Parsed[Index % ARRAY_SIZE (Requests)]) << "Request " << Index;
+  }
+
+  EXPECT_EQ (PackageList.ConfigDefaultCacheCount, ARRAY_SIZE (Requests));
+}
+
+TEST_F (HiiConfigRoutingTest, ExtractConfigSeesChangedForms) {
+  std::u16string  Request;
+  std::u16string  Before;
+  std::u16string  After;
+
+  Request = FormRequest (0, 4);
+  Before  = Extract (Request);
+
+  //
+  // Change the default of the first question. The form package is updated
+  // through the HII database, which invalidates the cache.
+  //
+  ((EFI_IFR_DEFAULT *)&Ifr[DefaultOffset[0]])->Value.u8 = 0xA5;
+  EXPECT_TRUE (Extract (Request) == Before);
+  InvalidateVarStoreCache (&PackageList);
+  After = Extract (Request);
+  EXPECT_FALSE (After == Before);
+  EXPECT_NE (After.find (u"VALUE=a5"), std::u16string::npos);
+}
+
+TEST_F (HiiConfigRoutingTest, RouteConfigUpdatesVarStore) {
+  std::u16string  Current;
+  UINTN           Position;
+
+  Current = CurrentSettings (Extract (ConfigHdr));
+
+  //
+  // Change the value of the first question, a byte at offset 0.
+  //
+  Position = Current.find (u"&VALUE=");
+  ASSERT_NE (Position, std::u16string::npos);
+  Current.replace (Position + 7, 2, u"5a");
+  Route (Current);
+  EXPECT_EQ (mVarStore[0], 0x5A);
+  EXPECT_TRUE (CurrentSettings (Extract (ConfigHdr)) == Current);
+}
+
+TEST_F (HiiConfigRoutingTest, DefaultCacheKeyedByDevicePath) {
+  EFI_DEVICE_PATH_PROTOCOL  *DevicePath[2];
+  std::vector<UINT8>        OtherPath;
+  std::u16string            Request;
+  EFI_STRING                Copy;
+  EFI_STRING                AltCfgResp;
+  UINTN                     Round;
+  UINTN                     Index;
+
+  //
+  // A second driver of the same package list, the vendor GUID of its device
+  // path differs in the last byte.
+  //
+  DevicePath[0] = (EFI_DEVICE_PATH_PROTOCOL *)(DevicePathPkg.data () + sizeof (EFI_HII_PACKAGE_HEADER));
+  OtherPath.assign ((UINT8 *)DevicePath[0], (UINT8 *)DevicePath[0] + GetDevicePathSize (DevicePath[0]));
+  OtherPath[sizeof (VENDOR_DEVICE_PATH) - 1] ^= 0xFF;
+  DevicePath[1] = (EFI_DEVICE_PATH_PROTOCOL *)OtherPath.data ();
+
+  Request = FormRequest (0, 4);
+  for (Round = 0; Round < 2; Round++) {
+    for (Index = 0; Index < ARRAY_SIZE (DevicePath); Index++) {
+      Copy       = (EFI_STRING)AllocateCopyPool ((Request.size () + 1) * sizeof (CHAR16), Request.c_str ());
+      AltCfgResp = NULL;
+      ASSERT_NE (Copy, nullptr);
+      EXPECT_EQ (GetCachedFullStringFromHiiFormPackages (&Record, DevicePath[Index], &Copy, &AltCfgResp, NULL), EFI_SUCCESS);
+      FreePool (Copy);
+      if (AltCfgResp != NULL) {
+        FreePool (AltCfgResp);
+      }
+
+      //
+      // Each device path gets an entry of its own, the second round hits them.
+      //
+      EXPECT_EQ (PackageList.ConfigDefaultCacheCount, Round == 0 ? Index + 1 : ARRAY_SIZE (DevicePath));
+    }
+  }
+
+  InvalidateVarStoreCache (&PackageList);
+  EXPECT_EQ (PackageList.ConfigDefaultCacheCount, 0U);
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  testing::InitGoogleTest (&argc, argv);
+  return RUN_ALL_TESTS ();
+}
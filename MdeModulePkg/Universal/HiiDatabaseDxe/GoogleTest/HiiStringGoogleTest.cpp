@@ -0,0 +1,445 @@
+/** @file
+  Unit tests of the StringId index of HII string packages.
+
+  A synthetic string package with 10,000 strings, mixing every kind of string
+  block with skip, duplicate and font blocks, is looked up the way a form
+  browser renders the prompts and help strings of a form: once per string,
+  in StringId order.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <vector>
+extern "C" {
+  #include <Uefi.h>
+  #include <Library/BaseLib.h>
+  #include <Library/BaseMemoryLib.h>
+  #include <Library/MemoryAllocationLib.h>
+  #include "../HiiDatabase.h"
+
+  //
+  // Internal functions of String.c under test.
+  //
+  EFI_STATUS
+  GetStringWorker (
+    IN HII_DATABASE_PRIVATE_DATA     *Private,
+    IN  HII_STRING_PACKAGE_INSTANCE  *StringPackage,
+    IN  EFI_STRING_ID                StringId,
+    OUT EFI_STRING                   String,
+    IN  OUT UINTN                    *StringSize  OPTIONAL,
+    OUT EFI_FONT_INFO                **StringFontInfo OPTIONAL
+    );
+
+  EFI_STATUS
+  SetStringWorker (
+    IN  HII_DATABASE_PRIVATE_DATA       *Private,
+    IN OUT HII_STRING_PACKAGE_INSTANCE  *StringPackage,
+    IN  EFI_STRING_ID                   StringId,
+    IN  EFI_STRING                      String,
+    IN  EFI_FONT_INFO                   *StringFontInfo OPTIONAL
+    );
+}
+
+////////////////////////////////////////////////////////////////////////
+// Symbol Definitions
+// These are not directly under test - but required to link String.c
+////////////////////////////////////////////////////////////////////////
+extern "C" {
+  EFI_LOCK  mHiiDatabaseLock;
+  BOOLEAN   gExportAfterReadyToBoot = FALSE;
+
+  VOID
+  EFIAPI
+  EfiAcquireLock (
+    IN EFI_LOCK  *Lock
+    )
+  {
+  }
+
+  VOID
+  EFIAPI
+  EfiReleaseLock (
+    IN EFI_LOCK  *Lock
+    )
+  {
+  }
+
+  BOOLEAN
+  IsHiiHandleValid (
+    EFI_HII_HANDLE  Handle
+    )
+  {
+    return TRUE;
+  }
+
+  BOOLEAN
+  IsFontInfoExisted (
+    IN  HII_DATABASE_PRIVATE_DATA  *Private,
+    IN  EFI_FONT_INFO              *FontInfo,
+    IN  EFI_FONT_INFO_MASK         *FontInfoMask    OPTIONAL,
+    IN  EFI_FONT_HANDLE            FontHandle       OPTIONAL,
+    OUT HII_GLOBAL_FONT_INFO       **GlobalFontInfo OPTIONAL
+    )
+  {
+    return FALSE;
+  }
+
+  EFI_STATUS
+  InvokeRegisteredFunction (
+    IN HII_DATABASE_PRIVATE_DATA           *Private,
+    IN EFI_HII_DATABASE_NOTIFY_TYPE        NotifyType,
+    IN VOID                                *PackageInstance,
+    IN UINT8                               PackageType,
+    IN EFI_HII_HANDLE                      Handle
+    )
+  {
+    return EFI_SUCCESS;
+  }
+
+  EFI_STATUS
+  EFIAPI
+  HiiGetDatabaseInfo (
+    IN CONST EFI_HII_DATABASE_PROTOCOL  *This
+    )
+  {
+    return EFI_SUCCESS;
+  }
+
+  VOID
+  InvalidateConfigDefaultCache (
+    IN OUT HII_DATABASE_PACKAGE_LIST_INSTANCE  *PackageList
+    )
+  {
+  }
+}
+
+#define HII_STRING_TEST_COUNT  10000
+
+//
+// Marks the StringIds that have no string.
+//
+static const std::u16string  NO_STRING (1, (char16_t)0xFFFF);
+
+class HiiStringTest : public ::testing::Test {
+protected:
+  HII_DATABASE_PRIVATE_DATA              Private;
+  HII_STRING_PACKAGE_INSTANCE            StringPackage;
+  std::vector<UINT8>                     Blocks;
+  std::map<EFI_STRING_ID, std::u16string>  Expected;
+  std::map<EFI_STRING_ID, EFI_STRING_ID>   DuplicateOf;
+  EFI_STRING_ID                          NextStringId;
+
+  //
+  // StringId of the string block that holds the text of a StringId.
+  //
+  EFI_STRING_ID
+  Resolve (
+    EFI_STRING_ID  StringId
+    )
+  {
+    while (DuplicateOf.count (StringId) != 0) {
+      StringId = DuplicateOf[StringId];
+    }
+
+    return StringId;
+  }
+
+  VOID
+  AddBlockHeader (
+    UINT8  BlockType
+    )
+  {
+    Blocks.push_back (BlockType);
+  }
+
+  VOID
+  AddUint16 (
+    UINT16  Value
+    )
+  {
+    Blocks.push_back ((UINT8)Value);
+    Blocks.push_back ((UINT8)(Value >> 8));
+  }
+
+  VOID
+  AddUcs2 (
+    const std::u16string  &Text
+    )
+  {
+    for (char16_t Char : Text) {
+      AddUint16 ((UINT16)Char);
+    }
+
+    AddUint16 (0);
+    Expected[NextStringId++] = Text;
+  }
+
+  VOID
+  AddAscii (
+    const std::u16string  &Text
+    )
+  {
+    for (char16_t Char : Text) {
+      Blocks.push_back ((UINT8)Char);
+    }
+
+    Blocks.push_back (0);
+    Expected[NextStringId++] = Text;
+  }
+
+  VOID
+  AddSkip (
+    UINT16  Count
+    )
+  {
+    if (Count <= MAX_UINT8) {
+      AddBlockHeader (EFI_HII_SIBT_SKIP1);
+      Blocks.push_back ((UINT8)Count);
+    } else {
+      AddBlockHeader (EFI_HII_SIBT_SKIP2);
+      AddUint16 (Count);
+    }
+
+    while (Count-- > 0) {
+      Expected[NextStringId++] = NO_STRING;
+    }
+  }
+
+  VOID
+  AddDuplicate (
+    EFI_STRING_ID  StringId
+    )
+  {
+    AddBlockHeader (EFI_HII_SIBT_DUPLICATE);
+    AddUint16 (StringId);
+    DuplicateOf[NextStringId++] = StringId;
+  }
+
+  VOID
+  AddFont (
+    VOID
+    )
+  {
+    static const std::u16string  FontName = u"sysdefault";
+
+    //
+    // EFI_HII_SIBT_EXT2_BLOCK + FontId + FontSize + FontStyle + FontName.
+    //
+    AddBlockHeader (EFI_HII_SIBT_EXT2);
+    Blocks.push_back (EFI_HII_SIBT_FONT);
+    AddUint16 ((UINT16)(sizeof (EFI_HII_SIBT_EXT2_BLOCK) + 1 + 2 + 4 + (FontName.size () + 1) * 2));
+    Blocks.push_back (0);
+    AddUint16 (19);
+    AddUint16 (0);
+    AddUint16 (0);
+    for (char16_t Char : FontName) {
+      AddUint16 ((UINT16)Char);
+    }
+
+    AddUint16 (0);
+  }
+
+  void
+  SetUp (
+    ) override
+  {
+    UINTN                       Index;
+    UINTN                       Count;
+    EFI_HII_STRING_PACKAGE_HDR  *Header;
+    UINTN                       HeaderSize;
+    EFI_STATUS                  Status;
+
+    NextStringId = 1;
+    AddBlockHeader (EFI_HII_SIBT_STRING_UCS2);
+    AddUcs2 (u"English");
+    AddFont ();
+
+    //
+    // Prompts and help strings of questions, as VfrCompile and the string
+    // gather tools lay them out, with some of the less common blocks mixed in.
+    //
+    for (Index = 0; NextStringId <= HII_STRING_TEST_COUNT; Index++) {
+      switch (Index % 8) {
+        case 0:
+        case 1:
+        case 2:
+          AddBlockHeader (EFI_HII_SIBT_STRING_UCS2);
+          AddUcs2 (u"Prompt " + std::u16string (1, (char16_t)(u'A' + Index % 26)) + u" of question " + std::u16string (Index % 40, u'x'));
+          break;
+        case 3:
+          Count = 1 + Index % 7;
+          AddBlockHeader (EFI_HII_SIBT_STRINGS_UCS2);
+          AddUint16 ((UINT16)Count);
+          while (Count-- > 0) {
+            AddUcs2 (u"Help text " + std::u16string (Count + Index % 30, (char16_t)(u'a' + Count)));
+          }
+
+          break;
+        case 4:
+          AddBlockHeader (EFI_HII_SIBT_STRING_UCS2_FONT);
+          Blocks.push_back (0);
+          AddUcs2 (u"Font string");
+          break;
+        case 5:
+          AddSkip ((Index % 64 == 5) ? 300 : (UINT16)(1 + Index % 3));
+          break;
+        case 6:
+          AddBlockHeader (EFI_HII_SIBT_STRING_SCSU);
+          AddAscii (u"Ascii string " + std::u16string (Index % 17, u'z'));
+          break;
+        case 7:
+          AddDuplicate ((EFI_STRING_ID)(1 + Index % (NextStringId - 1)));
+          break;
+      }
+    }
+
+    AddBlockHeader (EFI_HII_SIBT_END);
+
+    HeaderSize = sizeof (EFI_HII_STRING_PACKAGE_HDR) + sizeof ("en-US") - 1;
+    Header     = (EFI_HII_STRING_PACKAGE_HDR *)AllocateZeroPool (HeaderSize);
+    ASSERT_NE (Header, nullptr);
+    Header->Header.Type   = EFI_HII_PACKAGE_STRINGS;
+    Header->Header.Length = (UINT32)(HeaderSize + Blocks.size ());
+    Header->HdrSize       = (UINT32)HeaderSize;
+    Header->StringInfoOffset = (UINT32)HeaderSize;
+    AsciiStrCpyS (Header->Language, sizeof ("en-US"), "en-US");
+
+    ZeroMem (&Private, sizeof (Private));
+    Private.Signature = HII_DATABASE_PRIVATE_DATA_SIGNATURE;
+    ZeroMem (&StringPackage, sizeof (StringPackage));
+    StringPackage.Signature    = HII_STRING_PACKAGE_SIGNATURE;
+    StringPackage.StringPkgHdr = Header;
+    StringPackage.StringBlock  = (UINT8 *)AllocateCopyPool (Blocks.size (), Blocks.data ());
+    ASSERT_NE (StringPackage.StringBlock, nullptr);
+    InitializeListHead (&StringPackage.FontInfoList);
+
+    Status = FindStringBlock (&Private, &StringPackage, (EFI_STRING_ID)(-1), NULL, NULL, NULL, &StringPackage.MaxStringId, NULL);
+    ASSERT_EQ (Status, EFI_SUCCESS);
+    ASSERT_EQ (StringPackage.MaxStringId, NextStringId - 1);
+  }
+
+  void
+  TearDown (
+    ) override
+  {
+    InvalidateStringIdIndex (&StringPackage);
+    FreePool (StringPackage.StringBlock);
+    FreePool (StringPackage.StringPkgHdr);
+  }
+
+  //
+  // Get all the strings of the package, and the StringIds around them.
+  //
+  VOID
+  CheckAllStrings (
+    VOID
+    )
+  {
+    CHAR16         Buffer[128];
+    UINTN          Size;
+    EFI_STRING_ID  StringId;
+    EFI_STATUS     Status;
+
+    for (StringId = 1; StringId <= StringPackage.MaxStringId + 2; StringId++) {
+      Size   = sizeof (Buffer);
+      Status = GetStringWorker (&Private, &StringPackage, StringId, Buffer, &Size, NULL);
+      if ((StringId > StringPackage.MaxStringId) || (Expected[Resolve (StringId)] == NO_STRING)) {
+        ASSERT_EQ (Status, EFI_NOT_FOUND) << "StringId " << StringId;
+      } else {
+        ASSERT_EQ (Status, EFI_SUCCESS) << "StringId " << StringId;
+        ASSERT_EQ (std::u16string ((char16_t *)Buffer), Expected[Resolve (StringId)]) << "StringId " << StringId;
+      }
+    }
+  }
+};
+
+TEST_F (HiiStringTest, IndexMatchesStringBlocks) {
+  UINT8          BlockType;
+  UINT8          *StringBlockAddr;
+  UINTN          StringTextOffset;
+  UINT8          ParsedBlockType;
+  UINT8          *ParsedStringBlockAddr;
+  UINTN          ParsedStringTextOffset;
+  EFI_STRING_ID  StartStringId;
+  EFI_STRING_ID  StringId;
+  EFI_STATUS     Status;
+  EFI_STATUS     ParsedStatus;
+
+  for (StringId = 1; StringId <= StringPackage.MaxStringId; StringId++) {
+    Status = FindStringBlock (&Private, &StringPackage, StringId, &BlockType, &StringBlockAddr, &StringTextOffset, NULL, NULL);
+    //
+    // Passing StartStringId parses the string blocks.
+    //
+    ParsedStatus = FindStringBlock (
+                     &Private,
+                     &StringPackage,
+                     StringId,
+                     &ParsedBlockType,
+                     &ParsedStringBlockAddr,
+                     &ParsedStringTextOffset,
+                     NULL,
+                     &StartStringId
+                     );
+    ASSERT_EQ (Status, ParsedStatus) << "StringId " << StringId;
+    if (!EFI_ERROR (Status)) {
+      ASSERT_EQ (BlockType, ParsedBlockType) << "StringId " << StringId;
+      ASSERT_EQ (StringBlockAddr, ParsedStringBlockAddr) << "StringId " << StringId;
+      ASSERT_EQ (StringTextOffset, ParsedStringTextOffset) << "StringId " << StringId;
+    }
+  }
+
+  ASSERT_NE (StringPackage.StringIdIndex, nullptr);
+}
+
+TEST_F (HiiStringTest, GetAllStrings) {
+  CheckAllStrings ();
+}
+
+TEST_F (HiiStringTest, SetStringInvalidatesIndex) {
+  EFI_STRING_ID  StringId;
+  UINTN          Changed;
+
+  CheckAllStrings ();
+  ASSERT_NE (StringPackage.StringIdIndex, nullptr);
+
+  //
+  // Change strings of every kind of block, including StringIds of skip
+  // blocks which InsertLackStringBlock() turns into new string blocks.
+  // Duplicate blocks are left alone, they refer to the string they duplicate.
+  //
+  Changed = 0;
+  for (StringId = 3; StringId <= StringPackage.MaxStringId; StringId += 97) {
+    if (DuplicateOf.count (StringId) != 0) {
+      continue;
+    }
+
+    std::u16string  Text = u"Changed string " + std::u16string (StringId % 23, u'c');
+
+    ASSERT_EQ (SetStringWorker (&Private, &StringPackage, StringId, (EFI_STRING)Text.c_str (), NULL), EFI_SUCCESS);
+    EXPECT_EQ (StringPackage.StringIdIndex, nullptr);
+    if (Expected[StringId] == NO_STRING) {
+      Changed++;
+    }
+
+    Expected[StringId] = Text;
+    CheckAllStrings ();
+    if (HasFatalFailure ()) {
+      return;
+    }
+  }
+
+  EXPECT_GT (Changed, 0U);
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  testing::InitGoogleTest (&argc, argv);
+  return RUN_ALL_TESTS ();
+}
@@ -150,6 +150,18 @@ typedef struct {
 // String Package definitions
 //
 #define HII_STRING_PACKAGE_SIGNATURE  SIGNATURE_32 ('h','i','s','p')
+
+//
+// Location of the string block of a StringId. BlockOffset is
+// HII_STRING_ID_NOT_INDEXED for StringIds that have no string, such as the
+// ones in EFI_HII_SIBT_SKIP1 and EFI_HII_SIBT_SKIP2 blocks.
+//
+#define HII_STRING_ID_NOT_INDEXED  MAX_UINT32
+typedef struct {
+  UINT32    BlockOffset;                               // offset of the string block from StringBlock
+  UINT32    TextOffset;                                // offset of the string text from the string block
+} HII_STRING_ID_INDEX_ENTRY;
+
 typedef struct _HII_STRING_PACKAGE_INSTANCE {
   UINTN                         Signature;
   EFI_HII_STRING_PACKAGE_HDR    *StringPkgHdr;
@@ -158,8 +170,41 @@ typedef struct _HII_STRING_PACKAGE_INSTANCE {
   LIST_ENTRY                    FontInfoList;          // local font info list
   UINT8                         FontId;
   EFI_STRING_ID                 MaxStringId;           // record StringId
+  HII_STRING_ID_INDEX_ENTRY     *StringIdIndex;        // StringId to string block map, built on first lookup
 } HII_STRING_PACKAGE_INSTANCE;
 
+//
+// Varstore declared in the form packages of a package list. ConfigHdr is the
+// "GUID=...&NAME=...&" prefix a <ConfigHdr> of this varstore starts with.
+//
+#define HII_VARSTORE_CACHE_SIGNATURE  SIGNATURE_32 ('h','v','s','c')
+typedef struct {
+  UINTN                   Signature;
+  LIST_ENTRY              Entry;
+  UINT8                   OpCode;                      // EFI_IFR_VARSTORE_OP, EFI_IFR_VARSTORE_EFI_OP or EFI_IFR_VARSTORE_NAME_VALUE_OP
+  BOOLEAN                 BeforeFirstForm;             // declared before the first form of the package list
+  EFI_STRING              ConfigHdr;
+  EFI_IFR_VARSTORE_EFI    *EfiVarStore;                // copy of the opcode of an EFI varstore with a buffer
+} HII_VARSTORE_CACHE;
+
+//
+// Full <ConfigRequest> and default <ConfigAltResp> generated from the IFR of
+// a package list for a <ConfigRequest> and a device path, kept to answer the
+// next ExtractConfig() of the same request without parsing the IFR again.
+//
+#define HII_CONFIG_DEFAULT_CACHE_SIGNATURE  SIGNATURE_32 ('h','c','d','c')
+#define HII_CONFIG_DEFAULT_CACHE_MAX        32
+typedef struct {
+  UINTN                       Signature;
+  LIST_ENTRY                  Entry;
+  EFI_STRING                  Request;                 // <ConfigRequest> passed in
+  EFI_STRING                  FullRequest;             // <ConfigRequest> completed from IFR, NULL if Request has elements
+  EFI_STRING                  AltCfgResp;              // default <ConfigAltResp>, may be NULL
+  CHAR8                       *PlatformLang;           // PlatformLang the default strings were read in, may be NULL
+  EFI_DEVICE_PATH_PROTOCOL    *DevicePath;             // device path of the driver of the request, may be NULL
+  UINTN                       DevicePathSize;
+} HII_CONFIG_DEFAULT_CACHE;
+
 //
 // Form Package definitions
 //
@@ -268,6 +313,10 @@ typedef struct _HII_DATABASE_PACKAGE_LIST_INSTANCE {
   HII_IMAGE_PACKAGE_INSTANCE     *ImagePkg;
   LIST_ENTRY                     SimpleFontPkgHdr;
   UINT8                          *DevicePathPkg;
+  LIST_ENTRY                     VarStoreCache;        // HII_VARSTORE_CACHE list, built on first lookup
+  BOOLEAN                        VarStoreCacheValid;
+  LIST_ENTRY                     ConfigDefaultCache;   // HII_CONFIG_DEFAULT_CACHE list, most recent first
+  UINTN                          ConfigDefaultCacheCount;
 } HII_DATABASE_PACKAGE_LIST_INSTANCE;
 
 #define HII_HANDLE_SIGNATURE  SIGNATURE_32 ('h','i','h','l')
@@ -497,6 +546,45 @@ GetSystemFont (
   OUT UINTN                      *FontInfoSize OPTIONAL
   );
 
+/**
+  Free the StringId index of a string package. This must be called whenever
+  the string blocks or the MaxStringId of the package are changed, the index
+  is built again by the next FindStringBlock() call that looks up a string.
+
+  @param  StringPackage           Hii string package instance.
+
+**/
+VOID
+InvalidateStringIdIndex (
+  IN OUT HII_STRING_PACKAGE_INSTANCE  *StringPackage
+  );
+
+/**
+  Free the varstores and the default configurations cached for a package
+  list. This must be called whenever the form packages of the package list
+  are changed.
+
+  @param  PackageList             Pointer to a package list.
+
+**/
+VOID
+InvalidateVarStoreCache (
+  IN OUT HII_DATABASE_PACKAGE_LIST_INSTANCE  *PackageList
+  );
+
+/**
+  Free the default configurations cached for a package list. This must be
+  called whenever the strings of the package list are changed, since default
+  string values and the names of name/value varstores are read from them.
+
+  @param  PackageList             Pointer to a package list.
+
+**/
+VOID
+InvalidateConfigDefaultCache (
+  IN OUT HII_DATABASE_PACKAGE_LIST_INSTANCE  *PackageList
+  );
+
 /**
   Parse all string blocks to find a String block specified by StringId.
   If StringId = (EFI_STRING_ID) (-1), find out all EFI_HII_SIBT_FONT blocks
@@ -225,12 +225,269 @@ GetStringFontInfo (
   return EFI_NOT_FOUND;
 }
 
+/**
+  Free the StringId index of a string package. This must be called whenever
+  the string blocks or the MaxStringId of the package are changed, the index
+  is built again by the next FindStringBlock() call that looks up a string.
+
+  @param  StringPackage           Hii string package instance.
+
+**/
+VOID
+InvalidateStringIdIndex (
+  IN OUT HII_STRING_PACKAGE_INSTANCE  *StringPackage
+  )
+{
+  if (StringPackage->StringIdIndex != NULL) {
+    FreePool (StringPackage->StringIdIndex);
+    StringPackage->StringIdIndex = NULL;
+  }
+}
+
+/**
+  Parse all string blocks once to record the location of the string block and
+  of the string text of every StringId of a string package.
+
+  This is a internal function.
+
+  @param  StringPackage           Hii string package instance.
+
+  @retval EFI_SUCCESS             The index is built.
+  @retval EFI_UNSUPPORTED         The string blocks contain an unknown block type.
+  @retval EFI_OUT_OF_RESOURCES    The system is out of resources to accomplish the
+                                  task.
+
+**/
+EFI_STATUS
+BuildStringIdIndex (
+  IN OUT HII_STRING_PACKAGE_INSTANCE  *StringPackage
+  )
+{
+  HII_STRING_ID_INDEX_ENTRY  *Index;
+  UINT8                      *BlockHdr;
+  UINT8                      *StringTextPtr;
+  UINTN                      CurrentStringId;
+  UINTN                      TextOffset;
+  UINTN                      StringSize;
+  UINT16                     StringCount;
+  UINT16                     SkipCount;
+  UINT8                      Length8;
+  UINT32                     Length32;
+  EFI_HII_SIBT_EXT2_BLOCK    Ext2;
+  BOOLEAN                    Ascii;
+
+  ASSERT (StringPackage->StringIdIndex == NULL);
+
+  //
+  // Every entry starts as HII_STRING_ID_NOT_INDEXED.
+  //
+  Index = AllocatePool ((StringPackage->MaxStringId + 1) * sizeof (HII_STRING_ID_INDEX_ENTRY));
+  if (Index == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  SetMem (Index, (StringPackage->MaxStringId + 1) * sizeof (HII_STRING_ID_INDEX_ENTRY), 0xFF);
+
+  CurrentStringId = 1;
+  BlockHdr        = StringPackage->StringBlock;
+  while (*BlockHdr != EFI_HII_SIBT_END) {
+    StringCount = 0;
+    TextOffset  = 0;
+    Ascii       = FALSE;
+    switch (*BlockHdr) {
+      case EFI_HII_SIBT_STRING_SCSU:
+        TextOffset  = sizeof (EFI_HII_STRING_BLOCK);
+        StringCount = 1;
+        Ascii       = TRUE;
+        break;
+
+      case EFI_HII_SIBT_STRING_SCSU_FONT:
+        TextOffset  = sizeof (EFI_HII_SIBT_STRING_SCSU_FONT_BLOCK) - sizeof (UINT8);
+        StringCount = 1;
+        Ascii       = TRUE;
+        break;
+
+      case EFI_HII_SIBT_STRINGS_SCSU:
+        CopyMem (&StringCount, BlockHdr + sizeof (EFI_HII_STRING_BLOCK), sizeof (UINT16));
+        TextOffset = sizeof (EFI_HII_SIBT_STRINGS_SCSU_BLOCK) - sizeof (UINT8);
+        Ascii      = TRUE;
+        break;
+
+      case EFI_HII_SIBT_STRINGS_SCSU_FONT:
+        CopyMem (&StringCount, BlockHdr + sizeof (EFI_HII_STRING_BLOCK) + sizeof (UINT8), sizeof (UINT16));
+        TextOffset = sizeof (EFI_HII_SIBT_STRINGS_SCSU_FONT_BLOCK) - sizeof (UINT8);
+        Ascii      = TRUE;
+        break;
+
+      case EFI_HII_SIBT_STRING_UCS2:
+        TextOffset  = sizeof (EFI_HII_STRING_BLOCK);
+        StringCount = 1;
+        break;
+
+      case EFI_HII_SIBT_STRING_UCS2_FONT:
+        TextOffset  = sizeof (EFI_HII_SIBT_STRING_UCS2_FONT_BLOCK) - sizeof (CHAR16);
+        StringCount = 1;
+        break;
+
+      case EFI_HII_SIBT_STRINGS_UCS2:
+        CopyMem (&StringCount, BlockHdr + sizeof (EFI_HII_STRING_BLOCK), sizeof (UINT16));
+        TextOffset = sizeof (EFI_HII_SIBT_STRINGS_UCS2_BLOCK) - sizeof (CHAR16);
+        break;
+
+      case EFI_HII_SIBT_STRINGS_UCS2_FONT:
+        CopyMem (&StringCount, BlockHdr + sizeof (EFI_HII_STRING_BLOCK) + sizeof (UINT8), sizeof (UINT16));
+        TextOffset = sizeof (EFI_HII_SIBT_STRINGS_UCS2_FONT_BLOCK) - sizeof (CHAR16);
+        break;
+
+      case EFI_HII_SIBT_DUPLICATE:
+        //
+        // The duplicate block itself is recorded, the StringId it refers to is
+        // looked up when the string is requested.
+        //
+        if (CurrentStringId <= StringPackage->MaxStringId) {
+          Index[CurrentStringId].BlockOffset = (UINT32)(BlockHdr - StringPackage->StringBlock);
+          Index[CurrentStringId].TextOffset  = 0;
+        }
+
+        CurrentStringId++;
+        BlockHdr += sizeof (EFI_HII_SIBT_DUPLICATE_BLOCK);
+        continue;
+
+      case EFI_HII_SIBT_SKIP1:
+        SkipCount        = (UINT16)(*(UINT8 *)((UINTN)BlockHdr + sizeof (EFI_HII_STRING_BLOCK)));
+        CurrentStringId += SkipCount;
+        BlockHdr        += sizeof (EFI_HII_SIBT_SKIP1_BLOCK);
+        continue;
+
+      case EFI_HII_SIBT_SKIP2:
+        CopyMem (&SkipCount, BlockHdr + sizeof (EFI_HII_STRING_BLOCK), sizeof (UINT16));
+        CurrentStringId += SkipCount;
+        BlockHdr        += sizeof (EFI_HII_SIBT_SKIP2_BLOCK);
+        continue;
+
+      case EFI_HII_SIBT_EXT1:
+        CopyMem (&Length8, BlockHdr + sizeof (EFI_HII_STRING_BLOCK) + sizeof (UINT8), sizeof (UINT8));
+        BlockHdr += Length8;
+        continue;
+
+      case EFI_HII_SIBT_EXT2:
+        CopyMem (&Ext2, BlockHdr, sizeof (EFI_HII_SIBT_EXT2_BLOCK));
+        BlockHdr += Ext2.Length;
+        continue;
+
+      case EFI_HII_SIBT_EXT4:
+        CopyMem (&Length32, BlockHdr + sizeof (EFI_HII_STRING_BLOCK) + sizeof (UINT8), sizeof (UINT32));
+        BlockHdr += Length32;
+        continue;
+
+      default:
+        FreePool (Index);
+        return EFI_UNSUPPORTED;
+    }
+
+    //
+    // Record each string of the string block, the next block follows the last
+    // string text.
+    //
+    StringTextPtr = BlockHdr + TextOffset;
+    while (StringCount-- > 0) {
+      if (CurrentStringId <= StringPackage->MaxStringId) {
+        Index[CurrentStringId].BlockOffset = (UINT32)(BlockHdr - StringPackage->StringBlock);
+        Index[CurrentStringId].TextOffset  = (UINT32)(StringTextPtr - BlockHdr);
+      }
+
+      if (Ascii) {
+        StringSize = AsciiStrSize ((CHAR8 *)StringTextPtr);
+      } else {
+        GetUnicodeStringTextOrSize (NULL, StringTextPtr, &StringSize);
+      }
+
+      StringTextPtr += StringSize;
+      CurrentStringId++;
+    }
+
+    BlockHdr = StringTextPtr;
+  }
+
+  StringPackage->StringIdIndex = Index;
+  return EFI_SUCCESS;
+}
+
+/**
+  Find the String block of a StringId with the StringId index of the string
+  package, building the index if it does not exist yet.
+
+  This is a internal function.
+
+  @param  StringPackage           Hii string package instance.
+  @param  StringId                The string's id, which is unique within
+                                  PackageList.
+  @param  BlockType               Output the block type of found string block.
+  @param  StringBlockAddr         Output the block address of found string block.
+  @param  StringTextOffset        Offset, relative to the found block address, of
+                                  the  string text information.
+
+  @retval EFI_SUCCESS             The string block is found.
+  @retval EFI_NOT_FOUND           The StringId has no string in this package.
+  @retval EFI_UNSUPPORTED         The index can not be built, the string blocks
+                                  must be parsed instead.
+
+**/
+EFI_STATUS
+FindStringBlockByIndex (
+  IN  HII_STRING_PACKAGE_INSTANCE  *StringPackage,
+  IN  EFI_STRING_ID                StringId,
+  OUT UINT8                        *BlockType,
+  OUT UINT8                        **StringBlockAddr,
+  OUT UINTN                        *StringTextOffset
+  )
+{
+  HII_STRING_ID_INDEX_ENTRY  *Entry;
+  UINT8                      *BlockHdr;
+  UINTN                      Hops;
+
+  if (StringPackage->StringIdIndex == NULL) {
+    if (EFI_ERROR (BuildStringIdIndex (StringPackage))) {
+      return EFI_UNSUPPORTED;
+    }
+  }
+
+  //
+  // Follow EFI_HII_SIBT_DUPLICATE blocks to the string they refer to. A chain
+  // can not be longer than the number of StringIds unless it is circular.
+  //
+  for (Hops = 0; Hops <= StringPackage->MaxStringId; Hops++) {
+    if ((StringId == 0) || (StringId > StringPackage->MaxStringId)) {
+      return EFI_NOT_FOUND;
+    }
+
+    Entry = &StringPackage->StringIdIndex[StringId];
+    if (Entry->BlockOffset == HII_STRING_ID_NOT_INDEXED) {
+      return EFI_NOT_FOUND;
+    }
+
+    BlockHdr = StringPackage->StringBlock + Entry->BlockOffset;
+    if (*BlockHdr != EFI_HII_SIBT_DUPLICATE) {
+      *BlockType        = *BlockHdr;
+      *StringBlockAddr  = BlockHdr;
+      *StringTextOffset = Entry->TextOffset;
+      return EFI_SUCCESS;
+    }
+
+    CopyMem (&StringId, BlockHdr + sizeof (EFI_HII_STRING_BLOCK), sizeof (EFI_STRING_ID));
+  }
+
+  return EFI_NOT_FOUND;
+}
+
 /**
   Parse all string blocks to find a String block specified by StringId.
   If StringId = (EFI_STRING_ID) (-1), find out all EFI_HII_SIBT_FONT blocks
   within this string package and backup its information. If LastStringId is
   specified, the string id of last string block will also be output.
   If StringId = 0, output the string id of last string block (EFI_HII_SIBT_STRING).
+  A string that is looked up without StartStringId is found through the
+  StringId index of the package instead of parsing the string blocks.
 
   @param  Private                 Hii database private structure.
   @param  StringPackage           Hii string package instance.
@@ -283,6 +540,7 @@ FindStringBlock (
   UINT32                   Length32;
   UINTN                    StringSize;
   CHAR16                   Zero;
+  EFI_STATUS               Status;
 
   ASSERT (StringPackage != NULL);
   ASSERT (StringPackage->Signature == HII_STRING_PACKAGE_SIGNATURE);
@@ -295,6 +553,18 @@ FindStringBlock (
     if (StringId > StringPackage->MaxStringId) {
       return EFI_NOT_FOUND;
     }
+
+    //
+    // The block that holds StringId is only known after parsing the blocks
+    // in front of it, so look it up in the index which records all of them.
+    // Callers that need StartStringId are about to change the string blocks.
+    //
+    if (StartStringId == NULL) {
+      Status = FindStringBlockByIndex (StringPackage, StringId, BlockType, StringBlockAddr, StringTextOffset);
+      if (Status != EFI_UNSUPPORTED) {
+        return Status;
+      }
+    }
   } else {
     ASSERT (Private != NULL && Private->Signature == HII_DATABASE_PRIVATE_DATA_SIGNATURE);
     if ((StringId == 0) && (LastStringId != NULL)) {
@@ -853,6 +1123,7 @@ InsertLackStringBlock (
     *BlockType = EFI_HII_SIBT_STRING_UCS2;
   }
 
+  InvalidateStringIdIndex (StringPackage);
   FreePool (StringPackage->StringBlock);
   StringPackage->StringBlock                  = StringBlock;
   StringPackage->StringPkgHdr->Header.Length += NewBlockSize - OldBlockSize;
@@ -991,6 +1262,11 @@ SetStringWorker (
 
   OldBlockSize = StringPackage->StringPkgHdr->Header.Length - StringPackage->StringPkgHdr->HdrSize;
 
+  //
+  // The string blocks are reallocated below, which moves every string.
+  //
+  InvalidateStringIdIndex (StringPackage);
+
   //
   // Set the string text and font.
   //
@@ -1237,6 +1513,10 @@ HiiNewString (
   {
     StringPackage = CR (Link, HII_STRING_PACKAGE_INSTANCE, StringEntry, HII_STRING_PACKAGE_SIGNATURE);
     //
+    // Every string package of the list gets the new StringId.
+    //
+    InvalidateStringIdIndex (StringPackage);
+    //
     // Create a string block and corresponding font block if exists, then append them
     // to the end of the string package.
     //
@@ -1564,6 +1844,11 @@ Done:
                EFI_HII_PACKAGE_STRINGS,
                PackageList
                );
+
+    //
+    // A new language may change the language default strings are read in.
+    //
+    InvalidateConfigDefaultCache (PackageListNode);
   }
 
   if (!EFI_ERROR (Status)) {
@@ -1583,6 +1868,7 @@ Done:
     // Free the allocated new string Package when new string can't be added.
     //
     RemoveEntryList (&StringPackage->StringEntry);
+    InvalidateStringIdIndex (StringPackage);
     FreePool (StringPackage->StringBlock);
     FreePool (StringPackage->StringPkgHdr);
     FreePool (StringPackage);
@@ -1802,6 +2088,7 @@ HiiSetString (
         }
 
         PackageListNode->PackageListHdr.PackageLength += StringPackage->StringPkgHdr->Header.Length - OldPackageLen;
+        InvalidateConfigDefaultCache (PackageListNode);
         //
         // Check whether need to get the contents of HiiDataBase.
         // Only after ReadyToBoot to do the export.
@@ -361,6 +361,51 @@ WriteMemory (
   return EFI_SUCCESS;
 }
 
+/**
+  Report an uncorrectable memory error found by the memory test.
+
+  @param[in] Address  The address of the memory test pattern that mis-compared.
+
+  @retval EFI_DEVICE_ERROR      The error is reported.
+  @retval EFI_OUT_OF_RESOURCES  The error data cannot be allocated.
+
+**/
+EFI_STATUS
+ReportMemoryError (
+  IN  EFI_PHYSICAL_ADDRESS  Address
+  )
+{
+  EFI_MEMORY_EXTENDED_ERROR_DATA  *ExtendedErrorData;
+
+  //
+  // Report uncorrectable errors
+  //
+  ExtendedErrorData = AllocateZeroPool (sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA));
+  if (ExtendedErrorData == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  ExtendedErrorData->DataHeader.HeaderSize = (UINT16)sizeof (EFI_STATUS_CODE_DATA);
+  ExtendedErrorData->DataHeader.Size       = (UINT16)(sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA) - sizeof (EFI_STATUS_CODE_DATA));
+  ExtendedErrorData->Granularity           = EFI_MEMORY_ERROR_DEVICE;
+  ExtendedErrorData->Operation             = EFI_MEMORY_OPERATION_READ;
+  ExtendedErrorData->Syndrome              = 0x0;
+  ExtendedErrorData->Address               = Address;
+  ExtendedErrorData->Resolution            = 0x40;
+
+  REPORT_STATUS_CODE_EX (
+    EFI_ERROR_CODE,
+    EFI_COMPUTING_UNIT_MEMORY | EFI_CU_MEMORY_EC_UNCORRECTABLE,
+    0,
+    &gEfiGenericMemTestProtocolGuid,
+    NULL,
+    (UINT8 *)ExtendedErrorData + sizeof (EFI_STATUS_CODE_DATA),
+    ExtendedErrorData->DataHeader.Size
+    );
+
+  return EFI_DEVICE_ERROR;
+}
+
 /**
   Verify the range of physical memory which covered by memory test pattern.
 
@@ -382,12 +427,10 @@ VerifyMemory (
   IN  UINT64                       Size
   )
 {
-  EFI_PHYSICAL_ADDRESS            Address;
-  INTN                            ErrorFound;
-  EFI_MEMORY_EXTENDED_ERROR_DATA  *ExtendedErrorData;
+  EFI_PHYSICAL_ADDRESS  Address;
+  INTN                  ErrorFound;
 
-  Address           = Start;
-  ExtendedErrorData = NULL;
+  Address = Start;
 
   //
   // Add 4G memory address check for IA32 platform
@@ -409,33 +452,7 @@ VerifyMemory (
                    Private->MonoTestSize
                    );
     if (ErrorFound != 0) {
-      //
-      // Report uncorrectable errors
-      //
-      ExtendedErrorData = AllocateZeroPool (sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA));
-      if (ExtendedErrorData == NULL) {
-        return EFI_OUT_OF_RESOURCES;
-      }
-
-      ExtendedErrorData->DataHeader.HeaderSize = (UINT16)sizeof (EFI_STATUS_CODE_DATA);
-      ExtendedErrorData->DataHeader.Size       = (UINT16)(sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA) - sizeof (EFI_STATUS_CODE_DATA));
-      ExtendedErrorData->Granularity           = EFI_MEMORY_ERROR_DEVICE;
-      ExtendedErrorData->Operation             = EFI_MEMORY_OPERATION_READ;
-      ExtendedErrorData->Syndrome              = 0x0;
-      ExtendedErrorData->Address               = Address;
-      ExtendedErrorData->Resolution            = 0x40;
-
-      REPORT_STATUS_CODE_EX (
-        EFI_ERROR_CODE,
-        EFI_COMPUTING_UNIT_MEMORY | EFI_CU_MEMORY_EC_UNCORRECTABLE,
-        0,
-        &gEfiGenericMemTestProtocolGuid,
-        NULL,
-        (UINT8 *)ExtendedErrorData + sizeof (EFI_STATUS_CODE_DATA),
-        ExtendedErrorData->DataHeader.Size
-        );
-
-      return EFI_DEVICE_ERROR;
+      return ReportMemoryError (Address);
     }
 
     Address += Private->CoverageSpan;
@@ -501,6 +518,20 @@ InitializeMemoryTest (
     Private->Cpu = Cpu;
   }
 
+  //
+  // Test bigger blocks when all the processors share the work
+  //
+  Status = gBS->LocateProtocol (
+                  &gEdkiiParallelMemoryProtocolGuid,
+                  NULL,
+                  (VOID **)&Private->ParallelMemory
+                  );
+  if (EFI_ERROR (Status)) {
+    Private->ParallelMemory = NULL;
+  } else {
+    Private->BdsBlockSize = PARALLEL_TEST_BLOCK_SIZE;
+  }
+
   //
   // Create the CoverageSpan of the memory test base on the coverage level
   //
@@ -572,6 +603,7 @@ GenPerformMemoryTest (
   GENERIC_MEMORY_TEST_PRIVATE     *Private;
   EFI_MEMORY_RANGE_EXTENDED_DATA  *RangeData;
   UINT64                          BlockBoundary;
+  EFI_PHYSICAL_ADDRESS            ErrorAddress;
 
   Private       = GENERIC_MEMORY_TEST_PRIVATE_FROM_THIS (This);
   *ErrorOut     = FALSE;
@@ -619,11 +651,31 @@ GenPerformMemoryTest (
 
       //
       // The software memory test (R/W/V) perform here. It will detect the
-      // memory mis-compare error.
+      // memory mis-compare error. The parallel memory protocol flushes the
+      // copies of the pattern it writes, so no cache flush is needed.
       //
-      WriteMemory (Private, mCurrentAddress, BlockBoundary);
+      Status = EFI_UNSUPPORTED;
+      if (Private->ParallelMemory != NULL) {
+        Status = Private->ParallelMemory->Test (
+                                            Private->ParallelMemory,
+                                            mCurrentAddress,
+                                            BlockBoundary,
+                                            Private->MonoPattern,
+                                            Private->MonoTestSize,
+                                            Private->CoverageSpan,
+                                            &ErrorAddress
+                                            );
+        if (Status == EFI_DEVICE_ERROR) {
+          ReportMemoryError (ErrorAddress);
+        }
+      }
+
+      if ((Status != EFI_SUCCESS) && (Status != EFI_DEVICE_ERROR)) {
+        WriteMemory (Private, mCurrentAddress, BlockBoundary);
+
+        Status = VerifyMemory (Private, mCurrentAddress, BlockBoundary);
+      }
 
-      Status = VerifyMemory (Private, mCurrentAddress, BlockBoundary);
       if (EFI_ERROR (Status)) {
         //
         // If perform here, means there is mis-compare error, and no agent can
@@ -684,11 +736,46 @@ GenMemoryTestFinished (
   IN EFI_GENERIC_MEMORY_TEST_PROTOCOL  *This
   )
 {
-  EFI_STATUS                   Status;
-  GENERIC_MEMORY_TEST_PRIVATE  *Private;
+  EFI_STATUS                             Status;
+  GENERIC_MEMORY_TEST_PRIVATE            *Private;
+  EDKII_PARALLEL_MEMORY_NODE_STATISTICS  *Statistics;
+  UINTN                                  NodeCount;
+  UINTN                                  Index;
 
   Private = GENERIC_MEMORY_TEST_PRIVATE_FROM_THIS (This);
 
+  //
+  // Report the memory bandwidth of the NUMA nodes
+  //
+  NodeCount  = 0;
+  Statistics = NULL;
+  if ((Private->ParallelMemory != NULL) &&
+      (Private->ParallelMemory->GetStatistics (Private->ParallelMemory, &NodeCount, NULL) == EFI_BUFFER_TOO_SMALL))
+  {
+    Statistics = AllocatePool (NodeCount * sizeof (*Statistics));
+  }
+
+  if ((Statistics != NULL) &&
+      !EFI_ERROR (Private->ParallelMemory->GetStatistics (Private->ParallelMemory, &NodeCount, Statistics)))
+  {
+    for (Index = 0; Index < NodeCount; Index++) {
+      if (Statistics[Index].ElapsedNs != 0) {
+        DEBUG ((
+          DEBUG_INFO,
+          "GenericMemoryTest: node %d, %d processors, %ld MB at %ld MB/s\n",
+          Statistics[Index].ProximityDomain,
+          Statistics[Index].ProcessorCount,
+          RShiftU64 (Statistics[Index].Bytes, 20),
+          DivU64x64Remainder (MultU64x32 (Statistics[Index].Bytes, 1000), Statistics[Index].ElapsedNs, NULL)
+          ));
+      }
+    }
+  }
+
+  if (Statistics != NULL) {
+    FreePool (Statistics);
+  }
+
   //
   // Perform Data and Address line test only if not ignore memory test
   //
@@ -868,7 +955,8 @@ GENERIC_MEMORY_TEST_PRIVATE  mGenericMemoryTestPrivate = {
   {
     NULL,
     NULL
-  }
+  },
+  NULL
 };
 
 /**
@@ -13,6 +13,7 @@
 #include <Guid/StatusCodeDataTypeId.h>
 #include <Protocol/GenericMemoryTest.h>
 #include <Protocol/Cpu.h>
+#include <Protocol/ParallelMemory.h>
 
 #include <Library/DebugLib.h>
 #include <Library/UefiDriverEntryPoint.h>
@@ -43,6 +44,11 @@
 #define QUICK_SPAN_SIZE   (TEST_BLOCK_SIZE >> 2)
 #define SPARSE_SPAN_SIZE  (TEST_BLOCK_SIZE >> 4)
 
+//
+// Block size of the memory test when it is run on all the processors
+//
+#define PARALLEL_TEST_BLOCK_SIZE  (TEST_BLOCK_SIZE << 5)
+
 //
 // This structure records every nontested memory range parsed through GCD
 // service.
@@ -108,6 +114,11 @@ typedef struct {
   // memory range list
   //
   LIST_ENTRY                          NonTestedMemRanList;
+
+  //
+  // Parallel memory protocol's pointer, NULL if the test runs on the BSP only
+  //
+  EDKII_PARALLEL_MEMORY_PROTOCOL      *ParallelMemory;
 } GENERIC_MEMORY_TEST_PRIVATE;
 
 #define GENERIC_MEMORY_TEST_PRIVATE_FROM_THIS(a) \
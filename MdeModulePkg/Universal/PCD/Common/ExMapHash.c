@@ -0,0 +1,52 @@
+/** @file
+  Hash function of the perfect hash of the ExMap table, shared by the PEI and DXE PCD drivers.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "ExMapHash.h"
+
+/**
+  Hash a {token space guid: token number} pair the way the build tool does for the
+  perfect hash of the ExMap table.
+
+  @param Guid            Token space guid for dynamic-ex PCD entry.
+  @param ExTokenNumber   Dynamic-ex PCD token number.
+  @param Seed            0 for the bucket of the pair, the displacement of the bucket plus 1 for its slot.
+
+  @return The hash of the pair.
+
+**/
+UINT32
+GetExMapHash (
+  IN CONST EFI_GUID  *Guid,
+  IN UINT32          ExTokenNumber,
+  IN UINT32          Seed
+  )
+{
+  CONST UINT8  *GuidBytes;
+  UINT32       Hash;
+  UINTN        Index;
+
+  Hash      = PCD_EX_MAP_HASH_OFFSET_BASIS ^ (Seed * PCD_EX_MAP_HASH_SEED_MULTIPLIER);
+  GuidBytes = (CONST UINT8 *)Guid;
+  for (Index = 0; Index < sizeof (EFI_GUID); Index++) {
+    Hash = (Hash ^ GuidBytes[Index]) * PCD_EX_MAP_HASH_PRIME;
+  }
+
+  for (Index = 0; Index < sizeof (UINT32); Index++) {
+    Hash = (Hash ^ (UINT8)(ExTokenNumber >> (Index * 8))) * PCD_EX_MAP_HASH_PRIME;
+  }
+
+  //
+  // The low bits of FNV-1a do not depend on the seed enough, mix all the bits into them.
+  //
+  Hash ^= Hash >> 16;
+  Hash *= 0x85EBCA6BU;
+  Hash ^= Hash >> 13;
+  Hash *= 0xC2B2AE35U;
+  Hash ^= Hash >> 16;
+
+  return Hash;
+}
@@ -0,0 +1,32 @@
+/** @file
+  Hash function of the perfect hash of the ExMap table, shared by the PEI and DXE PCD drivers.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef EX_MAP_HASH_H_
+#define EX_MAP_HASH_H_
+
+#include <Uefi/UefiBaseType.h>
+#include <Guid/PcdDataBaseSignatureGuid.h>
+
+/**
+  Hash a {token space guid: token number} pair the way the build tool does for the
+  perfect hash of the ExMap table.
+
+  @param Guid            Token space guid for dynamic-ex PCD entry.
+  @param ExTokenNumber   Dynamic-ex PCD token number.
+  @param Seed            0 for the bucket of the pair, the displacement of the bucket plus 1 for its slot.
+
+  @return The hash of the pair.
+
+**/
+UINT32
+GetExMapHash (
+  IN CONST EFI_GUID  *Guid,
+  IN UINT32          ExTokenNumber,
+  IN UINT32          Seed
+  );
+
+#endif
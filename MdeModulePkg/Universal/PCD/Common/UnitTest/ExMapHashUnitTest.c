@@ -0,0 +1,145 @@
+/** @file
+  Unit tests of the hash of the perfect hash of the ExMap table.
+
+  GetExMapHash() must give the hashes GenPcdDb gives when it builds the table.
+  The vectors are the ones checked against GetExMapHash() of GenPcdDb by
+  BaseTools/Tests/GenPcdDbExMapHash.py, keep them in sync.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/UnitTestLib.h>
+
+#include "../ExMapHash.h"
+
+#define UNIT_TEST_NAME     "PCD ExMap Hash Unit Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+typedef struct {
+  CONST EFI_GUID    *Guid;
+  UINT32            ExTokenNumber;
+  UINT32            Seed;
+  UINT32            Hash;
+} EX_MAP_HASH_VECTOR;
+
+STATIC CONST EFI_GUID  mZeroGuid = {
+  0x00000000, 0x0000, 0x0000, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }
+};
+
+//
+// gEfiMdePkgTokenSpaceGuid
+//
+STATIC CONST EFI_GUID  mMdePkgTokenSpaceGuid = {
+  0x914AEBE7, 0x4635, 0x459b, { 0xAA, 0x1C, 0x11, 0xE2, 0x19, 0xB0, 0x3A, 0x10 }
+};
+
+//
+// gEfiMdeModulePkgTokenSpaceGuid
+//
+STATIC CONST EFI_GUID  mMdeModulePkgTokenSpaceGuid = {
+  0xA1AFF049, 0xFDEB, 0x442a, { 0xB3, 0x20, 0x13, 0xAB, 0x4C, 0xB7, 0x2B, 0xBC }
+};
+
+STATIC CONST EX_MAP_HASH_VECTOR  mVectors[] = {
+  { &mZeroGuid,                   0x00000000, 0x00000, 0xC85D0DC8 },
+  { &mZeroGuid,                   0xFFFFFFFF, 0x10000, 0x685A7EA2 },
+  { &mMdePkgTokenSpaceGuid,       0x00000001, 0x00000, 0x465EF6CA },
+  { &mMdePkgTokenSpaceGuid,       0x30000001, 0x00001, 0xD1DF3C53 },
+  { &mMdePkgTokenSpaceGuid,       0xFFFFFFFF, 0x10000, 0xE48B946F },
+  { &mMdeModulePkgTokenSpaceGuid, 0x00000000, 0x00001, 0x6AEACBFE },
+  { &mMdeModulePkgTokenSpaceGuid, 0x30000001, 0x00000, 0x9DE5BBF1 },
+  { &mMdeModulePkgTokenSpaceGuid, 0xFFFFFFFF, 0x10000, 0x020D6ABE },
+};
+
+/**
+  GetExMapHash() gives the hashes of GenPcdDb.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+HashShouldMatchTheBuildTool (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (mVectors); Index++) {
+    UT_LOG_INFO ("Vector %d\n", Index);
+    UT_ASSERT_EQUAL (GetExMapHash (mVectors[Index].Guid, mVectors[Index].ExTokenNumber, mVectors[Index].Seed), mVectors[Index].Hash);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the ExMap hash
+  and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      HashTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&HashTests, Framework, "PCD ExMap Hash Tests", "Pcd.ExMapHash", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for HashTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (HashTests, "The hash should match the one of GenPcdDb", "Vectors", HashShouldMatchTheBuildTool, NULL, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
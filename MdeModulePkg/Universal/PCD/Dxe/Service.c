@@ -36,6 +36,12 @@ PEI_PCD_DATABASE  *mPeiPcdDbBinary = NULL;
 UINTN             mDxePcdDbSize    = 0;
 DXE_PCD_DATABASE  *mDxePcdDbBinary = NULL;
 
+//
+// Buffer shared by the reads of the HII type PCD variables
+//
+UINT8  *mHiiVariableBuffer     = NULL;
+UINTN  mHiiVariableBufferSize = 0;
+
 /**
   Get Local Token Number by Token Number.
 
@@ -480,12 +486,10 @@ GetWorker (
           //
           // If the operation is successful, we copy the data
           // to the default value buffer in the PCD Database.
-          // So that we can free the Data allocated in GetHiiVariable.
+          // So that the Data buffer can be reused by the next GetHiiVariable.
           //
           CopyMem (VaraiableDefaultBuffer, Data + VariableHead->Offset, GetSize);
         }
-
-        FreePool (Data);
       }
 
       RetPtr = (VOID *)VaraiableDefaultBuffer;
@@ -955,9 +959,13 @@ BuildPcdDxeDataBase (
 /**
   Get Variable which contains HII type PCD entry.
 
+  The variable is read into a buffer shared by all the HII type PCDs, which
+  only grows. The variable is read once unless it does not fit in the buffer.
+  It is not cached, as the variable may be set without the PCD services.
+
   @param VariableGuid    Variable's guid
   @param VariableName    Variable's unicode name string
-  @param VariableData    Variable's data pointer,
+  @param VariableData    Variable's data pointer. It is valid until the next call.
   @param VariableSize    Variable's size.
 
   @return the status of gRT->GetVariable
@@ -972,40 +980,46 @@ GetHiiVariable (
 {
   UINTN       Size;
   EFI_STATUS  Status;
-  UINT8       *Buffer;
-
-  Size   = 0;
-  Buffer = NULL;
 
-  //
-  // Firstly get the real size of HII variable
-  //
+  Size   = mHiiVariableBufferSize;
   Status = gRT->GetVariable (
                   (UINT16 *)VariableName,
                   VariableGuid,
                   NULL,
                   &Size,
-                  Buffer
+                  mHiiVariableBuffer
                   );
 
   //
-  // Allocate buffer to hold whole variable data according to variable size.
+  // Grow the buffer to hold whole variable data according to variable size.
   //
   if (Status == EFI_BUFFER_TOO_SMALL) {
-    Buffer = (UINT8 *)AllocatePool (Size);
+    if (mHiiVariableBuffer != NULL) {
+      FreePool (mHiiVariableBuffer);
+    }
 
-    ASSERT (Buffer != NULL);
+    mHiiVariableBuffer = (UINT8 *)AllocatePool (Size);
+    ASSERT (mHiiVariableBuffer != NULL);
+    if (mHiiVariableBuffer == NULL) {
+      mHiiVariableBufferSize = 0;
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    mHiiVariableBufferSize = Size;
 
     Status = gRT->GetVariable (
                     VariableName,
                     VariableGuid,
                     NULL,
                     &Size,
-                    Buffer
+                    mHiiVariableBuffer
                     );
 
     ASSERT (Status == EFI_SUCCESS);
-    *VariableData = Buffer;
+  }
+
+  if (Status == EFI_SUCCESS) {
+    *VariableData = mHiiVariableBuffer;
     *VariableSize = Size;
   } else {
     //
@@ -1592,21 +1606,36 @@ GetExPcdTokenNumber (
   EFI_GUID           *GuidTable;
   EFI_GUID           *MatchGuid;
   UINTN              MatchGuidIdx;
+  UINT16             *ExMapHash;
 
   if (!mPeiDatabaseEmpty) {
     ExMap     = (DYNAMICEX_MAPPING *)((UINT8 *)mPcdDatabase.PeiDb + mPcdDatabase.PeiDb->ExMapTableOffset);
     GuidTable = (EFI_GUID *)((UINT8 *)mPcdDatabase.PeiDb + mPcdDatabase.PeiDb->GuidTableOffset);
 
-    MatchGuid = ScanGuid (GuidTable, mPeiGuidTableSize, Guid);
+    if (mPcdDatabase.PeiDb->ExMapHashBucketCount != 0) {
+      //
+      // Only the entry in the slot of the pair may match it.
+      //
+      ExMapHash = (UINT16 *)((UINT8 *)mPcdDatabase.PeiDb + mPcdDatabase.PeiDb->ExMapHashTableOffset);
+      Index     = ExMapHash[GetExMapHash (Guid, ExTokenNumber, 0) % mPcdDatabase.PeiDb->ExMapHashBucketCount];
+      Index     = ExMapHash[mPcdDatabase.PeiDb->ExMapHashBucketCount + GetExMapHash (Guid, ExTokenNumber, Index + 1) % mPcdDatabase.PeiDb->ExTokenCount];
+      if ((ExTokenNumber == ExMap[Index].ExTokenNumber) &&
+          CompareGuid (Guid, &GuidTable[ExMap[Index].ExGuidIndex]))
+      {
+        return ExMap[Index].TokenNumber;
+      }
+    } else {
+      MatchGuid = ScanGuid (GuidTable, mPeiGuidTableSize, Guid);
 
-    if (MatchGuid != NULL) {
-      MatchGuidIdx = MatchGuid - GuidTable;
+      if (MatchGuid != NULL) {
+        MatchGuidIdx = MatchGuid - GuidTable;
 
-      for (Index = 0; Index < mPcdDatabase.PeiDb->ExTokenCount; Index++) {
-        if ((ExTokenNumber == ExMap[Index].ExTokenNumber) &&
-            (MatchGuidIdx == ExMap[Index].ExGuidIndex))
-        {
-          return ExMap[Index].TokenNumber;
+        for (Index = 0; Index < mPcdDatabase.PeiDb->ExTokenCount; Index++) {
+          if ((ExTokenNumber == ExMap[Index].ExTokenNumber) &&
+              (MatchGuidIdx == ExMap[Index].ExGuidIndex))
+          {
+            return ExMap[Index].TokenNumber;
+          }
         }
       }
     }
@@ -1615,21 +1644,32 @@ GetExPcdTokenNumber (
   ExMap     = (DYNAMICEX_MAPPING *)((UINT8 *)mPcdDatabase.DxeDb + mPcdDatabase.DxeDb->ExMapTableOffset);
   GuidTable = (EFI_GUID *)((UINT8 *)mPcdDatabase.DxeDb + mPcdDatabase.DxeDb->GuidTableOffset);
 
-  MatchGuid = ScanGuid (GuidTable, mDxeGuidTableSize, Guid);
-  //
-  // We need to ASSERT here. If GUID can't be found in GuidTable, this is a
-  // error in the BUILD system.
-  //
-  ASSERT (MatchGuid != NULL);
-
-  MatchGuidIdx = MatchGuid - GuidTable;
-
-  for (Index = 0; Index < mPcdDatabase.DxeDb->ExTokenCount; Index++) {
+  if (mPcdDatabase.DxeDb->ExMapHashBucketCount != 0) {
+    ExMapHash = (UINT16 *)((UINT8 *)mPcdDatabase.DxeDb + mPcdDatabase.DxeDb->ExMapHashTableOffset);
+    Index     = ExMapHash[GetExMapHash (Guid, ExTokenNumber, 0) % mPcdDatabase.DxeDb->ExMapHashBucketCount];
+    Index     = ExMapHash[mPcdDatabase.DxeDb->ExMapHashBucketCount + GetExMapHash (Guid, ExTokenNumber, Index + 1) % mPcdDatabase.DxeDb->ExTokenCount];
     if ((ExTokenNumber == ExMap[Index].ExTokenNumber) &&
-        (MatchGuidIdx == ExMap[Index].ExGuidIndex))
+        CompareGuid (Guid, &GuidTable[ExMap[Index].ExGuidIndex]))
     {
       return ExMap[Index].TokenNumber;
     }
+  } else {
+    MatchGuid = ScanGuid (GuidTable, mDxeGuidTableSize, Guid);
+    //
+    // We need to ASSERT here. If GUID can't be found in GuidTable, this is a
+    // error in the BUILD system.
+    //
+    ASSERT (MatchGuid != NULL);
+
+    MatchGuidIdx = MatchGuid - GuidTable;
+
+    for (Index = 0; Index < mPcdDatabase.DxeDb->ExTokenCount; Index++) {
+      if ((ExTokenNumber == ExMap[Index].ExTokenNumber) &&
+          (MatchGuidIdx == ExMap[Index].ExGuidIndex))
+      {
+        return ExMap[Index].TokenNumber;
+      }
+    }
   }
 
   DEBUG ((DEBUG_ERROR, "%a: Failed to find PCD with GUID: %g and token number: %d\n", __func__, Guid, ExTokenNumber));
@@ -29,11 +29,13 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/BaseMemoryLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
 
+#include "../Common/ExMapHash.h"
+
 //
 // Please make sure the PCD Serivce DXE Version is consistent with
 // the version of the generated DXE PCD Database by build tool.
 //
-#define PCD_SERVICE_DXE_VERSION  7
+#define PCD_SERVICE_DXE_VERSION  8
 
 //
 // PCD_DXE_SERVICE_DRIVER_VERSION is defined in Autogen.h.
@@ -961,7 +963,7 @@ ExGetWorker (
 
   @param VariableGuid    Variable's guid
   @param VariableName    Variable's unicode name string
-  @param VariableData    Variable's data pointer,
+  @param VariableData    Variable's data pointer. It is valid until the next call.
   @param VariableSize    Variable's size.
 
   @return the status of gRT->GetVariable
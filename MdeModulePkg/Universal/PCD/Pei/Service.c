@@ -984,12 +984,29 @@ GetExPcdTokenNumber (
   EFI_GUID           *MatchGuid;
   UINTN              MatchGuidIdx;
   PEI_PCD_DATABASE   *PeiPcdDb;
+  UINT16             *ExMapHash;
 
   PeiPcdDb = GetPcdDatabase ();
 
   ExMap     = (DYNAMICEX_MAPPING *)((UINT8 *)PeiPcdDb + PeiPcdDb->ExMapTableOffset);
   GuidTable = (EFI_GUID *)((UINT8 *)PeiPcdDb + PeiPcdDb->GuidTableOffset);
 
+  if (PeiPcdDb->ExMapHashBucketCount != 0) {
+    //
+    // Only the entry in the slot of the pair may match it.
+    //
+    ExMapHash = (UINT16 *)((UINT8 *)PeiPcdDb + PeiPcdDb->ExMapHashTableOffset);
+    Index     = ExMapHash[GetExMapHash (Guid, (UINT32)ExTokenNumber, 0) % PeiPcdDb->ExMapHashBucketCount];
+    Index     = ExMapHash[PeiPcdDb->ExMapHashBucketCount + GetExMapHash (Guid, (UINT32)ExTokenNumber, Index + 1) % PeiPcdDb->ExTokenCount];
+    if ((ExTokenNumber == ExMap[Index].ExTokenNumber) &&
+        CompareGuid (Guid, &GuidTable[ExMap[Index].ExGuidIndex]))
+    {
+      return ExMap[Index].TokenNumber;
+    }
+
+    return PCD_INVALID_TOKEN_NUMBER;
+  }
+
   MatchGuid = ScanGuid (GuidTable, PeiPcdDb->GuidTableCount * sizeof (EFI_GUID), Guid);
   //
   // We need to ASSERT here. If GUID can't be found in GuidTable, this is a
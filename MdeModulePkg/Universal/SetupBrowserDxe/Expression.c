@@ -2514,6 +2514,339 @@ Done:
   return GetTheVal;
 }
 
+/**
+  Resolve a QuestionId referenced by an expression opcode, the way
+  IdToQuestion () looks it up.
+
+  @param  FormSet                FormSet associated with the expression.
+  @param  Form                   Form associated with the expression.
+  @param  QuestionId             Id of the referenced Question.
+  @param  QuestionForm           Returns the Form of the Question if its value
+                                 must be reloaded from the EFI variable before
+                                 each use, NULL otherwise.
+
+  @retval Pointer                The Question.
+  @retval NULL                   Specified Question not found in the formset.
+
+**/
+STATIC
+FORM_BROWSER_STATEMENT *
+ResolveQuestionId (
+  IN  FORM_BROWSER_FORMSET  *FormSet,
+  IN  FORM_BROWSER_FORM     *Form,
+  IN  UINT16                QuestionId,
+  OUT FORM_BROWSER_FORM     **QuestionForm
+  )
+{
+  LIST_ENTRY              *Link;
+  FORM_BROWSER_FORM       *OtherForm;
+  FORM_BROWSER_STATEMENT  *Question;
+
+  *QuestionForm = NULL;
+
+  Question = IdToQuestion2 (Form, QuestionId);
+  if (Question != NULL) {
+    return Question;
+  }
+
+  Link = GetFirstNode (&FormSet->FormListHead);
+  while (!IsNull (&FormSet->FormListHead, Link)) {
+    OtherForm = FORM_BROWSER_FORM_FROM_LINK (Link);
+
+    Question = IdToQuestion2 (OtherForm, QuestionId);
+    if (Question != NULL) {
+      if (Question->Storage->Type == EFI_HII_VARSTORE_EFI_VARIABLE) {
+        *QuestionForm = OtherForm;
+      }
+
+      return Question;
+    }
+
+    Link = GetNextNode (&FormSet->FormListHead, Link);
+  }
+
+  return NULL;
+}
+
+/**
+  Get a Question referenced by an expression opcode, using the Question
+  resolved when the expression was compiled if there is one.
+
+  @param  FormSet                FormSet associated with the expression.
+  @param  Form                   Form associated with the expression.
+  @param  OpCode                 The expression opcode.
+  @param  Index                  0 for QuestionId, 1 for QuestionId2.
+
+  @retval Pointer                The Question.
+  @retval NULL                   Specified Question not found in the formset.
+
+**/
+STATIC
+FORM_BROWSER_STATEMENT *
+GetOpCodeQuestion (
+  IN FORM_BROWSER_FORMSET  *FormSet,
+  IN FORM_BROWSER_FORM     *Form,
+  IN EXPRESSION_OPCODE     *OpCode,
+  IN UINTN                 Index
+  )
+{
+  if (OpCode->Question[Index] == NULL) {
+    return IdToQuestion (FormSet, Form, (Index == 0) ? OpCode->QuestionId : OpCode->QuestionId2);
+  }
+
+  if (OpCode->QuestionForm[Index] != NULL) {
+    //
+    // EFI variable storage may be updated by Callback() asynchronous,
+    // to keep synchronous, always reload the Question Value.
+    //
+    GetQuestionValue (FormSet, OpCode->QuestionForm[Index], OpCode->Question[Index], GetSetValueWithHiiDriver);
+  }
+
+  return OpCode->Question[Index];
+}
+
+/**
+  Check whether the result of an expression opcode only depends on its
+  operands and the values of the Questions it references.
+
+  @param  Operand                The opcode of the expression opcode.
+
+  @retval TRUE                   The opcode has no side effect and does not
+                                 read strings, storages or other formsets.
+  @retval FALSE                  The opcode must be evaluated each time.
+
+**/
+STATIC
+BOOLEAN
+IsCacheableOpCode (
+  IN UINT8  Operand
+  )
+{
+  switch (Operand) {
+    case EFI_IFR_EQ_ID_VAL_OP:
+    case EFI_IFR_EQ_ID_ID_OP:
+    case EFI_IFR_EQ_ID_VAL_LIST_OP:
+    case EFI_IFR_QUESTION_REF1_OP:
+    case EFI_IFR_THIS_OP:
+    case EFI_IFR_DUP_OP:
+    case EFI_IFR_TRUE_OP:
+    case EFI_IFR_FALSE_OP:
+    case EFI_IFR_ONE_OP:
+    case EFI_IFR_ONES_OP:
+    case EFI_IFR_UINT8_OP:
+    case EFI_IFR_UINT16_OP:
+    case EFI_IFR_UINT32_OP:
+    case EFI_IFR_UINT64_OP:
+    case EFI_IFR_UNDEFINED_OP:
+    case EFI_IFR_VERSION_OP:
+    case EFI_IFR_ZERO_OP:
+    case EFI_IFR_NOT_OP:
+    case EFI_IFR_TO_BOOLEAN_OP:
+    case EFI_IFR_TO_UINT_OP:
+    case EFI_IFR_BITWISE_NOT_OP:
+    case EFI_IFR_ADD_OP:
+    case EFI_IFR_SUBTRACT_OP:
+    case EFI_IFR_MULTIPLY_OP:
+    case EFI_IFR_DIVIDE_OP:
+    case EFI_IFR_MODULO_OP:
+    case EFI_IFR_BITWISE_AND_OP:
+    case EFI_IFR_BITWISE_OR_OP:
+    case EFI_IFR_SHIFT_LEFT_OP:
+    case EFI_IFR_SHIFT_RIGHT_OP:
+    case EFI_IFR_AND_OP:
+    case EFI_IFR_OR_OP:
+    case EFI_IFR_EQUAL_OP:
+    case EFI_IFR_NOT_EQUAL_OP:
+    case EFI_IFR_GREATER_EQUAL_OP:
+    case EFI_IFR_GREATER_THAN_OP:
+    case EFI_IFR_LESS_EQUAL_OP:
+    case EFI_IFR_LESS_THAN_OP:
+    case EFI_IFR_CONDITIONAL_OP:
+      return TRUE;
+
+    default:
+      return FALSE;
+  }
+}
+
+/**
+  Compile an expression for the Form it is evaluated in.
+
+  The QuestionIds referenced by the opcodes are resolved once instead of
+  searching the formset on every evaluation, and the Questions the expression
+  reads are collected. An expression made only of cacheable opcodes, whose
+  Questions are all resolved, keeps its Result until the value of one of these
+  Questions changes.
+
+  If a referenced Question is not found, e.g. because the formset is still
+  being parsed, the expression is compiled again on its next evaluation.
+
+  @param  FormSet                FormSet associated with this expression.
+  @param  Form                   Form associated with this expression.
+  @param  Expression             Expression to compile.
+
+**/
+STATIC
+VOID
+CompileExpression (
+  IN     FORM_BROWSER_FORMSET  *FormSet,
+  IN     FORM_BROWSER_FORM     *Form,
+  IN OUT FORM_EXPRESSION       *Expression
+  )
+{
+  LIST_ENTRY              *Link;
+  EXPRESSION_OPCODE       *OpCode;
+  FORM_BROWSER_STATEMENT  *Question;
+  UINTN                   Index;
+  UINTN                   InputIndex;
+  UINTN                   ReferenceCount;
+  BOOLEAN                 Resolved;
+
+  if (Expression->Inputs != NULL) {
+    FreePool (Expression->Inputs);
+    Expression->Inputs = NULL;
+  }
+
+  if (Expression->InputValues != NULL) {
+    FreePool (Expression->InputValues);
+    Expression->InputValues = NULL;
+  }
+
+  Expression->InputCount   = 0;
+  Expression->ResultValid  = FALSE;
+  Expression->Cacheable    = TRUE;
+  Expression->CompiledForm = Form;
+  Resolved                 = TRUE;
+  ReferenceCount           = 0;
+
+  Link = GetFirstNode (&Expression->OpCodeListHead);
+  while (!IsNull (&Expression->OpCodeListHead, Link)) {
+    OpCode = EXPRESSION_OPCODE_FROM_LINK (Link);
+    Link   = GetNextNode (&Expression->OpCodeListHead, Link);
+
+    OpCode->Question[0] = NULL;
+    OpCode->Question[1] = NULL;
+    if (!IsCacheableOpCode (OpCode->Operand)) {
+      Expression->Cacheable = FALSE;
+    }
+
+    if (OpCode->Operand == EFI_IFR_EQ_ID_ID_OP) {
+      OpCode->Question[1] = ResolveQuestionId (FormSet, Form, OpCode->QuestionId2, &OpCode->QuestionForm[1]);
+      Resolved            = (BOOLEAN)(Resolved && OpCode->Question[1] != NULL);
+    }
+
+    switch (OpCode->Operand) {
+      case EFI_IFR_EQ_ID_ID_OP:
+      case EFI_IFR_EQ_ID_VAL_OP:
+      case EFI_IFR_EQ_ID_VAL_LIST_OP:
+      case EFI_IFR_QUESTION_REF1_OP:
+      case EFI_IFR_THIS_OP:
+        OpCode->Question[0] = ResolveQuestionId (FormSet, Form, OpCode->QuestionId, &OpCode->QuestionForm[0]);
+        Resolved            = (BOOLEAN)(Resolved && OpCode->Question[0] != NULL);
+        break;
+
+      default:
+        break;
+    }
+
+    for (Index = 0; Index < ARRAY_SIZE (OpCode->Question); Index++) {
+      if (OpCode->Question[Index] != NULL) {
+        ReferenceCount++;
+        if (OpCode->QuestionForm[Index] != NULL) {
+          //
+          // The value is reloaded from the EFI variable, it can change
+          // without the browser knowing it.
+          //
+          Expression->Cacheable = FALSE;
+        }
+      }
+    }
+  }
+
+  Expression->Compiled = Resolved;
+  if (!Resolved) {
+    Expression->Cacheable = FALSE;
+  }
+
+  if (!Expression->Cacheable || (ReferenceCount == 0)) {
+    return;
+  }
+
+  Expression->Inputs      = AllocatePool (ReferenceCount * sizeof (FORM_BROWSER_STATEMENT *));
+  Expression->InputValues = AllocatePool (ReferenceCount * sizeof (EFI_HII_VALUE));
+  if ((Expression->Inputs == NULL) || (Expression->InputValues == NULL)) {
+    Expression->Cacheable = FALSE;
+    return;
+  }
+
+  //
+  // Collect each Question the expression depends on once.
+  //
+  Link = GetFirstNode (&Expression->OpCodeListHead);
+  while (!IsNull (&Expression->OpCodeListHead, Link)) {
+    OpCode = EXPRESSION_OPCODE_FROM_LINK (Link);
+    Link   = GetNextNode (&Expression->OpCodeListHead, Link);
+
+    for (Index = 0; Index < ARRAY_SIZE (OpCode->Question); Index++) {
+      Question = OpCode->Question[Index];
+      if (Question == NULL) {
+        continue;
+      }
+
+      for (InputIndex = 0; InputIndex < Expression->InputCount; InputIndex++) {
+        if (Expression->Inputs[InputIndex] == Question) {
+          break;
+        }
+      }
+
+      if (InputIndex == Expression->InputCount) {
+        Expression->Inputs[Expression->InputCount++] = Question;
+      }
+    }
+  }
+}
+
+/**
+  Check whether the values of the Questions an expression depends on are the
+  ones its Result was computed from.
+
+  @param  Expression             The compiled, cacheable expression.
+
+  @retval TRUE                   Result is up to date.
+  @retval FALSE                  The expression must be evaluated again.
+
+**/
+STATIC
+BOOLEAN
+IsExpressionResultValid (
+  IN FORM_EXPRESSION  *Expression
+  )
+{
+  UINTN          Index;
+  EFI_HII_VALUE  *Value;
+
+  if (!Expression->ResultValid) {
+    return FALSE;
+  }
+
+  for (Index = 0; Index < Expression->InputCount; Index++) {
+    Value = &Expression->Inputs[Index]->HiiValue;
+
+    //
+    // Only values held in EFI_HII_VALUE itself can be compared, strings and
+    // buffers may change in place.
+    //
+    if ((Value->Type > EFI_IFR_TYPE_DATE) ||
+        (Value->Type != Expression->InputValues[Index].Type) ||
+        (CompareMem (&Value->Value, &Expression->InputValues[Index].Value, sizeof (EFI_IFR_TYPE_VALUE)) != 0))
+    {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
 /**
   Evaluate the result of a HII expression.
 
@@ -2567,12 +2900,25 @@ EvaluateExpression (
 
   StrPtr = NULL;
 
+  ASSERT (Expression != NULL);
+  if (!Expression->Compiled || (Expression->CompiledForm != Form)) {
+    CompileExpression (FormSet, Form, Expression);
+  }
+
+  //
+  // Keep the result if none of the Questions it depends on has changed.
+  //
+  if (Expression->Cacheable && IsExpressionResultValid (Expression)) {
+    return EFI_SUCCESS;
+  }
+
+  Expression->ResultValid = FALSE;
+
   //
   // Save current stack offset.
   //
   StackOffset = SaveExpressionEvaluationStackOffset ();
 
-  ASSERT (Expression != NULL);
   Expression->Result.Type = EFI_IFR_TYPE_OTHER;
 
   Link = GetFirstNode (&Expression->OpCodeListHead);
@@ -2594,7 +2940,7 @@ EvaluateExpression (
       // Built-in functions
       //
       case EFI_IFR_EQ_ID_VAL_OP:
-        Question = IdToQuestion (FormSet, Form, OpCode->QuestionId);
+        Question = GetOpCodeQuestion (FormSet, Form, OpCode, 0);
         if (Question == NULL) {
           Value->Type = EFI_IFR_TYPE_UNDEFINED;
           break;
@@ -2615,13 +2961,13 @@ EvaluateExpression (
         break;
 
       case EFI_IFR_EQ_ID_ID_OP:
-        Question = IdToQuestion (FormSet, Form, OpCode->QuestionId);
+        Question = GetOpCodeQuestion (FormSet, Form, OpCode, 0);
         if (Question == NULL) {
           Value->Type = EFI_IFR_TYPE_UNDEFINED;
           break;
         }
 
-        Question2 = IdToQuestion (FormSet, Form, OpCode->QuestionId2);
+        Question2 = GetOpCodeQuestion (FormSet, Form, OpCode, 1);
         if (Question2 == NULL) {
           Value->Type = EFI_IFR_TYPE_UNDEFINED;
           break;
@@ -2642,7 +2988,7 @@ EvaluateExpression (
         break;
 
       case EFI_IFR_EQ_ID_VAL_LIST_OP:
-        Question = IdToQuestion (FormSet, Form, OpCode->QuestionId);
+        Question = GetOpCodeQuestion (FormSet, Form, OpCode, 0);
         if (Question == NULL) {
           Value->Type = EFI_IFR_TYPE_UNDEFINED;
           break;
@@ -2669,7 +3015,7 @@ EvaluateExpression (
 
       case EFI_IFR_QUESTION_REF1_OP:
       case EFI_IFR_THIS_OP:
-        Question = IdToQuestion (FormSet, Form, OpCode->QuestionId);
+        Question = GetOpCodeQuestion (FormSet, Form, OpCode, 0);
         if (Question == NULL) {
           Status = EFI_NOT_FOUND;
           goto Done;
@@ -3671,6 +4017,17 @@ Done:
   RestoreExpressionEvaluationStackOffset (StackOffset);
   if (!EFI_ERROR (Status)) {
     CopyMem (&Expression->Result, Value, sizeof (EFI_HII_VALUE));
+
+    //
+    // Callers take ownership of a buffer result, only plain values are kept.
+    //
+    if (Expression->Cacheable && (Expression->Result.Type <= EFI_IFR_TYPE_DATE)) {
+      for (Index = 0; Index < Expression->InputCount; Index++) {
+        CopyMem (&Expression->InputValues[Index], &Expression->Inputs[Index]->HiiValue, sizeof (EFI_HII_VALUE));
+      }
+
+      Expression->ResultValid = TRUE;
+    }
   }
 
   return Status;
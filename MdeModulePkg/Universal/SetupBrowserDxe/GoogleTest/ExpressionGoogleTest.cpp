@@ -0,0 +1,652 @@
+/** @file
+  Unit tests of the compiled IFR expressions of the Setup Browser.
+
+  A formset with two forms holding questions of the same QuestionIds is built
+  in memory. Expressions made of the opcodes CompileExpression () can cache
+  are evaluated compiled and the way the browser interpreted them before, with
+  every QuestionId looked up by IdToQuestion () and no result kept, and the
+  results are compared while the question values change.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+extern "C" {
+  #include "../Setup.h"
+}
+
+////////////////////////////////////////////////////////////////////////
+// Symbol Definitions
+// These are not directly under test - but required to link Expression.c
+////////////////////////////////////////////////////////////////////////
+extern "C" {
+  EFI_RUNTIME_SERVICES                *gRT           = NULL;
+  EFI_DEVICE_PATH_FROM_TEXT_PROTOCOL  *mPathFromText = NULL;
+  CHAR16                              *gEmptyString  = (CHAR16 *)L"";
+
+  VOID
+  DestroyFormSet (
+    IN OUT FORM_BROWSER_FORMSET  *FormSet
+    )
+  {
+  }
+
+  EFI_HII_HANDLE
+  DevicePathToHiiHandle (
+    IN EFI_DEVICE_PATH_PROTOCOL  *DevicePath,
+    IN EFI_GUID                  *FormsetGuid
+    )
+  {
+    return NULL;
+  }
+
+  EFI_STATUS
+  GetQuestionValue (
+    IN FORM_BROWSER_FORMSET         *FormSet,
+    IN FORM_BROWSER_FORM            *Form,
+    IN OUT FORM_BROWSER_STATEMENT   *Question,
+    IN GET_SET_QUESTION_VALUE_WITH  GetValueFrom
+    )
+  {
+    return EFI_SUCCESS;
+  }
+
+  CHAR16 *
+  GetToken (
+    IN  EFI_STRING_ID   Token,
+    IN  EFI_HII_HANDLE  HiiHandle
+    )
+  {
+    return NULL;
+  }
+
+  EFI_STATUS
+  GetValueByName (
+    IN BROWSER_STORAGE              *Storage,
+    IN CHAR16                       *Name,
+    IN OUT CHAR16                   **Value,
+    IN GET_SET_QUESTION_VALUE_WITH  GetValueFrom
+    )
+  {
+    return EFI_NOT_FOUND;
+  }
+
+  EFI_STATUS
+  InitializeFormSet (
+    IN  EFI_HII_HANDLE        Handle,
+    IN OUT EFI_GUID           *FormSetGuid,
+    OUT FORM_BROWSER_FORMSET  *FormSet
+    )
+  {
+    return EFI_NOT_FOUND;
+  }
+
+  EFI_STRING_ID
+  NewString (
+    IN  CHAR16          *String,
+    IN  EFI_HII_HANDLE  HiiHandle
+    )
+  {
+    return 0;
+  }
+
+  EFI_STATUS
+  SetValueByName (
+    IN  BROWSER_STORAGE              *Storage,
+    IN  CHAR16                       *Name,
+    IN  CHAR16                       *Value,
+    IN  GET_SET_QUESTION_VALUE_WITH  SetValueTo,
+    OUT NAME_VALUE_NODE              **ReturnNode
+    )
+  {
+    return EFI_NOT_FOUND;
+  }
+}
+
+#define FORM_COUNT      2
+#define QUESTION_COUNT  4
+
+STATIC UINT16  mValueList[] = { 0, 2, 5 };
+
+class ExpressionTest : public ::testing::Test {
+protected:
+  FORM_BROWSER_FORMSET              FormSet;
+  FORM_BROWSER_FORM                 Form[FORM_COUNT];
+  FORM_BROWSER_STATEMENT            Question[FORM_COUNT][QUESTION_COUNT];
+  BROWSER_STORAGE                   Storage;
+  std::vector<FORM_EXPRESSION *>    Expressions;
+  std::vector<EXPRESSION_OPCODE>    OpCodes;
+
+  //
+  // Question I of each form has QuestionId I + 1 and a value of
+  // 1 << I bytes.
+  //
+  void
+  SetUp (
+    ) override
+  {
+    UINTN  FormIndex;
+    UINTN  Index;
+
+    ZeroMem (&FormSet, sizeof (FormSet));
+    FormSet.Signature = FORM_BROWSER_FORMSET_SIGNATURE;
+    InitializeListHead (&FormSet.FormListHead);
+
+    ZeroMem (&Storage, sizeof (Storage));
+    Storage.Signature = BROWSER_STORAGE_SIGNATURE;
+    Storage.Type      = EFI_HII_VARSTORE_BUFFER;
+
+    for (FormIndex = 0; FormIndex < FORM_COUNT; FormIndex++) {
+      ZeroMem (&Form[FormIndex], sizeof (Form[FormIndex]));
+      Form[FormIndex].Signature = FORM_BROWSER_FORM_SIGNATURE;
+      Form[FormIndex].FormId    = (UINT16)(FormIndex + 1);
+      InitializeListHead (&Form[FormIndex].StatementListHead);
+      InitializeListHead (&Form[FormIndex].ExpressionListHead);
+      InsertTailList (&FormSet.FormListHead, &Form[FormIndex].Link);
+
+      for (Index = 0; Index < QUESTION_COUNT; Index++) {
+        ZeroMem (&Question[FormIndex][Index], sizeof (FORM_BROWSER_STATEMENT));
+        Question[FormIndex][Index].Signature     = FORM_BROWSER_STATEMENT_SIGNATURE;
+        Question[FormIndex][Index].QuestionId    = (EFI_QUESTION_ID)(Index + 1);
+        Question[FormIndex][Index].Storage       = &Storage;
+        Question[FormIndex][Index].HiiValue.Type = (UINT8)(EFI_IFR_TYPE_NUM_SIZE_8 + Index);
+        InsertTailList (&Form[FormIndex].StatementListHead, &Question[FormIndex][Index].Link);
+      }
+    }
+  }
+
+  void
+  TearDown (
+    ) override
+  {
+    UINTN  Index;
+
+    for (Index = 0; Index < Expressions.size (); Index++) {
+      DestroyTestExpression (Expressions[Index]);
+    }
+  }
+
+  VOID
+  SetQuestion (
+    UINTN   FormIndex,
+    UINTN   Index,
+    UINT64  Value
+    )
+  {
+    Question[FormIndex][Index].HiiValue.Value.u64 = 0;
+    CopyMem (&Question[FormIndex][Index].HiiValue.Value, &Value, (UINTN)1 << Index);
+  }
+
+  VOID
+  Op (
+    UINT8  Operand
+    )
+  {
+    EXPRESSION_OPCODE  OpCode;
+
+    ZeroMem (&OpCode, sizeof (OpCode));
+    OpCode.Signature = EXPRESSION_OPCODE_SIGNATURE;
+    OpCode.Operand   = Operand;
+    switch (Operand) {
+      case EFI_IFR_TRUE_OP:
+      case EFI_IFR_FALSE_OP:
+        OpCode.Value.Type    = EFI_IFR_TYPE_BOOLEAN;
+        OpCode.Value.Value.b = (BOOLEAN)(Operand == EFI_IFR_TRUE_OP);
+        break;
+
+      case EFI_IFR_ONE_OP:
+      case EFI_IFR_ZERO_OP:
+        OpCode.Value.Type     = EFI_IFR_TYPE_NUM_SIZE_8;
+        OpCode.Value.Value.u8 = (UINT8)(Operand == EFI_IFR_ONE_OP);
+        break;
+
+      case EFI_IFR_ONES_OP:
+        OpCode.Value.Type      = EFI_IFR_TYPE_NUM_SIZE_64;
+        OpCode.Value.Value.u64 = MAX_UINT64;
+        break;
+
+      case EFI_IFR_VERSION_OP:
+        OpCode.Value.Type      = EFI_IFR_TYPE_NUM_SIZE_16;
+        OpCode.Value.Value.u16 = 0x0230;
+        break;
+
+      case EFI_IFR_UNDEFINED_OP:
+        OpCode.Value.Type = EFI_IFR_TYPE_UNDEFINED;
+        break;
+
+      default:
+        break;
+    }
+
+    OpCodes.push_back (OpCode);
+  }
+
+  VOID
+  OpValue (
+    UINT8   Operand,
+    UINT64  Value
+    )
+  {
+    Op (Operand);
+    OpCodes.back ().Value.Value.u64 = Value;
+    switch (Operand) {
+      case EFI_IFR_UINT8_OP:
+        OpCodes.back ().Value.Type = EFI_IFR_TYPE_NUM_SIZE_8;
+        break;
+      case EFI_IFR_UINT16_OP:
+        OpCodes.back ().Value.Type = EFI_IFR_TYPE_NUM_SIZE_16;
+        break;
+      case EFI_IFR_UINT32_OP:
+        OpCodes.back ().Value.Type = EFI_IFR_TYPE_NUM_SIZE_32;
+        break;
+      default:
+        OpCodes.back ().Value.Type = EFI_IFR_TYPE_NUM_SIZE_64;
+        break;
+    }
+  }
+
+  VOID
+  OpQuestion (
+    UINT8            Operand,
+    EFI_QUESTION_ID  QuestionId,
+    UINT64           Value = 0
+    )
+  {
+    Op (Operand);
+    OpCodes.back ().QuestionId = QuestionId;
+    if (Operand == EFI_IFR_EQ_ID_VAL_OP) {
+      OpCodes.back ().Value.Type      = EFI_IFR_TYPE_NUM_SIZE_16;
+      OpCodes.back ().Value.Value.u16 = (UINT16)Value;
+    } else if (Operand == EFI_IFR_EQ_ID_ID_OP) {
+      OpCodes.back ().QuestionId2 = (EFI_QUESTION_ID)Value;
+    } else if (Operand == EFI_IFR_EQ_ID_VAL_LIST_OP) {
+      OpCodes.back ().ListLength = ARRAY_SIZE (mValueList);
+      OpCodes.back ().ValueList  = mValueList;
+    }
+  }
+
+  //
+  // Expression of the opcodes added since the last call.
+  //
+  FORM_EXPRESSION *
+  NewExpression (
+    VOID
+    )
+  {
+    FORM_EXPRESSION    *Expression;
+    EXPRESSION_OPCODE  *OpCode;
+    UINTN              Index;
+
+    Expression = (FORM_EXPRESSION *)AllocateZeroPool (sizeof (FORM_EXPRESSION));
+    EXPECT_NE (Expression, nullptr);
+    Expression->Signature = FORM_EXPRESSION_SIGNATURE;
+    Expression->Type      = EFI_HII_EXPRESSION_SUPPRESS_IF;
+    InitializeListHead (&Expression->OpCodeListHead);
+    for (Index = 0; Index < OpCodes.size (); Index++) {
+      OpCode = (EXPRESSION_OPCODE *)AllocateCopyPool (sizeof (EXPRESSION_OPCODE), &OpCodes[Index]);
+      EXPECT_NE (OpCode, nullptr);
+      InsertTailList (&Expression->OpCodeListHead, &OpCode->Link);
+    }
+
+    OpCodes.clear ();
+    Expressions.push_back (Expression);
+    return Expression;
+  }
+
+  static VOID
+  DestroyTestExpression (
+    FORM_EXPRESSION  *Expression
+    )
+  {
+    LIST_ENTRY  *Link;
+
+    while (!IsListEmpty (&Expression->OpCodeListHead)) {
+      Link = GetFirstNode (&Expression->OpCodeListHead);
+      RemoveEntryList (Link);
+      FreePool (EXPRESSION_OPCODE_FROM_LINK (Link));
+    }
+
+    if (Expression->Inputs != NULL) {
+      FreePool (Expression->Inputs);
+    }
+
+    if (Expression->InputValues != NULL) {
+      FreePool (Expression->InputValues);
+    }
+
+    FreePool (Expression);
+  }
+
+  //
+  // Copy of Expression, evaluated without compiling it.
+  //
+  FORM_EXPRESSION *
+  CloneExpression (
+    FORM_EXPRESSION  *Expression
+    )
+  {
+    LIST_ENTRY         *Link;
+    EXPRESSION_OPCODE  *OpCode;
+
+    for (Link = GetFirstNode (&Expression->OpCodeListHead); !IsNull (&Expression->OpCodeListHead, Link); Link = GetNextNode (&Expression->OpCodeListHead, Link)) {
+      OpCode = EXPRESSION_OPCODE_FROM_LINK (Link);
+      OpCodes.push_back (*OpCode);
+    }
+
+    return NewExpression ();
+  }
+
+  //
+  // Evaluate Expression the way the browser did before expressions were
+  // compiled: every QuestionId is looked up with IdToQuestion () and no result
+  // is kept.
+  //
+  EFI_STATUS
+  Interpret (
+    FORM_BROWSER_FORM  *EvalForm,
+    FORM_EXPRESSION    *Expression
+    )
+  {
+    LIST_ENTRY         *Link;
+    EXPRESSION_OPCODE  *OpCode;
+
+    for (Link = GetFirstNode (&Expression->OpCodeListHead); !IsNull (&Expression->OpCodeListHead, Link); Link = GetNextNode (&Expression->OpCodeListHead, Link)) {
+      OpCode              = EXPRESSION_OPCODE_FROM_LINK (Link);
+      OpCode->Question[0] = NULL;
+      OpCode->Question[1] = NULL;
+    }
+
+    Expression->Compiled     = TRUE;
+    Expression->CompiledForm = EvalForm;
+    Expression->Cacheable    = FALSE;
+    Expression->ResultValid  = FALSE;
+    return EvaluateExpression (&FormSet, EvalForm, Expression);
+  }
+
+  static BOOLEAN
+  SameResult (
+    CONST EFI_HII_VALUE  *Value1,
+    CONST EFI_HII_VALUE  *Value2
+    )
+  {
+    if (Value1->Type != Value2->Type) {
+      return FALSE;
+    }
+
+    if (Value1->Type == EFI_IFR_TYPE_UNDEFINED) {
+      return TRUE;
+    }
+
+    return (BOOLEAN)(CompareMem (&Value1->Value, &Value2->Value, sizeof (EFI_IFR_TYPE_VALUE)) == 0);
+  }
+
+  //
+  // One expression per opcode CompileExpression () can cache, in postfix
+  // order. Question 1 and 2 take small values, so that comparisons go both
+  // ways.
+  //
+  VOID
+  BuildCacheableExpressions (
+    VOID
+    )
+  {
+    STATIC CONST UINT8  Compare[] = {
+      EFI_IFR_EQUAL_OP,        EFI_IFR_NOT_EQUAL_OP,  EFI_IFR_GREATER_EQUAL_OP,
+      EFI_IFR_GREATER_THAN_OP, EFI_IFR_LESS_EQUAL_OP, EFI_IFR_LESS_THAN_OP
+    };
+    UINTN               Index;
+
+    OpQuestion (EFI_IFR_EQ_ID_VAL_OP, 1, 3);
+    NewExpression ();
+    OpQuestion (EFI_IFR_EQ_ID_ID_OP, 1, 2);
+    NewExpression ();
+    OpQuestion (EFI_IFR_EQ_ID_VAL_LIST_OP, 2);
+    NewExpression ();
+    OpQuestion (EFI_IFR_QUESTION_REF1_OP, 1);
+    OpValue (EFI_IFR_UINT8_OP, 2);
+    Op (EFI_IFR_ADD_OP);
+    NewExpression ();
+    OpQuestion (EFI_IFR_THIS_OP, 3);
+    OpValue (EFI_IFR_UINT16_OP, 7);
+    Op (EFI_IFR_MULTIPLY_OP);
+    NewExpression ();
+    OpQuestion (EFI_IFR_QUESTION_REF1_OP, 4);
+    OpValue (EFI_IFR_UINT32_OP, 3);
+    Op (EFI_IFR_DIVIDE_OP);
+    NewExpression ();
+    OpQuestion (EFI_IFR_QUESTION_REF1_OP, 3);
+    OpValue (EFI_IFR_UINT64_OP, 5);
+    Op (EFI_IFR_MODULO_OP);
+    NewExpression ();
+    OpQuestion (EFI_IFR_QUESTION_REF1_OP, 2);
+    OpQuestion (EFI_IFR_QUESTION_REF1_OP, 1);
+    Op (EFI_IFR_SUBTRACT_OP);
+    NewExpression ();
+    OpQuestion (EFI_IFR_QUESTION_REF1_OP, 4);
+    OpValue (EFI_IFR_UINT64_OP, 0xF0F0);
+    Op (EFI_IFR_BITWISE_AND_OP);
+    OpQuestion (EFI_IFR_QUESTION_REF1_OP, 1);
+    Op (EFI_IFR_BITWISE_OR_OP);
+    NewExpression ();
+    OpQuestion (EFI_IFR_QUESTION_REF1_OP, 3);
+    OpQuestion (EFI_IFR_QUESTION_REF1_OP, 1);
+    Op (EFI_IFR_SHIFT_LEFT_OP);
+    OpQuestion (EFI_IFR_QUESTION_REF1_OP, 2);
+    Op (EFI_IFR_SHIFT_RIGHT_OP);
+    NewExpression ();
+    OpQuestion (EFI_IFR_QUESTION_REF1_OP, 4);
+    Op (EFI_IFR_BITWISE_NOT_OP);
+    NewExpression ();
+    OpQuestion (EFI_IFR_QUESTION_REF1_OP, 2);
+    Op (EFI_IFR_TO_BOOLEAN_OP);
+    Op (EFI_IFR_NOT_OP);
+    NewExpression ();
+    OpQuestion (EFI_IFR_EQ_ID_VAL_OP, 2, 1);
+    Op (EFI_IFR_TO_UINT_OP);
+    NewExpression ();
+    OpQuestion (EFI_IFR_QUESTION_REF1_OP, 1);
+    Op (EFI_IFR_DUP_OP);
+    Op (EFI_IFR_EQUAL_OP);
+    NewExpression ();
+
+    for (Index = 0; Index < ARRAY_SIZE (Compare); Index++) {
+      OpQuestion (EFI_IFR_QUESTION_REF1_OP, 1);
+      OpQuestion (EFI_IFR_QUESTION_REF1_OP, 2);
+      Op (Compare[Index]);
+      NewExpression ();
+    }
+
+    OpQuestion (EFI_IFR_EQ_ID_VAL_OP, 1, 0);
+    Op (EFI_IFR_TRUE_OP);
+    Op (EFI_IFR_AND_OP);
+    OpQuestion (EFI_IFR_EQ_ID_ID_OP, 1, 2);
+    Op (EFI_IFR_FALSE_OP);
+    Op (EFI_IFR_OR_OP);
+    Op (EFI_IFR_OR_OP);
+    NewExpression ();
+    OpQuestion (EFI_IFR_EQ_ID_VAL_LIST_OP, 1);
+    Op (EFI_IFR_ONES_OP);
+    OpQuestion (EFI_IFR_QUESTION_REF1_OP, 3);
+    Op (EFI_IFR_CONDITIONAL_OP);
+    NewExpression ();
+    OpQuestion (EFI_IFR_EQ_ID_VAL_OP, 2, 0);
+    Op (EFI_IFR_ONE_OP);
+    Op (EFI_IFR_ZERO_OP);
+    Op (EFI_IFR_CONDITIONAL_OP);
+    Op (EFI_IFR_VERSION_OP);
+    Op (EFI_IFR_ADD_OP);
+    NewExpression ();
+    OpQuestion (EFI_IFR_QUESTION_REF1_OP, 1);
+    Op (EFI_IFR_UNDEFINED_OP);
+    Op (EFI_IFR_ADD_OP);
+    NewExpression ();
+  }
+};
+
+TEST_F (ExpressionTest, CompiledMatchesInterpreted) {
+  std::vector<FORM_EXPRESSION *>  Interpreted;
+  std::mt19937                    Random (1);
+  EFI_STATUS                      Status;
+  UINTN                           Count;
+  UINTN                           Round;
+  UINTN                           FormIndex;
+  UINTN                           Index;
+
+  BuildCacheableExpressions ();
+  Count = Expressions.size ();
+  for (Index = 0; Index < Count; Index++) {
+    Interpreted.push_back (CloneExpression (Expressions[Index]));
+  }
+
+  for (Round = 0; Round < 2000; Round++) {
+    //
+    // Change one value, or none, and stay on a form most of the time.
+    //
+    FormIndex = (Round / 100) % FORM_COUNT;
+    Index     = Random () % (QUESTION_COUNT + 1);
+    if (Index < 2) {
+      SetQuestion (FormIndex, Index, Random () % 4);
+    } else if (Index < QUESTION_COUNT) {
+      SetQuestion (FormIndex, Index, Random ());
+    }
+
+    for (Index = 0; Index < Count; Index++) {
+      Status = Interpret (&Form[FormIndex], Interpreted[Index]);
+      ASSERT_EQ (EvaluateExpression (&FormSet, &Form[FormIndex], Expressions[Index]), Status) << "Expression " << Index;
+      if (!EFI_ERROR (Status)) {
+        EXPECT_TRUE (SameResult (&Expressions[Index]->Result, &Interpreted[Index]->Result)) << "Expression " << Index << " round " << Round;
+      }
+
+      EXPECT_TRUE (Expressions[Index]->Cacheable) << "Expression " << Index;
+      EXPECT_EQ (Expressions[Index]->CompiledForm, &Form[FormIndex]);
+    }
+  }
+}
+
+TEST_F (ExpressionTest, QuestionValueChangeInvalidatesResult) {
+  FORM_EXPRESSION  *Expression;
+
+  OpQuestion (EFI_IFR_QUESTION_REF1_OP, 1);
+  OpQuestion (EFI_IFR_QUESTION_REF1_OP, 4);
+  Op (EFI_IFR_ADD_OP);
+  Expression = NewExpression ();
+
+  SetQuestion (0, 0, 1);
+  SetQuestion (0, 3, 10);
+  ASSERT_EQ (EvaluateExpression (&FormSet, &Form[0], Expression), EFI_SUCCESS);
+  EXPECT_EQ (Expression->Result.Value.u64, 11U);
+  EXPECT_TRUE (Expression->ResultValid);
+  EXPECT_EQ (Expression->InputCount, 2U);
+
+  //
+  // While the inputs are unchanged, the kept result is returned without
+  // evaluating the opcodes.
+  //
+  Expression->Result.Value.u64 = 0xBAD;
+  ASSERT_EQ (EvaluateExpression (&FormSet, &Form[0], Expression), EFI_SUCCESS);
+  EXPECT_EQ (Expression->Result.Value.u64, 0xBADU);
+
+  SetQuestion (0, 3, 20);
+  ASSERT_EQ (EvaluateExpression (&FormSet, &Form[0], Expression), EFI_SUCCESS);
+  EXPECT_EQ (Expression->Result.Value.u64, 21U);
+
+  //
+  // A question of another form with the same QuestionId is not an input.
+  //
+  SetQuestion (1, 0, 5);
+  Expression->Result.Value.u64 = 0xBAD;
+  ASSERT_EQ (EvaluateExpression (&FormSet, &Form[0], Expression), EFI_SUCCESS);
+  EXPECT_EQ (Expression->Result.Value.u64, 0xBADU);
+
+  //
+  // A value changing type is a change even if its bytes are the same.
+  //
+  Question[0][0].HiiValue.Type = EFI_IFR_TYPE_NUM_SIZE_16;
+  ASSERT_EQ (EvaluateExpression (&FormSet, &Form[0], Expression), EFI_SUCCESS);
+  EXPECT_EQ (Expression->Result.Value.u64, 21U);
+}
+
+TEST_F (ExpressionTest, FormChangeRecompiles) {
+  FORM_EXPRESSION         *Expression;
+  FORM_BROWSER_STATEMENT  Added;
+
+  OpQuestion (EFI_IFR_EQ_ID_VAL_OP, 1, 2);
+  Expression = NewExpression ();
+
+  SetQuestion (0, 0, 2);
+  SetQuestion (1, 0, 3);
+  ASSERT_EQ (EvaluateExpression (&FormSet, &Form[0], Expression), EFI_SUCCESS);
+  EXPECT_TRUE (Expression->Result.Value.b);
+  EXPECT_EQ (Expression->CompiledForm, &Form[0]);
+
+  //
+  // Evaluated in the other form, QuestionId 1 is the question of that form.
+  //
+  ASSERT_EQ (EvaluateExpression (&FormSet, &Form[1], Expression), EFI_SUCCESS);
+  EXPECT_FALSE (Expression->Result.Value.b);
+  EXPECT_EQ (Expression->CompiledForm, &Form[1]);
+  EXPECT_EQ (Expression->Inputs[0], &Question[1][0]);
+
+  ASSERT_EQ (EvaluateExpression (&FormSet, &Form[0], Expression), EFI_SUCCESS);
+  EXPECT_TRUE (Expression->Result.Value.b);
+
+  //
+  // A QuestionId not in the formset yet leaves the expression uncompiled and
+  // uncached, until the question is added.
+  //
+  OpQuestion (EFI_IFR_EQ_ID_VAL_OP, QUESTION_COUNT + 1, 9);
+  Expression = NewExpression ();
+  ASSERT_EQ (EvaluateExpression (&FormSet, &Form[0], Expression), EFI_SUCCESS);
+  EXPECT_EQ (Expression->Result.Type, EFI_IFR_TYPE_UNDEFINED);
+  EXPECT_FALSE (Expression->Compiled);
+  EXPECT_FALSE (Expression->Cacheable);
+
+  ZeroMem (&Added, sizeof (Added));
+  Added.Signature          = FORM_BROWSER_STATEMENT_SIGNATURE;
+  Added.QuestionId         = QUESTION_COUNT + 1;
+  Added.Storage            = &Storage;
+  Added.HiiValue.Type      = EFI_IFR_TYPE_NUM_SIZE_16;
+  Added.HiiValue.Value.u16 = 9;
+  InsertTailList (&Form[1].StatementListHead, &Added.Link);
+
+  ASSERT_EQ (EvaluateExpression (&FormSet, &Form[0], Expression), EFI_SUCCESS);
+  EXPECT_TRUE (Expression->Compiled);
+  EXPECT_TRUE (Expression->Cacheable);
+  EXPECT_EQ (Expression->Result.Type, EFI_IFR_TYPE_BOOLEAN);
+  EXPECT_TRUE (Expression->Result.Value.b);
+
+  Added.HiiValue.Value.u16 = 8;
+  ASSERT_EQ (EvaluateExpression (&FormSet, &Form[0], Expression), EFI_SUCCESS);
+  EXPECT_FALSE (Expression->Result.Value.b);
+  RemoveEntryList (&Added.Link);
+}
+
+TEST_F (ExpressionTest, UncacheableOpCodeIsEvaluatedEachTime) {
+  FORM_EXPRESSION  *Expression;
+
+  OpQuestion (EFI_IFR_QUESTION_REF1_OP, 1);
+  Op (EFI_IFR_LENGTH_OP);
+  Expression = NewExpression ();
+
+  ASSERT_EQ (EvaluateExpression (&FormSet, &Form[0], Expression), EFI_SUCCESS);
+  EXPECT_TRUE (Expression->Compiled);
+  EXPECT_FALSE (Expression->Cacheable);
+  EXPECT_FALSE (Expression->ResultValid);
+  EXPECT_EQ (Expression->Result.Type, EFI_IFR_TYPE_UNDEFINED);
+
+  Expression->Result.Type = EFI_IFR_TYPE_OTHER;
+  ASSERT_EQ (EvaluateExpression (&FormSet, &Form[0], Expression), EFI_SUCCESS);
+  EXPECT_EQ (Expression->Result.Type, EFI_IFR_TYPE_UNDEFINED);
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  testing::InitGoogleTest (&argc, argv);
+  return RUN_ALL_TESTS ();
+}
@@ -739,6 +739,14 @@ DestroyExpression (
     }
   }
 
+  if (Expression->Inputs != NULL) {
+    FreePool (Expression->Inputs);
+  }
+
+  if (Expression->InputValues != NULL) {
+    FreePool (Expression->InputValues);
+  }
+
   //
   // Free this Expression
   //
@@ -180,35 +180,46 @@ typedef union {
   UINT16           VarOffset;
 } VAR_STORE_INFO;
 
+typedef struct _FORM_BROWSER_STATEMENT FORM_BROWSER_STATEMENT;
+typedef struct _FORM_BROWSER_FORM      FORM_BROWSER_FORM;
+
 #define EXPRESSION_OPCODE_SIGNATURE  SIGNATURE_32 ('E', 'X', 'O', 'P')
 
 typedef struct {
-  UINTN              Signature;
-  LIST_ENTRY         Link;
+  UINTN                     Signature;
+  LIST_ENTRY                Link;
+
+  UINT8                     Operand;
 
-  UINT8              Operand;
+  UINT8                     Format;     // For EFI_IFR_TO_STRING, EFI_IFR_FIND
+  UINT8                     Flags;      // For EFI_IFR_SPAN
+  UINT8                     RuleId;     // For EFI_IFR_RULE_REF
 
-  UINT8              Format;     // For EFI_IFR_TO_STRING, EFI_IFR_FIND
-  UINT8              Flags;      // For EFI_IFR_SPAN
-  UINT8              RuleId;     // For EFI_IFR_RULE_REF
+  EFI_HII_VALUE             Value;      // For EFI_IFR_EQ_ID_VAL, EFI_IFR_UINT64, EFI_IFR_UINT32, EFI_IFR_UINT16, EFI_IFR_UINT8, EFI_IFR_STRING_REF1
 
-  EFI_HII_VALUE      Value;      // For EFI_IFR_EQ_ID_VAL, EFI_IFR_UINT64, EFI_IFR_UINT32, EFI_IFR_UINT16, EFI_IFR_UINT8, EFI_IFR_STRING_REF1
+  EFI_QUESTION_ID           QuestionId; // For EFI_IFR_EQ_ID_ID, EFI_IFR_EQ_ID_VAL_LIST, EFI_IFR_QUESTION_REF1
+  EFI_QUESTION_ID           QuestionId2;
 
-  EFI_QUESTION_ID    QuestionId; // For EFI_IFR_EQ_ID_ID, EFI_IFR_EQ_ID_VAL_LIST, EFI_IFR_QUESTION_REF1
-  EFI_QUESTION_ID    QuestionId2;
+  UINT16                    ListLength; // For EFI_IFR_EQ_ID_VAL_LIST
+  UINT16                    *ValueList;
 
-  UINT16             ListLength; // For EFI_IFR_EQ_ID_VAL_LIST
-  UINT16             *ValueList;
+  EFI_STRING_ID             DevicePath; // For EFI_IFR_QUESTION_REF3_2, EFI_IFR_QUESTION_REF3_3
+  EFI_GUID                  Guid;
 
-  EFI_STRING_ID      DevicePath; // For EFI_IFR_QUESTION_REF3_2, EFI_IFR_QUESTION_REF3_3
-  EFI_GUID           Guid;
+  BROWSER_STORAGE           *VarStorage;       // For EFI_IFR_SET, EFI_IFR_GET
+  VAR_STORE_INFO            VarStoreInfo;      // For EFI_IFR_SET, EFI_IFR_GET
+  UINT8                     ValueType;         // For EFI_IFR_SET, EFI_IFR_GET
+  UINT8                     ValueWidth;        // For EFI_IFR_SET, EFI_IFR_GET
+  CHAR16                    *ValueName;        // For EFI_IFR_SET, EFI_IFR_GET
+  LIST_ENTRY                MapExpressionList; // nested expressions inside of Map opcode.
 
-  BROWSER_STORAGE    *VarStorage;       // For EFI_IFR_SET, EFI_IFR_GET
-  VAR_STORE_INFO     VarStoreInfo;      // For EFI_IFR_SET, EFI_IFR_GET
-  UINT8              ValueType;         // For EFI_IFR_SET, EFI_IFR_GET
-  UINT8              ValueWidth;        // For EFI_IFR_SET, EFI_IFR_GET
-  CHAR16             *ValueName;        // For EFI_IFR_SET, EFI_IFR_GET
-  LIST_ENTRY         MapExpressionList; // nested expressions inside of Map opcode.
+  //
+  // Questions of QuestionId and QuestionId2 resolved when the expression is
+  // compiled. QuestionForm is not NULL if the Question value is reloaded from
+  // the EFI variable before each use, the way IdToQuestion() does.
+  //
+  FORM_BROWSER_STATEMENT    *Question[2];
+  FORM_BROWSER_FORM         *QuestionForm[2];
 } EXPRESSION_OPCODE;
 
 #define EXPRESSION_OPCODE_FROM_LINK(a)  CR (a, EXPRESSION_OPCODE, Link, EXPRESSION_OPCODE_SIGNATURE)
@@ -216,20 +227,33 @@ typedef struct {
 #define FORM_EXPRESSION_SIGNATURE  SIGNATURE_32 ('F', 'E', 'X', 'P')
 
 typedef struct {
-  UINTN                Signature;
-  LIST_ENTRY           Link;
+  UINTN                     Signature;
+  LIST_ENTRY                Link;
+
+  UINT8                     Type;         // Type for this expression
 
-  UINT8                Type;         // Type for this expression
+  UINT8                     RuleId;       // For EFI_IFR_RULE only
+  EFI_STRING_ID             Error;        // For EFI_IFR_NO_SUBMIT_IF, EFI_IFR_INCONSISTENT_IF only
 
-  UINT8                RuleId;       // For EFI_IFR_RULE only
-  EFI_STRING_ID        Error;        // For EFI_IFR_NO_SUBMIT_IF, EFI_IFR_INCONSISTENT_IF only
+  EFI_HII_VALUE             Result;       // Expression evaluation result
 
-  EFI_HII_VALUE        Result;       // Expression evaluation result
+  UINT8                     TimeOut;      // For EFI_IFR_WARNING_IF
+  EFI_IFR_OP_HEADER         *OpCode;      // Save the opcode buffer.
 
-  UINT8                TimeOut;      // For EFI_IFR_WARNING_IF
-  EFI_IFR_OP_HEADER    *OpCode;      // Save the opcode buffer.
+  LIST_ENTRY                OpCodeListHead; // OpCodes consist of this expression (EXPRESSION_OPCODE)
 
-  LIST_ENTRY           OpCodeListHead; // OpCodes consist of this expression (EXPRESSION_OPCODE)
+  //
+  // Filled in by CompileExpression() when the expression is first evaluated.
+  // A cacheable expression only reads the values of its Inputs, its Result is
+  // kept until one of them changes.
+  //
+  BOOLEAN                   Compiled;
+  FORM_BROWSER_FORM         *CompiledForm;  // Form the QuestionIds were resolved in
+  BOOLEAN                   Cacheable;
+  BOOLEAN                   ResultValid;    // Result matches InputValues
+  UINTN                     InputCount;
+  FORM_BROWSER_STATEMENT    **Inputs;       // Questions the expression depends on
+  EFI_HII_VALUE             *InputValues;   // Input values Result was computed from
 } FORM_EXPRESSION;
 
 #define FORM_EXPRESSION_FROM_LINK(a)  CR (a, FORM_EXPRESSION, Link, FORM_EXPRESSION_SIGNATURE)
@@ -288,8 +312,6 @@ typedef enum {
   ExpressOption
 } EXPRESS_LEVEL;
 
-typedef struct _FORM_BROWSER_STATEMENT FORM_BROWSER_STATEMENT;
-
 #define FORM_BROWSER_STATEMENT_SIGNATURE  SIGNATURE_32 ('F', 'S', 'T', 'A')
 
 struct _FORM_BROWSER_STATEMENT {
@@ -393,7 +415,7 @@ typedef struct {
 #define FORM_BROWSER_FORM_SIGNATURE  SIGNATURE_32 ('F', 'F', 'R', 'M')
 #define STANDARD_MAP_FORM_TYPE       0x01
 
-typedef struct {
+struct _FORM_BROWSER_FORM {
   UINTN                   Signature;
   LIST_ENTRY              Link;
 
@@ -412,7 +434,7 @@ typedef struct {
   LIST_ENTRY              StatementListHead;   // List of Statements and Questions (FORM_BROWSER_STATEMENT)
   LIST_ENTRY              ConfigRequestHead;   // List of configreques for all storage.
   FORM_EXPRESSION_LIST    *SuppressExpression; // nesting inside of SuppressIf
-} FORM_BROWSER_FORM;
+};
 
 #define FORM_BROWSER_FORM_FROM_LINK(a)  CR (a, FORM_BROWSER_FORM, Link, FORM_BROWSER_FORM_SIGNATURE)
 
@@ -0,0 +1,185 @@
+/** @file
+  Measures the cost of the SMI handler dispatch of the SMM core.
+
+  The driver registers SMI_BENCH_HANDLER_COUNT GUID SMI handlers, then times
+  gSmst->SmiManage() in the MM phase for a repeated handler type, for handler
+  types alternating between the first and the last registered ones and for a
+  handler type without handler. The root SMI handlers are not called as they
+  access the hardware. The results are reported
+  with DEBUG_INFO and the handlers are unregistered before the driver returns.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiSmm.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/SmmServicesTableLib.h>
+#include <Library/TimerLib.h>
+
+//
+// Number of GUID SMI handlers registered, about the count of a server platform.
+//
+#define SMI_BENCH_HANDLER_COUNT  64
+
+//
+// Number of SmiManage() calls of each measurement.
+//
+#define SMI_BENCH_ITERATIONS  10000
+
+//
+// Base of the handler types, Data1 is replaced by the handler index.
+//
+#define SMI_BENCH_HANDLER_TYPE_BASE \
+  { 0x00000000, 0x5d1e, 0x4f3a, { 0x9c, 0x2b, 0x7e, 0x41, 0x86, 0x0d, 0xa3, 0x5f } }
+
+EFI_GUID    mSmiBenchHandlerType[SMI_BENCH_HANDLER_COUNT + 1];
+EFI_HANDLE  mSmiBenchDispatchHandle[SMI_BENCH_HANDLER_COUNT];
+UINTN       mSmiBenchCallCount;
+
+/**
+  SMI handler of the benchmark, counts its calls.
+
+  @param DispatchHandle  The unique handle assigned to this handler by SmiHandlerRegister().
+  @param Context         Points to an optional handler context which was specified when the
+                         handler was registered.
+  @param CommBuffer      A pointer to a collection of data in memory that will
+                         be conveyed from a non-SMM environment into an SMM environment.
+  @param CommBufferSize  The size of the CommBuffer.
+
+  @retval EFI_SUCCESS  The call is counted.
+**/
+EFI_STATUS
+EFIAPI
+SmiBenchHandler (
+  IN EFI_HANDLE  DispatchHandle,
+  IN CONST VOID  *Context         OPTIONAL,
+  IN OUT VOID    *CommBuffer      OPTIONAL,
+  IN OUT UINTN   *CommBufferSize  OPTIONAL
+  )
+{
+  mSmiBenchCallCount++;
+  return EFI_SUCCESS;
+}
+
+/**
+  Returns the nanoseconds elapsed since a performance counter value.
+
+  @param StartTicks  The performance counter value at the start of the measurement.
+
+  @return The elapsed time in nanoseconds.
+**/
+UINT64
+SmiBenchElapsedTime (
+  IN UINT64  StartTicks
+  )
+{
+  UINT64  EndTicks;
+  UINT64  StartValue;
+  UINT64  EndValue;
+
+  EndTicks = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&StartValue, &EndValue);
+  if (EndValue >= StartValue) {
+    return GetTimeInNanoSecond (EndTicks - StartTicks);
+  }
+
+  return GetTimeInNanoSecond (StartTicks - EndTicks);
+}
+
+/**
+  Times SMI_BENCH_ITERATIONS calls of gSmst->SmiManage() and reports the time of
+  one call.
+
+  @param Name          The name of the measurement.
+  @param HandlerType   The handler types, used in turn.
+  @param TypeCount     The number of handler types.
+**/
+VOID
+SmiBenchMeasure (
+  IN CONST CHAR8  *Name,
+  IN EFI_GUID     **HandlerType,
+  IN UINTN        TypeCount
+  )
+{
+  UINTN   Index;
+  UINTN   CallCount;
+  UINT64  StartTicks;
+  UINT64  Time;
+
+  CallCount  = mSmiBenchCallCount;
+  StartTicks = GetPerformanceCounter ();
+  for (Index = 0; Index < SMI_BENCH_ITERATIONS; Index++) {
+    gSmst->SmiManage (HandlerType[Index % TypeCount], NULL, NULL, NULL);
+  }
+
+  Time = SmiBenchElapsedTime (StartTicks);
+
+  DEBUG ((
+    DEBUG_INFO,
+    "SmiHandlerBench: %-24a %6ld ns/call, %d handlers called\n",
+    Name,
+    DivU64x32 (Time, SMI_BENCH_ITERATIONS),
+    mSmiBenchCallCount - CallCount
+    ));
+}
+
+/**
+  The module Entry Point of the driver.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       The benchmark completed.
+  @retval Other             Some error occurs when registering the handlers.
+**/
+EFI_STATUS
+EFIAPI
+SmiHandlerBenchEntryPoint (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS      Status;
+  UINTN           Index;
+  UINTN           Count;
+  CONST EFI_GUID  HandlerTypeBase = SMI_BENCH_HANDLER_TYPE_BASE;
+  EFI_GUID        *HandlerType[2];
+
+  //
+  // The last handler type is never registered.
+  //
+  for (Index = 0; Index <= SMI_BENCH_HANDLER_COUNT; Index++) {
+    CopyGuid (&mSmiBenchHandlerType[Index], &HandlerTypeBase);
+    mSmiBenchHandlerType[Index].Data1 = (UINT32)Index;
+  }
+
+  for (Count = 0; Count < SMI_BENCH_HANDLER_COUNT; Count++) {
+    Status = gSmst->SmiHandlerRegister (SmiBenchHandler, &mSmiBenchHandlerType[Count], &mSmiBenchDispatchHandle[Count]);
+    if (EFI_ERROR (Status)) {
+      goto Done;
+    }
+  }
+
+  HandlerType[0] = &mSmiBenchHandlerType[SMI_BENCH_HANDLER_COUNT - 1];
+  SmiBenchMeasure ("Same handler type", HandlerType, 1);
+
+  HandlerType[0] = &mSmiBenchHandlerType[0];
+  HandlerType[1] = &mSmiBenchHandlerType[SMI_BENCH_HANDLER_COUNT - 1];
+  SmiBenchMeasure ("Alternate handler types", HandlerType, 2);
+
+  HandlerType[0] = &mSmiBenchHandlerType[SMI_BENCH_HANDLER_COUNT];
+  SmiBenchMeasure ("Unregistered handler type", HandlerType, 1);
+
+  Status = EFI_SUCCESS;
+
+Done:
+  for (Index = 0; Index < Count; Index++) {
+    gSmst->SmiHandlerUnRegister (mSmiBenchDispatchHandle[Index]);
+  }
+
+  return Status;
+}
@@ -8,6 +8,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
 #include "Variable.h"
+#include "VariableParsing.h"
 
 /**
   Gets LBA of block and offset by given address.
@@ -86,14 +87,476 @@ GetLbaAndOffsetByAddress (
 }
 
 /**
-  Writes a buffer to variable storage space, in the working block.
+  Gets the size of the erase block containing the given address, and the
+  offset of the address in the block.
 
-  This function writes a buffer to variable storage space into a firmware
-  volume block device. The destination is specified by parameter
-  VariableBase. Fault Tolerant Write protocol is used for writing.
+  @param  Address        Address which should be contained
+                         by the FVB device.
+  @param  BlockSize      Pointer to the block size for output.
+  @param  Offset         Pointer to offset for output.
 
-  @param  VariableBase   Base address of variable to write
+  @retval EFI_SUCCESS    The block size and offset are returned.
+  @retval EFI_NOT_FOUND  Fail to find FVB handle by address.
+  @retval EFI_ABORTED    Fail to get the block size and offset.
+
+**/
+EFI_STATUS
+GetBlockSizeAndOffsetByAddress (
+  IN  EFI_PHYSICAL_ADDRESS  Address,
+  OUT UINTN                 *BlockSize,
+  OUT UINTN                 *Offset
+  )
+{
+  EFI_STATUS                          Status;
+  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *Fvb;
+  EFI_LBA                             Lba;
+  UINTN                               NumberOfBlocks;
+
+  Status = GetFvbInfoByAddress (Address, NULL, &Fvb);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = GetLbaAndOffsetByAddress (Address, &Lba, Offset);
+  if (EFI_ERROR (Status)) {
+    return EFI_ABORTED;
+  }
+
+  Status = Fvb->GetBlockSize (Fvb, Lba, BlockSize, &NumberOfBlocks);
+  if (EFI_ERROR (Status) || (*BlockSize == 0)) {
+    return EFI_ABORTED;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Finds the offset from which an incremental reclaim compacts the
+  non-volatile variable store.
+
+  The variables before the offset are kept as they are, including the
+  deleted ones, and the blocks holding them are not written. The offset
+  is the start of the first variable of an erase block, it is chosen as
+  high as possible so that only the dirtiest blocks at the end of the
+  store are rewritten, while compacting the variables from it still leaves
+  RequiredSize bytes free.
+
+  The blocks after the offset are erased by every reclaim, and a reclaim
+  that frees less space is needed sooner. So the deleted bytes kept before
+  the offset are also bounded to half of the space a reclaim of the whole
+  store would free: an incremental reclaim then frees at least half of it,
+  and the tail blocks are erased at most about twice as often as with a
+  reclaim of the whole store, while the blocks before the offset are
+  erased less often.
+
+  @param[in]  VariableStoreHeader         Pointer to the variable store.
+  @param[in]  BlockSize                   Size of the erase blocks of the store.
+  @param[in]  BlockOffset                 Offset of the store header in its erase block.
+  @param[in]  AuthFormat                  TRUE indicates authenticated variables are used.
+                                          FALSE indicates authenticated variables are not used.
+  @param[in]  UpdatingVariable            Variable dropped by the reclaim, it must not be kept.
+  @param[in]  UpdatingInDeletedTransition Variable dropped by the reclaim, it must not be kept.
+  @param[in]  RequiredSize                Free space the reclaim must produce.
+  @param[out] KeepOffset                  Offset from the store header of the first
+                                          compacted variable.
+
+  @retval EFI_SUCCESS    KeepOffset is returned.
+  @retval EFI_NOT_FOUND  Only a reclaim of the whole store frees enough space.
+
+**/
+EFI_STATUS
+GetIncrementalReclaimOffset (
+  IN  VARIABLE_STORE_HEADER  *VariableStoreHeader,
+  IN  UINTN                  BlockSize,
+  IN  UINTN                  BlockOffset,
+  IN  BOOLEAN                AuthFormat,
+  IN  VARIABLE_HEADER        *UpdatingVariable OPTIONAL,
+  IN  VARIABLE_HEADER        *UpdatingInDeletedTransition OPTIONAL,
+  IN  UINTN                  RequiredSize,
+  OUT UINTN                  *KeepOffset
+  )
+{
+  VARIABLE_HEADER  *Variable;
+  VARIABLE_HEADER  *NextVariable;
+  VARIABLE_HEADER  *EndVariable;
+  UINTN            StartOffset;
+  UINTN            Offset;
+  UINTN            VariableSize;
+  UINTN            LiveSize;
+  UINTN            KeptLiveSize;
+  UINTN            DeadBudget;
+  UINTN            LimitOffset;
+  UINTN            Block;
+  UINTN            LastBlock;
+
+  if (BlockSize == 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  EndVariable = GetEndPointer (VariableStoreHeader);
+  StartOffset = (UINTN)GetStartPointer (VariableStoreHeader) - (UINTN)VariableStoreHeader;
+  LimitOffset = VariableStoreHeader->Size;
+  if (UpdatingVariable != NULL) {
+    LimitOffset = MIN (LimitOffset, (UINTN)UpdatingVariable - (UINTN)VariableStoreHeader);
+  }
+
+  if (UpdatingInDeletedTransition != NULL) {
+    LimitOffset = MIN (LimitOffset, (UINTN)UpdatingInDeletedTransition - (UINTN)VariableStoreHeader);
+  }
+
+  //
+  // Count the bytes that a reclaim of the whole store keeps.
+  //
+  LiveSize = 0;
+  Variable = GetStartPointer (VariableStoreHeader);
+  while (IsValidVariableHeader (Variable, EndVariable)) {
+    NextVariable = GetNextVariablePtr (Variable, AuthFormat);
+    if (((Variable->State == VAR_ADDED) || (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) &&
+        (Variable != UpdatingVariable) &&
+        (Variable != UpdatingInDeletedTransition))
+    {
+      LiveSize += (UINTN)NextVariable - (UINTN)Variable;
+    }
+
+    Variable = NextVariable;
+  }
+
+  if (StartOffset + LiveSize + RequiredSize > VariableStoreHeader->Size) {
+    return EFI_NOT_FOUND;
+  }
+
+  //
+  // Every deleted byte kept before the offset is lost for the new variable,
+  // so the kept deleted bytes must stay within the space a reclaim of the
+  // whole store would free beyond RequiredSize. They must also stay within
+  // half of that space, to bound the erases of the tail blocks.
+  //
+  DeadBudget   = VariableStoreHeader->Size - StartOffset - LiveSize;
+  DeadBudget   = MIN (DeadBudget - RequiredSize, DeadBudget / 2);
+  KeptLiveSize = 0;
+  LastBlock    = BlockOffset / BlockSize;
+  *KeepOffset  = 0;
+  Variable     = GetStartPointer (VariableStoreHeader);
+  while (IsValidVariableHeader (Variable, EndVariable)) {
+    NextVariable = GetNextVariablePtr (Variable, AuthFormat);
+    Offset       = (UINTN)Variable - (UINTN)VariableStoreHeader;
+    Block        = (BlockOffset + Offset) / BlockSize;
+    if (Block != LastBlock) {
+      if ((Offset > LimitOffset) || (Offset - StartOffset - KeptLiveSize > DeadBudget)) {
+        break;
+      }
+
+      *KeepOffset = Offset;
+      LastBlock   = Block;
+    }
+
+    VariableSize = (UINTN)NextVariable - (UINTN)Variable;
+    if (((Variable->State == VAR_ADDED) || (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) &&
+        (Variable != UpdatingVariable) &&
+        (Variable != UpdatingInDeletedTransition))
+    {
+      KeptLiveSize += VariableSize;
+    }
+
+    Variable = NextVariable;
+  }
+
+  if (*KeepOffset == 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Adds the size of a variable to the totals of the store, by the kind of
+  storage it uses.
+
+  @param[in]      Variable                     Pointer to the variable header.
+  @param[in]      VariableSize                 Size of the variable.
+  @param[in, out] HwErrVariableTotalSize       Total size of the hardware error record variables.
+  @param[in, out] CommonVariableTotalSize      Total size of the common variables.
+  @param[in, out] CommonUserVariableTotalSize  Total size of the common user variables.
+
+**/
+STATIC
+VOID
+AccountVariableSize (
+  IN     VARIABLE_HEADER  *Variable,
+  IN     UINTN            VariableSize,
+  IN OUT UINTN            *HwErrVariableTotalSize,
+  IN OUT UINTN            *CommonVariableTotalSize,
+  IN OUT UINTN            *CommonUserVariableTotalSize
+  )
+{
+  if ((Variable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) == EFI_VARIABLE_HARDWARE_ERROR_RECORD) {
+    *HwErrVariableTotalSize += VariableSize;
+  } else {
+    *CommonVariableTotalSize += VariableSize;
+    if (IsUserVariable (Variable)) {
+      *CommonUserVariableTotalSize += VariableSize;
+    }
+  }
+}
+
+/**
+  Compacts a variable store into a buffer and integrates a new variable.
+
+  The ADDED variables are copied, except the one being updated, then the
+  IN_DELETED_TRANSITION ones that have no ADDED copy are promoted to ADDED,
+  then the new variable is appended. When KeepOffset is not 0, the store
+  header and the variables before KeepOffset are copied as they are and
+  only the variables from KeepOffset are compacted. If the new variable
+  then does not fit in the store or in its quota, the whole store is
+  compacted instead and KeepOffset is set to 0.
+
+  @param[in]      VariableStoreHeader          Pointer to the variable store.
+  @param[out]     ValidBuffer                  Buffer receiving the compacted store.
+  @param[in]      ValidBufferSize              Size of ValidBuffer.
+  @param[in]      IsVolatile                   The variable store is volatile or not,
+                                               the sizes are only counted for a non-volatile one.
+  @param[in, out] KeepOffset                   Offset from the store header of the first
+                                               compacted variable, 0 to compact the whole
+                                               store. Set to 0 if the whole store is compacted.
+  @param[in, out] UpdatingPtrTrack             Pointer to updating variable pointer track structure.
+  @param[in]      NewVariable                  Pointer to new variable.
+  @param[in]      NewVariableSize              New variable size.
+  @param[out]     ValidSize                    Size of the compacted store in ValidBuffer.
+  @param[out]     HwErrVariableTotalSize       Total size of the hardware error record variables.
+  @param[out]     CommonVariableTotalSize      Total size of the common variables.
+  @param[out]     CommonUserVariableTotalSize  Total size of the common user variables.
+
+  @retval EFI_SUCCESS           The store is compacted in ValidBuffer.
+  @retval EFI_OUT_OF_RESOURCES  The new variable does not fit in the store or in its quota.
+
+**/
+EFI_STATUS
+CompactVariableStore (
+  IN     VARIABLE_STORE_HEADER   *VariableStoreHeader,
+  OUT    UINT8                   *ValidBuffer,
+  IN     UINTN                   ValidBufferSize,
+  IN     BOOLEAN                 IsVolatile,
+  IN OUT UINTN                   *KeepOffset,
+  IN OUT VARIABLE_POINTER_TRACK  *UpdatingPtrTrack OPTIONAL,
+  IN     VARIABLE_HEADER         *NewVariable OPTIONAL,
+  IN     UINTN                   NewVariableSize,
+  OUT    UINTN                   *ValidSize,
+  OUT    UINTN                   *HwErrVariableTotalSize,
+  OUT    UINTN                   *CommonVariableTotalSize,
+  OUT    UINTN                   *CommonUserVariableTotalSize
+  )
+{
+  VARIABLE_HEADER  *Variable;
+  VARIABLE_HEADER  *AddedVariable;
+  VARIABLE_HEADER  *NextVariable;
+  VARIABLE_HEADER  *NextAddedVariable;
+  VARIABLE_HEADER  *FirstVariable;
+  VARIABLE_HEADER  *UpdatingVariable;
+  VARIABLE_HEADER  *UpdatingInDeletedTransition;
+  UINTN            VariableSize;
+  UINTN            NameSize;
+  UINT8            *CurrPtr;
+  VOID             *Point0;
+  VOID             *Point1;
+  BOOLEAN          FoundAdded;
+  BOOLEAN          AuthFormat;
+
+  AuthFormat                  = mVariableModuleGlobal->VariableGlobal.AuthFormat;
+  UpdatingVariable            = NULL;
+  UpdatingInDeletedTransition = NULL;
+  if (UpdatingPtrTrack != NULL) {
+    UpdatingVariable            = UpdatingPtrTrack->CurrPtr;
+    UpdatingInDeletedTransition = UpdatingPtrTrack->InDeletedTransitionPtr;
+  }
+
+Compact:
+  *HwErrVariableTotalSize      = 0;
+  *CommonVariableTotalSize     = 0;
+  *CommonUserVariableTotalSize = 0;
+
+  SetMem (ValidBuffer, ValidBufferSize, 0xff);
+
+  if (*KeepOffset == 0) {
+    //
+    // Copy variable store header.
+    //
+    CopyMem (ValidBuffer, VariableStoreHeader, sizeof (VARIABLE_STORE_HEADER));
+    CurrPtr       = (UINT8 *)GetStartPointer ((VARIABLE_STORE_HEADER *)ValidBuffer);
+    FirstVariable = GetStartPointer (VariableStoreHeader);
+  } else {
+    //
+    // Copy variable store header and the variables before KeepOffset as they are.
+    // The deleted ones still use their space, so they are counted too.
+    //
+    CopyMem (ValidBuffer, VariableStoreHeader, *KeepOffset);
+    CurrPtr       = ValidBuffer + *KeepOffset;
+    FirstVariable = (VARIABLE_HEADER *)((UINTN)VariableStoreHeader + *KeepOffset);
+    Variable      = GetStartPointer (VariableStoreHeader);
+    while (Variable < FirstVariable) {
+      NextVariable = GetNextVariablePtr (Variable, AuthFormat);
+      AccountVariableSize (
+        Variable,
+        (UINTN)NextVariable - (UINTN)Variable,
+        HwErrVariableTotalSize,
+        CommonVariableTotalSize,
+        CommonUserVariableTotalSize
+        );
+      Variable = NextVariable;
+    }
+  }
+
+  //
+  // Reinstall all ADDED variables as long as they are not identical to Updating Variable.
+  //
+  Variable = FirstVariable;
+  while (IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))) {
+    NextVariable = GetNextVariablePtr (Variable, AuthFormat);
+    if ((Variable != UpdatingVariable) && (Variable->State == VAR_ADDED)) {
+      VariableSize = (UINTN)NextVariable - (UINTN)Variable;
+      CopyMem (CurrPtr, (UINT8 *)Variable, VariableSize);
+      CurrPtr += VariableSize;
+      if (!IsVolatile) {
+        AccountVariableSize (
+          Variable,
+          VariableSize,
+          HwErrVariableTotalSize,
+          CommonVariableTotalSize,
+          CommonUserVariableTotalSize
+          );
+      }
+    }
+
+    Variable = NextVariable;
+  }
+
+  //
+  // Reinstall all in delete transition variables.
+  //
+  Variable = FirstVariable;
+  while (IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))) {
+    NextVariable = GetNextVariablePtr (Variable, AuthFormat);
+    if ((Variable != UpdatingVariable) && (Variable != UpdatingInDeletedTransition) && (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
+      //
+      // Buffer has cached all ADDED variable.
+      // Per IN_DELETED variable, we have to guarantee that
+      // no ADDED one in previous buffer. The variables kept
+      // before KeepOffset may be in any state, only the
+      // ADDED ones are checked.
+      //
+
+      FoundAdded    = FALSE;
+      AddedVariable = GetStartPointer ((VARIABLE_STORE_HEADER *)ValidBuffer);
+      while (IsValidVariableHeader (AddedVariable, GetEndPointer ((VARIABLE_STORE_HEADER *)ValidBuffer))) {
+        NextAddedVariable = GetNextVariablePtr (AddedVariable, AuthFormat);
+        NameSize          = NameSizeOfVariable (AddedVariable, AuthFormat);
+        if ((AddedVariable->State == VAR_ADDED) &&
+            CompareGuid (GetVendorGuidPtr (AddedVariable, AuthFormat), GetVendorGuidPtr (Variable, AuthFormat)) &&
+            (NameSize == NameSizeOfVariable (Variable, AuthFormat)))
+        {
+          Point0 = (VOID *)GetVariableNamePtr (AddedVariable, AuthFormat);
+          Point1 = (VOID *)GetVariableNamePtr (Variable, AuthFormat);
+          if (CompareMem (Point0, Point1, NameSize) == 0) {
+            FoundAdded = TRUE;
+            break;
+          }
+        }
+
+        AddedVariable = NextAddedVariable;
+      }
+
+      if (!FoundAdded) {
+        //
+        // Promote VAR_IN_DELETED_TRANSITION to VAR_ADDED.
+        //
+        VariableSize = (UINTN)NextVariable - (UINTN)Variable;
+        CopyMem (CurrPtr, (UINT8 *)Variable, VariableSize);
+        ((VARIABLE_HEADER *)CurrPtr)->State = VAR_ADDED;
+        CurrPtr                            += VariableSize;
+        if (!IsVolatile) {
+          AccountVariableSize (
+            Variable,
+            VariableSize,
+            HwErrVariableTotalSize,
+            CommonVariableTotalSize,
+            CommonUserVariableTotalSize
+            );
+        }
+      }
+    }
+
+    Variable = NextVariable;
+  }
+
+  //
+  // Install the new variable if it is not NULL.
+  //
+  if (NewVariable != NULL) {
+    if (((UINTN)CurrPtr - (UINTN)ValidBuffer) + NewVariableSize > VariableStoreHeader->Size) {
+      if (*KeepOffset != 0) {
+        *KeepOffset = 0;
+        goto Compact;
+      }
+
+      //
+      // No enough space to store the new variable.
+      //
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    if (!IsVolatile) {
+      AccountVariableSize (
+        NewVariable,
+        NewVariableSize,
+        HwErrVariableTotalSize,
+        CommonVariableTotalSize,
+        CommonUserVariableTotalSize
+        );
+
+      if ((*HwErrVariableTotalSize > PcdGet32 (PcdHwErrStorageSize)) ||
+          (*CommonVariableTotalSize > mVariableModuleGlobal->CommonVariableSpace) ||
+          (*CommonUserVariableTotalSize > mVariableModuleGlobal->CommonMaxUserVariableSpace))
+      {
+        if (*KeepOffset != 0) {
+          //
+          // The variables kept before KeepOffset use too much of the quota,
+          // reclaim the whole store instead.
+          //
+          *KeepOffset = 0;
+          goto Compact;
+        }
+
+        //
+        // No enough space to store the new variable by NV or NV+HR attribute.
+        //
+        return EFI_OUT_OF_RESOURCES;
+      }
+    }
+
+    CopyMem (CurrPtr, (UINT8 *)NewVariable, NewVariableSize);
+    ((VARIABLE_HEADER *)CurrPtr)->State = VAR_ADDED;
+    if (UpdatingVariable != NULL) {
+      UpdatingPtrTrack->CurrPtr                = (VARIABLE_HEADER *)((UINTN)UpdatingPtrTrack->StartPtr + ((UINTN)CurrPtr - (UINTN)GetStartPointer ((VARIABLE_STORE_HEADER *)ValidBuffer)));
+      UpdatingPtrTrack->InDeletedTransitionPtr = NULL;
+    }
+
+    CurrPtr += NewVariableSize;
+  }
+
+  *ValidSize = (UINTN)CurrPtr - (UINTN)ValidBuffer;
+  return EFI_SUCCESS;
+}
+
+/**
+  Writes a range of a buffer to the same range of the variable storage
+  space, in the working block.
+
+  Fault Tolerant Write protocol is used for writing, with a single write
+  record, so either the whole range or none of it is updated.
+
+  @param  VariableBase   Base address of variable to write.
   @param  VariableBuffer Point to the variable data buffer.
+  @param  Offset         Offset of the range from the variable store header.
+  @param  Length         Length in bytes of the range.
 
   @retval EFI_SUCCESS    The function completed successfully.
   @retval EFI_NOT_FOUND  Fail to locate Fault Tolerant Write protocol.
@@ -101,18 +564,21 @@ GetLbaAndOffsetByAddress (
 
 **/
 EFI_STATUS
-FtwVariableSpace (
+FtwVariableSpaceRange (
   IN EFI_PHYSICAL_ADDRESS   VariableBase,
-  IN VARIABLE_STORE_HEADER  *VariableBuffer
+  IN VARIABLE_STORE_HEADER  *VariableBuffer,
+  IN UINTN                  Offset,
+  IN UINTN                  Length
   )
 {
   EFI_STATUS                         Status;
   EFI_HANDLE                         FvbHandle;
   EFI_LBA                            VarLba;
   UINTN                              VarOffset;
-  UINTN                              FtwBufferSize;
   EFI_FAULT_TOLERANT_WRITE_PROTOCOL  *FtwProtocol;
 
+  ASSERT (Offset + Length <= VariableBuffer->Size);
+
   //
   // Locate fault tolerant write protocol.
   //
@@ -124,7 +590,7 @@ FtwVariableSpace (
   //
   // Locate Fvb handle by address.
   //
-  Status = GetFvbInfoByAddress (VariableBase, &FvbHandle, NULL);
+  Status = GetFvbInfoByAddress (VariableBase + Offset, &FvbHandle, NULL);
   if (EFI_ERROR (Status)) {
     return Status;
   }
@@ -132,26 +598,52 @@ FtwVariableSpace (
   //
   // Get LBA and Offset by address.
   //
-  Status = GetLbaAndOffsetByAddress (VariableBase, &VarLba, &VarOffset);
+  Status = GetLbaAndOffsetByAddress (VariableBase + Offset, &VarLba, &VarOffset);
   if (EFI_ERROR (Status)) {
     return EFI_ABORTED;
   }
 
-  FtwBufferSize = ((VARIABLE_STORE_HEADER *)((UINTN)VariableBase))->Size;
-  ASSERT (FtwBufferSize == VariableBuffer->Size);
-
   //
   // FTW write record.
   //
   Status = FtwProtocol->Write (
                           FtwProtocol,
-                          VarLba,                // LBA
-                          VarOffset,             // Offset
-                          FtwBufferSize,         // NumBytes
-                          NULL,                  // PrivateData NULL
-                          FvbHandle,             // Fvb Handle
-                          (VOID *)VariableBuffer // write buffer
+                          VarLba,                                    // LBA
+                          VarOffset,                                 // Offset
+                          Length,                                    // NumBytes
+                          NULL,                                      // PrivateData NULL
+                          FvbHandle,                                 // Fvb Handle
+                          (VOID *)((UINT8 *)VariableBuffer + Offset) // write buffer
                           );
 
   return Status;
 }
+
+/**
+  Writes a buffer to variable storage space, in the working block.
+
+  This function writes a buffer to variable storage space into a firmware
+  volume block device. The destination is specified by parameter
+  VariableBase. Fault Tolerant Write protocol is used for writing.
+
+  @param  VariableBase   Base address of variable to write
+  @param  VariableBuffer Point to the variable data buffer.
+
+  @retval EFI_SUCCESS    The function completed successfully.
+  @retval EFI_NOT_FOUND  Fail to locate Fault Tolerant Write protocol.
+  @retval EFI_ABORTED    The function could not complete successfully.
+
+**/
+EFI_STATUS
+FtwVariableSpace (
+  IN EFI_PHYSICAL_ADDRESS   VariableBase,
+  IN VARIABLE_STORE_HEADER  *VariableBuffer
+  )
+{
+  UINTN  FtwBufferSize;
+
+  FtwBufferSize = ((VARIABLE_STORE_HEADER *)((UINTN)VariableBase))->Size;
+  ASSERT (FtwBufferSize == VariableBuffer->Size);
+
+  return FtwVariableSpaceRange (VariableBase, VariableBuffer, 0, FtwBufferSize);
+}
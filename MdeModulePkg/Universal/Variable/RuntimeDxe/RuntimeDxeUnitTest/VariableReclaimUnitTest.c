@@ -0,0 +1,1291 @@
+/** @file
+  Unit tests of the incremental reclaim of the non-volatile variable store.
+
+  The store lives in a simulated flash device with 4 KB erase blocks, exposed
+  through fake FVB and FTW protocols that count the erases of every block.
+  The tests check where an incremental reclaim starts, that the blocks before
+  it are not written, and that over a workload of long-lived and frequently
+  updated variables no block is erased more than twice as often as with
+  reclaims of the whole store. The compaction of CompactVariableStore() is
+  also checked directly: the fallback to a reclaim of the whole store, the
+  sizes counted for the kept variables, the promotion of the variables in
+  deleted transition and the pointer track of the updated variable.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../Variable.h"
+#include "../VariableParsing.h"
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_NAME     "Variable Incremental Reclaim Unit Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+#define FLASH_BLOCK_SIZE   SIZE_4KB
+#define FLASH_BLOCK_COUNT  64
+#define FLASH_SIZE         (FLASH_BLOCK_SIZE * FLASH_BLOCK_COUNT)
+#define FV_HEADER_LENGTH   (sizeof (EFI_FIRMWARE_VOLUME_HEADER) + sizeof (EFI_FV_BLOCK_MAP_ENTRY))
+
+#define STATIC_VARIABLE_COUNT  100
+#define HOT_VARIABLE_COUNT     16
+#define VARIABLE_COUNT         (STATIC_VARIABLE_COUNT + HOT_VARIABLE_COUNT)
+#define WORKLOAD_UPDATES       20000
+#define MAX_TEST_DATA_SIZE     SIZE_2KB
+
+typedef struct {
+  UINTN    FtwWrites;
+  UINTN    ErasedBlocks;
+  UINTN    MaxErasedBlocks;
+  UINTN    BlockErases[FLASH_BLOCK_COUNT];
+} FLASH_STATISTICS;
+
+typedef struct {
+  UINTN    Reclaims;
+  UINTN    FullReclaims;
+} RECLAIM_STATISTICS;
+
+//
+// Simulated flash device, holding the FV header followed by the variable store.
+//
+UINT64                 mFlash[FLASH_SIZE / sizeof (UINT64)];
+UINT64                 mScratch[FLASH_SIZE / sizeof (UINT64)];
+FLASH_STATISTICS       mFlashStatistics;
+UINTN                  mLastVariableOffset;
+UINT32                 mVersion[VARIABLE_COUNT];
+UINT32                 mDataSize[VARIABLE_COUNT];
+UINT32                 mRandom;
+VARIABLE_STORE_HEADER  *mStore;
+
+//
+// Module global of the variable driver, only the store sizes and quotas are used.
+//
+VARIABLE_MODULE_GLOBAL  mTestModuleGlobal;
+VARIABLE_MODULE_GLOBAL  *mVariableModuleGlobal = &mTestModuleGlobal;
+
+//
+// Test GUID {3E0E8C68-0B4C-4E3B-9A6A-5F0AB3C2D1E7}
+//
+EFI_GUID  mTestGuid = {
+  0x3e0e8c68, 0x0b4c, 0x4e3b, { 0x9a, 0x6a, 0x5f, 0x0a, 0xb3, 0xc2, 0xd1, 0xe7 }
+};
+
+/// === FLASH SIMULATOR ============================================================================
+
+/**
+  Gets the address of the simulated flash device.
+**/
+EFI_STATUS
+EFIAPI
+SimFvbGetPhysicalAddress (
+  IN CONST EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  OUT EFI_PHYSICAL_ADDRESS                     *Address
+  )
+{
+  *Address = (EFI_PHYSICAL_ADDRESS)(UINTN)mFlash;
+  return EFI_SUCCESS;
+}
+
+/**
+  Gets the block size of the simulated flash device.
+**/
+EFI_STATUS
+EFIAPI
+SimFvbGetBlockSize (
+  IN CONST EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  IN EFI_LBA                                   Lba,
+  OUT UINTN                                    *BlockSize,
+  OUT UINTN                                    *NumberOfBlocks
+  )
+{
+  if (Lba >= FLASH_BLOCK_COUNT) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *BlockSize      = FLASH_BLOCK_SIZE;
+  *NumberOfBlocks = FLASH_BLOCK_COUNT - (UINTN)Lba;
+  return EFI_SUCCESS;
+}
+
+EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  mSimFvb = {
+  NULL,
+  NULL,
+  SimFvbGetPhysicalAddress,
+  SimFvbGetBlockSize,
+  NULL,
+  NULL,
+  NULL,
+  NULL
+};
+
+/**
+  Writes the simulated flash device as the FTW driver does: every block of the
+  range is erased and programmed once in the spare area and once in place.
+**/
+EFI_STATUS
+EFIAPI
+SimFtwWrite (
+  IN EFI_FAULT_TOLERANT_WRITE_PROTOCOL  *This,
+  IN EFI_LBA                            Lba,
+  IN UINTN                              Offset,
+  IN UINTN                              Length,
+  IN VOID                               *PrivateData,
+  IN EFI_HANDLE                         FvBlockHandle,
+  IN VOID                               *Buffer
+  )
+{
+  UINTN  Start;
+  UINTN  FirstBlock;
+  UINTN  LastBlock;
+  UINTN  Block;
+
+  Start = (UINTN)Lba * FLASH_BLOCK_SIZE + Offset;
+  if ((Length == 0) || (Start + Length > FLASH_SIZE)) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  CopyMem ((UINT8 *)mFlash + Start, Buffer, Length);
+
+  FirstBlock = Start / FLASH_BLOCK_SIZE;
+  LastBlock  = (Start + Length - 1) / FLASH_BLOCK_SIZE;
+  for (Block = FirstBlock; Block <= LastBlock; Block++) {
+    mFlashStatistics.BlockErases[Block]++;
+  }
+
+  mFlashStatistics.FtwWrites++;
+  mFlashStatistics.ErasedBlocks    += 2 * (LastBlock - FirstBlock + 1);
+  mFlashStatistics.MaxErasedBlocks  = MAX (mFlashStatistics.MaxErasedBlocks, 2 * (LastBlock - FirstBlock + 1));
+  return EFI_SUCCESS;
+}
+
+EFI_FAULT_TOLERANT_WRITE_PROTOCOL  mSimFtw = {
+  NULL,
+  NULL,
+  SimFtwWrite,
+  NULL,
+  NULL,
+  NULL
+};
+
+/**
+  Get the FTW protocol, the simulated one.
+**/
+EFI_STATUS
+GetFtwProtocol (
+  OUT VOID  **FtwProtocol
+  )
+{
+  *FtwProtocol = &mSimFtw;
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the FVB protocol of an address, the simulated one.
+**/
+EFI_STATUS
+GetFvbInfoByAddress (
+  IN  EFI_PHYSICAL_ADDRESS                Address,
+  OUT EFI_HANDLE                          *FvbHandle OPTIONAL,
+  OUT EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  **FvbProtocol OPTIONAL
+  )
+{
+  if ((Address < (UINTN)mFlash) || (Address >= (UINTN)mFlash + FLASH_SIZE)) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (FvbHandle != NULL) {
+    *FvbHandle = (EFI_HANDLE)&mSimFvb;
+  }
+
+  if (FvbProtocol != NULL) {
+    *FvbProtocol = &mSimFvb;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  The variable services run at boot time in this test.
+**/
+BOOLEAN
+AtRuntime (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+/// === VARIABLE STORE MODEL =======================================================================
+
+/**
+  Returns a pseudo random number.
+**/
+UINT32
+NextRandom (
+  VOID
+  )
+{
+  mRandom = mRandom * 1103515245 + 12345;
+  return mRandom >> 8;
+}
+
+/**
+  Formats the simulated flash device with an empty variable store.
+**/
+VOID
+FormatFlash (
+  VOID
+  )
+{
+  EFI_FIRMWARE_VOLUME_HEADER  *FvHeader;
+
+  SetMem (mFlash, sizeof (mFlash), 0xff);
+  ZeroMem (&mFlashStatistics, sizeof (mFlashStatistics));
+  ZeroMem (mVersion, sizeof (mVersion));
+
+  FvHeader                        = (EFI_FIRMWARE_VOLUME_HEADER *)mFlash;
+  FvHeader->FvLength              = FLASH_SIZE;
+  FvHeader->HeaderLength          = (UINT16)FV_HEADER_LENGTH;
+  FvHeader->BlockMap[0].NumBlocks = FLASH_BLOCK_COUNT;
+  FvHeader->BlockMap[0].Length    = FLASH_BLOCK_SIZE;
+  FvHeader->BlockMap[1].NumBlocks = 0;
+  FvHeader->BlockMap[1].Length    = 0;
+
+  mStore = (VARIABLE_STORE_HEADER *)((UINT8 *)mFlash + FV_HEADER_LENGTH);
+  CopyGuid (&mStore->Signature, &gEfiVariableGuid);
+  mStore->Size        = FLASH_SIZE - FV_HEADER_LENGTH;
+  mStore->Format      = VARIABLE_STORE_FORMATTED;
+  mStore->State       = VARIABLE_STORE_HEALTHY;
+  mStore->Reserved    = 0;
+  mStore->Reserved1   = 0;
+  mLastVariableOffset = (UINTN)GetStartPointer (mStore) - (UINTN)mStore;
+
+  ZeroMem (mVariableModuleGlobal, sizeof (*mVariableModuleGlobal));
+  mVariableModuleGlobal->CommonVariableSpace        = mStore->Size;
+  mVariableModuleGlobal->CommonMaxUserVariableSpace = mStore->Size;
+}
+
+/**
+  Builds a variable in a buffer, its data holds the version of the variable.
+
+  @return The size of the variable.
+**/
+UINTN
+BuildVariable (
+  OUT VARIABLE_HEADER  *Variable,
+  IN  UINTN            Index,
+  IN  UINT32           Version,
+  IN  UINT32           DataSize
+  )
+{
+  CHAR16  Name[8];
+  UINTN   NameSize;
+  UINTN   Digit;
+
+  //
+  // The name is "VarNNNN", with the index of the variable.
+  //
+  CopyMem (Name, L"Var", 3 * sizeof (CHAR16));
+  for (Digit = 6; Digit >= 3; Digit--) {
+    Name[Digit] = (CHAR16)(L'0' + Index % 10);
+    Index      /= 10;
+  }
+
+  Name[7]  = L'\0';
+  NameSize = sizeof (Name);
+
+  SetMem (Variable, sizeof (VARIABLE_HEADER), 0);
+  Variable->StartId    = VARIABLE_DATA;
+  Variable->State      = VAR_ADDED;
+  Variable->Attributes = EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS;
+  Variable->NameSize   = (UINT32)NameSize;
+  Variable->DataSize   = DataSize;
+  CopyGuid (&Variable->VendorGuid, &mTestGuid);
+  CopyMem (GetVariableNamePtr (Variable, FALSE), Name, NameSize);
+  SetMem (GetVariableDataPtr (Variable, FALSE), DataSize, (UINT8)Version);
+  CopyMem (GetVariableDataPtr (Variable, FALSE), &Version, sizeof (Version));
+
+  return HEADER_ALIGN ((UINTN)GetVariableDataPtr (Variable, FALSE) + DataSize + GET_PAD_SIZE (DataSize) - (UINTN)Variable);
+}
+
+/**
+  Gets the index of a variable from its name.
+**/
+UINTN
+GetVariableIndex (
+  IN VARIABLE_HEADER  *Variable
+  )
+{
+  CHAR16  *Name;
+  UINTN   Index;
+  UINTN   Digit;
+
+  Name  = GetVariableNamePtr (Variable, FALSE);
+  Index = 0;
+  for (Digit = 3; Digit < 7; Digit++) {
+    Index = Index * 10 + (Name[Digit] - L'0');
+  }
+
+  return Index;
+}
+
+/**
+  The frequently updated variables are user variables in this test.
+**/
+BOOLEAN
+IsUserVariable (
+  IN VARIABLE_HEADER  *Variable
+  )
+{
+  return (BOOLEAN)(GetVariableIndex (Variable) >= STATIC_VARIABLE_COUNT);
+}
+
+/**
+  Finds the ADDED copy of a variable in the store.
+**/
+VARIABLE_HEADER *
+FindAddedVariable (
+  IN UINTN  Index
+  )
+{
+  VARIABLE_HEADER  *Variable;
+
+  Variable = GetStartPointer (mStore);
+  while (IsValidVariableHeader (Variable, GetEndPointer (mStore))) {
+    if ((Variable->State == VAR_ADDED) && (GetVariableIndex (Variable) == Index)) {
+      return Variable;
+    }
+
+    Variable = GetNextVariablePtr (Variable, FALSE);
+  }
+
+  return NULL;
+}
+
+/**
+  Initializes the pointer track of a variable of the store.
+**/
+VOID
+InitPointerTrack (
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  IN  VARIABLE_HEADER         *Variable OPTIONAL,
+  IN  VARIABLE_HEADER         *InDeletedTransition OPTIONAL
+  )
+{
+  PtrTrack->StartPtr               = GetStartPointer (mStore);
+  PtrTrack->EndPtr                 = GetEndPointer (mStore);
+  PtrTrack->CurrPtr                = Variable;
+  PtrTrack->InDeletedTransitionPtr = InDeletedTransition;
+  PtrTrack->Volatile               = FALSE;
+}
+
+/**
+  Appends a variable to the store, in the given state.
+
+  @return The variable in the store.
+**/
+VARIABLE_HEADER *
+AppendVariable (
+  IN UINTN   Index,
+  IN UINT32  Version,
+  IN UINT32  DataSize,
+  IN UINT8   State
+  )
+{
+  VARIABLE_HEADER  *Variable;
+
+  Variable             = (VARIABLE_HEADER *)((UINT8 *)mStore + mLastVariableOffset);
+  mLastVariableOffset += BuildVariable (Variable, Index, Version, DataSize);
+  Variable->State      = State;
+  return Variable;
+}
+
+/**
+  Counts the copies of a variable in a given state in a store.
+**/
+UINTN
+CountVariables (
+  IN VARIABLE_STORE_HEADER  *Store,
+  IN UINTN                  Index,
+  IN UINT8                  State
+  )
+{
+  VARIABLE_HEADER  *Variable;
+  UINTN            Count;
+
+  Count    = 0;
+  Variable = GetStartPointer (Store);
+  while (IsValidVariableHeader (Variable, GetEndPointer (Store))) {
+    if ((Variable->State == State) && (GetVariableIndex (Variable) == Index)) {
+      Count++;
+    }
+
+    Variable = GetNextVariablePtr (Variable, FALSE);
+  }
+
+  return Count;
+}
+
+/**
+  Compacts the store into the scratch buffer with CompactVariableStore(), the
+  sizes of the variables are counted in the module global.
+**/
+EFI_STATUS
+CompactTestStore (
+  IN OUT UINTN                   *KeepOffset,
+  IN OUT VARIABLE_POINTER_TRACK  *UpdatingPtrTrack OPTIONAL,
+  IN     VARIABLE_HEADER         *NewVariable,
+  IN     UINTN                   NewVariableSize,
+  OUT    UINTN                   *ValidSize
+  )
+{
+  return CompactVariableStore (
+           mStore,
+           (UINT8 *)mScratch,
+           mStore->Size,
+           FALSE,
+           KeepOffset,
+           UpdatingPtrTrack,
+           NewVariable,
+           NewVariableSize,
+           ValidSize,
+           &mVariableModuleGlobal->HwErrVariableTotalSize,
+           &mVariableModuleGlobal->CommonVariableTotalSize,
+           &mVariableModuleGlobal->CommonUserVariableTotalSize
+           );
+}
+
+/**
+  Reclaims the store and integrates a new variable, the way Reclaim() of the
+  variable driver does for the non-volatile store: the store is compacted
+  from the offset of an incremental reclaim, if any, and written from it.
+**/
+EFI_STATUS
+ReclaimStore (
+  IN OUT VARIABLE_POINTER_TRACK  *UpdatingPtrTrack,
+  IN     VARIABLE_HEADER         *NewVariable,
+  IN     UINTN                   NewVariableSize,
+  IN     UINTN                   ReserveSize,
+  IN     RECLAIM_STATISTICS      *ReclaimStatistics
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       KeepOffset;
+  UINTN       BlockSize;
+  UINTN       BlockOffset;
+  UINTN       ValidSize;
+
+  KeepOffset = 0;
+  if (ReserveSize != 0) {
+    Status = GetBlockSizeAndOffsetByAddress ((UINTN)mStore, &BlockSize, &BlockOffset);
+    if (!EFI_ERROR (Status)) {
+      Status = GetIncrementalReclaimOffset (
+                 mStore,
+                 BlockSize,
+                 BlockOffset,
+                 FALSE,
+                 UpdatingPtrTrack->CurrPtr,
+                 UpdatingPtrTrack->InDeletedTransitionPtr,
+                 NewVariableSize + ReserveSize,
+                 &KeepOffset
+                 );
+    }
+
+    if (EFI_ERROR (Status)) {
+      KeepOffset = 0;
+    }
+  }
+
+  Status = CompactTestStore (&KeepOffset, UpdatingPtrTrack, NewVariable, NewVariableSize, &ValidSize);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (KeepOffset == 0) {
+    Status = FtwVariableSpace ((UINTN)mStore, (VARIABLE_STORE_HEADER *)mScratch);
+    ReclaimStatistics->FullReclaims++;
+  } else {
+    Status = FtwVariableSpaceRange ((UINTN)mStore, (VARIABLE_STORE_HEADER *)mScratch, KeepOffset, mStore->Size - KeepOffset);
+  }
+
+  if (!EFI_ERROR (Status)) {
+    mLastVariableOffset = ValidSize;
+    ReclaimStatistics->Reclaims++;
+  }
+
+  return Status;
+}
+
+/**
+  Sets a variable, appending it to the store or reclaiming the store when it
+  does not fit.
+**/
+EFI_STATUS
+SetTestVariable (
+  IN UINTN               Index,
+  IN UINT32              DataSize,
+  IN UINTN               ReserveSize,
+  IN RECLAIM_STATISTICS  *ReclaimStatistics
+  )
+{
+  UINT64                  NewVariable[(sizeof (VARIABLE_HEADER) + 64 + MAX_TEST_DATA_SIZE) / sizeof (UINT64)];
+  UINTN                   NewVariableSize;
+  VARIABLE_HEADER         *OldVariable;
+  VARIABLE_POINTER_TRACK  PtrTrack;
+  EFI_STATUS              Status;
+
+  OldVariable     = FindAddedVariable (Index);
+  NewVariableSize = BuildVariable ((VARIABLE_HEADER *)NewVariable, Index, mVersion[Index] + 1, DataSize);
+
+  if (mLastVariableOffset + NewVariableSize > mStore->Size) {
+    InitPointerTrack (&PtrTrack, OldVariable, NULL);
+    Status = ReclaimStore (&PtrTrack, (VARIABLE_HEADER *)NewVariable, NewVariableSize, ReserveSize, ReclaimStatistics);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  } else {
+    CopyMem ((UINT8 *)mStore + mLastVariableOffset, NewVariable, NewVariableSize);
+    mLastVariableOffset += NewVariableSize;
+    if (OldVariable != NULL) {
+      OldVariable->State &= VAR_DELETED;
+    }
+  }
+
+  mVersion[Index]++;
+  mDataSize[Index] = DataSize;
+  return EFI_SUCCESS;
+}
+
+/**
+  Checks that every variable of the workload has a single ADDED copy holding
+  its latest version.
+**/
+BOOLEAN
+IsStoreConsistent (
+  VOID
+  )
+{
+  VARIABLE_HEADER  *Variable;
+  UINTN            Index;
+  UINT32           Found[VARIABLE_COUNT];
+  UINT32           Version;
+
+  ZeroMem (Found, sizeof (Found));
+  Variable = GetStartPointer (mStore);
+  while (IsValidVariableHeader (Variable, GetEndPointer (mStore))) {
+    if (Variable->State == VAR_ADDED) {
+      Index = GetVariableIndex (Variable);
+      if ((Index >= VARIABLE_COUNT) || (Found[Index] != 0)) {
+        return FALSE;
+      }
+
+      CopyMem (&Version, GetVariableDataPtr (Variable, FALSE), sizeof (Version));
+      if ((Version != mVersion[Index]) || (Variable->DataSize != mDataSize[Index])) {
+        return FALSE;
+      }
+
+      Found[Index] = 1;
+    }
+
+    Variable = GetNextVariablePtr (Variable, FALSE);
+  }
+
+  for (Index = 0; Index < VARIABLE_COUNT; Index++) {
+    if ((mVersion[Index] != 0) && (Found[Index] == 0)) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Runs the workload: long-lived variables are set once, then a small set of
+  variables is updated many times with random sizes.
+**/
+EFI_STATUS
+RunWorkload (
+  IN  UINTN               ReserveSize,
+  OUT RECLAIM_STATISTICS  *ReclaimStatistics
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+  UINTN       Update;
+
+  FormatFlash ();
+  ZeroMem (ReclaimStatistics, sizeof (*ReclaimStatistics));
+  mRandom = 1;
+
+  for (Index = 0; Index < STATIC_VARIABLE_COUNT; Index++) {
+    Status = SetTestVariable (Index, 512 + NextRandom () % 1024, ReserveSize, ReclaimStatistics);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  for (Update = 0; Update < WORKLOAD_UPDATES; Update++) {
+    Index  = STATIC_VARIABLE_COUNT + NextRandom () % HOT_VARIABLE_COUNT;
+    Status = SetTestVariable (Index, 64 + NextRandom () % (MAX_TEST_DATA_SIZE - 64), ReserveSize, ReclaimStatistics);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/// === TEST CASES =================================================================================
+
+/**
+  The incremental reclaim keeps the blocks of the long-lived variables and
+  starts compacting at the first variable of an erase block.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IncrementalReclaimOffsetShouldKeepCleanBlocks (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  RECLAIM_STATISTICS      ReclaimStatistics;
+  UINT64                  NewVariable[(sizeof (VARIABLE_HEADER) + 64 + MAX_TEST_DATA_SIZE) / sizeof (UINT64)];
+  VARIABLE_POINTER_TRACK  PtrTrack;
+  UINTN                   StaticEnd;
+  UINTN                   Index;
+  UINTN                   KeepOffset;
+  UINTN                   BlockOffset;
+  UINTN                   BlockSize;
+  VARIABLE_HEADER         *Variable;
+  VARIABLE_HEADER         *Updating;
+
+  FormatFlash ();
+  ZeroMem (&ReclaimStatistics, sizeof (ReclaimStatistics));
+  for (Index = 0; Index < STATIC_VARIABLE_COUNT; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (SetTestVariable (Index, 1024, 0, &ReclaimStatistics));
+  }
+
+  StaticEnd = mLastVariableOffset;
+
+  //
+  // Fill the store with copies of one variable, all of them deleted but the last one.
+  //
+  while (mLastVariableOffset + SIZE_2KB < mStore->Size) {
+    UT_ASSERT_NOT_EFI_ERROR (SetTestVariable (STATIC_VARIABLE_COUNT, 1024, 0, &ReclaimStatistics));
+  }
+
+  UT_ASSERT_EQUAL (ReclaimStatistics.Reclaims, 0);
+  UT_ASSERT_NOT_EFI_ERROR (GetBlockSizeAndOffsetByAddress ((UINTN)mStore, &BlockSize, &BlockOffset));
+  UT_ASSERT_EQUAL (BlockSize, FLASH_BLOCK_SIZE);
+  UT_ASSERT_EQUAL (BlockOffset, FV_HEADER_LENGTH);
+
+  //
+  // The offset is in the deleted copies, at the first variable of a block,
+  // and leaves the required free space.
+  //
+  Updating = FindAddedVariable (STATIC_VARIABLE_COUNT);
+  UT_ASSERT_NOT_NULL (Updating);
+  UT_ASSERT_NOT_EFI_ERROR (
+    GetIncrementalReclaimOffset (mStore, BlockSize, BlockOffset, FALSE, Updating, NULL, SIZE_16KB, &KeepOffset)
+    );
+  UT_ASSERT_TRUE (KeepOffset >= StaticEnd);
+  UT_ASSERT_TRUE (KeepOffset + SIZE_16KB <= mStore->Size);
+  //
+  // The deleted bytes kept before the offset are at most half of the space a
+  // reclaim of the whole store frees, and the next block would exceed it.
+  //
+  UT_ASSERT_TRUE (2 * (KeepOffset - StaticEnd) <= mStore->Size - StaticEnd);
+  UT_ASSERT_TRUE (2 * (KeepOffset - StaticEnd + BlockSize + SIZE_2KB) > mStore->Size - StaticEnd);
+  Variable = GetStartPointer (mStore);
+  while ((UINTN)GetNextVariablePtr (Variable, FALSE) - (UINTN)mStore < KeepOffset) {
+    Variable = GetNextVariablePtr (Variable, FALSE);
+  }
+
+  UT_ASSERT_EQUAL ((UINTN)GetNextVariablePtr (Variable, FALSE) - (UINTN)mStore, KeepOffset);
+  UT_ASSERT_NOT_EQUAL (
+    (BlockOffset + (UINTN)Variable - (UINTN)mStore) / BlockSize,
+    (BlockOffset + KeepOffset) / BlockSize
+    );
+
+  //
+  // The variable being updated is never kept.
+  //
+  Updating = GetNextVariablePtr ((VARIABLE_HEADER *)((UINTN)mStore + StaticEnd), FALSE);
+  UT_ASSERT_NOT_EFI_ERROR (
+    GetIncrementalReclaimOffset (mStore, BlockSize, BlockOffset, FALSE, Updating, NULL, SIZE_16KB, &KeepOffset)
+    );
+  UT_ASSERT_TRUE (KeepOffset <= (UINTN)Updating - (UINTN)mStore);
+
+  //
+  // A reclaim of the whole store is needed when the free space would come
+  // from the deleted variables before the updated one.
+  //
+  UT_ASSERT_STATUS_EQUAL (
+    GetIncrementalReclaimOffset (mStore, BlockSize, BlockOffset, FALSE, NULL, NULL, mStore->Size, &KeepOffset),
+    EFI_NOT_FOUND
+    );
+
+  //
+  // The reclaim only writes the blocks from the offset.
+  //
+  InitPointerTrack (&PtrTrack, FindAddedVariable (STATIC_VARIABLE_COUNT), NULL);
+  ZeroMem (&mFlashStatistics, sizeof (mFlashStatistics));
+  UT_ASSERT_NOT_EFI_ERROR (
+    ReclaimStore (
+      &PtrTrack,
+      (VARIABLE_HEADER *)NewVariable,
+      BuildVariable ((VARIABLE_HEADER *)NewVariable, STATIC_VARIABLE_COUNT, ++mVersion[STATIC_VARIABLE_COUNT], 1024),
+      SIZE_16KB,
+      &ReclaimStatistics
+      )
+    );
+  UT_ASSERT_EQUAL (ReclaimStatistics.FullReclaims, 0);
+  UT_ASSERT_EQUAL (mFlashStatistics.BlockErases[0], 0);
+  UT_ASSERT_EQUAL (mFlashStatistics.BlockErases[(FV_HEADER_LENGTH + StaticEnd) / FLASH_BLOCK_SIZE - 1], 0);
+  UT_ASSERT_EQUAL (mFlashStatistics.BlockErases[FLASH_BLOCK_COUNT - 1], 1);
+  UT_ASSERT_TRUE (mLastVariableOffset + SIZE_16KB <= mStore->Size);
+  UT_ASSERT_TRUE (IsStoreConsistent ());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Runs the workload with reclaims of the whole store and with incremental
+  reclaims. The incremental reclaims erase fewer blocks in total and per
+  reclaim, and no block more than twice as often.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IncrementalReclaimShouldWriteFewerBlocks (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST UINTN  ReserveSize[] = { 0, SIZE_16KB, SIZE_32KB, SIZE_64KB };
+  RECLAIM_STATISTICS  ReclaimStatistics;
+  FLASH_STATISTICS    FullStatistics;
+  UINTN               Index;
+  UINTN               Block;
+  UINTN               MaxBlockErases;
+  UINTN               FullMaxBlockErases;
+
+  FullMaxBlockErases = 0;
+  for (Index = 0; Index < ARRAY_SIZE (ReserveSize); Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (RunWorkload (ReserveSize[Index], &ReclaimStatistics));
+    UT_ASSERT_TRUE (IsStoreConsistent ());
+
+    MaxBlockErases = 0;
+    for (Block = 0; Block < FLASH_BLOCK_COUNT; Block++) {
+      MaxBlockErases = MAX (MaxBlockErases, mFlashStatistics.BlockErases[Block]);
+    }
+
+    if (ReserveSize[Index] == 0) {
+      UT_ASSERT_EQUAL (ReclaimStatistics.Reclaims, ReclaimStatistics.FullReclaims);
+      CopyMem (&FullStatistics, &mFlashStatistics, sizeof (FullStatistics));
+      FullMaxBlockErases = MaxBlockErases;
+    } else {
+      UT_ASSERT_TRUE (ReclaimStatistics.FullReclaims < ReclaimStatistics.Reclaims);
+      UT_ASSERT_TRUE (mFlashStatistics.ErasedBlocks < FullStatistics.ErasedBlocks);
+      UT_ASSERT_TRUE (mFlashStatistics.MaxErasedBlocks <= FullStatistics.MaxErasedBlocks);
+      UT_ASSERT_TRUE (mFlashStatistics.BlockErases[0] < FullStatistics.BlockErases[0]);
+      UT_ASSERT_TRUE (MaxBlockErases <= 2 * FullMaxBlockErases);
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The compaction falls back to a reclaim of the whole store when the new
+  variable does not fit after the variables kept before KeepOffset, and
+  refuses the new variable when it does not fit in the whole store either.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CompactionShouldFallBackWhenTheStoreOverflows (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT64           NewVariable[(sizeof (VARIABLE_HEADER) + 64 + MAX_TEST_DATA_SIZE) / sizeof (UINT64)];
+  UINTN            NewVariableSize;
+  UINTN            LiveSize;
+  UINTN            KeepOffset;
+  UINTN            ValidSize;
+  UINTN            Index;
+
+  FormatFlash ();
+  for (Index = 0; Index < 8; Index++) {
+    AppendVariable (Index, 1, 1024, VAR_ADDED);
+  }
+
+  LiveSize = mLastVariableOffset;
+
+  //
+  // The deleted copies of a variable fill the store before KeepOffset, so
+  // compacting from KeepOffset frees nothing.
+  //
+  while (mLastVariableOffset + 3 * SIZE_1KB < mStore->Size) {
+    AppendVariable (8, 1, 1024, VAR_ADDED & VAR_DELETED);
+  }
+
+  KeepOffset = mLastVariableOffset;
+  AppendVariable (8, 2, 1024, VAR_ADDED);
+  LiveSize       += mLastVariableOffset - KeepOffset;
+  NewVariableSize = BuildVariable ((VARIABLE_HEADER *)NewVariable, 9, 1, MAX_TEST_DATA_SIZE);
+  UT_ASSERT_TRUE (mLastVariableOffset + NewVariableSize > mStore->Size);
+
+  UT_ASSERT_NOT_EFI_ERROR (CompactTestStore (&KeepOffset, NULL, (VARIABLE_HEADER *)NewVariable, NewVariableSize, &ValidSize));
+  UT_ASSERT_EQUAL (KeepOffset, 0);
+  UT_ASSERT_EQUAL (ValidSize, LiveSize + NewVariableSize);
+  UT_ASSERT_EQUAL (CountVariables ((VARIABLE_STORE_HEADER *)mScratch, 8, VAR_ADDED & VAR_DELETED), 0);
+  UT_ASSERT_EQUAL (CountVariables ((VARIABLE_STORE_HEADER *)mScratch, 8, VAR_ADDED), 1);
+  UT_ASSERT_EQUAL (CountVariables ((VARIABLE_STORE_HEADER *)mScratch, 9, VAR_ADDED), 1);
+
+  //
+  // Without deleted variables, the whole store is full too.
+  //
+  FormatFlash ();
+  Index = 0;
+  while (mLastVariableOffset + SIZE_2KB < mStore->Size) {
+    KeepOffset = mLastVariableOffset;
+    AppendVariable (Index++, 1, 1024, VAR_ADDED);
+  }
+
+  UT_ASSERT_TRUE (mLastVariableOffset + NewVariableSize > mStore->Size);
+  UT_ASSERT_STATUS_EQUAL (
+    CompactTestStore (&KeepOffset, NULL, (VARIABLE_HEADER *)NewVariable, NewVariableSize, &ValidSize),
+    EFI_OUT_OF_RESOURCES
+    );
+  UT_ASSERT_EQUAL (KeepOffset, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The compaction falls back to a reclaim of the whole store when the deleted
+  variables kept before KeepOffset exceed the common or the user variable
+  quota, and refuses the new variable when the whole store exceeds it too.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CompactionShouldFallBackWhenTheQuotaIsExceeded (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT64                  NewVariable[(sizeof (VARIABLE_HEADER) + 64 + MAX_TEST_DATA_SIZE) / sizeof (UINT64)];
+  VARIABLE_POINTER_TRACK  PtrTrack;
+  VARIABLE_HEADER         *Updating;
+  UINTN                   NewVariableSize;
+  UINTN                   StartOffset;
+  UINTN                   CommonSize;
+  UINTN                   KeepOffset;
+  UINTN                   UpdatingOffset;
+  UINTN                   ValidSize;
+  UINTN                   Index;
+  UINTN                   Quota;
+
+  for (Quota = 0; Quota < 2; Quota++) {
+    FormatFlash ();
+    StartOffset = mLastVariableOffset;
+    for (Index = 0; Index < 8; Index++) {
+      AppendVariable (Index, 1, 1024, VAR_ADDED);
+    }
+
+    CommonSize = mLastVariableOffset - StartOffset;
+    for (Index = 0; Index < 16; Index++) {
+      AppendVariable (STATIC_VARIABLE_COUNT, (UINT32)Index + 1, 1024, VAR_ADDED & VAR_DELETED);
+    }
+
+    UpdatingOffset  = mLastVariableOffset;
+    Updating        = AppendVariable (STATIC_VARIABLE_COUNT, 17, 1024, VAR_ADDED);
+    NewVariableSize = BuildVariable ((VARIABLE_HEADER *)NewVariable, STATIC_VARIABLE_COUNT, 18, 1024);
+
+    //
+    // The whole store then holds the common variables and the new one, the
+    // only user variable.
+    //
+    if (Quota == 0) {
+      mVariableModuleGlobal->CommonVariableSpace = CommonSize + NewVariableSize;
+    } else {
+      mVariableModuleGlobal->CommonMaxUserVariableSpace = NewVariableSize;
+    }
+
+    KeepOffset = UpdatingOffset;
+    InitPointerTrack (&PtrTrack, Updating, NULL);
+    UT_ASSERT_NOT_EFI_ERROR (CompactTestStore (&KeepOffset, &PtrTrack, (VARIABLE_HEADER *)NewVariable, NewVariableSize, &ValidSize));
+    UT_ASSERT_EQUAL (KeepOffset, 0);
+    UT_ASSERT_EQUAL (ValidSize, StartOffset + CommonSize + NewVariableSize);
+    UT_ASSERT_EQUAL (mVariableModuleGlobal->CommonVariableTotalSize, CommonSize + NewVariableSize);
+    UT_ASSERT_EQUAL (mVariableModuleGlobal->CommonUserVariableTotalSize, NewVariableSize);
+    UT_ASSERT_EQUAL (mVariableModuleGlobal->HwErrVariableTotalSize, 0);
+
+    if (Quota == 0) {
+      mVariableModuleGlobal->CommonVariableSpace--;
+    } else {
+      mVariableModuleGlobal->CommonMaxUserVariableSpace--;
+    }
+
+    KeepOffset = UpdatingOffset;
+    InitPointerTrack (&PtrTrack, Updating, NULL);
+    UT_ASSERT_STATUS_EQUAL (
+      CompactTestStore (&KeepOffset, &PtrTrack, (VARIABLE_HEADER *)NewVariable, NewVariableSize, &ValidSize),
+      EFI_OUT_OF_RESOURCES
+      );
+    UT_ASSERT_EQUAL (KeepOffset, 0);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The variables kept before KeepOffset are copied as they are, and counted in
+  the sizes of the store whatever their state. From KeepOffset, only the ADDED
+  variables but the updated one are counted, with the new variable.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CompactionShouldCountTheKeptVariables (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT64                  NewVariable[(sizeof (VARIABLE_HEADER) + 64 + MAX_TEST_DATA_SIZE) / sizeof (UINT64)];
+  VARIABLE_POINTER_TRACK  PtrTrack;
+  VARIABLE_HEADER         *Updating;
+  VARIABLE_HEADER         *Variable;
+  VARIABLE_HEADER         *NextVariable;
+  UINTN                   NewVariableSize;
+  UINTN                   KeepOffset;
+  UINTN                   ValidSize;
+  UINTN                   VariableSize;
+  UINTN                   CommonSize;
+  UINTN                   UserSize;
+  UINTN                   CompactedSize;
+  UINTN                   Index;
+
+  FormatFlash ();
+  for (Index = 0; Index < 4; Index++) {
+    AppendVariable (Index, 1, 512, VAR_ADDED);
+  }
+
+  for (Index = 0; Index < 6; Index++) {
+    AppendVariable ((Index % 2 == 0) ? 4 : STATIC_VARIABLE_COUNT, (UINT32)Index + 1, 700, VAR_ADDED & VAR_DELETED);
+  }
+
+  AppendVariable (STATIC_VARIABLE_COUNT + 1, 1, 300, VAR_IN_DELETED_TRANSITION & VAR_ADDED);
+  KeepOffset = mLastVariableOffset;
+  AppendVariable (5, 1, 400, VAR_ADDED);
+  AppendVariable (STATIC_VARIABLE_COUNT + 2, 1, 400, VAR_ADDED & VAR_DELETED);
+  AppendVariable (STATIC_VARIABLE_COUNT + 3, 1, 400, VAR_ADDED);
+  Updating = AppendVariable (STATIC_VARIABLE_COUNT + 4, 1, 400, VAR_ADDED);
+  AppendVariable (6, 1, 400, VAR_ADDED & VAR_DELETED);
+  NewVariableSize = BuildVariable ((VARIABLE_HEADER *)NewVariable, STATIC_VARIABLE_COUNT + 4, 2, 600);
+
+  CommonSize    = NewVariableSize;
+  UserSize      = NewVariableSize;
+  CompactedSize = 0;
+  Variable      = GetStartPointer (mStore);
+  while (IsValidVariableHeader (Variable, GetEndPointer (mStore))) {
+    NextVariable = GetNextVariablePtr (Variable, FALSE);
+    VariableSize = (UINTN)NextVariable - (UINTN)Variable;
+    if (((UINTN)Variable - (UINTN)mStore < KeepOffset) || ((Variable->State == VAR_ADDED) && (Variable != Updating))) {
+      CommonSize += VariableSize;
+      if (GetVariableIndex (Variable) >= STATIC_VARIABLE_COUNT) {
+        UserSize += VariableSize;
+      }
+
+      if ((UINTN)Variable - (UINTN)mStore >= KeepOffset) {
+        CompactedSize += VariableSize;
+      }
+    }
+
+    Variable = NextVariable;
+  }
+
+  InitPointerTrack (&PtrTrack, Updating, NULL);
+  UT_ASSERT_NOT_EFI_ERROR (CompactTestStore (&KeepOffset, &PtrTrack, (VARIABLE_HEADER *)NewVariable, NewVariableSize, &ValidSize));
+  UT_ASSERT_NOT_EQUAL (KeepOffset, 0);
+  UT_ASSERT_MEM_EQUAL (mScratch, mStore, KeepOffset);
+  UT_ASSERT_EQUAL (ValidSize, KeepOffset + CompactedSize + NewVariableSize);
+  UT_ASSERT_EQUAL (mVariableModuleGlobal->CommonVariableTotalSize, CommonSize);
+  UT_ASSERT_EQUAL (mVariableModuleGlobal->CommonUserVariableTotalSize, UserSize);
+  UT_ASSERT_EQUAL (mVariableModuleGlobal->HwErrVariableTotalSize, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A variable in deleted transition after KeepOffset is promoted to ADDED
+  unless the compacted store has an ADDED copy of it: a deleted copy kept
+  before KeepOffset does not count.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CompactionShouldPromoteInDeletedTransitionVariables (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT64           NewVariable[(sizeof (VARIABLE_HEADER) + 64 + MAX_TEST_DATA_SIZE) / sizeof (UINT64)];
+  VARIABLE_HEADER  *Variable;
+  UINTN            NewVariableSize;
+  UINTN            KeepOffset;
+  UINTN            ValidSize;
+  UINT32           Version;
+
+  FormatFlash ();
+  AppendVariable (10, 1, 256, VAR_ADDED & VAR_DELETED);
+  AppendVariable (11, 1, 256, VAR_ADDED);
+  KeepOffset = mLastVariableOffset;
+  AppendVariable (10, 2, 256, VAR_IN_DELETED_TRANSITION & VAR_ADDED);
+  AppendVariable (11, 2, 256, VAR_IN_DELETED_TRANSITION & VAR_ADDED);
+  AppendVariable (12, 1, 256, VAR_IN_DELETED_TRANSITION & VAR_ADDED);
+  AppendVariable (12, 2, 256, VAR_ADDED);
+  NewVariableSize = BuildVariable ((VARIABLE_HEADER *)NewVariable, 13, 1, 256);
+
+  UT_ASSERT_NOT_EFI_ERROR (CompactTestStore (&KeepOffset, NULL, (VARIABLE_HEADER *)NewVariable, NewVariableSize, &ValidSize));
+  UT_ASSERT_NOT_EQUAL (KeepOffset, 0);
+
+  //
+  // The deleted copy of the first variable is kept, its copy in deleted
+  // transition is promoted.
+  //
+  UT_ASSERT_EQUAL (CountVariables ((VARIABLE_STORE_HEADER *)mScratch, 10, VAR_ADDED & VAR_DELETED), 1);
+  UT_ASSERT_EQUAL (CountVariables ((VARIABLE_STORE_HEADER *)mScratch, 10, VAR_ADDED), 1);
+  Variable = (VARIABLE_HEADER *)((UINT8 *)mScratch + KeepOffset);
+  while (IsValidVariableHeader (Variable, GetEndPointer ((VARIABLE_STORE_HEADER *)mScratch))) {
+    if (GetVariableIndex (Variable) == 10) {
+      break;
+    }
+
+    Variable = GetNextVariablePtr (Variable, FALSE);
+  }
+
+  UT_ASSERT_EQUAL (Variable->State, VAR_ADDED);
+  CopyMem (&Version, GetVariableDataPtr (Variable, FALSE), sizeof (Version));
+  UT_ASSERT_EQUAL (Version, 2);
+
+  //
+  // The other ones have an ADDED copy, before or after KeepOffset.
+  //
+  UT_ASSERT_EQUAL (CountVariables ((VARIABLE_STORE_HEADER *)mScratch, 11, VAR_ADDED), 1);
+  UT_ASSERT_EQUAL (CountVariables ((VARIABLE_STORE_HEADER *)mScratch, 11, VAR_IN_DELETED_TRANSITION & VAR_ADDED), 0);
+  UT_ASSERT_EQUAL (CountVariables ((VARIABLE_STORE_HEADER *)mScratch, 12, VAR_ADDED), 1);
+  UT_ASSERT_EQUAL (CountVariables ((VARIABLE_STORE_HEADER *)mScratch, 12, VAR_IN_DELETED_TRANSITION & VAR_ADDED), 0);
+  UT_ASSERT_EQUAL (CountVariables ((VARIABLE_STORE_HEADER *)mScratch, 13, VAR_ADDED), 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  After an incremental compaction, the pointer track of the updated variable
+  points to the new variable in the store, and its copy in deleted transition
+  is dropped.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CompactionShouldTrackTheUpdatedVariable (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT64                  NewVariable[(sizeof (VARIABLE_HEADER) + 64 + MAX_TEST_DATA_SIZE) / sizeof (UINT64)];
+  VARIABLE_POINTER_TRACK  PtrTrack;
+  VARIABLE_HEADER         *Updating;
+  VARIABLE_HEADER         *InDeletedTransition;
+  UINTN                   NewVariableSize;
+  UINTN                   KeepOffset;
+  UINTN                   ValidSize;
+  UINTN                   Index;
+  UINT32                  Version;
+
+  FormatFlash ();
+  for (Index = 0; Index < 4; Index++) {
+    AppendVariable (Index, 1, 1024, VAR_ADDED);
+  }
+
+  for (Index = 0; Index < 4; Index++) {
+    AppendVariable (20, (UINT32)Index + 1, 1024, VAR_ADDED & VAR_DELETED);
+  }
+
+  KeepOffset = mLastVariableOffset;
+  AppendVariable (21, 1, 512, VAR_ADDED);
+  InDeletedTransition = AppendVariable (20, 5, 512, VAR_IN_DELETED_TRANSITION & VAR_ADDED);
+  Updating            = AppendVariable (20, 6, 512, VAR_ADDED);
+  AppendVariable (22, 1, 512, VAR_ADDED);
+  NewVariableSize = BuildVariable ((VARIABLE_HEADER *)NewVariable, 20, 7, 768);
+
+  InitPointerTrack (&PtrTrack, Updating, InDeletedTransition);
+  UT_ASSERT_NOT_EFI_ERROR (CompactTestStore (&KeepOffset, &PtrTrack, (VARIABLE_HEADER *)NewVariable, NewVariableSize, &ValidSize));
+  UT_ASSERT_NOT_EQUAL (KeepOffset, 0);
+  UT_ASSERT_NOT_EFI_ERROR (
+    FtwVariableSpaceRange ((UINTN)mStore, (VARIABLE_STORE_HEADER *)mScratch, KeepOffset, mStore->Size - KeepOffset)
+    );
+
+  UT_ASSERT_TRUE (PtrTrack.InDeletedTransitionPtr == NULL);
+  UT_ASSERT_EQUAL ((UINTN)PtrTrack.CurrPtr - (UINTN)mStore, ValidSize - NewVariableSize);
+  UT_ASSERT_EQUAL (PtrTrack.CurrPtr->State, VAR_ADDED);
+  UT_ASSERT_EQUAL (GetVariableIndex (PtrTrack.CurrPtr), 20);
+  CopyMem (&Version, GetVariableDataPtr (PtrTrack.CurrPtr, FALSE), sizeof (Version));
+  UT_ASSERT_EQUAL (Version, 7);
+  UT_ASSERT_EQUAL (CountVariables (mStore, 20, VAR_ADDED), 1);
+  UT_ASSERT_EQUAL (CountVariables (mStore, 20, VAR_IN_DELETED_TRANSITION & VAR_ADDED), 0);
+  UT_ASSERT_EQUAL (CountVariables (mStore, 21, VAR_ADDED), 1);
+  UT_ASSERT_EQUAL (CountVariables (mStore, 22, VAR_ADDED), 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+/// === TEST ENGINE ================================================================================
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the incremental
+  reclaim and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      ReclaimTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&ReclaimTests, Framework, "Incremental Reclaim Tests", "VarStore.Reclaim", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for ReclaimTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (
+    ReclaimTests,
+    "The incremental reclaim should keep the blocks of long-lived variables",
+    "KeepCleanBlocks",
+    IncrementalReclaimOffsetShouldKeepCleanBlocks,
+    NULL,
+    NULL,
+    NULL
+    );
+  AddTestCase (
+    ReclaimTests,
+    "The incremental reclaim should write fewer blocks and bound the erases per block",
+    "Workload",
+    IncrementalReclaimShouldWriteFewerBlocks,
+    NULL,
+    NULL,
+    NULL
+    );
+  AddTestCase (
+    ReclaimTests,
+    "The compaction should fall back to the whole store when the new variable does not fit",
+    "StoreOverflow",
+    CompactionShouldFallBackWhenTheStoreOverflows,
+    NULL,
+    NULL,
+    NULL
+    );
+  AddTestCase (
+    ReclaimTests,
+    "The compaction should fall back to the whole store when the quota is exceeded",
+    "QuotaExceeded",
+    CompactionShouldFallBackWhenTheQuotaIsExceeded,
+    NULL,
+    NULL,
+    NULL
+    );
+  AddTestCase (
+    ReclaimTests,
+    "The compaction should count the variables kept before the offset",
+    "KeptSizes",
+    CompactionShouldCountTheKeptVariables,
+    NULL,
+    NULL,
+    NULL
+    );
+  AddTestCase (
+    ReclaimTests,
+    "The compaction should promote the variables in deleted transition without an ADDED copy",
+    "InDeletedTransition",
+    CompactionShouldPromoteInDeletedTransitionVariables,
+    NULL,
+    NULL,
+    NULL
+    );
+  AddTestCase (
+    ReclaimTests,
+    "The compaction should track the updated variable in the store",
+    "PointerTrack",
+    CompactionShouldTrackTheUpdatedVariable,
+    NULL,
+    NULL,
+    NULL
+    );
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
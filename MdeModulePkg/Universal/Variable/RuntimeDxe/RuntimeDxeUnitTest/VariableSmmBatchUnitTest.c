@@ -0,0 +1,894 @@
+/** @file
+  Unit tests of the batch and the bulk name enumeration services of the SMI
+  handler of the MM variable driver.
+
+  The communicate buffers are sent to SmmVariableHandler() as the DXE runtime
+  driver does. A malformed batch or request must be rejected with
+  EFI_INVALID_PARAMETER before any variable service is run, and without
+  touching memory outside of the buffers.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Library/MmServicesTableLib.h>
+#include <Guid/SmmVariableCommon.h>
+
+#include "../Variable.h"
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_NAME     "SMM Variable Batch Unit Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+#define TEST_PAYLOAD_SIZE  SIZE_1KB
+#define TEST_GUARD_SIZE    64
+#define TEST_GUARD_BYTE    0xA5
+#define TEST_DATA_SIZE     8
+
+/// === CODE UNDER TEST ===========================================================================
+
+EFI_STATUS
+EFIAPI
+SmmVariableHandler (
+  IN     EFI_HANDLE  DispatchHandle,
+  IN     CONST VOID  *RegisterContext,
+  IN OUT VOID        *CommBuffer,
+  IN OUT UINTN       *CommBufferSize
+  );
+
+extern UINT8  *mVariableBufferPayload;
+extern UINTN  mVariableBufferPayloadSize;
+
+/// === TEST DATA ==================================================================================
+
+//
+// Communicate buffer, followed by a guard area.
+//
+UINT64  mCommBuffer[(SMM_VARIABLE_COMMUNICATE_HEADER_SIZE + TEST_PAYLOAD_SIZE + TEST_GUARD_SIZE) / sizeof (UINT64)];
+UINT64  mCommBufferCopy[ARRAY_SIZE (mCommBuffer)];
+
+//
+// Copy of the payload in SMRAM, followed by a guard area.
+//
+UINT64  mSmramPayload[(TEST_PAYLOAD_SIZE + TEST_GUARD_SIZE) / sizeof (UINT64)];
+
+UINTN  mGetVariableCalls;
+UINTN  mSetVariableCalls;
+
+CHAR16  *mVariableNames[] = { L"Alpha", L"Beta", L"Gamma" };
+
+//
+// Test GUID {8D1A1F3C-6E52-4C0B-A3F4-2B7E9C05D861}
+//
+EFI_GUID  mTestGuid = {
+  0x8d1a1f3c, 0x6e52, 0x4c0b, { 0xa3, 0xf4, 0x2b, 0x7e, 0x9c, 0x05, 0xd8, 0x61 }
+};
+
+/// === SYMBOL DEFINITIONS =========================================================================
+///
+/// These are not directly under test - but required to link VariableSmm.c.
+///
+
+EFI_MM_SYSTEM_TABLE         *gMmst;
+VARIABLE_MODULE_GLOBAL      *mVariableModuleGlobal;
+EFI_FIRMWARE_VOLUME_HEADER  *mNvFvHeaderCache;
+VARIABLE_STORE_HEADER       *mNvVariableCache;
+VARIABLE_INFO_ENTRY         *gVariableInfo;
+BOOLEAN                     mEndOfDxe;
+VAR_CHECK_REQUEST_SOURCE    mRequestSource;
+
+/**
+  Gets the data of a variable: every variable holds TEST_DATA_SIZE bytes of
+  the first character of its name.
+**/
+EFI_STATUS
+EFIAPI
+VariableServiceGetVariable (
+  IN      CHAR16    *VariableName,
+  IN      EFI_GUID  *VendorGuid,
+  OUT     UINT32    *Attributes OPTIONAL,
+  IN OUT  UINTN     *DataSize,
+  OUT     VOID      *Data OPTIONAL
+  )
+{
+  mGetVariableCalls++;
+  if (*DataSize < TEST_DATA_SIZE) {
+    *DataSize = TEST_DATA_SIZE;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  *DataSize = TEST_DATA_SIZE;
+  SetMem (Data, TEST_DATA_SIZE, (UINT8)VariableName[0]);
+  if (Attributes != NULL) {
+    *Attributes = EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Sets a variable, only the calls are counted.
+**/
+EFI_STATUS
+EFIAPI
+VariableServiceSetVariable (
+  IN CHAR16    *VariableName,
+  IN EFI_GUID  *VendorGuid,
+  IN UINT32    Attributes,
+  IN UINTN     DataSize,
+  IN VOID      *Data
+  )
+{
+  mSetVariableCalls++;
+  return EFI_SUCCESS;
+}
+
+/**
+  Gets the name following a variable in mVariableNames.
+**/
+EFI_STATUS
+EFIAPI
+VariableServiceGetNextVariableName (
+  IN OUT  UINTN     *VariableNameSize,
+  IN OUT  CHAR16    *VariableName,
+  IN OUT  EFI_GUID  *VendorGuid
+  )
+{
+  UINTN  Index;
+
+  Index = 0;
+  if (VariableName[0] != L'\0') {
+    while ((Index < ARRAY_SIZE (mVariableNames)) && (StrCmp (VariableName, mVariableNames[Index]) != 0)) {
+      Index++;
+    }
+
+    Index++;
+  }
+
+  if (Index >= ARRAY_SIZE (mVariableNames)) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (*VariableNameSize < StrSize (mVariableNames[Index])) {
+    *VariableNameSize = StrSize (mVariableNames[Index]);
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  *VariableNameSize = StrSize (mVariableNames[Index]);
+  CopyMem (VariableName, mVariableNames[Index], *VariableNameSize);
+  CopyGuid (VendorGuid, &mTestGuid);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+VariableServiceQueryVariableInfo (
+  IN  UINT32  Attributes,
+  OUT UINT64  *MaximumVariableStorageSize,
+  OUT UINT64  *RemainingVariableStorageSize,
+  OUT UINT64  *MaximumVariableSize
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+VariableLockRequestToLock (
+  IN CONST EDKII_VARIABLE_LOCK_PROTOCOL  *This,
+  IN       CHAR16                        *VariableName,
+  IN       EFI_GUID                      *VendorGuid
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+VarCheckRegisterSetVariableCheckHandler (
+  IN VAR_CHECK_SET_VARIABLE_CHECK_HANDLER  Handler
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+VarCheckVariablePropertySet (
+  IN CHAR16                       *Name,
+  IN EFI_GUID                     *Guid,
+  IN VAR_CHECK_VARIABLE_PROPERTY  *VariableProperty
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+VarCheckVariablePropertyGet (
+  IN CHAR16                        *Name,
+  IN EFI_GUID                      *Guid,
+  OUT VAR_CHECK_VARIABLE_PROPERTY  *VariableProperty
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+VOID ***
+EFIAPI
+VarCheckLibInitializeAtEndOfDxe (
+  IN OUT UINTN  *AddressPointerCount OPTIONAL
+  )
+{
+  return NULL;
+}
+
+EFI_STATUS
+GetFvbInfoByAddress (
+  IN  EFI_PHYSICAL_ADDRESS                Address,
+  OUT EFI_HANDLE                          *FvbHandle OPTIONAL,
+  OUT EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  **FvbProtocol OPTIONAL
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+EFI_STATUS
+EFIAPI
+GetVariableFlashNvStorageInfo (
+  OUT EFI_PHYSICAL_ADDRESS  *BaseAddress,
+  OUT UINT64                *Length
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+LockVariablePolicy (
+  VOID
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+FlushPendingRuntimeVariableCacheUpdates (
+  VOID
+  )
+{
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+VariableCommonInitialize (
+  VOID
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+VariableWriteServiceInitialize (
+  VOID
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+UINTN
+GetMaxVariableSize (
+  VOID
+  )
+{
+  return TEST_PAYLOAD_SIZE;
+}
+
+VOID
+ReclaimForOS (
+  VOID
+  )
+{
+}
+
+VOID
+InitializeVariableQuota (
+  VOID
+  )
+{
+}
+
+VOID
+MorLockInitAtEndOfDxe (
+  VOID
+  )
+{
+}
+
+VOID
+VariableSpeculationBarrier (
+  VOID
+  )
+{
+}
+
+VOID
+VariableNotifySmmReady (
+  VOID
+  )
+{
+}
+
+VOID
+VariableNotifySmmWriteReady (
+  VOID
+  )
+{
+}
+
+/**
+  The communicate buffer is outside of SMRAM in this test.
+**/
+BOOLEAN
+VariableSmmIsPrimaryBufferValid (
+  IN EFI_PHYSICAL_ADDRESS  Buffer,
+  IN UINT64                Length
+  )
+{
+  return TRUE;
+}
+
+BOOLEAN
+VariableSmmIsNonPrimaryBufferValid (
+  IN EFI_PHYSICAL_ADDRESS  Buffer,
+  IN UINT64                Length
+  )
+{
+  return TRUE;
+}
+
+/// === HELPER FUNCTIONS ===========================================================================
+
+/**
+  Gets the payload of the communicate buffer.
+**/
+VOID *
+GetPayload (
+  VOID
+  )
+{
+  return ((SMM_VARIABLE_COMMUNICATE_HEADER *)mCommBuffer)->Data;
+}
+
+/**
+  Starts an empty batch, or a request for the names following an empty name.
+**/
+VOID
+ResetCommBuffer (
+  VOID
+  )
+{
+  ZeroMem (mCommBuffer, SMM_VARIABLE_COMMUNICATE_HEADER_SIZE + TEST_PAYLOAD_SIZE);
+  SetMem ((UINT8 *)mCommBuffer + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE + TEST_PAYLOAD_SIZE, TEST_GUARD_SIZE, TEST_GUARD_BYTE);
+  SetMem (mSmramPayload, sizeof (mSmramPayload), TEST_GUARD_BYTE);
+  mVariableBufferPayload     = (UINT8 *)mSmramPayload;
+  mVariableBufferPayloadSize = TEST_PAYLOAD_SIZE;
+  mGetVariableCalls          = 0;
+  mSetVariableCalls          = 0;
+}
+
+/**
+  Appends an operation to the batch of the communicate buffer.
+
+  @param[in, out]  PayloadSize  The size of the batch, updated with the operation.
+  @param[in]       Function     The function of the operation.
+  @param[in]       Name         The name of the variable.
+  @param[in]       DataSize     The size of the data of the operation.
+
+  @return The operation.
+**/
+SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION *
+AppendOperation (
+  IN OUT UINTN   *PayloadSize,
+  IN     UINTN   Function,
+  IN     CHAR16  *Name,
+  IN     UINTN   DataSize
+  )
+{
+  SMM_VARIABLE_COMMUNICATE_BATCH            *Batch;
+  SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION  *Operation;
+
+  Batch = GetPayload ();
+  if (*PayloadSize == 0) {
+    *PayloadSize = sizeof (SMM_VARIABLE_COMMUNICATE_BATCH);
+  }
+
+  Operation                    = (SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION *)((UINT8 *)Batch + *PayloadSize);
+  Operation->Function          = Function;
+  Operation->ReturnStatus      = EFI_NOT_READY;
+  Operation->Size              = SMM_VARIABLE_BATCH_OPERATION_SIZE (StrSize (Name), DataSize);
+  Operation->Access.DataSize   = DataSize;
+  Operation->Access.NameSize   = StrSize (Name);
+  Operation->Access.Attributes = EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS;
+  CopyGuid (&Operation->Access.Guid, &mTestGuid);
+  CopyMem (Operation->Access.Name, Name, StrSize (Name));
+
+  Batch->OperationCount++;
+  *PayloadSize += Operation->Size;
+  return Operation;
+}
+
+/**
+  Sends the communicate buffer to the SMI handler.
+
+  @param[in]  Function     The function of the request.
+  @param[in]  PayloadSize  The size of the payload of the request.
+
+  @return The ReturnStatus of the communicate buffer.
+**/
+EFI_STATUS
+SendCommBuffer (
+  IN UINTN  Function,
+  IN UINTN  PayloadSize
+  )
+{
+  SMM_VARIABLE_COMMUNICATE_HEADER  *Header;
+  UINTN                            CommBufferSize;
+
+  Header               = (SMM_VARIABLE_COMMUNICATE_HEADER *)mCommBuffer;
+  Header->Function     = Function;
+  Header->ReturnStatus = EFI_NOT_READY;
+  CopyMem (mCommBufferCopy, mCommBuffer, sizeof (mCommBuffer));
+
+  CommBufferSize = SMM_VARIABLE_COMMUNICATE_HEADER_SIZE + PayloadSize;
+  SmmVariableHandler (NULL, NULL, mCommBuffer, &CommBufferSize);
+  return Header->ReturnStatus;
+}
+
+/**
+  Checks that a malformed batch has been rejected: no variable service has
+  been run, the payload of the communicate buffer is unchanged and the guard
+  areas after the buffers are intact.
+**/
+BOOLEAN
+IsBatchRejected (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  if ((mGetVariableCalls != 0) || (mSetVariableCalls != 0)) {
+    return FALSE;
+  }
+
+  if (CompareMem (GetPayload (), (UINT8 *)mCommBufferCopy + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE, TEST_PAYLOAD_SIZE + TEST_GUARD_SIZE) != 0) {
+    return FALSE;
+  }
+
+  for (Index = 0; Index < TEST_GUARD_SIZE; Index++) {
+    if (((UINT8 *)mSmramPayload)[TEST_PAYLOAD_SIZE + Index] != TEST_GUARD_BYTE) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/// === TEST CASES =================================================================================
+
+/**
+  A well formed batch runs every operation and returns their results.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BatchShouldRunEveryOperation (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION  *Get;
+  SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION  *Set;
+  SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION  *TooSmall;
+  UINT8                                     Data[TEST_DATA_SIZE];
+  UINTN                                     PayloadSize;
+
+  ResetCommBuffer ();
+  PayloadSize = 0;
+  Get         = AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_GET_VARIABLE, L"Alpha", TEST_DATA_SIZE);
+  Set         = AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_SET_VARIABLE, L"Beta", TEST_DATA_SIZE);
+  TooSmall    = AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_GET_VARIABLE, L"Gamma", 1);
+
+  UT_ASSERT_NOT_EFI_ERROR (SendCommBuffer (SMM_VARIABLE_FUNCTION_BATCH, PayloadSize));
+  UT_ASSERT_EQUAL (mGetVariableCalls, 2);
+  UT_ASSERT_EQUAL (mSetVariableCalls, 1);
+  UT_ASSERT_NOT_EFI_ERROR (Get->ReturnStatus);
+  UT_ASSERT_NOT_EFI_ERROR (Set->ReturnStatus);
+  UT_ASSERT_STATUS_EQUAL (TooSmall->ReturnStatus, EFI_BUFFER_TOO_SMALL);
+  UT_ASSERT_EQUAL (TooSmall->Access.DataSize, TEST_DATA_SIZE);
+  SetMem (Data, sizeof (Data), (UINT8)L'A');
+  UT_ASSERT_MEM_EQUAL ((UINT8 *)Get->Access.Name + Get->Access.NameSize, Data, sizeof (Data));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A payload smaller than the batch header is rejected.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BatchShouldRejectATruncatedHeader (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_VARIABLE_COMMUNICATE_BATCH  *Batch;
+  UINTN                           PayloadSize;
+
+  for (PayloadSize = 0; PayloadSize < sizeof (SMM_VARIABLE_COMMUNICATE_BATCH); PayloadSize++) {
+    ResetCommBuffer ();
+    Batch                 = GetPayload ();
+    Batch->OperationCount = 1;
+    UT_ASSERT_STATUS_EQUAL (SendCommBuffer (SMM_VARIABLE_FUNCTION_BATCH, PayloadSize), EFI_INVALID_PARAMETER);
+    UT_ASSERT_TRUE (IsBatchRejected ());
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A batch larger than the buffer in SMRAM is not copied nor run. The SMI
+  handler stops before the ReturnStatus of the request is updated.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BatchShouldIgnoreAnOversizedBuffer (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  PayloadSize;
+
+  ResetCommBuffer ();
+  PayloadSize = 0;
+  AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_SET_VARIABLE, L"Alpha", TEST_DATA_SIZE);
+  UT_ASSERT_STATUS_EQUAL (SendCommBuffer (SMM_VARIABLE_FUNCTION_BATCH, TEST_PAYLOAD_SIZE + SMM_VARIABLE_BATCH_ALIGNMENT), EFI_NOT_READY);
+  UT_ASSERT_TRUE (IsBatchRejected ());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  An operation whose size is not aligned, or smaller than its header, is
+  rejected with the whole batch.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BatchShouldRejectMisalignedOperations (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION  *Operation;
+  UINTN                                     PayloadSize;
+  UINTN                                     Delta;
+
+  for (Delta = 1; Delta < SMM_VARIABLE_BATCH_ALIGNMENT; Delta++) {
+    ResetCommBuffer ();
+    PayloadSize = 0;
+    AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_GET_VARIABLE, L"Alpha", TEST_DATA_SIZE);
+    Operation        = AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_GET_VARIABLE, L"Beta", TEST_DATA_SIZE);
+    Operation->Size += Delta;
+    PayloadSize     += Delta;
+    UT_ASSERT_STATUS_EQUAL (SendCommBuffer (SMM_VARIABLE_FUNCTION_BATCH, PayloadSize), EFI_INVALID_PARAMETER);
+    UT_ASSERT_TRUE (IsBatchRejected ());
+  }
+
+  ResetCommBuffer ();
+  PayloadSize     = 0;
+  Operation       = AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_GET_VARIABLE, L"Alpha", TEST_DATA_SIZE);
+  Operation->Size = 0;
+  UT_ASSERT_STATUS_EQUAL (SendCommBuffer (SMM_VARIABLE_FUNCTION_BATCH, PayloadSize), EFI_INVALID_PARAMETER);
+  UT_ASSERT_TRUE (IsBatchRejected ());
+
+  ResetCommBuffer ();
+  PayloadSize     = 0;
+  Operation       = AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_GET_VARIABLE, L"Alpha", TEST_DATA_SIZE);
+  Operation->Size = ALIGN_VALUE (OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION, Access.Name), SMM_VARIABLE_BATCH_ALIGNMENT) - SMM_VARIABLE_BATCH_ALIGNMENT;
+  UT_ASSERT_STATUS_EQUAL (SendCommBuffer (SMM_VARIABLE_FUNCTION_BATCH, PayloadSize), EFI_INVALID_PARAMETER);
+  UT_ASSERT_TRUE (IsBatchRejected ());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  An operation whose name and data sizes exceed its size is rejected, also
+  when their sum overflows UINTN.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BatchShouldRejectOverflowingSizes (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  //
+  // The sum of the sizes of most of these wraps around to a small value.
+  //
+  STATIC CONST struct {
+    UINTN    NameSize;
+    UINTN    DataSize;
+  } Sizes[] = {
+    { sizeof (L"Alpha"),      MAX_UINTN                          },
+    { sizeof (L"Alpha"),      MAX_UINTN - sizeof (L"Alpha") + 1  },
+    { sizeof (L"Alpha"),      MAX_UINTN - sizeof (L"Alpha") + 5  },
+    { MAX_UINTN,              TEST_DATA_SIZE                     },
+    { MAX_UINTN - 1,          4                                  },
+    { MAX_UINTN / 2 + 1,      MAX_UINTN / 2 + 1                  },
+    { sizeof (L"Alpha"),      TEST_DATA_SIZE + 8                 },
+  };
+  SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION  *Operation;
+  UINTN                                     PayloadSize;
+  UINTN                                     Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (Sizes); Index++) {
+    ResetCommBuffer ();
+    PayloadSize = 0;
+    AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_SET_VARIABLE, L"Beta", TEST_DATA_SIZE);
+    Operation                  = AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_GET_VARIABLE, L"Alpha", TEST_DATA_SIZE);
+    Operation->Access.NameSize = Sizes[Index].NameSize;
+    Operation->Access.DataSize = Sizes[Index].DataSize;
+    UT_ASSERT_STATUS_EQUAL (SendCommBuffer (SMM_VARIABLE_FUNCTION_BATCH, PayloadSize), EFI_INVALID_PARAMETER);
+    UT_ASSERT_TRUE (IsBatchRejected ());
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  An operation whose name is not Null-terminated rejects the whole batch,
+  the operations before it are not run.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BatchShouldRejectUnterminatedNames (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION  *Operation;
+  UINTN                                     PayloadSize;
+
+  //
+  // The terminator of the name is overwritten, the zeroed data following the
+  // name must not be taken for it.
+  //
+  ResetCommBuffer ();
+  PayloadSize = 0;
+  AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_SET_VARIABLE, L"Alpha", TEST_DATA_SIZE);
+  Operation                                = AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_SET_VARIABLE, L"Beta", TEST_DATA_SIZE);
+  Operation->Access.Name[StrLen (L"Beta")] = L'!';
+  UT_ASSERT_STATUS_EQUAL (SendCommBuffer (SMM_VARIABLE_FUNCTION_BATCH, PayloadSize), EFI_INVALID_PARAMETER);
+  UT_ASSERT_TRUE (IsBatchRejected ());
+
+  //
+  // The name is empty, or has an odd size.
+  //
+  ResetCommBuffer ();
+  PayloadSize = 0;
+  AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_GET_VARIABLE, L"Alpha", TEST_DATA_SIZE);
+  Operation                  = AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_GET_VARIABLE, L"Beta", TEST_DATA_SIZE);
+  Operation->Access.NameSize = 0;
+  UT_ASSERT_STATUS_EQUAL (SendCommBuffer (SMM_VARIABLE_FUNCTION_BATCH, PayloadSize), EFI_INVALID_PARAMETER);
+  UT_ASSERT_TRUE (IsBatchRejected ());
+
+  ResetCommBuffer ();
+  PayloadSize                = 0;
+  Operation                  = AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_GET_VARIABLE, L"Beta", TEST_DATA_SIZE);
+  Operation->Access.NameSize = 1;
+  UT_ASSERT_STATUS_EQUAL (SendCommBuffer (SMM_VARIABLE_FUNCTION_BATCH, PayloadSize), EFI_INVALID_PARAMETER);
+  UT_ASSERT_TRUE (IsBatchRejected ());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A batch whose operation count does not match the operations filling its
+  payload is rejected.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BatchShouldRejectAMismatchedCount (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_VARIABLE_COMMUNICATE_BATCH  *Batch;
+  UINTN                           PayloadSize;
+  UINTN                           Count;
+
+  for (Count = 0; Count < 6; Count++) {
+    if (Count == 2) {
+      continue;
+    }
+
+    ResetCommBuffer ();
+    PayloadSize = 0;
+    AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_GET_VARIABLE, L"Alpha", TEST_DATA_SIZE);
+    AppendOperation (&PayloadSize, SMM_VARIABLE_FUNCTION_SET_VARIABLE, L"Beta", TEST_DATA_SIZE);
+    Batch                 = GetPayload ();
+    Batch->OperationCount = Count;
+    UT_ASSERT_STATUS_EQUAL (SendCommBuffer (SMM_VARIABLE_FUNCTION_BATCH, PayloadSize), EFI_INVALID_PARAMETER);
+    UT_ASSERT_TRUE (IsBatchRejected ());
+  }
+
+  ResetCommBuffer ();
+  Batch                 = GetPayload ();
+  Batch->OperationCount = MAX_UINTN;
+  UT_ASSERT_STATUS_EQUAL (SendCommBuffer (SMM_VARIABLE_FUNCTION_BATCH, TEST_PAYLOAD_SIZE), EFI_INVALID_PARAMETER);
+  UT_ASSERT_TRUE (IsBatchRejected ());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The names following a variable are returned as many as fit in the payload,
+  and a malformed request is rejected.
+
+  @param[in]  Context    Unit test context.
+
+  @retval UNIT_TEST_PASSED  The unit test passed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+GetNextVariableNamesShouldValidateTheRequest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES  *Request;
+  EDKII_VARIABLE_NAME_ENTRY                         *Entry;
+  UINTN                                             PayloadSize;
+  UINTN                                             Index;
+
+  //
+  // All the names fit in the payload.
+  //
+  ResetCommBuffer ();
+  Request = GetPayload ();
+  UT_ASSERT_NOT_EFI_ERROR (SendCommBuffer (SMM_VARIABLE_FUNCTION_GET_NEXT_VARIABLE_NAMES, TEST_PAYLOAD_SIZE));
+  UT_ASSERT_EQUAL (Request->NameCount, ARRAY_SIZE (mVariableNames));
+  Entry = &Request->Start;
+  for (Index = 0; Index < ARRAY_SIZE (mVariableNames); Index++) {
+    UT_ASSERT_EQUAL (Entry->NameSize, StrSize (mVariableNames[Index]));
+    UT_ASSERT_MEM_EQUAL (Entry->Name, mVariableNames[Index], Entry->NameSize);
+    UT_ASSERT_TRUE (CompareGuid (&Entry->VendorGuid, &mTestGuid));
+    Entry = (EDKII_VARIABLE_NAME_ENTRY *)((UINT8 *)Entry + EDKII_VARIABLE_NAME_ENTRY_SIZE (Entry->NameSize));
+  }
+
+  //
+  // Only the first name fits, the enumeration continues after it.
+  //
+  ResetCommBuffer ();
+  Request     = GetPayload ();
+  PayloadSize = OFFSET_OF (SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES, Start) + EDKII_VARIABLE_NAME_ENTRY_SIZE (StrSize (mVariableNames[0]));
+  UT_ASSERT_STATUS_EQUAL (SendCommBuffer (SMM_VARIABLE_FUNCTION_GET_NEXT_VARIABLE_NAMES, PayloadSize), EFI_BUFFER_TOO_SMALL);
+  UT_ASSERT_EQUAL (Request->NameCount, 1);
+  UT_ASSERT_MEM_EQUAL (Request->Start.Name, mVariableNames[0], StrSize (mVariableNames[0]));
+
+  //
+  // The payload is too small for a name.
+  //
+  for (PayloadSize = 0; PayloadSize < OFFSET_OF (SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES, Start.Name) + sizeof (CHAR16); PayloadSize++) {
+    ResetCommBuffer ();
+    UT_ASSERT_STATUS_EQUAL (SendCommBuffer (SMM_VARIABLE_FUNCTION_GET_NEXT_VARIABLE_NAMES, PayloadSize), EFI_INVALID_PARAMETER);
+    UT_ASSERT_TRUE (IsBatchRejected ());
+  }
+
+  //
+  // The start name is not Null-terminated within the payload.
+  //
+  ResetCommBuffer ();
+  Request     = GetPayload ();
+  PayloadSize = OFFSET_OF (SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES, Start.Name) + StrLen (mVariableNames[1]) * sizeof (CHAR16);
+  CopyMem (Request->Start.Name, mVariableNames[1], StrLen (mVariableNames[1]) * sizeof (CHAR16));
+  UT_ASSERT_STATUS_EQUAL (SendCommBuffer (SMM_VARIABLE_FUNCTION_GET_NEXT_VARIABLE_NAMES, PayloadSize), EFI_INVALID_PARAMETER);
+  UT_ASSERT_TRUE (IsBatchRejected ());
+
+  return UNIT_TEST_PASSED;
+}
+
+/// === TEST ENGINE ================================================================================
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the batch
+  services of the SMI handler and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      BatchTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&BatchTests, Framework, "SMM Variable Batch Tests", "SmmVariable.Batch", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BatchTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (BatchTests, "A well formed batch should run every operation", "Run", BatchShouldRunEveryOperation, NULL, NULL, NULL);
+  AddTestCase (BatchTests, "A batch smaller than its header should be rejected", "TruncatedHeader", BatchShouldRejectATruncatedHeader, NULL, NULL, NULL);
+  AddTestCase (BatchTests, "A batch larger than the SMRAM buffer should be ignored", "Oversized", BatchShouldIgnoreAnOversizedBuffer, NULL, NULL, NULL);
+  AddTestCase (BatchTests, "A batch with misaligned operations should be rejected", "Misaligned", BatchShouldRejectMisalignedOperations, NULL, NULL, NULL);
+  AddTestCase (BatchTests, "A batch with overflowing sizes should be rejected", "Overflow", BatchShouldRejectOverflowingSizes, NULL, NULL, NULL);
+  AddTestCase (BatchTests, "A batch with an unterminated name should be rejected", "Unterminated", BatchShouldRejectUnterminatedNames, NULL, NULL, NULL);
+  AddTestCase (BatchTests, "A batch with a mismatched operation count should be rejected", "Count", BatchShouldRejectAMismatchedCount, NULL, NULL, NULL);
+  AddTestCase (BatchTests, "The bulk name enumeration should validate the request", "Names", GetNextVariableNamesShouldValidateTheRequest, NULL, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -525,18 +525,12 @@ Reclaim (
   )
 {
   VARIABLE_HEADER        *Variable;
-  VARIABLE_HEADER        *AddedVariable;
   VARIABLE_HEADER        *NextVariable;
-  VARIABLE_HEADER        *NextAddedVariable;
   VARIABLE_STORE_HEADER  *VariableStoreHeader;
   UINT8                  *ValidBuffer;
   UINTN                  MaximumBufferSize;
   UINTN                  VariableSize;
-  UINTN                  NameSize;
-  UINT8                  *CurrPtr;
-  VOID                   *Point0;
-  VOID                   *Point1;
-  BOOLEAN                FoundAdded;
+  UINTN                  ValidSize;
   EFI_STATUS             Status;
   EFI_STATUS             DoneStatus;
   UINTN                  CommonVariableTotalSize;
@@ -544,9 +538,13 @@ Reclaim (
   UINTN                  HwErrVariableTotalSize;
   VARIABLE_HEADER        *UpdatingVariable;
   VARIABLE_HEADER        *UpdatingInDeletedTransition;
+  UINTN                  KeepOffset;
+  UINTN                  BlockSize;
+  UINTN                  BlockOffset;
   BOOLEAN                AuthFormat;
 
   AuthFormat                  = mVariableModuleGlobal->VariableGlobal.AuthFormat;
+  KeepOffset                  = 0;
   UpdatingVariable            = NULL;
   UpdatingInDeletedTransition = NULL;
   if (UpdatingPtrTrack != NULL) {
@@ -556,10 +554,6 @@ Reclaim (
 
   VariableStoreHeader = (VARIABLE_STORE_HEADER *)((UINTN)VariableBase);
 
-  CommonVariableTotalSize     = 0;
-  CommonUserVariableTotalSize = 0;
-  HwErrVariableTotalSize      = 0;
-
   if (IsVolatile || mVariableModuleGlobal->VariableGlobal.EmuNvMode) {
     //
     // Start Pointers for the variable.
@@ -604,137 +598,48 @@ Reclaim (
     //
     MaximumBufferSize = mNvVariableCache->Size;
     ValidBuffer       = (UINT8 *)mNvVariableCache;
-  }
-
-  SetMem (ValidBuffer, MaximumBufferSize, 0xff);
-
-  //
-  // Copy variable store header.
-  //
-  CopyMem (ValidBuffer, VariableStoreHeader, sizeof (VARIABLE_STORE_HEADER));
-  CurrPtr = (UINT8 *)GetStartPointer ((VARIABLE_STORE_HEADER *)ValidBuffer);
 
-  //
-  // Reinstall all ADDED variables as long as they are not identical to Updating Variable.
-  //
-  Variable = GetStartPointer (VariableStoreHeader);
-  while (IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))) {
-    NextVariable = GetNextVariablePtr (Variable, AuthFormat);
-    if ((Variable != UpdatingVariable) && (Variable->State == VAR_ADDED)) {
-      VariableSize = (UINTN)NextVariable - (UINTN)Variable;
-      CopyMem (CurrPtr, (UINT8 *)Variable, VariableSize);
-      CurrPtr += VariableSize;
-      if ((!IsVolatile) && ((Variable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) == EFI_VARIABLE_HARDWARE_ERROR_RECORD)) {
-        HwErrVariableTotalSize += VariableSize;
-      } else if ((!IsVolatile) && ((Variable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) != EFI_VARIABLE_HARDWARE_ERROR_RECORD)) {
-        CommonVariableTotalSize += VariableSize;
-        if (IsUserVariable (Variable)) {
-          CommonUserVariableTotalSize += VariableSize;
-        }
-      }
-    }
-
-    Variable = NextVariable;
-  }
-
-  //
-  // Reinstall all in delete transition variables.
-  //
-  Variable = GetStartPointer (VariableStoreHeader);
-  while (IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))) {
-    NextVariable = GetNextVariablePtr (Variable, AuthFormat);
-    if ((Variable != UpdatingVariable) && (Variable != UpdatingInDeletedTransition) && (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
-      //
-      // Buffer has cached all ADDED variable.
-      // Per IN_DELETED variable, we have to guarantee that
-      // no ADDED one in previous buffer.
-      //
-
-      FoundAdded    = FALSE;
-      AddedVariable = GetStartPointer ((VARIABLE_STORE_HEADER *)ValidBuffer);
-      while (IsValidVariableHeader (AddedVariable, GetEndPointer ((VARIABLE_STORE_HEADER *)ValidBuffer))) {
-        NextAddedVariable = GetNextVariablePtr (AddedVariable, AuthFormat);
-        NameSize          = NameSizeOfVariable (AddedVariable, AuthFormat);
-        if (CompareGuid (
-              GetVendorGuidPtr (AddedVariable, AuthFormat),
-              GetVendorGuidPtr (Variable, AuthFormat)
-              ) && (NameSize == NameSizeOfVariable (Variable, AuthFormat)))
-        {
-          Point0 = (VOID *)GetVariableNamePtr (AddedVariable, AuthFormat);
-          Point1 = (VOID *)GetVariableNamePtr (Variable, AuthFormat);
-          if (CompareMem (Point0, Point1, NameSize) == 0) {
-            FoundAdded = TRUE;
-            break;
-          }
-        }
-
-        AddedVariable = NextAddedVariable;
+    //
+    // When a new variable is integrated, try to compact only the end of the store,
+    // so the erase blocks before KeepOffset are not written.
+    //
+    if ((NewVariable != NULL) && (PcdGet32 (PcdVariableIncrementalReclaimSize) != 0)) {
+      Status = GetBlockSizeAndOffsetByAddress (VariableBase, &BlockSize, &BlockOffset);
+      if (!EFI_ERROR (Status)) {
+        Status = GetIncrementalReclaimOffset (
+                   VariableStoreHeader,
+                   BlockSize,
+                   BlockOffset,
+                   AuthFormat,
+                   UpdatingVariable,
+                   UpdatingInDeletedTransition,
+                   NewVariableSize + PcdGet32 (PcdVariableIncrementalReclaimSize),
+                   &KeepOffset
+                   );
       }
 
-      if (!FoundAdded) {
-        //
-        // Promote VAR_IN_DELETED_TRANSITION to VAR_ADDED.
-        //
-        VariableSize = (UINTN)NextVariable - (UINTN)Variable;
-        CopyMem (CurrPtr, (UINT8 *)Variable, VariableSize);
-        ((VARIABLE_HEADER *)CurrPtr)->State = VAR_ADDED;
-        CurrPtr                            += VariableSize;
-        if ((!IsVolatile) && ((Variable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) == EFI_VARIABLE_HARDWARE_ERROR_RECORD)) {
-          HwErrVariableTotalSize += VariableSize;
-        } else if ((!IsVolatile) && ((Variable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) != EFI_VARIABLE_HARDWARE_ERROR_RECORD)) {
-          CommonVariableTotalSize += VariableSize;
-          if (IsUserVariable (Variable)) {
-            CommonUserVariableTotalSize += VariableSize;
-          }
-        }
+      if (EFI_ERROR (Status)) {
+        KeepOffset = 0;
       }
     }
-
-    Variable = NextVariable;
   }
 
-  //
-  // Install the new variable if it is not NULL.
-  //
-  if (NewVariable != NULL) {
-    if (((UINTN)CurrPtr - (UINTN)ValidBuffer) + NewVariableSize > VariableStoreHeader->Size) {
-      //
-      // No enough space to store the new variable.
-      //
-      Status = EFI_OUT_OF_RESOURCES;
-      goto Done;
-    }
-
-    if (!IsVolatile) {
-      if ((NewVariable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) == EFI_VARIABLE_HARDWARE_ERROR_RECORD) {
-        HwErrVariableTotalSize += NewVariableSize;
-      } else if ((NewVariable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) != EFI_VARIABLE_HARDWARE_ERROR_RECORD) {
-        CommonVariableTotalSize += NewVariableSize;
-        if (IsUserVariable (NewVariable)) {
-          CommonUserVariableTotalSize += NewVariableSize;
-        }
-      }
-
-      if ((HwErrVariableTotalSize > PcdGet32 (PcdHwErrStorageSize)) ||
-          (CommonVariableTotalSize > mVariableModuleGlobal->CommonVariableSpace) ||
-          (CommonUserVariableTotalSize > mVariableModuleGlobal->CommonMaxUserVariableSpace))
-      {
-        //
-        // No enough space to store the new variable by NV or NV+HR attribute.
-        //
-        Status = EFI_OUT_OF_RESOURCES;
-        goto Done;
-      }
-    }
-
-    CopyMem (CurrPtr, (UINT8 *)NewVariable, NewVariableSize);
-    ((VARIABLE_HEADER *)CurrPtr)->State = VAR_ADDED;
-    if (UpdatingVariable != NULL) {
-      UpdatingPtrTrack->CurrPtr                = (VARIABLE_HEADER *)((UINTN)UpdatingPtrTrack->StartPtr + ((UINTN)CurrPtr - (UINTN)GetStartPointer ((VARIABLE_STORE_HEADER *)ValidBuffer)));
-      UpdatingPtrTrack->InDeletedTransitionPtr = NULL;
-    }
-
-    CurrPtr += NewVariableSize;
+  Status = CompactVariableStore (
+             VariableStoreHeader,
+             ValidBuffer,
+             MaximumBufferSize,
+             IsVolatile,
+             &KeepOffset,
+             UpdatingPtrTrack,
+             NewVariable,
+             NewVariableSize,
+             &ValidSize,
+             &HwErrVariableTotalSize,
+             &CommonVariableTotalSize,
+             &CommonUserVariableTotalSize
+             );
+  if (EFI_ERROR (Status)) {
+    goto Done;
   }
 
   if (IsVolatile || mVariableModuleGlobal->VariableGlobal.EmuNvMode) {
@@ -742,8 +647,8 @@ Reclaim (
     // If volatile/emulated non-volatile variable store, just copy valid buffer.
     //
     SetMem ((UINT8 *)(UINTN)VariableBase, VariableStoreHeader->Size, 0xff);
-    CopyMem ((UINT8 *)(UINTN)VariableBase, ValidBuffer, (UINTN)CurrPtr - (UINTN)ValidBuffer);
-    *LastVariableOffset = (UINTN)CurrPtr - (UINTN)ValidBuffer;
+    CopyMem ((UINT8 *)(UINTN)VariableBase, ValidBuffer, ValidSize);
+    *LastVariableOffset = ValidSize;
     if (!IsVolatile) {
       //
       // Emulated non-volatile variable mode.
@@ -757,13 +662,24 @@ Reclaim (
   } else {
     //
     // If non-volatile variable store, perform FTW here.
-    //
-    Status = FtwVariableSpace (
-               VariableBase,
-               (VARIABLE_STORE_HEADER *)ValidBuffer
-               );
+    // An incremental reclaim only writes the blocks from KeepOffset.
+    //
+    if (KeepOffset != 0) {
+      Status = FtwVariableSpaceRange (
+                 VariableBase,
+                 (VARIABLE_STORE_HEADER *)ValidBuffer,
+                 KeepOffset,
+                 VariableStoreHeader->Size - KeepOffset
+                 );
+    } else {
+      Status = FtwVariableSpace (
+                 VariableBase,
+                 (VARIABLE_STORE_HEADER *)ValidBuffer
+                 );
+    }
+
     if (!EFI_ERROR (Status)) {
-      *LastVariableOffset                                = (UINTN)CurrPtr - (UINTN)ValidBuffer;
+      *LastVariableOffset                                = ValidSize;
       mVariableModuleGlobal->HwErrVariableTotalSize      = HwErrVariableTotalSize;
       mVariableModuleGlobal->CommonVariableTotalSize     = CommonVariableTotalSize;
       mVariableModuleGlobal->CommonUserVariableTotalSize = CommonUserVariableTotalSize;
@@ -157,6 +157,159 @@ FtwVariableSpace (
   IN VARIABLE_STORE_HEADER  *VariableBuffer
   );
 
+/**
+  Writes a range of a buffer to the same range of the variable storage
+  space, in the working block.
+
+  Fault Tolerant Write protocol is used for writing, with a single write
+  record, so either the whole range or none of it is updated.
+
+  @param  VariableBase   Base address of variable to write.
+  @param  VariableBuffer Point to the variable data buffer.
+  @param  Offset         Offset of the range from the variable store header.
+  @param  Length         Length in bytes of the range.
+
+  @retval EFI_SUCCESS    The function completed successfully.
+  @retval EFI_NOT_FOUND  Fail to locate Fault Tolerant Write protocol.
+  @retval EFI_ABORTED    The function could not complete successfully.
+
+**/
+EFI_STATUS
+FtwVariableSpaceRange (
+  IN EFI_PHYSICAL_ADDRESS   VariableBase,
+  IN VARIABLE_STORE_HEADER  *VariableBuffer,
+  IN UINTN                  Offset,
+  IN UINTN                  Length
+  );
+
+/**
+  Gets the size of the erase block containing the given address, and the
+  offset of the address in the block.
+
+  @param  Address        Address which should be contained
+                         by the FVB device.
+  @param  BlockSize      Pointer to the block size for output.
+  @param  Offset         Pointer to offset for output.
+
+  @retval EFI_SUCCESS    The block size and offset are returned.
+  @retval EFI_NOT_FOUND  Fail to find FVB handle by address.
+  @retval EFI_ABORTED    Fail to get the block size and offset.
+
+**/
+EFI_STATUS
+GetBlockSizeAndOffsetByAddress (
+  IN  EFI_PHYSICAL_ADDRESS  Address,
+  OUT UINTN                 *BlockSize,
+  OUT UINTN                 *Offset
+  );
+
+/**
+  Finds the offset from which an incremental reclaim compacts the
+  non-volatile variable store.
+
+  The variables before the offset are kept as they are, including the
+  deleted ones, and the blocks holding them are not written. The offset
+  is the start of the first variable of an erase block, it is chosen as
+  high as possible so that only the dirtiest blocks at the end of the
+  store are rewritten, while compacting the variables from it still leaves
+  RequiredSize bytes free.
+
+  The blocks after the offset are erased by every reclaim, and a reclaim
+  that frees less space is needed sooner. So the deleted bytes kept before
+  the offset are also bounded to half of the space a reclaim of the whole
+  store would free: an incremental reclaim then frees at least half of it,
+  and the tail blocks are erased at most about twice as often as with a
+  reclaim of the whole store, while the blocks before the offset are
+  erased less often.
+
+  @param[in]  VariableStoreHeader         Pointer to the variable store.
+  @param[in]  BlockSize                   Size of the erase blocks of the store.
+  @param[in]  BlockOffset                 Offset of the store header in its erase block.
+  @param[in]  AuthFormat                  TRUE indicates authenticated variables are used.
+                                          FALSE indicates authenticated variables are not used.
+  @param[in]  UpdatingVariable            Variable dropped by the reclaim, it must not be kept.
+  @param[in]  UpdatingInDeletedTransition Variable dropped by the reclaim, it must not be kept.
+  @param[in]  RequiredSize                Free space the reclaim must produce.
+  @param[out] KeepOffset                  Offset from the store header of the first
+                                          compacted variable.
+
+  @retval EFI_SUCCESS    KeepOffset is returned.
+  @retval EFI_NOT_FOUND  Only a reclaim of the whole store frees enough space.
+
+**/
+EFI_STATUS
+GetIncrementalReclaimOffset (
+  IN  VARIABLE_STORE_HEADER  *VariableStoreHeader,
+  IN  UINTN                  BlockSize,
+  IN  UINTN                  BlockOffset,
+  IN  BOOLEAN                AuthFormat,
+  IN  VARIABLE_HEADER        *UpdatingVariable OPTIONAL,
+  IN  VARIABLE_HEADER        *UpdatingInDeletedTransition OPTIONAL,
+  IN  UINTN                  RequiredSize,
+  OUT UINTN                  *KeepOffset
+  );
+
+/**
+  Is user variable?
+
+  @param[in] Variable   Pointer to variable header.
+
+  @retval TRUE          User variable.
+  @retval FALSE         System variable.
+
+**/
+BOOLEAN
+IsUserVariable (
+  IN VARIABLE_HEADER  *Variable
+  );
+
+/**
+  Compacts a variable store into a buffer and integrates a new variable.
+
+  The ADDED variables are copied, except the one being updated, then the
+  IN_DELETED_TRANSITION ones that have no ADDED copy are promoted to ADDED,
+  then the new variable is appended. When KeepOffset is not 0, the store
+  header and the variables before KeepOffset are copied as they are and
+  only the variables from KeepOffset are compacted. If the new variable
+  then does not fit in the store or in its quota, the whole store is
+  compacted instead and KeepOffset is set to 0.
+
+  @param[in]      VariableStoreHeader          Pointer to the variable store.
+  @param[out]     ValidBuffer                  Buffer receiving the compacted store.
+  @param[in]      ValidBufferSize              Size of ValidBuffer.
+  @param[in]      IsVolatile                   The variable store is volatile or not,
+                                               the sizes are only counted for a non-volatile one.
+  @param[in, out] KeepOffset                   Offset from the store header of the first
+                                               compacted variable, 0 to compact the whole
+                                               store. Set to 0 if the whole store is compacted.
+  @param[in, out] UpdatingPtrTrack             Pointer to updating variable pointer track structure.
+  @param[in]      NewVariable                  Pointer to new variable.
+  @param[in]      NewVariableSize              New variable size.
+  @param[out]     ValidSize                    Size of the compacted store in ValidBuffer.
+  @param[out]     HwErrVariableTotalSize       Total size of the hardware error record variables.
+  @param[out]     CommonVariableTotalSize      Total size of the common variables.
+  @param[out]     CommonUserVariableTotalSize  Total size of the common user variables.
+
+  @retval EFI_SUCCESS           The store is compacted in ValidBuffer.
+  @retval EFI_OUT_OF_RESOURCES  The new variable does not fit in the store or in its quota.
+
+**/
+EFI_STATUS
+CompactVariableStore (
+  IN     VARIABLE_STORE_HEADER   *VariableStoreHeader,
+  OUT    UINT8                   *ValidBuffer,
+  IN     UINTN                   ValidBufferSize,
+  IN     BOOLEAN                 IsVolatile,
+  IN OUT UINTN                   *KeepOffset,
+  IN OUT VARIABLE_POINTER_TRACK  *UpdatingPtrTrack OPTIONAL,
+  IN     VARIABLE_HEADER         *NewVariable OPTIONAL,
+  IN     UINTN                   NewVariableSize,
+  OUT    UINTN                   *ValidSize,
+  OUT    UINTN                   *HwErrVariableTotalSize,
+  OUT    UINTN                   *CommonVariableTotalSize,
+  OUT    UINTN                   *CommonUserVariableTotalSize
+  );
+
 /**
   Finds variable in storage blocks of volatile and non-volatile storage areas.
 
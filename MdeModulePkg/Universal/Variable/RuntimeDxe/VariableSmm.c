@@ -424,6 +424,206 @@ SmmVariableGetStatistics (
   return EFI_SUCCESS;
 }
 
+/**
+  Run the GetVariable and SetVariable operations of a batch.
+
+  Caution: This function may receive untrusted input.
+  The batch is a copy of the communicate buffer payload in SMRAM. The size and the
+  name of every operation are validated before any operation is run, and the
+  operations must fill the payload exactly.
+
+  @param[in, out]  Batch        The batch. On output, the ReturnStatus of every operation
+                                is updated, and the data of the GetVariable operations.
+  @param[in]       PayloadSize  The size of the batch, including its header.
+
+  @retval EFI_SUCCESS           The operations have been run.
+  @retval EFI_INVALID_PARAMETER The batch is malformed, no operation has been run.
+
+**/
+EFI_STATUS
+SmmVariableRunBatch (
+  IN OUT SMM_VARIABLE_COMMUNICATE_BATCH  *Batch,
+  IN     UINTN                           PayloadSize
+  )
+{
+  SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION  *Operation;
+  UINTN                                     Offset;
+  UINTN                                     Index;
+  UINTN                                     AccessSize;
+
+  if (PayloadSize < sizeof (SMM_VARIABLE_COMMUNICATE_BATCH)) {
+    DEBUG ((DEBUG_ERROR, "Batch: SMM communication buffer size invalid!\n"));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // Validate the layout of all the operations first, so that a malformed batch is
+  // rejected as a whole.
+  //
+  Offset = sizeof (SMM_VARIABLE_COMMUNICATE_BATCH);
+  for (Index = 0; Index < Batch->OperationCount; Index++) {
+    if (PayloadSize - Offset < OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION, Access.Name)) {
+      DEBUG ((DEBUG_ERROR, "Batch: SMM communication buffer size invalid!\n"));
+      return EFI_INVALID_PARAMETER;
+    }
+
+    Operation = (SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION *)((UINT8 *)Batch + Offset);
+    if ((Operation->Size < OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION, Access.Name)) ||
+        (Operation->Size > PayloadSize - Offset) ||
+        ((Operation->Size % SMM_VARIABLE_BATCH_ALIGNMENT) != 0))
+    {
+      DEBUG ((DEBUG_ERROR, "Batch: Operation size invalid!\n"));
+      return EFI_INVALID_PARAMETER;
+    }
+
+    AccessSize = Operation->Size - OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION, Access.Name);
+    if ((Operation->Access.NameSize > AccessSize) ||
+        (Operation->Access.DataSize > AccessSize - Operation->Access.NameSize))
+    {
+      DEBUG ((DEBUG_ERROR, "Batch: Data size exceed operation size!\n"));
+      return EFI_INVALID_PARAMETER;
+    }
+
+    if ((Operation->Access.NameSize < sizeof (CHAR16)) ||
+        (Operation->Access.Name[Operation->Access.NameSize / sizeof (CHAR16) - 1] != L'\0'))
+    {
+      //
+      // Make sure VariableName is A Null-terminated string.
+      //
+      DEBUG ((DEBUG_ERROR, "Batch: Variable name is not Null-terminated!\n"));
+      return EFI_INVALID_PARAMETER;
+    }
+
+    Offset += Operation->Size;
+  }
+
+  if (Offset != PayloadSize) {
+    DEBUG ((DEBUG_ERROR, "Batch: Operation count does not match the buffer size!\n"));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // The VariableSpeculationBarrier() call here is to ensure the previous
+  // range/content checks for the CommBuffer have been completed before the
+  // subsequent consumption of the CommBuffer content.
+  //
+  VariableSpeculationBarrier ();
+
+  Offset = sizeof (SMM_VARIABLE_COMMUNICATE_BATCH);
+  for (Index = 0; Index < Batch->OperationCount; Index++) {
+    Operation = (SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION *)((UINT8 *)Batch + Offset);
+    Offset   += Operation->Size;
+
+    switch (Operation->Function) {
+      case SMM_VARIABLE_FUNCTION_GET_VARIABLE:
+        Operation->ReturnStatus = VariableServiceGetVariable (
+                                    Operation->Access.Name,
+                                    &Operation->Access.Guid,
+                                    &Operation->Access.Attributes,
+                                    &Operation->Access.DataSize,
+                                    (UINT8 *)Operation->Access.Name + Operation->Access.NameSize
+                                    );
+        break;
+
+      case SMM_VARIABLE_FUNCTION_SET_VARIABLE:
+        Operation->ReturnStatus = VariableServiceSetVariable (
+                                    Operation->Access.Name,
+                                    &Operation->Access.Guid,
+                                    Operation->Access.Attributes,
+                                    Operation->Access.DataSize,
+                                    (UINT8 *)Operation->Access.Name + Operation->Access.NameSize
+                                    );
+        break;
+
+      default:
+        Operation->ReturnStatus = EFI_UNSUPPORTED;
+        break;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the names of the variables following a variable, as many as fit in the
+  communicate buffer.
+
+  Caution: This function may receive untrusted input.
+  The request is a copy of the communicate buffer payload in SMRAM, the names are
+  written to the communicate buffer only within PayloadSize.
+
+  @param[in, out]  Request      The copy of the request. Its Start name is used as the
+                                cursor of the enumeration.
+  @param[out]      Response     The communicate buffer payload receiving the names.
+  @param[in]       PayloadSize  The size of the communicate buffer payload.
+
+  @retval EFI_SUCCESS           The names following Start are returned, up to the last one.
+  @retval EFI_BUFFER_TOO_SMALL  Names are returned and more names follow the last one.
+  @retval EFI_INVALID_PARAMETER The payload is too small or the Start name is not a
+                                Null-terminated string.
+  @retval Others                The error returned by VariableServiceGetNextVariableName().
+
+**/
+EFI_STATUS
+SmmVariableGetNextVariableNames (
+  IN OUT SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES  *Request,
+  OUT    SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES  *Response,
+  IN     UINTN                                             PayloadSize
+  )
+{
+  EFI_STATUS                 Status;
+  EDKII_VARIABLE_NAME_ENTRY  *Entry;
+  UINTN                      NameBufferSize;
+  UINTN                      NameSize;
+  UINTN                      EntrySize;
+  UINTN                      NameCount;
+  UINTN                      Offset;
+
+  if (PayloadSize < OFFSET_OF (SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES, Start.Name) + sizeof (CHAR16)) {
+    DEBUG ((DEBUG_ERROR, "GetNextVariableNames: SMM communication buffer size invalid!\n"));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  NameBufferSize = PayloadSize - OFFSET_OF (SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES, Start.Name);
+  if (Request->Start.Name[NameBufferSize / sizeof (CHAR16) - 1] != L'\0') {
+    //
+    // Make sure input VariableName is A Null-terminated string.
+    //
+    return EFI_INVALID_PARAMETER;
+  }
+
+  NameCount = 0;
+  Offset    = OFFSET_OF (SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES, Start);
+  while (TRUE) {
+    NameSize = NameBufferSize;
+    Status   = VariableServiceGetNextVariableName (&NameSize, Request->Start.Name, &Request->Start.VendorGuid);
+    if (Status == EFI_NOT_FOUND) {
+      Status = EFI_SUCCESS;
+      break;
+    }
+
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    EntrySize = EDKII_VARIABLE_NAME_ENTRY_SIZE (NameSize);
+    if (EntrySize > PayloadSize - Offset) {
+      Status = EFI_BUFFER_TOO_SMALL;
+      break;
+    }
+
+    Entry = (EDKII_VARIABLE_NAME_ENTRY *)((UINT8 *)Response + Offset);
+    CopyGuid (&Entry->VendorGuid, &Request->Start.VendorGuid);
+    Entry->NameSize = NameSize;
+    CopyMem (Entry->Name, Request->Start.Name, NameSize);
+    Offset += EntrySize;
+    NameCount++;
+  }
+
+  Response->NameCount = NameCount;
+  return Status;
+}
+
 /**
   Communication service SMI Handler entry.
 
@@ -986,6 +1186,32 @@ SmmVariableHandler (
       Status = EFI_SUCCESS;
       break;
 
+    case SMM_VARIABLE_FUNCTION_BATCH:
+      //
+      // The size of the batch is validated by SmmVariableRunBatch().
+      // Copy the input communicate buffer payload to pre-allocated SMM variable buffer payload.
+      //
+      CopyMem (mVariableBufferPayload, SmmVariableFunctionHeader->Data, CommBufferPayloadSize);
+      Status = SmmVariableRunBatch ((SMM_VARIABLE_COMMUNICATE_BATCH *)mVariableBufferPayload, CommBufferPayloadSize);
+      if (!EFI_ERROR (Status)) {
+        CopyMem (SmmVariableFunctionHeader->Data, mVariableBufferPayload, CommBufferPayloadSize);
+      }
+
+      break;
+
+    case SMM_VARIABLE_FUNCTION_GET_NEXT_VARIABLE_NAMES:
+      //
+      // The size of the request is validated by SmmVariableGetNextVariableNames().
+      // Copy the input communicate buffer payload to pre-allocated SMM variable buffer payload.
+      //
+      CopyMem (mVariableBufferPayload, SmmVariableFunctionHeader->Data, CommBufferPayloadSize);
+      Status = SmmVariableGetNextVariableNames (
+                 (SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES *)mVariableBufferPayload,
+                 (SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES *)SmmVariableFunctionHeader->Data,
+                 CommBufferPayloadSize
+                 );
+      break;
+
     default:
       Status = EFI_UNSUPPORTED;
   }
@@ -25,6 +25,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/SmmVariable.h>
 #include <Protocol/VariableLock.h>
 #include <Protocol/VarCheck.h>
+#include <Protocol/VariableBatch.h>
 
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
@@ -40,6 +41,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/EventGroup.h>
 #include <Guid/SmmVariableCommon.h>
 #include <Guid/VariableRuntimeCacheInfo.h>
+#include <Guid/ZeroGuid.h>
 
 #include "PrivilegePolymorphic.h"
 #include "VariableParsing.h"
@@ -57,9 +59,20 @@ BOOLEAN                         mVariableAuthFormat;
 EFI_LOCK                        mVariableServicesLock;
 EDKII_VARIABLE_LOCK_PROTOCOL    mVariableLock;
 EDKII_VAR_CHECK_PROTOCOL        mVarCheck;
+EDKII_VARIABLE_BATCH_PROTOCOL   mVariableBatch;
 VARIABLE_RUNTIME_CACHE_INFO     mVariableRtCacheInfo;
 BOOLEAN                         mIsRuntimeCacheEnabled = FALSE;
 
+//
+// Names returned by the last SMM_VARIABLE_FUNCTION_GET_NEXT_VARIABLE_NAMES, used by
+// GetNextVariableName() when the runtime cache is disabled.
+//
+UINT8    *mVariableNameCache = NULL;
+UINTN    mVariableNameCacheSize;
+UINTN    mVariableNameCacheCursor;
+BOOLEAN  mVariableNameCacheComplete;
+BOOLEAN  mVariableNameCacheValid = FALSE;
+
 /**
   The logic to initialize the VariablePolicy engine is in its own file.
 
@@ -1006,6 +1019,247 @@ Done:
   return Status;
 }
 
+/**
+  Get the names of the variables following a variable in one communicate round-trip
+  to SMM.
+
+  VariableName and VendorGuid may point to a name entry returned by the previous call,
+  the entries are in the communicate buffer and are valid until the next communication.
+
+  @param[in]  VariableName  Name of the variable to start after, an empty name to
+                            start from the first variable.
+  @param[in]  VendorGuid    Vendor GUID of the variable to start after.
+  @param[out] Entries       Returns the packed name entries.
+  @param[out] EntriesSize   Returns the size of the name entries.
+  @param[out] NameCount     Returns the number of name entries.
+
+  @retval EFI_SUCCESS            The names are returned, up to the last variable.
+  @retval EFI_BUFFER_TOO_SMALL   The names are returned and more names follow the last entry.
+  @retval EFI_INVALID_PARAMETER  The name exceeds the SMM payload limit, or is not the
+                                 name of an existing variable.
+  @retval Others                 The names could not be retrieved.
+
+**/
+EFI_STATUS
+GetNextVariableNamesInSmm (
+  IN  CONST CHAR16               *VariableName,
+  IN  CONST EFI_GUID             *VendorGuid,
+  OUT EDKII_VARIABLE_NAME_ENTRY  **Entries,
+  OUT UINTN                      *EntriesSize,
+  OUT UINTN                      *NameCount
+  )
+{
+  EFI_STATUS                                        Status;
+  SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES  *SmmGetNextVariableNames;
+  EDKII_VARIABLE_NAME_ENTRY                         *Entry;
+  UINTN                                             NameSize;
+  UINTN                                             Index;
+
+  NameSize                = StrSize (VariableName);
+  SmmGetNextVariableNames = NULL;
+
+  //
+  // If input string exceeds SMM payload limit. Return failure
+  //
+  if (NameSize > mVariableBufferPayloadSize - OFFSET_OF (SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES, Start.Name)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // The whole payload is sent so that SMM can fill it with names.
+  //
+  Status = InitCommunicateBuffer ((VOID **)&SmmGetNextVariableNames, mVariableBufferPayloadSize, SMM_VARIABLE_FUNCTION_GET_NEXT_VARIABLE_NAMES);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  ASSERT (SmmGetNextVariableNames != NULL);
+
+  //
+  // VariableName may be a name entry of the previous response, which is located after
+  // Start in the same buffer, so copy it forward with CopyMem() before clearing the rest.
+  //
+  CopyMem (&SmmGetNextVariableNames->Start.VendorGuid, VendorGuid, sizeof (EFI_GUID));
+  SmmGetNextVariableNames->Start.NameSize = NameSize;
+  CopyMem (SmmGetNextVariableNames->Start.Name, VariableName, NameSize);
+  ZeroMem (
+    (UINT8 *)SmmGetNextVariableNames->Start.Name + NameSize,
+    mVariableBufferPayloadSize - OFFSET_OF (SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAMES, Start.Name) - NameSize
+    );
+
+  Status = SendCommunicateBuffer (mVariableBufferPayloadSize);
+  if (EFI_ERROR (Status) && (Status != EFI_BUFFER_TOO_SMALL)) {
+    return Status;
+  }
+
+  *Entries     = &SmmGetNextVariableNames->Start;
+  *NameCount   = SmmGetNextVariableNames->NameCount;
+  *EntriesSize = 0;
+  Entry        = *Entries;
+  for (Index = 0; Index < *NameCount; Index++) {
+    *EntriesSize += EDKII_VARIABLE_NAME_ENTRY_SIZE (Entry->NameSize);
+    Entry         = (EDKII_VARIABLE_NAME_ENTRY *)((UINT8 *)*Entries + *EntriesSize);
+  }
+
+  return Status;
+}
+
+/**
+  Fill the variable name cache with the names following a variable.
+
+  @param[in]  VariableName  Name of the variable to start after, an empty name to
+                            start from the first variable.
+  @param[in]  VendorGuid    Vendor GUID of the variable to start after.
+
+  @retval EFI_SUCCESS       The name cache is filled.
+  @retval Others            The names could not be retrieved, the name cache is invalid.
+
+**/
+EFI_STATUS
+FillVariableNameCache (
+  IN  CONST CHAR16    *VariableName,
+  IN  CONST EFI_GUID  *VendorGuid
+  )
+{
+  EFI_STATUS                 Status;
+  EDKII_VARIABLE_NAME_ENTRY  *Entries;
+  UINTN                      EntriesSize;
+  UINTN                      NameCount;
+
+  mVariableNameCacheValid = FALSE;
+
+  Status = GetNextVariableNamesInSmm (VariableName, VendorGuid, &Entries, &EntriesSize, &NameCount);
+  if (EFI_ERROR (Status) && (Status != EFI_BUFFER_TOO_SMALL)) {
+    return Status;
+  }
+
+  if ((NameCount == 0) && (Status == EFI_BUFFER_TOO_SMALL)) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  CopyMem (mVariableNameCache, Entries, EntriesSize);
+  mVariableNameCacheSize     = EntriesSize;
+  mVariableNameCacheComplete = (BOOLEAN)(Status == EFI_SUCCESS);
+  mVariableNameCacheCursor   = 0;
+  mVariableNameCacheValid    = TRUE;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Find the entry following a variable in the variable name cache.
+
+  @param[in]  VariableName  Name of the variable.
+  @param[in]  VendorGuid    Vendor GUID of the variable.
+
+  @return The offset of the entry following the variable in the cache, which is the size
+          of the cache if the variable is the last one, or MAX_UINTN if the variable is
+          not in the cache.
+
+**/
+UINTN
+FindNextInVariableNameCache (
+  IN  CONST CHAR16    *VariableName,
+  IN  CONST EFI_GUID  *VendorGuid
+  )
+{
+  EDKII_VARIABLE_NAME_ENTRY  *Entry;
+  UINTN                      NameSize;
+  UINTN                      Offset;
+
+  NameSize = StrSize (VariableName);
+
+  //
+  // The variable is usually the one returned last.
+  //
+  Offset = mVariableNameCacheCursor;
+  if (Offset < mVariableNameCacheSize) {
+    Entry = (EDKII_VARIABLE_NAME_ENTRY *)(mVariableNameCache + Offset);
+    if ((Entry->NameSize == NameSize) && CompareGuid (&Entry->VendorGuid, VendorGuid) &&
+        (CompareMem (Entry->Name, VariableName, NameSize) == 0))
+    {
+      return Offset + EDKII_VARIABLE_NAME_ENTRY_SIZE (Entry->NameSize);
+    }
+  }
+
+  Offset = 0;
+  while (Offset < mVariableNameCacheSize) {
+    Entry   = (EDKII_VARIABLE_NAME_ENTRY *)(mVariableNameCache + Offset);
+    Offset += EDKII_VARIABLE_NAME_ENTRY_SIZE (Entry->NameSize);
+    if ((Entry->NameSize == NameSize) && CompareGuid (&Entry->VendorGuid, VendorGuid) &&
+        (CompareMem (Entry->Name, VariableName, NameSize) == 0))
+    {
+      return Offset;
+    }
+  }
+
+  return MAX_UINTN;
+}
+
+/**
+  Finds the next available variable from the variable name cache, which is filled
+  with as many names as one SMM communicate round-trip returns.
+
+  The cache is refilled when an enumeration starts, so that a new enumeration sees the
+  variables changed since the previous one. Changes made by SetVariable() invalidate
+  the cache.
+
+  @param[in, out] VariableNameSize   Size of the variable name.
+  @param[in, out] VariableName       Pointer to variable name.
+  @param[in, out] VendorGuid         Variable Vendor Guid.
+
+  @retval EFI_SUCCESS                The function completed successfully.
+  @retval EFI_NOT_FOUND              The next variable was not found.
+  @retval EFI_BUFFER_TOO_SMALL       The VariableNameSize is too small for the result.
+                                     VariableNameSize has been updated with the size needed to complete the request.
+  @retval EFI_INVALID_PARAMETER      The input values of VariableName and VendorGuid are not a name and
+                                     GUID of an existing variable.
+  @retval EFI_DEVICE_ERROR           The variable could not be retrieved due to a hardware error.
+
+**/
+EFI_STATUS
+GetNextVariableNameInNameCache (
+  IN OUT  UINTN     *VariableNameSize,
+  IN OUT  CHAR16    *VariableName,
+  IN OUT  EFI_GUID  *VendorGuid
+  )
+{
+  EFI_STATUS                 Status;
+  EDKII_VARIABLE_NAME_ENTRY  *Entry;
+  UINTN                      Next;
+
+  Next = MAX_UINTN;
+  if (mVariableNameCacheValid && (VariableName[0] != 0)) {
+    Next = FindNextInVariableNameCache (VariableName, VendorGuid);
+  }
+
+  if ((Next == MAX_UINTN) || ((Next == mVariableNameCacheSize) && !mVariableNameCacheComplete)) {
+    Status = FillVariableNameCache (VariableName, VendorGuid);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Next = 0;
+  }
+
+  if (Next == mVariableNameCacheSize) {
+    return EFI_NOT_FOUND;
+  }
+
+  Entry = (EDKII_VARIABLE_NAME_ENTRY *)(mVariableNameCache + Next);
+  if (*VariableNameSize < Entry->NameSize) {
+    *VariableNameSize = Entry->NameSize;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  CopyGuid (VendorGuid, &Entry->VendorGuid);
+  CopyMem (VariableName, Entry->Name, Entry->NameSize);
+  *VariableNameSize        = Entry->NameSize;
+  mVariableNameCacheCursor = Next;
+
+  return EFI_SUCCESS;
+}
+
 /**
   This code Finds the Next available variable.
 
@@ -1063,6 +1317,8 @@ RuntimeServiceGetNextVariableName (
   AcquireLockOnlyAtBootTime (&mVariableServicesLock);
   if (mIsRuntimeCacheEnabled) {
     Status = GetNextVariableNameInRuntimeCache (VariableNameSize, VariableName, VendorGuid);
+  } else if (mVariableNameCache != NULL) {
+    Status = GetNextVariableNameInNameCache (VariableNameSize, VariableName, VendorGuid);
   } else {
     Status = GetNextVariableNameInSmm (VariableNameSize, VariableName, VendorGuid);
   }
@@ -1166,7 +1422,8 @@ RuntimeServiceSetVariable (
   //
   // Send data to SMM.
   //
-  Status = SendCommunicateBuffer (PayloadSize);
+  Status                  = SendCommunicateBuffer (PayloadSize);
+  mVariableNameCacheValid = FALSE;
 
 Done:
   ReleaseLockOnlyAtBootTime (&mVariableServicesLock);
@@ -1255,6 +1512,283 @@ Done:
   return Status;
 }
 
+/**
+  Run a vector of variable operations, packing as many operations as fit in the
+  communicate buffer in each SMM communicate round-trip.
+
+  An operation too large to share the communicate buffer is run alone through the
+  runtime services.
+
+  @param[in]      This            The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in]      OperationCount  Number of operations.
+  @param[in, out] Operations      The operations.
+
+  @retval EFI_SUCCESS            All the operations have been run. The status of each
+                                 is in its Status field.
+  @retval EFI_INVALID_PARAMETER  Operations is NULL and OperationCount is not zero.
+
+**/
+EFI_STATUS
+EFIAPI
+VariableBatchExecute (
+  IN     EDKII_VARIABLE_BATCH_PROTOCOL   *This,
+  IN     UINTN                           OperationCount,
+  IN OUT EDKII_VARIABLE_BATCH_OPERATION  *Operations
+  )
+{
+  EFI_STATUS                                Status;
+  SMM_VARIABLE_COMMUNICATE_BATCH            *SmmBatch;
+  SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION  *SmmOperation;
+  EDKII_VARIABLE_BATCH_OPERATION            *Operation;
+  UINTN                                     PayloadSize;
+  UINTN                                     OperationSize;
+  UINTN                                     NameSize;
+  UINTN                                     First;
+  UINTN                                     Index;
+  UINTN                                     AloneIndex;
+  UINTN                                     Current;
+  UINTN                                     Offset;
+
+  if ((Operations == NULL) && (OperationCount != 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Index = 0;
+  while (Index < OperationCount) {
+    AcquireLockOnlyAtBootTime (&mVariableServicesLock);
+
+    SmmBatch = NULL;
+    Status   = InitCommunicateBuffer ((VOID **)&SmmBatch, sizeof (SMM_VARIABLE_COMMUNICATE_BATCH), SMM_VARIABLE_FUNCTION_BATCH);
+    ASSERT_EFI_ERROR (Status);
+    ASSERT (SmmBatch != NULL);
+
+    SmmBatch->OperationCount = 0;
+    SmmBatch->Reserved       = 0;
+    PayloadSize              = sizeof (SMM_VARIABLE_COMMUNICATE_BATCH);
+    First                    = Index;
+    AloneIndex               = MAX_UINTN;
+
+    //
+    // Pack the operations while they fit in the communicate buffer.
+    //
+    for ( ; Index < OperationCount; Index++) {
+      Operation = &Operations[Index];
+      if ((Operation->VariableName == NULL) || (Operation->VendorGuid == NULL) ||
+          ((Operation->Type != EdkiiVariableBatchGetVariable) && (Operation->Type != EdkiiVariableBatchSetVariable)) ||
+          ((Operation->Type == EdkiiVariableBatchSetVariable) && (Operation->VariableName[0] == 0)) ||
+          ((Operation->DataSize != 0) && (Operation->Data == NULL)))
+      {
+        Operation->Status = EFI_INVALID_PARAMETER;
+        continue;
+      }
+
+      NameSize = StrSize (Operation->VariableName);
+      if ((NameSize > mVariableBufferPayloadSize) || (Operation->DataSize > mVariableBufferPayloadSize)) {
+        OperationSize = MAX_UINTN;
+      } else {
+        OperationSize = SMM_VARIABLE_BATCH_OPERATION_SIZE (NameSize, Operation->DataSize);
+      }
+
+      if (OperationSize > mVariableBufferPayloadSize - PayloadSize) {
+        if (SmmBatch->OperationCount == 0) {
+          AloneIndex = Index;
+          Index++;
+        }
+
+        break;
+      }
+
+      SmmOperation                    = (SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION *)((UINT8 *)SmmBatch + PayloadSize);
+      SmmOperation->Function          = (Operation->Type == EdkiiVariableBatchGetVariable) ?
+                                        SMM_VARIABLE_FUNCTION_GET_VARIABLE : SMM_VARIABLE_FUNCTION_SET_VARIABLE;
+      SmmOperation->ReturnStatus      = EFI_NOT_READY;
+      SmmOperation->Size              = OperationSize;
+      SmmOperation->Access.DataSize   = Operation->DataSize;
+      SmmOperation->Access.NameSize   = NameSize;
+      SmmOperation->Access.Attributes = Operation->Attributes;
+      CopyGuid (&SmmOperation->Access.Guid, Operation->VendorGuid);
+      CopyMem (SmmOperation->Access.Name, Operation->VariableName, NameSize);
+      if (Operation->Type == EdkiiVariableBatchSetVariable) {
+        CopyMem ((UINT8 *)SmmOperation->Access.Name + NameSize, Operation->Data, Operation->DataSize);
+      }
+
+      Operation->Status = EFI_NOT_READY;
+      PayloadSize      += OperationSize;
+      SmmBatch->OperationCount++;
+    }
+
+    if (SmmBatch->OperationCount != 0) {
+      InitCommunicateBuffer (NULL, PayloadSize, SMM_VARIABLE_FUNCTION_BATCH);
+      Status = SendCommunicateBuffer (PayloadSize);
+
+      //
+      // Get the results of the packed operations from SMM.
+      //
+      Offset = sizeof (SMM_VARIABLE_COMMUNICATE_BATCH);
+      for (Current = First; Current < Index; Current++) {
+        Operation = &Operations[Current];
+        if ((Operation->Status != EFI_NOT_READY) || (Current == AloneIndex)) {
+          continue;
+        }
+
+        SmmOperation = (SMM_VARIABLE_COMMUNICATE_BATCH_OPERATION *)((UINT8 *)SmmBatch + Offset);
+        Offset      += SmmOperation->Size;
+        if (EFI_ERROR (Status)) {
+          Operation->Status = Status;
+          continue;
+        }
+
+        Operation->Status = SmmOperation->ReturnStatus;
+        if (Operation->Type == EdkiiVariableBatchGetVariable) {
+          if ((Operation->Status == EFI_SUCCESS) || (Operation->Status == EFI_BUFFER_TOO_SMALL)) {
+            Operation->DataSize = SmmOperation->Access.DataSize;
+          }
+
+          if (Operation->Status == EFI_SUCCESS) {
+            Operation->Attributes = SmmOperation->Access.Attributes;
+            CopyMem (Operation->Data, (UINT8 *)SmmOperation->Access.Name + SmmOperation->Access.NameSize, Operation->DataSize);
+          }
+        } else {
+          mVariableNameCacheValid = FALSE;
+        }
+      }
+    }
+
+    ReleaseLockOnlyAtBootTime (&mVariableServicesLock);
+
+    if (!EfiAtRuntime ()) {
+      for (Current = First; Current < Index; Current++) {
+        Operation = &Operations[Current];
+        if ((Operation->Type == EdkiiVariableBatchSetVariable) && !EFI_ERROR (Operation->Status) && (Current != AloneIndex)) {
+          SecureBootHook (Operation->VariableName, Operation->VendorGuid);
+        }
+      }
+    }
+
+    if (AloneIndex != MAX_UINTN) {
+      Operation = &Operations[AloneIndex];
+      if (Operation->Type == EdkiiVariableBatchGetVariable) {
+        Operation->Status = RuntimeServiceGetVariable (
+                              Operation->VariableName,
+                              Operation->VendorGuid,
+                              &Operation->Attributes,
+                              &Operation->DataSize,
+                              Operation->Data
+                              );
+      } else {
+        Operation->Status = RuntimeServiceSetVariable (
+                              Operation->VariableName,
+                              Operation->VendorGuid,
+                              Operation->Attributes,
+                              Operation->DataSize,
+                              Operation->Data
+                              );
+      }
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the names and vendor GUIDs of all the variables, with as many names as fit in the
+  communicate buffer in each SMM communicate round-trip.
+
+  @param[in]      This        The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in, out] BufferSize  On input, the size of Buffer. On output, the size of the
+                              name entries, or the size needed.
+  @param[out]     Buffer      Packed EDKII_VARIABLE_NAME_ENTRY entries.
+  @param[out]     NameCount   Number of entries returned in Buffer. OPTIONAL
+
+  @retval EFI_SUCCESS            The names have been returned.
+  @retval EFI_BUFFER_TOO_SMALL   BufferSize is too small. It has been updated with the
+                                 size needed.
+  @retval EFI_INVALID_PARAMETER  BufferSize is NULL, or Buffer is NULL and *BufferSize is
+                                 not zero.
+  @retval EFI_DEVICE_ERROR       The names could not be retrieved due to a hardware error.
+
+**/
+EFI_STATUS
+EFIAPI
+VariableBatchGetVariableNames (
+  IN     EDKII_VARIABLE_BATCH_PROTOCOL  *This,
+  IN OUT UINTN                          *BufferSize,
+  OUT    VOID                           *Buffer,
+  OUT    UINTN                          *NameCount OPTIONAL
+  )
+{
+  EFI_STATUS                 Status;
+  EDKII_VARIABLE_NAME_ENTRY  *Entries;
+  EDKII_VARIABLE_NAME_ENTRY  *Last;
+  CONST CHAR16               *VariableName;
+  CONST EFI_GUID             *VendorGuid;
+  UINTN                      EntriesSize;
+  UINTN                      EntryCount;
+  UINTN                      Size;
+  UINTN                      Count;
+
+  if ((BufferSize == NULL) || ((Buffer == NULL) && (*BufferSize != 0))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  AcquireLockOnlyAtBootTime (&mVariableServicesLock);
+
+  VariableName = L"";
+  VendorGuid   = &gZeroGuid;
+  Size         = 0;
+  Count        = 0;
+  do {
+    Status = GetNextVariableNamesInSmm (VariableName, VendorGuid, &Entries, &EntriesSize, &EntryCount);
+    if (EFI_ERROR (Status) && (Status != EFI_BUFFER_TOO_SMALL)) {
+      break;
+    }
+
+    if (EntryCount == 0) {
+      if (Status == EFI_BUFFER_TOO_SMALL) {
+        Status = EFI_DEVICE_ERROR;
+      }
+
+      break;
+    }
+
+    if ((Size <= *BufferSize) && (EntriesSize <= *BufferSize - Size)) {
+      CopyMem ((UINT8 *)Buffer + Size, Entries, EntriesSize);
+    }
+
+    Size  += EntriesSize;
+    Count += EntryCount;
+
+    //
+    // Continue after the last name, it is copied to the start of the next request.
+    //
+    Last = Entries;
+    while (--EntryCount != 0) {
+      Last = (EDKII_VARIABLE_NAME_ENTRY *)((UINT8 *)Last + EDKII_VARIABLE_NAME_ENTRY_SIZE (Last->NameSize));
+    }
+
+    VariableName = Last->Name;
+    VendorGuid   = &Last->VendorGuid;
+  } while (Status == EFI_BUFFER_TOO_SMALL);
+
+  ReleaseLockOnlyAtBootTime (&mVariableServicesLock);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (Size > *BufferSize) {
+    *BufferSize = Size;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  *BufferSize = Size;
+  if (NameCount != NULL) {
+    *NameCount = Count;
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
   Exit Boot Services Event notification handler.
 
@@ -1281,6 +1815,11 @@ OnExitBootServices (
   // Send data to SMM.
   //
   SendCommunicateBuffer (0);
+
+  //
+  // The boot services variables are not returned at runtime.
+  //
+  mVariableNameCacheValid = FALSE;
 }
 
 /**
@@ -1309,6 +1848,7 @@ OnReadyToBoot (
   // Send data to SMM.
   //
   SendCommunicateBuffer (0);
+  mVariableNameCacheValid = FALSE;
 
   //
   // Install the system configuration table for variable info data captured
@@ -1343,6 +1883,7 @@ VariableAddressChangeEvent (
 {
   EfiConvertPointer (0x0, (VOID **)&mVariableBuffer);
   EfiConvertPointer (0x0, (VOID **)&mMmCommunication2);
+  EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **)&mVariableNameCache);
   EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **)&mVariableRtCacheInfo.CacheInfoFlagBuffer);
   EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **)&mVariableRtCacheInfo.RuntimeHobCacheBuffer);
   EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **)&mVariableRtCacheInfo.RuntimeNvCacheBuffer);
@@ -1714,6 +2255,12 @@ SmmVariableReady (
     ASSERT_EFI_ERROR (Status);
   } else {
     DEBUG ((DEBUG_INFO, "Variable driver runtime cache is disabled.\n"));
+
+    //
+    // Serve GetNextVariableName() from names fetched in bulk, one SMI returns as many
+    // names as fit in the communicate buffer.
+    //
+    mVariableNameCache = AllocateRuntimePool (mVariableBufferPayloadSize);
   }
 
   gRT->GetVariable         = RuntimeServiceGetVariable;
@@ -1762,6 +2309,17 @@ SmmVariableReady (
                                                      );
   ASSERT_EFI_ERROR (Status);
 
+  mVariableBatch.Revision         = EDKII_VARIABLE_BATCH_PROTOCOL_REVISION;
+  mVariableBatch.Execute          = VariableBatchExecute;
+  mVariableBatch.GetVariableNames = VariableBatchGetVariableNames;
+  Status                          = gBS->InstallMultipleProtocolInterfaces (
+                                           &mHandle,
+                                           &gEdkiiVariableBatchProtocolGuid,
+                                           &mVariableBatch,
+                                           NULL
+                                           );
+  ASSERT_EFI_ERROR (Status);
+
   gBS->CloseEvent (Event);
 }
 
@@ -0,0 +1,56 @@
+/** @file
+  GUID of the HOB GUID index configuration table.
+
+  The DXE Core HOB library builds this table once the HOB list has been handed
+  off and installed in memory, and publishes it in the EFI System Configuration
+  Table. The DXE HOB library then answers GetFirstGuidHob()/GetNextGuidHob()
+  for the published HOB list with a binary search instead of walking it.
+
+  The table is stored in memory of type EfiBootServicesData, like the HOB list.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __HOB_GUID_INDEX_GUID_H__
+#define __HOB_GUID_INDEX_GUID_H__
+
+#define EDKII_HOB_GUID_INDEX_GUID \
+  { \
+    0xbec3cd9e, 0x52a2, 0x4853, {0x8c, 0xd2, 0x62, 0xad, 0xd7, 0xd4, 0x97, 0xa1 } \
+  }
+
+#define EDKII_HOB_GUID_INDEX_SIGNATURE  SIGNATURE_32 ('H', 'G', 'I', 'X')
+
+///
+/// One GUID extension HOB of the indexed HOB list.
+///
+typedef struct {
+  ///
+  /// Copy of the GUID of the HOB, so the search does not touch the HOB list.
+  ///
+  EFI_GUID                Name;
+  ///
+  /// Address of the GUID extension HOB.
+  ///
+  EFI_PHYSICAL_ADDRESS    Hob;
+} EDKII_HOB_GUID_INDEX_ENTRY;
+
+///
+/// HOB GUID index. Entries are sorted by GUID, and entries with the same GUID
+/// are sorted by HOB address, which is the HOB list order.
+///
+typedef struct {
+  UINT32                        Signature;
+  UINT32                        EntryCount;
+  ///
+  /// Address range [HobListStart, HobListEnd) of the indexed HOB list.
+  ///
+  EFI_PHYSICAL_ADDRESS          HobListStart;
+  EFI_PHYSICAL_ADDRESS          HobListEnd;
+  EDKII_HOB_GUID_INDEX_ENTRY    Entry[1];
+} EDKII_HOB_GUID_INDEX;
+
+extern EFI_GUID  gEdkiiHobGuidIndexGuid;
+
+#endif
@@ -0,0 +1,83 @@
+;------------------------------------------------------------------------------
+;
+; InternalCrc32Arm() for AArch64
+;
+; SPDX-License-Identifier: BSD-2-Clause-Patent
+;
+;------------------------------------------------------------------------------
+
+  EXPORT InternalCrc32Arm
+  AREA BaseLib_LowLevel, CODE, READONLY
+
+;/**
+;  Updates a CRC32 with the bytes of a buffer using the ARMv8 CRC32
+;  instructions.
+;
+;  The buffer is processed one byte at a time until it is aligned on a 64-bit
+;  boundary, then 32 bytes per iteration, then the remaining 0..31 bytes
+;  with progressively smaller loads.
+;
+;  @param[in]  Crc     The CRC32 of the preceding data, not inverted.
+;  @param[in]  Buffer  A pointer to the data.
+;  @param[in]  Length  The number of bytes in Buffer.
+;
+;  @return The CRC32 updated with Buffer, not inverted.
+;
+;**/
+;UINT32
+;EFIAPI
+;InternalCrc32Arm (
+;  IN UINT32       Crc,
+;  IN CONST UINT8  *Buffer,
+;  IN UINTN        Length
+;  );
+;
+InternalCrc32Arm
+  cbz     x2, Crc32Done
+Crc32AlignLoop
+  tst     x1, #7
+  b.eq    Crc32Aligned
+  ldrb    w3, [x1], #1
+  crc32b  w0, w0, w3
+  subs    x2, x2, #1
+  b.ne    Crc32AlignLoop
+  ret
+
+Crc32Aligned
+  subs    x2, x2, #32
+  b.lo    Crc32Tail
+Crc32Loop
+  ldp     x3, x4, [x1], #16
+  ldp     x5, x6, [x1], #16
+  crc32x  w0, w0, x3
+  crc32x  w0, w0, x4
+  crc32x  w0, w0, x5
+  crc32x  w0, w0, x6
+  subs    x2, x2, #32
+  b.hs    Crc32Loop
+
+Crc32Tail
+  tbz     x2, #4, Crc32Tail8
+  ldp     x3, x4, [x1], #16
+  crc32x  w0, w0, x3
+  crc32x  w0, w0, x4
+Crc32Tail8
+  tbz     x2, #3, Crc32Tail4
+  ldr     x3, [x1], #8
+  crc32x  w0, w0, x3
+Crc32Tail4
+  tbz     x2, #2, Crc32Tail2
+  ldr     w3, [x1], #4
+  crc32w  w0, w0, w3
+Crc32Tail2
+  tbz     x2, #1, Crc32Tail1
+  ldrh    w3, [x1], #2
+  crc32h  w0, w0, w3
+Crc32Tail1
+  tbz     x2, #0, Crc32Done
+  ldrb    w3, [x1]
+  crc32b  w0, w0, w3
+Crc32Done
+  ret
+
+  END
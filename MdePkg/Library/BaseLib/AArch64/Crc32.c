@@ -0,0 +1,46 @@
+/** @file
+  CRC32 worker for AArch64, using the CRC32 instructions when the processor
+  implements them.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "BaseLibInternals.h"
+
+//
+// Reading ID_AA64ISAR0_EL1 is cheap, but small buffers are not worth it.
+//
+#define CRC32_ARM_MIN_LENGTH  16
+
+/**
+  Updates a CRC32 with the bytes of a buffer, using the fastest implementation
+  supported by the processor.
+
+  @param[in]  Crc     The CRC32 of the preceding data, not inverted.
+  @param[in]  Buffer  A pointer to the data.
+  @param[in]  Length  The number of bytes in Buffer.
+
+  @return The CRC32 updated with Buffer, not inverted.
+
+**/
+UINT32
+InternalCalculateCrc32 (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  )
+{
+  UINT64  Isar0;
+
+  if (Length >= CRC32_ARM_MIN_LENGTH) {
+    Isar0 = ArmReadIdAA64Isar0Reg ();
+    if ((((Isar0 >> ARM_ID_AA64ISAR0_EL1_CRC32_SHIFT) & ARM_ID_AA64ISAR0_EL1_CRC32_MASK) &
+         ARM_ID_AA64ISAR0_EL1_CRC32_HAVE_CRC32_MASK) != 0)
+    {
+      return InternalCrc32Arm (Crc, Buffer, Length);
+    }
+  }
+
+  return InternalCrc32SliceBy8 (Crc, Buffer, Length);
+}
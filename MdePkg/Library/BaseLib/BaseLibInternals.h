@@ -553,6 +553,86 @@ InternalAsciiHexCharToUintn (
   IN      CHAR8  Char
   );
 
+/**
+  Updates a CRC32 with the bytes of a buffer using the slice-by-8 algorithm.
+
+  @param[in]  Crc     The CRC32 of the preceding data, not inverted.
+  @param[in]  Buffer  A pointer to the data.
+  @param[in]  Length  The number of bytes in Buffer.
+
+  @return The CRC32 updated with Buffer, not inverted.
+
+**/
+UINT32
+InternalCrc32SliceBy8 (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  );
+
+/**
+  Updates a CRC32 with the bytes of a buffer, using the fastest implementation
+  supported by the processor.
+
+  @param[in]  Crc     The CRC32 of the preceding data, not inverted.
+  @param[in]  Buffer  A pointer to the data.
+  @param[in]  Length  The number of bytes in Buffer.
+
+  @return The CRC32 updated with Buffer, not inverted.
+
+**/
+UINT32
+InternalCalculateCrc32 (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  );
+
+#if defined (MDE_CPU_X64)
+
+/**
+  Updates a CRC32 with the bytes of a buffer by folding 64 bytes at a time
+  with the PCLMULQDQ instruction.
+
+  @param[in]  Crc     The CRC32 of the preceding data, not inverted.
+  @param[in]  Buffer  A pointer to the data.
+  @param[in]  Length  The number of bytes in Buffer. Must be a multiple of 16
+                      and at least 64.
+
+  @return The CRC32 updated with Buffer, not inverted.
+
+**/
+UINT32
+EFIAPI
+InternalCrc32Pclmulqdq (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  );
+
+#elif defined (MDE_CPU_AARCH64)
+
+/**
+  Updates a CRC32 with the bytes of a buffer using the ARMv8 CRC32
+  instructions.
+
+  @param[in]  Crc     The CRC32 of the preceding data, not inverted.
+  @param[in]  Buffer  A pointer to the data.
+  @param[in]  Length  The number of bytes in Buffer.
+
+  @return The CRC32 updated with Buffer, not inverted.
+
+**/
+UINT32
+EFIAPI
+InternalCrc32Arm (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  );
+
+#endif
+
 //
 // Ia32 and x64 specific functions
 //
@@ -0,0 +1,29 @@
+/** @file
+  CRC32 worker for processors without a dedicated implementation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "BaseLibInternals.h"
+
+/**
+  Updates a CRC32 with the bytes of a buffer, using the fastest implementation
+  supported by the processor.
+
+  @param[in]  Crc     The CRC32 of the preceding data, not inverted.
+  @param[in]  Buffer  A pointer to the data.
+  @param[in]  Length  The number of bytes in Buffer.
+
+  @return The CRC32 updated with Buffer, not inverted.
+
+**/
+UINT32
+InternalCalculateCrc32 (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  )
+{
+  return InternalCrc32SliceBy8 (Crc, Buffer, Length);
+}
@@ -0,0 +1,60 @@
+/** @file
+  CRC32 worker for x64, using PCLMULQDQ when the processor supports it.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "BaseLibInternals.h"
+
+//
+// Support for PCLMULQDQ is reported by CPUID.01H:ECX[1].
+//
+#define CRC32_CPUID_ECX_PCLMULQDQ  BIT1
+
+//
+// The result of CPUID is not cached because BaseLib may execute in place from
+// flash. CPUID traps to the hypervisor in virtual machines, where it costs
+// about as much as computing the CRC32 of 4 KB with the lookup tables, so it
+// is only executed for buffers large enough for PCLMULQDQ folding to recover
+// that cost.
+//
+#define CRC32_PCLMULQDQ_MIN_LENGTH  SIZE_8KB
+
+/**
+  Updates a CRC32 with the bytes of a buffer, using the fastest implementation
+  supported by the processor.
+
+  @param[in]  Crc     The CRC32 of the preceding data, not inverted.
+  @param[in]  Buffer  A pointer to the data.
+  @param[in]  Length  The number of bytes in Buffer.
+
+  @return The CRC32 updated with Buffer, not inverted.
+
+**/
+UINT32
+InternalCalculateCrc32 (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  )
+{
+  UINT32  RegEcx;
+  UINTN   FoldLength;
+
+  if (Length >= CRC32_PCLMULQDQ_MIN_LENGTH) {
+    AsmCpuid (1, NULL, NULL, &RegEcx, NULL);
+    if ((RegEcx & CRC32_CPUID_ECX_PCLMULQDQ) != 0) {
+      //
+      // Fold the largest multiple of 16 bytes, and leave the remaining bytes
+      // to the table driven implementation.
+      //
+      FoldLength = Length & ~(UINTN)0xF;
+      Crc        = InternalCrc32Pclmulqdq (Crc, Buffer, FoldLength);
+      Buffer    += FoldLength;
+      Length    -= FoldLength;
+    }
+  }
+
+  return InternalCrc32SliceBy8 (Crc, Buffer, Length);
+}
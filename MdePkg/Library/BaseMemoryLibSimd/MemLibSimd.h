@@ -0,0 +1,104 @@
+/** @file
+  Declaration of the implementations selected at runtime by
+  BaseMemoryLibSimd.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef MEM_LIB_SIMD_H_
+#define MEM_LIB_SIMD_H_
+
+#include "../BaseMemoryLibOptDxe/MemLibInternals.h"
+
+//
+// Bits of PcdMemoryLibSimdFeatureMask, also used to record the features
+// detected on the executing processor.
+//
+#define MEM_LIB_SIMD_ERMSB  BIT0
+
+//
+// Set once the processor features have been detected.
+//
+#define MEM_LIB_SIMD_DETECTED  BIT7
+
+//
+// When ERMSB is available, copies shorter than MEM_LIB_SIMD_NT_MIN_LENGTH bytes
+// use REP MOVSB. Longer copies use the SSE2 non-temporal stores, so that they do
+// not evict the content of the caches.
+//
+#define MEM_LIB_SIMD_NT_MIN_LENGTH  0x400000
+
+/**
+  Copy Length bytes from Source to Destination using SSE2 non-temporal stores.
+
+  @param  DestinationBuffer The target of the copy request.
+  @param  SourceBuffer      The place to copy from.
+  @param  Length            The number of bytes to copy.
+
+  @return Destination.
+
+**/
+VOID *
+EFIAPI
+InternalMemCopyMemSse2 (
+  OUT     VOID        *DestinationBuffer,
+  IN      CONST VOID  *SourceBuffer,
+  IN      UINTN       Length
+  );
+
+/**
+  Copy Length bytes from Source to Destination using enhanced REP MOVSB.
+
+  @param  DestinationBuffer The target of the copy request.
+  @param  SourceBuffer      The place to copy from.
+  @param  Length            The number of bytes to copy.
+
+  @return Destination.
+
+**/
+VOID *
+EFIAPI
+InternalMemCopyMemErms (
+  OUT     VOID        *DestinationBuffer,
+  IN      CONST VOID  *SourceBuffer,
+  IN      UINTN       Length
+  );
+
+/**
+  Set Buffer to Value for Size bytes using REP STOS.
+
+  @param  Buffer   The memory to set.
+  @param  Length   The number of bytes to set.
+  @param  Value    The value of the set operation.
+
+  @return Buffer
+
+**/
+VOID *
+EFIAPI
+InternalMemSetMemRepStos (
+  OUT     VOID   *Buffer,
+  IN      UINTN  Length,
+  IN      UINT8  Value
+  );
+
+/**
+  Set Buffer to Value for Size bytes using enhanced REP STOSB.
+
+  @param  Buffer   The memory to set.
+  @param  Length   The number of bytes to set.
+  @param  Value    The value of the set operation.
+
+  @return Buffer
+
+**/
+VOID *
+EFIAPI
+InternalMemSetMemErms (
+  OUT     VOID   *Buffer,
+  IN      UINTN  Length,
+  IN      UINT8  Value
+  );
+
+#endif
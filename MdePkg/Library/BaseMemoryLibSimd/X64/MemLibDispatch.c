@@ -0,0 +1,142 @@
+/** @file
+  Runtime selection of the CopyMem(), SetMem() and ZeroMem() implementations.
+
+  The processor features are detected on first use and cached, subject to
+  PcdMemoryLibSimdFeatureMask. ERMSB is reported by CPUID and needs no state
+  enabled by software, so the cached value is valid on every processor,
+  including APs that run code of this library.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Register/Intel/Cpuid.h>
+#include "MemLibSimd.h"
+
+//
+// Features of the executing processor, filtered by PcdMemoryLibSimdFeatureMask.
+//
+STATIC UINT8  mMemLibSimdFeatures = 0;
+
+/**
+  Get the SIMD features that may be used by this library instance.
+
+  Detecting the features more than once, for instance concurrently on several
+  processors, is harmless as every detection yields the same value.
+
+  @return A bit mask of MEM_LIB_SIMD_* values.
+
+**/
+STATIC
+UINT8
+InternalMemLibSimdFeatures (
+  VOID
+  )
+{
+  UINT8                                        Features;
+  UINT32                                       MaxLeaf;
+  CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS_EBX  ExtendedFeatureEbx;
+
+  Features = mMemLibSimdFeatures;
+  if ((Features & MEM_LIB_SIMD_DETECTED) != 0) {
+    return Features;
+  }
+
+  Features = MEM_LIB_SIMD_DETECTED;
+  AsmCpuid (CPUID_SIGNATURE, &MaxLeaf, NULL, NULL, NULL);
+  if (MaxLeaf >= CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS) {
+    AsmCpuidEx (
+      CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS,
+      CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS_SUB_LEAF_INFO,
+      NULL,
+      &ExtendedFeatureEbx.Uint32,
+      NULL,
+      NULL
+      );
+
+    if (ExtendedFeatureEbx.Bits.EnhancedRepMovsbStosb != 0) {
+      Features |= MEM_LIB_SIMD_ERMSB;
+    }
+  }
+
+  Features &= (FixedPcdGet8 (PcdMemoryLibSimdFeatureMask) | MEM_LIB_SIMD_DETECTED);
+  mMemLibSimdFeatures = Features;
+  return Features;
+}
+
+/**
+  Copy Length bytes from Source to Destination.
+
+  @param  DestinationBuffer The target of the copy request.
+  @param  SourceBuffer      The place to copy from.
+  @param  Length            The number of bytes to copy.
+
+  @return Destination.
+
+**/
+VOID *
+EFIAPI
+InternalMemCopyMem (
+  OUT     VOID        *DestinationBuffer,
+  IN      CONST VOID  *SourceBuffer,
+  IN      UINTN       Length
+  )
+{
+  UINT8  Features;
+
+  Features = InternalMemLibSimdFeatures ();
+  if (((Features & MEM_LIB_SIMD_ERMSB) != 0) &&
+      (Length < MEM_LIB_SIMD_NT_MIN_LENGTH))
+  {
+    return InternalMemCopyMemErms (DestinationBuffer, SourceBuffer, Length);
+  }
+
+  return InternalMemCopyMemSse2 (DestinationBuffer, SourceBuffer, Length);
+}
+
+/**
+  Set Buffer to Value for Size bytes.
+
+  @param  Buffer   The memory to set.
+  @param  Length   The number of bytes to set.
+  @param  Value    The value of the set operation.
+
+  @return Buffer
+
+**/
+VOID *
+EFIAPI
+InternalMemSetMem (
+  OUT     VOID   *Buffer,
+  IN      UINTN  Length,
+  IN      UINT8  Value
+  )
+{
+  UINT8  Features;
+
+  Features = InternalMemLibSimdFeatures ();
+  if ((Features & MEM_LIB_SIMD_ERMSB) != 0) {
+    return InternalMemSetMemErms (Buffer, Length, Value);
+  }
+
+  return InternalMemSetMemRepStos (Buffer, Length, Value);
+}
+
+/**
+  Fills a target buffer with zeros.
+
+  @param  Buffer   The pointer to the target buffer to zero.
+  @param  Length   The number of bytes in Buffer to fill with zeros.
+
+  @return Buffer
+
+**/
+VOID *
+EFIAPI
+InternalMemZeroMem (
+  OUT     VOID   *Buffer,
+  IN      UINTN  Length
+  )
+{
+  return InternalMemSetMem (Buffer, Length, 0);
+}
@@ -0,0 +1,200 @@
+/** @file
+  Build and search the HOB GUID index.
+
+  The HOB list is read-only after it has been handed off to DXE, so the GUID
+  extension HOBs can be sorted once by GUID and then found with a binary search
+  instead of a walk of the whole HOB list on every GetNextGuidHob() call.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/HobLib.h>
+
+#include "HobGuidIndex.h"
+
+/**
+  Compares two HOB GUID index entries, by GUID and then by HOB address.
+
+  @param  Buffer1       The first EDKII_HOB_GUID_INDEX_ENTRY.
+  @param  Buffer2       The second EDKII_HOB_GUID_INDEX_ENTRY.
+
+  @retval <0            Buffer1 sorts before Buffer2.
+  @retval 0             Buffer1 and Buffer2 are equal.
+  @retval >0            Buffer1 sorts after Buffer2.
+
+**/
+STATIC
+INTN
+EFIAPI
+HobGuidIndexCompareEntry (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  CONST EDKII_HOB_GUID_INDEX_ENTRY  *Entry1;
+  CONST EDKII_HOB_GUID_INDEX_ENTRY  *Entry2;
+  INTN                              Result;
+
+  Entry1 = (CONST EDKII_HOB_GUID_INDEX_ENTRY *)Buffer1;
+  Entry2 = (CONST EDKII_HOB_GUID_INDEX_ENTRY *)Buffer2;
+
+  Result = CompareMem (&Entry1->Name, &Entry2->Name, sizeof (EFI_GUID));
+  if (Result != 0) {
+    return Result;
+  }
+
+  if (Entry1->Hob == Entry2->Hob) {
+    return 0;
+  }
+
+  return (Entry1->Hob < Entry2->Hob) ? -1 : 1;
+}
+
+/**
+  Returns the size of the HOB GUID index for a HOB list.
+
+  @param  HobList       The HOB list to index.
+
+  @return The size in bytes of the HOB GUID index.
+
+**/
+UINTN
+HobGuidIndexGetSize (
+  IN CONST VOID  *HobList
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+  UINTN                 Count;
+
+  ASSERT (HobList != NULL);
+
+  Count = 0;
+  for (Hob.Raw = (UINT8 *)HobList; !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    if (Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) {
+      Count++;
+    }
+  }
+
+  return OFFSET_OF (EDKII_HOB_GUID_INDEX, Entry) + Count * sizeof (EDKII_HOB_GUID_INDEX_ENTRY);
+}
+
+/**
+  Builds the HOB GUID index for a HOB list.
+
+  If HobList is NULL, then ASSERT().
+  If GuidIndex is NULL, then ASSERT().
+
+  @param  HobList       The HOB list to index.
+  @param  GuidIndex     The buffer for the HOB GUID index, at least
+                        HobGuidIndexGetSize (HobList) bytes.
+
+**/
+VOID
+HobGuidIndexBuild (
+  IN  CONST VOID            *HobList,
+  OUT EDKII_HOB_GUID_INDEX  *GuidIndex
+  )
+{
+  EFI_PEI_HOB_POINTERS        Hob;
+  UINT32                      Count;
+  EDKII_HOB_GUID_INDEX_ENTRY  Swap;
+
+  ASSERT (HobList != NULL);
+  ASSERT (GuidIndex != NULL);
+
+  Count = 0;
+  for (Hob.Raw = (UINT8 *)HobList; !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    if (Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) {
+      CopyGuid (&GuidIndex->Entry[Count].Name, &Hob.Guid->Name);
+      GuidIndex->Entry[Count].Hob = (EFI_PHYSICAL_ADDRESS)(UINTN)Hob.Raw;
+      Count++;
+    }
+  }
+
+  GuidIndex->Signature    = EDKII_HOB_GUID_INDEX_SIGNATURE;
+  GuidIndex->EntryCount   = Count;
+  GuidIndex->HobListStart = (EFI_PHYSICAL_ADDRESS)(UINTN)HobList;
+  GuidIndex->HobListEnd   = (EFI_PHYSICAL_ADDRESS)(UINTN)Hob.Raw + Hob.Header->HobLength;
+
+  QuickSort (GuidIndex->Entry, Count, sizeof (EDKII_HOB_GUID_INDEX_ENTRY), HobGuidIndexCompareEntry, &Swap);
+}
+
+/**
+  Searches the HOB GUID index for the next instance of the matched GUID HOB
+  from the starting HOB.
+
+  @param  GuidIndex     The HOB GUID index.
+  @param  Guid          The GUID to match with in the HOB list.
+  @param  HobStart      A pointer to a HOB of the indexed HOB list.
+  @param  GuidHob       Returns the next instance of the matched GUID HOB from
+                        the starting HOB, or NULL if there is none.
+
+  @retval TRUE          GuidHob is the result of the search.
+  @retval FALSE         HobStart is not in the indexed HOB list, the HOB list
+                        needs to be walked instead.
+
+**/
+BOOLEAN
+HobGuidIndexFind (
+  IN  CONST EDKII_HOB_GUID_INDEX  *GuidIndex,
+  IN  CONST EFI_GUID              *Guid,
+  IN  CONST VOID                  *HobStart,
+  OUT VOID                        **GuidHob
+  )
+{
+  EDKII_HOB_GUID_INDEX_ENTRY  Key;
+  EFI_PEI_HOB_POINTERS        Hob;
+  UINTN                       Low;
+  UINTN                       High;
+  UINTN                       Middle;
+
+  if ((GuidIndex == NULL) ||
+      (GuidIndex->Signature != EDKII_HOB_GUID_INDEX_SIGNATURE) ||
+      ((EFI_PHYSICAL_ADDRESS)(UINTN)HobStart < GuidIndex->HobListStart) ||
+      ((EFI_PHYSICAL_ADDRESS)(UINTN)HobStart >= GuidIndex->HobListEnd))
+  {
+    return FALSE;
+  }
+
+  CopyGuid (&Key.Name, Guid);
+  Key.Hob = (EFI_PHYSICAL_ADDRESS)(UINTN)HobStart;
+
+  //
+  // Find the first entry that does not sort before (Guid, HobStart).
+  //
+  Low  = 0;
+  High = GuidIndex->EntryCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (HobGuidIndexCompareEntry (&GuidIndex->Entry[Middle], &Key) < 0) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  //
+  // The HOB list is read-only in DXE, but a consumer may still have retired a
+  // GUID HOB by changing its type, so check the HOB itself as well.
+  //
+  for ( ; Low < GuidIndex->EntryCount; Low++) {
+    if (!CompareGuid (&GuidIndex->Entry[Low].Name, Guid)) {
+      break;
+    }
+
+    Hob.Raw = (UINT8 *)(UINTN)GuidIndex->Entry[Low].Hob;
+    if ((Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) && CompareGuid (&Hob.Guid->Name, Guid)) {
+      *GuidHob = Hob.Raw;
+      return TRUE;
+    }
+  }
+
+  *GuidHob = NULL;
+  return TRUE;
+}
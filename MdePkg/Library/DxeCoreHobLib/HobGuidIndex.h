@@ -0,0 +1,66 @@
+/** @file
+  Internal functions to build and search the HOB GUID index.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef HOB_GUID_INDEX_H_
+#define HOB_GUID_INDEX_H_
+
+#include <Guid/HobGuidIndex.h>
+
+/**
+  Returns the size of the HOB GUID index for a HOB list.
+
+  @param  HobList       The HOB list to index.
+
+  @return The size in bytes of the HOB GUID index.
+
+**/
+UINTN
+HobGuidIndexGetSize (
+  IN CONST VOID  *HobList
+  );
+
+/**
+  Builds the HOB GUID index for a HOB list.
+
+  If HobList is NULL, then ASSERT().
+  If GuidIndex is NULL, then ASSERT().
+
+  @param  HobList       The HOB list to index.
+  @param  GuidIndex     The buffer for the HOB GUID index, at least
+                        HobGuidIndexGetSize (HobList) bytes.
+
+**/
+VOID
+HobGuidIndexBuild (
+  IN  CONST VOID            *HobList,
+  OUT EDKII_HOB_GUID_INDEX  *GuidIndex
+  );
+
+/**
+  Searches the HOB GUID index for the next instance of the matched GUID HOB
+  from the starting HOB.
+
+  @param  GuidIndex     The HOB GUID index.
+  @param  Guid          The GUID to match with in the HOB list.
+  @param  HobStart      A pointer to a HOB of the indexed HOB list.
+  @param  GuidHob       Returns the next instance of the matched GUID HOB from
+                        the starting HOB, or NULL if there is none.
+
+  @retval TRUE          GuidHob is the result of the search.
+  @retval FALSE         HobStart is not in the indexed HOB list, the HOB list
+                        needs to be walked instead.
+
+**/
+BOOLEAN
+HobGuidIndexFind (
+  IN  CONST EDKII_HOB_GUID_INDEX  *GuidIndex,
+  IN  CONST EFI_GUID              *Guid,
+  IN  CONST VOID                  *HobStart,
+  OUT VOID                        **GuidHob
+  );
+
+#endif
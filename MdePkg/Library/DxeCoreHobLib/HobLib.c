@@ -13,6 +13,10 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/BaseMemoryLib.h>
 #include <Library/DxeCoreEntryPoint.h>
 
+#include "HobGuidIndex.h"
+
+EDKII_HOB_GUID_INDEX  *mHobGuidIndex = NULL;
+
 /**
   Returns the pointer to the HOB list.
 
@@ -39,6 +43,53 @@ GetHobList (
   return gHobList;
 }
 
+/**
+  The constructor function builds the HOB GUID index of the HOB list and
+  publishes it in the EFI System Configuration Table for the DXE HOB library.
+
+  The DXE Core calls the library constructors once memory services are
+  initialized and the HOB list has been relocated to its final location.
+  The HOB list is searched linearly if the index cannot be built.
+
+  @param  ImageHandle   The firmware allocated handle for the EFI image.
+  @param  SystemTable   A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS   The constructor always returns EFI_SUCCESS.
+
+**/
+EFI_STATUS
+EFIAPI
+DxeCoreHobLibConstructor (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS            Status;
+  EDKII_HOB_GUID_INDEX  *GuidIndex;
+  VOID                  *HobList;
+
+  HobList = GetHobList ();
+  Status  = SystemTable->BootServices->AllocatePool (
+                                         EfiBootServicesData,
+                                         HobGuidIndexGetSize (HobList),
+                                         (VOID **)&GuidIndex
+                                         );
+  if (EFI_ERROR (Status)) {
+    return EFI_SUCCESS;
+  }
+
+  HobGuidIndexBuild (HobList, GuidIndex);
+
+  Status = SystemTable->BootServices->InstallConfigurationTable (&gEdkiiHobGuidIndexGuid, GuidIndex);
+  if (EFI_ERROR (Status)) {
+    SystemTable->BootServices->FreePool (GuidIndex);
+    return EFI_SUCCESS;
+  }
+
+  mHobGuidIndex = GuidIndex;
+  return EFI_SUCCESS;
+}
+
 /**
   Returns the next instance of a HOB type from the starting HOB.
 
@@ -137,6 +188,11 @@ GetNextGuidHob (
   )
 {
   EFI_PEI_HOB_POINTERS  GuidHob;
+  VOID                  *IndexedHob;
+
+  if (HobGuidIndexFind (mHobGuidIndex, Guid, HobStart, &IndexedHob)) {
+    return IndexedHob;
+  }
 
   GuidHob.Raw = (UINT8 *)HobStart;
   while ((GuidHob.Raw = GetNextHob (EFI_HOB_TYPE_GUID_EXTENSION, GuidHob.Raw)) != NULL) {
@@ -15,7 +15,10 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
 
-VOID  *mHobList = NULL;
+#include "../DxeCoreHobLib/HobGuidIndex.h"
+
+VOID                  *mHobList      = NULL;
+EDKII_HOB_GUID_INDEX  *mHobGuidIndex = NULL;
 
 /**
   Returns the pointer to the HOB list.
@@ -53,8 +56,9 @@ GetHobList (
 }
 
 /**
-  The constructor function caches the pointer to HOB list by calling GetHobList()
-  and will always return EFI_SUCCESS.
+  The constructor function caches the pointer to HOB list by calling GetHobList(),
+  and the HOB GUID index published by the DXE Core HOB library, if any.
+  It will always return EFI_SUCCESS.
 
   @param  ImageHandle   The firmware allocated handle for the EFI image.
   @param  SystemTable   A pointer to the EFI System Table.
@@ -71,6 +75,8 @@ HobLibConstructor (
 {
   GetHobList ();
 
+  EfiGetSystemConfigurationTable (&gEdkiiHobGuidIndexGuid, (VOID **)&mHobGuidIndex);
+
   return EFI_SUCCESS;
 }
 
@@ -172,6 +178,14 @@ GetNextGuidHob (
   )
 {
   EFI_PEI_HOB_POINTERS  GuidHob;
+  VOID                  *IndexedHob;
+
+  //
+  // Use the HOB GUID index published by the DXE Core HOB library, if any.
+  //
+  if (HobGuidIndexFind (mHobGuidIndex, Guid, HobStart, &IndexedHob)) {
+    return IndexedHob;
+  }
 
   GuidHob.Raw = (UINT8 *)HobStart;
   while ((GuidHob.Raw = GetNextHob (EFI_HOB_TYPE_GUID_EXTENSION, GuidHob.Raw)) != NULL) {
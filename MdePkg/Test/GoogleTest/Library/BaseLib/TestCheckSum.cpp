@@ -6,6 +6,7 @@
 **/
 
 #include <gtest/gtest.h>
+#include <vector>
 extern "C" {
   #include <Base.h>
   #include <Library/BaseLib.h>
@@ -15,6 +16,78 @@ extern "C" {
 constexpr STATIC UINT32  mHelloCrc32c = 0x9A71BB4C;
 constexpr STATIC UINT16  mHelloCrc16  = 0x34F6;
 
+// Bit at a time CRC32 (ITU-T V.42) used as the reference for the table
+// driven and processor specific implementations.
+STATIC
+UINT32
+ReferenceCrc32 (
+  CONST UINT8  *Buffer,
+  UINTN        Length
+  )
+{
+  UINT32  Crc;
+  UINTN   Bit;
+
+  Crc = 0xFFFFFFFF;
+  while (Length-- != 0) {
+    Crc ^= *(Buffer++);
+    for (Bit = 0; Bit < 8; Bit++) {
+      Crc = (Crc >> 1) ^ ((Crc & 1) != 0 ? 0xEDB88320 : 0);
+    }
+  }
+
+  return ~Crc;
+}
+
+TEST (Crc32, BasicCheck) {
+  // Note: The magic numbers below are precomputed checksums
+  EXPECT_EQ (CalculateCrc32 ((VOID *)"123456789", 9), 0xCBF43926U);
+  EXPECT_EQ (CalculateCrc32 ((VOID *)"hello", 5), 0x3610A686U);
+  EXPECT_EQ (CalculateCrc32 ((VOID *)"", 0), 0U);
+}
+
+TEST (Crc32, SizesAndAlignments) {
+  // Every length up to a few kilobytes is checked at every alignment within
+  // a 64-bit word, so that the byte, 8 byte and folding loops as well as the
+  // transitions between them are all covered.
+  std::vector<UINT8>  Data (0x10000 + 8);
+  UINTN               Index;
+  UINTN               Length;
+  UINTN               Offset;
+
+  for (Index = 0; Index < Data.size (); Index++) {
+    Data[Index] = (UINT8)((Index * 131) ^ (Index >> 7));
+  }
+
+  for (Length = 0; Length <= 2100; Length++) {
+    for (Offset = 0; Offset < 8; Offset++) {
+      ASSERT_EQ (
+        CalculateCrc32 (&Data[Offset], Length),
+        ReferenceCrc32 (&Data[Offset], Length)
+        ) << "Length " << Length << " Offset " << Offset;
+    }
+  }
+
+  // Larger buffers end with every combination of 64 byte, 16 byte and
+  // single byte remainders.
+  for (Length = 0x2000 - 64; Length <= 0x2000 + 128; Length++) {
+    for (Offset = 0; Offset < 8; Offset += 3) {
+      ASSERT_EQ (
+        CalculateCrc32 (&Data[Offset], Length),
+        ReferenceCrc32 (&Data[Offset], Length)
+        ) << "Length " << Length << " Offset " << Offset;
+    }
+  }
+
+  for (Offset = 0; Offset < 8; Offset++) {
+    Length = Data.size () - Offset;
+    ASSERT_EQ (
+      CalculateCrc32 (&Data[Offset], Length),
+      ReferenceCrc32 (&Data[Offset], Length)
+      ) << "Length " << Length << " Offset " << Offset;
+  }
+}
+
 TEST (Crc32c, BasicCheck) {
   // Note: The magic numbers below are precomputed checksums
   // Check for basic operation on even and odd numbers of bytes
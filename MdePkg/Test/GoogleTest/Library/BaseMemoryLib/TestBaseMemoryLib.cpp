@@ -0,0 +1,223 @@
+/** @file
+  Unit tests of CopyMem(), SetMem() and ZeroMem().
+
+  The results are compared with a byte by byte reference over a sweep of
+  lengths, source and destination alignments and overlaps. MdePkgHostTest.dsc
+  builds the tests once with the BaseMemoryLib of the host test platform, and
+  once on X64 with BaseMemoryLibSimd. The large lengths are on both sides of
+  the length where BaseMemoryLibSimd switches from REP MOVSB to SSE2
+  non-temporal stores.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <gtest/gtest.h>
+#include <vector>
+extern "C" {
+  #include <Uefi.h>
+  #include <Library/BaseLib.h>
+  #include <Library/BaseMemoryLib.h>
+}
+
+//
+// Alignments are tested up to the size of a cache line.
+//
+#define MEM_TEST_ALIGNMENT  64
+
+//
+// Bytes around the tested area that must not be modified.
+//
+#define MEM_TEST_GUARD  128
+
+//
+// Lengths larger than this are only tested with a few alignments, and cover
+// the switch to non-temporal stores.
+//
+#define MEM_TEST_SMALL_LENGTH  1024
+
+static const UINTN  mLargeLengths[] = {
+  4095,
+  4096,
+  4097,
+  65536 + 17,
+  0x400000 - 1,
+  0x400000,
+  0x400000 + 77
+};
+
+class BaseMemoryLibTest : public ::testing::Test {
+protected:
+  std::vector<UINT8>  Buffer;
+  std::vector<UINT8>  Expected;
+  UINT8               *Base;
+  UINT8               *ExpectedBase;
+
+  void
+  SetUp (
+    ) override
+  {
+    Buffer.resize (2 * (0x400000 + 1024 + 2 * MEM_TEST_GUARD + 2 * MEM_TEST_ALIGNMENT));
+    Expected.resize (Buffer.size ());
+    //
+    // Base is MEM_TEST_ALIGNMENT aligned, and is preceded by a guard area.
+    //
+    Base         = (UINT8 *)ALIGN_POINTER (&Buffer[MEM_TEST_GUARD], MEM_TEST_ALIGNMENT);
+    ExpectedBase = &Expected[Base - &Buffer[0]];
+  }
+
+  VOID
+  Fill (
+    UINTN  Length,
+    UINTN  Seed
+    )
+  {
+    UINTN  Index;
+
+    for (Index = 0; Index < Length; Index++) {
+      Buffer[Index] = (UINT8)(Index * 7 + Seed + (Index >> 8));
+    }
+
+    memcpy (&Expected[0], &Buffer[0], Length);
+  }
+
+  VOID
+  CheckCopy (
+    UINTN  Length,
+    UINTN  SourceOffset,
+    UINTN  DestinationOffset
+    )
+  {
+    UINTN  Index;
+    UINTN  Span;
+    VOID   *Result;
+
+    Span = MAX (SourceOffset, DestinationOffset) + Length + MEM_TEST_GUARD;
+    Fill (Span + (Base - &Buffer[0]), Length + SourceOffset);
+    for (Index = 0; Index < Length; Index++) {
+      ExpectedBase[DestinationOffset + Index] = Buffer[(Base - &Buffer[0]) + SourceOffset + Index];
+    }
+
+    Result = CopyMem (Base + DestinationOffset, Base + SourceOffset, Length);
+    ASSERT_EQ (Result, Base + DestinationOffset);
+    ASSERT_EQ (memcmp (&Buffer[0], &Expected[0], Span + (Base - &Buffer[0])), 0)
+      << "Length " << Length << " Source " << SourceOffset << " Destination " << DestinationOffset;
+  }
+
+  VOID
+  CheckSet (
+    UINTN  Length,
+    UINTN  Offset,
+    UINT8  Value
+    )
+  {
+    UINTN  Span;
+    VOID   *Result;
+
+    Span = Offset + Length + MEM_TEST_GUARD;
+    Fill (Span + (Base - &Buffer[0]), Length);
+    memset (ExpectedBase + Offset, Value, Length);
+
+    if (Value == 0) {
+      Result = ZeroMem (Base + Offset, Length);
+    } else {
+      Result = SetMem (Base + Offset, Length, Value);
+    }
+
+    ASSERT_EQ (Result, Base + Offset);
+    ASSERT_EQ (memcmp (&Buffer[0], &Expected[0], Span + (Base - &Buffer[0])), 0)
+      << "Length " << Length << " Offset " << Offset << " Value " << (UINTN)Value;
+  }
+};
+
+TEST_F (BaseMemoryLibTest, CopyMemSmallLengths) {
+  UINTN  Length;
+  UINTN  SourceAlignment;
+  UINTN  DestinationAlignment;
+
+  for (Length = 0; Length <= MEM_TEST_SMALL_LENGTH; Length += (Length < 300) ? 1 : 61) {
+    for (SourceAlignment = 0; SourceAlignment < MEM_TEST_ALIGNMENT; SourceAlignment += 3) {
+      for (DestinationAlignment = 0; DestinationAlignment < MEM_TEST_ALIGNMENT; DestinationAlignment += 5) {
+        //
+        // Keep the buffers apart so that they do not overlap.
+        //
+        CheckCopy (Length, SourceAlignment, 2 * MEM_TEST_SMALL_LENGTH + DestinationAlignment);
+        if (HasFatalFailure ()) {
+          return;
+        }
+      }
+    }
+  }
+}
+
+TEST_F (BaseMemoryLibTest, CopyMemLargeLengths) {
+  UINTN  Index;
+  UINTN  Length;
+
+  for (Index = 0; Index < ARRAY_SIZE (mLargeLengths); Index++) {
+    Length = mLargeLengths[Index];
+    CheckCopy (Length, 0, Length + MEM_TEST_ALIGNMENT);
+    CheckCopy (Length, 1, Length + MEM_TEST_ALIGNMENT + 33);
+    CheckCopy (Length + 1, Length + MEM_TEST_ALIGNMENT + 17, 0);
+    if (HasFatalFailure ()) {
+      return;
+    }
+  }
+}
+
+TEST_F (BaseMemoryLibTest, CopyMemOverlap) {
+  static const UINTN  Distances[] = { 1, 7, 8, 9, 16, 17, 31, 32, 33, 64, 65, 200 };
+  static const UINTN  Lengths[]   = { 1, 15, 16, 33, 64, 100, 128, 129, 255, 256, 257, 1000, 4096, 65536 + 17 };
+  UINTN               DistanceIndex;
+  UINTN               LengthIndex;
+  UINTN               Alignment;
+
+  for (LengthIndex = 0; LengthIndex < ARRAY_SIZE (Lengths); LengthIndex++) {
+    for (DistanceIndex = 0; DistanceIndex < ARRAY_SIZE (Distances); DistanceIndex++) {
+      for (Alignment = 0; Alignment < MEM_TEST_ALIGNMENT; Alignment += 7) {
+        //
+        // Destination above the source is copied backward, destination below
+        // the source is copied forward.
+        //
+        CheckCopy (Lengths[LengthIndex], Alignment, Alignment + Distances[DistanceIndex]);
+        CheckCopy (Lengths[LengthIndex], Alignment + Distances[DistanceIndex], Alignment);
+        if (HasFatalFailure ()) {
+          return;
+        }
+      }
+    }
+  }
+}
+
+TEST_F (BaseMemoryLibTest, SetMemAndZeroMem) {
+  UINTN  Length;
+  UINTN  Alignment;
+  UINTN  Index;
+
+  for (Length = 0; Length <= MEM_TEST_SMALL_LENGTH; Length += (Length < 300) ? 1 : 61) {
+    for (Alignment = 0; Alignment < MEM_TEST_ALIGNMENT; Alignment += 3) {
+      CheckSet (Length, Alignment, 0xA5);
+      CheckSet (Length, Alignment, 0);
+      if (HasFatalFailure ()) {
+        return;
+      }
+    }
+  }
+
+  for (Index = 0; Index < ARRAY_SIZE (mLargeLengths); Index++) {
+    CheckSet (mLargeLengths[Index], 0, 0x5A);
+    CheckSet (mLargeLengths[Index], 13, 0);
+    if (HasFatalFailure ()) {
+      return;
+    }
+  }
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  testing::InitGoogleTest (&argc, argv);
+  return RUN_ALL_TESTS ();
+}
@@ -0,0 +1,194 @@
+/** @file
+  Unit tests of the HOB GUID index used by DxeCoreHobLib and DxeHobLib.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <gtest/gtest.h>
+#include <vector>
+extern "C" {
+  #include <PiDxe.h>
+  #include <Library/BaseLib.h>
+  #include <Library/BaseMemoryLib.h>
+  #include <Library/HobLib.h>
+  #include "../../../../Library/DxeCoreHobLib/HobGuidIndex.h"
+}
+
+//
+// Number of distinct GUIDs in the synthetic HOB list, and number of HOBs
+// produced for each of them. This is in the range of what FSP based
+// platforms hand off to DXE.
+//
+#define HOB_TEST_GUID_COUNT      200
+#define HOB_TEST_INSTANCE_COUNT  3
+#define HOB_TEST_DATA_SIZE       32
+
+class HobGuidIndexTest : public ::testing::Test {
+protected:
+  std::vector<UINT64>      HobBuffer;
+  VOID                     *HobList;
+  std::vector<UINT8>       IndexBuffer;
+  EDKII_HOB_GUID_INDEX     *GuidIndex;
+  std::vector<EFI_GUID>    Guids;
+
+  VOID
+  AppendHob (
+    UINT8  **Cursor,
+    UINT16 HobType,
+    UINT16 HobLength
+    )
+  {
+    EFI_HOB_GENERIC_HEADER  *Header;
+
+    Header            = (EFI_HOB_GENERIC_HEADER *)*Cursor;
+    Header->HobType   = HobType;
+    Header->HobLength = HobLength;
+    Header->Reserved  = 0;
+    *Cursor          += HobLength;
+  }
+
+  void
+  SetUp (
+    ) override
+  {
+    UINT8              *Cursor;
+    EFI_HOB_GUID_TYPE  *GuidHob;
+    UINTN              Instance;
+    UINTN              Index;
+
+    for (Index = 0; Index < HOB_TEST_GUID_COUNT; Index++) {
+      EFI_GUID  Guid = {
+        (UINT32)(0x9E3779B1 * (Index + 1)), (UINT16)Index, 0x4A5B, { 0x8C, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, (UINT8)Index }
+      };
+      Guids.push_back (Guid);
+    }
+
+    HobBuffer.resize (
+                (sizeof (EFI_HOB_HANDOFF_INFO_TABLE) +
+                 HOB_TEST_GUID_COUNT * HOB_TEST_INSTANCE_COUNT * (sizeof (EFI_HOB_GUID_TYPE) + HOB_TEST_DATA_SIZE + sizeof (EFI_HOB_RESOURCE_DESCRIPTOR)) +
+                 sizeof (EFI_HOB_GENERIC_HEADER)) / sizeof (UINT64) + 1
+                );
+    HobList = HobBuffer.data ();
+    Cursor  = (UINT8 *)HobList;
+
+    AppendHob (&Cursor, EFI_HOB_TYPE_HANDOFF, sizeof (EFI_HOB_HANDOFF_INFO_TABLE));
+    //
+    // Interleave GUID HOBs with other HOB types, and produce each GUID several
+    // times across the list.
+    //
+    for (Instance = 0; Instance < HOB_TEST_INSTANCE_COUNT; Instance++) {
+      for (Index = 0; Index < HOB_TEST_GUID_COUNT; Index++) {
+        GuidHob = (EFI_HOB_GUID_TYPE *)Cursor;
+        AppendHob (&Cursor, EFI_HOB_TYPE_GUID_EXTENSION, sizeof (EFI_HOB_GUID_TYPE) + HOB_TEST_DATA_SIZE);
+        CopyGuid (&GuidHob->Name, &Guids[Index]);
+        AppendHob (&Cursor, EFI_HOB_TYPE_RESOURCE_DESCRIPTOR, sizeof (EFI_HOB_RESOURCE_DESCRIPTOR));
+      }
+    }
+
+    AppendHob (&Cursor, EFI_HOB_TYPE_END_OF_HOB_LIST, sizeof (EFI_HOB_GENERIC_HEADER));
+
+    IndexBuffer.resize (HobGuidIndexGetSize (HobList));
+    GuidIndex = (EDKII_HOB_GUID_INDEX *)IndexBuffer.data ();
+    HobGuidIndexBuild (HobList, GuidIndex);
+  }
+
+  //
+  // Reference implementation: the linear walk of HobLib.
+  //
+  VOID *
+  LinearFind (
+    CONST EFI_GUID  *Guid,
+    CONST VOID      *HobStart
+    )
+  {
+    EFI_PEI_HOB_POINTERS  Hob;
+
+    for (Hob.Raw = (UINT8 *)HobStart; !END_OF_HOB_LIST (Hob); Hob.Raw = (UINT8 *)GET_NEXT_HOB (Hob)) {
+      if ((Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) && CompareGuid (Guid, &Hob.Guid->Name)) {
+        return Hob.Raw;
+      }
+    }
+
+    return NULL;
+  }
+
+  VOID *
+  IndexedFind (
+    CONST EFI_GUID  *Guid,
+    CONST VOID      *HobStart
+    )
+  {
+    VOID  *GuidHob;
+
+    EXPECT_TRUE (HobGuidIndexFind (GuidIndex, Guid, HobStart, &GuidHob));
+    return GuidHob;
+  }
+};
+
+TEST_F (HobGuidIndexTest, CountsAllGuidHobs) {
+  EXPECT_EQ (GuidIndex->Signature, EDKII_HOB_GUID_INDEX_SIGNATURE);
+  EXPECT_EQ (GuidIndex->EntryCount, (UINT32)(HOB_TEST_GUID_COUNT * HOB_TEST_INSTANCE_COUNT));
+}
+
+TEST_F (HobGuidIndexTest, MatchesLinearWalkForAllInstances) {
+  EFI_PEI_HOB_POINTERS  Hob;
+  UINTN                 Index;
+  UINTN                 Instances;
+
+  for (Index = 0; Index < HOB_TEST_GUID_COUNT; Index++) {
+    Instances = 0;
+    Hob.Raw   = (UINT8 *)IndexedFind (&Guids[Index], HobList);
+    while (Hob.Raw != NULL) {
+      Instances++;
+      Hob.Raw = (UINT8 *)IndexedFind (&Guids[Index], GET_NEXT_HOB (Hob));
+    }
+
+    EXPECT_EQ (Instances, (UINTN)HOB_TEST_INSTANCE_COUNT);
+  }
+
+  //
+  // Every HOB of the list as a start point, for a few GUIDs.
+  //
+  for (Hob.Raw = (UINT8 *)HobList; !END_OF_HOB_LIST (Hob); Hob.Raw = (UINT8 *)GET_NEXT_HOB (Hob)) {
+    for (Index = 0; Index < HOB_TEST_GUID_COUNT; Index += HOB_TEST_GUID_COUNT / 8) {
+      EXPECT_EQ (IndexedFind (&Guids[Index], Hob.Raw), LinearFind (&Guids[Index], Hob.Raw));
+    }
+  }
+}
+
+TEST_F (HobGuidIndexTest, MissingGuid) {
+  EFI_GUID  Missing = {
+    0x01234567, 0x89AB, 0xCDEF, { 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF }
+  };
+
+  EXPECT_EQ (IndexedFind (&Missing, HobList), nullptr);
+}
+
+TEST_F (HobGuidIndexTest, RetiredHobIsSkipped) {
+  EFI_HOB_GUID_TYPE  *GuidHob;
+
+  GuidHob                  = (EFI_HOB_GUID_TYPE *)IndexedFind (&Guids[7], HobList);
+  GuidHob->Header.HobType  = EFI_HOB_TYPE_UNUSED;
+  EXPECT_EQ (IndexedFind (&Guids[7], HobList), LinearFind (&Guids[7], HobList));
+  EXPECT_NE (IndexedFind (&Guids[7], HobList), (VOID *)GuidHob);
+}
+
+TEST_F (HobGuidIndexTest, HobStartOutsideListFallsBack) {
+  EFI_HOB_GENERIC_HEADER  OtherList;
+  VOID                    *GuidHob;
+
+  OtherList.HobType   = EFI_HOB_TYPE_END_OF_HOB_LIST;
+  OtherList.HobLength = sizeof (OtherList);
+  EXPECT_FALSE (HobGuidIndexFind (GuidIndex, &Guids[0], &OtherList, &GuidHob));
+  EXPECT_FALSE (HobGuidIndexFind (NULL, &Guids[0], HobList, &GuidHob));
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  testing::InitGoogleTest (&argc, argv);
+  return RUN_ALL_TESTS ();
+}
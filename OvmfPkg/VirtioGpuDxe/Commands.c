@@ -333,9 +333,9 @@ VirtioGpuUnmapAndFreeBackingStore (
 }
 
 /**
-  EFI_EVENT_NOTIFY function for the VGPU_DEV.ExitBoot event. It resets the
-  VirtIo device, causing it to release its resources and to forget its
-  configuration.
+  EFI_EVENT_NOTIFY function for the VGPU_DEV.ExitBoot event. It submits the
+  rectangles of the GOP that are still dirty, then resets the VirtIo device,
+  causing it to release its resources and to forget its configuration.
 
   This function may only be called (that is, VGPU_DEV.ExitBoot may only be
   signaled) after VirtioGpuInit() returns and before VirtioGpuUninit() is
@@ -356,6 +356,16 @@ VirtioGpuExitBoot (
 
   DEBUG ((DEBUG_VERBOSE, "%a: Context=0x%p\n", __func__, Context));
   VgpuDev = Context;
+
+  //
+  // The timer interrupt is disabled before ExitBootServices() notifications
+  // run, so VGPU_GOP.FlushTimer will not submit the last updates of the boot
+  // loader any longer.
+  //
+  if ((VgpuDev->Child != NULL) && (VgpuDev->Child->DirtyRectCount > 0)) {
+    VirtioGpuFlushDirtyRects (NULL, VgpuDev->Child);
+  }
+
   VgpuDev->VirtIo->SetDeviceStatus (VgpuDev->VirtIo, 0);
 }
 
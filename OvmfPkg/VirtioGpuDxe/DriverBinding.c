@@ -433,6 +433,30 @@ InitVgpuGop (
     goto CloseVirtIoByChild;
   }
 
+  //
+  // Blt() only updates the backing store, this timer submits the updated
+  // rectangles to the host.
+  //
+  Status = gBS->CreateEvent (
+                  EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  TPL_NOTIFY,
+                  VirtioGpuFlushDirtyRects,
+                  VgpuGop,
+                  &VgpuGop->FlushTimer
+                  );
+  if (EFI_ERROR (Status)) {
+    goto UninitGop;
+  }
+
+  Status = gBS->SetTimer (
+                  VgpuGop->FlushTimer,
+                  TimerPeriodic,
+                  VGPU_GOP_FLUSH_PERIOD
+                  );
+  if (EFI_ERROR (Status)) {
+    goto CloseFlushTimer;
+  }
+
   //
   // Install the Graphics Output Protocol on the child handle.
   //
@@ -443,7 +467,7 @@ InitVgpuGop (
                   &VgpuGop->Gop
                   );
   if (EFI_ERROR (Status)) {
-    goto UninitGop;
+    goto CloseFlushTimer;
   }
 
   //
@@ -453,6 +477,9 @@ InitVgpuGop (
   ParentBus->Child = VgpuGop;
   return EFI_SUCCESS;
 
+CloseFlushTimer:
+  gBS->CloseEvent (VgpuGop->FlushTimer);
+
 UninitGop:
   ReleaseGopResources (VgpuGop, TRUE /* DisableHead */);
 
@@ -523,6 +550,12 @@ UninitVgpuGop (
                    );
   ASSERT_EFI_ERROR (Status);
 
+  //
+  // Stop submitting dirty rectangles; the head is disabled below anyway.
+  //
+  Status = gBS->CloseEvent (VgpuGop->FlushTimer);
+  ASSERT_EFI_ERROR (Status);
+
   //
   // Uninitialize VgpuGop->Gop.
   //
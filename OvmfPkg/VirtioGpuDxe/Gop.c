@@ -10,6 +10,7 @@
 
 #include <Library/MemoryAllocationLib.h>
 #include <Library/PcdLib.h>
+#include <Library/UefiBootServicesTableLib.h>
 
 #include "VirtioGpu.h"
 
@@ -344,8 +345,7 @@ GopQueryMode (
 
 STATIC
 EFI_STATUS
-EFIAPI
-GopSetMode (
+GopSetModeWorker (
   IN  EFI_GRAPHICS_OUTPUT_PROTOCOL  *This,
   IN  UINT32                        ModeNumber
   )
@@ -547,6 +547,176 @@ DestroyHostResource:
   return Status;
 }
 
+STATIC
+EFI_STATUS
+EFIAPI
+GopSetMode (
+  IN  EFI_GRAPHICS_OUTPUT_PROTOCOL  *This,
+  IN  UINT32                        ModeNumber
+  )
+{
+  VGPU_GOP    *VgpuGop;
+  EFI_TPL     OldTpl;
+  EFI_STATUS  Status;
+
+  //
+  // Keep VgpuGop->FlushTimer from submitting commands in the middle of the
+  // mode change.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  Status = GopSetModeWorker (This, ModeNumber);
+  if (!EFI_ERROR (Status)) {
+    //
+    // The new backing store has been transferred and flushed as a whole, the
+    // dirty rectangles belonged to the previous mode.
+    //
+    VgpuGop                 = VGPU_GOP_FROM_GOP (This);
+    VgpuGop->DirtyRectCount = 0;
+  }
+
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+/**
+  Merge a rectangle into another one, so that it covers both.
+
+  @param[in,out] Rect  The rectangle to grow.
+
+  @param[in] Other     The rectangle to cover.
+**/
+STATIC
+VOID
+UnionRect (
+  IN OUT VGPU_GOP_RECT        *Rect,
+  IN     CONST VGPU_GOP_RECT  *Other
+  )
+{
+  UINT32  Right;
+  UINT32  Bottom;
+
+  Right   = MAX (Rect->X + Rect->Width, Other->X + Other->Width);
+  Bottom  = MAX (Rect->Y + Rect->Height, Other->Y + Other->Height);
+  Rect->X = MIN (Rect->X, Other->X);
+  Rect->Y = MIN (Rect->Y, Other->Y);
+
+  Rect->Width  = Right - Rect->X;
+  Rect->Height = Bottom - Rect->Y;
+}
+
+/**
+  Record a rectangle of the backing store written by Gop.Blt(), for submission
+  by VirtioGpuFlushDirtyRects().
+
+  A rectangle that overlaps or touches a tracked one is merged into it. When
+  all the tracked rectangles are in use and apart from the new one, the new
+  one is merged into the tracked rectangle that grows the least.
+
+  @param[in,out] VgpuGop  The VGPU_GOP object whose backing store was written.
+
+  @param[in] Rect         The written rectangle.
+**/
+STATIC
+VOID
+AddDirtyRect (
+  IN OUT VGPU_GOP             *VgpuGop,
+  IN     CONST VGPU_GOP_RECT  *Rect
+  )
+{
+  VGPU_GOP_RECT  *Dirty;
+  VGPU_GOP_RECT  Union;
+  UINTN          Index;
+  UINTN          Best;
+  UINT64         Growth;
+  UINT64         BestGrowth;
+
+  for (Index = 0; Index < VgpuGop->DirtyRectCount; Index++) {
+    Dirty = &VgpuGop->DirtyRects[Index];
+    if ((Rect->X <= Dirty->X + Dirty->Width) &&
+        (Dirty->X <= Rect->X + Rect->Width) &&
+        (Rect->Y <= Dirty->Y + Dirty->Height) &&
+        (Dirty->Y <= Rect->Y + Rect->Height))
+    {
+      UnionRect (Dirty, Rect);
+      return;
+    }
+  }
+
+  if (VgpuGop->DirtyRectCount < VGPU_GOP_DIRTY_RECTS) {
+    CopyMem (&VgpuGop->DirtyRects[VgpuGop->DirtyRectCount++], Rect, sizeof *Rect);
+    return;
+  }
+
+  Best       = 0;
+  BestGrowth = MAX_UINT64;
+  for (Index = 0; Index < VGPU_GOP_DIRTY_RECTS; Index++) {
+    Dirty = &VgpuGop->DirtyRects[Index];
+    CopyMem (&Union, Dirty, sizeof Union);
+    UnionRect (&Union, Rect);
+    Growth = MultU64x32 (Union.Width, Union.Height) -
+             MultU64x32 (Dirty->Width, Dirty->Height);
+    if (Growth < BestGrowth) {
+      Best       = Index;
+      BestGrowth = Growth;
+    }
+  }
+
+  UnionRect (&VgpuGop->DirtyRects[Best], Rect);
+}
+
+VOID
+EFIAPI
+VirtioGpuFlushDirtyRects (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  VGPU_GOP       *VgpuGop;
+  VGPU_GOP_RECT  *Dirty;
+  UINTN          Index;
+  UINT64         ResourceOffset;
+  EFI_STATUS     Status;
+
+  VgpuGop = Context;
+
+  for (Index = 0; Index < VgpuGop->DirtyRectCount; Index++) {
+    Dirty = &VgpuGop->DirtyRects[Index];
+
+    //
+    // Update the host resource from guest memory.
+    //
+    ResourceOffset = sizeof (UINT32) * ((UINT64)Dirty->Y * VgpuGop->GopModeInfo.HorizontalResolution + Dirty->X);
+    Status         = VirtioGpuTransferToHost2d (
+                       VgpuGop->ParentBus,  // VgpuDev
+                       Dirty->X,            // X
+                       Dirty->Y,            // Y
+                       Dirty->Width,        // Width
+                       Dirty->Height,       // Height
+                       ResourceOffset,      // Offset
+                       VgpuGop->ResourceId  // ResourceId
+                       );
+    if (!EFI_ERROR (Status)) {
+      //
+      // Flush the updated resource to the display.
+      //
+      Status = VirtioGpuResourceFlush (
+                 VgpuGop->ParentBus,  // VgpuDev
+                 Dirty->X,            // X
+                 Dirty->Y,            // Y
+                 Dirty->Width,        // Width
+                 Dirty->Height,       // Height
+                 VgpuGop->ResourceId  // ResourceId
+                 );
+    }
+
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a: %r\n", __func__, Status));
+    }
+  }
+
+  VgpuGop->DirtyRectCount = 0;
+}
+
 STATIC
 EFI_STATUS
 EFIAPI
@@ -563,13 +733,13 @@ GopBlt (
   IN  UINTN                              Delta         OPTIONAL
   )
 {
-  VGPU_GOP    *VgpuGop;
-  UINT32      CurrentHorizontal;
-  UINT32      CurrentVertical;
-  UINTN       SegmentSize;
-  UINTN       Y;
-  UINTN       ResourceOffset;
-  EFI_STATUS  Status;
+  VGPU_GOP       *VgpuGop;
+  UINT32         CurrentHorizontal;
+  UINT32         CurrentVertical;
+  UINTN          SegmentSize;
+  UINTN          Y;
+  VGPU_GOP_RECT  Rect;
+  EFI_TPL        OldTpl;
 
   VgpuGop           = VGPU_GOP_FROM_GOP (This);
   CurrentHorizontal = VgpuGop->GopModeInfo.HorizontalResolution;
@@ -672,6 +842,15 @@ GopBlt (
           );
       }
 
+      //
+      // Make sure that the display shows what the caller has read back.
+      //
+      OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+      if (VgpuGop->DirtyRectCount > 0) {
+        VirtioGpuFlushDirtyRects (NULL, VgpuGop);
+      }
+
+      gBS->RestoreTPL (OldTpl);
       return EFI_SUCCESS;
 
     case EfiBltBufferToVideo:
@@ -736,36 +915,24 @@ GopBlt (
   }
 
   //
-  // For operations that wrote to the display, submit the updated area to the
-  // host -- update the host resource from guest memory.
+  // For operations that wrote to the display, remember the updated area.
+  // VgpuGop->FlushTimer submits it to the host shortly, together with the
+  // areas updated by subsequent calls.
   //
-  ResourceOffset = sizeof (UINT32) * (DestinationY * CurrentHorizontal +
-                                      DestinationX);
-  Status = VirtioGpuTransferToHost2d (
-             VgpuGop->ParentBus,   // VgpuDev
-             (UINT32)DestinationX, // X
-             (UINT32)DestinationY, // Y
-             (UINT32)Width,        // Width
-             (UINT32)Height,       // Height
-             ResourceOffset,       // Offset
-             VgpuGop->ResourceId   // ResourceId
-             );
-  if (EFI_ERROR (Status)) {
-    return Status;
+  if ((Width == 0) || (Height == 0)) {
+    return EFI_SUCCESS;
   }
 
-  //
-  // Flush the updated resource to the display.
-  //
-  Status = VirtioGpuResourceFlush (
-             VgpuGop->ParentBus,   // VgpuDev
-             (UINT32)DestinationX, // X
-             (UINT32)DestinationY, // Y
-             (UINT32)Width,        // Width
-             (UINT32)Height,       // Height
-             VgpuGop->ResourceId   // ResourceId
-             );
-  return Status;
+  Rect.X      = (UINT32)DestinationX;
+  Rect.Y      = (UINT32)DestinationY;
+  Rect.Width  = (UINT32)Width;
+  Rect.Height = (UINT32)Height;
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  AddDirtyRect (VgpuGop, &Rect);
+  gBS->RestoreTPL (OldTpl);
+
+  return EFI_SUCCESS;
 }
 
 //
@@ -80,6 +80,28 @@ typedef struct {
   VGPU_GOP    *Child;
 } VGPU_DEV;
 
+//
+// A rectangle of the backing store that has been written by Gop.Blt(), but
+// not yet transferred to the host resource and flushed to the display.
+//
+typedef struct {
+  UINT32    X;
+  UINT32    Y;
+  UINT32    Width;
+  UINT32    Height;
+} VGPU_GOP_RECT;
+
+//
+// Number of separate dirty rectangles tracked per head. Further rectangles
+// are merged into the tracked ones.
+//
+#define VGPU_GOP_DIRTY_RECTS  4
+
+//
+// Interval of the dirty rectangle submission, in 100ns units.
+//
+#define VGPU_GOP_FLUSH_PERIOD  EFI_TIMER_PERIOD_MILLISECONDS (15)
+
 //
 // The Graphics Output Protocol wrapper structure.
 //
@@ -157,6 +179,20 @@ struct VGPU_GOP_STRUCT {
   //
   UINT32                                  NativeXRes;
   UINT32                                  NativeYRes;
+
+  //
+  // Rectangles of BackingStore updated by Gop.Blt() since the last submission
+  // to the host. They are submitted by FlushTimer, so that a burst of small
+  // Blt() calls results in a few transfer and flush commands. Accessed at
+  // TPL_NOTIFY.
+  //
+  VGPU_GOP_RECT                           DirtyRects[VGPU_GOP_DIRTY_RECTS];
+  UINTN                                   DirtyRectCount;
+
+  //
+  // Periodic timer event that calls VirtioGpuFlushDirtyRects().
+  //
+  EFI_EVENT                               FlushTimer;
 };
 
 //
@@ -407,6 +443,24 @@ ReleaseGopResources (
   IN     BOOLEAN   DisableHead
   );
 
+/**
+  Transfer the dirty rectangles of the backing store to the host resource, and
+  flush them to the display.
+
+  This is the EFI_EVENT_NOTIFY function of VGPU_GOP.FlushTimer, it runs at
+  TPL_NOTIFY.
+
+  @param[in] Event    Event whose notification function is being invoked.
+
+  @param[in] Context  Pointer to the VGPU_GOP object.
+**/
+VOID
+EFIAPI
+VirtioGpuFlushDirtyRects (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  );
+
 //
 // Template for initializing VGPU_GOP.Gop.
 //
@@ -68,6 +68,28 @@ HashCompleteAndExtend (
   OUT TPML_DIGEST_VALUES  *DigestList
   );
 
+/**
+  Hash sequence complete, without extending a PCR.
+
+  The digests returned are the ones HashCompleteAndExtend() would extend. The caller
+  extends them later with Tpm2PcrExtend().
+
+  @param HashHandle    Hash handle.
+  @param DataToHash    Data to be hashed.
+  @param DataToHashLen Data size.
+  @param DigestList    Digest list.
+
+  @retval EFI_SUCCESS     Hash sequence complete and DigestList is returned.
+**/
+EFI_STATUS
+EFIAPI
+HashComplete (
+  IN HASH_HANDLE          HashHandle,
+  IN VOID                 *DataToHash,
+  IN UINTN                DataToHashLen,
+  OUT TPML_DIGEST_VALUES  *DigestList
+  );
+
 /**
   Hash data and extend to PCR.
 
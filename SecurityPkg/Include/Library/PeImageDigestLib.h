@@ -0,0 +1,141 @@
+/** @file
+  Provides the Authenticode digests of a PE/COFF image, as defined in PE/COFF
+  Specification 8.0 Appendix A, for several hash algorithms in one walk of the image.
+
+  The image verification and the TPM measurement of an image both hash it with the
+  Authenticode algorithm, the first with the algorithm of its signature, the second
+  with the algorithm of each active PCR bank. The digests of the image being
+  authenticated are cached, so that the image is walked once for all of them.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef PE_IMAGE_DIGEST_LIB_H_
+#define PE_IMAGE_DIGEST_LIB_H_
+
+#include <IndustryStandard/Tpm20.h>
+#include <Protocol/Tcg2Protocol.h>
+
+///
+/// Hash algorithms supported, as a mask of EFI_TCG2_BOOT_HASH_ALG_*.
+///
+#define PE_IMAGE_DIGEST_HASH_ALG_ALL  (EFI_TCG2_BOOT_HASH_ALG_SHA1   |  \
+                                       EFI_TCG2_BOOT_HASH_ALG_SHA256 |  \
+                                       EFI_TCG2_BOOT_HASH_ALG_SHA384 |  \
+                                       EFI_TCG2_BOOT_HASH_ALG_SHA512 |  \
+                                       EFI_TCG2_BOOT_HASH_ALG_SM3_256)
+
+///
+/// Consumers of the cached digests, see PeImageDigestBeginImage().
+///
+#define PE_IMAGE_DIGEST_CONSUMER_IMAGE_VERIFICATION  BIT0
+#define PE_IMAGE_DIGEST_CONSUMER_TPM2_MEASURE_BOOT   BIT1
+
+/**
+  Calculate the Authenticode digests of a PE/COFF image, for all the hash algorithms
+  requested, in one walk of the image. Nothing is cached.
+
+  Caution: This function may receive untrusted input.
+  PE/COFF image is external input, so this function will validate its data structure
+  within this image buffer before use.
+
+  @param[in]  ImageBase          Start address of the image.
+  @param[in]  ImageSize          Size of the image in bytes.
+  @param[in]  HashAlgorithmMask  Hash algorithms, as a mask of EFI_TCG2_BOOT_HASH_ALG_*.
+  @param[out] DigestList         The digests, one per algorithm requested.
+
+  @retval EFI_SUCCESS            The digests have been calculated.
+  @retval EFI_INVALID_PARAMETER  ImageBase or DigestList is NULL.
+  @retval EFI_UNSUPPORTED        HashAlgorithmMask is zero, or requests an algorithm that
+                                 is not supported.
+  @retval EFI_UNSUPPORTED        The image is not a valid PE/COFF image.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to hash the image.
+**/
+EFI_STATUS
+EFIAPI
+PeImageDigestCalculate (
+  IN  CONST VOID          *ImageBase,
+  IN  UINTN               ImageSize,
+  IN  UINT32              HashAlgorithmMask,
+  OUT TPML_DIGEST_VALUES  *DigestList
+  );
+
+/**
+  Get the Authenticode digests of the image being authenticated.
+
+  The digests already calculated for the image are returned from the cache. The
+  missing ones are calculated in one walk of the image, together with the digests
+  of the algorithms added with PeImageDigestAddAlgorithms(), which the next
+  consumers of the image will request.
+
+  Caution: This function may receive untrusted input.
+  PE/COFF image is external input, so this function will validate its data structure
+  within this image buffer before use.
+
+  @param[in]  ImageBase          Start address of the image.
+  @param[in]  ImageSize          Size of the image in bytes.
+  @param[in]  HashAlgorithmMask  Hash algorithms, as a mask of EFI_TCG2_BOOT_HASH_ALG_*.
+  @param[out] DigestList         The digests, one per algorithm requested.
+
+  @retval EFI_SUCCESS            The digests have been returned.
+  @retval EFI_INVALID_PARAMETER  ImageBase or DigestList is NULL.
+  @retval EFI_UNSUPPORTED        HashAlgorithmMask is zero, or requests an algorithm that
+                                 is not supported.
+  @retval EFI_UNSUPPORTED        The image is not a valid PE/COFF image.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to hash the image.
+**/
+EFI_STATUS
+EFIAPI
+PeImageDigestGet (
+  IN  CONST VOID          *ImageBase,
+  IN  UINTN               ImageSize,
+  IN  UINT32              HashAlgorithmMask,
+  OUT TPML_DIGEST_VALUES  *DigestList
+  );
+
+/**
+  Add hash algorithms to calculate whenever an image is walked, because a consumer
+  will request them. The algorithms that are not supported are ignored.
+
+  @param[in]  HashAlgorithmMask  Hash algorithms, as a mask of EFI_TCG2_BOOT_HASH_ALG_*.
+**/
+VOID
+EFIAPI
+PeImageDigestAddAlgorithms (
+  IN UINT32  HashAlgorithmMask
+  );
+
+/**
+  Tell that a consumer starts the authentication of an image.
+
+  The digests are cached for the address and size of an image, and a new image may
+  be loaded at the address of the previous one. A consumer must call this function
+  at the start of each call of its security handler, before it returns for any
+  reason. Each security handler runs once per image, so the cache is dropped when a
+  consumer that already started for the cached image starts again.
+
+  @param[in]  Consumer  The consumer, one of PE_IMAGE_DIGEST_CONSUMER_*.
+**/
+VOID
+EFIAPI
+PeImageDigestBeginImage (
+  IN UINT32  Consumer
+  );
+
+/**
+  Get a digest from a digest list.
+
+  @param[in]  DigestList  The digest list.
+  @param[in]  HashAlg     The hash algorithm of the digest.
+
+  @return The digest, or NULL if the digest list has no digest of HashAlg.
+**/
+UINT8 *
+EFIAPI
+PeImageDigestFromList (
+  IN TPML_DIGEST_VALUES  *DigestList,
+  IN TPMI_ALG_HASH       HashAlg
+  );
+
+#endif
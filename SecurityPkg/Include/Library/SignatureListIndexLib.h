@@ -0,0 +1,153 @@
+/** @file
+  Provides a sorted index of the signatures of an EFI_SIGNATURE_LIST database,
+  such as the db and dbx image security databases.
+
+  The index references the signatures in the caller's buffer, sorted by signature
+  type, then by signature data. A lookup is a binary search instead of a walk of
+  all the signature lists, so its cost grows with the logarithm of the number of
+  signatures, not with the number itself. The buffer must not be changed or freed
+  while the index exists.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef SIGNATURE_LIST_INDEX_LIB_H_
+#define SIGNATURE_LIST_INDEX_LIB_H_
+
+#include <Guid/ImageAuthentication.h>
+
+typedef struct _SIGNATURE_LIST_INDEX SIGNATURE_LIST_INDEX;
+
+/**
+  Create the index of a signature database.
+
+  The signature lists are walked the way the image verification does: the walk stops
+  at the first signature list whose size exceeds the remaining size of the database.
+
+  @param[in]  Data      The signature database, a sequence of EFI_SIGNATURE_LIST.
+  @param[in]  DataSize  Size of Data in bytes.
+  @param[out] Index     The index of the database. It must be freed with
+                        SignatureListIndexFree().
+
+  @retval EFI_SUCCESS            The index has been created.
+  @retval EFI_INVALID_PARAMETER  Index is NULL, or Data is NULL and DataSize is not zero.
+  @retval EFI_INVALID_PARAMETER  A signature list of the database is malformed.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to create the index.
+**/
+EFI_STATUS
+EFIAPI
+SignatureListIndexCreate (
+  IN  CONST VOID            *Data,
+  IN  UINTN                 DataSize,
+  OUT SIGNATURE_LIST_INDEX  **Index
+  );
+
+/**
+  Create the index of a signature database in a buffer of the caller, for callers
+  that cannot allocate memory, such as runtime services.
+
+  @param[in]      Data        The signature database, a sequence of EFI_SIGNATURE_LIST.
+  @param[in]      DataSize    Size of Data in bytes.
+  @param[in]      Buffer      Buffer to create the index in, aligned on a UINTN.
+  @param[in, out] BufferSize  On input, the size of Buffer in bytes. On output, the size
+                              of the index.
+  @param[out]     Index       The index of the database, at the start of Buffer. It must
+                              not be freed with SignatureListIndexFree().
+
+  @retval EFI_SUCCESS            The index has been created.
+  @retval EFI_BUFFER_TOO_SMALL   Buffer is too small. BufferSize has been updated with
+                                 the size needed.
+  @retval EFI_INVALID_PARAMETER  BufferSize or Index is NULL, Data is NULL and DataSize is
+                                 not zero, or Buffer is not aligned.
+  @retval EFI_INVALID_PARAMETER  A signature list of the database is malformed.
+  @retval EFI_OUT_OF_RESOURCES   The index of the database would not fit in memory.
+**/
+EFI_STATUS
+EFIAPI
+SignatureListIndexCreateInBuffer (
+  IN     CONST VOID            *Data,
+  IN     UINTN                 DataSize,
+  IN     VOID                  *Buffer,
+  IN OUT UINTN                 *BufferSize,
+  OUT    SIGNATURE_LIST_INDEX  **Index
+  );
+
+/**
+  Free an index created by SignatureListIndexCreate(). The database is not freed.
+
+  @param[in]  Index  The index to free. NULL is ignored.
+**/
+VOID
+EFIAPI
+SignatureListIndexFree (
+  IN SIGNATURE_LIST_INDEX  *Index
+  );
+
+/**
+  Find a signature whose data starts with a key.
+
+  When several signatures match, the first one in the order of the database is
+  returned, which is the one a walk of the signature lists would find.
+
+  @param[in]  Index          The index of the database.
+  @param[in]  SignatureType  Type of the signature list to search.
+  @param[in]  SignatureSize  SignatureSize of the signature list to search, including
+                             the owner GUID, or zero to search the lists of any size.
+  @param[in]  Key            Bytes the signature data starts with.
+  @param[in]  KeySize        Size of Key in bytes.
+  @param[out] SignatureList  The signature list of the signature found. OPTIONAL
+
+  @return The signature found, or NULL if no signature matches.
+**/
+EFI_SIGNATURE_DATA *
+EFIAPI
+SignatureListIndexFind (
+  IN  SIGNATURE_LIST_INDEX  *Index,
+  IN  CONST EFI_GUID        *SignatureType,
+  IN  UINTN                 SignatureSize,
+  IN  CONST VOID            *Key,
+  IN  UINTN                 KeySize,
+  OUT EFI_SIGNATURE_LIST    **SignatureList OPTIONAL
+  );
+
+/**
+  Find a signature, owner included.
+
+  This is the comparison the signature lists of a database are deduplicated with when
+  EFI_SIGNATURE_DATA are appended to it: the same type, the same SignatureSize and the
+  same bytes from SignatureOwner on.
+
+  @param[in]  Index          The index of the database.
+  @param[in]  SignatureType  Type of the signature list of the signature.
+  @param[in]  SignatureSize  SignatureSize of the signature list of the signature.
+  @param[in]  Signature      The signature to find.
+
+  @return The signature found, or NULL if the database does not have the signature.
+**/
+EFI_SIGNATURE_DATA *
+EFIAPI
+SignatureListIndexFindSignature (
+  IN SIGNATURE_LIST_INDEX      *Index,
+  IN CONST EFI_GUID            *SignatureType,
+  IN UINTN                     SignatureSize,
+  IN CONST EFI_SIGNATURE_DATA  *Signature
+  );
+
+/**
+  Get the number of signatures of the database, or of one type of signature.
+
+  @param[in]  Index          The index of the database.
+  @param[in]  SignatureType  Type of the signatures to count, or NULL to count all
+                             the signatures. OPTIONAL
+
+  @return The number of signatures.
+**/
+UINTN
+EFIAPI
+SignatureListIndexCount (
+  IN SIGNATURE_LIST_INDEX  *Index,
+  IN CONST EFI_GUID        *SignatureType OPTIONAL
+  );
+
+#endif
@@ -0,0 +1,63 @@
+/** @file
+  EDKII PE Image Digest Protocol.
+
+  Installed by the TPM 2.0 measure boot handler. While the handler measures a PE/COFF
+  image with HashLogExtendEvent(), the protocol returns the Authenticode digests of
+  the image that were already calculated for its verification, so that the TPM
+  driver extends them instead of hashing the image again.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef EDKII_PE_IMAGE_DIGEST_PROTOCOL_H_
+#define EDKII_PE_IMAGE_DIGEST_PROTOCOL_H_
+
+#include <IndustryStandard/Tpm20.h>
+
+#define EDKII_PE_IMAGE_DIGEST_PROTOCOL_GUID \
+  { \
+    0x7cc07113, 0x318b, 0x48a8, { 0x90, 0x04, 0x67, 0xdb, 0xf4, 0x0b, 0xbb, 0xcd } \
+  }
+
+typedef struct _EDKII_PE_IMAGE_DIGEST_PROTOCOL EDKII_PE_IMAGE_DIGEST_PROTOCOL;
+
+#define EDKII_PE_IMAGE_DIGEST_PROTOCOL_REVISION  0x00000001
+
+/**
+  Get the Authenticode digests of the PE/COFF image being measured.
+
+  @param[in]  This               The EDKII_PE_IMAGE_DIGEST_PROTOCOL instance.
+  @param[in]  ImageAddress       Start address of the image.
+  @param[in]  ImageSize          Size of the image in bytes.
+  @param[in]  HashAlgorithmMask  Hash algorithms, as a mask of EFI_TCG2_BOOT_HASH_ALG_*.
+  @param[out] DigestList         The digests, one per algorithm requested.
+
+  @retval EFI_SUCCESS            The digests have been returned.
+  @retval EFI_INVALID_PARAMETER  DigestList is NULL.
+  @retval EFI_NOT_FOUND          The image is not the one being measured.
+  @retval EFI_UNSUPPORTED        An algorithm requested is not supported, or the image
+                                 is not a valid PE/COFF image.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to hash the image.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_PE_IMAGE_DIGEST_GET_DIGESTS)(
+  IN  EDKII_PE_IMAGE_DIGEST_PROTOCOL  *This,
+  IN  EFI_PHYSICAL_ADDRESS            ImageAddress,
+  IN  UINT64                          ImageSize,
+  IN  UINT32                          HashAlgorithmMask,
+  OUT TPML_DIGEST_VALUES              *DigestList
+  );
+
+///
+/// Authenticode digests of the PE/COFF image being measured.
+///
+struct _EDKII_PE_IMAGE_DIGEST_PROTOCOL {
+  UINT32                               Revision;
+  EDKII_PE_IMAGE_DIGEST_GET_DIGESTS    GetDigests;
+};
+
+extern EFI_GUID  gEdkiiPeImageDigestProtocolGuid;
+
+#endif
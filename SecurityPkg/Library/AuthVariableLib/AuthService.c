@@ -274,6 +274,7 @@ AuthServiceInternalUpdateVariableWithTimeStamp (
   IN EFI_TIME  *TimeStamp
   )
 {
+  EFI_STATUS          Status;
   EFI_STATUS          FindStatus;
   VOID                *OrgData;
   UINTN               OrgDataSize;
@@ -315,9 +316,21 @@ AuthServiceInternalUpdateVariableWithTimeStamp (
   AuthVariableInfo.DataSize     = DataSize;
   AuthVariableInfo.Attributes   = Attributes;
   AuthVariableInfo.TimeStamp    = TimeStamp;
-  return mAuthVarLibContextIn->UpdateVariable (
-                                 &AuthVariableInfo
-                                 );
+
+  Status = mAuthVarLibContextIn->UpdateVariable (&AuthVariableInfo);
+
+  if (!EFI_ERROR (Status) &&
+      (CompareGuid (VendorGuid, &gEfiImageSecurityDatabaseGuid) ||
+       (CompareGuid (VendorGuid, &gEfiGlobalVariableGuid) &&
+        ((StrCmp (VariableName, EFI_KEY_EXCHANGE_KEY_NAME) == 0) || (StrCmp (VariableName, EFI_PLATFORM_KEY_NAME) == 0)))))
+  {
+    //
+    // The trusted certificates have changed, release the ones parsed by Pkcs7Verify().
+    //
+    Pkcs7VerifyCacheFlush ();
+  }
+
+  return Status;
 }
 
 /**
@@ -1042,7 +1055,8 @@ ProcessVariable (
 }
 
 /**
-  Filter out the duplicated EFI_SIGNATURE_DATA from the new data by comparing to the original data.
+  Filter out the duplicated EFI_SIGNATURE_DATA from the new data by walking the original
+  data for each new EFI_SIGNATURE_DATA.
 
   @param[in]        Data          Pointer to original EFI_SIGNATURE_LIST.
   @param[in]        DataSize      Size of Data buffer.
@@ -1050,8 +1064,9 @@ ProcessVariable (
   @param[in, out]   NewDataSize   Size of NewData buffer.
 
 **/
+STATIC
 EFI_STATUS
-FilterSignatureList (
+FilterSignatureListByWalk (
   IN     VOID   *Data,
   IN     UINTN  DataSize,
   IN OUT VOID   *NewData,
@@ -1166,6 +1181,138 @@ FilterSignatureList (
   return EFI_SUCCESS;
 }
 
+/**
+  Filter out the duplicated EFI_SIGNATURE_DATA from the new data by looking each new
+  EFI_SIGNATURE_DATA up in the index of the original data.
+
+  The new data is compacted in place: what is kept of a signature list never goes past
+  the start of the signature list, so nothing is overwritten before it has been read.
+
+  @param[in]        Index         Index of the original EFI_SIGNATURE_LIST.
+  @param[in, out]   NewData       Pointer to new EFI_SIGNATURE_LIST. It must be well-formed.
+  @param[in, out]   NewDataSize   Size of NewData buffer.
+
+**/
+STATIC
+VOID
+FilterSignatureListByIndex (
+  IN     SIGNATURE_LIST_INDEX  *Index,
+  IN OUT VOID                  *NewData,
+  IN OUT UINTN                 *NewDataSize
+  )
+{
+  EFI_SIGNATURE_LIST  NewCertListHeader;
+  EFI_SIGNATURE_LIST  *NewCertList;
+  EFI_SIGNATURE_LIST  *KeptCertList;
+  EFI_SIGNATURE_DATA  *NewCert;
+  UINTN               NewCertCount;
+  UINTN               HeaderSize;
+  UINTN               Index2;
+  UINTN               Size;
+  UINT8               *Tail;
+  UINTN               CopiedCount;
+
+  Tail        = NewData;
+  Size        = *NewDataSize;
+  NewCertList = (EFI_SIGNATURE_LIST *)NewData;
+  while ((Size > 0) && (Size >= NewCertList->SignatureListSize)) {
+    //
+    // The header may be overwritten by the EFI_SIGNATURE_DATA kept.
+    //
+    CopyMem (&NewCertListHeader, NewCertList, sizeof (EFI_SIGNATURE_LIST));
+    HeaderSize   = sizeof (EFI_SIGNATURE_LIST) + NewCertListHeader.SignatureHeaderSize;
+    NewCert      = (EFI_SIGNATURE_DATA *)((UINT8 *)NewCertList + HeaderSize);
+    NewCertCount = (NewCertListHeader.SignatureListSize - HeaderSize) / NewCertListHeader.SignatureSize;
+    KeptCertList = (EFI_SIGNATURE_LIST *)Tail;
+
+    CopiedCount = 0;
+    for (Index2 = 0; Index2 < NewCertCount; Index2++) {
+      if (SignatureListIndexFindSignature (Index, &NewCertListHeader.SignatureType, NewCertListHeader.SignatureSize, NewCert) == NULL) {
+        //
+        // New EFI_SIGNATURE_DATA, keep it.
+        //
+        if (CopiedCount == 0) {
+          CopyMem (Tail, NewCertList, HeaderSize);
+          Tail += HeaderSize;
+        }
+
+        CopyMem (Tail, NewCert, NewCertListHeader.SignatureSize);
+        Tail += NewCertListHeader.SignatureSize;
+        CopiedCount++;
+      }
+
+      NewCert = (EFI_SIGNATURE_DATA *)((UINT8 *)NewCert + NewCertListHeader.SignatureSize);
+    }
+
+    if (CopiedCount != 0) {
+      KeptCertList->SignatureListSize = (UINT32)(HeaderSize + CopiedCount * NewCertListHeader.SignatureSize);
+    }
+
+    Size       -= NewCertListHeader.SignatureListSize;
+    NewCertList = (EFI_SIGNATURE_LIST *)((UINT8 *)NewCertList + NewCertListHeader.SignatureListSize);
+  }
+
+  *NewDataSize = Tail - (UINT8 *)NewData;
+}
+
+/**
+  Filter out the duplicated EFI_SIGNATURE_DATA from the new data by comparing to the original data.
+
+  The original data is indexed in the scratch buffer, so that appending thousands of
+  hashes to a dbx of thousands of hashes does not compare every pair of them. When the
+  index does not fit in the scratch buffer, or either data is not well-formed, the
+  original data is walked for each new EFI_SIGNATURE_DATA instead, which compares
+  every pair again.
+
+  @param[in]        Data          Pointer to original EFI_SIGNATURE_LIST.
+  @param[in]        DataSize      Size of Data buffer.
+  @param[in, out]   NewData       Pointer to new EFI_SIGNATURE_LIST.
+  @param[in, out]   NewDataSize   Size of NewData buffer.
+
+**/
+EFI_STATUS
+FilterSignatureList (
+  IN     VOID   *Data,
+  IN     UINTN  DataSize,
+  IN OUT VOID   *NewData,
+  IN OUT UINTN  *NewDataSize
+  )
+{
+  SIGNATURE_LIST_INDEX  *Index;
+  UINTN                 IndexSize;
+  UINTN                 ScratchSize;
+  VOID                  *Scratch;
+  EFI_STATUS            Status;
+
+  if (*NewDataSize == 0) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Sizing the index of the new data checks that it is well-formed.
+  //
+  IndexSize = 0;
+  Status    = SignatureListIndexCreateInBuffer (NewData, *NewDataSize, NULL, &IndexSize, &Index);
+  if (Status == EFI_BUFFER_TOO_SMALL) {
+    IndexSize = 0;
+    Status    = SignatureListIndexCreateInBuffer (Data, DataSize, NULL, &IndexSize, &Index);
+  }
+
+  if ((Status == EFI_BUFFER_TOO_SMALL) && (IndexSize <= MAX_UINTN - sizeof (UINTN))) {
+    ScratchSize = IndexSize + sizeof (UINTN) - 1;
+    Status      = mAuthVarLibContextIn->GetScratchBuffer (&ScratchSize, &Scratch);
+    if (!EFI_ERROR (Status)) {
+      Status = SignatureListIndexCreateInBuffer (Data, DataSize, ALIGN_POINTER (Scratch, sizeof (UINTN)), &IndexSize, &Index);
+      if (!EFI_ERROR (Status)) {
+        FilterSignatureListByIndex (Index, NewData, NewDataSize);
+        return EFI_SUCCESS;
+      }
+    }
+  }
+
+  return FilterSignatureListByWalk (Data, DataSize, NewData, NewDataSize);
+}
+
 /**
   Compare two EFI_TIME data.
 
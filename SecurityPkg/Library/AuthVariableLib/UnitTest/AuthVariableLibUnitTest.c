@@ -0,0 +1,511 @@
+/** @file
+  Unit tests of FilterSignatureList(), which drops the signatures of an append
+  write to db, dbx, dbt or KEK that are already in the variable.
+
+  The signatures it keeps are compared with those kept by a walk of the original
+  signature lists for each new signature, with and without the index of the
+  original data.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../AuthServiceInternal.h"
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_NAME     "AuthVariableLib Unit Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+#define SHA256_DIGEST_SIZE     32
+#define SHA256_SIGNATURE_SIZE  (sizeof (EFI_GUID) + SHA256_DIGEST_SIZE)
+
+//
+// Maximum size of the scratch buffer, the maximum size of a variable.
+//
+#define SCRATCH_BUFFER_SIZE  SIZE_1MB
+
+STATIC UINT8   *mScratchBuffer;
+STATIC UINTN   mScratchBufferSize;
+
+/**
+  Get the scratch buffer, of mScratchBufferSize bytes at most.
+
+  @param[in, out] ScratchBufferSize Scratch buffer size. If input size is greater than
+                                    the maximum supported buffer size, this value contains
+                                    the maximum supported buffer size as output.
+  @param[out]     ScratchBuffer     Pointer to scratch buffer address.
+
+  @retval EFI_SUCCESS       Get scratch buffer successfully.
+  @retval EFI_UNSUPPORTED   If input size is greater than the maximum supported buffer size.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+MockGetScratchBuffer (
+  IN OUT UINTN  *ScratchBufferSize,
+  OUT    VOID   **ScratchBuffer
+  )
+{
+  if (*ScratchBufferSize > mScratchBufferSize) {
+    *ScratchBufferSize = mScratchBufferSize;
+    return EFI_UNSUPPORTED;
+  }
+
+  *ScratchBuffer = mScratchBuffer;
+  return EFI_SUCCESS;
+}
+
+STATIC AUTH_VAR_LIB_CONTEXT_IN  mMockAuthVarLibContextIn = {
+  AUTH_VAR_LIB_CONTEXT_IN_STRUCT_VERSION,
+  sizeof (AUTH_VAR_LIB_CONTEXT_IN),
+  SCRATCH_BUFFER_SIZE,
+  NULL,
+  NULL,
+  NULL,
+  MockGetScratchBuffer,
+  NULL,
+  NULL
+};
+
+/**
+  Get a hash of a signature list created by CreateHashList().
+
+  @param[in]  List  The signature list.
+  @param[in]  Hash  Position of the hash in the list.
+
+  @return The hash.
+**/
+STATIC
+EFI_SIGNATURE_DATA *
+GetHash (
+  IN UINT8  *List,
+  IN UINTN  Hash
+  )
+{
+  return (EFI_SIGNATURE_DATA *)(List + sizeof (EFI_SIGNATURE_LIST) + Hash * SHA256_SIGNATURE_SIZE);
+}
+
+/**
+  Create a signature list of numbered SHA-256 hashes. The data and the owner of
+  hash N both start with N.
+
+  @param[in]  FirstHash  Number of the first hash.
+  @param[in]  HashCount  Number of hashes.
+  @param[out] ListSize   Size of the signature list in bytes.
+
+  @return The signature list, to free with FreePool().
+**/
+STATIC
+UINT8 *
+CreateHashList (
+  IN  UINTN  FirstHash,
+  IN  UINTN  HashCount,
+  OUT UINTN  *ListSize
+  )
+{
+  EFI_SIGNATURE_LIST  *List;
+  EFI_SIGNATURE_DATA  *Signature;
+  UINT32              Number;
+  UINTN               Index;
+
+  *ListSize = sizeof (EFI_SIGNATURE_LIST) + HashCount * SHA256_SIGNATURE_SIZE;
+  List      = AllocateZeroPool (*ListSize);
+  if (List == NULL) {
+    return NULL;
+  }
+
+  CopyGuid (&List->SignatureType, &gEfiCertSha256Guid);
+  List->SignatureSize     = SHA256_SIGNATURE_SIZE;
+  List->SignatureListSize = (UINT32)*ListSize;
+  for (Index = 0; Index < HashCount; Index++) {
+    Signature = GetHash ((UINT8 *)List, Index);
+    Number    = (UINT32)(FirstHash + Index);
+    CopyMem (&Signature->SignatureOwner, &Number, sizeof (Number));
+    CopyMem (Signature->SignatureData, &Number, sizeof (Number));
+  }
+
+  return (UINT8 *)List;
+}
+
+/**
+  Create a dbx update of new hashes, and of hashes of the original dbx: one in three
+  of the update is in the original dbx, and one in three has the data of a hash of
+  the original dbx with another owner.
+
+  @param[in]  Data          The original dbx.
+  @param[in]  HashCount     Number of hashes of the original dbx.
+  @param[in]  NewHashCount  Number of hashes of the update.
+  @param[out] NewDataSize   Size of the update in bytes.
+
+  @return The update, to free with FreePool().
+**/
+STATIC
+UINT8 *
+CreateHashUpdate (
+  IN  UINT8  *Data,
+  IN  UINTN  HashCount,
+  IN  UINTN  NewHashCount,
+  OUT UINTN  *NewDataSize
+  )
+{
+  UINT8               *NewData;
+  EFI_SIGNATURE_DATA  *Signature;
+  UINTN               Index;
+
+  NewData = CreateHashList (HashCount, NewHashCount, NewDataSize);
+  if (NewData == NULL) {
+    return NULL;
+  }
+
+  for (Index = 0; Index < NewHashCount; Index++) {
+    Signature = GetHash (NewData, Index);
+    switch (Index % 3) {
+      case 0:
+        CopyMem (Signature, GetHash (Data, (Index * 7) % HashCount), SHA256_SIGNATURE_SIZE);
+        break;
+      case 1:
+        CopyMem (Signature->SignatureData, GetHash (Data, (Index * 5) % HashCount)->SignatureData, SHA256_DIGEST_SIZE);
+        break;
+      default:
+        break;
+    }
+  }
+
+  return NewData;
+}
+
+/**
+  Filter out the duplicated EFI_SIGNATURE_DATA from the new data by walking the original
+  data for each new EFI_SIGNATURE_DATA. The filtering is checked against it.
+
+  @param[in]      Data         Pointer to original EFI_SIGNATURE_LIST.
+  @param[in]      DataSize     Size of Data buffer.
+  @param[in, out] NewData      Pointer to new EFI_SIGNATURE_LIST.
+  @param[in, out] NewDataSize  Size of NewData buffer.
+**/
+STATIC
+VOID
+ReferenceFilterSignatureList (
+  IN     UINT8  *Data,
+  IN     UINTN  DataSize,
+  IN OUT UINT8  *NewData,
+  IN OUT UINTN  *NewDataSize
+  )
+{
+  EFI_SIGNATURE_LIST  *CertList;
+  EFI_SIGNATURE_LIST  *NewCertList;
+  EFI_SIGNATURE_LIST  *KeptCertList;
+  UINT8               *Cert;
+  UINT8               *NewCert;
+  UINT8               *Kept;
+  UINT8               *Tail;
+  UINTN               Size;
+  UINTN               NewSize;
+  UINTN               Index;
+  UINTN               Index2;
+  BOOLEAN             IsNewCert;
+
+  Kept = AllocatePool (*NewDataSize);
+  ASSERT (Kept != NULL);
+  Tail = Kept;
+
+  NewSize     = *NewDataSize;
+  NewCertList = (EFI_SIGNATURE_LIST *)NewData;
+  while ((NewSize > 0) && (NewSize >= NewCertList->SignatureListSize)) {
+    KeptCertList = NULL;
+    NewCert      = (UINT8 *)(NewCertList + 1) + NewCertList->SignatureHeaderSize;
+    for (Index = 0; Index < (NewCertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - NewCertList->SignatureHeaderSize) / NewCertList->SignatureSize; Index++) {
+      IsNewCert = TRUE;
+      Size      = DataSize;
+      CertList  = (EFI_SIGNATURE_LIST *)Data;
+      while (IsNewCert && (Size > 0) && (Size >= CertList->SignatureListSize)) {
+        if (CompareGuid (&CertList->SignatureType, &NewCertList->SignatureType) && (CertList->SignatureSize == NewCertList->SignatureSize)) {
+          Cert = (UINT8 *)(CertList + 1) + CertList->SignatureHeaderSize;
+          for (Index2 = 0; Index2 < (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize; Index2++) {
+            if (CompareMem (NewCert, Cert, CertList->SignatureSize) == 0) {
+              IsNewCert = FALSE;
+              break;
+            }
+
+            Cert += CertList->SignatureSize;
+          }
+        }
+
+        Size    -= CertList->SignatureListSize;
+        CertList = (EFI_SIGNATURE_LIST *)((UINT8 *)CertList + CertList->SignatureListSize);
+      }
+
+      if (IsNewCert) {
+        if (KeptCertList == NULL) {
+          KeptCertList = (EFI_SIGNATURE_LIST *)Tail;
+          CopyMem (Tail, NewCertList, sizeof (EFI_SIGNATURE_LIST) + NewCertList->SignatureHeaderSize);
+          KeptCertList->SignatureListSize = (UINT32)(sizeof (EFI_SIGNATURE_LIST) + NewCertList->SignatureHeaderSize);
+          Tail                           += KeptCertList->SignatureListSize;
+        }
+
+        CopyMem (Tail, NewCert, NewCertList->SignatureSize);
+        Tail                            += NewCertList->SignatureSize;
+        KeptCertList->SignatureListSize += NewCertList->SignatureSize;
+      }
+
+      NewCert += NewCertList->SignatureSize;
+    }
+
+    NewSize    -= NewCertList->SignatureListSize;
+    NewCertList = (EFI_SIGNATURE_LIST *)((UINT8 *)NewCertList + NewCertList->SignatureListSize);
+  }
+
+  *NewDataSize = Tail - Kept;
+  CopyMem (NewData, Kept, *NewDataSize);
+  FreePool (Kept);
+}
+
+/**
+  Filter an update with FilterSignatureList() and with the reference walk, and check
+  that they keep the same signatures.
+
+  @param[in]  Data         The original data.
+  @param[in]  DataSize     Size of Data in bytes.
+  @param[in]  NewData      The update.
+  @param[in]  NewDataSize  Size of NewData in bytes.
+  @param[out] KeptSize     Size of the update once filtered.
+
+  @retval TRUE   Both kept the same signatures.
+  @retval FALSE  The signatures kept differ.
+**/
+STATIC
+BOOLEAN
+FilterMatchesReference (
+  IN  UINT8  *Data,
+  IN  UINTN  DataSize,
+  IN  UINT8  *NewData,
+  IN  UINTN  NewDataSize,
+  OUT UINTN  *KeptSize
+  )
+{
+  UINT8    *Filtered;
+  UINT8    *Expected;
+  UINTN    FilteredSize;
+  UINTN    ExpectedSize;
+  BOOLEAN  Match;
+
+  Filtered = AllocateCopyPool (NewDataSize, NewData);
+  Expected = AllocateCopyPool (NewDataSize, NewData);
+  ASSERT (Filtered != NULL && Expected != NULL);
+
+  FilteredSize = NewDataSize;
+  FilterSignatureList (Data, DataSize, Filtered, &FilteredSize);
+  ExpectedSize = NewDataSize;
+  ReferenceFilterSignatureList (Data, DataSize, Expected, &ExpectedSize);
+
+  Match     = (BOOLEAN)((FilteredSize == ExpectedSize) && (CompareMem (Filtered, Expected, ExpectedSize) == 0));
+  *KeptSize = FilteredSize;
+
+  FreePool (Filtered);
+  FreePool (Expected);
+  return Match;
+}
+
+/**
+  Set up the scratch buffer of the tests.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  The scratch buffer is allocated.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SetupScratchBuffer (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  mScratchBuffer = AllocatePool (SCRATCH_BUFFER_SIZE);
+  UT_ASSERT_NOT_NULL (mScratchBuffer);
+  mScratchBufferSize   = SCRATCH_BUFFER_SIZE;
+  mAuthVarLibContextIn = &mMockAuthVarLibContextIn;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free the scratch buffer of the tests.
+
+  @param[in]  Context  Unused.
+**/
+STATIC
+VOID
+EFIAPI
+CleanupScratchBuffer (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  FreePool (mScratchBuffer);
+  mScratchBuffer       = NULL;
+  mAuthVarLibContextIn = NULL;
+}
+
+/**
+  The hashes of a dbx update already in dbx are filtered out, and the hashes of
+  dbx with another owner are kept.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  The update was filtered as by the walk.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+FilterHashUpdate (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8  *Data;
+  UINT8  *NewData;
+  UINTN  DataSize;
+  UINTN  NewDataSize;
+  UINTN  KeptSize;
+  UINTN  Index;
+
+  Data = CreateHashList (0, 3000, &DataSize);
+  UT_ASSERT_NOT_NULL (Data);
+  NewData = CreateHashUpdate (Data, 3000, 3000, &NewDataSize);
+  UT_ASSERT_NOT_NULL (NewData);
+
+  UT_ASSERT_TRUE (FilterMatchesReference (Data, DataSize, NewData, NewDataSize, &KeptSize));
+  UT_ASSERT_EQUAL (KeptSize, sizeof (EFI_SIGNATURE_LIST) + 2000 * SHA256_SIGNATURE_SIZE);
+
+  //
+  // Nothing is kept of an update already in dbx.
+  //
+  UT_ASSERT_EQUAL (NewDataSize, DataSize);
+  CopyMem (NewData, Data, DataSize);
+  KeptSize = DataSize;
+  FilterSignatureList (Data, DataSize, NewData, &KeptSize);
+  UT_ASSERT_EQUAL (KeptSize, 0);
+
+  //
+  // Everything is kept of an update of another signature type.
+  //
+  for (Index = 0; Index < DataSize; Index += ((EFI_SIGNATURE_LIST *)&NewData[Index])->SignatureListSize) {
+    CopyGuid (&((EFI_SIGNATURE_LIST *)&NewData[Index])->SignatureType, &gEfiCertX509Sha256Guid);
+  }
+
+  KeptSize = DataSize;
+  FilterSignatureList (Data, DataSize, NewData, &KeptSize);
+  UT_ASSERT_EQUAL (KeptSize, DataSize);
+
+  FreePool (NewData);
+  FreePool (Data);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The update is filtered the same when the scratch buffer is too small for the index
+  of the original data, and when the data is not well-formed.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  The update was filtered as by the walk.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+FilterWithoutIndex (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8  *Data;
+  UINT8  *NewData;
+  UINTN  DataSize;
+  UINTN  NewDataSize;
+  UINTN  KeptSize;
+
+  Data = CreateHashList (0, 1000, &DataSize);
+  UT_ASSERT_NOT_NULL (Data);
+  NewData = CreateHashUpdate (Data, 1000, 30, &NewDataSize);
+  UT_ASSERT_NOT_NULL (NewData);
+
+  mScratchBufferSize = NewDataSize;
+  UT_ASSERT_TRUE (FilterMatchesReference (Data, DataSize, NewData, NewDataSize, &KeptSize));
+  UT_ASSERT_EQUAL (KeptSize, sizeof (EFI_SIGNATURE_LIST) + 20 * SHA256_SIGNATURE_SIZE);
+  mScratchBufferSize = SCRATCH_BUFFER_SIZE;
+
+  //
+  // A signature list of the original data with signatures smaller than their owner.
+  //
+  ((EFI_SIGNATURE_LIST *)Data)->SignatureSize = sizeof (UINT64);
+  UT_ASSERT_TRUE (FilterMatchesReference (Data, DataSize, NewData, NewDataSize, &KeptSize));
+  UT_ASSERT_TRUE (KeptSize >= sizeof (EFI_SIGNATURE_LIST) + 20 * SHA256_SIGNATURE_SIZE);
+
+  FreePool (NewData);
+  FreePool (Data);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests and run them.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      FilterTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&FilterTests, Framework, "FilterSignatureList Tests", "AuthVariableLib.FilterSignatureList", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for FilterSignatureList\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (FilterTests, "Hashes of dbx are filtered out of a dbx update", "FilterHashUpdate", FilterHashUpdate, SetupScratchBuffer, CleanupScratchBuffer, NULL);
+  AddTestCase (FilterTests, "Updates are filtered without the index", "FilterWithoutIndex", FilterWithoutIndex, SetupScratchBuffer, CleanupScratchBuffer, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
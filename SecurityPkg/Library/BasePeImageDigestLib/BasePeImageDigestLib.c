@@ -0,0 +1,687 @@
+/** @file
+  Calculate and cache the Authenticode digests of a PE/COFF image for several hash
+  algorithms in one walk of the image.
+
+  Caution: This file requires additional review when modified.
+  This library will have external input - PE/COFF image.
+  This external input must be validated carefully to avoid security issue like
+  buffer overflow, integer overflow.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <IndustryStandard/PeImage.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/BaseCryptLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PeCoffLib.h>
+#include <Library/PeImageDigestLib.h>
+
+typedef
+UINTN
+(EFIAPI *PE_IMAGE_DIGEST_GET_CONTEXT_SIZE)(
+  VOID
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *PE_IMAGE_DIGEST_INIT)(
+  OUT VOID  *HashContext
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *PE_IMAGE_DIGEST_UPDATE)(
+  IN OUT VOID        *HashContext,
+  IN     CONST VOID  *Data,
+  IN     UINTN       DataSize
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *PE_IMAGE_DIGEST_FINAL)(
+  IN OUT VOID   *HashContext,
+  OUT    UINT8  *HashValue
+  );
+
+typedef struct {
+  UINT32                              HashMask;
+  TPMI_ALG_HASH                       HashAlg;
+  UINTN                               DigestSize;
+  PE_IMAGE_DIGEST_GET_CONTEXT_SIZE    GetContextSize;
+  PE_IMAGE_DIGEST_INIT                HashInit;
+  PE_IMAGE_DIGEST_UPDATE              HashUpdate;
+  PE_IMAGE_DIGEST_FINAL               HashFinal;
+} PE_IMAGE_DIGEST_HASH;
+
+typedef struct {
+  CONST UINT8    *ImageBase;
+  UINTN          ImageSize;
+} PE_IMAGE_DIGEST_IMAGE;
+
+STATIC CONST PE_IMAGE_DIGEST_HASH  mHashTable[] = {
+ #ifndef DISABLE_SHA1_DEPRECATED_INTERFACES
+  { EFI_TCG2_BOOT_HASH_ALG_SHA1,    TPM_ALG_SHA1,    SHA1_DIGEST_SIZE,    Sha1GetContextSize,   Sha1Init,   Sha1Update,   Sha1Final   },
+ #endif
+  { EFI_TCG2_BOOT_HASH_ALG_SHA256,  TPM_ALG_SHA256,  SHA256_DIGEST_SIZE,  Sha256GetContextSize, Sha256Init, Sha256Update, Sha256Final },
+  { EFI_TCG2_BOOT_HASH_ALG_SHA384,  TPM_ALG_SHA384,  SHA384_DIGEST_SIZE,  Sha384GetContextSize, Sha384Init, Sha384Update, Sha384Final },
+  { EFI_TCG2_BOOT_HASH_ALG_SHA512,  TPM_ALG_SHA512,  SHA512_DIGEST_SIZE,  Sha512GetContextSize, Sha512Init, Sha512Update, Sha512Final },
+  { EFI_TCG2_BOOT_HASH_ALG_SM3_256, TPM_ALG_SM3_256, SM3_256_DIGEST_SIZE, Sm3GetContextSize,    Sm3Init,    Sm3Update,    Sm3Final    }
+};
+
+#define PE_IMAGE_DIGEST_HASH_COUNT  ARRAY_SIZE (mHashTable)
+
+//
+// Digests of the image being authenticated.
+//
+STATIC CONST VOID  *mCachedImageBase = NULL;
+STATIC UINTN       mCachedImageSize  = 0;
+STATIC UINT32      mCachedHashMask   = 0;
+STATIC UINT8       mCachedDigest[PE_IMAGE_DIGEST_HASH_COUNT][sizeof (TPMU_HA)];
+
+//
+// Algorithms the consumers will request, consumers started for the cached image,
+// and the last consumer started.
+//
+STATIC UINT32  mWantedHashMask  = 0;
+STATIC UINT32  mConsumers       = 0;
+STATIC UINT32  mCurrentConsumer = 0;
+
+/**
+  Get the hash algorithms supported.
+
+  @return Mask of EFI_TCG2_BOOT_HASH_ALG_*.
+**/
+STATIC
+UINT32
+GetSupportedHashMask (
+  VOID
+  )
+{
+  UINTN   Index;
+  UINT32  HashMask;
+
+  HashMask = 0;
+  for (Index = 0; Index < PE_IMAGE_DIGEST_HASH_COUNT; Index++) {
+    HashMask |= mHashTable[Index].HashMask;
+  }
+
+  return HashMask;
+}
+
+/**
+  Reads contents of a PE/COFF image in memory buffer.
+
+  Caution: This function may receive untrusted input.
+  PE/COFF image is external input, so this function will make sure the PE/COFF image content
+  read is within the image buffer.
+
+  @param  FileHandle      Pointer to the PE_IMAGE_DIGEST_IMAGE of the image.
+  @param  FileOffset      Offset into the PE/COFF image to begin the read operation.
+  @param  ReadSize        On input, the size in bytes of the requested read operation.
+                          On output, the number of bytes actually read.
+  @param  Buffer          Output buffer that contains the data read from the PE/COFF image.
+
+  @retval EFI_SUCCESS     The specified portion of the PE/COFF image was read and the size
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+PeImageDigestImageRead (
+  IN     VOID   *FileHandle,
+  IN     UINTN  FileOffset,
+  IN OUT UINTN  *ReadSize,
+  OUT    VOID   *Buffer
+  )
+{
+  PE_IMAGE_DIGEST_IMAGE  *Image;
+
+  if ((FileHandle == NULL) || (ReadSize == NULL) || (Buffer == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Image = (PE_IMAGE_DIGEST_IMAGE *)FileHandle;
+  if (FileOffset >= Image->ImageSize) {
+    *ReadSize = 0;
+  } else if (*ReadSize > Image->ImageSize - FileOffset) {
+    *ReadSize = Image->ImageSize - FileOffset;
+  }
+
+  CopyMem (Buffer, Image->ImageBase + FileOffset, *ReadSize);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Update all the hash contexts with a range of the image.
+
+  @param[in]  HashContext  The hash contexts, NULL for the algorithms not calculated.
+  @param[in]  Data         The range of the image.
+  @param[in]  DataSize     Size of the range in bytes.
+
+  @retval TRUE   The contexts have been updated.
+  @retval FALSE  A context could not be updated.
+**/
+STATIC
+BOOLEAN
+UpdateHashContexts (
+  IN VOID        **HashContext,
+  IN CONST VOID  *Data,
+  IN UINTN       DataSize
+  )
+{
+  UINTN  Index;
+
+  if (DataSize == 0) {
+    return TRUE;
+  }
+
+  for (Index = 0; Index < PE_IMAGE_DIGEST_HASH_COUNT; Index++) {
+    if (HashContext[Index] == NULL) {
+      continue;
+    }
+
+    if (!mHashTable[Index].HashUpdate (HashContext[Index], Data, DataSize)) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Calculate the Authenticode digests of a PE/COFF image, based on the authenticode
+  image hashing in PE/COFF Specification 8.0 Appendix A. Each range of the image is
+  hashed with all the algorithms before the next one is read.
+
+  Caution: This function may receive untrusted input.
+  PE/COFF image is external input, so this function will validate its data structure
+  within this image buffer before use.
+
+  @param[in]  ImageBase  Start address of the image.
+  @param[in]  ImageSize  Size of the image in bytes.
+  @param[in]  HashMask   Hash algorithms to calculate. They must be supported.
+  @param[out] Digest     The digests, indexed like mHashTable. Only the digests of
+                         the algorithms of HashMask are written.
+
+  @retval EFI_SUCCESS           The digests have been calculated.
+  @retval EFI_UNSUPPORTED       The image is not a valid PE/COFF image.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory to hash the image.
+**/
+STATIC
+EFI_STATUS
+HashImage (
+  IN  CONST UINT8  *ImageBase,
+  IN  UINTN        ImageSize,
+  IN  UINT32       HashMask,
+  OUT UINT8        Digest[PE_IMAGE_DIGEST_HASH_COUNT][sizeof (TPMU_HA)]
+  )
+{
+  EFI_STATUS                           Status;
+  PE_IMAGE_DIGEST_IMAGE                Image;
+  PE_COFF_LOADER_IMAGE_CONTEXT         ImageContext;
+  EFI_IMAGE_DOS_HEADER                 *DosHdr;
+  UINT32                               PeCoffHeaderOffset;
+  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  Hdr;
+  VOID                                 *HashContext[PE_IMAGE_DIGEST_HASH_COUNT];
+  UINT32                               *CheckSum;
+  EFI_IMAGE_DATA_DIRECTORY             *SecDataDir;
+  UINT32                               NumberOfRvaAndSizes;
+  UINTN                                SizeOfHeaders;
+  CONST UINT8                          *HashBase;
+  UINTN                                HashSize;
+  UINTN                                SumOfBytesHashed;
+  UINTN                                SectionTableOffset;
+  EFI_IMAGE_SECTION_HEADER             *Section;
+  EFI_IMAGE_SECTION_HEADER             *SectionHeader;
+  UINTN                                NumberOfSections;
+  UINT32                               CertSize;
+  UINTN                                Index;
+  UINTN                                Pos;
+
+  SectionHeader = NULL;
+  ZeroMem (HashContext, sizeof (HashContext));
+
+  //
+  // Check PE/COFF image.
+  //
+  Image.ImageBase = ImageBase;
+  Image.ImageSize = ImageSize;
+  ZeroMem (&ImageContext, sizeof (ImageContext));
+  ImageContext.Handle    = &Image;
+  ImageContext.ImageRead = (PE_COFF_LOADER_READ_FILE)PeImageDigestImageRead;
+  if (RETURN_ERROR (PeCoffLoaderGetImageInfo (&ImageContext))) {
+    return EFI_UNSUPPORTED;
+  }
+
+  DosHdr             = (EFI_IMAGE_DOS_HEADER *)ImageBase;
+  PeCoffHeaderOffset = 0;
+  if (DosHdr->e_magic == EFI_IMAGE_DOS_SIGNATURE) {
+    PeCoffHeaderOffset = DosHdr->e_lfanew;
+  }
+
+  Hdr.Pe32 = (EFI_IMAGE_NT_HEADERS32 *)(ImageBase + PeCoffHeaderOffset);
+  if (Hdr.Pe32->Signature != EFI_IMAGE_NT_SIGNATURE) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (Hdr.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+    CheckSum            = &Hdr.Pe32->OptionalHeader.CheckSum;
+    SecDataDir          = &Hdr.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY];
+    NumberOfRvaAndSizes = Hdr.Pe32->OptionalHeader.NumberOfRvaAndSizes;
+    SizeOfHeaders       = Hdr.Pe32->OptionalHeader.SizeOfHeaders;
+  } else if (Hdr.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC) {
+    CheckSum            = &Hdr.Pe32Plus->OptionalHeader.CheckSum;
+    SecDataDir          = &Hdr.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY];
+    NumberOfRvaAndSizes = Hdr.Pe32Plus->OptionalHeader.NumberOfRvaAndSizes;
+    SizeOfHeaders       = Hdr.Pe32Plus->OptionalHeader.SizeOfHeaders;
+  } else {
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // The header ranges hashed must be within SizeOfHeaders, and SizeOfHeaders within
+  // the image.
+  //
+  if (NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
+    HashBase = (UINT8 *)(CheckSum + 1);
+  } else {
+    HashBase = (UINT8 *)(SecDataDir + 1);
+  }
+
+  if ((SizeOfHeaders > ImageSize) || ((UINTN)(HashBase - ImageBase) > SizeOfHeaders)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  NumberOfSections   = Hdr.Pe32->FileHeader.NumberOfSections;
+  SectionTableOffset = PeCoffHeaderOffset + sizeof (UINT32) + sizeof (EFI_IMAGE_FILE_HEADER) +
+                       Hdr.Pe32->FileHeader.SizeOfOptionalHeader;
+  if ((SectionTableOffset > ImageSize) ||
+      (NumberOfSections > (ImageSize - SectionTableOffset) / sizeof (EFI_IMAGE_SECTION_HEADER)))
+  {
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // 1.  Load the image header into memory.
+  // 2.  Initialize a hash context for each algorithm.
+  //
+  Status = EFI_OUT_OF_RESOURCES;
+  for (Index = 0; Index < PE_IMAGE_DIGEST_HASH_COUNT; Index++) {
+    if ((HashMask & mHashTable[Index].HashMask) == 0) {
+      continue;
+    }
+
+    HashContext[Index] = AllocatePool (mHashTable[Index].GetContextSize ());
+    if (HashContext[Index] == NULL) {
+      goto Done;
+    }
+
+    if (!mHashTable[Index].HashInit (HashContext[Index])) {
+      Status = EFI_UNSUPPORTED;
+      goto Done;
+    }
+  }
+
+  Status = EFI_UNSUPPORTED;
+
+  //
+  // 3.  Calculate the distance from the base of the image header to the image checksum address.
+  // 4.  Hash the image header from its base to beginning of the image checksum.
+  // 5.  Skip over the image checksum (it occupies a single ULONG).
+  //
+  if (!UpdateHashContexts (HashContext, ImageBase, (UINTN)((UINT8 *)CheckSum - ImageBase))) {
+    goto Done;
+  }
+
+  //
+  // 6.  If there is no Cert Directory in optional header, hash everything
+  //     from the end of the checksum to the end of image header.
+  //
+  HashBase = (UINT8 *)(CheckSum + 1);
+  if (NumberOfRvaAndSizes > EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
+    //
+    // 7.  Hash everything from the end of the checksum to the start of the Cert Directory.
+    //
+    if (!UpdateHashContexts (HashContext, HashBase, (UINTN)((UINT8 *)SecDataDir - HashBase))) {
+      goto Done;
+    }
+
+    //
+    // 8.  Skip over the Cert Directory. (It is sizeof(IMAGE_DATA_DIRECTORY) bytes.)
+    // 9.  Hash everything from the end of the Cert Directory to the end of image header.
+    //
+    HashBase = (UINT8 *)(SecDataDir + 1);
+  }
+
+  if (!UpdateHashContexts (HashContext, HashBase, SizeOfHeaders - (UINTN)(HashBase - ImageBase))) {
+    goto Done;
+  }
+
+  //
+  // 10. Set the SUM_OF_BYTES_HASHED to the size of the header.
+  //
+  SumOfBytesHashed = SizeOfHeaders;
+
+  //
+  // 11. Build a temporary table of pointers to all the IMAGE_SECTION_HEADER
+  //     structures in the image.
+  // 12. Using the 'PointerToRawData' in the referenced section headers as
+  //     a key, arrange the elements in the table in ascending order.
+  //
+  if (NumberOfSections != 0) {
+    SectionHeader = AllocateZeroPool (sizeof (EFI_IMAGE_SECTION_HEADER) * NumberOfSections);
+    if (SectionHeader == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      goto Done;
+    }
+  }
+
+  Section = (EFI_IMAGE_SECTION_HEADER *)(ImageBase + SectionTableOffset);
+  for (Index = 0; Index < NumberOfSections; Index++) {
+    Pos = Index;
+    while ((Pos > 0) && (Section->PointerToRawData < SectionHeader[Pos - 1].PointerToRawData)) {
+      CopyMem (&SectionHeader[Pos], &SectionHeader[Pos - 1], sizeof (EFI_IMAGE_SECTION_HEADER));
+      Pos--;
+    }
+
+    CopyMem (&SectionHeader[Pos], Section, sizeof (EFI_IMAGE_SECTION_HEADER));
+    Section += 1;
+  }
+
+  //
+  // 13. Walk through the sorted table, bring the corresponding section
+  //     into memory, and hash the entire section.
+  // 14. Add the section's 'SizeOfRawData' to SUM_OF_BYTES_HASHED.
+  // 15. Repeat steps 13 and 14 for all the sections in the sorted table.
+  //
+  for (Index = 0; Index < NumberOfSections; Index++) {
+    Section = &SectionHeader[Index];
+    if (Section->SizeOfRawData == 0) {
+      continue;
+    }
+
+    if ((Section->PointerToRawData > ImageSize) ||
+        (Section->SizeOfRawData > ImageSize - Section->PointerToRawData) ||
+        (Section->SizeOfRawData > MAX_UINTN - SumOfBytesHashed))
+    {
+      goto Done;
+    }
+
+    if (!UpdateHashContexts (HashContext, ImageBase + Section->PointerToRawData, Section->SizeOfRawData)) {
+      goto Done;
+    }
+
+    SumOfBytesHashed += Section->SizeOfRawData;
+  }
+
+  //
+  // 16. If the file size is greater than SUM_OF_BYTES_HASHED, there is extra
+  //     data in the file that needs to be added to the hash. This data begins
+  //     at file offset SUM_OF_BYTES_HASHED and its length is:
+  //             FileSize  -  (CertDirectory->Size)
+  //
+  if (ImageSize > SumOfBytesHashed) {
+    CertSize = 0;
+    if (NumberOfRvaAndSizes > EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
+      CertSize = SecDataDir->Size;
+    }
+
+    HashSize = ImageSize - SumOfBytesHashed;
+    if (HashSize < CertSize) {
+      goto Done;
+    }
+
+    if (!UpdateHashContexts (HashContext, ImageBase + SumOfBytesHashed, HashSize - CertSize)) {
+      goto Done;
+    }
+  }
+
+  //
+  // 17. Finalize the hashes.
+  //
+  for (Index = 0; Index < PE_IMAGE_DIGEST_HASH_COUNT; Index++) {
+    if (HashContext[Index] == NULL) {
+      continue;
+    }
+
+    if (!mHashTable[Index].HashFinal (HashContext[Index], Digest[Index])) {
+      goto Done;
+    }
+  }
+
+  Status = EFI_SUCCESS;
+
+Done:
+  for (Index = 0; Index < PE_IMAGE_DIGEST_HASH_COUNT; Index++) {
+    if (HashContext[Index] != NULL) {
+      FreePool (HashContext[Index]);
+    }
+  }
+
+  if (SectionHeader != NULL) {
+    FreePool (SectionHeader);
+  }
+
+  return Status;
+}
+
+/**
+  Build a digest list from the digests of some algorithms.
+
+  @param[in]  HashMask    Hash algorithms of the digest list.
+  @param[in]  Digest      The digests, indexed like mHashTable.
+  @param[out] DigestList  The digest list.
+**/
+STATIC
+VOID
+BuildDigestList (
+  IN  UINT32              HashMask,
+  IN  UINT8               Digest[PE_IMAGE_DIGEST_HASH_COUNT][sizeof (TPMU_HA)],
+  OUT TPML_DIGEST_VALUES  *DigestList
+  )
+{
+  UINTN  Index;
+
+  ZeroMem (DigestList, sizeof (*DigestList));
+  for (Index = 0; Index < PE_IMAGE_DIGEST_HASH_COUNT; Index++) {
+    if ((HashMask & mHashTable[Index].HashMask) == 0) {
+      continue;
+    }
+
+    DigestList->digests[DigestList->count].hashAlg = mHashTable[Index].HashAlg;
+    CopyMem (&DigestList->digests[DigestList->count].digest, Digest[Index], mHashTable[Index].DigestSize);
+    DigestList->count++;
+  }
+}
+
+/**
+  Calculate the Authenticode digests of a PE/COFF image, for all the hash algorithms
+  requested, in one walk of the image. Nothing is cached.
+
+  Caution: This function may receive untrusted input.
+  PE/COFF image is external input, so this function will validate its data structure
+  within this image buffer before use.
+
+  @param[in]  ImageBase          Start address of the image.
+  @param[in]  ImageSize          Size of the image in bytes.
+  @param[in]  HashAlgorithmMask  Hash algorithms, as a mask of EFI_TCG2_BOOT_HASH_ALG_*.
+  @param[out] DigestList         The digests, one per algorithm requested.
+
+  @retval EFI_SUCCESS            The digests have been calculated.
+  @retval EFI_INVALID_PARAMETER  ImageBase or DigestList is NULL.
+  @retval EFI_UNSUPPORTED        HashAlgorithmMask is zero, or requests an algorithm that
+                                 is not supported.
+  @retval EFI_UNSUPPORTED        The image is not a valid PE/COFF image.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to hash the image.
+**/
+EFI_STATUS
+EFIAPI
+PeImageDigestCalculate (
+  IN  CONST VOID          *ImageBase,
+  IN  UINTN               ImageSize,
+  IN  UINT32              HashAlgorithmMask,
+  OUT TPML_DIGEST_VALUES  *DigestList
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       Digest[PE_IMAGE_DIGEST_HASH_COUNT][sizeof (TPMU_HA)];
+
+  if ((ImageBase == NULL) || (DigestList == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((HashAlgorithmMask == 0) || ((HashAlgorithmMask & ~GetSupportedHashMask ()) != 0)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = HashImage (ImageBase, ImageSize, HashAlgorithmMask, Digest);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  BuildDigestList (HashAlgorithmMask, Digest, DigestList);
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the Authenticode digests of the image being authenticated.
+
+  The digests already calculated for the image are returned from the cache. The
+  missing ones are calculated in one walk of the image, together with the digests
+  of the algorithms added with PeImageDigestAddAlgorithms(), which the next
+  consumers of the image will request.
+
+  Caution: This function may receive untrusted input.
+  PE/COFF image is external input, so this function will validate its data structure
+  within this image buffer before use.
+
+  @param[in]  ImageBase          Start address of the image.
+  @param[in]  ImageSize          Size of the image in bytes.
+  @param[in]  HashAlgorithmMask  Hash algorithms, as a mask of EFI_TCG2_BOOT_HASH_ALG_*.
+  @param[out] DigestList         The digests, one per algorithm requested.
+
+  @retval EFI_SUCCESS            The digests have been returned.
+  @retval EFI_INVALID_PARAMETER  ImageBase or DigestList is NULL.
+  @retval EFI_UNSUPPORTED        HashAlgorithmMask is zero, or requests an algorithm that
+                                 is not supported.
+  @retval EFI_UNSUPPORTED        The image is not a valid PE/COFF image.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to hash the image.
+**/
+EFI_STATUS
+EFIAPI
+PeImageDigestGet (
+  IN  CONST VOID          *ImageBase,
+  IN  UINTN               ImageSize,
+  IN  UINT32              HashAlgorithmMask,
+  OUT TPML_DIGEST_VALUES  *DigestList
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      HashMask;
+
+  if ((ImageBase == NULL) || (DigestList == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((HashAlgorithmMask == 0) || ((HashAlgorithmMask & ~GetSupportedHashMask ()) != 0)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if ((ImageBase != mCachedImageBase) || (ImageSize != mCachedImageSize)) {
+    //
+    // The consumers started for a previous image do not own this one.
+    //
+    mCachedImageBase = ImageBase;
+    mCachedImageSize = ImageSize;
+    mCachedHashMask  = 0;
+    mConsumers       = mCurrentConsumer;
+  }
+
+  if ((HashAlgorithmMask & ~mCachedHashMask) != 0) {
+    HashMask = (HashAlgorithmMask | mWantedHashMask) & ~mCachedHashMask;
+    Status   = HashImage (ImageBase, ImageSize, HashMask, mCachedDigest);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    mCachedHashMask |= HashMask;
+  }
+
+  BuildDigestList (HashAlgorithmMask, mCachedDigest, DigestList);
+  return EFI_SUCCESS;
+}
+
+/**
+  Add hash algorithms to calculate whenever an image is walked, because a consumer
+  will request them. The algorithms that are not supported are ignored.
+
+  @param[in]  HashAlgorithmMask  Hash algorithms, as a mask of EFI_TCG2_BOOT_HASH_ALG_*.
+**/
+VOID
+EFIAPI
+PeImageDigestAddAlgorithms (
+  IN UINT32  HashAlgorithmMask
+  )
+{
+  mWantedHashMask |= HashAlgorithmMask & GetSupportedHashMask ();
+}
+
+/**
+  Tell that a consumer starts the authentication of an image.
+
+  The digests are cached for the address and size of an image, and a new image may
+  be loaded at the address of the previous one. A consumer must call this function
+  at the start of each call of its security handler, before it returns for any
+  reason. Each security handler runs once per image, so the cache is dropped when a
+  consumer that already started for the cached image starts again.
+
+  @param[in]  Consumer  The consumer, one of PE_IMAGE_DIGEST_CONSUMER_*.
+**/
+VOID
+EFIAPI
+PeImageDigestBeginImage (
+  IN UINT32  Consumer
+  )
+{
+  if ((mConsumers & Consumer) != 0) {
+    mCachedImageBase = NULL;
+    mCachedImageSize = 0;
+    mCachedHashMask  = 0;
+    mConsumers       = 0;
+  }
+
+  mConsumers      |= Consumer;
+  mCurrentConsumer = Consumer;
+}
+
+/**
+  Get a digest from a digest list.
+
+  @param[in]  DigestList  The digest list.
+  @param[in]  HashAlg     The hash algorithm of the digest.
+
+  @return The digest, or NULL if the digest list has no digest of HashAlg.
+**/
+UINT8 *
+EFIAPI
+PeImageDigestFromList (
+  IN TPML_DIGEST_VALUES  *DigestList,
+  IN TPMI_ALG_HASH       HashAlg
+  )
+{
+  UINT32  Index;
+
+  for (Index = 0; Index < DigestList->count && Index < HASH_COUNT; Index++) {
+    if (DigestList->digests[Index].hashAlg == HashAlg) {
+      return (UINT8 *)&DigestList->digests[Index].digest;
+    }
+  }
+
+  return NULL;
+}
@@ -0,0 +1,581 @@
+/** @file
+  Unit tests of BasePeImageDigestLib.
+
+  They check that the digests of all the algorithms calculated in one walk of a
+  PE32 or PE32+ image match the Authenticode digest of each algorithm, that the
+  digests of an image are shared by its verification and its measurement but
+  not by the next image, and that malformed images are rejected.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <IndustryStandard/PeImage.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/BaseCryptLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PeImageDigestLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_NAME     "PeImageDigestLib Unit Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+//
+// Layout of the test images. The section headers are not in the order of the
+// raw data of the sections, and the image ends with data after the sections
+// followed by the certificate table.
+//
+#define TEST_PE_HEADER_OFFSET    0x80
+#define TEST_SIZE_OF_HEADERS     0x400
+#define TEST_DATA_OFFSET         0x400
+#define TEST_DATA_SIZE           0x1000
+#define TEST_TEXT_OFFSET         0x1400
+#define TEST_TEXT_SIZE           0x800
+#define TEST_TRAILING_OFFSET     0x1C00
+#define TEST_TRAILING_SIZE       0x38
+#define TEST_CERT_SIZE           0x100
+#define TEST_NUMBER_OF_SECTIONS  3
+
+typedef
+UINTN
+(EFIAPI *TEST_GET_CONTEXT_SIZE)(
+  VOID
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *TEST_HASH_INIT)(
+  OUT VOID  *HashContext
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *TEST_HASH_UPDATE)(
+  IN OUT VOID        *HashContext,
+  IN     CONST VOID  *Data,
+  IN     UINTN       DataSize
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *TEST_HASH_FINAL)(
+  IN OUT VOID   *HashContext,
+  OUT    UINT8  *HashValue
+  );
+
+typedef struct {
+  UINT32                   HashMask;
+  TPMI_ALG_HASH            HashAlg;
+  UINTN                    DigestSize;
+  TEST_GET_CONTEXT_SIZE    GetContextSize;
+  TEST_HASH_INIT           HashInit;
+  TEST_HASH_UPDATE         HashUpdate;
+  TEST_HASH_FINAL          HashFinal;
+} TEST_HASH;
+
+STATIC CONST TEST_HASH  mTestHash[] = {
+  { EFI_TCG2_BOOT_HASH_ALG_SHA1,    TPM_ALG_SHA1,    SHA1_DIGEST_SIZE,    Sha1GetContextSize,   Sha1Init,   Sha1Update,   Sha1Final   },
+  { EFI_TCG2_BOOT_HASH_ALG_SHA256,  TPM_ALG_SHA256,  SHA256_DIGEST_SIZE,  Sha256GetContextSize, Sha256Init, Sha256Update, Sha256Final },
+  { EFI_TCG2_BOOT_HASH_ALG_SHA384,  TPM_ALG_SHA384,  SHA384_DIGEST_SIZE,  Sha384GetContextSize, Sha384Init, Sha384Update, Sha384Final },
+  { EFI_TCG2_BOOT_HASH_ALG_SHA512,  TPM_ALG_SHA512,  SHA512_DIGEST_SIZE,  Sha512GetContextSize, Sha512Init, Sha512Update, Sha512Final },
+  { EFI_TCG2_BOOT_HASH_ALG_SM3_256, TPM_ALG_SM3_256, SM3_256_DIGEST_SIZE, Sm3GetContextSize,    Sm3Init,    Sm3Update,    Sm3Final    }
+};
+
+/**
+  Create a PE/COFF image, its headers and sections filled with a byte pattern.
+
+  @param[in]  Pe32Plus             TRUE for a PE32+ image, FALSE for a PE32 image.
+  @param[in]  NumberOfRvaAndSizes  Number of data directories. The image has a
+                                   certificate table only if it has the security
+                                   directory.
+  @param[in]  SectionScale         Factor applied to the size of the sections.
+  @param[out] ImageSize            Size of the image in bytes.
+
+  @return The image, to free with FreePool().
+**/
+STATIC
+UINT8 *
+CreateImage (
+  IN  BOOLEAN  Pe32Plus,
+  IN  UINT32   NumberOfRvaAndSizes,
+  IN  UINTN    SectionScale,
+  OUT UINTN    *ImageSize
+  )
+{
+  EFI_IMAGE_DOS_HEADER                 *DosHdr;
+  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  Hdr;
+  EFI_IMAGE_SECTION_HEADER             *Section;
+  EFI_IMAGE_DATA_DIRECTORY             *DataDirectory;
+  UINT8                                *Image;
+  UINTN                                DataSize;
+  UINTN                                TextOffset;
+  UINTN                                TextSize;
+  UINTN                                TrailingOffset;
+  UINTN                                CertOffset;
+  UINTN                                Size;
+  UINTN                                Index;
+
+  DataSize       = TEST_DATA_SIZE * SectionScale;
+  TextOffset     = TEST_DATA_OFFSET + DataSize;
+  TextSize       = TEST_TEXT_SIZE * SectionScale;
+  TrailingOffset = TextOffset + TextSize;
+  CertOffset     = TrailingOffset + TEST_TRAILING_SIZE;
+  Size           = CertOffset;
+  if (NumberOfRvaAndSizes > EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
+    Size += TEST_CERT_SIZE;
+  }
+
+  Image = AllocatePool (Size);
+  if (Image == NULL) {
+    return NULL;
+  }
+
+  for (Index = 0; Index < Size; Index++) {
+    Image[Index] = (UINT8)(Index * 31 + (Index >> 8));
+  }
+
+  DosHdr           = (EFI_IMAGE_DOS_HEADER *)Image;
+  DosHdr->e_magic  = EFI_IMAGE_DOS_SIGNATURE;
+  DosHdr->e_lfanew = TEST_PE_HEADER_OFFSET;
+
+  //
+  // The headers keep the pattern outside of the fields set, so the checksum
+  // excluded from the digests is not zero.
+  //
+  Hdr.Pe32                               = (EFI_IMAGE_NT_HEADERS32 *)(Image + TEST_PE_HEADER_OFFSET);
+  Hdr.Pe32->Signature                    = EFI_IMAGE_NT_SIGNATURE;
+  Hdr.Pe32->FileHeader.NumberOfSections  = TEST_NUMBER_OF_SECTIONS;
+  Hdr.Pe32->FileHeader.PointerToSymbolTable = 0;
+  Hdr.Pe32->FileHeader.NumberOfSymbols   = 0;
+  Hdr.Pe32->FileHeader.Characteristics   = EFI_IMAGE_FILE_EXECUTABLE_IMAGE | EFI_IMAGE_FILE_RELOCS_STRIPPED;
+  if (Pe32Plus) {
+    Hdr.Pe32Plus->FileHeader.Machine              = IMAGE_FILE_MACHINE_X64;
+    Hdr.Pe32Plus->FileHeader.SizeOfOptionalHeader = (UINT16)(OFFSET_OF (EFI_IMAGE_OPTIONAL_HEADER64, DataDirectory) +
+                                                             NumberOfRvaAndSizes * sizeof (EFI_IMAGE_DATA_DIRECTORY));
+    Hdr.Pe32Plus->OptionalHeader.Magic               = EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC;
+    Hdr.Pe32Plus->OptionalHeader.AddressOfEntryPoint = (UINT32)TextOffset;
+    Hdr.Pe32Plus->OptionalHeader.ImageBase           = 0;
+    Hdr.Pe32Plus->OptionalHeader.SectionAlignment    = 0x200;
+    Hdr.Pe32Plus->OptionalHeader.FileAlignment       = 0x200;
+    Hdr.Pe32Plus->OptionalHeader.SizeOfImage         = (UINT32)TrailingOffset;
+    Hdr.Pe32Plus->OptionalHeader.SizeOfHeaders       = TEST_SIZE_OF_HEADERS;
+    Hdr.Pe32Plus->OptionalHeader.Subsystem           = EFI_IMAGE_SUBSYSTEM_EFI_APPLICATION;
+    Hdr.Pe32Plus->OptionalHeader.NumberOfRvaAndSizes = NumberOfRvaAndSizes;
+    DataDirectory                                    = Hdr.Pe32Plus->OptionalHeader.DataDirectory;
+  } else {
+    Hdr.Pe32->FileHeader.Machine              = IMAGE_FILE_MACHINE_I386;
+    Hdr.Pe32->FileHeader.SizeOfOptionalHeader = (UINT16)(OFFSET_OF (EFI_IMAGE_OPTIONAL_HEADER32, DataDirectory) +
+                                                         NumberOfRvaAndSizes * sizeof (EFI_IMAGE_DATA_DIRECTORY));
+    Hdr.Pe32->OptionalHeader.Magic               = EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC;
+    Hdr.Pe32->OptionalHeader.AddressOfEntryPoint = (UINT32)TextOffset;
+    Hdr.Pe32->OptionalHeader.ImageBase           = 0;
+    Hdr.Pe32->OptionalHeader.SectionAlignment    = 0x200;
+    Hdr.Pe32->OptionalHeader.FileAlignment       = 0x200;
+    Hdr.Pe32->OptionalHeader.SizeOfImage         = (UINT32)TrailingOffset;
+    Hdr.Pe32->OptionalHeader.SizeOfHeaders       = TEST_SIZE_OF_HEADERS;
+    Hdr.Pe32->OptionalHeader.Subsystem           = EFI_IMAGE_SUBSYSTEM_EFI_APPLICATION;
+    Hdr.Pe32->OptionalHeader.NumberOfRvaAndSizes = NumberOfRvaAndSizes;
+    DataDirectory                                = Hdr.Pe32->OptionalHeader.DataDirectory;
+  }
+
+  ZeroMem (DataDirectory, NumberOfRvaAndSizes * sizeof (EFI_IMAGE_DATA_DIRECTORY));
+  if (NumberOfRvaAndSizes > EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
+    DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY].VirtualAddress = (UINT32)CertOffset;
+    DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY].Size           = TEST_CERT_SIZE;
+  }
+
+  Section = (EFI_IMAGE_SECTION_HEADER *)((UINT8 *)DataDirectory + NumberOfRvaAndSizes * sizeof (EFI_IMAGE_DATA_DIRECTORY));
+  ZeroMem (Section, TEST_NUMBER_OF_SECTIONS * sizeof (EFI_IMAGE_SECTION_HEADER));
+  CopyMem (Section[0].Name, ".text", 5);
+  Section[0].Misc.VirtualSize = (UINT32)TextSize;
+  Section[0].VirtualAddress   = (UINT32)TextOffset;
+  Section[0].SizeOfRawData    = (UINT32)TextSize;
+  Section[0].PointerToRawData = (UINT32)TextOffset;
+  CopyMem (Section[1].Name, ".data", 5);
+  Section[1].Misc.VirtualSize = (UINT32)DataSize;
+  Section[1].VirtualAddress   = TEST_DATA_OFFSET;
+  Section[1].SizeOfRawData    = (UINT32)DataSize;
+  Section[1].PointerToRawData = TEST_DATA_OFFSET;
+  CopyMem (Section[2].Name, ".bss", 4);
+  Section[2].Misc.VirtualSize = 0x200;
+  Section[2].VirtualAddress   = (UINT32)TrailingOffset;
+
+  *ImageSize = Size;
+  return Image;
+}
+
+/**
+  Calculate the Authenticode digest of an image for one algorithm, following
+  the steps of the Authenticode specification.
+
+  @param[in]  Hash       The hash algorithm.
+  @param[in]  Image      The image, created by CreateImage().
+  @param[in]  ImageSize  Size of the image in bytes.
+  @param[out] Digest     The digest.
+
+  @retval TRUE   The digest has been calculated.
+  @retval FALSE  The image could not be hashed.
+**/
+STATIC
+BOOLEAN
+ReferenceDigest (
+  IN  CONST TEST_HASH  *Hash,
+  IN  UINT8            *Image,
+  IN  UINTN            ImageSize,
+  OUT UINT8            *Digest
+  )
+{
+  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  Hdr;
+  EFI_IMAGE_SECTION_HEADER             *Section;
+  EFI_IMAGE_SECTION_HEADER             *SectionHeader;
+  VOID                                 *HashCtx;
+  UINT8                                *HashBase;
+  UINTN                                SumOfBytesHashed;
+  UINT32                               NumberOfRvaAndSizes;
+  UINT32                               SizeOfHeaders;
+  UINT32                               CertSize;
+  UINTN                                Index;
+  UINTN                                Pos;
+  BOOLEAN                              Status;
+
+  Hdr.Pe32 = (EFI_IMAGE_NT_HEADERS32 *)(Image + ((EFI_IMAGE_DOS_HEADER *)Image)->e_lfanew);
+  HashCtx  = AllocatePool (Hash->GetContextSize ());
+  if (HashCtx == NULL) {
+    return FALSE;
+  }
+
+  Status = Hash->HashInit (HashCtx);
+  if (Hdr.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+    NumberOfRvaAndSizes = Hdr.Pe32->OptionalHeader.NumberOfRvaAndSizes;
+    SizeOfHeaders       = Hdr.Pe32->OptionalHeader.SizeOfHeaders;
+    Status              = Status && Hash->HashUpdate (HashCtx, Image, (UINT8 *)&Hdr.Pe32->OptionalHeader.CheckSum - Image);
+    HashBase            = (UINT8 *)&Hdr.Pe32->OptionalHeader.CheckSum + sizeof (UINT32);
+    if (NumberOfRvaAndSizes > EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
+      Status   = Status && Hash->HashUpdate (HashCtx, HashBase, (UINT8 *)&Hdr.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY] - HashBase);
+      HashBase = (UINT8 *)&Hdr.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY + 1];
+      CertSize = Hdr.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY].Size;
+    } else {
+      CertSize = 0;
+    }
+  } else {
+    NumberOfRvaAndSizes = Hdr.Pe32Plus->OptionalHeader.NumberOfRvaAndSizes;
+    SizeOfHeaders       = Hdr.Pe32Plus->OptionalHeader.SizeOfHeaders;
+    Status              = Status && Hash->HashUpdate (HashCtx, Image, (UINT8 *)&Hdr.Pe32Plus->OptionalHeader.CheckSum - Image);
+    HashBase            = (UINT8 *)&Hdr.Pe32Plus->OptionalHeader.CheckSum + sizeof (UINT32);
+    if (NumberOfRvaAndSizes > EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
+      Status   = Status && Hash->HashUpdate (HashCtx, HashBase, (UINT8 *)&Hdr.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY] - HashBase);
+      HashBase = (UINT8 *)&Hdr.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY + 1];
+      CertSize = Hdr.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY].Size;
+    } else {
+      CertSize = 0;
+    }
+  }
+
+  Status = Status && Hash->HashUpdate (HashCtx, HashBase, SizeOfHeaders - (HashBase - Image));
+
+  //
+  // Hash the sections in the order of their raw data.
+  //
+  SumOfBytesHashed = SizeOfHeaders;
+  Section          = (EFI_IMAGE_SECTION_HEADER *)((UINT8 *)&Hdr.Pe32->OptionalHeader + Hdr.Pe32->FileHeader.SizeOfOptionalHeader);
+  SectionHeader    = AllocateZeroPool (sizeof (EFI_IMAGE_SECTION_HEADER) * Hdr.Pe32->FileHeader.NumberOfSections);
+  if (SectionHeader == NULL) {
+    FreePool (HashCtx);
+    return FALSE;
+  }
+
+  for (Index = 0; Index < Hdr.Pe32->FileHeader.NumberOfSections; Index++) {
+    Pos = Index;
+    while ((Pos > 0) && (Section->PointerToRawData < SectionHeader[Pos - 1].PointerToRawData)) {
+      CopyMem (&SectionHeader[Pos], &SectionHeader[Pos - 1], sizeof (EFI_IMAGE_SECTION_HEADER));
+      Pos--;
+    }
+
+    CopyMem (&SectionHeader[Pos], Section, sizeof (EFI_IMAGE_SECTION_HEADER));
+    Section += 1;
+  }
+
+  for (Index = 0; Index < Hdr.Pe32->FileHeader.NumberOfSections; Index++) {
+    if (SectionHeader[Index].SizeOfRawData == 0) {
+      continue;
+    }
+
+    Status            = Status && Hash->HashUpdate (HashCtx, Image + SectionHeader[Index].PointerToRawData, SectionHeader[Index].SizeOfRawData);
+    SumOfBytesHashed += SectionHeader[Index].SizeOfRawData;
+  }
+
+  if (ImageSize > SumOfBytesHashed) {
+    if (ImageSize < CertSize + SumOfBytesHashed) {
+      Status = FALSE;
+    } else {
+      Status = Status && Hash->HashUpdate (HashCtx, Image + SumOfBytesHashed, ImageSize - CertSize - SumOfBytesHashed);
+    }
+  }
+
+  Status = Status && Hash->HashFinal (HashCtx, Digest);
+
+  FreePool (SectionHeader);
+  FreePool (HashCtx);
+  return Status;
+}
+
+/**
+  Check the digests of all the algorithms, calculated in one walk, against the
+  digests calculated with one walk per algorithm.
+
+  @param[in]  Context  Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SinglePassMatchesSeparateWalks (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST UINT32  NumberOfRvaAndSizes[] = { EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES, EFI_IMAGE_DIRECTORY_ENTRY_SECURITY };
+  EFI_STATUS           Status;
+  TPML_DIGEST_VALUES   DigestList;
+  UINT8                Expected[sizeof (TPMU_HA)];
+  UINT8                *Digest;
+  UINT8                *Image;
+  UINTN                ImageSize;
+  UINTN                Pe32Plus;
+  UINTN                Directories;
+  UINTN                Index;
+
+  for (Pe32Plus = 0; Pe32Plus < 2; Pe32Plus++) {
+    for (Directories = 0; Directories < ARRAY_SIZE (NumberOfRvaAndSizes); Directories++) {
+      Image = CreateImage ((BOOLEAN)Pe32Plus, NumberOfRvaAndSizes[Directories], 1, &ImageSize);
+      UT_ASSERT_NOT_NULL (Image);
+
+      Status = PeImageDigestCalculate (Image, ImageSize, PE_IMAGE_DIGEST_HASH_ALG_ALL, &DigestList);
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+      UT_ASSERT_EQUAL (DigestList.count, ARRAY_SIZE (mTestHash));
+
+      for (Index = 0; Index < ARRAY_SIZE (mTestHash); Index++) {
+        UT_ASSERT_TRUE (ReferenceDigest (&mTestHash[Index], Image, ImageSize, Expected));
+        Digest = PeImageDigestFromList (&DigestList, mTestHash[Index].HashAlg);
+        UT_ASSERT_NOT_NULL (Digest);
+        UT_ASSERT_MEM_EQUAL (Digest, Expected, mTestHash[Index].DigestSize);
+      }
+
+      //
+      // One algorithm alone gives the same digest.
+      //
+      Status = PeImageDigestCalculate (Image, ImageSize, EFI_TCG2_BOOT_HASH_ALG_SHA384, &DigestList);
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+      UT_ASSERT_EQUAL (DigestList.count, 1);
+      UT_ASSERT_EQUAL (DigestList.digests[0].hashAlg, TPM_ALG_SHA384);
+      UT_ASSERT_TRUE (ReferenceDigest (&mTestHash[2], Image, ImageSize, Expected));
+      UT_ASSERT_MEM_EQUAL (&DigestList.digests[0].digest, Expected, SHA384_DIGEST_SIZE);
+
+      FreePool (Image);
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that the digests are shared by the consumers of an image, and are not
+  reused for the next image loaded at the same address.
+
+  @param[in]  Context  Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+DigestsAreSharedPerImage (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS          Status;
+  TPML_DIGEST_VALUES  DigestList;
+  UINT8               First[SHA384_DIGEST_SIZE];
+  UINT8               Expected[SHA384_DIGEST_SIZE];
+  UINT8               *Image;
+  UINTN               ImageSize;
+
+  Image = CreateImage (TRUE, EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES, 1, &ImageSize);
+  UT_ASSERT_NOT_NULL (Image);
+
+  //
+  // The verification of the image calculates the SHA-384 digest the measurement
+  // will request in the same walk.
+  //
+  PeImageDigestAddAlgorithms (EFI_TCG2_BOOT_HASH_ALG_SHA384);
+  PeImageDigestBeginImage (PE_IMAGE_DIGEST_CONSUMER_IMAGE_VERIFICATION);
+  Status = PeImageDigestGet (Image, ImageSize, EFI_TCG2_BOOT_HASH_ALG_SHA256, &DigestList);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (DigestList.count, 1);
+  UT_ASSERT_TRUE (ReferenceDigest (&mTestHash[2], Image, ImageSize, First));
+
+  //
+  // The image is not walked again for the measurement: a change of the image is
+  // not seen.
+  //
+  Image[TEST_TEXT_OFFSET] ^= 0xFF;
+  PeImageDigestBeginImage (PE_IMAGE_DIGEST_CONSUMER_TPM2_MEASURE_BOOT);
+  Status = PeImageDigestGet (Image, ImageSize, EFI_TCG2_BOOT_HASH_ALG_SHA384, &DigestList);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (DigestList.count, 1);
+  UT_ASSERT_MEM_EQUAL (&DigestList.digests[0].digest, First, SHA384_DIGEST_SIZE);
+
+  //
+  // The next image loaded in the same buffer is hashed again.
+  //
+  PeImageDigestBeginImage (PE_IMAGE_DIGEST_CONSUMER_IMAGE_VERIFICATION);
+  Status = PeImageDigestGet (Image, ImageSize, EFI_TCG2_BOOT_HASH_ALG_SHA384, &DigestList);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_TRUE (ReferenceDigest (&mTestHash[2], Image, ImageSize, Expected));
+  UT_ASSERT_MEM_EQUAL (&DigestList.digests[0].digest, Expected, SHA384_DIGEST_SIZE);
+  UT_ASSERT_FALSE (CompareMem (Expected, First, SHA384_DIGEST_SIZE) == 0);
+
+  //
+  // So is an image measured without being verified first, when the measurement of
+  // the previous image already started.
+  //
+  Image[TEST_DATA_OFFSET] ^= 0xFF;
+  PeImageDigestBeginImage (PE_IMAGE_DIGEST_CONSUMER_TPM2_MEASURE_BOOT);
+  PeImageDigestBeginImage (PE_IMAGE_DIGEST_CONSUMER_TPM2_MEASURE_BOOT);
+  Status = PeImageDigestGet (Image, ImageSize, EFI_TCG2_BOOT_HASH_ALG_SHA384, &DigestList);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_TRUE (ReferenceDigest (&mTestHash[2], Image, ImageSize, Expected));
+  UT_ASSERT_MEM_EQUAL (&DigestList.digests[0].digest, Expected, SHA384_DIGEST_SIZE);
+
+  FreePool (Image);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that malformed images are rejected.
+
+  @param[in]  Context  Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+MalformedImageIsRejected (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                           Status;
+  TPML_DIGEST_VALUES                   DigestList;
+  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  Hdr;
+  UINT8                                *Image;
+  UINTN                                ImageSize;
+
+  Image = CreateImage (TRUE, EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES, 1, &ImageSize);
+  UT_ASSERT_NOT_NULL (Image);
+  Hdr.Pe32 = (EFI_IMAGE_NT_HEADERS32 *)(Image + TEST_PE_HEADER_OFFSET);
+
+  Status = PeImageDigestCalculate (Image, ImageSize, 0, &DigestList);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_UNSUPPORTED);
+  Status = PeImageDigestCalculate (Image, ImageSize, BIT31, &DigestList);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_UNSUPPORTED);
+  Status = PeImageDigestCalculate (NULL, ImageSize, EFI_TCG2_BOOT_HASH_ALG_SHA256, &DigestList);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_INVALID_PARAMETER);
+
+  //
+  // The image is truncated in its last section.
+  //
+  Status = PeImageDigestCalculate (Image, TEST_TEXT_OFFSET + 1, EFI_TCG2_BOOT_HASH_ALG_SHA256, &DigestList);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_UNSUPPORTED);
+
+  //
+  // The certificate table overlaps the sections.
+  //
+  Hdr.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY].VirtualAddress = TEST_SIZE_OF_HEADERS;
+  Hdr.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY].Size           = (UINT32)(ImageSize - TEST_SIZE_OF_HEADERS);
+  Status                                                                                        = PeImageDigestCalculate (Image, ImageSize, EFI_TCG2_BOOT_HASH_ALG_SHA256, &DigestList);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_UNSUPPORTED);
+
+  //
+  // The image is not a PE/COFF image.
+  //
+  Hdr.Pe32->Signature = 0;
+  Status              = PeImageDigestCalculate (Image, ImageSize, EFI_TCG2_BOOT_HASH_ALG_SHA256, &DigestList);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_UNSUPPORTED);
+
+  FreePool (Image);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests and run them.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      DigestTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&DigestTests, Framework, "PeImageDigestLib Tests", "PeImageDigestLib", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for PeImageDigestLib\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (DigestTests, "One walk gives the digests of separate walks", "SinglePassMatchesSeparateWalks", SinglePassMatchesSeparateWalks, NULL, NULL, NULL);
+  AddTestCase (DigestTests, "Digests are shared by the consumers of one image", "DigestsAreSharedPerImage", DigestsAreSharedPerImage, NULL, NULL, NULL);
+  AddTestCase (DigestTests, "Malformed images are rejected", "MalformedImageIsRejected", MalformedImageIsRejected, NULL, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,499 @@
+/** @file
+  Sorted index of the signatures of an EFI_SIGNATURE_LIST database.
+
+  Caution: This module requires additional review when modified.
+  The signature database is external input, so the signature lists are validated
+  before the index references their signatures.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SignatureListIndexLib.h>
+
+typedef struct {
+  EFI_SIGNATURE_LIST    *List;
+  EFI_SIGNATURE_DATA    *Signature;
+} SIGNATURE_LIST_INDEX_ENTRY;
+
+struct _SIGNATURE_LIST_INDEX {
+  UINTN                         Count;
+  SIGNATURE_LIST_INDEX_ENTRY    Entries[1];
+};
+
+/**
+  Walk the signature lists of a database.
+
+  @param[in]  Data      The signature database.
+  @param[in]  DataSize  Size of Data in bytes.
+  @param[out] Entries   Entries to fill with the signatures, or NULL to only count them.
+  @param[out] Count     Number of signatures of the database.
+
+  @retval EFI_SUCCESS            The signature lists have been walked.
+  @retval EFI_INVALID_PARAMETER  A signature list is malformed.
+**/
+STATIC
+EFI_STATUS
+WalkSignatureLists (
+  IN  CONST UINT8                 *Data,
+  IN  UINTN                       DataSize,
+  OUT SIGNATURE_LIST_INDEX_ENTRY  *Entries OPTIONAL,
+  OUT UINTN                       *Count
+  )
+{
+  EFI_SIGNATURE_LIST  *List;
+  EFI_SIGNATURE_DATA  *Signature;
+  UINTN               SignatureCount;
+  UINTN               Index;
+
+  *Count = 0;
+  while (DataSize > 0) {
+    if (DataSize < sizeof (EFI_SIGNATURE_LIST)) {
+      return EFI_INVALID_PARAMETER;
+    }
+
+    List = (EFI_SIGNATURE_LIST *)Data;
+    if (List->SignatureListSize > DataSize) {
+      break;
+    }
+
+    if ((List->SignatureListSize < sizeof (EFI_SIGNATURE_LIST)) ||
+        (List->SignatureHeaderSize > List->SignatureListSize - sizeof (EFI_SIGNATURE_LIST)) ||
+        (List->SignatureSize < sizeof (EFI_GUID)))
+    {
+      return EFI_INVALID_PARAMETER;
+    }
+
+    SignatureCount = (List->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - List->SignatureHeaderSize) / List->SignatureSize;
+    if (Entries != NULL) {
+      Signature = (EFI_SIGNATURE_DATA *)((UINT8 *)List + sizeof (EFI_SIGNATURE_LIST) + List->SignatureHeaderSize);
+      for (Index = 0; Index < SignatureCount; Index++) {
+        Entries[*Count + Index].List      = List;
+        Entries[*Count + Index].Signature = Signature;
+        Signature                         = (EFI_SIGNATURE_DATA *)((UINT8 *)Signature + List->SignatureSize);
+      }
+    }
+
+    *Count   += SignatureCount;
+    DataSize -= List->SignatureListSize;
+    Data     += List->SignatureListSize;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Compare an entry with a signature type and a key.
+
+  @param[in]  Entry          The entry.
+  @param[in]  SignatureType  The signature type.
+  @param[in]  Key            The key.
+  @param[in]  KeySize        Size of Key in bytes.
+
+  @retval <0  The entry sorts before the signatures starting with the key.
+  @retval 0   The entry is of the type and its data starts with the key.
+  @retval >0  The entry sorts after the signatures starting with the key.
+**/
+STATIC
+INTN
+CompareEntryWithKey (
+  IN CONST SIGNATURE_LIST_INDEX_ENTRY  *Entry,
+  IN CONST EFI_GUID                    *SignatureType,
+  IN CONST VOID                        *Key,
+  IN UINTN                             KeySize
+  )
+{
+  INTN   Result;
+  UINTN  DataSize;
+
+  Result = CompareMem (&Entry->List->SignatureType, SignatureType, sizeof (EFI_GUID));
+  if (Result != 0) {
+    return Result;
+  }
+
+  DataSize = Entry->List->SignatureSize - sizeof (EFI_GUID);
+  Result   = CompareMem (Entry->Signature->SignatureData, Key, MIN (DataSize, KeySize));
+  if (Result != 0) {
+    return Result;
+  }
+
+  return (DataSize < KeySize) ? -1 : 0;
+}
+
+/**
+  Order the entries by signature type, then by signature data compared byte by byte,
+  a shorter data sorting before the longer ones it starts, then by address. The
+  signatures starting with a key are then adjacent.
+
+  @param[in]  Buffer1  The first entry.
+  @param[in]  Buffer2  The second entry.
+
+  @retval <0  Buffer1 sorts before Buffer2.
+  @retval 0   Buffer1 and Buffer2 are the same entry.
+  @retval >0  Buffer1 sorts after Buffer2.
+**/
+STATIC
+INTN
+EFIAPI
+CompareEntries (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  CONST SIGNATURE_LIST_INDEX_ENTRY  *Entry1;
+  CONST SIGNATURE_LIST_INDEX_ENTRY  *Entry2;
+  INTN                              Result;
+  UINTN                             DataSize2;
+
+  Entry1    = (CONST SIGNATURE_LIST_INDEX_ENTRY *)Buffer1;
+  Entry2    = (CONST SIGNATURE_LIST_INDEX_ENTRY *)Buffer2;
+  DataSize2 = Entry2->List->SignatureSize - sizeof (EFI_GUID);
+
+  Result = CompareEntryWithKey (Entry1, &Entry2->List->SignatureType, Entry2->Signature->SignatureData, DataSize2);
+  if (Result != 0) {
+    return Result;
+  }
+
+  if (Entry1->List->SignatureSize != Entry2->List->SignatureSize) {
+    return 1;
+  }
+
+  if (Entry1->Signature == Entry2->Signature) {
+    return 0;
+  }
+
+  return ((UINTN)Entry1->Signature < (UINTN)Entry2->Signature) ? -1 : 1;
+}
+
+/**
+  Find the first entry that does not sort before the signatures starting with a key.
+
+  @param[in]  Index          The index.
+  @param[in]  SignatureType  The signature type.
+  @param[in]  Key            The key.
+  @param[in]  KeySize        Size of Key in bytes.
+  @param[in]  Upper          FALSE to find the first entry of the signatures starting
+                             with the key, TRUE to find the entry following them.
+
+  @return The position of the entry, Index->Count if there is none.
+**/
+STATIC
+UINTN
+FindEntryBound (
+  IN SIGNATURE_LIST_INDEX  *Index,
+  IN CONST EFI_GUID        *SignatureType,
+  IN CONST VOID            *Key,
+  IN UINTN                 KeySize,
+  IN BOOLEAN               Upper
+  )
+{
+  UINTN  Low;
+  UINTN  High;
+  UINTN  Middle;
+  INTN   Result;
+
+  Low  = 0;
+  High = Index->Count;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    Result = CompareEntryWithKey (&Index->Entries[Middle], SignatureType, Key, KeySize);
+    if ((Result < 0) || (Upper && (Result == 0))) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  return Low;
+}
+
+/**
+  Create the index of a signature database.
+
+  The signature lists are walked the way the image verification does: the walk stops
+  at the first signature list whose size exceeds the remaining size of the database.
+
+  @param[in]  Data      The signature database, a sequence of EFI_SIGNATURE_LIST.
+  @param[in]  DataSize  Size of Data in bytes.
+  @param[out] Index     The index of the database. It must be freed with
+                        SignatureListIndexFree().
+
+  @retval EFI_SUCCESS            The index has been created.
+  @retval EFI_INVALID_PARAMETER  Index is NULL, or Data is NULL and DataSize is not zero.
+  @retval EFI_INVALID_PARAMETER  A signature list of the database is malformed.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to create the index.
+**/
+EFI_STATUS
+EFIAPI
+SignatureListIndexCreate (
+  IN  CONST VOID            *Data,
+  IN  UINTN                 DataSize,
+  OUT SIGNATURE_LIST_INDEX  **Index
+  )
+{
+  EFI_STATUS  Status;
+  VOID        *Buffer;
+  UINTN       BufferSize;
+
+  if (Index == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  BufferSize = 0;
+  Status     = SignatureListIndexCreateInBuffer (Data, DataSize, NULL, &BufferSize, Index);
+  if (Status != EFI_BUFFER_TOO_SMALL) {
+    return Status;
+  }
+
+  Buffer = AllocatePool (BufferSize);
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = SignatureListIndexCreateInBuffer (Data, DataSize, Buffer, &BufferSize, Index);
+  ASSERT_EFI_ERROR (Status);
+  return Status;
+}
+
+/**
+  Create the index of a signature database in a buffer of the caller, for callers
+  that cannot allocate memory, such as runtime services.
+
+  @param[in]      Data        The signature database, a sequence of EFI_SIGNATURE_LIST.
+  @param[in]      DataSize    Size of Data in bytes.
+  @param[in]      Buffer      Buffer to create the index in, aligned on a UINTN.
+  @param[in, out] BufferSize  On input, the size of Buffer in bytes. On output, the size
+                              of the index.
+  @param[out]     Index       The index of the database, at the start of Buffer. It must
+                              not be freed with SignatureListIndexFree().
+
+  @retval EFI_SUCCESS            The index has been created.
+  @retval EFI_BUFFER_TOO_SMALL   Buffer is too small. BufferSize has been updated with
+                                 the size needed.
+  @retval EFI_INVALID_PARAMETER  BufferSize or Index is NULL, Data is NULL and DataSize is
+                                 not zero, or Buffer is not aligned.
+  @retval EFI_INVALID_PARAMETER  A signature list of the database is malformed.
+  @retval EFI_OUT_OF_RESOURCES   The index of the database would not fit in memory.
+**/
+EFI_STATUS
+EFIAPI
+SignatureListIndexCreateInBuffer (
+  IN     CONST VOID            *Data,
+  IN     UINTN                 DataSize,
+  IN     VOID                  *Buffer,
+  IN OUT UINTN                 *BufferSize,
+  OUT    SIGNATURE_LIST_INDEX  **Index
+  )
+{
+  EFI_STATUS                  Status;
+  SIGNATURE_LIST_INDEX        *NewIndex;
+  SIGNATURE_LIST_INDEX_ENTRY  Scratch;
+  UINTN                       Count;
+  UINTN                       IndexSize;
+
+  if ((BufferSize == NULL) || (Index == NULL) || ((Data == NULL) && (DataSize != 0)) ||
+      (((UINTN)Buffer & (sizeof (UINTN) - 1)) != 0))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = WalkSignatureLists (Data, DataSize, NULL, &Count);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (Count > (MAX_UINTN - sizeof (SIGNATURE_LIST_INDEX)) / sizeof (SIGNATURE_LIST_INDEX_ENTRY)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  IndexSize = sizeof (SIGNATURE_LIST_INDEX) + Count * sizeof (SIGNATURE_LIST_INDEX_ENTRY);
+  if ((Buffer == NULL) || (*BufferSize < IndexSize)) {
+    *BufferSize = IndexSize;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  NewIndex = (SIGNATURE_LIST_INDEX *)Buffer;
+  WalkSignatureLists (Data, DataSize, NewIndex->Entries, &NewIndex->Count);
+  ASSERT (NewIndex->Count == Count);
+
+  if (Count > 1) {
+    QuickSort (NewIndex->Entries, Count, sizeof (SIGNATURE_LIST_INDEX_ENTRY), CompareEntries, &Scratch);
+  }
+
+  *BufferSize = IndexSize;
+  *Index      = NewIndex;
+  return EFI_SUCCESS;
+}
+
+/**
+  Free an index created by SignatureListIndexCreate(). The database is not freed.
+
+  @param[in]  Index  The index to free. NULL is ignored.
+**/
+VOID
+EFIAPI
+SignatureListIndexFree (
+  IN SIGNATURE_LIST_INDEX  *Index
+  )
+{
+  if (Index != NULL) {
+    FreePool (Index);
+  }
+}
+
+/**
+  Find a signature whose data starts with a key.
+
+  When several signatures match, the first one in the order of the database is
+  returned, which is the one a walk of the signature lists would find.
+
+  @param[in]  Index          The index of the database.
+  @param[in]  SignatureType  Type of the signature list to search.
+  @param[in]  SignatureSize  SignatureSize of the signature list to search, including
+                             the owner GUID, or zero to search the lists of any size.
+  @param[in]  Key            Bytes the signature data starts with.
+  @param[in]  KeySize        Size of Key in bytes.
+  @param[out] SignatureList  The signature list of the signature found. OPTIONAL
+
+  @return The signature found, or NULL if no signature matches.
+**/
+EFI_SIGNATURE_DATA *
+EFIAPI
+SignatureListIndexFind (
+  IN  SIGNATURE_LIST_INDEX  *Index,
+  IN  CONST EFI_GUID        *SignatureType,
+  IN  UINTN                 SignatureSize,
+  IN  CONST VOID            *Key,
+  IN  UINTN                 KeySize,
+  OUT EFI_SIGNATURE_LIST    **SignatureList OPTIONAL
+  )
+{
+  SIGNATURE_LIST_INDEX_ENTRY  *Found;
+  UINTN                       Position;
+
+  if ((Index == NULL) || (SignatureType == NULL) || ((Key == NULL) && (KeySize != 0))) {
+    return NULL;
+  }
+
+  //
+  // The signatures starting with the key are adjacent, sorted by data before address,
+  // so the whole run is scanned for the lowest address. The run is one signature
+  // unless the key is shorter than the data or the database has duplicates.
+  //
+  Found = NULL;
+  for (Position = FindEntryBound (Index, SignatureType, Key, KeySize, FALSE);
+       Position < Index->Count;
+       Position++)
+  {
+    if (CompareEntryWithKey (&Index->Entries[Position], SignatureType, Key, KeySize) != 0) {
+      break;
+    }
+
+    if ((SignatureSize != 0) && (Index->Entries[Position].List->SignatureSize != SignatureSize)) {
+      continue;
+    }
+
+    if ((Found == NULL) || ((UINTN)Index->Entries[Position].Signature < (UINTN)Found->Signature)) {
+      Found = &Index->Entries[Position];
+    }
+  }
+
+  if (Found == NULL) {
+    return NULL;
+  }
+
+  if (SignatureList != NULL) {
+    *SignatureList = Found->List;
+  }
+
+  return Found->Signature;
+}
+
+/**
+  Find a signature, owner included.
+
+  This is the comparison the signature lists of a database are deduplicated with when
+  EFI_SIGNATURE_DATA are appended to it: the same type, the same SignatureSize and the
+  same bytes from SignatureOwner on.
+
+  @param[in]  Index          The index of the database.
+  @param[in]  SignatureType  Type of the signature list of the signature.
+  @param[in]  SignatureSize  SignatureSize of the signature list of the signature.
+  @param[in]  Signature      The signature to find.
+
+  @return The signature found, or NULL if the database does not have the signature.
+**/
+EFI_SIGNATURE_DATA *
+EFIAPI
+SignatureListIndexFindSignature (
+  IN SIGNATURE_LIST_INDEX      *Index,
+  IN CONST EFI_GUID            *SignatureType,
+  IN UINTN                     SignatureSize,
+  IN CONST EFI_SIGNATURE_DATA  *Signature
+  )
+{
+  SIGNATURE_LIST_INDEX_ENTRY  *Entry;
+  UINTN                       Position;
+  UINTN                       DataSize;
+
+  if ((Index == NULL) || (SignatureType == NULL) || (Signature == NULL) || (SignatureSize < sizeof (EFI_GUID))) {
+    return NULL;
+  }
+
+  //
+  // The signatures with the same data differ by owner, or by size when the data of
+  // one starts with the data of another. All are adjacent.
+  //
+  DataSize = SignatureSize - sizeof (EFI_GUID);
+  for (Position = FindEntryBound (Index, SignatureType, Signature->SignatureData, DataSize, FALSE);
+       Position < Index->Count;
+       Position++)
+  {
+    Entry = &Index->Entries[Position];
+    if (CompareEntryWithKey (Entry, SignatureType, Signature->SignatureData, DataSize) != 0) {
+      break;
+    }
+
+    if ((Entry->List->SignatureSize == SignatureSize) &&
+        CompareGuid (&Entry->Signature->SignatureOwner, &Signature->SignatureOwner))
+    {
+      return Entry->Signature;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Get the number of signatures of the database, or of one type of signature.
+
+  @param[in]  Index          The index of the database.
+  @param[in]  SignatureType  Type of the signatures to count, or NULL to count all
+                             the signatures. OPTIONAL
+
+  @return The number of signatures.
+**/
+UINTN
+EFIAPI
+SignatureListIndexCount (
+  IN SIGNATURE_LIST_INDEX  *Index,
+  IN CONST EFI_GUID        *SignatureType OPTIONAL
+  )
+{
+  if (Index == NULL) {
+    return 0;
+  }
+
+  if (SignatureType == NULL) {
+    return Index->Count;
+  }
+
+  return FindEntryBound (Index, SignatureType, NULL, 0, TRUE) -
+         FindEntryBound (Index, SignatureType, NULL, 0, FALSE);
+}
@@ -0,0 +1,548 @@
+/** @file
+  Unit tests of BaseSignatureListIndexLib.
+
+  They check that an index of a database of 1,000 SHA-256 hashes finds the same
+  signatures as a linear search of its signature lists, that a signature present
+  in several lists is found in the first one, that malformed signature lists are
+  rejected, and that an index built in a buffer of the caller finds signatures
+  by owner.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Guid/ImageAuthentication.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SignatureListIndexLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_NAME     "SignatureListIndexLib Unit Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+//
+// Number of hashes of a signature list of the test databases.
+//
+#define HASHES_PER_LIST  64
+
+#define SHA256_DIGEST_SIZE          32
+#define SHA256_SIGNATURE_SIZE       (sizeof (EFI_GUID) + SHA256_DIGEST_SIZE)
+#define X509_SHA256_SIGNATURE_SIZE  (sizeof (EFI_GUID) + SHA256_DIGEST_SIZE + sizeof (EFI_TIME))
+
+STATIC UINT64  mRandomState;
+
+/**
+  Fill a buffer with pseudo-random bytes.
+
+  @param[out] Buffer  The buffer.
+  @param[in]  Size    Size of Buffer in bytes.
+**/
+STATIC
+VOID
+FillRandom (
+  OUT UINT8  *Buffer,
+  IN  UINTN  Size
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Size; Index++) {
+    mRandomState ^= LShiftU64 (mRandomState, 13);
+    mRandomState ^= RShiftU64 (mRandomState, 7);
+    mRandomState ^= LShiftU64 (mRandomState, 17);
+    Buffer[Index] = (UINT8)mRandomState;
+  }
+}
+
+/**
+  Append a signature list to a database.
+
+  @param[in, out] Database       The database.
+  @param[in]      DatabaseSize   Size of the database in bytes.
+  @param[in]      SignatureType  Type of the list.
+  @param[in]      SignatureSize  Size of a signature of the list.
+  @param[in]      Count          Number of signatures of the list, filled with
+                                 pseudo-random data.
+
+  @return The new size of the database.
+**/
+STATIC
+UINTN
+AppendSignatureList (
+  IN OUT UINT8           *Database,
+  IN     UINTN           DatabaseSize,
+  IN     CONST EFI_GUID  *SignatureType,
+  IN     UINTN           SignatureSize,
+  IN     UINTN           Count
+  )
+{
+  EFI_SIGNATURE_LIST  *List;
+
+  List = (EFI_SIGNATURE_LIST *)(Database + DatabaseSize);
+  CopyGuid (&List->SignatureType, SignatureType);
+  List->SignatureHeaderSize = 0;
+  List->SignatureSize       = (UINT32)SignatureSize;
+  List->SignatureListSize   = (UINT32)(sizeof (EFI_SIGNATURE_LIST) + Count * SignatureSize);
+  FillRandom ((UINT8 *)(List + 1), Count * SignatureSize);
+
+  return DatabaseSize + List->SignatureListSize;
+}
+
+/**
+  Create a dbx-like database of SHA-256 hashes.
+
+  @param[in]  HashCount     Number of hashes.
+  @param[out] DatabaseSize  Size of the database in bytes.
+
+  @return The database, to free with FreePool().
+**/
+STATIC
+UINT8 *
+CreateHashDatabase (
+  IN  UINTN  HashCount,
+  OUT UINTN  *DatabaseSize
+  )
+{
+  UINT8  *Database;
+  UINTN  ListCount;
+  UINTN  Index;
+
+  ListCount = (HashCount + HASHES_PER_LIST - 1) / HASHES_PER_LIST;
+  Database  = AllocatePool (ListCount * sizeof (EFI_SIGNATURE_LIST) + HashCount * SHA256_SIGNATURE_SIZE);
+  if (Database == NULL) {
+    return NULL;
+  }
+
+  *DatabaseSize = 0;
+  for (Index = 0; Index < HashCount; Index += HASHES_PER_LIST) {
+    *DatabaseSize = AppendSignatureList (
+                      Database,
+                      *DatabaseSize,
+                      &gEfiCertSha256Guid,
+                      SHA256_SIGNATURE_SIZE,
+                      MIN (HASHES_PER_LIST, HashCount - Index)
+                      );
+  }
+
+  return Database;
+}
+
+/**
+  Find a signature with a linear search of the signature lists of a database.
+
+  @param[in]  Database       The database.
+  @param[in]  DatabaseSize   Size of the database in bytes.
+  @param[in]  SignatureType  Type of the signature list to search.
+  @param[in]  SignatureSize  SignatureSize of the lists to search, zero for any size.
+  @param[in]  Key            Bytes the signature data starts with.
+  @param[in]  KeySize        Size of Key in bytes.
+
+  @return The first signature found, or NULL.
+**/
+STATIC
+EFI_SIGNATURE_DATA *
+WalkAndFind (
+  IN CONST UINT8     *Database,
+  IN UINTN           DatabaseSize,
+  IN CONST EFI_GUID  *SignatureType,
+  IN UINTN           SignatureSize,
+  IN CONST UINT8     *Key,
+  IN UINTN           KeySize
+  )
+{
+  EFI_SIGNATURE_LIST  *List;
+  EFI_SIGNATURE_DATA  *Signature;
+  UINTN               Count;
+  UINTN               Index;
+
+  List = (EFI_SIGNATURE_LIST *)Database;
+  while ((DatabaseSize > 0) && (DatabaseSize >= List->SignatureListSize)) {
+    if (CompareGuid (&List->SignatureType, SignatureType) &&
+        ((SignatureSize == 0) || (List->SignatureSize == SignatureSize)) &&
+        (List->SignatureSize - sizeof (EFI_GUID) >= KeySize))
+    {
+      Count     = (List->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - List->SignatureHeaderSize) / List->SignatureSize;
+      Signature = (EFI_SIGNATURE_DATA *)((UINT8 *)List + sizeof (EFI_SIGNATURE_LIST) + List->SignatureHeaderSize);
+      for (Index = 0; Index < Count; Index++) {
+        if (CompareMem (Signature->SignatureData, Key, KeySize) == 0) {
+          return Signature;
+        }
+
+        Signature = (EFI_SIGNATURE_DATA *)((UINT8 *)Signature + List->SignatureSize);
+      }
+    }
+
+    DatabaseSize -= List->SignatureListSize;
+    List          = (EFI_SIGNATURE_LIST *)((UINT8 *)List + List->SignatureListSize);
+  }
+
+  return NULL;
+}
+
+/**
+  Fill the keys of the lookups of a database: the hashes of the database, one in two,
+  and hashes that are not in the database.
+
+  @param[in]  Database      The database.
+  @param[in]  HashCount     Number of hashes of the database.
+  @param[out] Keys          The keys.
+  @param[in]  KeyCount      Number of keys.
+**/
+STATIC
+VOID
+FillLookupKeys (
+  IN  CONST UINT8  *Database,
+  IN  UINTN        HashCount,
+  OUT UINT8        *Keys,
+  IN  UINTN        KeyCount
+  )
+{
+  CONST EFI_SIGNATURE_LIST  *List;
+  CONST EFI_SIGNATURE_DATA  *Signature;
+  UINTN                     Hash;
+  UINTN                     Index;
+
+  for (Index = 0; Index < KeyCount; Index++) {
+    if ((Index % 2) == 0) {
+      FillRandom (&Keys[Index * SHA256_DIGEST_SIZE], SHA256_DIGEST_SIZE);
+      continue;
+    }
+
+    Hash      = (Index / 2) % HashCount;
+    List      = (CONST EFI_SIGNATURE_LIST *)(Database + (Hash / HASHES_PER_LIST) * (sizeof (EFI_SIGNATURE_LIST) + HASHES_PER_LIST * SHA256_SIGNATURE_SIZE));
+    Signature = (CONST EFI_SIGNATURE_DATA *)((UINT8 *)(List + 1) + (Hash % HASHES_PER_LIST) * SHA256_SIGNATURE_SIZE);
+    CopyMem (&Keys[Index * SHA256_DIGEST_SIZE], Signature->SignatureData, SHA256_DIGEST_SIZE);
+  }
+}
+
+/**
+  Every hash of a database, and hashes that are not in it, are found by the index
+  as they are by a walk of the signature lists.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  The lookups matched.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+FindMatchesWalk (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS            Status;
+  SIGNATURE_LIST_INDEX  *Index;
+  UINT8                 *Database;
+  UINTN                 DatabaseSize;
+  UINT8                 *Keys;
+  UINTN                 Key;
+
+  mRandomState = 0x5EED0001;
+  Database     = CreateHashDatabase (1000, &DatabaseSize);
+  UT_ASSERT_NOT_NULL (Database);
+  Keys = AllocatePool (2000 * SHA256_DIGEST_SIZE);
+  UT_ASSERT_NOT_NULL (Keys);
+  FillLookupKeys (Database, 1000, Keys, 2000);
+
+  Status = SignatureListIndexCreate (Database, DatabaseSize, &Index);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (SignatureListIndexCount (Index, NULL), 1000);
+  UT_ASSERT_EQUAL (SignatureListIndexCount (Index, &gEfiCertSha256Guid), 1000);
+  UT_ASSERT_EQUAL (SignatureListIndexCount (Index, &gEfiCertX509Sha256Guid), 0);
+
+  for (Key = 0; Key < 2000; Key++) {
+    UT_ASSERT_EQUAL (
+      (UINTN)SignatureListIndexFind (Index, &gEfiCertSha256Guid, SHA256_SIGNATURE_SIZE, &Keys[Key * SHA256_DIGEST_SIZE], SHA256_DIGEST_SIZE, NULL),
+      (UINTN)WalkAndFind (Database, DatabaseSize, &gEfiCertSha256Guid, SHA256_SIGNATURE_SIZE, &Keys[Key * SHA256_DIGEST_SIZE], SHA256_DIGEST_SIZE)
+      );
+    UT_ASSERT_EQUAL (
+      (UINTN)SignatureListIndexFind (Index, &gEfiCertSha384Guid, 0, &Keys[Key * SHA256_DIGEST_SIZE], SHA256_DIGEST_SIZE, NULL),
+      0
+      );
+  }
+
+  SignatureListIndexFree (Index);
+  FreePool (Keys);
+  FreePool (Database);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A signature in several lists is found in the first list, with its own signature
+  list, and the lists of another size or type are not searched.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  The first signature was found.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+FindReturnsFirstInDatabaseOrder (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS            Status;
+  SIGNATURE_LIST_INDEX  *Index;
+  UINT8                 Database[4096];
+  UINTN                 DatabaseSize;
+  EFI_SIGNATURE_LIST    *Lists[4];
+  EFI_SIGNATURE_DATA    *Signatures[4];
+  EFI_SIGNATURE_LIST    *FoundList;
+  UINT8                 Digest[SHA256_DIGEST_SIZE];
+  UINTN                 Position;
+
+  mRandomState = 0x5EED0002;
+  FillRandom (Digest, sizeof (Digest));
+
+  //
+  // The digest is the third hash of a SHA-256 list, the first of a certificate hash
+  // list, the last of a second SHA-256 list, and the start of a longer SHA-256 list.
+  //
+  DatabaseSize = 0;
+  Lists[0]     = (EFI_SIGNATURE_LIST *)&Database[DatabaseSize];
+  DatabaseSize = AppendSignatureList (Database, DatabaseSize, &gEfiCertSha256Guid, SHA256_SIGNATURE_SIZE + 16, 4);
+  Lists[1]     = (EFI_SIGNATURE_LIST *)&Database[DatabaseSize];
+  DatabaseSize = AppendSignatureList (Database, DatabaseSize, &gEfiCertSha256Guid, SHA256_SIGNATURE_SIZE, 8);
+  Lists[2]     = (EFI_SIGNATURE_LIST *)&Database[DatabaseSize];
+  DatabaseSize = AppendSignatureList (Database, DatabaseSize, &gEfiCertX509Sha256Guid, X509_SHA256_SIGNATURE_SIZE, 2);
+  Lists[3]     = (EFI_SIGNATURE_LIST *)&Database[DatabaseSize];
+  DatabaseSize = AppendSignatureList (Database, DatabaseSize, &gEfiCertSha256Guid, SHA256_SIGNATURE_SIZE, 5);
+
+  Signatures[0] = (EFI_SIGNATURE_DATA *)(Lists[0] + 1);
+  Signatures[1] = (EFI_SIGNATURE_DATA *)((UINT8 *)(Lists[1] + 1) + 2 * SHA256_SIGNATURE_SIZE);
+  Signatures[2] = (EFI_SIGNATURE_DATA *)(Lists[2] + 1);
+  Signatures[3] = (EFI_SIGNATURE_DATA *)((UINT8 *)(Lists[3] + 1) + 4 * SHA256_SIGNATURE_SIZE);
+  for (Position = 0; Position < ARRAY_SIZE (Signatures); Position++) {
+    CopyMem (Signatures[Position]->SignatureData, Digest, sizeof (Digest));
+  }
+
+  Status = SignatureListIndexCreate (Database, DatabaseSize, &Index);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (SignatureListIndexCount (Index, &gEfiCertSha256Guid), 17);
+  UT_ASSERT_EQUAL (SignatureListIndexCount (Index, &gEfiCertX509Sha256Guid), 2);
+
+  FoundList = NULL;
+  UT_ASSERT_EQUAL ((UINTN)SignatureListIndexFind (Index, &gEfiCertSha256Guid, SHA256_SIGNATURE_SIZE, Digest, sizeof (Digest), &FoundList), (UINTN)Signatures[1]);
+  UT_ASSERT_EQUAL ((UINTN)FoundList, (UINTN)Lists[1]);
+  UT_ASSERT_EQUAL ((UINTN)SignatureListIndexFind (Index, &gEfiCertSha256Guid, 0, Digest, sizeof (Digest), &FoundList), (UINTN)Signatures[0]);
+  UT_ASSERT_EQUAL ((UINTN)FoundList, (UINTN)Lists[0]);
+  UT_ASSERT_EQUAL ((UINTN)SignatureListIndexFind (Index, &gEfiCertX509Sha256Guid, 0, Digest, sizeof (Digest), &FoundList), (UINTN)Signatures[2]);
+  UT_ASSERT_EQUAL ((UINTN)FoundList, (UINTN)Lists[2]);
+
+  //
+  // The key is longer than the data of the lists of hashes.
+  //
+  UT_ASSERT_EQUAL ((UINTN)SignatureListIndexFind (Index, &gEfiCertSha256Guid, 0, Lists[0] + 1, SHA256_SIGNATURE_SIZE + 16, NULL), 0);
+
+  SignatureListIndexFree (Index);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Malformed signature lists are rejected, and the walk stops at a signature list
+  larger than the rest of the database.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  The malformed databases were handled.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+MalformedDatabaseIsRejected (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS            Status;
+  SIGNATURE_LIST_INDEX  *Index;
+  UINT8                 Database[1024];
+  UINTN                 DatabaseSize;
+  EFI_SIGNATURE_LIST    *List;
+
+  mRandomState = 0x5EED0003;
+  List         = (EFI_SIGNATURE_LIST *)Database;
+
+  Status = SignatureListIndexCreate (NULL, 0, &Index);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (SignatureListIndexCount (Index, NULL), 0);
+  UT_ASSERT_EQUAL ((UINTN)SignatureListIndexFind (Index, &gEfiCertSha256Guid, 0, Database, SHA256_DIGEST_SIZE, NULL), 0);
+  SignatureListIndexFree (Index);
+
+  UT_ASSERT_STATUS_EQUAL (SignatureListIndexCreate (NULL, 1, &Index), EFI_INVALID_PARAMETER);
+
+  //
+  // A list larger than the database is ignored, a tail smaller than a list header
+  // is malformed.
+  //
+  DatabaseSize = AppendSignatureList (Database, 0, &gEfiCertSha256Guid, SHA256_SIGNATURE_SIZE, 2);
+  Status       = SignatureListIndexCreate (Database, DatabaseSize - 1, &Index);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (SignatureListIndexCount (Index, NULL), 0);
+  SignatureListIndexFree (Index);
+
+  UT_ASSERT_STATUS_EQUAL (SignatureListIndexCreate (Database, DatabaseSize + 1, &Index), EFI_INVALID_PARAMETER);
+
+  List->SignatureSize = sizeof (EFI_GUID) - 1;
+  UT_ASSERT_STATUS_EQUAL (SignatureListIndexCreate (Database, DatabaseSize, &Index), EFI_INVALID_PARAMETER);
+
+  List->SignatureSize     = SHA256_SIGNATURE_SIZE;
+  List->SignatureListSize = sizeof (EFI_SIGNATURE_LIST) - 1;
+  UT_ASSERT_STATUS_EQUAL (SignatureListIndexCreate (Database, DatabaseSize, &Index), EFI_INVALID_PARAMETER);
+
+  List->SignatureListSize   = (UINT32)DatabaseSize;
+  List->SignatureHeaderSize = (UINT32)DatabaseSize;
+  UT_ASSERT_STATUS_EQUAL (SignatureListIndexCreate (Database, DatabaseSize, &Index), EFI_INVALID_PARAMETER);
+
+  //
+  // The walk stops at a second list larger than the rest of the database.
+  //
+  List->SignatureHeaderSize = 0;
+  DatabaseSize              = AppendSignatureList (Database, DatabaseSize, &gEfiCertSha256Guid, SHA256_SIGNATURE_SIZE, 3);
+  Status                    = SignatureListIndexCreate (Database, DatabaseSize - 1, &Index);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (SignatureListIndexCount (Index, NULL), 2);
+  SignatureListIndexFree (Index);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  An index created in a buffer of the caller finds signatures by data and owner, and
+  a buffer too small is reported with the size needed.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  The signatures were found.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+FindSignatureInBuffer (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS            Status;
+  SIGNATURE_LIST_INDEX  *Index;
+  UINT8                 Database[1024];
+  UINTN                 DatabaseSize;
+  UINTN                 Buffer[64];
+  UINTN                 BufferSize;
+  EFI_SIGNATURE_LIST    *Lists[2];
+  EFI_SIGNATURE_DATA    *Signature;
+  UINT8                 Copy[SHA256_SIGNATURE_SIZE + 16];
+
+  mRandomState = 0x5EED0004;
+  DatabaseSize = 0;
+  Lists[0]     = (EFI_SIGNATURE_LIST *)&Database[DatabaseSize];
+  DatabaseSize = AppendSignatureList (Database, DatabaseSize, &gEfiCertSha256Guid, SHA256_SIGNATURE_SIZE, 4);
+  Lists[1]     = (EFI_SIGNATURE_LIST *)&Database[DatabaseSize];
+  DatabaseSize = AppendSignatureList (Database, DatabaseSize, &gEfiCertSha256Guid, SHA256_SIGNATURE_SIZE + 16, 2);
+
+  BufferSize = 0;
+  UT_ASSERT_STATUS_EQUAL (SignatureListIndexCreateInBuffer (Database, DatabaseSize, NULL, &BufferSize, &Index), EFI_BUFFER_TOO_SMALL);
+  UT_ASSERT_TRUE (BufferSize > 6 * sizeof (VOID *));
+  UT_ASSERT_TRUE (BufferSize <= sizeof (Buffer));
+  BufferSize--;
+  UT_ASSERT_STATUS_EQUAL (SignatureListIndexCreateInBuffer (Database, DatabaseSize, Buffer, &BufferSize, &Index), EFI_BUFFER_TOO_SMALL);
+  UT_ASSERT_STATUS_EQUAL (SignatureListIndexCreateInBuffer (Database, DatabaseSize, (UINT8 *)Buffer + 1, &BufferSize, &Index), EFI_INVALID_PARAMETER);
+
+  Status = SignatureListIndexCreateInBuffer (Database, DatabaseSize, Buffer, &BufferSize, &Index);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL ((UINTN)Index, (UINTN)Buffer);
+  UT_ASSERT_EQUAL (SignatureListIndexCount (Index, NULL), 6);
+
+  //
+  // The third hash is found, but not with another owner, another size or another type.
+  //
+  Signature = (EFI_SIGNATURE_DATA *)((UINT8 *)(Lists[0] + 1) + 2 * SHA256_SIGNATURE_SIZE);
+  CopyMem (Copy, Signature, SHA256_SIGNATURE_SIZE);
+  UT_ASSERT_EQUAL ((UINTN)SignatureListIndexFindSignature (Index, &gEfiCertSha256Guid, SHA256_SIGNATURE_SIZE, (EFI_SIGNATURE_DATA *)Copy), (UINTN)Signature);
+  UT_ASSERT_EQUAL ((UINTN)SignatureListIndexFindSignature (Index, &gEfiCertSha384Guid, SHA256_SIGNATURE_SIZE, (EFI_SIGNATURE_DATA *)Copy), 0);
+  Copy[0] ^= 1;
+  UT_ASSERT_EQUAL ((UINTN)SignatureListIndexFindSignature (Index, &gEfiCertSha256Guid, SHA256_SIGNATURE_SIZE, (EFI_SIGNATURE_DATA *)Copy), 0);
+
+  //
+  // The longer signature is found with its own size only.
+  //
+  Signature = (EFI_SIGNATURE_DATA *)((UINT8 *)(Lists[1] + 1) + SHA256_SIGNATURE_SIZE + 16);
+  CopyMem (Copy, Signature, sizeof (Copy));
+  UT_ASSERT_EQUAL ((UINTN)SignatureListIndexFindSignature (Index, &gEfiCertSha256Guid, sizeof (Copy), (EFI_SIGNATURE_DATA *)Copy), (UINTN)Signature);
+  UT_ASSERT_EQUAL ((UINTN)SignatureListIndexFindSignature (Index, &gEfiCertSha256Guid, SHA256_SIGNATURE_SIZE, (EFI_SIGNATURE_DATA *)Copy), 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests and run them.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      IndexTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&IndexTests, Framework, "SignatureListIndexLib Tests", "SignatureListIndexLib", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for SignatureListIndexLib\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (IndexTests, "Lookups match a walk of the signature lists", "FindMatchesWalk", FindMatchesWalk, NULL, NULL, NULL);
+  AddTestCase (IndexTests, "Lookups return the first signature of the database", "FindReturnsFirstInDatabaseOrder", FindReturnsFirstInDatabaseOrder, NULL, NULL, NULL);
+  AddTestCase (IndexTests, "Malformed signature lists are rejected", "MalformedDatabaseIsRejected", MalformedDatabaseIsRejected, NULL, NULL, NULL);
+  AddTestCase (IndexTests, "Signatures are found by owner in an index in a buffer", "FindSignatureInBuffer", FindSignatureInBuffer, NULL, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
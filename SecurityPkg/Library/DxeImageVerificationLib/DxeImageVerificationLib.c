@@ -9,8 +9,9 @@
   DxeImageVerificationLibImageRead() function will make sure the PE/COFF image content
   read is within the image buffer.
 
-  DxeImageVerificationHandler(), HashPeImageByType(), HashPeImage() function will accept
-  untrusted PE/COFF image and validate its data structure within this image buffer before use.
+  DxeImageVerificationHandler(), CheckImageHeaders(), HashPeImageByType(), HashPeImage()
+  function will accept untrusted PE/COFF image and validate its data structure within this
+  image buffer before use.
 
 Copyright (c) 2009 - 2018, Intel Corporation. All rights reserved.<BR>
 (C) Copyright 2016 Hewlett Packard Enterprise Development LP<BR>
@@ -71,6 +72,13 @@ HASH_TABLE  mHash[] = {
 
 EFI_STRING  mHashTypeStr;
 
+//
+// Allowed and forbidden databases, read for each image and indexed again only
+// when they change.
+//
+IMAGE_SECURITY_DATABASE  mDb  = { EFI_IMAGE_SECURITY_DATABASE, NULL, 0, NULL, EFI_NOT_FOUND };
+IMAGE_SECURITY_DATABASE  mDbx = { EFI_IMAGE_SECURITY_DATABASE1, NULL, 0, NULL, EFI_NOT_FOUND };
+
 /**
   SecureBoot Hook for processing image verification.
 
@@ -138,6 +146,78 @@ DxeImageVerificationLibImageRead (
   return EFI_SUCCESS;
 }
 
+/**
+  Check that the PE header, the data directories and the section table of the
+  current PE/COFF image are within its headers.
+
+  Caution: This function may receive untrusted input.
+  PE/COFF image is external input, so this function will validate its data structure
+  within the headers before use.
+
+  @param[in]  Headers      The headers of the image.
+  @param[in]  HeadersSize  Size of the headers in bytes, SizeOfHeaders.
+
+  @retval TRUE   The PE header, the data directories and the section table are within
+                 the headers.
+  @retval FALSE  The headers are malformed.
+**/
+BOOLEAN
+CheckImageHeaders (
+  IN CONST UINT8  *Headers,
+  IN UINTN        HeadersSize
+  )
+{
+  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  Hdr;
+  UINTN                                DataDirectoryOffset;
+  UINT32                               NumberOfRvaAndSizes;
+  UINTN                                SectionTableOffset;
+
+  if ((mPeCoffHeaderOffset > HeadersSize) ||
+      (HeadersSize - mPeCoffHeaderOffset < OFFSET_OF (EFI_IMAGE_NT_HEADERS32, OptionalHeader.MajorLinkerVersion)))
+  {
+    return FALSE;
+  }
+
+  Hdr.Pe32 = (EFI_IMAGE_NT_HEADERS32 *)(Headers + mPeCoffHeaderOffset);
+  if (Hdr.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+    DataDirectoryOffset = OFFSET_OF (EFI_IMAGE_NT_HEADERS32, OptionalHeader.DataDirectory);
+  } else if (Hdr.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC) {
+    DataDirectoryOffset = OFFSET_OF (EFI_IMAGE_NT_HEADERS64, OptionalHeader.DataDirectory);
+  } else {
+    return FALSE;
+  }
+
+  if (HeadersSize - mPeCoffHeaderOffset < DataDirectoryOffset) {
+    return FALSE;
+  }
+
+  if (Hdr.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+    NumberOfRvaAndSizes = Hdr.Pe32->OptionalHeader.NumberOfRvaAndSizes;
+  } else {
+    NumberOfRvaAndSizes = Hdr.Pe32Plus->OptionalHeader.NumberOfRvaAndSizes;
+  }
+
+  //
+  // The data directories are in the optional header, and the section table follows it.
+  //
+  if ((NumberOfRvaAndSizes > EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES) ||
+      (OFFSET_OF (EFI_IMAGE_NT_HEADERS32, OptionalHeader) + Hdr.Pe32->FileHeader.SizeOfOptionalHeader <
+       DataDirectoryOffset + NumberOfRvaAndSizes * sizeof (EFI_IMAGE_DATA_DIRECTORY)))
+  {
+    return FALSE;
+  }
+
+  SectionTableOffset = mPeCoffHeaderOffset + OFFSET_OF (EFI_IMAGE_NT_HEADERS32, OptionalHeader) +
+                       Hdr.Pe32->FileHeader.SizeOfOptionalHeader;
+  if ((SectionTableOffset > HeadersSize) ||
+      (Hdr.Pe32->FileHeader.NumberOfSections > (HeadersSize - SectionTableOffset) / sizeof (EFI_IMAGE_SECTION_HEADER)))
+  {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
 /**
   Get the image type.
 
@@ -293,30 +373,16 @@ HashPeImage (
   IN  UINT32  HashAlg
   )
 {
-  BOOLEAN                   Status;
-  EFI_IMAGE_SECTION_HEADER  *Section;
-  VOID                      *HashCtx;
-  UINTN                     CtxSize;
-  UINT8                     *HashBase;
-  UINTN                     HashSize;
-  UINTN                     SumOfBytesHashed;
-  EFI_IMAGE_SECTION_HEADER  *SectionHeader;
-  UINTN                     Index;
-  UINTN                     Pos;
-  UINT32                    CertSize;
-  UINT32                    NumberOfRvaAndSizes;
-
-  HashCtx       = NULL;
-  SectionHeader = NULL;
-  Status        = FALSE;
+  EFI_STATUS          Status;
+  UINT32              HashMask;
+  TPMI_ALG_HASH       TpmHashAlg;
+  TPML_DIGEST_VALUES  DigestList;
+  UINT8               *Digest;
 
   if ((HashAlg >= HASHALG_MAX)) {
     return FALSE;
   }
 
-  //
-  // Initialize context of hash.
-  //
   ZeroMem (mImageDigest, MAX_DIGEST_SIZE);
 
   switch (HashAlg) {
@@ -324,22 +390,30 @@ HashPeImage (
     case HASHALG_SHA1:
       mImageDigestSize = SHA1_DIGEST_SIZE;
       mCertType        = gEfiCertSha1Guid;
+      HashMask         = EFI_TCG2_BOOT_HASH_ALG_SHA1;
+      TpmHashAlg       = TPM_ALG_SHA1;
       break;
  #endif
 
     case HASHALG_SHA256:
       mImageDigestSize = SHA256_DIGEST_SIZE;
       mCertType        = gEfiCertSha256Guid;
+      HashMask         = EFI_TCG2_BOOT_HASH_ALG_SHA256;
+      TpmHashAlg       = TPM_ALG_SHA256;
       break;
 
     case HASHALG_SHA384:
       mImageDigestSize = SHA384_DIGEST_SIZE;
       mCertType        = gEfiCertSha384Guid;
+      HashMask         = EFI_TCG2_BOOT_HASH_ALG_SHA384;
+      TpmHashAlg       = TPM_ALG_SHA384;
       break;
 
     case HASHALG_SHA512:
       mImageDigestSize = SHA512_DIGEST_SIZE;
       mCertType        = gEfiCertSha512Guid;
+      HashMask         = EFI_TCG2_BOOT_HASH_ALG_SHA512;
+      TpmHashAlg       = TPM_ALG_SHA512;
       break;
 
     default:
@@ -347,262 +421,23 @@ HashPeImage (
   }
 
   mHashTypeStr = mHash[HashAlg].Name;
-  CtxSize      = mHash[HashAlg].GetContextSize ();
-
-  HashCtx = AllocatePool (CtxSize);
-  if (HashCtx == NULL) {
-    return FALSE;
-  }
-
-  // 1.  Load the image header into memory.
-
-  // 2.  Initialize a SHA hash context.
-  Status = mHash[HashAlg].HashInit (HashCtx);
-
-  if (!Status) {
-    goto Done;
-  }
 
   //
-  // Measuring PE/COFF Image Header;
-  // But CheckSum field and SECURITY data directory (certificate) are excluded
+  // The digest is calculated in the same walk of the image as the digests the TPM
+  // measurement of the image needs, and is reused if it was already calculated.
   //
-
-  //
-  // 3.  Calculate the distance from the base of the image header to the image checksum address.
-  // 4.  Hash the image header from its base to beginning of the image checksum.
-  //
-  HashBase = mImageBase;
-  if (mNtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
-    //
-    // Use PE32 offset.
-    //
-    HashSize            = (UINTN)(&mNtHeader.Pe32->OptionalHeader.CheckSum) - (UINTN)HashBase;
-    NumberOfRvaAndSizes = mNtHeader.Pe32->OptionalHeader.NumberOfRvaAndSizes;
-  } else if (mNtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC) {
-    //
-    // Use PE32+ offset.
-    //
-    HashSize            = (UINTN)(&mNtHeader.Pe32Plus->OptionalHeader.CheckSum) - (UINTN)HashBase;
-    NumberOfRvaAndSizes = mNtHeader.Pe32Plus->OptionalHeader.NumberOfRvaAndSizes;
-  } else {
-    //
-    // Invalid header magic number.
-    //
-    Status = FALSE;
-    goto Done;
-  }
-
-  Status = mHash[HashAlg].HashUpdate (HashCtx, HashBase, HashSize);
-  if (!Status) {
-    goto Done;
-  }
-
-  //
-  // 5.  Skip over the image checksum (it occupies a single ULONG).
-  //
-  if (NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
-    //
-    // 6.  Since there is no Cert Directory in optional header, hash everything
-    //     from the end of the checksum to the end of image header.
-    //
-    if (mNtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
-      //
-      // Use PE32 offset.
-      //
-      HashBase = (UINT8 *)&mNtHeader.Pe32->OptionalHeader.CheckSum + sizeof (UINT32);
-      HashSize = mNtHeader.Pe32->OptionalHeader.SizeOfHeaders - ((UINTN)HashBase - (UINTN)mImageBase);
-    } else {
-      //
-      // Use PE32+ offset.
-      //
-      HashBase = (UINT8 *)&mNtHeader.Pe32Plus->OptionalHeader.CheckSum + sizeof (UINT32);
-      HashSize = mNtHeader.Pe32Plus->OptionalHeader.SizeOfHeaders - ((UINTN)HashBase - (UINTN)mImageBase);
-    }
-
-    if (HashSize != 0) {
-      Status = mHash[HashAlg].HashUpdate (HashCtx, HashBase, HashSize);
-      if (!Status) {
-        goto Done;
-      }
-    }
-  } else {
-    //
-    // 7.  Hash everything from the end of the checksum to the start of the Cert Directory.
-    //
-    if (mNtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
-      //
-      // Use PE32 offset.
-      //
-      HashBase = (UINT8 *)&mNtHeader.Pe32->OptionalHeader.CheckSum + sizeof (UINT32);
-      HashSize = (UINTN)(&mNtHeader.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY]) - (UINTN)HashBase;
-    } else {
-      //
-      // Use PE32+ offset.
-      //
-      HashBase = (UINT8 *)&mNtHeader.Pe32Plus->OptionalHeader.CheckSum + sizeof (UINT32);
-      HashSize = (UINTN)(&mNtHeader.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY]) - (UINTN)HashBase;
-    }
-
-    if (HashSize != 0) {
-      Status = mHash[HashAlg].HashUpdate (HashCtx, HashBase, HashSize);
-      if (!Status) {
-        goto Done;
-      }
-    }
-
-    //
-    // 8.  Skip over the Cert Directory. (It is sizeof(IMAGE_DATA_DIRECTORY) bytes.)
-    // 9.  Hash everything from the end of the Cert Directory to the end of image header.
-    //
-    if (mNtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
-      //
-      // Use PE32 offset
-      //
-      HashBase = (UINT8 *)&mNtHeader.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY + 1];
-      HashSize = mNtHeader.Pe32->OptionalHeader.SizeOfHeaders - ((UINTN)HashBase - (UINTN)mImageBase);
-    } else {
-      //
-      // Use PE32+ offset.
-      //
-      HashBase = (UINT8 *)&mNtHeader.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY + 1];
-      HashSize = mNtHeader.Pe32Plus->OptionalHeader.SizeOfHeaders - ((UINTN)HashBase - (UINTN)mImageBase);
-    }
-
-    if (HashSize != 0) {
-      Status = mHash[HashAlg].HashUpdate (HashCtx, HashBase, HashSize);
-      if (!Status) {
-        goto Done;
-      }
-    }
-  }
-
-  //
-  // 10. Set the SUM_OF_BYTES_HASHED to the size of the header.
-  //
-  if (mNtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
-    //
-    // Use PE32 offset.
-    //
-    SumOfBytesHashed = mNtHeader.Pe32->OptionalHeader.SizeOfHeaders;
-  } else {
-    //
-    // Use PE32+ offset
-    //
-    SumOfBytesHashed = mNtHeader.Pe32Plus->OptionalHeader.SizeOfHeaders;
-  }
-
-  Section = (EFI_IMAGE_SECTION_HEADER *)(
-                                         mImageBase +
-                                         mPeCoffHeaderOffset +
-                                         sizeof (UINT32) +
-                                         sizeof (EFI_IMAGE_FILE_HEADER) +
-                                         mNtHeader.Pe32->FileHeader.SizeOfOptionalHeader
-                                         );
-
-  //
-  // 11. Build a temporary table of pointers to all the IMAGE_SECTION_HEADER
-  //     structures in the image. The 'NumberOfSections' field of the image
-  //     header indicates how big the table should be. Do not include any
-  //     IMAGE_SECTION_HEADERs in the table whose 'SizeOfRawData' field is zero.
-  //
-  SectionHeader = (EFI_IMAGE_SECTION_HEADER *)AllocateZeroPool (sizeof (EFI_IMAGE_SECTION_HEADER) * mNtHeader.Pe32->FileHeader.NumberOfSections);
-  if (SectionHeader == NULL) {
-    Status = FALSE;
-    goto Done;
-  }
-
-  //
-  // 12.  Using the 'PointerToRawData' in the referenced section headers as
-  //      a key, arrange the elements in the table in ascending order. In other
-  //      words, sort the section headers according to the disk-file offset of
-  //      the section.
-  //
-  for (Index = 0; Index < mNtHeader.Pe32->FileHeader.NumberOfSections; Index++) {
-    Pos = Index;
-    while ((Pos > 0) && (Section->PointerToRawData < SectionHeader[Pos - 1].PointerToRawData)) {
-      CopyMem (&SectionHeader[Pos], &SectionHeader[Pos - 1], sizeof (EFI_IMAGE_SECTION_HEADER));
-      Pos--;
-    }
-
-    CopyMem (&SectionHeader[Pos], Section, sizeof (EFI_IMAGE_SECTION_HEADER));
-    Section += 1;
-  }
-
-  //
-  // 13.  Walk through the sorted table, bring the corresponding section
-  //      into memory, and hash the entire section (using the 'SizeOfRawData'
-  //      field in the section header to determine the amount of data to hash).
-  // 14.  Add the section's 'SizeOfRawData' to SUM_OF_BYTES_HASHED .
-  // 15.  Repeat steps 13 and 14 for all the sections in the sorted table.
-  //
-  for (Index = 0; Index < mNtHeader.Pe32->FileHeader.NumberOfSections; Index++) {
-    Section = &SectionHeader[Index];
-    if (Section->SizeOfRawData == 0) {
-      continue;
-    }
-
-    HashBase = mImageBase + Section->PointerToRawData;
-    HashSize = (UINTN)Section->SizeOfRawData;
-
-    Status = mHash[HashAlg].HashUpdate (HashCtx, HashBase, HashSize);
-    if (!Status) {
-      goto Done;
-    }
-
-    SumOfBytesHashed += HashSize;
-  }
-
-  //
-  // 16.  If the file size is greater than SUM_OF_BYTES_HASHED, there is extra
-  //      data in the file that needs to be added to the hash. This data begins
-  //      at file offset SUM_OF_BYTES_HASHED and its length is:
-  //             FileSize  -  (CertDirectory->Size)
-  //
-  if (mImageSize > SumOfBytesHashed) {
-    HashBase = mImageBase + SumOfBytesHashed;
-
-    if (NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
-      CertSize = 0;
-    } else {
-      if (mNtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
-        //
-        // Use PE32 offset.
-        //
-        CertSize = mNtHeader.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY].Size;
-      } else {
-        //
-        // Use PE32+ offset.
-        //
-        CertSize = mNtHeader.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY].Size;
-      }
-    }
-
-    if (mImageSize > CertSize + SumOfBytesHashed) {
-      HashSize = (UINTN)(mImageSize - CertSize - SumOfBytesHashed);
-
-      Status = mHash[HashAlg].HashUpdate (HashCtx, HashBase, HashSize);
-      if (!Status) {
-        goto Done;
-      }
-    } else if (mImageSize < CertSize + SumOfBytesHashed) {
-      Status = FALSE;
-      goto Done;
-    }
-  }
-
-  Status = mHash[HashAlg].HashFinal (HashCtx, mImageDigest);
-
-Done:
-  if (HashCtx != NULL) {
-    FreePool (HashCtx);
+  Status = PeImageDigestGet (mImageBase, mImageSize, HashMask, &DigestList);
+  if (EFI_ERROR (Status)) {
+    return FALSE;
   }
 
-  if (SectionHeader != NULL) {
-    FreePool (SectionHeader);
+  Digest = PeImageDigestFromList (&DigestList, TpmHashAlg);
+  if (Digest == NULL) {
+    return FALSE;
   }
 
-  return Status;
+  CopyMem (mImageDigest, Digest, mImageDigestSize);
+  return TRUE;
 }
 
 /**
@@ -827,13 +662,88 @@ AddImageExeInfo (
   }
 }
 
+/**
+  Read an image security database variable, and index it again if its content
+  changed since it was last read.
+
+  @param[in, out]  Database  The database to refresh. Database->Status is set to
+                             EFI_SUCCESS if the variable has been read and indexed,
+                             or to the error that occurred.
+
+**/
+VOID
+RefreshImageSecurityDatabase (
+  IN OUT IMAGE_SECURITY_DATABASE  *Database
+  )
+{
+  EFI_STATUS            Status;
+  UINT8                 *Data;
+  UINTN                 DataSize;
+  SIGNATURE_LIST_INDEX  *Index;
+
+  Data     = NULL;
+  DataSize = 0;
+  Status   = gRT->GetVariable (Database->VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
+  if (Status == EFI_BUFFER_TOO_SMALL) {
+    Data = (UINT8 *)AllocateZeroPool (DataSize);
+    if (Data == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+    } else {
+      Status = gRT->GetVariable (Database->VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, Data);
+    }
+  }
+
+  if (!EFI_ERROR (Status) &&
+      !EFI_ERROR (Database->Status) &&
+      (DataSize == Database->DataSize) &&
+      (CompareMem (Data, Database->Data, DataSize) == 0))
+  {
+    //
+    // The database did not change, keep its index.
+    //
+    if (Data != NULL) {
+      FreePool (Data);
+    }
+
+    return;
+  }
+
+  Index = NULL;
+  if (!EFI_ERROR (Status)) {
+    Status = SignatureListIndexCreate (Data, DataSize, &Index);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "DxeImageVerificationLib: Failed to index %s - %r.\n", Database->VariableName, Status));
+    }
+  }
+
+  if (EFI_ERROR (Status) && (Data != NULL)) {
+    FreePool (Data);
+    Data     = NULL;
+    DataSize = 0;
+  }
+
+  SignatureListIndexFree (Database->Index);
+  if (Database->Data != NULL) {
+    FreePool (Database->Data);
+  }
+
+  //
+  // Release the certificates of the previous database parsed by Pkcs7Verify().
+  //
+  Pkcs7VerifyCacheFlush ();
+
+  Database->Data     = Data;
+  Database->DataSize = DataSize;
+  Database->Index    = Index;
+  Database->Status   = Status;
+}
+
 /**
   Check whether the hash of an given X.509 certificate is in forbidden database (DBX).
 
   @param[in]  Certificate       Pointer to X.509 Certificate that is searched for.
   @param[in]  CertSize          Size of X.509 Certificate.
-  @param[in]  SignatureList     Pointer to the Signature List in forbidden database.
-  @param[in]  SignatureListSize Size of Signature List.
+  @param[in]  Dbx               The forbidden database.
   @param[out] RevocationTime    Return the time that the certificate was revoked.
   @param[out] IsFound           Search result. Only valid if EFI_SUCCESS returned.
 
@@ -843,36 +753,36 @@ AddImageExeInfo (
 **/
 EFI_STATUS
 IsCertHashFoundInDbx (
-  IN  UINT8               *Certificate,
-  IN  UINTN               CertSize,
-  IN  EFI_SIGNATURE_LIST  *SignatureList,
-  IN  UINTN               SignatureListSize,
-  OUT EFI_TIME            *RevocationTime,
-  OUT BOOLEAN             *IsFound
+  IN  UINT8                    *Certificate,
+  IN  UINTN                    CertSize,
+  IN  IMAGE_SECURITY_DATABASE  *Dbx,
+  OUT EFI_TIME                 *RevocationTime,
+  OUT BOOLEAN                  *IsFound
   )
 {
   EFI_STATUS          Status;
+  EFI_GUID            *CertHashType[3];
+  UINT32              CertHashAlg[3];
   EFI_SIGNATURE_LIST  *DbxList;
-  UINTN               DbxSize;
   EFI_SIGNATURE_DATA  *CertHash;
-  UINTN               CertHashCount;
+  EFI_SIGNATURE_LIST  *FoundList;
+  EFI_SIGNATURE_DATA  *FoundCertHash;
+  UINT32              FoundHashAlg;
   UINTN               Index;
   UINT32              HashAlg;
   VOID                *HashCtx;
   UINT8               CertDigest[MAX_DIGEST_SIZE];
-  UINT8               *DbxCertHash;
-  UINTN               SiglistHeaderSize;
   UINT8               *TBSCert;
   UINTN               TBSCertSize;
 
-  Status   = EFI_ABORTED;
-  *IsFound = FALSE;
-  DbxList  = SignatureList;
-  DbxSize  = SignatureListSize;
-  HashCtx  = NULL;
-  HashAlg  = HASHALG_MAX;
+  Status        = EFI_ABORTED;
+  *IsFound      = FALSE;
+  HashCtx       = NULL;
+  FoundList     = NULL;
+  FoundCertHash = NULL;
+  FoundHashAlg  = HASHALG_MAX;
 
-  if ((RevocationTime == NULL) || (DbxList == NULL)) {
+  if ((RevocationTime == NULL) || (Dbx == NULL) || EFI_ERROR (Dbx->Status)) {
     return EFI_INVALID_PARAMETER;
   }
 
@@ -883,22 +793,23 @@ IsCertHashFoundInDbx (
     return Status;
   }
 
-  while ((DbxSize > 0) && (SignatureListSize >= DbxList->SignatureListSize)) {
+  CertHashType[0] = &gEfiCertX509Sha256Guid;
+  CertHashAlg[0]  = HASHALG_SHA256;
+  CertHashType[1] = &gEfiCertX509Sha384Guid;
+  CertHashAlg[1]  = HASHALG_SHA384;
+  CertHashType[2] = &gEfiCertX509Sha512Guid;
+  CertHashAlg[2]  = HASHALG_SHA512;
+
+  for (Index = 0; Index < ARRAY_SIZE (CertHashType); Index++) {
     //
-    // Determine Hash Algorithm of Certificate in the forbidden database.
+    // Only hash the TBSCertificate with the algorithms used in the forbidden database.
     //
-    if (CompareGuid (&DbxList->SignatureType, &gEfiCertX509Sha256Guid)) {
-      HashAlg = HASHALG_SHA256;
-    } else if (CompareGuid (&DbxList->SignatureType, &gEfiCertX509Sha384Guid)) {
-      HashAlg = HASHALG_SHA384;
-    } else if (CompareGuid (&DbxList->SignatureType, &gEfiCertX509Sha512Guid)) {
-      HashAlg = HASHALG_SHA512;
-    } else {
-      DbxSize -= DbxList->SignatureListSize;
-      DbxList  = (EFI_SIGNATURE_LIST *)((UINT8 *)DbxList + DbxList->SignatureListSize);
+    if (SignatureListIndexCount (Dbx->Index, CertHashType[Index]) == 0) {
       continue;
     }
 
+    HashAlg = CertHashAlg[Index];
+
     //
     // Calculate the hash value of current TBSCertificate for comparision.
     //
@@ -927,33 +838,33 @@ IsCertHashFoundInDbx (
     FreePool (HashCtx);
     HashCtx = NULL;
 
-    SiglistHeaderSize = sizeof (EFI_SIGNATURE_LIST) + DbxList->SignatureHeaderSize;
-    CertHash          = (EFI_SIGNATURE_DATA *)((UINT8 *)DbxList + SiglistHeaderSize);
-    CertHashCount     = (DbxList->SignatureListSize - SiglistHeaderSize) / DbxList->SignatureSize;
-    for (Index = 0; Index < CertHashCount; Index++) {
-      //
-      // Iterate each Signature Data Node within this CertList for verify.
-      //
-      DbxCertHash = CertHash->SignatureData;
-      if (CompareMem (DbxCertHash, CertDigest, mHash[HashAlg].DigestLength) == 0) {
-        //
-        // Hash of Certificate is found in forbidden database.
-        //
-        Status   = EFI_SUCCESS;
-        *IsFound = TRUE;
-
-        //
-        // Return the revocation time.
-        //
-        CopyMem (RevocationTime, (EFI_TIME *)(DbxCertHash + mHash[HashAlg].DigestLength), sizeof (EFI_TIME));
-        goto Done;
-      }
+    //
+    // Keep the hash found first in the forbidden database, its revocation time is
+    // the one a walk of the signature lists would return.
+    //
+    CertHash = SignatureListIndexFind (Dbx->Index, CertHashType[Index], 0, CertDigest, mHash[HashAlg].DigestLength, &DbxList);
+    if ((CertHash != NULL) && ((FoundCertHash == NULL) || ((UINTN)CertHash < (UINTN)FoundCertHash))) {
+      FoundList     = DbxList;
+      FoundCertHash = CertHash;
+      FoundHashAlg  = HashAlg;
+    }
+  }
 
-      CertHash = (EFI_SIGNATURE_DATA *)((UINT8 *)CertHash + DbxList->SignatureSize);
+  if (FoundCertHash != NULL) {
+    //
+    // Hash of Certificate is found in forbidden database. The revocation time
+    // follows the hash.
+    //
+    if (FoundList->SignatureSize < OFFSET_OF (EFI_SIGNATURE_DATA, SignatureData) + mHash[FoundHashAlg].DigestLength + sizeof (EFI_TIME)) {
+      goto Done;
     }
 
-    DbxSize -= DbxList->SignatureListSize;
-    DbxList  = (EFI_SIGNATURE_LIST *)((UINT8 *)DbxList + DbxList->SignatureListSize);
+    *IsFound = TRUE;
+
+    //
+    // Return the revocation time.
+    //
+    CopyMem (RevocationTime, FoundCertHash->SignatureData + mHash[FoundHashAlg].DigestLength, sizeof (EFI_TIME));
   }
 
   Status = EFI_SUCCESS;
@@ -969,7 +880,7 @@ Done:
 /**
   Check whether signature is in specified database.
 
-  @param[in]  VariableName        Name of database variable that is searched in.
+  @param[in]  Database            Database that is searched in.
   @param[in]  Signature           Pointer to signature that is searched for.
   @param[in]  CertType            Pointer to hash algorithm.
   @param[in]  SignatureSize       Size of Signature.
@@ -981,91 +892,50 @@ Done:
 **/
 EFI_STATUS
 IsSignatureFoundInDatabase (
-  IN  CHAR16    *VariableName,
-  IN  UINT8     *Signature,
-  IN  EFI_GUID  *CertType,
-  IN  UINTN     SignatureSize,
-  OUT BOOLEAN   *IsFound
+  IN  IMAGE_SECURITY_DATABASE  *Database,
+  IN  UINT8                    *Signature,
+  IN  EFI_GUID                 *CertType,
+  IN  UINTN                    SignatureSize,
+  OUT BOOLEAN                  *IsFound
   )
 {
-  EFI_STATUS          Status;
   EFI_SIGNATURE_LIST  *CertList;
   EFI_SIGNATURE_DATA  *Cert;
-  UINTN               DataSize;
-  UINT8               *Data;
-  UINTN               Index;
-  UINTN               CertCount;
 
-  //
-  // Read signature database variable.
-  //
   *IsFound = FALSE;
-  Data     = NULL;
-  DataSize = 0;
-  Status   = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
-  if (Status != EFI_BUFFER_TOO_SMALL) {
-    if (Status == EFI_NOT_FOUND) {
-      //
-      // No database, no need to search.
-      //
-      Status = EFI_SUCCESS;
-    }
-
-    return Status;
-  }
-
-  Data = (UINT8 *)AllocateZeroPool (DataSize);
-  if (Data == NULL) {
-    return EFI_OUT_OF_RESOURCES;
+  if (Database->Status == EFI_NOT_FOUND) {
+    //
+    // No database, no need to search.
+    //
+    return EFI_SUCCESS;
   }
 
-  Status = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, Data);
-  if (EFI_ERROR (Status)) {
-    goto Done;
+  if (EFI_ERROR (Database->Status)) {
+    return Database->Status;
   }
 
-  //
-  // Enumerate all signature data in SigDB to check if signature exists for executable.
-  //
-  CertList = (EFI_SIGNATURE_LIST *)Data;
-  while ((DataSize > 0) && (DataSize >= CertList->SignatureListSize)) {
-    CertCount = (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
-    Cert      = (EFI_SIGNATURE_DATA *)((UINT8 *)CertList + sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize);
-    if ((CertList->SignatureSize == sizeof (EFI_SIGNATURE_DATA) - 1 + SignatureSize) && (CompareGuid (&CertList->SignatureType, CertType))) {
-      for (Index = 0; Index < CertCount; Index++) {
-        if (CompareMem (Cert->SignatureData, Signature, SignatureSize) == 0) {
-          //
-          // Find the signature in database.
-          //
-          *IsFound = TRUE;
-          //
-          // Entries in UEFI_IMAGE_SECURITY_DATABASE that are used to validate image should be measured
-          //
-          if (StrCmp (VariableName, EFI_IMAGE_SECURITY_DATABASE) == 0) {
-            SecureBootHook (VariableName, &gEfiImageSecurityDatabaseGuid, CertList->SignatureSize, Cert);
-          }
-
-          break;
-        }
-
-        Cert = (EFI_SIGNATURE_DATA *)((UINT8 *)Cert + CertList->SignatureSize);
-      }
-
-      if (*IsFound) {
-        break;
-      }
+  Cert = SignatureListIndexFind (
+           Database->Index,
+           CertType,
+           sizeof (EFI_SIGNATURE_DATA) - 1 + SignatureSize,
+           Signature,
+           SignatureSize,
+           &CertList
+           );
+  if (Cert != NULL) {
+    //
+    // Find the signature in database.
+    //
+    *IsFound = TRUE;
+    //
+    // Entries in UEFI_IMAGE_SECURITY_DATABASE that are used to validate image should be measured
+    //
+    if (StrCmp (Database->VariableName, EFI_IMAGE_SECURITY_DATABASE) == 0) {
+      SecureBootHook (Database->VariableName, &gEfiImageSecurityDatabaseGuid, CertList->SignatureSize, Cert);
     }
-
-    DataSize -= CertList->SignatureListSize;
-    CertList  = (EFI_SIGNATURE_LIST *)((UINT8 *)CertList + CertList->SignatureListSize);
   }
 
-Done:
-  if (Data != NULL) {
-    FreePool (Data);
-  }
-
-  return Status;
+  return EFI_SUCCESS;
 }
 
 /**
@@ -1287,13 +1157,10 @@ IsForbiddenByDbx (
   TrustedCertLength = 0;
 
   //
-  // The image will not be forbidden if dbx can't be got.
+  // The image will be forbidden if dbx can't be got.
   //
-  DataSize = 0;
-  Status   = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
-  ASSERT (EFI_ERROR (Status));
-  if (Status != EFI_BUFFER_TOO_SMALL) {
-    if (Status == EFI_NOT_FOUND) {
+  if (EFI_ERROR (mDbx.Status)) {
+    if (mDbx.Status == EFI_NOT_FOUND) {
       //
       // Evidently not in dbx if the database doesn't exist.
       //
@@ -1303,15 +1170,8 @@ IsForbiddenByDbx (
     return IsForbidden;
   }
 
-  Data = (UINT8 *)AllocateZeroPool (DataSize);
-  if (Data == NULL) {
-    return IsForbidden;
-  }
-
-  Status = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, (VOID *)Data);
-  if (EFI_ERROR (Status)) {
-    goto Done;
-  }
+  Data     = mDbx.Data;
+  DataSize = mDbx.DataSize;
 
   //
   // Verify image signature with RAW X509 certificates in DBX database.
@@ -1390,7 +1250,7 @@ IsForbiddenByDbx (
     //
     CertPtr = CertPtr + sizeof (UINT32) + CertSize;
 
-    Status = IsCertHashFoundInDbx (Cert, CertSize, (EFI_SIGNATURE_LIST *)Data, DataSize, &RevocationTime, &IsFound);
+    Status = IsCertHashFoundInDbx (Cert, CertSize, &mDbx, &RevocationTime, &IsFound);
     if (EFI_ERROR (Status)) {
       //
       // Error in searching dbx. Consider it as 'found'. RevocationTime might
@@ -1419,10 +1279,6 @@ IsForbiddenByDbx (
   IsForbidden = FALSE;
 
 Done:
-  if (Data != NULL) {
-    FreePool (Data);
-  }
-
   Pkcs7FreeSigners (CertBuffer);
   Pkcs7FreeSigners (TrustedCert);
 
@@ -1456,15 +1312,11 @@ IsAllowedByDb (
   UINTN               RootCertSize;
   UINTN               Index;
   UINTN               CertCount;
-  UINTN               DbxDataSize;
-  UINT8               *DbxData;
   EFI_TIME            RevocationTime;
 
-  Data         = NULL;
   CertList     = NULL;
   CertData     = NULL;
   RootCert     = NULL;
-  DbxData      = NULL;
   RootCertSize = 0;
   VerifyStatus = FALSE;
 
@@ -1472,52 +1324,20 @@ IsAllowedByDb (
   // Fetch 'db' content. If 'db' doesn't exist or encounters problem to get the
   // data, return not-allowed-by-db (FALSE).
   //
-  DataSize = 0;
-  Status   = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
-  ASSERT (EFI_ERROR (Status));
-  if (Status != EFI_BUFFER_TOO_SMALL) {
+  if (EFI_ERROR (mDb.Status)) {
     return VerifyStatus;
   }
 
-  Data = (UINT8 *)AllocateZeroPool (DataSize);
-  if (Data == NULL) {
-    return VerifyStatus;
-  }
-
-  Status = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, (VOID *)Data);
-  if (EFI_ERROR (Status)) {
-    goto Done;
-  }
+  Data     = mDb.Data;
+  DataSize = mDb.DataSize;
 
   //
   // Fetch 'dbx' content. If 'dbx' doesn't exist, continue to check 'db'.
   // If any other errors occurred, no need to check 'db' but just return
   // not-allowed-by-db (FALSE) to avoid bypass.
   //
-  DbxDataSize = 0;
-  Status      = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DbxDataSize, NULL);
-  ASSERT (EFI_ERROR (Status));
-  if (Status != EFI_BUFFER_TOO_SMALL) {
-    if (Status != EFI_NOT_FOUND) {
-      goto Done;
-    }
-
-    //
-    // 'dbx' does not exist. Continue to check 'db'.
-    //
-  } else {
-    //
-    // 'dbx' exists. Get its content.
-    //
-    DbxData = (UINT8 *)AllocateZeroPool (DbxDataSize);
-    if (DbxData == NULL) {
-      goto Done;
-    }
-
-    Status = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DbxDataSize, (VOID *)DbxData);
-    if (EFI_ERROR (Status)) {
-      goto Done;
-    }
+  if (EFI_ERROR (mDbx.Status) && (mDbx.Status != EFI_NOT_FOUND)) {
+    return VerifyStatus;
   }
 
   //
@@ -1551,11 +1371,11 @@ IsAllowedByDb (
           //
           // The image is signed and its signature is found in 'db'.
           //
-          if (DbxData != NULL) {
+          if (!EFI_ERROR (mDbx.Status)) {
             //
             // Here We still need to check if this RootCert's Hash is revoked
             //
-            Status = IsCertHashFoundInDbx (RootCert, RootCertSize, (EFI_SIGNATURE_LIST *)DbxData, DbxDataSize, &RevocationTime, &IsFound);
+            Status = IsCertHashFoundInDbx (RootCert, RootCertSize, &mDbx, &RevocationTime, &IsFound);
             if (EFI_ERROR (Status)) {
               //
               // Error in searching dbx. Consider it as 'found'. RevocationTime might
@@ -1596,14 +1416,6 @@ Done:
     SecureBootHook (EFI_IMAGE_SECURITY_DATABASE, &gEfiImageSecurityDatabaseGuid, CertList->SignatureSize, CertData);
   }
 
-  if (Data != NULL) {
-    FreePool (Data);
-  }
-
-  if (DbxData != NULL) {
-    FreePool (DbxData);
-  }
-
   return VerifyStatus;
 }
 
@@ -1693,6 +1505,7 @@ DxeImageVerificationHandler (
   BOOLEAN                       IsFound;
   UINT8                         HashAlg;
   BOOLEAN                       IsFoundInDatabase;
+  TPML_DIGEST_VALUES            DigestList;
 
   SignatureList     = NULL;
   SignatureListSize = 0;
@@ -1704,6 +1517,8 @@ DxeImageVerificationHandler (
   IsFound           = FALSE;
   IsFoundInDatabase = FALSE;
 
+  PeImageDigestBeginImage (PE_IMAGE_DIGEST_CONSUMER_IMAGE_VERIFICATION);
+
   //
   // Check the image type and get policy setting.
   //
@@ -1776,6 +1591,13 @@ DxeImageVerificationHandler (
     return EFI_ACCESS_DENIED;
   }
 
+  //
+  // Read db and dbx once for the image. They are indexed again only if they
+  // changed since the previous image.
+  //
+  RefreshImageSecurityDatabase (&mDb);
+  RefreshImageSecurityDatabase (&mDbx);
+
   mImageBase = (UINT8 *)FileBuffer;
   mImageSize = FileSize;
 
@@ -1809,6 +1631,11 @@ DxeImageVerificationHandler (
   //
   // Check PE/COFF image.
   //
+  if (!CheckImageHeaders (mImageBase, (UINTN)ImageContext.SizeOfHeaders)) {
+    DEBUG ((DEBUG_INFO, "DxeImageVerificationLib: The PE/COFF headers are malformed.\n"));
+    goto Failed;
+  }
+
   mNtHeader.Pe32 = (EFI_IMAGE_NT_HEADERS32 *)(mImageBase + mPeCoffHeaderOffset);
   if (mNtHeader.Pe32->Signature != EFI_IMAGE_NT_SIGNATURE) {
     //
@@ -1843,7 +1670,10 @@ DxeImageVerificationHandler (
     //
     // This image is not signed. The hash value of the image must match a record in the security database "db",
     // and not be reflected in the security data base "dbx".
+    // Calculate the digests of all the algorithms in one walk of the image first.
     //
+    PeImageDigestGet (mImageBase, mImageSize, IMAGE_VERIFICATION_HASH_MASK, &DigestList);
+
     HashAlg = sizeof (mHash) / sizeof (HASH_TABLE);
     while (HashAlg > 0) {
       HashAlg--;
@@ -1856,7 +1686,7 @@ DxeImageVerificationHandler (
       }
 
       DbStatus = IsSignatureFoundInDatabase (
-                   EFI_IMAGE_SECURITY_DATABASE1,
+                   &mDbx,
                    mImageDigest,
                    &mCertType,
                    mImageDigestSize,
@@ -1871,7 +1701,7 @@ DxeImageVerificationHandler (
       }
 
       DbStatus = IsSignatureFoundInDatabase (
-                   EFI_IMAGE_SECURITY_DATABASE,
+                   &mDb,
                    mImageDigest,
                    &mCertType,
                    mImageDigestSize,
@@ -1984,7 +1814,7 @@ DxeImageVerificationHandler (
     // Check the image's hash value.
     //
     DbStatus = IsSignatureFoundInDatabase (
-                 EFI_IMAGE_SECURITY_DATABASE1,
+                 &mDbx,
                  mImageDigest,
                  &mCertType,
                  mImageDigestSize,
@@ -1999,7 +1829,7 @@ DxeImageVerificationHandler (
 
     if (!IsVerified) {
       DbStatus = IsSignatureFoundInDatabase (
-                   EFI_IMAGE_SECURITY_DATABASE,
+                   &mDb,
                    mImageDigest,
                    &mCertType,
                    mImageDigestSize,
@@ -2085,6 +1915,18 @@ OnReadyToBoot (
 {
   EFI_IMAGE_EXECUTION_INFO_TABLE  *ImageExeInfoTable;
   UINTN                           ImageExeInfoTableSize;
+  PKCS7_VERIFY_CACHE_STATISTICS   Statistics;
+
+  if (Pkcs7VerifyCacheGetStatistics (&Statistics)) {
+    DEBUG ((
+      DEBUG_INFO,
+      "DxeImageVerificationLib: %ld PKCS#7 verifications, %ld trusted certificate hits, %ld chain hits, %ld certificate signature checks avoided.\n",
+      Statistics.Verifications,
+      Statistics.TrustedCertHits,
+      Statistics.ChainHits,
+      Statistics.SignatureChecksAvoided
+      ));
+  }
 
   EfiGetSystemConfigurationTable (&gEfiImageSecurityDatabaseGuid, (VOID **)&ImageExeInfoTable);
   if (ImageExeInfoTable != NULL) {
@@ -23,6 +23,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/DevicePathLib.h>
 #include <Library/SecurityManagementLib.h>
 #include <Library/PeCoffLib.h>
+#include <Library/SignatureListIndexLib.h>
+#include <Library/PeImageDigestLib.h>
 #include <Protocol/FirmwareVolume2.h>
 #include <Protocol/DevicePath.h>
 #include <Protocol/BlockIo.h>
@@ -69,6 +71,17 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define HASHALG_SHA512  0x00000004
 #define HASHALG_MAX     0x00000005
 
+//
+// Digests of an unsigned image looked up in db and dbx, as a mask of EFI_TCG2_BOOT_HASH_ALG_*
+//
+#ifndef DISABLE_SHA1_DEPRECATED_INTERFACES
+#define IMAGE_VERIFICATION_HASH_MASK  (EFI_TCG2_BOOT_HASH_ALG_SHA1 | EFI_TCG2_BOOT_HASH_ALG_SHA256 | \
+                                       EFI_TCG2_BOOT_HASH_ALG_SHA384 | EFI_TCG2_BOOT_HASH_ALG_SHA512)
+#else
+#define IMAGE_VERIFICATION_HASH_MASK  (EFI_TCG2_BOOT_HASH_ALG_SHA256 | EFI_TCG2_BOOT_HASH_ALG_SHA384 | \
+                                       EFI_TCG2_BOOT_HASH_ALG_SHA512)
+#endif
+
 //
 // Set max digest size as SHA512 Output (64 bytes) by far
 //
@@ -195,4 +208,28 @@ typedef struct {
   HASH_FINAL               HashFinal;
 } HASH_TABLE;
 
+//
+// Cached content of an image security database variable
+//
+typedef struct {
+  //
+  // Name of the database variable
+  //
+  CHAR16                  *VariableName;
+  //
+  // Content of the variable, NULL if it could not be read
+  //
+  UINT8                   *Data;
+  UINTN                   DataSize;
+  //
+  // Signatures of Data sorted for lookups
+  //
+  SIGNATURE_LIST_INDEX    *Index;
+  //
+  // EFI_SUCCESS if Data and Index are valid, otherwise the error that occurred
+  // reading or indexing the variable, EFI_NOT_FOUND if it does not exist
+  //
+  EFI_STATUS              Status;
+} IMAGE_SECURITY_DATABASE;
+
 #endif
@@ -31,6 +31,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/DiskIo.h>
 #include <Protocol/DevicePathToText.h>
 #include <Protocol/FirmwareVolumeBlock.h>
+#include <Protocol/PeImageDigest.h>
 
 #include <Guid/MeasuredFvHob.h>
 
@@ -44,6 +45,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/PeCoffLib.h>
 #include <Library/SecurityManagementLib.h>
 #include <Library/HobLib.h>
+#include <Library/PeImageDigestLib.h>
 #include <Protocol/CcMeasurement.h>
 
 #include "DxeTpm2MeasureBootLibSanitization.h"
@@ -66,6 +68,54 @@ UINTN    mTcg2ImageSize;
 EFI_HANDLE         mTcg2CacheMeasuredHandle = NULL;
 MEASURED_HOB_DATA  *mTcg2MeasuredHobData    = NULL;
 
+//
+// PE image being measured by Tcg2Protocol->HashLogExtendEvent(). Its digests are
+// returned to the TPM driver through EDKII_PE_IMAGE_DIGEST_PROTOCOL.
+//
+EFI_PHYSICAL_ADDRESS  mTcg2PeImageAddress      = 0;
+UINT64                mTcg2PeImageSize         = 0;
+EFI_HANDLE            mTcg2PeImageDigestHandle = NULL;
+
+/**
+  Get the Authenticode digests of the PE/COFF image being measured.
+
+  @param[in]  This               The EDKII_PE_IMAGE_DIGEST_PROTOCOL instance.
+  @param[in]  ImageAddress       Start address of the image.
+  @param[in]  ImageSize          Size of the image in bytes.
+  @param[in]  HashAlgorithmMask  Hash algorithms, as a mask of EFI_TCG2_BOOT_HASH_ALG_*.
+  @param[out] DigestList         The digests, one per algorithm requested.
+
+  @retval EFI_SUCCESS            The digests have been returned.
+  @retval EFI_INVALID_PARAMETER  DigestList is NULL.
+  @retval EFI_NOT_FOUND          The image is not the one being measured.
+  @retval other                  The digests could not be calculated.
+**/
+EFI_STATUS
+EFIAPI
+Tcg2GetPeImageDigests (
+  IN  EDKII_PE_IMAGE_DIGEST_PROTOCOL  *This,
+  IN  EFI_PHYSICAL_ADDRESS            ImageAddress,
+  IN  UINT64                          ImageSize,
+  IN  UINT32                          HashAlgorithmMask,
+  OUT TPML_DIGEST_VALUES              *DigestList
+  )
+{
+  if (DigestList == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((mTcg2PeImageAddress == 0) || (ImageAddress != mTcg2PeImageAddress) || (ImageSize != mTcg2PeImageSize)) {
+    return EFI_NOT_FOUND;
+  }
+
+  return PeImageDigestGet ((VOID *)(UINTN)ImageAddress, (UINTN)ImageSize, HashAlgorithmMask, DigestList);
+}
+
+EDKII_PE_IMAGE_DIGEST_PROTOCOL  mTcg2PeImageDigest = {
+  EDKII_PE_IMAGE_DIGEST_PROTOCOL_REVISION,
+  Tcg2GetPeImageDigests
+};
+
 /**
   Reads contents of a PE/COFF image in memory buffer.
 
@@ -494,13 +544,21 @@ Tcg2MeasurePeImage (
                            );
     DEBUG ((DEBUG_INFO, "DxeTpm2MeasureBootHandler - Cc MeasurePeImage - %r\n", Status));
   } else if (Tcg2Protocol != NULL) {
-    Status = Tcg2Protocol->HashLogExtendEvent (
-                             Tcg2Protocol,
-                             PE_COFF_IMAGE,
-                             ImageAddress,
-                             ImageSize,
-                             Tcg2Event
-                             );
+    //
+    // The TPM driver gets the digests already calculated for the image verification
+    // while it measures the image.
+    //
+    mTcg2PeImageAddress = ImageAddress;
+    mTcg2PeImageSize    = ImageSize;
+    Status              = Tcg2Protocol->HashLogExtendEvent (
+                                          Tcg2Protocol,
+                                          PE_COFF_IMAGE,
+                                          ImageAddress,
+                                          ImageSize,
+                                          Tcg2Event
+                                          );
+    mTcg2PeImageAddress = 0;
+    mTcg2PeImageSize    = 0;
     DEBUG ((DEBUG_INFO, "DxeTpm2MeasureBootHandler - Tcg2 MeasurePeImage - %r\n", Status));
   }
 
@@ -644,6 +702,9 @@ DxeTpm2MeasureBootHandler (
   EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *FvbProtocol;
   EFI_PHYSICAL_ADDRESS                FvAddress;
   UINT32                              Index;
+  UINT32                              ActivePcrBanks;
+
+  PeImageDigestBeginImage (PE_IMAGE_DIGEST_CONSUMER_TPM2_MEASURE_BOOT);
 
   MeasureBootProtocols.Tcg2Protocol = NULL;
   MeasureBootProtocols.CcProtocol   = NULL;
@@ -668,6 +729,16 @@ DxeTpm2MeasureBootHandler (
     )
     );
 
+  //
+  // Have the digests of the active PCR banks calculated in the walk of the next
+  // images for their verification.
+  //
+  if ((MeasureBootProtocols.CcProtocol == NULL) &&
+      !EFI_ERROR (MeasureBootProtocols.Tcg2Protocol->GetActivePcrBanks (MeasureBootProtocols.Tcg2Protocol, &ActivePcrBanks)))
+  {
+    PeImageDigestAddAlgorithms (ActivePcrBanks);
+  }
+
   //
   // Copy File Device Path
   //
@@ -902,6 +973,7 @@ DxeTpm2MeasureBootLibConstructor (
   )
 {
   EFI_HOB_GUID_TYPE  *GuidHob;
+  EFI_STATUS         Status;
 
   GuidHob = NULL;
 
@@ -911,6 +983,16 @@ DxeTpm2MeasureBootLibConstructor (
     mTcg2MeasuredHobData = GET_GUID_HOB_DATA (GuidHob);
   }
 
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &mTcg2PeImageDigestHandle,
+                  &gEdkiiPeImageDigestProtocolGuid,
+                  &mTcg2PeImageDigest,
+                  NULL
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "Install PeImageDigestProtocol - %r. The TPM driver will hash the images again.\n", Status));
+  }
+
   return RegisterSecurity2Handler (
            DxeTpm2MeasureBootHandler,
            EFI_AUTH_OPERATION_MEASURE_IMAGE | EFI_AUTH_OPERATION_IMAGE_REQUIRED
@@ -0,0 +1,187 @@
+/** @file
+  Unit tests of the single pass multi-bank hash update of
+  HashLibBaseCryptoRouter.
+
+  The digests produced by HashUpdateActiveBanks() are compared with the one
+  shot BaseCryptLib hash functions.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <gtest/gtest.h>
+#include <vector>
+extern "C" {
+  #include <Uefi.h>
+  #include <Library/BaseLib.h>
+  #include <Library/BaseMemoryLib.h>
+  #include <Library/BaseCryptLib.h>
+  #include <Library/HashLib.h>
+  #include "../HashLibBaseCryptoRouterCommon.h"
+}
+
+//
+// Hash instances equivalent to the HashInstanceLib libraries, which register
+// themselves with the router from their constructors.
+//
+#define DEFINE_HASH_INSTANCE(Name, Alg, DigestField)                      \
+  STATIC EFI_STATUS EFIAPI Name##TestInit (OUT HASH_HANDLE *HashHandle)   \
+  {                                                                       \
+    VOID  *Context;                                                       \
+    Context = malloc (Name##GetContextSize ());                           \
+    Name##Init (Context);                                                 \
+    *HashHandle = (HASH_HANDLE)Context;                                   \
+    return EFI_SUCCESS;                                                   \
+  }                                                                       \
+  STATIC EFI_STATUS EFIAPI Name##TestUpdate (                             \
+    IN HASH_HANDLE HashHandle, IN VOID *Data, IN UINTN DataSize)          \
+  {                                                                       \
+    Name##Update ((VOID *)HashHandle, Data, DataSize);                    \
+    return EFI_SUCCESS;                                                   \
+  }                                                                       \
+  STATIC EFI_STATUS EFIAPI Name##TestFinal (                              \
+    IN HASH_HANDLE HashHandle, OUT TPML_DIGEST_VALUES *DigestList)        \
+  {                                                                       \
+    DigestList->count              = 1;                                   \
+    DigestList->digests[0].hashAlg = Alg;                                 \
+    Name##Final ((VOID *)HashHandle, DigestList->digests[0].digest.DigestField); \
+    free ((VOID *)HashHandle);                                            \
+    return EFI_SUCCESS;                                                   \
+  }
+
+DEFINE_HASH_INSTANCE (Sha1, TPM_ALG_SHA1, sha1)
+DEFINE_HASH_INSTANCE (Sha256, TPM_ALG_SHA256, sha256)
+DEFINE_HASH_INSTANCE (Sha384, TPM_ALG_SHA384, sha384)
+DEFINE_HASH_INSTANCE (Sm3, TPM_ALG_SM3_256, sm3_256)
+
+STATIC HASH_INTERFACE  mHashInterface[] = {
+  { HASH_ALGORITHM_SHA1_GUID,    Sha1TestInit,   Sha1TestUpdate,   Sha1TestFinal   },
+  { HASH_ALGORITHM_SHA256_GUID,  Sha256TestInit, Sha256TestUpdate, Sha256TestFinal },
+  { HASH_ALGORITHM_SHA384_GUID,  Sha384TestInit, Sha384TestUpdate, Sha384TestFinal },
+  { HASH_ALGORITHM_SM3_256_GUID, Sm3TestInit,    Sm3TestUpdate,    Sm3TestFinal    },
+};
+
+#define ALL_BANKS  (HASH_ALG_SHA1 | HASH_ALG_SHA256 | HASH_ALG_SHA384 | HASH_ALG_SM3_256)
+
+class HashLibBaseCryptoRouterTest : public ::testing::Test {
+protected:
+  std::vector<UINT8>  Buffer;
+  HASH_HANDLE         HashCtx[ARRAY_SIZE (mHashInterface)];
+  TPML_DIGEST_VALUES  Digest[ARRAY_SIZE (mHashInterface)];
+
+  void
+  SetUp (
+    ) override
+  {
+    UINTN  Index;
+
+    Buffer.resize (2 * 1024 * 1024);
+    for (Index = 0; Index < Buffer.size (); Index++) {
+      Buffer[Index] = (UINT8)(Index * 131 + (Index >> 12));
+    }
+  }
+
+  VOID
+  Start (
+    VOID
+    )
+  {
+    UINTN  Index;
+
+    for (Index = 0; Index < ARRAY_SIZE (mHashInterface); Index++) {
+      mHashInterface[Index].HashInit (&HashCtx[Index]);
+    }
+  }
+
+  VOID
+  Final (
+    VOID
+    )
+  {
+    UINTN  Index;
+
+    for (Index = 0; Index < ARRAY_SIZE (mHashInterface); Index++) {
+      mHashInterface[Index].HashFinal (HashCtx[Index], &Digest[Index]);
+    }
+  }
+
+  VOID
+  CheckDigests (
+    UINTN  Length
+    )
+  {
+    UINT8  Expected[SHA384_DIGEST_SIZE];
+
+    ASSERT_TRUE (Sha1HashAll (Buffer.data (), Length, Expected));
+    EXPECT_EQ (memcmp (Digest[0].digests[0].digest.sha1, Expected, SHA1_DIGEST_SIZE), 0) << "Length " << Length;
+    ASSERT_TRUE (Sha256HashAll (Buffer.data (), Length, Expected));
+    EXPECT_EQ (memcmp (Digest[1].digests[0].digest.sha256, Expected, SHA256_DIGEST_SIZE), 0) << "Length " << Length;
+    ASSERT_TRUE (Sha384HashAll (Buffer.data (), Length, Expected));
+    EXPECT_EQ (memcmp (Digest[2].digests[0].digest.sha384, Expected, SHA384_DIGEST_SIZE), 0) << "Length " << Length;
+    ASSERT_TRUE (Sm3HashAll (Buffer.data (), Length, Expected));
+    EXPECT_EQ (memcmp (Digest[3].digests[0].digest.sm3_256, Expected, SM3_256_DIGEST_SIZE), 0) << "Length " << Length;
+  }
+};
+
+TEST_F (HashLibBaseCryptoRouterTest, AllBanksMatchOneShotHash) {
+  static const UINTN  Lengths[] = {
+    0,
+    1,
+    HASH_LIB_UPDATE_CHUNK_SIZE - 1,
+    HASH_LIB_UPDATE_CHUNK_SIZE,
+    HASH_LIB_UPDATE_CHUNK_SIZE + 1,
+    3 * HASH_LIB_UPDATE_CHUNK_SIZE + 77,
+    1024 * 1024 + 13
+  };
+  UINTN               Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (Lengths); Index++) {
+    Start ();
+    HashUpdateActiveBanks (mHashInterface, ARRAY_SIZE (mHashInterface), HashCtx, ALL_BANKS, Buffer.data (), Lengths[Index]);
+    Final ();
+    CheckDigests (Lengths[Index]);
+  }
+}
+
+TEST_F (HashLibBaseCryptoRouterTest, SplitUpdatesMatchOneShotHash) {
+  UINTN  Length;
+  UINTN  Offset;
+  UINTN  Size;
+
+  //
+  // Updates that do not start or end on a chunk boundary.
+  //
+  Length = 5 * HASH_LIB_UPDATE_CHUNK_SIZE + 1000;
+  Start ();
+  for (Offset = 0, Size = 1; Offset < Length; Offset += Size, Size = Size * 3 + 7) {
+    Size = MIN (Size, Length - Offset);
+    HashUpdateActiveBanks (mHashInterface, ARRAY_SIZE (mHashInterface), HashCtx, ALL_BANKS, &Buffer[Offset], Size);
+  }
+
+  Final ();
+  CheckDigests (Length);
+}
+
+TEST_F (HashLibBaseCryptoRouterTest, InactiveBanksAreNotUpdated) {
+  UINT8  Expected[SHA384_DIGEST_SIZE];
+
+  Start ();
+  HashUpdateActiveBanks (mHashInterface, ARRAY_SIZE (mHashInterface), HashCtx, HASH_ALG_SHA256, Buffer.data (), 100000);
+  Final ();
+
+  ASSERT_TRUE (Sha256HashAll (Buffer.data (), 100000, Expected));
+  EXPECT_EQ (memcmp (Digest[1].digests[0].digest.sha256, Expected, SHA256_DIGEST_SIZE), 0);
+  ASSERT_TRUE (Sha1HashAll (Buffer.data (), 0, Expected));
+  EXPECT_EQ (memcmp (Digest[0].digests[0].digest.sha1, Expected, SHA1_DIGEST_SIZE), 0);
+  ASSERT_TRUE (Sha384HashAll (Buffer.data (), 0, Expected));
+  EXPECT_EQ (memcmp (Digest[2].digests[0].digest.sha384, Expected, SHA384_DIGEST_SIZE), 0);
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  testing::InitGoogleTest (&argc, argv);
+  return RUN_ALL_TESTS ();
+}
@@ -15,6 +15,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/HashLib.h>
 #include <Protocol/Tcg2Protocol.h>
 
+#include "HashLibBaseCryptoRouterCommon.h"
+
 typedef struct {
   EFI_GUID    Guid;
   UINT32      Mask;
@@ -72,3 +74,70 @@ Tpm2SetHashToDigestList (
     );
   DigestList->count++;
 }
+
+/**
+  Update the hash sequences of all the active PCR banks with the same data.
+
+  The data is walked only once: it is split in chunks of
+  HASH_LIB_UPDATE_CHUNK_SIZE bytes, and each chunk is passed to the hash
+  interface of every active bank before moving to the next one. Large buffers,
+  such as firmware volumes or images measured in place from flash, are then
+  read from memory once instead of once per bank.
+
+  @param HashInterface       Registered hash interfaces.
+  @param HashInterfaceCount  Number of entries in HashInterface.
+  @param HashCtx             Hash contexts, one per entry of HashInterface.
+  @param HashMask            Mask of the PCR banks to update. Interfaces whose
+                             algorithm is not in HashMask are skipped.
+  @param DataToHash          Data to be hashed.
+  @param DataToHashLen       Data size.
+**/
+VOID
+EFIAPI
+HashUpdateActiveBanks (
+  IN HASH_INTERFACE  *HashInterface,
+  IN UINTN           HashInterfaceCount,
+  IN HASH_HANDLE     *HashCtx,
+  IN UINT32          HashMask,
+  IN VOID            *DataToHash,
+  IN UINTN           DataToHashLen
+  )
+{
+  UINTN  ActiveIndex[HASH_COUNT];
+  UINTN  ActiveCount;
+  UINTN  Index;
+  UINT8  *Data;
+  UINTN  ChunkSize;
+
+  ASSERT (HashInterfaceCount <= HASH_COUNT);
+
+  //
+  // Resolve the active banks once, rather than once per chunk.
+  //
+  ActiveCount = 0;
+  for (Index = 0; Index < HashInterfaceCount; Index++) {
+    if ((Tpm2GetHashMaskFromAlgo (&HashInterface[Index].HashGuid) & HashMask) != 0) {
+      ActiveIndex[ActiveCount++] = Index;
+    }
+  }
+
+  if (ActiveCount == 0) {
+    return;
+  }
+
+  if (ActiveCount == 1) {
+    HashInterface[ActiveIndex[0]].HashUpdate (HashCtx[ActiveIndex[0]], DataToHash, DataToHashLen);
+    return;
+  }
+
+  Data = DataToHash;
+  while (DataToHashLen != 0) {
+    ChunkSize = MIN (DataToHashLen, HASH_LIB_UPDATE_CHUNK_SIZE);
+    for (Index = 0; Index < ActiveCount; Index++) {
+      HashInterface[ActiveIndex[Index]].HashUpdate (HashCtx[ActiveIndex[Index]], Data, ChunkSize);
+    }
+
+    Data          += ChunkSize;
+    DataToHashLen -= ChunkSize;
+  }
+}
@@ -9,6 +9,14 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #ifndef _HASH_LIB_BASE_CRYPTO_ROUTER_COMMON_H_
 #define _HASH_LIB_BASE_CRYPTO_ROUTER_COMMON_H_
 
+//
+// Size of the chunks HashUpdateActiveBanks() passes to every hash interface in
+// turn. It is small enough for a chunk to stay in the processor caches while
+// all PCR banks are updated, and a multiple of the block size of all the
+// supported hash algorithms.
+//
+#define HASH_LIB_UPDATE_CHUNK_SIZE  SIZE_16KB
+
 /**
   The function get hash mask info from algorithm.
 
@@ -35,4 +43,32 @@ Tpm2SetHashToDigestList (
   IN TPML_DIGEST_VALUES      *Digest
   );
 
+/**
+  Update the hash sequences of all the active PCR banks with the same data.
+
+  The data is walked only once: it is split in chunks of
+  HASH_LIB_UPDATE_CHUNK_SIZE bytes, and each chunk is passed to the hash
+  interface of every active bank before moving to the next one. Large buffers,
+  such as firmware volumes or images measured in place from flash, are then
+  read from memory once instead of once per bank.
+
+  @param HashInterface       Registered hash interfaces.
+  @param HashInterfaceCount  Number of entries in HashInterface.
+  @param HashCtx             Hash contexts, one per entry of HashInterface.
+  @param HashMask            Mask of the PCR banks to update. Interfaces whose
+                             algorithm is not in HashMask are skipped.
+  @param DataToHash          Data to be hashed.
+  @param DataToHashLen       Data size.
+**/
+VOID
+EFIAPI
+HashUpdateActiveBanks (
+  IN HASH_INTERFACE  *HashInterface,
+  IN UINTN           HashInterfaceCount,
+  IN HASH_HANDLE     *HashCtx,
+  IN UINT32          HashMask,
+  IN VOID            *DataToHash,
+  IN UINTN           DataToHashLen
+  );
+
 #endif
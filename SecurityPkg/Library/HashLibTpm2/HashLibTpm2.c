@@ -210,6 +210,85 @@ HashCompleteAndExtend (
   return EFI_SUCCESS;
 }
 
+/**
+  Hash sequence complete, without extending a PCR.
+
+  @param HashHandle    Hash handle.
+  @param DataToHash    Data to be hashed.
+  @param DataToHashLen Data size.
+  @param DigestList    Digest list.
+
+  @retval EFI_SUCCESS     Hash sequence complete and DigestList is returned.
+**/
+EFI_STATUS
+EFIAPI
+HashComplete (
+  IN HASH_HANDLE          HashHandle,
+  IN VOID                 *DataToHash,
+  IN UINTN                DataToHashLen,
+  OUT TPML_DIGEST_VALUES  *DigestList
+  )
+{
+  UINT8             *Buffer;
+  UINT64            HashLen;
+  TPM2B_MAX_BUFFER  HashBuffer;
+  EFI_STATUS        Status;
+  TPM_ALG_ID        AlgoId;
+  TPM2B_DIGEST      Result;
+
+  AlgoId = Tpm2GetAlgoFromHashMask ();
+
+  Buffer = (UINT8 *)(UINTN)DataToHash;
+  for (HashLen = DataToHashLen; HashLen > sizeof (HashBuffer.buffer); HashLen -= sizeof (HashBuffer.buffer)) {
+    HashBuffer.size = sizeof (HashBuffer.buffer);
+    CopyMem (HashBuffer.buffer, Buffer, sizeof (HashBuffer.buffer));
+    Buffer += sizeof (HashBuffer.buffer);
+
+    Status = Tpm2SequenceUpdate ((TPMI_DH_OBJECT)HashHandle, &HashBuffer);
+    if (EFI_ERROR (Status)) {
+      return EFI_DEVICE_ERROR;
+    }
+  }
+
+  //
+  // Last one
+  //
+  HashBuffer.size = (UINT16)HashLen;
+  CopyMem (HashBuffer.buffer, Buffer, (UINTN)HashLen);
+
+  ZeroMem (DigestList, sizeof (*DigestList));
+  DigestList->count = HASH_COUNT;
+
+  if (AlgoId == TPM_ALG_NULL) {
+    //
+    // With TPM_RH_NULL, the digests of all the banks are returned and no PCR is extended.
+    //
+    Status = Tpm2EventSequenceComplete (
+               TPM_RH_NULL,
+               (TPMI_DH_OBJECT)HashHandle,
+               &HashBuffer,
+               DigestList
+               );
+  } else {
+    Status = Tpm2SequenceComplete (
+               (TPMI_DH_OBJECT)HashHandle,
+               &HashBuffer,
+               &Result
+               );
+    if (!EFI_ERROR (Status)) {
+      DigestList->count              = 1;
+      DigestList->digests[0].hashAlg = AlgoId;
+      CopyMem (&DigestList->digests[0].digest, Result.buffer, Result.size);
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
   Hash data and extend to PCR.
 
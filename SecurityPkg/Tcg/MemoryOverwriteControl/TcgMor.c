@@ -293,6 +293,112 @@ TPerResetAtEndOfDxe (
   FreePool (HandleBuffer);
 }
 
+/**
+  Notification function of END_OF_DXE, clearing the free memory.
+
+  Every conventional memory range is allocated, cleared and freed. The clear is
+  run on all the processors when the parallel memory protocol is available.
+
+  @param[in] Event      Event whose notification function is being invoked.
+  @param[in] Context    Pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+ClearMemoryAtEndOfDxe (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  EFI_STATUS                      Status;
+  EDKII_PARALLEL_MEMORY_PROTOCOL  *ParallelMemory;
+  EFI_MEMORY_DESCRIPTOR           *MemoryMap;
+  EFI_MEMORY_DESCRIPTOR           *Entry;
+  UINTN                           MemoryMapSize;
+  UINTN                           MapKey;
+  UINTN                           DescriptorSize;
+  UINT32                          DescriptorVersion;
+  EFI_PHYSICAL_ADDRESS            Address;
+  UINT64                          NumberOfPages;
+  UINT64                          ClearedPages;
+
+  gBS->CloseEvent (Event);
+
+  Status = gBS->LocateProtocol (&gEdkiiParallelMemoryProtocolGuid, NULL, (VOID **)&ParallelMemory);
+  if (EFI_ERROR (Status)) {
+    ParallelMemory = NULL;
+  }
+
+  //
+  // Get the memory map, with room for the descriptors created by the pool
+  // allocation itself.
+  //
+  MemoryMapSize = 0;
+  MemoryMap     = NULL;
+  Status        = gBS->GetMemoryMap (&MemoryMapSize, MemoryMap, &MapKey, &DescriptorSize, &DescriptorVersion);
+  while (Status == EFI_BUFFER_TOO_SMALL) {
+    MemoryMapSize += 4 * DescriptorSize;
+    MemoryMap      = AllocatePool (MemoryMapSize);
+    if (MemoryMap == NULL) {
+      return;
+    }
+
+    Status = gBS->GetMemoryMap (&MemoryMapSize, MemoryMap, &MapKey, &DescriptorSize, &DescriptorVersion);
+    if (EFI_ERROR (Status)) {
+      FreePool (MemoryMap);
+      MemoryMap = NULL;
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  ClearedPages = 0;
+  for (Entry = MemoryMap;
+       (UINTN)Entry < (UINTN)MemoryMap + MemoryMapSize;
+       Entry = NEXT_MEMORY_DESCRIPTOR (Entry, DescriptorSize))
+  {
+    if (Entry->Type != EfiConventionalMemory) {
+      continue;
+    }
+
+    //
+    // Skip page 0, which cannot be cleared through a NULL pointer.
+    //
+    Address       = Entry->PhysicalStart;
+    NumberOfPages = Entry->NumberOfPages;
+    if (Address == 0) {
+      Address += EFI_PAGE_SIZE;
+      NumberOfPages--;
+    }
+
+    if ((NumberOfPages == 0) || (Address + EFI_PAGES_TO_SIZE (NumberOfPages) - 1 > MAX_ADDRESS)) {
+      continue;
+    }
+
+    Status = gBS->AllocatePages (AllocateAddress, EfiBootServicesData, (UINTN)NumberOfPages, &Address);
+    if (EFI_ERROR (Status)) {
+      continue;
+    }
+
+    Status = EFI_UNSUPPORTED;
+    if (ParallelMemory != NULL) {
+      Status = ParallelMemory->Clear (ParallelMemory, Address, EFI_PAGES_TO_SIZE (NumberOfPages));
+    }
+
+    if (EFI_ERROR (Status)) {
+      ZeroMem ((VOID *)(UINTN)Address, (UINTN)EFI_PAGES_TO_SIZE (NumberOfPages));
+    }
+
+    gBS->FreePages (Address, (UINTN)NumberOfPages);
+    ClearedPages += NumberOfPages;
+  }
+
+  FreePool (MemoryMap);
+  DEBUG ((DEBUG_INFO, "TcgMor: Cleared %ld MB of free memory\n", RShiftU64 (ClearedPages, 8)));
+}
+
 /**
   Entry Point for TCG MOR Control driver.
 
@@ -368,6 +474,21 @@ MorDriverEntryPoint (
     if (EFI_ERROR (Status)) {
       return Status;
     }
+
+    if (FeaturePcdGet (PcdTcgMorClearFreeMemory) && (MOR_CLEAR_MEMORY_VALUE (mMorControl) != 0x0)) {
+      DEBUG ((DEBUG_INFO, "TcgMor: Create EndofDxe Event for Mor free memory clearing!\n"));
+      Status = gBS->CreateEventEx (
+                      EVT_NOTIFY_SIGNAL,
+                      TPL_CALLBACK,
+                      ClearMemoryAtEndOfDxe,
+                      NULL,
+                      &gEfiEndOfDxeEventGroupGuid,
+                      &Event
+                      );
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+    }
   }
 
   return Status;
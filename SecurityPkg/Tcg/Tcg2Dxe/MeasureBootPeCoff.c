@@ -22,6 +22,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/PeCoffLib.h>
 #include <Library/Tpm2CommandLib.h>
 #include <Library/HashLib.h>
+#include <Protocol/Tcg2Protocol.h>
+#include <Protocol/PeImageDigest.h>
 
 UINTN  mTcg2DxeImageSize = 0;
 
@@ -406,3 +408,48 @@ Finish:
 
   return Status;
 }
+
+/**
+  Extend the Authenticode digests of a PE image that were already calculated for
+  its verification, instead of hashing the image again.
+
+  @param[in]  PCRIndex           TPM PCR index
+  @param[in]  ImageAddress       Start address of image buffer.
+  @param[in]  ImageSize          Image size
+  @param[in]  HashAlgorithmMask  Hash algorithms of the active PCR banks.
+  @param[out] DigestList         Digest list of this image.
+
+  @retval EFI_SUCCESS            The digests of the image have been extended.
+  @retval EFI_NOT_FOUND          The digests of the image are not available. The image
+                                 must be measured with MeasurePeImageAndExtend().
+  @retval other error value
+**/
+EFI_STATUS
+ExtendPeImageDigests (
+  IN  UINT32                PCRIndex,
+  IN  EFI_PHYSICAL_ADDRESS  ImageAddress,
+  IN  UINTN                 ImageSize,
+  IN  UINT32                HashAlgorithmMask,
+  OUT TPML_DIGEST_VALUES    *DigestList
+  )
+{
+  EFI_STATUS                      Status;
+  EDKII_PE_IMAGE_DIGEST_PROTOCOL  *PeImageDigest;
+
+  if ((PCRIndex > MAX_PCR_INDEX) || (HashAlgorithmMask == 0)) {
+    return EFI_NOT_FOUND;
+  }
+
+  Status = gBS->LocateProtocol (&gEdkiiPeImageDigestProtocolGuid, NULL, (VOID **)&PeImageDigest);
+  if (EFI_ERROR (Status)) {
+    return EFI_NOT_FOUND;
+  }
+
+  Status = PeImageDigest->GetDigests (PeImageDigest, ImageAddress, ImageSize, HashAlgorithmMask, DigestList);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_VERBOSE, "Tcg2Dxe: No shared digests of image %lx - %r\n", ImageAddress, Status));
+    return EFI_NOT_FOUND;
+  }
+
+  return Tpm2PcrExtend (PCRIndex, DigestList);
+}
@@ -0,0 +1,182 @@
+/** @file
+  Queue of the PCR extends deferred by Tcg2Dxe.
+
+  TPM2_PCR_Extend has to be sent once per event: the TPM has no command that folds
+  the digests of several events into a PCR. The queue takes the extends of the
+  events that are not PE images off the path of the measurement, and sends them when
+  the PCRs are observed or the system is idle.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/Tpm2CommandLib.h>
+
+#include "PcrExtendQueue.h"
+
+typedef struct {
+  TPMI_DH_PCR           PcrIndex;
+  TPML_DIGEST_VALUES    DigestList;
+} PCR_EXTEND_QUEUE_ENTRY;
+
+PCR_EXTEND_QUEUE_ENTRY  *mPcrExtendQueue      = NULL;
+UINTN                   mPcrExtendQueueDepth = 0;
+UINTN                   mPcrExtendQueueHead  = 0;
+UINTN                   mPcrExtendQueueCount = 0;
+
+/**
+  Allocate the queue.
+
+  @param[in] Depth  Number of extends that may be deferred. 0 disables the queue.
+
+  @retval EFI_SUCCESS           The queue is ready, or disabled.
+  @retval EFI_OUT_OF_RESOURCES  The queue could not be allocated. It is disabled.
+**/
+EFI_STATUS
+PcrExtendQueueInitialize (
+  IN UINT32  Depth
+  )
+{
+  ASSERT (mPcrExtendQueueCount == 0);
+
+  if (mPcrExtendQueue != NULL) {
+    FreePool (mPcrExtendQueue);
+    mPcrExtendQueue = NULL;
+  }
+
+  mPcrExtendQueueDepth = 0;
+  mPcrExtendQueueHead  = 0;
+  mPcrExtendQueueCount = 0;
+
+  if (Depth == 0) {
+    return EFI_SUCCESS;
+  }
+
+  mPcrExtendQueue = AllocatePool (Depth * sizeof (PCR_EXTEND_QUEUE_ENTRY));
+  if (mPcrExtendQueue == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mPcrExtendQueueDepth = Depth;
+  return EFI_SUCCESS;
+}
+
+/**
+  Check whether extends are deferred.
+
+  @retval TRUE   Extends are queued by PcrExtendQueueAdd().
+  @retval FALSE  The queue is disabled.
+**/
+BOOLEAN
+PcrExtendQueueIsEnabled (
+  VOID
+  )
+{
+  return (BOOLEAN)(mPcrExtendQueueDepth != 0);
+}
+
+/**
+  Get the number of extends queued.
+
+  @return The number of extends queued.
+**/
+UINTN
+PcrExtendQueueGetCount (
+  VOID
+  )
+{
+  return mPcrExtendQueueCount;
+}
+
+/**
+  Send the oldest extends of the queue to the TPM.
+
+  An entry is removed once the TPM has extended it, so that the extends stay in the
+  order of the event log.
+
+  @param[in] Count  Maximum number of extends to send.
+
+  @retval EFI_SUCCESS       The extends have been sent.
+  @retval EFI_DEVICE_ERROR  An extend failed. The queue has been emptied.
+**/
+EFI_STATUS
+PcrExtendQueueDrain (
+  IN UINTN  Count
+  )
+{
+  PCR_EXTEND_QUEUE_ENTRY  *Entry;
+  EFI_STATUS              Status;
+
+  while ((Count > 0) && (mPcrExtendQueueCount > 0)) {
+    Entry  = &mPcrExtendQueue[mPcrExtendQueueHead];
+    Status = Tpm2PcrExtend (Entry->PcrIndex, &Entry->DigestList);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a - PCR%d extend failed - %r. %d extends dropped.\n", __func__, Entry->PcrIndex, Status, mPcrExtendQueueCount));
+      mPcrExtendQueueHead  = 0;
+      mPcrExtendQueueCount = 0;
+      return EFI_DEVICE_ERROR;
+    }
+
+    mPcrExtendQueueHead = (mPcrExtendQueueHead + 1) % mPcrExtendQueueDepth;
+    mPcrExtendQueueCount--;
+    Count--;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Send all the extends of the queue to the TPM.
+
+  @retval EFI_SUCCESS       The PCRs match the event log.
+  @retval EFI_DEVICE_ERROR  An extend failed. The queue has been emptied.
+**/
+EFI_STATUS
+PcrExtendQueueFlush (
+  VOID
+  )
+{
+  return PcrExtendQueueDrain (MAX_UINTN);
+}
+
+/**
+  Queue the extend of a PCR. When the queue is full, the oldest extend is sent to
+  the TPM first. When the queue is disabled, the PCR is extended now.
+
+  @param[in] PcrIndex    PCR to be extended.
+  @param[in] DigestList  Digests to extend the PCR with.
+
+  @retval EFI_SUCCESS       The extend has been queued, or done.
+  @retval EFI_DEVICE_ERROR  An extend failed. The queue has been emptied.
+**/
+EFI_STATUS
+PcrExtendQueueAdd (
+  IN TPMI_DH_PCR         PcrIndex,
+  IN TPML_DIGEST_VALUES  *DigestList
+  )
+{
+  PCR_EXTEND_QUEUE_ENTRY  *Entry;
+  EFI_STATUS              Status;
+
+  if (mPcrExtendQueueDepth == 0) {
+    Status = Tpm2PcrExtend (PcrIndex, DigestList);
+    return EFI_ERROR (Status) ? EFI_DEVICE_ERROR : EFI_SUCCESS;
+  }
+
+  if (mPcrExtendQueueCount == mPcrExtendQueueDepth) {
+    Status = PcrExtendQueueDrain (1);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  Entry           = &mPcrExtendQueue[(mPcrExtendQueueHead + mPcrExtendQueueCount) % mPcrExtendQueueDepth];
+  Entry->PcrIndex = PcrIndex;
+  CopyMem (&Entry->DigestList, DigestList, sizeof (Entry->DigestList));
+  mPcrExtendQueueCount++;
+
+  return EFI_SUCCESS;
+}
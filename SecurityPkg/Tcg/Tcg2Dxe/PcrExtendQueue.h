@@ -0,0 +1,92 @@
+/** @file
+  Queue of the PCR extends deferred by Tcg2Dxe.
+
+  An event that is not a PE image is logged with its digests when it is measured,
+  and the extend of the digests is queued. The extends are sent to the TPM in the
+  order the events were logged, so the PCRs always match a prefix of the event log.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef PCR_EXTEND_QUEUE_H_
+#define PCR_EXTEND_QUEUE_H_
+
+#include <Uefi.h>
+#include <IndustryStandard/Tpm20.h>
+
+/**
+  Allocate the queue.
+
+  @param[in] Depth  Number of extends that may be deferred. 0 disables the queue.
+
+  @retval EFI_SUCCESS           The queue is ready, or disabled.
+  @retval EFI_OUT_OF_RESOURCES  The queue could not be allocated. It is disabled.
+**/
+EFI_STATUS
+PcrExtendQueueInitialize (
+  IN UINT32  Depth
+  );
+
+/**
+  Check whether extends are deferred.
+
+  @retval TRUE   Extends are queued by PcrExtendQueueAdd().
+  @retval FALSE  The queue is disabled.
+**/
+BOOLEAN
+PcrExtendQueueIsEnabled (
+  VOID
+  );
+
+/**
+  Get the number of extends queued.
+
+  @return The number of extends queued.
+**/
+UINTN
+PcrExtendQueueGetCount (
+  VOID
+  );
+
+/**
+  Queue the extend of a PCR. When the queue is full, the oldest extend is sent to
+  the TPM first. When the queue is disabled, the PCR is extended now.
+
+  @param[in] PcrIndex    PCR to be extended.
+  @param[in] DigestList  Digests to extend the PCR with.
+
+  @retval EFI_SUCCESS       The extend has been queued, or done.
+  @retval EFI_DEVICE_ERROR  An extend failed. The queue has been emptied.
+**/
+EFI_STATUS
+PcrExtendQueueAdd (
+  IN TPMI_DH_PCR         PcrIndex,
+  IN TPML_DIGEST_VALUES  *DigestList
+  );
+
+/**
+  Send the oldest extends of the queue to the TPM.
+
+  @param[in] Count  Maximum number of extends to send.
+
+  @retval EFI_SUCCESS       The extends have been sent.
+  @retval EFI_DEVICE_ERROR  An extend failed. The queue has been emptied.
+**/
+EFI_STATUS
+PcrExtendQueueDrain (
+  IN UINTN  Count
+  );
+
+/**
+  Send all the extends of the queue to the TPM.
+
+  @retval EFI_SUCCESS       The PCRs match the event log.
+  @retval EFI_DEVICE_ERROR  An extend failed. The queue has been emptied.
+**/
+EFI_STATUS
+PcrExtendQueueFlush (
+  VOID
+  );
+
+#endif
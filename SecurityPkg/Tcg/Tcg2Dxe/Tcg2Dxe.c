@@ -17,6 +17,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/TcgEventHob.h>
 #include <Guid/EventGroup.h>
 #include <Guid/EventExitBootServiceFailed.h>
+#include <Guid/IdleLoopEvent.h>
 #include <Guid/ImageAuthentication.h>
 #include <Guid/TpmInstance.h>
 #include <Guid/DeviceAuthentication.h>
@@ -46,6 +47,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/ReportStatusCodeLib.h>
 #include <Library/Tcg2PhysicalPresenceLib.h>
 
+#include "PcrExtendQueue.h"
+
 #define PERF_ID_TCG2_DXE  0x3120
 
 typedef struct {
@@ -143,6 +146,60 @@ MeasurePeImageAndExtend (
   OUT TPML_DIGEST_VALUES    *DigestList
   );
 
+/**
+  Extend the Authenticode digests of a PE image that were already calculated for
+  its verification, instead of hashing the image again.
+
+  @param[in]  PCRIndex           TPM PCR index
+  @param[in]  ImageAddress       Start address of image buffer.
+  @param[in]  ImageSize          Image size
+  @param[in]  HashAlgorithmMask  Hash algorithms of the active PCR banks.
+  @param[out] DigestList         Digest list of this image.
+
+  @retval EFI_SUCCESS            The digests of the image have been extended.
+  @retval EFI_NOT_FOUND          The digests of the image are not available. The image
+                                 must be measured with MeasurePeImageAndExtend().
+  @retval other error value
+**/
+EFI_STATUS
+ExtendPeImageDigests (
+  IN  UINT32                PCRIndex,
+  IN  EFI_PHYSICAL_ADDRESS  ImageAddress,
+  IN  UINTN                 ImageSize,
+  IN  UINT32                HashAlgorithmMask,
+  OUT TPML_DIGEST_VALUES    *DigestList
+  );
+
+/**
+  Send the extends deferred for the events already logged to the TPM.
+  The TPM is disabled if an extend fails, as when an event cannot be extended.
+
+  @param[in] Count  Maximum number of extends to send. MAX_UINTN sends them all, so
+                    that the PCRs match the event log.
+
+  @retval EFI_SUCCESS       The extends have been sent.
+  @retval EFI_DEVICE_ERROR  An extend failed.
+**/
+EFI_STATUS
+ExtendQueuedEvents (
+  IN UINTN  Count
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = PcrExtendQueueDrain (Count);
+  if (Status == EFI_DEVICE_ERROR) {
+    DEBUG ((DEBUG_ERROR, "ExtendQueuedEvents - %r. Disable TPM.\n", Status));
+    mTcgDxeData.BsCap.TPMPresentFlag = FALSE;
+    REPORT_STATUS_CODE (
+      EFI_ERROR_CODE | EFI_ERROR_MINOR,
+      (PcdGet32 (PcdStatusCodeSubClassTpmDevice) | EFI_P_EC_INTERFACE_ERROR)
+      );
+  }
+
+  return Status;
+}
+
 /**
 
   This function dump raw data.
@@ -738,6 +795,11 @@ Tcg2GetEventLog (
     return EFI_INVALID_PARAMETER;
   }
 
+  //
+  // The caller may replay the log against the PCRs.
+  //
+  ExtendQueuedEvents (MAX_UINTN);
+
   if (!mTcgDxeData.BsCap.TPMPresentFlag) {
     if (EventLogLocation != NULL) {
       *EventLogLocation = 0;
@@ -1199,6 +1261,42 @@ TcgDxeLogHashEvent (
   return RetStatus;
 }
 
+/**
+  Hash data and queue the extend of a PCR with the digests, instead of extending it
+  before the event is logged.
+
+  @param[in]  PcrIndex       PCR to be extended.
+  @param[in]  DataToHash     Data to be hashed.
+  @param[in]  DataToHashLen  Data size.
+  @param[out] DigestList     Digest list.
+
+  @retval EFI_SUCCESS       The data has been hashed, and the extend queued.
+  @retval EFI_DEVICE_ERROR  The command was unsuccessful.
+**/
+EFI_STATUS
+HashAndQueueExtend (
+  IN  TPMI_DH_PCR         PcrIndex,
+  IN  VOID                *DataToHash,
+  IN  UINTN               DataToHashLen,
+  OUT TPML_DIGEST_VALUES  *DigestList
+  )
+{
+  HASH_HANDLE  HashHandle;
+  EFI_STATUS   Status;
+
+  Status = HashStart (&HashHandle);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = HashComplete (HashHandle, DataToHash, DataToHashLen, DigestList);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return PcrExtendQueueAdd (PcrIndex, DigestList);
+}
+
 /**
   Do a hash operation on a data buffer, extend a specific TPM PCR with the hash result,
   and add an entry to the Event Log.
@@ -1260,12 +1358,25 @@ TcgDxeHashLogExtendEvent (
     return Status;
   }
 
-  Status = HashAndExtend (
-             NewEventHdr->PCRIndex,
-             HashData,
-             (UINTN)HashDataLen,
-             &DigestList
-             );
+  if (PcrExtendQueueIsEnabled () && (NewEventHdr->PCRIndex <= MAX_PCR_INDEX)) {
+    //
+    // The event is logged now, and the PCR extended before it is next observed.
+    //
+    Status = HashAndQueueExtend (
+               NewEventHdr->PCRIndex,
+               HashData,
+               (UINTN)HashDataLen,
+               &DigestList
+               );
+  } else {
+    Status = HashAndExtend (
+               NewEventHdr->PCRIndex,
+               HashData,
+               (UINTN)HashDataLen,
+               &DigestList
+               );
+  }
+
   if (!EFI_ERROR (Status)) {
     if ((Flags & EFI_TCG2_EXTEND_ONLY) == 0) {
       Status = TcgDxeLogHashEvent (&DigestList, NewEventHdr, NewEventData);
@@ -1346,12 +1457,29 @@ Tcg2HashLogExtendEvent (
   NewEventHdr.EventType = Event->Header.EventType;
   NewEventHdr.EventSize = Event->Size - sizeof (UINT32) - Event->Header.HeaderSize;
   if ((Flags & PE_COFF_IMAGE) != 0) {
-    Status = MeasurePeImageAndExtend (
-               NewEventHdr.PCRIndex,
-               DataToHash,
-               (UINTN)DataToHashLen,
-               &DigestList
-               );
+    //
+    // The image may run as soon as it is measured, so it is never deferred, and the
+    // events logged before it are extended first.
+    //
+    Status = ExtendQueuedEvents (MAX_UINTN);
+    if (!EFI_ERROR (Status)) {
+      Status = ExtendPeImageDigests (
+                 NewEventHdr.PCRIndex,
+                 DataToHash,
+                 (UINTN)DataToHashLen,
+                 mTcgDxeData.BsCap.ActivePcrBanks,
+                 &DigestList
+                 );
+      if (Status == EFI_NOT_FOUND) {
+        Status = MeasurePeImageAndExtend (
+                   NewEventHdr.PCRIndex,
+                   DataToHash,
+                   (UINTN)DataToHashLen,
+                   &DigestList
+                   );
+      }
+    }
+
     if (!EFI_ERROR (Status)) {
       if ((Flags & EFI_TCG2_EXTEND_ONLY) == 0) {
         Status = TcgDxeLogHashEvent (&DigestList, &NewEventHdr, Event->Event);
@@ -1427,6 +1555,14 @@ Tcg2SubmitCommand (
     return EFI_INVALID_PARAMETER;
   }
 
+  //
+  // The command may read the PCRs, or quote them.
+  //
+  Status = ExtendQueuedEvents (MAX_UINTN);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   Status = Tpm2SubmitCommand (
              InputParameterBlockSize,
              InputParameterBlock,
@@ -2548,6 +2684,11 @@ OnReadyToBoot (
     }
   }
 
+  //
+  // The boot option may read the PCRs without the TCG2 protocol.
+  //
+  ExtendQueuedEvents (MAX_UINTN);
+
   DEBUG ((DEBUG_INFO, "TPM2 Tcg2Dxe Measure Data when ReadyToBoot\n"));
   //
   // Increase boot attempt counter.
@@ -2595,6 +2736,8 @@ OnExitBootServices (
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "%a not Measured. Error!\n", EFI_EXIT_BOOT_SERVICES_SUCCEEDED));
   }
+
+  ExtendQueuedEvents (MAX_UINTN);
 }
 
 /**
@@ -2636,6 +2779,29 @@ OnExitBootServicesFailed (
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "%a not Measured. Error!\n", EFI_EXIT_BOOT_SERVICES_FAILED));
   }
+
+  ExtendQueuedEvents (MAX_UINTN);
+}
+
+/**
+  Idle Loop Event notification handler.
+
+  Send one of the extends deferred to the TPM while the system has nothing else to do.
+
+  @param[in]  Event     Event whose notification function is being invoked
+  @param[in]  Context   Pointer to the notification function's context
+
+**/
+VOID
+EFIAPI
+OnIdle (
+  IN      EFI_EVENT  Event,
+  IN      VOID       *Context
+  )
+{
+  if (mTcgDxeData.BsCap.TPMPresentFlag) {
+    ExtendQueuedEvents (1);
+  }
 }
 
 /**
@@ -2860,6 +3026,22 @@ DriverEntry (
     Status = SetupEventLog ();
     ASSERT_EFI_ERROR (Status);
 
+    //
+    // Defer the extends of the events that are not PE images.
+    //
+    Status = PcrExtendQueueInitialize (PcdGet32 (PcdTcg2PcrExtendQueueDepth));
+    DEBUG ((DEBUG_INFO, "PcrExtendQueueInitialize (%d) - %r\n", PcdGet32 (PcdTcg2PcrExtendQueueDepth), Status));
+    if (PcrExtendQueueIsEnabled ()) {
+      Status = gBS->CreateEventEx (
+                      EVT_NOTIFY_SIGNAL,
+                      TPL_CALLBACK,
+                      OnIdle,
+                      NULL,
+                      &gIdleLoopEventGuid,
+                      &Event
+                      );
+    }
+
     //
     // Measure handoff tables, Boot#### variables etc.
     //
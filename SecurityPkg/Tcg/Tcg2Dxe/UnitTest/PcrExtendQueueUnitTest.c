@@ -0,0 +1,569 @@
+/** @file
+  Unit tests of the PCR extend queue of Tcg2Dxe.
+
+  Tpm2PcrExtend() is implemented by a simulated TPM with SHA-256 and SHA-384 banks,
+  which counts the commands sent while events are measured, at the flush points
+  and when the system is idle. Data events are queued, and the queue is flushed
+  before a PE image is extended. The simulated PCRs must match the event log,
+  less the events still queued.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <IndustryStandard/Tpm20.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/BaseCryptLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/Tpm2CommandLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../PcrExtendQueue.h"
+
+#define UNIT_TEST_NAME     "Tcg2Dxe PCR Extend Queue Unit Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+#define TEST_PCR_COUNT   8
+#define TEST_MAX_EVENTS  512
+
+typedef enum {
+  TpmPathMeasure,
+  TpmPathFlush,
+  TpmPathIdle,
+  TpmPathMax
+} TPM_PATH;
+
+typedef struct {
+  UINT8       Sha256[TEST_PCR_COUNT][SHA256_DIGEST_SIZE];
+  UINT8       Sha384[TEST_PCR_COUNT][SHA384_DIGEST_SIZE];
+  UINTN       Commands;
+  UINTN       FailAtCommand;
+  TPM_PATH    Path;
+  UINTN       PathCommands[TpmPathMax];
+} SIMULATED_TPM;
+
+typedef struct {
+  TPMI_DH_PCR           PcrIndex;
+  TPML_DIGEST_VALUES    DigestList;
+} TEST_EVENT;
+
+STATIC SIMULATED_TPM  mTpm;
+STATIC TEST_EVENT     mEventLog[TEST_MAX_EVENTS];
+STATIC UINTN          mEventCount;
+
+/**
+  Extend a PCR value of a bank with a digest.
+**/
+STATIC
+VOID
+ExtendPcrValue (
+  IN OUT UINT8        *PcrValue,
+  IN     CONST UINT8  *Digest,
+  IN     UINTN        DigestSize
+  )
+{
+  UINT8  Buffer[SHA384_DIGEST_SIZE * 2];
+
+  CopyMem (Buffer, PcrValue, DigestSize);
+  CopyMem (Buffer + DigestSize, Digest, DigestSize);
+  if (DigestSize == SHA256_DIGEST_SIZE) {
+    Sha256HashAll (Buffer, DigestSize * 2, PcrValue);
+  } else {
+    Sha384HashAll (Buffer, DigestSize * 2, PcrValue);
+  }
+}
+
+/**
+  Extend the PCRs of a simulated TPM with a digest list.
+**/
+STATIC
+VOID
+ExtendPcrs (
+  IN OUT SIMULATED_TPM       *Tpm,
+  IN     TPMI_DH_PCR         PcrHandle,
+  IN     TPML_DIGEST_VALUES  *Digests
+  )
+{
+  UINT32  Index;
+
+  for (Index = 0; Index < Digests->count; Index++) {
+    if (Digests->digests[Index].hashAlg == TPM_ALG_SHA256) {
+      ExtendPcrValue (Tpm->Sha256[PcrHandle], Digests->digests[Index].digest.sha256, SHA256_DIGEST_SIZE);
+    } else if (Digests->digests[Index].hashAlg == TPM_ALG_SHA384) {
+      ExtendPcrValue (Tpm->Sha384[PcrHandle], Digests->digests[Index].digest.sha384, SHA384_DIGEST_SIZE);
+    }
+  }
+}
+
+/**
+  TPM2_PCR_Extend of the simulated TPM.
+
+  @param[in] PcrHandle  Handle of the PCR
+  @param[in] Digests    List of tagged digest values to be extended
+
+  @retval EFI_SUCCESS      Operation completed successfully.
+  @retval EFI_DEVICE_ERROR The command failed.
+**/
+EFI_STATUS
+EFIAPI
+Tpm2PcrExtend (
+  IN      TPMI_DH_PCR         PcrHandle,
+  IN      TPML_DIGEST_VALUES  *Digests
+  )
+{
+  mTpm.Commands++;
+  mTpm.PathCommands[mTpm.Path]++;
+  if (mTpm.Commands == mTpm.FailAtCommand) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  if (PcrHandle >= TEST_PCR_COUNT) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  ExtendPcrs (&mTpm, PcrHandle, Digests);
+  return EFI_SUCCESS;
+}
+
+/**
+  Reset the simulated TPM, the event log and the queue.
+**/
+STATIC
+VOID
+ResetTest (
+  IN UINT32  Depth
+  )
+{
+  ZeroMem (&mTpm, sizeof (mTpm));
+  mEventCount = 0;
+  PcrExtendQueueInitialize (Depth);
+}
+
+/**
+  Log an event with the digests of data unique to it, and return it.
+**/
+STATIC
+TEST_EVENT *
+LogEvent (
+  IN TPMI_DH_PCR  PcrIndex
+  )
+{
+  TEST_EVENT  *Event;
+  UINT8       Data[64];
+  UINTN       Index;
+
+  ASSERT (mEventCount < TEST_MAX_EVENTS);
+
+  for (Index = 0; Index < sizeof (Data); Index++) {
+    Data[Index] = (UINT8)(mEventCount * 7 + Index);
+  }
+
+  Event                                = &mEventLog[mEventCount++];
+  Event->PcrIndex                      = PcrIndex;
+  Event->DigestList.count              = 2;
+  Event->DigestList.digests[0].hashAlg = TPM_ALG_SHA256;
+  Sha256HashAll (Data, sizeof (Data), Event->DigestList.digests[0].digest.sha256);
+  Event->DigestList.digests[1].hashAlg = TPM_ALG_SHA384;
+  Sha384HashAll (Data, sizeof (Data), Event->DigestList.digests[1].digest.sha384);
+  return Event;
+}
+
+/**
+  Measure a data event. Its extend is queued when the queue is enabled.
+**/
+STATIC
+EFI_STATUS
+MeasureData (
+  IN TPMI_DH_PCR  PcrIndex
+  )
+{
+  TEST_EVENT  *Event;
+
+  Event     = LogEvent (PcrIndex);
+  mTpm.Path = TpmPathMeasure;
+  return PcrExtendQueueAdd (Event->PcrIndex, &Event->DigestList);
+}
+
+/**
+  Measure a PE image. The queue is flushed first, and the image is extended at once.
+**/
+STATIC
+EFI_STATUS
+MeasureImage (
+  IN TPMI_DH_PCR  PcrIndex
+  )
+{
+  TEST_EVENT  *Event;
+  EFI_STATUS  Status;
+
+  mTpm.Path = TpmPathMeasure;
+  Status    = PcrExtendQueueFlush ();
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Event = LogEvent (PcrIndex);
+  return Tpm2PcrExtend (Event->PcrIndex, &Event->DigestList);
+}
+
+/**
+  Check that the simulated PCRs are the event log replayed, without the events
+  whose extends are still queued.
+**/
+STATIC
+BOOLEAN
+PcrsMatchEventLog (
+  VOID
+  )
+{
+  SIMULATED_TPM  *Replay;
+  UINTN          Index;
+  BOOLEAN        Match;
+
+  Replay = AllocateZeroPool (sizeof (*Replay));
+  ASSERT (Replay != NULL);
+
+  for (Index = 0; Index < mEventCount - PcrExtendQueueGetCount (); Index++) {
+    ExtendPcrs (Replay, mEventLog[Index].PcrIndex, &mEventLog[Index].DigestList);
+  }
+
+  Match = (BOOLEAN)(CompareMem (Replay->Sha256, mTpm.Sha256, sizeof (mTpm.Sha256)) == 0 &&
+                    CompareMem (Replay->Sha384, mTpm.Sha384, sizeof (mTpm.Sha384)) == 0);
+  FreePool (Replay);
+  return Match;
+}
+
+/**
+  Data events, images, flushes and idle time are interleaved. The PCRs
+  must match the event log, less the queued events, after each of them, and match
+  the whole log after each flush.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ExtendsFollowEventLog (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN       Step;
+  UINT32      Action;
+  EFI_STATUS  Status;
+
+  ResetTest (8);
+
+  //
+  // 7 and 16 are coprime, so each group of 16 steps goes through every action.
+  //
+  for (Step = 0; Step < 400; Step++) {
+    Action = (UINT32)(Step * 7 % 16);
+    if (Action < 10) {
+      Status = MeasureData ((TPMI_DH_PCR)(Step % TEST_PCR_COUNT));
+    } else if (Action < 12) {
+      Status = MeasureImage ((TPMI_DH_PCR)(Step % TEST_PCR_COUNT));
+      UT_ASSERT_EQUAL (PcrExtendQueueGetCount (), 0);
+    } else if (Action < 13) {
+      mTpm.Path = TpmPathFlush;
+      Status    = PcrExtendQueueFlush ();
+      UT_ASSERT_EQUAL (PcrExtendQueueGetCount (), 0);
+    } else {
+      mTpm.Path = TpmPathIdle;
+      Status    = PcrExtendQueueDrain (1);
+    }
+
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_TRUE (PcrExtendQueueGetCount () <= 8);
+    UT_ASSERT_TRUE (PcrsMatchEventLog ());
+  }
+
+  Status = PcrExtendQueueFlush ();
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_TRUE (PcrsMatchEventLog ());
+  UT_ASSERT_EQUAL (mTpm.Commands, mEventCount);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A full queue extends its oldest entry to make room, and a disabled queue extends
+  at once.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+QueueDepthIsBounded (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  ResetTest (4);
+  UT_ASSERT_TRUE (PcrExtendQueueIsEnabled ());
+  for (Index = 0; Index < 4; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (MeasureData (0));
+  }
+
+  UT_ASSERT_EQUAL (mTpm.Commands, 0);
+  UT_ASSERT_EQUAL (PcrExtendQueueGetCount (), 4);
+
+  UT_ASSERT_NOT_EFI_ERROR (MeasureData (1));
+  UT_ASSERT_EQUAL (mTpm.Commands, 1);
+  UT_ASSERT_EQUAL (PcrExtendQueueGetCount (), 4);
+  UT_ASSERT_TRUE (PcrsMatchEventLog ());
+
+  UT_ASSERT_NOT_EFI_ERROR (PcrExtendQueueFlush ());
+  UT_ASSERT_EQUAL (mTpm.Commands, 5);
+  UT_ASSERT_TRUE (PcrsMatchEventLog ());
+
+  ResetTest (0);
+  UT_ASSERT_FALSE (PcrExtendQueueIsEnabled ());
+  UT_ASSERT_NOT_EFI_ERROR (MeasureData (2));
+  UT_ASSERT_EQUAL (mTpm.Commands, 1);
+  UT_ASSERT_EQUAL (PcrExtendQueueGetCount (), 0);
+  UT_ASSERT_TRUE (PcrsMatchEventLog ());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  An extend that fails empties the queue, so that nothing is extended out of order
+  once Tcg2Dxe has disabled the TPM.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FailedExtendEmptiesQueue (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  ResetTest (8);
+  for (Index = 0; Index < 5; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (MeasureData ((TPMI_DH_PCR)Index));
+  }
+
+  mTpm.FailAtCommand = 3;
+  UT_ASSERT_STATUS_EQUAL (PcrExtendQueueFlush (), EFI_DEVICE_ERROR);
+  UT_ASSERT_EQUAL (mTpm.Commands, 3);
+  UT_ASSERT_EQUAL (PcrExtendQueueGetCount (), 0);
+
+  UT_ASSERT_NOT_EFI_ERROR (PcrExtendQueueFlush ());
+  UT_ASSERT_EQUAL (mTpm.Commands, 3);
+
+  mTpm.FailAtCommand = 4;
+  UT_ASSERT_STATUS_EQUAL (MeasureImage (0), EFI_DEVICE_ERROR);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Run a simulated boot with the given queue depth, and check that the PCRs match
+  the event log before the OS loader is extended.
+
+  Images are dispatched with two configuration events each, then the boot variables
+  and the separators are measured, with some idle time while the boot manager waits
+  for its timeout.
+**/
+STATIC
+UNIT_TEST_STATUS
+RunBoot (
+  IN UINT32  Depth,
+  IN UINTN   IdleSlots
+  )
+{
+  UINTN  Index;
+  UINTN  Event;
+
+  ResetTest (Depth);
+
+  //
+  // Driver dispatch: 120 images, each with two configuration events.
+  //
+  for (Index = 0; Index < 120; Index++) {
+    for (Event = 0; Event < 2; Event++) {
+      UT_ASSERT_NOT_EFI_ERROR (MeasureData (1));
+    }
+
+    UT_ASSERT_NOT_EFI_ERROR (MeasureImage (2));
+  }
+
+  //
+  // Secure Boot policy, handoff tables and boot variables.
+  //
+  for (Index = 0; Index < 48; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (MeasureData ((Index < 8) ? 7 : 1));
+  }
+
+  //
+  // Boot manager timeout.
+  //
+  mTpm.Path = TpmPathIdle;
+  for (Index = 0; Index < IdleSlots; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (PcrExtendQueueDrain (1));
+  }
+
+  //
+  // ReadyToBoot: the separators, then the flush before the OS loader.
+  //
+  for (Index = 0; Index < 7; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (MeasureData ((TPMI_DH_PCR)Index));
+  }
+
+  mTpm.Path = TpmPathFlush;
+  UT_ASSERT_NOT_EFI_ERROR (PcrExtendQueueFlush ());
+  UT_ASSERT_NOT_EFI_ERROR (MeasureImage (4));
+  UT_ASSERT_TRUE (PcrsMatchEventLog ());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A simulated boot sends the same extends with the queue disabled and enabled.
+  With the queue enabled, fewer of them are sent while events are measured, and
+  some are sent when the system is idle.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BootExtendsAreDeferred (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  Status;
+  UINTN             Synchronous;
+
+  Status = RunBoot (0, 0);
+  UT_ASSERT_EQUAL (Status, UNIT_TEST_PASSED);
+  Synchronous = mTpm.Commands;
+  UT_ASSERT_EQUAL (mTpm.PathCommands[TpmPathMeasure], Synchronous);
+
+  Status = RunBoot (16, 0);
+  UT_ASSERT_EQUAL (Status, UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (mTpm.Commands, Synchronous);
+
+  Status = RunBoot (64, 64);
+  UT_ASSERT_EQUAL (Status, UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (mTpm.Commands, Synchronous);
+  UT_ASSERT_TRUE (mTpm.PathCommands[TpmPathMeasure] < Synchronous);
+  UT_ASSERT_TRUE (mTpm.PathCommands[TpmPathIdle] > 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests and run them.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      QueueTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&QueueTests, Framework, "PCR Extend Queue Tests", "Tcg2Dxe.PcrExtendQueue", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for PCR Extend Queue\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (QueueTests, "PCRs follow the event log", "ExtendsFollowEventLog", ExtendsFollowEventLog, NULL, NULL, NULL);
+  AddTestCase (QueueTests, "Queue depth is bounded", "QueueDepthIsBounded", QueueDepthIsBounded, NULL, NULL, NULL);
+  AddTestCase (QueueTests, "Failed extend empties the queue", "FailedExtendEmptiesQueue", FailedExtendEmptiesQueue, NULL, NULL, NULL);
+  AddTestCase (QueueTests, "Boot extends are deferred", "BootExtendsAreDeferred", BootExtendsAreDeferred, NULL, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -25,8 +25,15 @@ typedef struct {
 
   EFI_GUID      HandlerType; // Type of interrupt
   LIST_ENTRY    MmiHandlers; // All handlers
+
+  LIST_ENTRY    HashLink; // Link on the hash bucket of HandlerType
 } MMI_ENTRY;
 
+//
+// Number of buckets of the MMI entry hash table, must be a power of 2.
+//
+#define MMI_ENTRY_HASH_BUCKETS  64
+
 #define MMI_HANDLER_SIGNATURE  SIGNATURE_32('m','m','i','h')
 
 typedef struct {
@@ -45,6 +52,19 @@ UINTN  mMmiManageCallingDepth = 0;
 LIST_ENTRY  mRootMmiHandlerList = INITIALIZE_LIST_HEAD_VARIABLE (mRootMmiHandlerList);
 LIST_ENTRY  mMmiEntryList       = INITIALIZE_LIST_HEAD_VARIABLE (mMmiEntryList);
 
+//
+// mMmiEntryHash holds the MMI entries hashed by handler type, so the MMI entry of
+// a handler type is found without walking mMmiEntryList.
+//
+LIST_ENTRY  mMmiEntryHash[MMI_ENTRY_HASH_BUCKETS];
+BOOLEAN     mMmiEntryHashInitialized = FALSE;
+
+//
+// mMmiEntryLastHit caches the last MMI entry found, as successive MMIs are often of
+// the same handler type.
+//
+MMI_ENTRY  *mMmiEntryLastHit = NULL;
+
 /**
   Remove MmiHandler and free the memory it used.
   If MmiEntry is empty, remove MmiEntry and free the memory it used.
@@ -70,7 +90,12 @@ RemoveMmiHandler (
   //
   if (MmiEntry != NULL) {
     if (IsListEmpty (&MmiEntry->MmiHandlers)) {
+      if (mMmiEntryLastHit == MmiEntry) {
+        mMmiEntryLastHit = NULL;
+      }
+
       RemoveEntryList (&MmiEntry->AllEntries);
+      RemoveEntryList (&MmiEntry->HashLink);
       FreePool (MmiEntry);
       return TRUE;
     }
@@ -79,6 +104,40 @@ RemoveMmiHandler (
   return FALSE;
 }
 
+/**
+  Returns the hash bucket of a handler type.
+
+  @param  HandlerType            The type of the interrupt
+
+  @return The hash bucket of HandlerType.
+
+**/
+LIST_ENTRY *
+MmiEntryHashBucket (
+  IN EFI_GUID  *HandlerType
+  )
+{
+  UINT32  Hash;
+  UINTN   Index;
+
+  if (!mMmiEntryHashInitialized) {
+    for (Index = 0; Index < MMI_ENTRY_HASH_BUCKETS; Index++) {
+      InitializeListHead (&mMmiEntryHash[Index]);
+    }
+
+    mMmiEntryHashInitialized = TRUE;
+  }
+
+  Hash  = ReadUnaligned32 ((UINT32 *)HandlerType);
+  Hash ^= ReadUnaligned32 ((UINT32 *)HandlerType + 1);
+  Hash ^= ReadUnaligned32 ((UINT32 *)HandlerType + 2);
+  Hash ^= ReadUnaligned32 ((UINT32 *)HandlerType + 3);
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+
+  return &mMmiEntryHash[Hash & (MMI_ENTRY_HASH_BUCKETS - 1)];
+}
+
 /**
   Finds the MMI entry for the requested handler type.
 
@@ -95,24 +154,37 @@ MmCoreFindMmiEntry (
   IN BOOLEAN   Create
   )
 {
+  LIST_ENTRY  *Bucket;
   LIST_ENTRY  *Link;
   MMI_ENTRY   *Item;
   MMI_ENTRY   *MmiEntry;
 
+  if ((mMmiEntryLastHit != NULL) && CompareGuid (&mMmiEntryLastHit->HandlerType, HandlerType)) {
+    return mMmiEntryLastHit;
+  }
+
   //
-  // Search the MMI entry list for the matching GUID
+  // Search the hash bucket for the matching GUID
   //
   MmiEntry = NULL;
-  for (Link = mMmiEntryList.ForwardLink;
-       Link != &mMmiEntryList;
+  Bucket   = MmiEntryHashBucket (HandlerType);
+  for (Link = Bucket->ForwardLink;
+       Link != Bucket;
        Link = Link->ForwardLink)
   {
-    Item = CR (Link, MMI_ENTRY, AllEntries, MMI_ENTRY_SIGNATURE);
+    Item = CR (Link, MMI_ENTRY, HashLink, MMI_ENTRY_SIGNATURE);
     if (CompareGuid (&Item->HandlerType, HandlerType)) {
       //
-      // This is the MMI entry
+      // This is the MMI entry, move it to the front of the bucket so the
+      // frequent handler types are found first.
       //
       MmiEntry = Item;
+      if (Link != Bucket->ForwardLink) {
+        RemoveEntryList (Link);
+        InsertHeadList (Bucket, Link);
+      }
+
+      mMmiEntryLastHit = MmiEntry;
       break;
     }
   }
@@ -132,9 +204,10 @@ MmCoreFindMmiEntry (
       InitializeListHead (&MmiEntry->MmiHandlers);
 
       //
-      // Add it to MMI entry list
+      // Add it to MMI entry list and hash table
       //
       InsertTailList (&mMmiEntryList, &MmiEntry->AllEntries);
+      InsertHeadList (Bucket, &MmiEntry->HashLink);
     }
   }
 
@@ -192,6 +265,7 @@ MmiManage (
       //
       // There is no handler registered for this interrupt source
       //
+      mMmiManageCallingDepth--;
       return Status;
     }
 
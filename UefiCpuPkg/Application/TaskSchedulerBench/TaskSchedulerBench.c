@@ -0,0 +1,271 @@
+/** @file
+  UEFI Application to benchmark TaskSchedulerLib.
+
+  Hashes a buffer with SHA-256 and zeroes a large buffer, first on the BSP only and
+  then in parallel on all the enabled processors, checks that both runs give the
+  same result and prints the time of each run.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiLib.h>
+#include <Library/TimerLib.h>
+#include <Library/BaseCryptLib.h>
+#include <Library/TaskSchedulerLib.h>
+
+#define BENCH_HASH_BLOCK_SIZE   SIZE_64KB
+#define BENCH_HASH_BLOCK_COUNT  512
+#define BENCH_ZERO_SIZE         SIZE_256MB
+#define BENCH_ZERO_CHUNK_SIZE   SIZE_1MB
+
+typedef struct {
+  UINT8    *Data;
+  UINT8    *Digest;
+  UINTN    WorkerCount;
+} BENCH_CONTEXT;
+
+/**
+  Get the time elapsed since a performance counter value.
+
+  @param[in]  Start  The performance counter value at the beginning of the run.
+
+  @return The elapsed time in microseconds.
+**/
+STATIC
+UINT64
+BenchElapsed (
+  IN UINT64  Start
+  )
+{
+  UINT64  End;
+  UINT64  StartValue;
+  UINT64  EndValue;
+
+  End = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&StartValue, &EndValue);
+  if (StartValue > EndValue) {
+    return DivU64x32 (GetTimeInNanoSecond (Start - End), 1000);
+  }
+
+  return DivU64x32 (GetTimeInNanoSecond (End - Start), 1000);
+}
+
+/**
+  Hash a range of blocks.
+
+  @param[in]  Worker   The worker running the range.
+  @param[in]  Start    First block.
+  @param[in]  End      Block following the last block.
+  @param[in]  Context  The BENCH_CONTEXT.
+**/
+STATIC
+VOID
+EFIAPI
+BenchHashRange (
+  IN TASK_WORKER  *Worker,
+  IN UINTN        Start,
+  IN UINTN        End,
+  IN VOID         *Context
+  )
+{
+  BENCH_CONTEXT  *Bench;
+  UINTN          Index;
+
+  Bench = (BENCH_CONTEXT *)Context;
+  if (Worker != NULL) {
+    Bench->WorkerCount = TaskSchedulerGetWorkerCount (Worker);
+  }
+
+  for (Index = Start; Index < End; Index++) {
+    Sha256HashAll (
+      Bench->Data + Index * BENCH_HASH_BLOCK_SIZE,
+      BENCH_HASH_BLOCK_SIZE,
+      Bench->Digest + Index * SHA256_DIGEST_SIZE
+      );
+  }
+}
+
+/**
+  Zero a range of chunks.
+
+  @param[in]  Worker   The worker running the range.
+  @param[in]  Start    First chunk.
+  @param[in]  End      Chunk following the last chunk.
+  @param[in]  Context  The BENCH_CONTEXT.
+**/
+STATIC
+VOID
+EFIAPI
+BenchZeroRange (
+  IN TASK_WORKER  *Worker,
+  IN UINTN        Start,
+  IN UINTN        End,
+  IN VOID         *Context
+  )
+{
+  BENCH_CONTEXT  *Bench;
+
+  Bench = (BENCH_CONTEXT *)Context;
+  ZeroMem (Bench->Data + Start * BENCH_ZERO_CHUNK_SIZE, (End - Start) * BENCH_ZERO_CHUNK_SIZE);
+}
+
+/**
+  Compare the serial and parallel SHA-256 of a buffer.
+
+  @retval EFI_SUCCESS           The digests match.
+  @retval EFI_OUT_OF_RESOURCES  The buffers cannot be allocated.
+  @retval EFI_ABORTED           The digests do not match.
+**/
+STATIC
+EFI_STATUS
+BenchHash (
+  VOID
+  )
+{
+  BENCH_CONTEXT  Bench;
+  UINT8          *Expected;
+  UINTN          Index;
+  UINT64         Start;
+  UINT64         Serial;
+  UINT64         Parallel;
+  EFI_STATUS     Status;
+
+  Bench.Data        = AllocatePages (EFI_SIZE_TO_PAGES (BENCH_HASH_BLOCK_COUNT * BENCH_HASH_BLOCK_SIZE));
+  Bench.Digest      = AllocateZeroPool (BENCH_HASH_BLOCK_COUNT * SHA256_DIGEST_SIZE);
+  Expected          = AllocateZeroPool (BENCH_HASH_BLOCK_COUNT * SHA256_DIGEST_SIZE);
+  Bench.WorkerCount = 1;
+  if ((Bench.Data == NULL) || (Bench.Digest == NULL) || (Expected == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  for (Index = 0; Index < BENCH_HASH_BLOCK_COUNT * BENCH_HASH_BLOCK_SIZE / sizeof (UINT32); Index++) {
+    ((UINT32 *)Bench.Data)[Index] = (UINT32)(Index * 0x9E3779B9);
+  }
+
+  Start = GetPerformanceCounter ();
+  BenchHashRange (NULL, 0, BENCH_HASH_BLOCK_COUNT, &Bench);
+  Serial = BenchElapsed (Start);
+  CopyMem (Expected, Bench.Digest, BENCH_HASH_BLOCK_COUNT * SHA256_DIGEST_SIZE);
+  ZeroMem (Bench.Digest, BENCH_HASH_BLOCK_COUNT * SHA256_DIGEST_SIZE);
+
+  Start = GetPerformanceCounter ();
+  TaskSchedulerParallelFor (NULL, 0, BENCH_HASH_BLOCK_COUNT, 1, BenchHashRange, &Bench);
+  Parallel = BenchElapsed (Start);
+
+  Status = EFI_SUCCESS;
+  if (CompareMem (Expected, Bench.Digest, BENCH_HASH_BLOCK_COUNT * SHA256_DIGEST_SIZE) != 0) {
+    Status = EFI_ABORTED;
+  }
+
+  Print (
+    L"SHA-256 %d x %d KB: serial %ld us, parallel %ld us on %d workers - %r\n",
+    BENCH_HASH_BLOCK_COUNT,
+    BENCH_HASH_BLOCK_SIZE / SIZE_1KB,
+    Serial,
+    Parallel,
+    (UINT32)Bench.WorkerCount,
+    Status
+    );
+
+Done:
+  if (Bench.Data != NULL) {
+    FreePages (Bench.Data, EFI_SIZE_TO_PAGES (BENCH_HASH_BLOCK_COUNT * BENCH_HASH_BLOCK_SIZE));
+  }
+
+  if (Bench.Digest != NULL) {
+    FreePool (Bench.Digest);
+  }
+
+  if (Expected != NULL) {
+    FreePool (Expected);
+  }
+
+  return Status;
+}
+
+/**
+  Compare the serial and parallel zeroing of a buffer.
+
+  @retval EFI_SUCCESS           The buffer is zeroed.
+  @retval EFI_OUT_OF_RESOURCES  The buffer cannot be allocated.
+  @retval EFI_ABORTED           The buffer is not zeroed.
+**/
+STATIC
+EFI_STATUS
+BenchZero (
+  VOID
+  )
+{
+  BENCH_CONTEXT  Bench;
+  UINT64         Start;
+  UINT64         Serial;
+  UINT64         Parallel;
+  EFI_STATUS     Status;
+
+  ZeroMem (&Bench, sizeof (Bench));
+  Bench.Data = AllocatePages (EFI_SIZE_TO_PAGES (BENCH_ZERO_SIZE));
+  if (Bench.Data == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  SetMem (Bench.Data, BENCH_ZERO_SIZE, 0xA5);
+  Start = GetPerformanceCounter ();
+  ZeroMem (Bench.Data, BENCH_ZERO_SIZE);
+  Serial = BenchElapsed (Start);
+
+  SetMem (Bench.Data, BENCH_ZERO_SIZE, 0xA5);
+  Start = GetPerformanceCounter ();
+  TaskSchedulerParallelFor (NULL, 0, BENCH_ZERO_SIZE / BENCH_ZERO_CHUNK_SIZE, 1, BenchZeroRange, &Bench);
+  Parallel = BenchElapsed (Start);
+
+  Status = EFI_SUCCESS;
+  if (!IsZeroBuffer (Bench.Data, BENCH_ZERO_SIZE)) {
+    Status = EFI_ABORTED;
+  }
+
+  Print (
+    L"ZeroMem %d MB: serial %ld us, parallel %ld us - %r\n",
+    BENCH_ZERO_SIZE / SIZE_1MB,
+    Serial,
+    Parallel,
+    Status
+    );
+
+  FreePages (Bench.Data, EFI_SIZE_TO_PAGES (BENCH_ZERO_SIZE));
+  return Status;
+}
+
+/**
+  The user Entry Point for Application. The user code starts with this function
+  as the real entry point for the application.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       The benchmarks passed.
+  @retval other             A benchmark failed.
+**/
+EFI_STATUS
+EFIAPI
+UefiMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS  Status;
+  EFI_STATUS  ZeroStatus;
+
+  Status     = BenchHash ();
+  ZeroStatus = BenchZero ();
+  if (!EFI_ERROR (Status)) {
+    Status = ZeroStatus;
+  }
+
+  return Status;
+}
@@ -0,0 +1,186 @@
+/** @file
+  Task scheduler running fork-join tasks on all the enabled processors.
+
+  TaskSchedulerRun() runs a root procedure on the BSP while every enabled AP runs a
+  worker loop. Each processor owns a deque of spawned tasks. A processor takes the
+  newest task of its own deque and, when it is empty, steals the oldest task of
+  another processor. Idle APs park in MWAIT when the processor supports it.
+
+  Tasks are fork-join: a task must wait for the tasks it spawned before it returns.
+  Task procedures run on APs, so they must only call services that are safe on APs.
+  The TASK_SCHEDULER_TASK storage is owned by the caller, typically on its stack, and
+  the library never allocates memory while tasks run.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef TASK_SCHEDULER_LIB_H_
+#define TASK_SCHEDULER_LIB_H_
+
+///
+/// Processor running a task, passed to every task procedure.
+///
+typedef struct _TASK_WORKER TASK_WORKER;
+
+/**
+  Procedure of a task.
+
+  @param[in]  Worker   The processor running the task.
+  @param[in]  Context  The context passed to TaskSchedulerSpawn().
+**/
+typedef
+VOID
+(EFIAPI *TASK_PROCEDURE)(
+  IN TASK_WORKER  *Worker,
+  IN VOID         *Context
+  );
+
+/**
+  Procedure run by TaskSchedulerParallelFor() on a range of indexes.
+
+  @param[in]  Worker   The processor running the range.
+  @param[in]  Start    First index of the range.
+  @param[in]  End      Index following the last index of the range.
+  @param[in]  Context  The context passed to TaskSchedulerParallelFor().
+**/
+typedef
+VOID
+(EFIAPI *TASK_RANGE_PROCEDURE)(
+  IN TASK_WORKER  *Worker,
+  IN UINTN        Start,
+  IN UINTN        End,
+  IN VOID         *Context
+  );
+
+///
+/// A spawned task, also used as its future. The fields are private to the library.
+///
+typedef struct {
+  TASK_PROCEDURE     Procedure;
+  VOID               *Context;
+  volatile UINT32    Done;
+  UINT32             Reserved;
+} TASK_SCHEDULER_TASK;
+
+/**
+  Run a procedure on the BSP with all the enabled APs available to run the tasks
+  it spawns, and return when it and all its tasks are done.
+
+  The procedure is run with the BSP as the only worker if the MP services are not
+  available, are busy, or the caller runs at a TPL that does not allow waiting for
+  the APs. TaskSchedulerRun() must be called on the BSP, tasks run nested parallel
+  work through their TASK_WORKER, for example with TaskSchedulerParallelFor().
+
+  @param[in]  Procedure  The root procedure.
+  @param[in]  Context    The context passed to Procedure.
+
+  @retval EFI_SUCCESS            Procedure and its tasks are done.
+  @retval EFI_INVALID_PARAMETER  Procedure is NULL.
+**/
+EFI_STATUS
+EFIAPI
+TaskSchedulerRun (
+  IN TASK_PROCEDURE  Procedure,
+  IN VOID            *Context
+  );
+
+/**
+  Spawn a task that may be run by any worker.
+
+  If the deque of the worker is full, the task is run before the function returns.
+
+  @param[in]  Worker     The worker spawning the task.
+  @param[out] Task       Storage of the task, valid until TaskSchedulerWait() returns.
+  @param[in]  Procedure  The procedure of the task.
+  @param[in]  Context    The context passed to Procedure.
+**/
+VOID
+EFIAPI
+TaskSchedulerSpawn (
+  IN  TASK_WORKER          *Worker,
+  OUT TASK_SCHEDULER_TASK  *Task,
+  IN  TASK_PROCEDURE       Procedure,
+  IN  VOID                 *Context
+  );
+
+/**
+  Wait for a task to be done. The worker runs other tasks while it waits.
+
+  @param[in]  Worker  The worker that spawned the task.
+  @param[in]  Task    The task to wait for.
+**/
+VOID
+EFIAPI
+TaskSchedulerWait (
+  IN TASK_WORKER          *Worker,
+  IN TASK_SCHEDULER_TASK  *Task
+  );
+
+/**
+  Check whether a task is done, without waiting.
+
+  @param[in]  Task  The task to check.
+
+  @retval TRUE   The task is done.
+  @retval FALSE  The task is queued or running.
+**/
+BOOLEAN
+EFIAPI
+TaskSchedulerIsDone (
+  IN TASK_SCHEDULER_TASK  *Task
+  );
+
+/**
+  Run a procedure on the ranges of [Start, End), split in ranges of at most
+  Grain indexes that are run in parallel.
+
+  @param[in]  Worker     The calling worker, or NULL to run the loop in its own
+                         TaskSchedulerRun().
+  @param[in]  Start      First index.
+  @param[in]  End        Index following the last index.
+  @param[in]  Grain      Maximum number of indexes of a range, 0 is handled as 1.
+  @param[in]  Procedure  The procedure run on each range.
+  @param[in]  Context    The context passed to Procedure.
+
+  @retval EFI_SUCCESS            Procedure has been run on all the ranges.
+  @retval EFI_INVALID_PARAMETER  Procedure is NULL.
+**/
+EFI_STATUS
+EFIAPI
+TaskSchedulerParallelFor (
+  IN TASK_WORKER           *Worker  OPTIONAL,
+  IN UINTN                 Start,
+  IN UINTN                 End,
+  IN UINTN                 Grain,
+  IN TASK_RANGE_PROCEDURE  Procedure,
+  IN VOID                  *Context
+  );
+
+/**
+  Get the number of workers of the scheduler running a worker.
+
+  @param[in]  Worker  A worker.
+
+  @return The number of workers, including the BSP.
+**/
+UINTN
+EFIAPI
+TaskSchedulerGetWorkerCount (
+  IN TASK_WORKER  *Worker
+  );
+
+/**
+  Get the index of a worker, 0 for the BSP.
+
+  @param[in]  Worker  A worker.
+
+  @return The index of the worker, less than TaskSchedulerGetWorkerCount().
+**/
+UINTN
+EFIAPI
+TaskSchedulerGetWorkerIndex (
+  IN TASK_WORKER  *Worker
+  );
+
+#endif
@@ -0,0 +1,984 @@
+/** @file
+  Hierarchical SMM CPU Sync lib implementation.
+
+  It provides the same APIs as SmmCpuSyncLib, but reduces the contention between
+  CPUs on systems with many CPUs:
+  1. CPUs are split in groups of CPUs of the same package and die, of at most
+     PcdSmmCpuSyncGroupSize CPUs. Each group owns a check-in counter and a counter
+     of the APs signaling the BSP, each on its own cache line. An AP only updates
+     the counters of its group, and the BSP locks the door and waits for the APs
+     by walking the groups.
+  2. When PcdSmmCpuSyncPerCpuArrival is TRUE, CPUs check in through a flag on their
+     own cache line instead of the group counter, so check-in never contends with
+     other CPUs. Only the BSP walks the flags when it counts the arrived CPUs and
+     when it locks the door.
+
+  The semaphores releasing each AP are on their own cache line, as in SmmCpuSyncLib.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+#include <PiMm.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/HobLib.h>
+#include <Library/LocalApicLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/SafeIntLib.h>
+#include <Library/SmmCpuSyncLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Guid/MpInformation2.h>
+
+///
+/// The implementation shall place one semaphore on exclusive cache line for good performance.
+///
+typedef volatile UINT32 SMM_CPU_SYNC_SEMAPHORE;
+
+///
+/// Per-CPU arrival flag: the epoch of the SMI in the upper bits, and the state bits below.
+///
+#define SMM_CPU_SYNC_ARRIVED      BIT0
+#define SMM_CPU_SYNC_LOCKED       BIT1
+#define SMM_CPU_SYNC_STATE_MASK   (SMM_CPU_SYNC_ARRIVED | SMM_CPU_SYNC_LOCKED)
+#define SMM_CPU_SYNC_EPOCH_SHIFT  2
+
+///
+/// Group key used for the CPUs without topology information.
+///
+#define SMM_CPU_SYNC_NO_TOPOLOGY  BIT63
+
+typedef struct {
+  ///
+  /// Used for control each CPU continue run or wait for signal
+  ///
+  SMM_CPU_SYNC_SEMAPHORE    *Run;
+  ///
+  /// Arrival flag of the CPU, used when PcdSmmCpuSyncPerCpuArrival is TRUE
+  ///
+  SMM_CPU_SYNC_SEMAPHORE    *Arrived;
+  ///
+  /// Index of the group of the CPU
+  ///
+  UINTN                     Group;
+} SMM_CPU_SYNC_SEMAPHORE_FOR_EACH_CPU;
+
+typedef struct {
+  ///
+  /// Before the door is locked, CpuCount stores the arrived CPU count of the group.
+  /// After the door is locked, CpuCount is set to -1.
+  ///
+  SMM_CPU_SYNC_SEMAPHORE    *CpuCount;
+  ///
+  /// Number of APs of the group that released the BSP and are not waited yet.
+  ///
+  SMM_CPU_SYNC_SEMAPHORE    *Signal;
+} SMM_CPU_SYNC_GROUP;
+
+struct SMM_CPU_SYNC_CONTEXT  {
+  ///
+  /// Indicate all CPUs in the system.
+  ///
+  UINTN                                  NumberOfCpus;
+  ///
+  /// Address of semaphores.
+  ///
+  VOID                                   *SemBuffer;
+  ///
+  /// Size of semaphores.
+  ///
+  UINTN                                  SemBufferPages;
+  ///
+  /// The arrived CPU count when the door was locked.
+  ///
+  UINTN                                  ArrivedCpuCountUponLock;
+  ///
+  /// Check in through the per-CPU arrival flags.
+  ///
+  BOOLEAN                                PerCpuArrival;
+  ///
+  /// Epoch of the arrival flags, incremented by SmmCpuSyncContextReset().
+  ///
+  volatile UINT32                        Epoch;
+  ///
+  /// The groups of CPUs.
+  ///
+  UINTN                                  GroupCount;
+  SMM_CPU_SYNC_GROUP                     *Group;
+  ///
+  /// Define an array of structure for each CPU semaphore due to the size alignment
+  /// requirement. With the array of structure for each CPU semaphore, it's easy to
+  /// reach the specific CPU with CPU Index for its own semaphore access: CpuSem[CpuIndex].
+  ///
+  SMM_CPU_SYNC_SEMAPHORE_FOR_EACH_CPU    CpuSem[];
+};
+
+/**
+  Performs an atomic compare exchange operation to get semaphore.
+  The compare exchange operation must be performed using MP safe
+  mechanisms.
+
+  @param[in,out]  Sem    IN:  32-bit unsigned integer
+                         OUT: original integer - 1 if Sem is not locked.
+                         OUT: MAX_UINT32 if Sem is locked.
+
+  @retval     Original integer - 1 if Sem is not locked.
+              MAX_UINT32 if Sem is locked.
+
+**/
+STATIC
+UINT32
+InternalWaitForSemaphore (
+  IN OUT  volatile UINT32  *Sem
+  )
+{
+  UINT32  Value;
+
+  for ( ; ;) {
+    Value = *Sem;
+    if (Value == MAX_UINT32) {
+      return Value;
+    }
+
+    if ((Value != 0) &&
+        (InterlockedCompareExchange32 (
+           (UINT32 *)Sem,
+           Value,
+           Value - 1
+           ) == Value))
+    {
+      break;
+    }
+
+    CpuPause ();
+  }
+
+  return Value - 1;
+}
+
+/**
+  Performs an atomic compare exchange operation to release semaphore.
+  The compare exchange operation must be performed using MP safe
+  mechanisms.
+
+  @param[in,out]  Sem    IN:  32-bit unsigned integer
+                         OUT: original integer + 1 if Sem is not locked.
+                         OUT: MAX_UINT32 if Sem is locked.
+
+  @retval    Original integer + 1 if Sem is not locked.
+             MAX_UINT32 if Sem is locked.
+
+**/
+STATIC
+UINT32
+InternalReleaseSemaphore (
+  IN OUT  volatile UINT32  *Sem
+  )
+{
+  UINT32  Value;
+
+  do {
+    Value = *Sem;
+  } while (Value + 1 != 0 &&
+           InterlockedCompareExchange32 (
+             (UINT32 *)Sem,
+             Value,
+             Value + 1
+             ) != Value);
+
+  if (Value == MAX_UINT32) {
+    return Value;
+  }
+
+  return Value + 1;
+}
+
+/**
+  Performs an atomic compare exchange operation to lock semaphore.
+  The compare exchange operation must be performed using MP safe
+  mechanisms.
+
+  @param[in,out]  Sem    IN:  32-bit unsigned integer
+                         OUT: -1
+
+  @retval    Original integer
+
+**/
+STATIC
+UINT32
+InternalLockdownSemaphore (
+  IN OUT  volatile UINT32  *Sem
+  )
+{
+  UINT32  Value;
+
+  do {
+    Value = *Sem;
+  } while (InterlockedCompareExchange32 (
+             (UINT32 *)Sem,
+             Value,
+             (UINT32)-1
+             ) != Value);
+
+  return Value;
+}
+
+/**
+  Get the value of an arrival flag of the current epoch with no state bit set.
+
+  @param[in]  Context     Pointer to the SMM CPU Sync context object.
+
+  @return The value of the arrival flag.
+**/
+STATIC
+UINT32
+InternalCurrentEpoch (
+  IN SMM_CPU_SYNC_CONTEXT  *Context
+  )
+{
+  return Context->Epoch << SMM_CPU_SYNC_EPOCH_SHIFT;
+}
+
+/**
+  Get the topology key of each CPU from the MP information HOBs. CPUs with the same
+  key are in the same package and die.
+
+  @param[in]   NumberOfCpus  The number of Logical Processors in the system.
+  @param[out]  Key           The key of each CPU.
+**/
+STATIC
+VOID
+InternalGetCpuTopologyKeys (
+  IN  UINTN   NumberOfCpus,
+  OUT UINT64  *Key
+  )
+{
+  EFI_HOB_GUID_TYPE         *GuidHob;
+  MP_INFORMATION2_HOB_DATA  *MpInformation2HobData;
+  MP_INFORMATION2_ENTRY     *MpInformation2Entry;
+  UINTN                     Index;
+  UINT64                    CpuIndex;
+  UINT32                    Package;
+  UINT32                    Die;
+  UINTN                     GroupSize;
+
+  //
+  // CPUs not described by the HOBs, such as hot-pluggable CPUs, are grouped by
+  // CPU index.
+  //
+  GroupSize = MAX (PcdGet32 (PcdSmmCpuSyncGroupSize), 1);
+  for (Index = 0; Index < NumberOfCpus; Index++) {
+    Key[Index] = SMM_CPU_SYNC_NO_TOPOLOGY | (Index / GroupSize);
+  }
+
+  GuidHob = GetFirstGuidHob (&gMpInformation2HobGuid);
+  while (GuidHob != NULL) {
+    MpInformation2HobData = GET_GUID_HOB_DATA (GuidHob);
+    if (MpInformation2HobData->NumberOfProcessors == 0) {
+      break;
+    }
+
+    for (Index = 0; Index < MpInformation2HobData->NumberOfProcessors; Index++) {
+      CpuIndex = MpInformation2HobData->ProcessorIndex + Index;
+      if (CpuIndex >= NumberOfCpus) {
+        break;
+      }
+
+      MpInformation2Entry = GET_MP_INFORMATION_ENTRY (MpInformation2HobData, Index);
+      GetProcessorLocation2ByApicId (
+        (UINT32)MpInformation2Entry->ProcessorInfo.ProcessorId,
+        &Package,
+        &Die,
+        NULL,
+        NULL,
+        NULL,
+        NULL
+        );
+      Key[CpuIndex] = LShiftU64 (Package, 32) | Die;
+    }
+
+    GuidHob = GetNextGuidHob (&gMpInformation2HobGuid, GET_NEXT_HOB (GuidHob));
+  }
+}
+
+/**
+  Split the CPUs in groups of CPUs of the same package and die, of at most
+  PcdSmmCpuSyncGroupSize CPUs.
+
+  @param[in,out]  Context     Pointer to the SMM CPU Sync context object, with
+                              NumberOfCpus set.
+
+  @retval RETURN_SUCCESS            The CPUs are split in Context->GroupCount groups.
+  @retval RETURN_OUT_OF_RESOURCES   There are not enough resources available.
+
+**/
+STATIC
+RETURN_STATUS
+InternalGroupCpus (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context
+  )
+{
+  UINT64  *CpuKey;
+  UINT64  *GroupKey;
+  UINTN   *GroupCpuCount;
+  UINTN   GroupSize;
+  UINTN   CpuIndex;
+  UINTN   Group;
+
+  CpuKey        = AllocatePool (Context->NumberOfCpus * sizeof (UINT64));
+  GroupKey      = AllocatePool (Context->NumberOfCpus * sizeof (UINT64));
+  GroupCpuCount = AllocateZeroPool (Context->NumberOfCpus * sizeof (UINTN));
+  if ((CpuKey == NULL) || (GroupKey == NULL) || (GroupCpuCount == NULL)) {
+    if (CpuKey != NULL) {
+      FreePool (CpuKey);
+    }
+
+    if (GroupKey != NULL) {
+      FreePool (GroupKey);
+    }
+
+    if (GroupCpuCount != NULL) {
+      FreePool (GroupCpuCount);
+    }
+
+    return RETURN_OUT_OF_RESOURCES;
+  }
+
+  InternalGetCpuTopologyKeys (Context->NumberOfCpus, CpuKey);
+
+  GroupSize           = MAX (PcdGet32 (PcdSmmCpuSyncGroupSize), 1);
+  Context->GroupCount = 0;
+  for (CpuIndex = 0; CpuIndex < Context->NumberOfCpus; CpuIndex++) {
+    for (Group = 0; Group < Context->GroupCount; Group++) {
+      if ((GroupKey[Group] == CpuKey[CpuIndex]) && (GroupCpuCount[Group] < GroupSize)) {
+        break;
+      }
+    }
+
+    if (Group == Context->GroupCount) {
+      GroupKey[Group] = CpuKey[CpuIndex];
+      Context->GroupCount++;
+    }
+
+    GroupCpuCount[Group]++;
+    Context->CpuSem[CpuIndex].Group = Group;
+  }
+
+  DEBUG ((DEBUG_INFO, "SmmCpuSync: %d CPUs in %d groups\n", Context->NumberOfCpus, Context->GroupCount));
+
+  FreePool (CpuKey);
+  FreePool (GroupKey);
+  FreePool (GroupCpuCount);
+  return RETURN_SUCCESS;
+}
+
+/**
+  Create and initialize the SMM CPU Sync context. It is to allocate and initialize the
+  SMM CPU Sync context.
+
+  If Context is NULL, then ASSERT().
+
+  @param[in]  NumberOfCpus          The number of Logical Processors in the system.
+  @param[out] Context               Pointer to the new created and initialized SMM CPU Sync context object.
+                                    NULL will be returned if any error happen during init.
+
+  @retval RETURN_SUCCESS            The SMM CPU Sync context was successful created and initialized.
+  @retval RETURN_OUT_OF_RESOURCES   There are not enough resources available to create and initialize SMM CPU Sync context.
+  @retval RETURN_BUFFER_TOO_SMALL   Overflow happen
+
+**/
+RETURN_STATUS
+EFIAPI
+SmmCpuSyncContextInit (
+  IN   UINTN                 NumberOfCpus,
+  OUT  SMM_CPU_SYNC_CONTEXT  **Context
+  )
+{
+  RETURN_STATUS                        Status;
+  UINTN                                ContextSize;
+  UINTN                                OneSemSize;
+  UINTN                                NumSem;
+  UINTN                                TotalSemSize;
+  UINTN                                SemAddr;
+  UINTN                                CpuIndex;
+  UINTN                                Group;
+  SMM_CPU_SYNC_SEMAPHORE_FOR_EACH_CPU  *CpuSem;
+
+  ASSERT (Context != NULL);
+
+  //
+  // Calculate ContextSize
+  //
+  Status = SafeUintnMult (NumberOfCpus, sizeof (SMM_CPU_SYNC_SEMAPHORE_FOR_EACH_CPU), &ContextSize);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = SafeUintnAdd (ContextSize, sizeof (SMM_CPU_SYNC_CONTEXT), &ContextSize);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Allocate Buffer for Context
+  //
+  *Context = AllocateZeroPool (ContextSize);
+  if (*Context == NULL) {
+    return RETURN_OUT_OF_RESOURCES;
+  }
+
+  (*Context)->NumberOfCpus  = NumberOfCpus;
+  (*Context)->PerCpuArrival = FixedPcdGetBool (PcdSmmCpuSyncPerCpuArrival);
+
+  Status = InternalGroupCpus (*Context);
+  if (RETURN_ERROR (Status)) {
+    goto ON_ERROR;
+  }
+
+  (*Context)->Group = AllocatePool ((*Context)->GroupCount * sizeof (SMM_CPU_SYNC_GROUP));
+  if ((*Context)->Group == NULL) {
+    Status = RETURN_OUT_OF_RESOURCES;
+    goto ON_ERROR;
+  }
+
+  //
+  // Calculate total semaphore size: 2 semaphores for each group and each CPU.
+  //
+  OneSemSize = GetSpinLockProperties ();
+  ASSERT (sizeof (SMM_CPU_SYNC_SEMAPHORE) <= OneSemSize);
+
+  Status = SafeUintnAdd ((*Context)->GroupCount, NumberOfCpus, &NumSem);
+  if (RETURN_ERROR (Status)) {
+    goto ON_ERROR;
+  }
+
+  Status = SafeUintnMult (NumSem, 2 * OneSemSize, &TotalSemSize);
+  if (RETURN_ERROR (Status)) {
+    goto ON_ERROR;
+  }
+
+  //
+  // Allocate for Semaphores in the *Context
+  //
+  (*Context)->SemBufferPages = EFI_SIZE_TO_PAGES (TotalSemSize);
+  (*Context)->SemBuffer      = AllocatePages ((*Context)->SemBufferPages);
+  if ((*Context)->SemBuffer == NULL) {
+    Status = RETURN_OUT_OF_RESOURCES;
+    goto ON_ERROR;
+  }
+
+  //
+  // Assign Group Semaphore pointer
+  //
+  SemAddr = (UINTN)(*Context)->SemBuffer;
+  for (Group = 0; Group < (*Context)->GroupCount; Group++) {
+    (*Context)->Group[Group].CpuCount  = (SMM_CPU_SYNC_SEMAPHORE *)SemAddr;
+    *(*Context)->Group[Group].CpuCount = 0;
+    SemAddr                           += OneSemSize;
+
+    (*Context)->Group[Group].Signal  = (SMM_CPU_SYNC_SEMAPHORE *)SemAddr;
+    *(*Context)->Group[Group].Signal = 0;
+    SemAddr                         += OneSemSize;
+  }
+
+  //
+  // Assign CPU Semaphore pointer
+  //
+  CpuSem = (*Context)->CpuSem;
+  for (CpuIndex = 0; CpuIndex < NumberOfCpus; CpuIndex++) {
+    CpuSem->Run  = (SMM_CPU_SYNC_SEMAPHORE *)SemAddr;
+    *CpuSem->Run = 0;
+    SemAddr     += OneSemSize;
+
+    CpuSem->Arrived  = (SMM_CPU_SYNC_SEMAPHORE *)SemAddr;
+    *CpuSem->Arrived = 0;
+    SemAddr         += OneSemSize;
+
+    CpuSem++;
+  }
+
+  //
+  // Epoch 0 is the value of the arrival flags when they are allocated.
+  //
+  (*Context)->Epoch = 1;
+
+  return RETURN_SUCCESS;
+
+ON_ERROR:
+  if ((*Context)->Group != NULL) {
+    FreePool ((*Context)->Group);
+  }
+
+  FreePool (*Context);
+  *Context = NULL;
+  return Status;
+}
+
+/**
+  Deinit an allocated SMM CPU Sync context. The resources allocated in SmmCpuSyncContextInit() will
+  be freed.
+
+  If Context is NULL, then ASSERT().
+
+  @param[in,out]  Context     Pointer to the SMM CPU Sync context object to be deinitialized.
+
+**/
+VOID
+EFIAPI
+SmmCpuSyncContextDeinit (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context
+  )
+{
+  ASSERT (Context != NULL);
+
+  FreePages (Context->SemBuffer, Context->SemBufferPages);
+
+  FreePool (Context->Group);
+
+  FreePool (Context);
+}
+
+/**
+  Reset SMM CPU Sync context. SMM CPU Sync context will be reset to the initialized state.
+
+  This function is called by one of CPUs after all CPUs are ready to exit SMI, which allows CPU to
+  check into the next SMI from this point.
+
+  If Context is NULL, then ASSERT().
+
+  @param[in,out]  Context     Pointer to the SMM CPU Sync context object to be reset.
+
+**/
+VOID
+EFIAPI
+SmmCpuSyncContextReset (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context
+  )
+{
+  UINTN  Group;
+
+  ASSERT (Context != NULL);
+
+  Context->ArrivedCpuCountUponLock = 0;
+
+  if (Context->PerCpuArrival) {
+    //
+    // The arrival flags of the previous epoch are all obsolete, no need to clear them.
+    //
+    Context->Epoch = (Context->Epoch + 1) & (MAX_UINT32 >> SMM_CPU_SYNC_EPOCH_SHIFT);
+    return;
+  }
+
+  for (Group = 0; Group < Context->GroupCount; Group++) {
+    *Context->Group[Group].CpuCount = 0;
+  }
+}
+
+/**
+  Get current number of arrived CPU in SMI.
+
+  BSP might need to know the current number of arrived CPU in SMI to make sure all APs
+  in SMI. This API can be for that purpose.
+
+  If Context is NULL, then ASSERT().
+
+  @param[in]      Context     Pointer to the SMM CPU Sync context object.
+
+  @retval    Current number of arrived CPU in SMI.
+
+**/
+UINTN
+EFIAPI
+SmmCpuSyncGetArrivedCpuCount (
+  IN  SMM_CPU_SYNC_CONTEXT  *Context
+  )
+{
+  UINTN   Index;
+  UINTN   Count;
+  UINT32  Value;
+  UINT32  Arrived;
+
+  ASSERT (Context != NULL);
+
+  Count = 0;
+  if (Context->PerCpuArrival) {
+    //
+    // Arrival flags are never cleared by the door lock, the count is always exact.
+    //
+    Arrived = InternalCurrentEpoch (Context) | SMM_CPU_SYNC_ARRIVED;
+    for (Index = 0; Index < Context->NumberOfCpus; Index++) {
+      if ((*Context->CpuSem[Index].Arrived & ~SMM_CPU_SYNC_LOCKED) == Arrived) {
+        Count++;
+      }
+    }
+
+    return Count;
+  }
+
+  for (Index = 0; Index < Context->GroupCount; Index++) {
+    Value = *Context->Group[Index].CpuCount;
+    if (Value == (UINT32)-1) {
+      return Context->ArrivedCpuCountUponLock;
+    }
+
+    Count += Value;
+  }
+
+  return Count;
+}
+
+/**
+  Performs an atomic operation to check in CPU.
+
+  When SMI happens, all processors including BSP enter to SMM mode by calling SmmCpuSyncCheckInCpu().
+
+  If Context is NULL, then ASSERT().
+  If CpuIndex exceeds the range of all CPUs in the system, then ASSERT().
+
+  @param[in,out]  Context           Pointer to the SMM CPU Sync context object.
+  @param[in]      CpuIndex          Check in CPU index.
+
+  @retval RETURN_SUCCESS            Check in CPU (CpuIndex) successfully.
+  @retval RETURN_ABORTED            Check in CPU failed due to SmmCpuSyncLockDoor() has been called by one elected CPU.
+
+**/
+RETURN_STATUS
+EFIAPI
+SmmCpuSyncCheckInCpu (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context,
+  IN     UINTN                 CpuIndex
+  )
+{
+  UINT32  Epoch;
+  UINT32  Value;
+
+  ASSERT (Context != NULL);
+
+  ASSERT (CpuIndex < Context->NumberOfCpus);
+
+  if (Context->PerCpuArrival) {
+    //
+    // Only the BSP locking the door may update the flag concurrently.
+    //
+    Epoch = InternalCurrentEpoch (Context);
+    Value = *Context->CpuSem[CpuIndex].Arrived;
+    if (((Value & ~SMM_CPU_SYNC_STATE_MASK) == Epoch) && ((Value & SMM_CPU_SYNC_LOCKED) != 0)) {
+      return RETURN_ABORTED;
+    }
+
+    if (InterlockedCompareExchange32 (
+          (UINT32 *)Context->CpuSem[CpuIndex].Arrived,
+          Value,
+          Epoch | SMM_CPU_SYNC_ARRIVED
+          ) != Value)
+    {
+      return RETURN_ABORTED;
+    }
+
+    return RETURN_SUCCESS;
+  }
+
+  //
+  // Check to return if CpuCount has already been locked.
+  //
+  if (InternalReleaseSemaphore (Context->Group[Context->CpuSem[CpuIndex].Group].CpuCount) == MAX_UINT32) {
+    return RETURN_ABORTED;
+  }
+
+  return RETURN_SUCCESS;
+}
+
+/**
+  Performs an atomic operation to check out CPU.
+
+  This function can be called in error handling flow for the CPU who calls CheckInCpu() earlier.
+  The caller shall make sure the CPU specified by CpuIndex has already checked-in.
+
+  If Context is NULL, then ASSERT().
+  If CpuIndex exceeds the range of all CPUs in the system, then ASSERT().
+
+  @param[in,out]  Context           Pointer to the SMM CPU Sync context object.
+  @param[in]      CpuIndex          Check out CPU index.
+
+  @retval RETURN_SUCCESS            Check out CPU (CpuIndex) successfully.
+  @retval RETURN_ABORTED            Check out CPU failed due to SmmCpuSyncLockDoor() has been called by one elected CPU.
+
+**/
+RETURN_STATUS
+EFIAPI
+SmmCpuSyncCheckOutCpu (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context,
+  IN     UINTN                 CpuIndex
+  )
+{
+  UINT32  Epoch;
+
+  ASSERT (Context != NULL);
+
+  ASSERT (CpuIndex < Context->NumberOfCpus);
+
+  if (Context->PerCpuArrival) {
+    Epoch = InternalCurrentEpoch (Context);
+    if (InterlockedCompareExchange32 (
+          (UINT32 *)Context->CpuSem[CpuIndex].Arrived,
+          Epoch | SMM_CPU_SYNC_ARRIVED,
+          Epoch
+          ) != (Epoch | SMM_CPU_SYNC_ARRIVED))
+    {
+      return RETURN_ABORTED;
+    }
+
+    return RETURN_SUCCESS;
+  }
+
+  if (InternalWaitForSemaphore (Context->Group[Context->CpuSem[CpuIndex].Group].CpuCount) == MAX_UINT32) {
+    return RETURN_ABORTED;
+  }
+
+  return RETURN_SUCCESS;
+}
+
+/**
+  Performs an atomic operation lock door for CPU checkin and checkout. After this function:
+  CPU can not check in via SmmCpuSyncCheckInCpu().
+  CPU can not check out via SmmCpuSyncCheckOutCpu().
+
+  The CPU specified by CpuIndex is elected to lock door. The caller shall make sure the CpuIndex
+  is the actual CPU calling this function to avoid the undefined behavior.
+
+  If Context is NULL, then ASSERT().
+  If CpuCount is NULL, then ASSERT().
+  If CpuIndex exceeds the range of all CPUs in the system, then ASSERT().
+
+  @param[in,out]  Context           Pointer to the SMM CPU Sync context object.
+  @param[in]      CpuIndex          Indicate which CPU to lock door.
+  @param[out]     CpuCount          Number of arrived CPU in SMI after look door.
+
+**/
+VOID
+EFIAPI
+SmmCpuSyncLockDoor (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context,
+  IN     UINTN                 CpuIndex,
+  OUT UINTN                    *CpuCount
+  )
+{
+  UINTN   Index;
+  UINTN   Count;
+  UINT32  Epoch;
+  UINT32  Value;
+  UINT32  NewValue;
+
+  ASSERT (Context != NULL);
+
+  ASSERT (CpuCount != NULL);
+
+  ASSERT (CpuIndex < Context->NumberOfCpus);
+
+  //
+  // Temporarily record the arrived CPU count into the ArrivedCpuCountUponLock before
+  // locking the groups one by one, so that SmmCpuSyncGetArrivedCpuCount() returns a
+  // meaningful value while the door is being locked.
+  //
+  Context->ArrivedCpuCountUponLock = SmmCpuSyncGetArrivedCpuCount (Context);
+
+  Count = 0;
+  if (Context->PerCpuArrival) {
+    Epoch = InternalCurrentEpoch (Context);
+    for (Index = 0; Index < Context->NumberOfCpus; Index++) {
+      do {
+        Value    = *Context->CpuSem[Index].Arrived;
+        NewValue = ((Value & ~SMM_CPU_SYNC_STATE_MASK) == Epoch) ? Value : Epoch;
+        NewValue = NewValue | SMM_CPU_SYNC_LOCKED;
+      } while (InterlockedCompareExchange32 ((UINT32 *)Context->CpuSem[Index].Arrived, Value, NewValue) != Value);
+
+      if ((NewValue & SMM_CPU_SYNC_ARRIVED) != 0) {
+        Count++;
+      }
+    }
+  } else {
+    for (Index = 0; Index < Context->GroupCount; Index++) {
+      Count += InternalLockdownSemaphore (Context->Group[Index].CpuCount);
+    }
+  }
+
+  //
+  // Update the ArrivedCpuCountUponLock
+  //
+  Context->ArrivedCpuCountUponLock = Count;
+  *CpuCount                        = Count;
+}
+
+/**
+  Used by the BSP to wait for APs.
+
+  The number of APs need to be waited is specified by NumberOfAPs. The BSP is specified by BspIndex.
+  The caller shall make sure the BspIndex is the actual CPU calling this function to avoid the undefined behavior.
+  The caller shall make sure the NumberOfAPs have already checked-in to avoid the undefined behavior.
+
+  If Context is NULL, then ASSERT().
+  If NumberOfAPs >= All CPUs in system, then ASSERT().
+  If BspIndex exceeds the range of all CPUs in the system, then ASSERT().
+
+  Note:
+  This function is blocking mode, and it will return only after the number of APs released by
+  calling SmmCpuSyncReleaseBsp():
+  BSP: WaitForAPs    <--  AP: ReleaseBsp
+
+  @param[in,out]  Context           Pointer to the SMM CPU Sync context object.
+  @param[in]      NumberOfAPs       Number of APs need to be waited by BSP.
+  @param[in]      BspIndex          The BSP Index to wait for APs.
+
+**/
+VOID
+EFIAPI
+SmmCpuSyncWaitForAPs (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context,
+  IN     UINTN                 NumberOfAPs,
+  IN     UINTN                 BspIndex
+  )
+{
+  UINTN   Group;
+  UINT32  Value;
+  UINT32  Taken;
+
+  ASSERT (Context != NULL);
+
+  ASSERT (NumberOfAPs < Context->NumberOfCpus);
+
+  ASSERT (BspIndex < Context->NumberOfCpus);
+
+  //
+  // Take the signals of each group in one atomic operation instead of one by one.
+  //
+  while (NumberOfAPs > 0) {
+    for (Group = 0; Group < Context->GroupCount && NumberOfAPs > 0; Group++) {
+      Value = *Context->Group[Group].Signal;
+      if (Value == 0) {
+        continue;
+      }
+
+      Taken = (UINT32)MIN (Value, NumberOfAPs);
+      if (InterlockedCompareExchange32 ((UINT32 *)Context->Group[Group].Signal, Value, Value - Taken) == Value) {
+        NumberOfAPs -= Taken;
+      }
+    }
+
+    if (NumberOfAPs > 0) {
+      CpuPause ();
+    }
+  }
+}
+
+/**
+  Used by the BSP to release one AP.
+
+  The AP is specified by CpuIndex. The BSP is specified by BspIndex.
+  The caller shall make sure the BspIndex is the actual CPU calling this function to avoid the undefined behavior.
+  The caller shall make sure the CpuIndex has already checked-in to avoid the undefined behavior.
+
+  If Context is NULL, then ASSERT().
+  If CpuIndex == BspIndex, then ASSERT().
+  If BspIndex or CpuIndex exceed the range of all CPUs in the system, then ASSERT().
+
+  @param[in,out]  Context           Pointer to the SMM CPU Sync context object.
+  @param[in]      CpuIndex          Indicate which AP need to be released.
+  @param[in]      BspIndex          The BSP Index to release AP.
+
+**/
+VOID
+EFIAPI
+SmmCpuSyncReleaseOneAp   (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context,
+  IN     UINTN                 CpuIndex,
+  IN     UINTN                 BspIndex
+  )
+{
+  ASSERT (Context != NULL);
+
+  ASSERT (BspIndex != CpuIndex);
+
+  ASSERT (CpuIndex < Context->NumberOfCpus);
+
+  ASSERT (BspIndex < Context->NumberOfCpus);
+
+  InternalReleaseSemaphore (Context->CpuSem[CpuIndex].Run);
+}
+
+/**
+  Used by the AP to wait BSP.
+
+  The AP is specified by CpuIndex.
+  The caller shall make sure the CpuIndex is the actual CPU calling this function to avoid the undefined behavior.
+  The BSP is specified by BspIndex.
+
+  If Context is NULL, then ASSERT().
+  If CpuIndex == BspIndex, then ASSERT().
+  If BspIndex or CpuIndex exceed the range of all CPUs in the system, then ASSERT().
+
+  Note:
+  This function is blocking mode, and it will return only after the AP released by
+  calling SmmCpuSyncReleaseOneAp():
+  BSP: ReleaseOneAp  -->  AP: WaitForBsp
+
+  @param[in,out]  Context          Pointer to the SMM CPU Sync context object.
+  @param[in]      CpuIndex         Indicate which AP wait BSP.
+  @param[in]      BspIndex         The BSP Index to be waited.
+
+**/
+VOID
+EFIAPI
+SmmCpuSyncWaitForBsp (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context,
+  IN     UINTN                 CpuIndex,
+  IN     UINTN                 BspIndex
+  )
+{
+  ASSERT (Context != NULL);
+
+  ASSERT (BspIndex != CpuIndex);
+
+  ASSERT (CpuIndex < Context->NumberOfCpus);
+
+  ASSERT (BspIndex < Context->NumberOfCpus);
+
+  InternalWaitForSemaphore (Context->CpuSem[CpuIndex].Run);
+}
+
+/**
+  Used by the AP to release BSP.
+
+  The AP is specified by CpuIndex.
+  The caller shall make sure the CpuIndex is the actual CPU calling this function to avoid the undefined behavior.
+  The BSP is specified by BspIndex.
+
+  If Context is NULL, then ASSERT().
+  If CpuIndex == BspIndex, then ASSERT().
+  If BspIndex or CpuIndex exceed the range of all CPUs in the system, then ASSERT().
+
+  @param[in,out]  Context           Pointer to the SMM CPU Sync context object.
+  @param[in]      CpuIndex          Indicate which AP release BSP.
+  @param[in]      BspIndex          The BSP Index to be released.
+
+**/
+VOID
+EFIAPI
+SmmCpuSyncReleaseBsp (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context,
+  IN     UINTN                 CpuIndex,
+  IN     UINTN                 BspIndex
+  )
+{
+  ASSERT (Context != NULL);
+
+  ASSERT (BspIndex != CpuIndex);
+
+  ASSERT (CpuIndex < Context->NumberOfCpus);
+
+  ASSERT (BspIndex < Context->NumberOfCpus);
+
+  //
+  // The AP only contends with the APs of its own group.
+  //
+  InternalReleaseSemaphore (Context->Group[Context->CpuSem[CpuIndex].Group].Signal);
+}
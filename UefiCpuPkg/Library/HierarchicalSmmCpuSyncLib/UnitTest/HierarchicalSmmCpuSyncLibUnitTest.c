@@ -0,0 +1,418 @@
+/** @file
+  Unit tests of the Hierarchical SMM CPU Sync Library.
+
+  Each CPU is a POSIX thread that goes through the SMI flow of PiSmmCpuDxeSmm for
+  a number of epochs: all CPUs check in, one CPU checks out again, the BSP locks
+  the door, a late CPU fails to check in, and the BSP and the APs hand over
+  several times before the BSP resets the context for the next epoch. The BSP,
+  the late CPU and the CPU checking out change from one epoch to the other.
+
+  The test is built once with the group counters and once with the per-CPU
+  arrival flags, see PcdSmmCpuSyncPerCpuArrival.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <pthread.h>
+
+#include <PiMm.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/HobLib.h>
+#include <Library/LocalApicLib.h>
+#include <Library/PcdLib.h>
+#include <Library/SmmCpuSyncLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/UnitTestLib.h>
+#include <Guid/MpInformation2.h>
+
+#define UNIT_TEST_APP_NAME     "Hierarchical SMM CPU Sync Library Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define SYNC_TEST_MAX_CPUS  16
+#define SYNC_TEST_EPOCHS    24
+#define SYNC_TEST_ROUNDS    3
+
+//
+// Number of CPUs described by the MP information HOB, and number of CPUs of
+// each package, when the topology is reported.
+//
+#define SYNC_TEST_TOPOLOGY_CPUS  8
+#define SYNC_TEST_PACKAGE_CPUS   6
+#define SYNC_TEST_HOB_SIZE       (sizeof (EFI_HOB_GUID_TYPE) + sizeof (MP_INFORMATION2_HOB_DATA) +\
+                                  SYNC_TEST_TOPOLOGY_CPUS * sizeof (MP_INFORMATION2_ENTRY))
+
+typedef struct {
+  UINT32     GroupSize;
+  UINTN      NumberOfCpus;
+  BOOLEAN    Topology;
+} SYNC_TEST_CONFIG;
+
+typedef struct {
+  SMM_CPU_SYNC_CONTEXT    *Context;
+  UINTN                   NumberOfCpus;
+  pthread_barrier_t       Barrier;
+  //
+  // CPUs that completed their check in, or their check in and check out.
+  //
+  volatile UINT32         Ready;
+  volatile UINT32         DoorLocked;
+  //
+  // Number of times the APs ran between ReleaseOneAp() and ReleaseBsp().
+  //
+  volatile UINT32         Work;
+  volatile UINT32         Errors;
+} SYNC_TEST_STATE;
+
+SYNC_TEST_STATE  mState;
+
+BOOLEAN  mTopology;
+UINT64   mHobBuffer[(SYNC_TEST_HOB_SIZE + sizeof (UINT64) - 1) / sizeof (UINT64)];
+
+SYNC_TEST_CONFIG  mGroupsOfOne         = { 1, 10, FALSE };
+SYNC_TEST_CONFIG  mGroupsOfThree       = { 3, 10, FALSE };
+SYNC_TEST_CONFIG  mGroupsOfFour        = { 4, 10, FALSE };
+SYNC_TEST_CONFIG  mSingleGroup         = { 32, 10, FALSE };
+SYNC_TEST_CONFIG  mThreeCpus           = { 2, 3, FALSE };
+SYNC_TEST_CONFIG  mGroupsOfFourPackage = { 4, 10, TRUE };
+
+//
+// Record a failure of a CPU thread. UT_ASSERT_*() cannot be used outside of the
+// test thread.
+//
+#define SYNC_CHECK(Expression)                                                       \
+  do {                                                                               \
+    if (!(Expression)) {                                                             \
+      DEBUG ((                                                                       \
+        DEBUG_ERROR,                                                                 \
+        "CPU %d epoch %d line %d: %a\n",                                             \
+        CpuIndex,                                                                    \
+        Epoch,                                                                       \
+        __LINE__,                                                                    \
+        #Expression                                                                  \
+        ));                                                                          \
+      InterlockedIncrement (&mState.Errors);                                         \
+    }                                                                                \
+  } while (FALSE)
+
+//
+// Symbol Definitions
+// These are not directly under test - but required to link HierarchicalSmmCpuSyncLib.c.
+// When the topology is reported, one MP information HOB describes the first
+// SYNC_TEST_TOPOLOGY_CPUS CPUs, whose APIC ID is their CPU index, and the other
+// CPUs are grouped as hot-pluggable CPUs.
+//
+
+VOID *
+EFIAPI
+GetFirstGuidHob (
+  IN CONST EFI_GUID  *Guid
+  )
+{
+  EFI_HOB_GUID_TYPE         *GuidHob;
+  MP_INFORMATION2_HOB_DATA  *MpInformation2HobData;
+  MP_INFORMATION2_ENTRY     *MpInformation2Entry;
+  UINTN                     Index;
+
+  if (!mTopology || !CompareGuid (Guid, &gMpInformation2HobGuid)) {
+    return NULL;
+  }
+
+  ZeroMem (mHobBuffer, sizeof (mHobBuffer));
+  GuidHob                   = (EFI_HOB_GUID_TYPE *)mHobBuffer;
+  GuidHob->Header.HobType   = EFI_HOB_TYPE_GUID_EXTENSION;
+  GuidHob->Header.HobLength = (UINT16)sizeof (mHobBuffer);
+  CopyGuid (&GuidHob->Name, &gMpInformation2HobGuid);
+
+  MpInformation2HobData                     = GET_GUID_HOB_DATA (GuidHob);
+  MpInformation2HobData->NumberOfProcessors = SYNC_TEST_TOPOLOGY_CPUS;
+  MpInformation2HobData->EntrySize          = sizeof (MP_INFORMATION2_ENTRY);
+  MpInformation2HobData->ProcessorIndex     = 0;
+  for (Index = 0; Index < SYNC_TEST_TOPOLOGY_CPUS; Index++) {
+    MpInformation2Entry                            = GET_MP_INFORMATION_ENTRY (MpInformation2HobData, Index);
+    MpInformation2Entry->ProcessorInfo.ProcessorId = Index;
+  }
+
+  return GuidHob;
+}
+
+VOID *
+EFIAPI
+GetNextGuidHob (
+  IN CONST EFI_GUID  *Guid,
+  IN CONST VOID      *HobStart
+  )
+{
+  return NULL;
+}
+
+VOID
+EFIAPI
+GetProcessorLocation2ByApicId (
+  IN  UINT32  InitialApicId,
+  OUT UINT32  *Package  OPTIONAL,
+  OUT UINT32  *Die      OPTIONAL,
+  OUT UINT32  *Tile     OPTIONAL,
+  OUT UINT32  *Module   OPTIONAL,
+  OUT UINT32  *Core     OPTIONAL,
+  OUT UINT32  *Thread   OPTIONAL
+  )
+{
+  if (Package != NULL) {
+    *Package = InitialApicId / SYNC_TEST_PACKAGE_CPUS;
+  }
+
+  if (Die != NULL) {
+    *Die = 0;
+  }
+}
+
+/**
+  Get the roles of the CPUs in an epoch.
+
+  @param[in]   Epoch         The epoch.
+  @param[in]   NumberOfCpus  The number of CPUs, at least 3.
+  @param[out]  BspIndex      The BSP.
+  @param[out]  LateCpu       The AP checking in after the door is locked, or
+                             MAX_UINTN if all APs check in before.
+  @param[out]  CheckOutCpu   The AP checking out before the door is locked.
+**/
+STATIC
+VOID
+GetRoles (
+  IN  UINTN  Epoch,
+  IN  UINTN  NumberOfCpus,
+  OUT UINTN  *BspIndex,
+  OUT UINTN  *LateCpu,
+  OUT UINTN  *CheckOutCpu
+  )
+{
+  UINTN  Late;
+
+  *BspIndex = (Epoch * 7) % NumberOfCpus;
+  Late      = (*BspIndex + 1 + Epoch % (NumberOfCpus - 1)) % NumberOfCpus;
+
+  *CheckOutCpu = (*BspIndex + NumberOfCpus - 1) % NumberOfCpus;
+  if (*CheckOutCpu == Late) {
+    *CheckOutCpu = (Late + NumberOfCpus - 1) % NumberOfCpus;
+  }
+
+  *LateCpu = ((Epoch % 4) == 3) ? MAX_UINTN : Late;
+}
+
+/**
+  Run the SMI flow of all the epochs on one CPU.
+
+  @param[in]  Argument  The CPU index.
+
+  @return NULL.
+**/
+STATIC
+VOID *
+CpuThread (
+  IN VOID  *Argument
+  )
+{
+  SMM_CPU_SYNC_CONTEXT  *Context;
+  UINTN                 CpuIndex;
+  UINTN                 NumberOfCpus;
+  UINTN                 Epoch;
+  UINTN                 Round;
+  UINTN                 Index;
+  UINTN                 BspIndex;
+  UINTN                 LateCpu;
+  UINTN                 CheckOutCpu;
+  UINTN                 Arrived;
+  UINTN                 CpuCount;
+
+  Context      = mState.Context;
+  CpuIndex     = (UINTN)Argument;
+  NumberOfCpus = mState.NumberOfCpus;
+
+  for (Epoch = 0; Epoch < SYNC_TEST_EPOCHS; Epoch++) {
+    GetRoles (Epoch, NumberOfCpus, &BspIndex, &LateCpu, &CheckOutCpu);
+    Arrived = NumberOfCpus - 1 - ((LateCpu == MAX_UINTN) ? 0 : 1);
+
+    if (CpuIndex == LateCpu) {
+      while (mState.DoorLocked == 0) {
+        CpuPause ();
+      }
+
+      SYNC_CHECK (SmmCpuSyncCheckInCpu (Context, CpuIndex) == RETURN_ABORTED);
+    } else {
+      SYNC_CHECK (SmmCpuSyncCheckInCpu (Context, CpuIndex) == RETURN_SUCCESS);
+      if (CpuIndex == CheckOutCpu) {
+        SYNC_CHECK (SmmCpuSyncCheckOutCpu (Context, CpuIndex) == RETURN_SUCCESS);
+      }
+
+      InterlockedIncrement (&mState.Ready);
+    }
+
+    if (CpuIndex == BspIndex) {
+      while (mState.Ready < ((LateCpu == MAX_UINTN) ? NumberOfCpus : NumberOfCpus - 1)) {
+        CpuPause ();
+      }
+
+      SYNC_CHECK (SmmCpuSyncGetArrivedCpuCount (Context) == Arrived);
+      SmmCpuSyncLockDoor (Context, CpuIndex, &CpuCount);
+      SYNC_CHECK (CpuCount == Arrived);
+      SYNC_CHECK (SmmCpuSyncGetArrivedCpuCount (Context) == Arrived);
+      mState.DoorLocked = 1;
+
+      for (Round = 1; Round <= SYNC_TEST_ROUNDS; Round++) {
+        for (Index = 0; Index < NumberOfCpus; Index++) {
+          if ((Index != BspIndex) && (Index != LateCpu) && (Index != CheckOutCpu)) {
+            SmmCpuSyncReleaseOneAp (Context, Index, BspIndex);
+          }
+        }
+
+        SmmCpuSyncWaitForAPs (Context, Arrived - 1, BspIndex);
+        SYNC_CHECK (mState.Work == Round * (Arrived - 1));
+      }
+    } else if ((CpuIndex != LateCpu) && (CpuIndex != CheckOutCpu)) {
+      for (Round = 1; Round <= SYNC_TEST_ROUNDS; Round++) {
+        SmmCpuSyncWaitForBsp (Context, CpuIndex, BspIndex);
+        InterlockedIncrement (&mState.Work);
+        SmmCpuSyncReleaseBsp (Context, CpuIndex, BspIndex);
+      }
+    }
+
+    //
+    // All CPUs are ready to exit SMI. The late CPU did not change the count.
+    //
+    pthread_barrier_wait (&mState.Barrier);
+    if (CpuIndex == BspIndex) {
+      SYNC_CHECK (SmmCpuSyncGetArrivedCpuCount (Context) == Arrived);
+      SmmCpuSyncContextReset (Context);
+      SYNC_CHECK (SmmCpuSyncGetArrivedCpuCount (Context) == 0);
+      mState.Ready      = 0;
+      mState.DoorLocked = 0;
+      mState.Work       = 0;
+    }
+
+    pthread_barrier_wait (&mState.Barrier);
+  }
+
+  return NULL;
+}
+
+/**
+  Run SYNC_TEST_EPOCHS SMIs on the CPUs and with the group size of the config.
+
+  @param[in]  Context  The SYNC_TEST_CONFIG of the test.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SynchronizeEpochs (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SYNC_TEST_CONFIG  *Config;
+  RETURN_STATUS     Status;
+  pthread_t         Threads[SYNC_TEST_MAX_CPUS];
+  UINTN             Index;
+
+  Config = (SYNC_TEST_CONFIG *)Context;
+  UT_ASSERT_TRUE (Config->NumberOfCpus >= 3 && Config->NumberOfCpus <= SYNC_TEST_MAX_CPUS);
+
+  PatchPcdSet32 (PcdSmmCpuSyncGroupSize, Config->GroupSize);
+  mTopology = Config->Topology;
+
+  ZeroMem (&mState, sizeof (mState));
+  mState.NumberOfCpus = Config->NumberOfCpus;
+  Status              = SmmCpuSyncContextInit (Config->NumberOfCpus, &mState.Context);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (SmmCpuSyncGetArrivedCpuCount (mState.Context), 0);
+
+  UT_ASSERT_EQUAL (pthread_barrier_init (&mState.Barrier, NULL, (UINT32)Config->NumberOfCpus), 0);
+  for (Index = 0; Index < Config->NumberOfCpus; Index++) {
+    UT_ASSERT_EQUAL (pthread_create (&Threads[Index], NULL, CpuThread, (VOID *)Index), 0);
+  }
+
+  for (Index = 0; Index < Config->NumberOfCpus; Index++) {
+    pthread_join (Threads[Index], NULL);
+  }
+
+  pthread_barrier_destroy (&mState.Barrier);
+  SmmCpuSyncContextDeinit (mState.Context);
+
+  UT_ASSERT_EQUAL (mState.Errors, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  HierarchicalSmmCpuSyncLib and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UefiTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      SyncTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+  DEBUG ((DEBUG_INFO, "PcdSmmCpuSyncPerCpuArrival = %d\n", FixedPcdGetBool (PcdSmmCpuSyncPerCpuArrival)));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&SyncTests, Framework, "SMM CPU Sync Tests", "HierarchicalSmmCpuSyncLib.Sync", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for SMM CPU Sync Tests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (SyncTests, "10 CPUs in groups of 1 CPU", "GroupsOfOne", SynchronizeEpochs, NULL, NULL, &mGroupsOfOne);
+  AddTestCase (SyncTests, "10 CPUs in groups of 3 CPUs", "GroupsOfThree", SynchronizeEpochs, NULL, NULL, &mGroupsOfThree);
+  AddTestCase (SyncTests, "10 CPUs in groups of 4 CPUs", "GroupsOfFour", SynchronizeEpochs, NULL, NULL, &mGroupsOfFour);
+  AddTestCase (SyncTests, "10 CPUs in a single group", "SingleGroup", SynchronizeEpochs, NULL, NULL, &mSingleGroup);
+  AddTestCase (SyncTests, "3 CPUs in groups of 2 CPUs", "ThreeCpus", SynchronizeEpochs, NULL, NULL, &mThreeCpus);
+  AddTestCase (SyncTests, "10 CPUs in groups of 4 CPUs of the same package", "GroupsOfFourPackage", SynchronizeEpochs, NULL, NULL, &mGroupsOfFourPackage);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param Argc  Number of arguments.
+  @param Argv  Array of arguments.
+
+  @return Test application exit code.
+**/
+INT32
+main (
+  INT32  Argc,
+  CHAR8  *Argv[]
+  )
+{
+  return UefiTestMain ();
+}
@@ -0,0 +1,492 @@
+/** @file
+  Task scheduler running on the processors of EFI_MP_SERVICES_PROTOCOL.
+
+  The APs are started with a non-blocking StartupAllAPs() and run a session loop.
+  Each TaskSchedulerRun() publishes its scheduler by bumping a generation counter
+  the APs wait on, and joins them with a counter of finished APs that the BSP polls.
+
+  By default TaskSchedulerRun() ends the session and waits for MpInitLib to see the
+  APs idle before it returns, so that other StartupAllAPs() callers never find the
+  APs busy. The completion of a non-blocking StartupAllAPs() is only reported by a
+  timer of MpInitLib, so this costs up to one PcdCpuApStatusCheckIntervalInMicroSeconds
+  per run.
+
+  A platform may keep the APs in the session between runs with
+  PcdCpuTaskSchedulerLingerTimeInMicroSeconds. The session then ends when no run
+  starts for that time, before ExitBootServices() and when the image is unloaded.
+  Every module linking this library has its own session, and MpInitLib rejects the
+  StartupAllAPs() of other callers, including the session of another module, while
+  the APs linger.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "InternalTaskSchedulerLib.h"
+#include <Protocol/MpService.h>
+#include <Guid/EventGroup.h>
+#include <Library/PcdLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+typedef struct {
+  //
+  // Written by the BSP and monitored by the APs of the session.
+  //
+  volatile UINT32             Generation;
+  volatile UINT32             Exit;
+  TASK_SCHEDULER              *Scheduler;
+  BOOLEAN                     MwaitSupported;
+
+  //
+  // Written by the APs of the session.
+  //
+  UINT8                       Padding[TASK_CACHE_LINE_SIZE];
+  volatile UINT32             Resident;
+  volatile UINT32             Finished;
+
+  //
+  // Owned by the BSP. Busy and Active are changed at TPL_NOTIFY.
+  //
+  BOOLEAN                     Busy;
+  BOOLEAN                     Active;
+  //
+  // Set until MpInitLib reports the APs of the last session idle.
+  //
+  BOOLEAN                     Started;
+  EFI_MP_SERVICES_PROTOCOL    *MpServices;
+  UINTN                       ApCount;
+  EFI_EVENT                   WaitEvent;
+  EFI_EVENT                   LingerEvent;
+  EFI_EVENT                   ExitBootServicesEvent;
+} DXE_TASK_SCHEDULER_SESSION;
+
+DXE_TASK_SCHEDULER_SESSION  mTaskSchedulerSession;
+
+/**
+  AP procedure of a session. The AP joins the scheduler of every run published
+  by the BSP until the session ends.
+
+  @param[in]  Buffer  The DXE_TASK_SCHEDULER_SESSION.
+**/
+STATIC
+VOID
+EFIAPI
+DxeTaskSchedulerApProcedure (
+  IN VOID  *Buffer
+  )
+{
+  DXE_TASK_SCHEDULER_SESSION  *Session;
+  UINT32                      Generation;
+  UINTN                       Spin;
+
+  Session = (DXE_TASK_SCHEDULER_SESSION *)Buffer;
+  InterlockedIncrement (&Session->Resident);
+
+  //
+  // The generation is reset before the APs are started, so a run published
+  // before this AP gets here is not missed.
+  //
+  Generation = 0;
+  while (TRUE) {
+    for (Spin = 0; Spin < TASK_IDLE_SPIN_COUNT; Spin++) {
+      if ((Session->Generation != Generation) || (Session->Exit != 0)) {
+        break;
+      }
+
+      CpuPause ();
+    }
+
+    if (Session->MwaitSupported) {
+      AsmMonitor ((UINTN)&Session->Generation, 0, 0);
+      if ((Session->Generation == Generation) && (Session->Exit == 0)) {
+        AsmMwait (0, 0);
+      }
+    }
+
+    if (Session->Exit != 0) {
+      break;
+    }
+
+    if (Session->Generation == Generation) {
+      continue;
+    }
+
+    Generation = Session->Generation;
+    TaskSchedulerRunWorker (Session->Scheduler);
+    InterlockedIncrement (&Session->Finished);
+  }
+
+  InterlockedDecrement (&Session->Resident);
+}
+
+/**
+  Ask the APs of the session to return to MpInitLib.
+
+  Must be called at TPL_NOTIFY, or while the caller owns the session.
+
+  @param[in]  Session  The session.
+**/
+STATIC
+VOID
+DxeTaskSchedulerEndSession (
+  IN DXE_TASK_SCHEDULER_SESSION  *Session
+  )
+{
+  if (!Session->Active) {
+    return;
+  }
+
+  Session->Active = FALSE;
+  InterlockedCompareExchange32 (&Session->Exit, 0, 1);
+}
+
+/**
+  Wait for MpInitLib to see the APs of the last session idle.
+
+  Must be called below TPL_NOTIFY, after the session ended.
+
+  @param[in]  Session  The session.
+**/
+STATIC
+VOID
+DxeTaskSchedulerWaitForIdleAps (
+  IN DXE_TASK_SCHEDULER_SESSION  *Session
+  )
+{
+  if (!Session->Started) {
+    return;
+  }
+
+  while (gBS->CheckEvent (Session->WaitEvent) == EFI_NOT_READY) {
+    CpuPause ();
+  }
+
+  Session->Started = FALSE;
+}
+
+/**
+  Timer notification ending the session when no run started during its linger
+  time.
+
+  @param[in]  Event    The linger timer.
+  @param[in]  Context  The DXE_TASK_SCHEDULER_SESSION.
+**/
+STATIC
+VOID
+EFIAPI
+DxeTaskSchedulerLingerNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  DXE_TASK_SCHEDULER_SESSION  *Session;
+
+  //
+  // The notification may have been queued before a run claimed the session.
+  //
+  Session = (DXE_TASK_SCHEDULER_SESSION *)Context;
+  if (!Session->Busy) {
+    DxeTaskSchedulerEndSession (Session);
+  }
+}
+
+/**
+  Notification ending the session before ExitBootServices() relocates the APs.
+
+  @param[in]  Event    The event of the EFI_EVENT_GROUP_BEFORE_EXIT_BOOT_SERVICES group.
+  @param[in]  Context  The DXE_TASK_SCHEDULER_SESSION.
+**/
+STATIC
+VOID
+EFIAPI
+DxeTaskSchedulerExitBootServicesNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  DXE_TASK_SCHEDULER_SESSION  *Session;
+
+  Session = (DXE_TASK_SCHEDULER_SESSION *)Context;
+  DxeTaskSchedulerEndSession (Session);
+  while (Session->Resident != 0) {
+    CpuPause ();
+  }
+}
+
+/**
+  Start a session on all the enabled APs.
+
+  @param[in]  Session  The session, owned by the caller.
+
+  @retval EFI_SUCCESS  The APs run the session loop.
+  @retval Others       The APs could not be started.
+**/
+STATIC
+EFI_STATUS
+DxeTaskSchedulerStartSession (
+  IN DXE_TASK_SCHEDULER_SESSION  *Session
+  )
+{
+  EFI_STATUS              Status;
+  UINTN                   NumberOfProcessors;
+  UINTN                   NumberOfEnabledProcessors;
+  CPUID_VERSION_INFO_ECX  VersionInfoEcx;
+
+  if (Session->MpServices == NULL) {
+    Status = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **)&Session->MpServices);
+    if (EFI_ERROR (Status)) {
+      Session->MpServices = NULL;
+      return Status;
+    }
+
+    AsmCpuid (CPUID_VERSION_INFO, NULL, NULL, &VersionInfoEcx.Uint32, NULL);
+    Session->MwaitSupported = (BOOLEAN)(VersionInfoEcx.Bits.MONITOR == 1);
+  }
+
+  if (Session->WaitEvent == NULL) {
+    Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Session->WaitEvent);
+    if (EFI_ERROR (Status)) {
+      Session->WaitEvent = NULL;
+      return Status;
+    }
+  }
+
+  if ((Session->LingerEvent == NULL) && (PcdGet32 (PcdCpuTaskSchedulerLingerTimeInMicroSeconds) != 0)) {
+    Status = gBS->CreateEvent (
+                    EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                    TPL_NOTIFY,
+                    DxeTaskSchedulerLingerNotify,
+                    Session,
+                    &Session->LingerEvent
+                    );
+    if (EFI_ERROR (Status)) {
+      Session->LingerEvent = NULL;
+      return Status;
+    }
+  }
+
+  if (Session->ExitBootServicesEvent == NULL) {
+    Status = gBS->CreateEventEx (
+                    EVT_NOTIFY_SIGNAL,
+                    TPL_NOTIFY,
+                    DxeTaskSchedulerExitBootServicesNotify,
+                    Session,
+                    &gEfiEventBeforeExitBootServicesGuid,
+                    &Session->ExitBootServicesEvent
+                    );
+    if (EFI_ERROR (Status)) {
+      Session->ExitBootServicesEvent = NULL;
+      return Status;
+    }
+  }
+
+  Status = Session->MpServices->GetNumberOfProcessors (
+                                  Session->MpServices,
+                                  &NumberOfProcessors,
+                                  &NumberOfEnabledProcessors
+                                  );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (NumberOfEnabledProcessors <= 1) {
+    return EFI_NOT_STARTED;
+  }
+
+  //
+  // The APs of the previous session leave as soon as they see Exit, they must be
+  // gone before it is cleared.
+  //
+  while (Session->Resident != 0) {
+    CpuPause ();
+  }
+
+  //
+  // The wait event is checked by the destructor, drop the signal of the previous
+  // session.
+  //
+  gBS->CheckEvent (Session->WaitEvent);
+  Session->Generation = 0;
+  Session->Exit       = 0;
+  Session->ApCount    = NumberOfEnabledProcessors - 1;
+  Status              = Session->MpServices->StartupAllAPs (
+                                               Session->MpServices,
+                                               DxeTaskSchedulerApProcedure,
+                                               FALSE,
+                                               Session->WaitEvent,
+                                               0,
+                                               Session,
+                                               NULL
+                                               );
+  if (EFI_ERROR (Status)) {
+    //
+    // EFI_NOT_READY is returned when the APs are still busy, for example until
+    // MpInitLib sees the APs of the previous session idle.
+    //
+    DEBUG ((DEBUG_VERBOSE, "%a: StartupAllAPs - %r\n", __func__, Status));
+    return Status;
+  }
+
+  Session->Active  = TRUE;
+  Session->Started = TRUE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Run a procedure on the BSP with all the enabled APs available to run the tasks
+  it spawns, and return when it and all its tasks are done.
+
+  The procedure is run with the BSP as the only worker if the MP services are not
+  available, are busy, or the caller runs at a TPL that does not allow waiting for
+  the APs. TaskSchedulerRun() must be called on the BSP, tasks run nested parallel
+  work through their TASK_WORKER, for example with TaskSchedulerParallelFor().
+
+  @param[in]  Procedure  The root procedure.
+  @param[in]  Context    The context passed to Procedure.
+
+  @retval EFI_SUCCESS            Procedure and its tasks are done.
+  @retval EFI_INVALID_PARAMETER  Procedure is NULL.
+**/
+EFI_STATUS
+EFIAPI
+TaskSchedulerRun (
+  IN TASK_PROCEDURE  Procedure,
+  IN VOID            *Context
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_TPL                     OldTpl;
+  DXE_TASK_SCHEDULER_SESSION  *Session;
+  BOOLEAN                     Busy;
+  UINTN                       Pages;
+  VOID                        *Buffer;
+  TASK_SCHEDULER              Scheduler;
+
+  if (Procedure == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // The session is ended by notifications at TPL_NOTIFY, and MpInitLib reports
+  // that the APs of a session are gone with a timer at TPL_NOTIFY.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  gBS->RestoreTPL (OldTpl);
+  if (OldTpl >= TPL_NOTIFY) {
+    TaskSchedulerRunSerial (Procedure, Context);
+    return EFI_SUCCESS;
+  }
+
+  //
+  // A callback may run a scheduler while the BSP runs another one.
+  //
+  Session       = &mTaskSchedulerSession;
+  OldTpl        = gBS->RaiseTPL (TPL_NOTIFY);
+  Busy          = Session->Busy;
+  Session->Busy = TRUE;
+  gBS->RestoreTPL (OldTpl);
+  if (Busy) {
+    TaskSchedulerRunSerial (Procedure, Context);
+    return EFI_SUCCESS;
+  }
+
+  if (Session->LingerEvent != NULL) {
+    gBS->SetTimer (Session->LingerEvent, TimerCancel, 0);
+  }
+
+  Status = EFI_SUCCESS;
+  if (!Session->Active) {
+    Status = DxeTaskSchedulerStartSession (Session);
+  }
+
+  Buffer = NULL;
+  Pages  = 0;
+  if (!EFI_ERROR (Status)) {
+    Pages  = EFI_SIZE_TO_PAGES (TaskSchedulerGetBufferSize (Session->ApCount + 1));
+    Buffer = AllocatePages (Pages);
+  }
+
+  if (Buffer == NULL) {
+    TaskSchedulerRunSerial (Procedure, Context);
+  } else {
+    TaskSchedulerInitialize (&Scheduler, Session->ApCount + 1, Buffer, Procedure, Context);
+    Session->Scheduler = &Scheduler;
+    Session->Finished  = 0;
+    InterlockedIncrement (&Session->Generation);
+
+    TaskSchedulerRunRoot (&Scheduler);
+
+    //
+    // The APs leave the scheduler as soon as it is done, they do not touch it
+    // once they are counted.
+    //
+    while (Session->Finished != Session->ApCount) {
+      CpuPause ();
+    }
+
+    Session->Scheduler = NULL;
+    FreePages (Buffer, Pages);
+  }
+
+  if (Session->LingerEvent == NULL) {
+    //
+    // The APs must not stay busy once the run returns, the next StartupAllAPs()
+    // caller may not handle EFI_NOT_READY.
+    //
+    DxeTaskSchedulerEndSession (Session);
+    DxeTaskSchedulerWaitForIdleAps (Session);
+  }
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  if (Session->Active) {
+    gBS->SetTimer (
+           Session->LingerEvent,
+           TimerRelative,
+           MultU64x32 (PcdGet32 (PcdCpuTaskSchedulerLingerTimeInMicroSeconds), 10)
+           );
+  }
+
+  Session->Busy = FALSE;
+  gBS->RestoreTPL (OldTpl);
+  return EFI_SUCCESS;
+}
+
+/**
+  Destructor ending the session and waiting for MpInitLib to see the APs idle,
+  so that they do not run the code of an unloaded image.
+
+  @param[in]  ImageHandle  The firmware allocated handle for the EFI image.
+  @param[in]  SystemTable  A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS  The APs are out of the session loop.
+**/
+EFI_STATUS
+EFIAPI
+DxeTaskSchedulerLibDestructor (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  DXE_TASK_SCHEDULER_SESSION  *Session;
+  EFI_TPL                     OldTpl;
+
+  Session = &mTaskSchedulerSession;
+  OldTpl  = gBS->RaiseTPL (TPL_NOTIFY);
+  DxeTaskSchedulerEndSession (Session);
+  gBS->RestoreTPL (OldTpl);
+  DxeTaskSchedulerWaitForIdleAps (Session);
+
+  if (Session->LingerEvent != NULL) {
+    gBS->CloseEvent (Session->LingerEvent);
+  }
+
+  if (Session->ExitBootServicesEvent != NULL) {
+    gBS->CloseEvent (Session->ExitBootServicesEvent);
+  }
+
+  if (Session->WaitEvent != NULL) {
+    gBS->CloseEvent (Session->WaitEvent);
+  }
+
+  return EFI_SUCCESS;
+}
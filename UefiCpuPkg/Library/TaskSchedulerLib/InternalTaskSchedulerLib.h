@@ -0,0 +1,153 @@
+/** @file
+  Internal header file for the Task Scheduler Library.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef INTERNAL_TASK_SCHEDULER_LIB_H_
+#define INTERNAL_TASK_SCHEDULER_LIB_H_
+
+#include <Uefi.h>
+#include <Register/Cpuid.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/TaskSchedulerLib.h>
+
+//
+// Number of tasks a worker can queue. A worker whose deque is full runs the task
+// it spawns immediately.
+//
+#define TASK_DEQUE_SIZE  64
+
+//
+// Number of CpuPause() iterations an idle worker polls for work before it parks.
+//
+#define TASK_IDLE_SPIN_COUNT  0x400
+
+//
+// Workers are cache line aligned so that the deque of a worker does not share a
+// cache line with the deque of another worker.
+//
+#define TASK_CACHE_LINE_SIZE  64
+
+typedef struct _TASK_SCHEDULER TASK_SCHEDULER;
+
+struct _TASK_WORKER {
+  TASK_SCHEDULER         *Scheduler;
+  UINTN                  Index;
+  UINT32                 Seed;
+  //
+  // Protects Top, Bottom and Deque. The owner pushes and pops at Bottom, thieves
+  // steal at Top. Both are free running, so Bottom - Top is the number of tasks.
+  //
+  SPIN_LOCK              Lock;
+  volatile UINTN         Top;
+  volatile UINTN         Bottom;
+  TASK_SCHEDULER_TASK    *Deque[TASK_DEQUE_SIZE];
+};
+
+struct _TASK_SCHEDULER {
+  UINTN              WorkerCount;
+  UINTN              WorkerStride;
+  UINT8              *Workers;
+  BOOLEAN            MwaitSupported;
+  TASK_PROCEDURE     RootProcedure;
+  VOID               *RootContext;
+  //
+  // Phase specific data used by the AP procedure.
+  //
+  VOID               *PhaseContext;
+  UINTN              BspNumber;
+
+  //
+  // Shared counters, written by all the workers.
+  //
+  volatile UINT32    JoinedWorkers;
+  //
+  // Number of tasks in the deques.
+  //
+  volatile UINT32    Pending;
+  //
+  // Number of tasks spawned and not done.
+  //
+  volatile UINT32    Outstanding;
+  volatile UINT32    Sleepers;
+
+  //
+  // Idle workers monitor this cache line. It is written when a task is spawned
+  // while a worker sleeps and when the scheduler is done.
+  //
+  UINT8              Padding[TASK_CACHE_LINE_SIZE];
+  volatile UINT32    WorkSignal;
+  volatile UINT32    Done;
+};
+
+/**
+  Get the size of the buffer needed by a scheduler.
+
+  @param[in]  WorkerCount  Number of workers.
+
+  @return The size in bytes of the buffer to pass to TaskSchedulerInitialize().
+**/
+UINTN
+TaskSchedulerGetBufferSize (
+  IN UINTN  WorkerCount
+  );
+
+/**
+  Initialize a scheduler.
+
+  @param[out] Scheduler    The scheduler to initialize.
+  @param[in]  WorkerCount  Number of workers, including the BSP.
+  @param[in]  Buffer       Buffer of TaskSchedulerGetBufferSize() bytes, aligned on a
+                           cache line, holding the workers.
+  @param[in]  Procedure    The root procedure.
+  @param[in]  Context      The context passed to Procedure.
+**/
+VOID
+TaskSchedulerInitialize (
+  OUT TASK_SCHEDULER  *Scheduler,
+  IN  UINTN           WorkerCount,
+  IN  VOID            *Buffer,
+  IN  TASK_PROCEDURE  Procedure,
+  IN  VOID            *Context
+  );
+
+/**
+  Run the root procedure as worker 0, then wait for all the tasks to be done and
+  release the other workers.
+
+  @param[in]  Scheduler  The scheduler.
+**/
+VOID
+TaskSchedulerRunRoot (
+  IN TASK_SCHEDULER  *Scheduler
+  );
+
+/**
+  Join a scheduler as an AP and run tasks until the scheduler is done.
+
+  @param[in]  Scheduler  The scheduler.
+**/
+VOID
+TaskSchedulerRunWorker (
+  IN TASK_SCHEDULER  *Scheduler
+  );
+
+/**
+  Run a procedure with the calling processor as the only worker.
+
+  @param[in]  Procedure  The root procedure.
+  @param[in]  Context    The context passed to Procedure.
+**/
+VOID
+TaskSchedulerRunSerial (
+  IN TASK_PROCEDURE  Procedure,
+  IN VOID            *Context
+  );
+
+#endif
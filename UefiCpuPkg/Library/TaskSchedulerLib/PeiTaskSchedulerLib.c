@@ -0,0 +1,117 @@
+/** @file
+  Task scheduler running on the processors of EFI_PEI_MP_SERVICES2_PPI.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "InternalTaskSchedulerLib.h"
+#include <Ppi/MpServices2.h>
+#include <Library/PeiServicesLib.h>
+
+/**
+  Procedure run on all the processors. The BSP runs the root procedure, the APs
+  join the scheduler as workers.
+
+  @param[in]  Buffer  The TASK_SCHEDULER.
+**/
+STATIC
+VOID
+EFIAPI
+PeiTaskSchedulerProcedure (
+  IN VOID  *Buffer
+  )
+{
+  TASK_SCHEDULER            *Scheduler;
+  EFI_PEI_MP_SERVICES2_PPI  *MpServices;
+  UINTN                     ProcessorNumber;
+  EFI_STATUS                Status;
+
+  Scheduler  = (TASK_SCHEDULER *)Buffer;
+  MpServices = (EFI_PEI_MP_SERVICES2_PPI *)Scheduler->PhaseContext;
+  Status     = MpServices->WhoAmI (MpServices, &ProcessorNumber);
+  ASSERT_EFI_ERROR (Status);
+
+  if (ProcessorNumber == Scheduler->BspNumber) {
+    TaskSchedulerRunRoot (Scheduler);
+  } else {
+    TaskSchedulerRunWorker (Scheduler);
+  }
+}
+
+/**
+  Run a procedure on the BSP with all the enabled APs available to run the tasks
+  it spawns, and return when it and all its tasks are done.
+
+  The procedure is run with the BSP as the only worker if the MP services are not
+  available, are busy, or the caller runs at a TPL that does not allow waiting for
+  the APs. TaskSchedulerRun() must be called on the BSP, tasks run nested parallel
+  work through their TASK_WORKER, for example with TaskSchedulerParallelFor().
+
+  @param[in]  Procedure  The root procedure.
+  @param[in]  Context    The context passed to Procedure.
+
+  @retval EFI_SUCCESS            Procedure and its tasks are done.
+  @retval EFI_INVALID_PARAMETER  Procedure is NULL.
+**/
+EFI_STATUS
+EFIAPI
+TaskSchedulerRun (
+  IN TASK_PROCEDURE  Procedure,
+  IN VOID            *Context
+  )
+{
+  EFI_STATUS                Status;
+  EFI_PEI_MP_SERVICES2_PPI  *MpServices;
+  UINTN                     NumberOfProcessors;
+  UINTN                     NumberOfEnabledProcessors;
+  UINTN                     BspNumber;
+  UINTN                     Pages;
+  VOID                      *Buffer;
+  TASK_SCHEDULER            Scheduler;
+
+  if (Procedure == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = PeiServicesLocatePpi (&gEfiPeiMpServices2PpiGuid, 0, NULL, (VOID **)&MpServices);
+  if (!EFI_ERROR (Status)) {
+    Status = MpServices->GetNumberOfProcessors (MpServices, &NumberOfProcessors, &NumberOfEnabledProcessors);
+  }
+
+  if (!EFI_ERROR (Status)) {
+    Status = MpServices->WhoAmI (MpServices, &BspNumber);
+  }
+
+  if (EFI_ERROR (Status) || (NumberOfEnabledProcessors <= 1)) {
+    TaskSchedulerRunSerial (Procedure, Context);
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Pages rather than pool, the PEI pool cannot hold the workers of large systems.
+  //
+  Pages  = EFI_SIZE_TO_PAGES (TaskSchedulerGetBufferSize (NumberOfEnabledProcessors));
+  Buffer = AllocatePages (Pages);
+  if (Buffer == NULL) {
+    TaskSchedulerRunSerial (Procedure, Context);
+    return EFI_SUCCESS;
+  }
+
+  TaskSchedulerInitialize (&Scheduler, NumberOfEnabledProcessors, Buffer, Procedure, Context);
+  Scheduler.PhaseContext = MpServices;
+  Scheduler.BspNumber    = BspNumber;
+
+  //
+  // StartupAllCPUs() fails before running any processor, so the root procedure
+  // has not run when it returns an error.
+  //
+  Status = MpServices->StartupAllCPUs (MpServices, PeiTaskSchedulerProcedure, 0, &Scheduler);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_VERBOSE, "%a: StartupAllCPUs - %r, running serially\n", __func__, Status));
+    TaskSchedulerRunSerial (Procedure, Context);
+  }
+
+  FreePages (Buffer, Pages);
+  return EFI_SUCCESS;
+}
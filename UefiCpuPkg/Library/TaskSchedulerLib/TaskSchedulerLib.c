@@ -0,0 +1,606 @@
+/** @file
+  Work-stealing task scheduler common to the DXE and PEI instances.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "InternalTaskSchedulerLib.h"
+
+typedef struct {
+  UINTN                   Start;
+  UINTN                   End;
+  UINTN                   Grain;
+  TASK_RANGE_PROCEDURE    Procedure;
+  VOID                    *Context;
+} TASK_RANGE;
+
+/**
+  Get a worker of a scheduler.
+
+  @param[in]  Scheduler  The scheduler.
+  @param[in]  Index      The index of the worker.
+
+  @return The worker.
+**/
+STATIC
+TASK_WORKER *
+TaskSchedulerGetWorker (
+  IN TASK_SCHEDULER  *Scheduler,
+  IN UINTN           Index
+  )
+{
+  return (TASK_WORKER *)(Scheduler->Workers + Index * Scheduler->WorkerStride);
+}
+
+/**
+  Get the next pseudo-random number of a worker.
+
+  @param[in, out]  Worker  The worker.
+
+  @return A pseudo-random number.
+**/
+STATIC
+UINT32
+TaskSchedulerRandom (
+  IN OUT TASK_WORKER  *Worker
+  )
+{
+  UINT32  Seed;
+
+  Seed           = Worker->Seed;
+  Seed          ^= Seed << 13;
+  Seed          ^= Seed >> 17;
+  Seed          ^= Seed << 5;
+  Worker->Seed   = Seed;
+  return Seed;
+}
+
+/**
+  Run a task and mark it as done.
+
+  @param[in]  Worker  The worker running the task.
+  @param[in]  Task    The task.
+**/
+STATIC
+VOID
+TaskSchedulerExecute (
+  IN TASK_WORKER          *Worker,
+  IN TASK_SCHEDULER_TASK  *Task
+  )
+{
+  Task->Procedure (Worker, Task->Context);
+
+  InterlockedDecrement (&Worker->Scheduler->Outstanding);
+  //
+  // The task storage may be released by its owner as soon as Done is set.
+  //
+  InterlockedCompareExchange32 (&Task->Done, 0, 1);
+}
+
+/**
+  Take the newest task of the deque of a worker.
+
+  @param[in]  Worker  The worker owning the deque.
+
+  @return The task, or NULL if the deque is empty.
+**/
+STATIC
+TASK_SCHEDULER_TASK *
+TaskSchedulerPop (
+  IN TASK_WORKER  *Worker
+  )
+{
+  TASK_SCHEDULER_TASK  *Task;
+
+  if (Worker->Bottom == Worker->Top) {
+    return NULL;
+  }
+
+  Task = NULL;
+  AcquireSpinLock (&Worker->Lock);
+  if (Worker->Bottom != Worker->Top) {
+    Worker->Bottom--;
+    Task = Worker->Deque[Worker->Bottom % TASK_DEQUE_SIZE];
+    InterlockedDecrement (&Worker->Scheduler->Pending);
+  }
+
+  ReleaseSpinLock (&Worker->Lock);
+  return Task;
+}
+
+/**
+  Take the oldest task of the deque of another worker.
+
+  The deque is skipped if another worker holds its lock, the thief tries another
+  victim instead of waiting.
+
+  @param[in]  Victim  The worker owning the deque.
+
+  @return The task, or NULL if the deque is empty or busy.
+**/
+STATIC
+TASK_SCHEDULER_TASK *
+TaskSchedulerSteal (
+  IN TASK_WORKER  *Victim
+  )
+{
+  TASK_SCHEDULER_TASK  *Task;
+
+  if (Victim->Bottom == Victim->Top) {
+    return NULL;
+  }
+
+  if (!AcquireSpinLockOrFail (&Victim->Lock)) {
+    return NULL;
+  }
+
+  Task = NULL;
+  if (Victim->Bottom != Victim->Top) {
+    Task = Victim->Deque[Victim->Top % TASK_DEQUE_SIZE];
+    Victim->Top++;
+    InterlockedDecrement (&Victim->Scheduler->Pending);
+  }
+
+  ReleaseSpinLock (&Victim->Lock);
+  return Task;
+}
+
+/**
+  Find a task to run, in the deque of the worker first, then in the deques of
+  randomly chosen workers.
+
+  @param[in]  Worker  The worker looking for a task.
+
+  @return The task, or NULL if none was found.
+**/
+STATIC
+TASK_SCHEDULER_TASK *
+TaskSchedulerFindTask (
+  IN TASK_WORKER  *Worker
+  )
+{
+  TASK_SCHEDULER       *Scheduler;
+  TASK_SCHEDULER_TASK  *Task;
+  UINTN                Attempt;
+  UINTN                Victim;
+
+  Task = TaskSchedulerPop (Worker);
+  if (Task != NULL) {
+    return Task;
+  }
+
+  Scheduler = Worker->Scheduler;
+  for (Attempt = 0; Attempt < Scheduler->WorkerCount && Scheduler->Pending != 0; Attempt++) {
+    Victim = TaskSchedulerRandom (Worker) % Scheduler->WorkerCount;
+    if (Victim == Worker->Index) {
+      continue;
+    }
+
+    Task = TaskSchedulerSteal (TaskSchedulerGetWorker (Scheduler, Victim));
+    if (Task != NULL) {
+      return Task;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Wait for work after a worker found no task.
+
+  The worker polls for a while, then parks in MWAIT on the work signal of the
+  scheduler if the processor supports it.
+
+  @param[in]  Worker  The idle worker.
+**/
+STATIC
+VOID
+TaskSchedulerIdle (
+  IN TASK_WORKER  *Worker
+  )
+{
+  TASK_SCHEDULER  *Scheduler;
+  UINTN           Spin;
+
+  Scheduler = Worker->Scheduler;
+  for (Spin = 0; Spin < TASK_IDLE_SPIN_COUNT; Spin++) {
+    if ((Scheduler->Pending != 0) || (Scheduler->Done != 0)) {
+      return;
+    }
+
+    CpuPause ();
+  }
+
+  if (!Scheduler->MwaitSupported) {
+    return;
+  }
+
+  //
+  // A spawner increments Pending before it reads Sleepers, and the sleeper
+  // increments Sleepers before it reads Pending, so either the sleeper sees the
+  // task or the spawner writes the monitored line.
+  //
+  InterlockedIncrement (&Scheduler->Sleepers);
+  AsmMonitor ((UINTN)&Scheduler->WorkSignal, 0, 0);
+  if ((Scheduler->Pending == 0) && (Scheduler->Done == 0)) {
+    AsmMwait (0, 0);
+  }
+
+  InterlockedDecrement (&Scheduler->Sleepers);
+}
+
+/**
+  Get the size of the buffer needed by a scheduler.
+
+  @param[in]  WorkerCount  Number of workers.
+
+  @return The size in bytes of the buffer to pass to TaskSchedulerInitialize().
+**/
+UINTN
+TaskSchedulerGetBufferSize (
+  IN UINTN  WorkerCount
+  )
+{
+  return WorkerCount * ALIGN_VALUE (sizeof (TASK_WORKER), TASK_CACHE_LINE_SIZE);
+}
+
+/**
+  Initialize a scheduler.
+
+  @param[out] Scheduler    The scheduler to initialize.
+  @param[in]  WorkerCount  Number of workers, including the BSP.
+  @param[in]  Buffer       Buffer of TaskSchedulerGetBufferSize() bytes, aligned on a
+                           cache line, holding the workers.
+  @param[in]  Procedure    The root procedure.
+  @param[in]  Context      The context passed to Procedure.
+**/
+VOID
+TaskSchedulerInitialize (
+  OUT TASK_SCHEDULER  *Scheduler,
+  IN  UINTN           WorkerCount,
+  IN  VOID            *Buffer,
+  IN  TASK_PROCEDURE  Procedure,
+  IN  VOID            *Context
+  )
+{
+  CPUID_VERSION_INFO_ECX  VersionInfoEcx;
+  TASK_WORKER             *Worker;
+  UINTN                   Index;
+
+  ASSERT (WorkerCount != 0);
+
+  ZeroMem (Scheduler, sizeof (*Scheduler));
+  Scheduler->WorkerCount   = WorkerCount;
+  Scheduler->WorkerStride  = ALIGN_VALUE (sizeof (TASK_WORKER), TASK_CACHE_LINE_SIZE);
+  Scheduler->Workers       = Buffer;
+  Scheduler->RootProcedure = Procedure;
+  Scheduler->RootContext   = Context;
+
+  if (WorkerCount > 1) {
+    AsmCpuid (CPUID_VERSION_INFO, NULL, NULL, &VersionInfoEcx.Uint32, NULL);
+    Scheduler->MwaitSupported = (BOOLEAN)(VersionInfoEcx.Bits.MONITOR == 1);
+  }
+
+  for (Index = 0; Index < WorkerCount; Index++) {
+    Worker = TaskSchedulerGetWorker (Scheduler, Index);
+    ZeroMem (Worker, sizeof (*Worker));
+    Worker->Scheduler = Scheduler;
+    Worker->Index     = Index;
+    Worker->Seed      = (UINT32)(Index * 0x9E3779B9) | 1;
+    InitializeSpinLock (&Worker->Lock);
+  }
+}
+
+/**
+  Run the root procedure as worker 0, then wait for all the tasks to be done and
+  release the other workers.
+
+  @param[in]  Scheduler  The scheduler.
+**/
+VOID
+TaskSchedulerRunRoot (
+  IN TASK_SCHEDULER  *Scheduler
+  )
+{
+  TASK_WORKER          *Worker;
+  TASK_SCHEDULER_TASK  *Task;
+
+  Worker = TaskSchedulerGetWorker (Scheduler, 0);
+  Scheduler->RootProcedure (Worker, Scheduler->RootContext);
+
+  //
+  // A well formed root procedure waits for the tasks it spawns, this only drains
+  // the tasks it did not wait for.
+  //
+  while (Scheduler->Outstanding != 0) {
+    Task = TaskSchedulerFindTask (Worker);
+    if (Task != NULL) {
+      TaskSchedulerExecute (Worker, Task);
+    } else {
+      CpuPause ();
+    }
+  }
+
+  InterlockedCompareExchange32 (&Scheduler->Done, 0, 1);
+  InterlockedIncrement (&Scheduler->WorkSignal);
+}
+
+/**
+  Join a scheduler as an AP and run tasks until the scheduler is done.
+
+  @param[in]  Scheduler  The scheduler.
+**/
+VOID
+TaskSchedulerRunWorker (
+  IN TASK_SCHEDULER  *Scheduler
+  )
+{
+  TASK_WORKER          *Worker;
+  TASK_SCHEDULER_TASK  *Task;
+  UINTN                Index;
+
+  Index = InterlockedIncrement (&Scheduler->JoinedWorkers);
+  if (Index >= Scheduler->WorkerCount) {
+    return;
+  }
+
+  Worker = TaskSchedulerGetWorker (Scheduler, Index);
+  while (TRUE) {
+    Task = TaskSchedulerFindTask (Worker);
+    if (Task != NULL) {
+      TaskSchedulerExecute (Worker, Task);
+      continue;
+    }
+
+    if (Scheduler->Done != 0) {
+      break;
+    }
+
+    TaskSchedulerIdle (Worker);
+  }
+}
+
+/**
+  Run a procedure with the calling processor as the only worker.
+
+  @param[in]  Procedure  The root procedure.
+  @param[in]  Context    The context passed to Procedure.
+**/
+VOID
+TaskSchedulerRunSerial (
+  IN TASK_PROCEDURE  Procedure,
+  IN VOID            *Context
+  )
+{
+  TASK_SCHEDULER  Scheduler;
+  TASK_WORKER     Worker;
+
+  TaskSchedulerInitialize (&Scheduler, 1, &Worker, Procedure, Context);
+  TaskSchedulerRunRoot (&Scheduler);
+}
+
+/**
+  Spawn a task that may be run by any worker.
+
+  If the deque of the worker is full, the task is run before the function returns.
+
+  @param[in]  Worker     The worker spawning the task.
+  @param[out] Task       Storage of the task, valid until TaskSchedulerWait() returns.
+  @param[in]  Procedure  The procedure of the task.
+  @param[in]  Context    The context passed to Procedure.
+**/
+VOID
+EFIAPI
+TaskSchedulerSpawn (
+  IN  TASK_WORKER          *Worker,
+  OUT TASK_SCHEDULER_TASK  *Task,
+  IN  TASK_PROCEDURE       Procedure,
+  IN  VOID                 *Context
+  )
+{
+  TASK_SCHEDULER  *Scheduler;
+  BOOLEAN         Queued;
+
+  ASSERT (Worker != NULL);
+  ASSERT (Task != NULL);
+  ASSERT (Procedure != NULL);
+
+  Scheduler       = Worker->Scheduler;
+  Task->Procedure = Procedure;
+  Task->Context   = Context;
+  Task->Done      = 0;
+  Task->Reserved  = 0;
+  InterlockedIncrement (&Scheduler->Outstanding);
+
+  //
+  // With a single worker, nobody could steal the task.
+  //
+  Queued = FALSE;
+  if (Scheduler->WorkerCount > 1) {
+    AcquireSpinLock (&Worker->Lock);
+    if (Worker->Bottom - Worker->Top < TASK_DEQUE_SIZE) {
+      InterlockedIncrement (&Scheduler->Pending);
+      Worker->Deque[Worker->Bottom % TASK_DEQUE_SIZE] = Task;
+      Worker->Bottom++;
+      Queued = TRUE;
+    }
+
+    ReleaseSpinLock (&Worker->Lock);
+  }
+
+  if (!Queued) {
+    TaskSchedulerExecute (Worker, Task);
+    return;
+  }
+
+  if (Scheduler->Sleepers != 0) {
+    InterlockedIncrement (&Scheduler->WorkSignal);
+  }
+}
+
+/**
+  Wait for a task to be done. The worker runs other tasks while it waits.
+
+  @param[in]  Worker  The worker that spawned the task.
+  @param[in]  Task    The task to wait for.
+**/
+VOID
+EFIAPI
+TaskSchedulerWait (
+  IN TASK_WORKER          *Worker,
+  IN TASK_SCHEDULER_TASK  *Task
+  )
+{
+  TASK_SCHEDULER_TASK  *Other;
+
+  ASSERT (Worker != NULL);
+  ASSERT (Task != NULL);
+
+  while (Task->Done == 0) {
+    Other = TaskSchedulerFindTask (Worker);
+    if (Other != NULL) {
+      TaskSchedulerExecute (Worker, Other);
+    } else {
+      CpuPause ();
+    }
+  }
+}
+
+/**
+  Check whether a task is done, without waiting.
+
+  @param[in]  Task  The task to check.
+
+  @retval TRUE   The task is done.
+  @retval FALSE  The task is queued or running.
+**/
+BOOLEAN
+EFIAPI
+TaskSchedulerIsDone (
+  IN TASK_SCHEDULER_TASK  *Task
+  )
+{
+  ASSERT (Task != NULL);
+  return (BOOLEAN)(Task->Done != 0);
+}
+
+/**
+  Task running a range of TaskSchedulerParallelFor(), splitting it in two halves
+  until it is not larger than the grain.
+
+  @param[in]  Worker   The worker running the task.
+  @param[in]  Context  The TASK_RANGE to run.
+**/
+STATIC
+VOID
+EFIAPI
+TaskSchedulerRangeTask (
+  IN TASK_WORKER  *Worker,
+  IN VOID         *Context
+  )
+{
+  TASK_RANGE           Lower;
+  TASK_RANGE           Upper;
+  TASK_SCHEDULER_TASK  Task;
+  UINTN                Middle;
+
+  CopyMem (&Lower, Context, sizeof (Lower));
+  if (Lower.End - Lower.Start <= Lower.Grain) {
+    Lower.Procedure (Worker, Lower.Start, Lower.End, Lower.Context);
+    return;
+  }
+
+  Middle = Lower.Start + (Lower.End - Lower.Start) / 2;
+  CopyMem (&Upper, &Lower, sizeof (Upper));
+  Upper.Start = Middle;
+  Lower.End   = Middle;
+
+  TaskSchedulerSpawn (Worker, &Task, TaskSchedulerRangeTask, &Upper);
+  TaskSchedulerRangeTask (Worker, &Lower);
+  TaskSchedulerWait (Worker, &Task);
+}
+
+/**
+  Run a procedure on the ranges of [Start, End), split in ranges of at most
+  Grain indexes that are run in parallel.
+
+  @param[in]  Worker     The calling worker, or NULL to run the loop in its own
+                         TaskSchedulerRun().
+  @param[in]  Start      First index.
+  @param[in]  End        Index following the last index.
+  @param[in]  Grain      Maximum number of indexes of a range, 0 is handled as 1.
+  @param[in]  Procedure  The procedure run on each range.
+  @param[in]  Context    The context passed to Procedure.
+
+  @retval EFI_SUCCESS            Procedure has been run on all the ranges.
+  @retval EFI_INVALID_PARAMETER  Procedure is NULL.
+**/
+EFI_STATUS
+EFIAPI
+TaskSchedulerParallelFor (
+  IN TASK_WORKER           *Worker  OPTIONAL,
+  IN UINTN                 Start,
+  IN UINTN                 End,
+  IN UINTN                 Grain,
+  IN TASK_RANGE_PROCEDURE  Procedure,
+  IN VOID                  *Context
+  )
+{
+  TASK_RANGE  Range;
+
+  if (Procedure == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (End <= Start) {
+    return EFI_SUCCESS;
+  }
+
+  Range.Start     = Start;
+  Range.End       = End;
+  Range.Grain     = MAX (Grain, 1);
+  Range.Procedure = Procedure;
+  Range.Context   = Context;
+
+  if (Worker == NULL) {
+    return TaskSchedulerRun (TaskSchedulerRangeTask, &Range);
+  }
+
+  TaskSchedulerRangeTask (Worker, &Range);
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the number of workers of the scheduler running a worker.
+
+  @param[in]  Worker  A worker.
+
+  @return The number of workers, including the BSP.
+**/
+UINTN
+EFIAPI
+TaskSchedulerGetWorkerCount (
+  IN TASK_WORKER  *Worker
+  )
+{
+  ASSERT (Worker != NULL);
+  return Worker->Scheduler->WorkerCount;
+}
+
+/**
+  Get the index of a worker, 0 for the BSP.
+
+  @param[in]  Worker  A worker.
+
+  @return The index of the worker, less than TaskSchedulerGetWorkerCount().
+**/
+UINTN
+EFIAPI
+TaskSchedulerGetWorkerIndex (
+  IN TASK_WORKER  *Worker
+  )
+{
+  ASSERT (Worker != NULL);
+  return Worker->Index;
+}
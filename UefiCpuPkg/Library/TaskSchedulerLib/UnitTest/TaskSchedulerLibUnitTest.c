@@ -0,0 +1,631 @@
+/** @file
+  Unit tests of the work-stealing deques of the Task Scheduler Library.
+
+  The workers of a scheduler are driven one at a time from the test thread, so the
+  order in which tasks are popped, stolen and completed is deterministic.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UnitTestLib.h>
+
+#include "../InternalTaskSchedulerLib.h"
+
+#define UNIT_TEST_APP_NAME     "Task Scheduler Library Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_TASK_COUNT  8
+#define TEST_LOG_SIZE    (TASK_DEQUE_SIZE + 1)
+
+typedef struct {
+  TASK_SCHEDULER         Scheduler;
+  VOID                   *Buffer;
+  UINTN                  Pages;
+  TASK_SCHEDULER_TASK    Tasks[TEST_LOG_SIZE];
+  UINTN                  Ids[TEST_LOG_SIZE];
+  UINTN                  Log[TEST_LOG_SIZE];
+  UINTN                  LogWorker[TEST_LOG_SIZE];
+  UINTN                  LogCount;
+} TASK_SCHEDULER_TEST_CONTEXT;
+
+typedef struct {
+  TASK_SCHEDULER_TASK    *Task;
+  UINT32                 OutstandingAtDone;
+  BOOLEAN                Seen;
+} TASK_DONE_PROBE;
+
+TASK_SCHEDULER_TEST_CONTEXT  mContext;
+
+//
+// Tasks whose completion is watched by InterlockedCompareExchange32().
+//
+TASK_DONE_PROBE  mProbes[2];
+
+//
+// Largest range run by CountRange().
+//
+UINTN  mMaxRangeSize;
+
+//
+// Symbol Definitions
+// These are not directly under test - but required to link TaskSchedulerLib.c.
+// The workers run on the test thread only, so the synchronization primitives do
+// not need to be atomic, and the compare exchange records the outstanding task
+// count at the time a watched task is marked done.
+//
+
+SPIN_LOCK *
+EFIAPI
+InitializeSpinLock (
+  OUT SPIN_LOCK  *SpinLock
+  )
+{
+  *SpinLock = 0;
+  return SpinLock;
+}
+
+SPIN_LOCK *
+EFIAPI
+AcquireSpinLock (
+  IN OUT SPIN_LOCK  *SpinLock
+  )
+{
+  ASSERT (*SpinLock == 0);
+  *SpinLock = 1;
+  return SpinLock;
+}
+
+BOOLEAN
+EFIAPI
+AcquireSpinLockOrFail (
+  IN OUT SPIN_LOCK  *SpinLock
+  )
+{
+  if (*SpinLock != 0) {
+    return FALSE;
+  }
+
+  *SpinLock = 1;
+  return TRUE;
+}
+
+SPIN_LOCK *
+EFIAPI
+ReleaseSpinLock (
+  IN OUT SPIN_LOCK  *SpinLock
+  )
+{
+  ASSERT (*SpinLock == 1);
+  *SpinLock = 0;
+  return SpinLock;
+}
+
+UINT32
+EFIAPI
+InterlockedIncrement (
+  IN volatile UINT32  *Value
+  )
+{
+  return ++*Value;
+}
+
+UINT32
+EFIAPI
+InterlockedDecrement (
+  IN volatile UINT32  *Value
+  )
+{
+  return --*Value;
+}
+
+UINT32
+EFIAPI
+InterlockedCompareExchange32 (
+  IN OUT volatile UINT32  *Value,
+  IN     UINT32           CompareValue,
+  IN     UINT32           ExchangeValue
+  )
+{
+  UINT32  Original;
+  UINTN   Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (mProbes); Index++) {
+    if ((mProbes[Index].Task != NULL) && (Value == &mProbes[Index].Task->Done)) {
+      mProbes[Index].OutstandingAtDone = mContext.Scheduler.Outstanding;
+      mProbes[Index].Seen              = TRUE;
+    }
+  }
+
+  Original = *Value;
+  if (Original == CompareValue) {
+    *Value = ExchangeValue;
+  }
+
+  return Original;
+}
+
+EFI_STATUS
+EFIAPI
+TaskSchedulerRun (
+  IN TASK_PROCEDURE  Procedure,
+  IN VOID            *Context
+  )
+{
+  TaskSchedulerRunSerial (Procedure, Context);
+  return EFI_SUCCESS;
+}
+
+/**
+  Task logging its identifier and the worker running it.
+
+  @param[in]  Worker   The worker running the task.
+  @param[in]  Context  Pointer to the identifier of the task.
+**/
+VOID
+EFIAPI
+LogTask (
+  IN TASK_WORKER  *Worker,
+  IN VOID         *Context
+  )
+{
+  ASSERT (mContext.LogCount < TEST_LOG_SIZE);
+  mContext.Log[mContext.LogCount]       = *(UINTN *)Context;
+  mContext.LogWorker[mContext.LogCount] = TaskSchedulerGetWorkerIndex (Worker);
+  mContext.LogCount++;
+}
+
+/**
+  Task spawning the second probed task and waiting for it.
+
+  @param[in]  Worker   The worker running the task.
+  @param[in]  Context  Unused.
+**/
+VOID
+EFIAPI
+SpawnChildTask (
+  IN TASK_WORKER  *Worker,
+  IN VOID         *Context
+  )
+{
+  TaskSchedulerSpawn (Worker, mProbes[1].Task, LogTask, &mContext.Ids[1]);
+  TaskSchedulerWait (Worker, mProbes[1].Task);
+}
+
+/**
+  Range procedure counting the runs of every index.
+
+  @param[in]  Worker   The worker running the range.
+  @param[in]  Start    First index of the range.
+  @param[in]  End      Index following the last index of the range.
+  @param[in]  Context  Array of run counts, one per index.
+**/
+VOID
+EFIAPI
+CountRange (
+  IN TASK_WORKER  *Worker,
+  IN UINTN        Start,
+  IN UINTN        End,
+  IN VOID         *Context
+  )
+{
+  UINT8  *Counts;
+
+  mMaxRangeSize = MAX (mMaxRangeSize, End - Start);
+  Counts        = (UINT8 *)Context;
+  while (Start < End) {
+    Counts[Start++]++;
+  }
+}
+
+/**
+  Get a worker of the scheduler of the test context.
+
+  @param[in]  Index  The index of the worker.
+
+  @return The worker.
+**/
+TASK_WORKER *
+GetWorker (
+  IN UINTN  Index
+  )
+{
+  return (TASK_WORKER *)(mContext.Scheduler.Workers + Index * mContext.Scheduler.WorkerStride);
+}
+
+/**
+  Create a scheduler of two workers, none of them running.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED                      The scheduler is ready.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  The workers cannot be allocated.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SetupScheduler (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  ZeroMem (&mContext, sizeof (mContext));
+  ZeroMem (mProbes, sizeof (mProbes));
+  mContext.Pages  = EFI_SIZE_TO_PAGES (TaskSchedulerGetBufferSize (2));
+  mContext.Buffer = AllocatePages (mContext.Pages);
+  if (mContext.Buffer == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  for (Index = 0; Index < TEST_LOG_SIZE; Index++) {
+    mContext.Ids[Index] = Index;
+  }
+
+  TaskSchedulerInitialize (&mContext.Scheduler, 2, mContext.Buffer, NULL, NULL);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Release the workers of the scheduler.
+
+  @param[in]  Context  Unused.
+**/
+VOID
+EFIAPI
+CleanupScheduler (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  FreePages (mContext.Buffer, mContext.Pages);
+  mContext.Buffer = NULL;
+}
+
+/**
+  Run worker 1 until the deques are empty. The scheduler is marked done first so
+  that the worker returns once it finds no task.
+**/
+VOID
+DrainWithWorker1 (
+  VOID
+  )
+{
+  mContext.Scheduler.Done = 1;
+  while (mContext.Scheduler.Pending != 0) {
+    mContext.Scheduler.JoinedWorkers = 0;
+    TaskSchedulerRunWorker (&mContext.Scheduler);
+  }
+}
+
+/**
+  A thief takes the tasks of another worker oldest first.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+StealTakesOldestTask (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < TEST_TASK_COUNT; Index++) {
+    TaskSchedulerSpawn (GetWorker (0), &mContext.Tasks[Index], LogTask, &mContext.Ids[Index]);
+  }
+
+  UT_ASSERT_EQUAL (mContext.Scheduler.Pending, TEST_TASK_COUNT);
+  UT_ASSERT_EQUAL (mContext.Scheduler.Outstanding, TEST_TASK_COUNT);
+  UT_ASSERT_EQUAL (mContext.LogCount, 0);
+
+  DrainWithWorker1 ();
+
+  UT_ASSERT_EQUAL (mContext.LogCount, TEST_TASK_COUNT);
+  for (Index = 0; Index < TEST_TASK_COUNT; Index++) {
+    UT_ASSERT_EQUAL (mContext.Log[Index], Index);
+    UT_ASSERT_EQUAL (mContext.LogWorker[Index], 1);
+    UT_ASSERT_TRUE (TaskSchedulerIsDone (&mContext.Tasks[Index]));
+  }
+
+  UT_ASSERT_EQUAL (mContext.Scheduler.Outstanding, 0);
+  UT_ASSERT_EQUAL (GetWorker (0)->Top, GetWorker (0)->Bottom);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The owner of a deque runs its own tasks newest first while it waits.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+WaitPopsNewestTask (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < TEST_TASK_COUNT; Index++) {
+    TaskSchedulerSpawn (GetWorker (0), &mContext.Tasks[Index], LogTask, &mContext.Ids[Index]);
+  }
+
+  TaskSchedulerWait (GetWorker (0), &mContext.Tasks[0]);
+
+  UT_ASSERT_EQUAL (mContext.LogCount, TEST_TASK_COUNT);
+  for (Index = 0; Index < TEST_TASK_COUNT; Index++) {
+    UT_ASSERT_EQUAL (mContext.Log[Index], TEST_TASK_COUNT - 1 - Index);
+    UT_ASSERT_EQUAL (mContext.LogWorker[Index], 0);
+  }
+
+  UT_ASSERT_EQUAL (mContext.Scheduler.Pending, 0);
+  UT_ASSERT_EQUAL (mContext.Scheduler.Outstanding, 0);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The owner and a thief share a deque from both ends.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PopAndStealMeetInTheMiddle (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < TEST_TASK_COUNT; Index++) {
+    TaskSchedulerSpawn (GetWorker (0), &mContext.Tasks[Index], LogTask, &mContext.Ids[Index]);
+  }
+
+  //
+  // A thief cannot take a deque whose lock is held, it moves on to another victim.
+  //
+  AcquireSpinLock (&GetWorker (0)->Lock);
+  mContext.Scheduler.Done          = 1;
+  mContext.Scheduler.JoinedWorkers = 0;
+  TaskSchedulerRunWorker (&mContext.Scheduler);
+  ReleaseSpinLock (&GetWorker (0)->Lock);
+  UT_ASSERT_EQUAL (mContext.LogCount, 0);
+  UT_ASSERT_EQUAL (mContext.Scheduler.Pending, TEST_TASK_COUNT);
+
+  //
+  // The owner waiting for its newest task pops nothing else, the thief then takes
+  // the others oldest first.
+  //
+  mContext.Scheduler.Done = 0;
+  TaskSchedulerWait (GetWorker (0), &mContext.Tasks[TEST_TASK_COUNT - 1]);
+  UT_ASSERT_EQUAL (mContext.LogCount, 1);
+  UT_ASSERT_EQUAL (mContext.Log[0], TEST_TASK_COUNT - 1);
+  UT_ASSERT_EQUAL (mContext.Scheduler.Pending, TEST_TASK_COUNT - 1);
+
+  DrainWithWorker1 ();
+  UT_ASSERT_EQUAL (mContext.LogCount, TEST_TASK_COUNT);
+  for (Index = 1; Index < TEST_TASK_COUNT; Index++) {
+    UT_ASSERT_EQUAL (mContext.Log[Index], Index - 1);
+    UT_ASSERT_EQUAL (mContext.LogWorker[Index], 1);
+  }
+
+  UT_ASSERT_EQUAL (mContext.Scheduler.Outstanding, 0);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A task spawned on a full deque runs before TaskSchedulerSpawn() returns.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FullDequeRunsTaskInline (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < TASK_DEQUE_SIZE; Index++) {
+    TaskSchedulerSpawn (GetWorker (0), &mContext.Tasks[Index], LogTask, &mContext.Ids[Index]);
+  }
+
+  UT_ASSERT_EQUAL (mContext.LogCount, 0);
+  UT_ASSERT_EQUAL (mContext.Scheduler.Pending, TASK_DEQUE_SIZE);
+
+  TaskSchedulerSpawn (GetWorker (0), &mContext.Tasks[TASK_DEQUE_SIZE], LogTask, &mContext.Ids[TASK_DEQUE_SIZE]);
+  UT_ASSERT_TRUE (TaskSchedulerIsDone (&mContext.Tasks[TASK_DEQUE_SIZE]));
+  UT_ASSERT_EQUAL (mContext.LogCount, 1);
+  UT_ASSERT_EQUAL (mContext.Log[0], TASK_DEQUE_SIZE);
+  UT_ASSERT_EQUAL (mContext.Scheduler.Pending, TASK_DEQUE_SIZE);
+  UT_ASSERT_EQUAL (mContext.Scheduler.Outstanding, TASK_DEQUE_SIZE);
+
+  TaskSchedulerWait (GetWorker (0), &mContext.Tasks[0]);
+  UT_ASSERT_EQUAL (mContext.LogCount, TASK_DEQUE_SIZE + 1);
+  UT_ASSERT_EQUAL (mContext.Scheduler.Outstanding, 0);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A task is counted out of the outstanding tasks before it is marked done, since
+  its storage may be released as soon as it is done.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+OutstandingDecrementedBeforeDone (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  //
+  // A task run by its owner.
+  //
+  mProbes[0].Task = &mContext.Tasks[0];
+  TaskSchedulerSpawn (GetWorker (0), mProbes[0].Task, LogTask, &mContext.Ids[0]);
+  TaskSchedulerWait (GetWorker (0), mProbes[0].Task);
+  UT_ASSERT_TRUE (mProbes[0].Seen);
+  UT_ASSERT_EQUAL (mProbes[0].OutstandingAtDone, 0);
+
+  //
+  // A task stolen by another worker.
+  //
+  ZeroMem (mProbes, sizeof (mProbes));
+  mProbes[0].Task = &mContext.Tasks[1];
+  TaskSchedulerSpawn (GetWorker (0), mProbes[0].Task, LogTask, &mContext.Ids[1]);
+  DrainWithWorker1 ();
+  UT_ASSERT_TRUE (mProbes[0].Seen);
+  UT_ASSERT_EQUAL (mProbes[0].OutstandingAtDone, 0);
+  mContext.Scheduler.Done = 0;
+
+  //
+  // A parent task and the child it waits for: the child is done while its parent
+  // is still outstanding, the parent once nothing is.
+  //
+  ZeroMem (mProbes, sizeof (mProbes));
+  mProbes[0].Task = &mContext.Tasks[2];
+  mProbes[1].Task = &mContext.Tasks[3];
+  TaskSchedulerSpawn (GetWorker (0), mProbes[0].Task, SpawnChildTask, NULL);
+  TaskSchedulerWait (GetWorker (0), mProbes[0].Task);
+  UT_ASSERT_TRUE (mProbes[1].Seen);
+  UT_ASSERT_EQUAL (mProbes[1].OutstandingAtDone, 1);
+  UT_ASSERT_TRUE (mProbes[0].Seen);
+  UT_ASSERT_EQUAL (mProbes[0].OutstandingAtDone, 0);
+
+  //
+  // A task run inline by a single worker scheduler.
+  //
+  ZeroMem (mProbes, sizeof (mProbes));
+  TaskSchedulerInitialize (&mContext.Scheduler, 1, mContext.Buffer, NULL, NULL);
+  mProbes[0].Task = &mContext.Tasks[4];
+  TaskSchedulerSpawn (GetWorker (0), mProbes[0].Task, LogTask, &mContext.Ids[4]);
+  UT_ASSERT_TRUE (mProbes[0].Seen);
+  UT_ASSERT_EQUAL (mProbes[0].OutstandingAtDone, 0);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  TaskSchedulerParallelFor() runs every index of an unaligned range exactly once,
+  in ranges not larger than the grain.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ParallelForCoversRange (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8  Counts[1000];
+  UINTN  Index;
+
+  mMaxRangeSize = 0;
+  ZeroMem (Counts, sizeof (Counts));
+  UT_ASSERT_NOT_EFI_ERROR (TaskSchedulerParallelFor (GetWorker (0), 3, 997, 7, CountRange, Counts));
+  for (Index = 0; Index < ARRAY_SIZE (Counts); Index++) {
+    UT_ASSERT_EQUAL (Counts[Index], ((Index >= 3) && (Index < 997)) ? 1 : 0);
+  }
+
+  UT_ASSERT_TRUE (mMaxRangeSize <= 7);
+
+  UT_ASSERT_EQUAL (mContext.Scheduler.Pending, 0);
+  UT_ASSERT_EQUAL (mContext.Scheduler.Outstanding, 0);
+
+  ZeroMem (Counts, sizeof (Counts));
+  UT_ASSERT_NOT_EFI_ERROR (TaskSchedulerParallelFor (NULL, 0, ARRAY_SIZE (Counts), 7, CountRange, Counts));
+  for (Index = 0; Index < ARRAY_SIZE (Counts); Index++) {
+    UT_ASSERT_EQUAL (Counts[Index], 1);
+  }
+
+  UT_ASSERT_EQUAL (TaskSchedulerParallelFor (NULL, 0, 1, 1, NULL, NULL), EFI_INVALID_PARAMETER);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  Task Scheduler Library and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UefiTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      DequeTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&DequeTests, Framework, "Work-Stealing Deque Tests", "TaskSchedulerLib.Deque", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for Work-Stealing Deque Tests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (DequeTests, "A thief takes the oldest task", "StealTakesOldestTask", StealTakesOldestTask, SetupScheduler, CleanupScheduler, NULL);
+  AddTestCase (DequeTests, "The owner runs the newest task", "WaitPopsNewestTask", WaitPopsNewestTask, SetupScheduler, CleanupScheduler, NULL);
+  AddTestCase (DequeTests, "The owner and a thief share a deque", "PopAndStealMeetInTheMiddle", PopAndStealMeetInTheMiddle, SetupScheduler, CleanupScheduler, NULL);
+  AddTestCase (DequeTests, "A full deque runs the task inline", "FullDequeRunsTaskInline", FullDequeRunsTaskInline, SetupScheduler, CleanupScheduler, NULL);
+  AddTestCase (DequeTests, "A task leaves the outstanding count before it is done", "OutstandingDecrementedBeforeDone", OutstandingDecrementedBeforeDone, SetupScheduler, CleanupScheduler, NULL);
+  AddTestCase (DequeTests, "Parallel for covers the range", "ParallelForCoversRange", ParallelForCoversRange, SetupScheduler, CleanupScheduler, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param Argc  Number of arguments.
+  @param Argv  Array of arguments.
+
+  @return Test application exit code.
+**/
+INT32
+main (
+  INT32  Argc,
+  CHAR8  *Argv[]
+  )
+{
+  return UefiTestMain ();
+}
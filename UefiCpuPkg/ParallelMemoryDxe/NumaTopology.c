@@ -0,0 +1,288 @@
+/** @file
+  NUMA topology of the Parallel Memory DXE driver, read from the ACPI SRAT.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "ParallelMemoryDxe.h"
+
+/**
+  Get the index of a proximity domain, adding it if it is not known yet.
+
+  @param[in, out]  Domain       The known proximity domains.
+  @param[in, out]  DomainCount  The number of known proximity domains.
+  @param[in]       Value        The proximity domain.
+
+  @return The index of the proximity domain in Domain.
+**/
+STATIC
+UINTN
+ParallelMemoryAddDomain (
+  IN OUT UINT32  *Domain,
+  IN OUT UINTN   *DomainCount,
+  IN     UINT32  Value
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < *DomainCount; Index++) {
+    if (Domain[Index] == Value) {
+      return Index;
+    }
+  }
+
+  Domain[*DomainCount] = Value;
+  return (*DomainCount)++;
+}
+
+/**
+  Get the proximity domain of a processor from the SRAT.
+
+  @param[in]   Srat      The SRAT.
+  @param[in]   ApicId    The APIC ID of the processor.
+  @param[out]  Value     The proximity domain of the processor.
+
+  @retval TRUE   The processor is described by the SRAT.
+  @retval FALSE  The processor is not described by the SRAT.
+**/
+STATIC
+BOOLEAN
+ParallelMemoryGetProcessorDomain (
+  IN  EFI_ACPI_6_5_SYSTEM_RESOURCE_AFFINITY_TABLE_HEADER  *Srat,
+  IN  UINT32                                              ApicId,
+  OUT UINT32                                              *Value
+  )
+{
+  UINT8                                                       *Entry;
+  UINT8                                                       *End;
+  EFI_ACPI_6_5_PROCESSOR_LOCAL_APIC_SAPIC_AFFINITY_STRUCTURE  *Apic;
+  EFI_ACPI_6_5_PROCESSOR_LOCAL_X2APIC_AFFINITY_STRUCTURE      *X2Apic;
+
+  Entry = (UINT8 *)(Srat + 1);
+  End   = (UINT8 *)Srat + Srat->Header.Length;
+  while ((Entry + 2 <= End) && (Entry[1] >= 2) && (Entry + Entry[1] <= End)) {
+    if ((Entry[0] == EFI_ACPI_6_5_PROCESSOR_LOCAL_APIC_SAPIC_AFFINITY) &&
+        (Entry[1] >= sizeof (*Apic)))
+    {
+      Apic = (EFI_ACPI_6_5_PROCESSOR_LOCAL_APIC_SAPIC_AFFINITY_STRUCTURE *)Entry;
+      if (((Apic->Flags & EFI_ACPI_6_5_PROCESSOR_LOCAL_APIC_SAPIC_ENABLED) != 0) && (Apic->ApicId == ApicId)) {
+        *Value = Apic->ProximityDomain7To0 |
+                 ((UINT32)Apic->ProximityDomain31To8[0] << 8) |
+                 ((UINT32)Apic->ProximityDomain31To8[1] << 16) |
+                 ((UINT32)Apic->ProximityDomain31To8[2] << 24);
+        return TRUE;
+      }
+    } else if ((Entry[0] == EFI_ACPI_6_5_PROCESSOR_LOCAL_X2APIC_AFFINITY) &&
+               (Entry[1] >= sizeof (*X2Apic)))
+    {
+      X2Apic = (EFI_ACPI_6_5_PROCESSOR_LOCAL_X2APIC_AFFINITY_STRUCTURE *)Entry;
+      if (((X2Apic->Flags & EFI_ACPI_6_5_PROCESSOR_LOCAL_APIC_SAPIC_ENABLED) != 0) && (X2Apic->X2ApicId == ApicId)) {
+        *Value = X2Apic->ProximityDomain;
+        return TRUE;
+      }
+    }
+
+    Entry += Entry[1];
+  }
+
+  return FALSE;
+}
+
+/**
+  Read the NUMA topology from the SRAT.
+
+  @param[in, out]  Private  The driver private data.
+  @param[in]       Srat     The SRAT.
+
+  @retval EFI_SUCCESS           The topology is read.
+  @retval EFI_OUT_OF_RESOURCES  The topology cannot be allocated.
+**/
+STATIC
+EFI_STATUS
+ParallelMemoryReadSrat (
+  IN OUT PARALLEL_MEMORY_PRIVATE                             *Private,
+  IN     EFI_ACPI_6_5_SYSTEM_RESOURCE_AFFINITY_TABLE_HEADER  *Srat
+  )
+{
+  EFI_STATUS                              Status;
+  UINT8                                   *Entry;
+  UINT8                                   *End;
+  UINTN                                   EntryCount;
+  UINT32                                  *Domain;
+  UINTN                                   DomainCount;
+  PARALLEL_MEMORY_AFFINITY                *Affinity;
+  UINTN                                   AffinityCount;
+  EDKII_PARALLEL_MEMORY_NODE_STATISTICS   *Node;
+  EFI_ACPI_6_5_MEMORY_AFFINITY_STRUCTURE  *Memory;
+  EFI_PROCESSOR_INFORMATION               ProcessorInfo;
+  UINT32                                  Value;
+  UINTN                                   Index;
+  UINTN                                   NodeIndex;
+
+  EntryCount = 0;
+  Entry      = (UINT8 *)(Srat + 1);
+  End        = (UINT8 *)Srat + Srat->Header.Length;
+  while ((Entry + 2 <= End) && (Entry[1] >= 2) && (Entry + Entry[1] <= End)) {
+    EntryCount++;
+    Entry += Entry[1];
+  }
+
+  Domain   = AllocatePool (MAX (EntryCount, 1) * sizeof (UINT32));
+  Affinity = AllocatePool (MAX (EntryCount, 1) * sizeof (PARALLEL_MEMORY_AFFINITY));
+  if ((Domain == NULL) || (Affinity == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  //
+  // Every proximity domain with enabled memory becomes a node, in SRAT order.
+  //
+  DomainCount   = 0;
+  AffinityCount = 0;
+  Entry         = (UINT8 *)(Srat + 1);
+  while ((Entry + 2 <= End) && (Entry[1] >= 2) && (Entry + Entry[1] <= End)) {
+    if ((Entry[0] == EFI_ACPI_6_5_MEMORY_AFFINITY) && (Entry[1] >= sizeof (*Memory))) {
+      Memory = (EFI_ACPI_6_5_MEMORY_AFFINITY_STRUCTURE *)Entry;
+      if (((Memory->Flags & EFI_ACPI_6_5_MEMORY_ENABLED) != 0) && ((Memory->LengthLow | Memory->LengthHigh) != 0)) {
+        Affinity[AffinityCount].Base   = LShiftU64 (Memory->AddressBaseHigh, 32) | Memory->AddressBaseLow;
+        Affinity[AffinityCount].Length = LShiftU64 (Memory->LengthHigh, 32) | Memory->LengthLow;
+        Affinity[AffinityCount].Node   = ParallelMemoryAddDomain (Domain, &DomainCount, Memory->ProximityDomain);
+        AffinityCount++;
+      }
+    }
+
+    Entry += Entry[1];
+  }
+
+  if (DomainCount == 0) {
+    //
+    // Keep the single node.
+    //
+    Private->TopologyFromSrat = TRUE;
+    Status                    = EFI_SUCCESS;
+    goto Done;
+  }
+
+  Node = AllocateZeroPool (DomainCount * sizeof (*Node));
+  if (Node == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  for (Index = 0; Index < DomainCount; Index++) {
+    Node[Index].ProximityDomain = Domain[Index];
+  }
+
+  //
+  // Processors of a domain without memory, or not described by the SRAT, work
+  // from the first node.
+  //
+  for (Index = 0; Index < Private->ProcessorCount; Index++) {
+    Private->ProcessorNode[Index] = 0;
+    Status                        = Private->MpServices->GetProcessorInfo (Private->MpServices, Index, &ProcessorInfo);
+    if (EFI_ERROR (Status) || ((ProcessorInfo.StatusFlag & PROCESSOR_ENABLED_BIT) == 0)) {
+      continue;
+    }
+
+    if (ParallelMemoryGetProcessorDomain (Srat, (UINT32)ProcessorInfo.ProcessorId, &Value)) {
+      for (NodeIndex = 0; NodeIndex < DomainCount; NodeIndex++) {
+        if (Domain[NodeIndex] == Value) {
+          Private->ProcessorNode[Index] = NodeIndex;
+          break;
+        }
+      }
+    }
+
+    Node[Private->ProcessorNode[Index]].ProcessorCount++;
+  }
+
+  //
+  // Statistics gathered before the SRAT was installed are not attributed to
+  // any node and are dropped.
+  //
+  FreePool (Private->Node);
+  Private->Node             = Node;
+  Private->NodeCount        = DomainCount;
+  Private->Affinity         = Affinity;
+  Private->AffinityCount    = AffinityCount;
+  Private->TopologyFromSrat = TRUE;
+  Affinity                  = NULL;
+  Status                    = EFI_SUCCESS;
+
+  DEBUG ((DEBUG_INFO, "ParallelMemory: %d NUMA nodes, %d memory ranges\n", DomainCount, AffinityCount));
+
+Done:
+  if (Domain != NULL) {
+    FreePool (Domain);
+  }
+
+  if (Affinity != NULL) {
+    FreePool (Affinity);
+  }
+
+  return Status;
+}
+
+/**
+  Update the NUMA topology of the driver.
+
+  The topology is read once from the SRAT. Before the SRAT is installed, the
+  driver uses a single node holding all the memory and all the processors.
+
+  @param[in, out]  Private  The driver private data.
+
+  @retval EFI_SUCCESS           The topology is up to date.
+  @retval EFI_OUT_OF_RESOURCES  The topology cannot be allocated.
+**/
+EFI_STATUS
+ParallelMemoryUpdateTopology (
+  IN OUT PARALLEL_MEMORY_PRIVATE  *Private
+  )
+{
+  EFI_STATUS                                          Status;
+  EFI_MP_SERVICES_PROTOCOL                            *MpServices;
+  UINTN                                               NumberOfProcessors;
+  UINTN                                               NumberOfEnabledProcessors;
+  UINTN                                               *ProcessorNode;
+  EFI_ACPI_6_5_SYSTEM_RESOURCE_AFFINITY_TABLE_HEADER  *Srat;
+
+  if (Private->TopologyFromSrat) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Without MP services, the BSP does all the work from the single node.
+  //
+  if (Private->MpServices == NULL) {
+    Status = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **)&MpServices);
+    if (EFI_ERROR (Status)) {
+      return EFI_SUCCESS;
+    }
+
+    Status = MpServices->GetNumberOfProcessors (MpServices, &NumberOfProcessors, &NumberOfEnabledProcessors);
+    if (EFI_ERROR (Status)) {
+      return EFI_SUCCESS;
+    }
+
+    ProcessorNode = AllocateZeroPool (NumberOfProcessors * sizeof (UINTN));
+    if (ProcessorNode == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    FreePool (Private->ProcessorNode);
+    Private->ProcessorNode          = ProcessorNode;
+    Private->ProcessorCount         = NumberOfProcessors;
+    Private->MpServices             = MpServices;
+    Private->Node[0].ProcessorCount = (UINT32)NumberOfEnabledProcessors;
+  }
+
+  Srat = (EFI_ACPI_6_5_SYSTEM_RESOURCE_AFFINITY_TABLE_HEADER *)EfiLocateFirstAcpiTable (
+                                                                  EFI_ACPI_6_5_SYSTEM_RESOURCE_AFFINITY_TABLE_SIGNATURE
+                                                                  );
+  if (Srat == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  return ParallelMemoryReadSrat (Private, Srat);
+}
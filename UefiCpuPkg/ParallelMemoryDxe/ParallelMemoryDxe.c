@@ -0,0 +1,837 @@
+/** @file
+  Parallel Memory DXE driver.
+
+  Produces EDKII_PARALLEL_MEMORY_PROTOCOL. A range is split by NUMA node and each
+  node's part is cut in chunks. The workers of TaskSchedulerLib take chunks of
+  their own node first, then help with the chunks left on the other nodes.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "ParallelMemoryDxe.h"
+
+#define PARALLEL_MEMORY_CHUNK_SHIFT  20
+
+#define PARALLEL_MEMORY_CACHE_LINE_SIZE  64
+
+///
+/// Contiguous part of a range on a single node.
+///
+typedef struct {
+  EFI_PHYSICAL_ADDRESS    Base;
+  UINT64                  Length;
+  UINTN                   Node;
+  ///
+  /// Index of the first chunk of the piece among the chunks of its node.
+  ///
+  UINT32                  FirstChunk;
+} PARALLEL_MEMORY_PIECE;
+
+typedef struct {
+  PARALLEL_MEMORY_PIECE    *Piece;
+  UINTN                    PieceCount;
+  UINT32                   ChunkCount;
+  volatile UINT32          NextChunk;
+  volatile UINT32          DoneChunks;
+  UINT64                   Bytes;
+  ///
+  /// Time stamp counter when the last chunk of the node was done.
+  ///
+  volatile UINT64          EndTsc;
+} PARALLEL_MEMORY_NODE_WORK;
+
+typedef struct {
+  PARALLEL_MEMORY_PRIVATE      *Private;
+  BOOLEAN                      IsTest;
+  EFI_PHYSICAL_ADDRESS         Address;
+  CONST UINT8                  *Pattern;
+  UINTN                        PatternSize;
+  UINTN                        Span;
+  PARALLEL_MEMORY_NODE_WORK    *Work;
+  ///
+  /// MAX_UINT64 until a test error is found.
+  ///
+  volatile UINT64              ErrorAddress;
+  ///
+  /// Time stamp counters and elapsed time of the section where the workers run.
+  ///
+  UINT64                       StartTsc;
+  UINT64                       EndTsc;
+  UINT64                       ElapsedNs;
+} PARALLEL_MEMORY_JOB;
+
+/**
+  Take the next chunk of a node.
+
+  @param[in, out]  Work    The work of the node.
+  @param[out]      Base    Start of the chunk.
+  @param[out]      Length  Length of the chunk.
+
+  @retval TRUE   A chunk is returned.
+  @retval FALSE  All the chunks of the node are taken.
+**/
+STATIC
+BOOLEAN
+ParallelMemoryTakeChunk (
+  IN OUT PARALLEL_MEMORY_NODE_WORK  *Work,
+  OUT    EFI_PHYSICAL_ADDRESS       *Base,
+  OUT    UINT64                     *Length
+  )
+{
+  UINT32                 Chunk;
+  UINTN                  Low;
+  UINTN                  High;
+  UINTN                  Middle;
+  PARALLEL_MEMORY_PIECE  *Piece;
+  UINT64                 Offset;
+
+  if (Work->NextChunk >= Work->ChunkCount) {
+    return FALSE;
+  }
+
+  Chunk = InterlockedIncrement (&Work->NextChunk) - 1;
+  if (Chunk >= Work->ChunkCount) {
+    return FALSE;
+  }
+
+  //
+  // Find the last piece starting at or before the chunk.
+  //
+  Low  = 0;
+  High = Work->PieceCount - 1;
+  while (Low < High) {
+    Middle = (Low + High + 1) / 2;
+    if (Work->Piece[Middle].FirstChunk <= Chunk) {
+      Low = Middle;
+    } else {
+      High = Middle - 1;
+    }
+  }
+
+  Piece   = &Work->Piece[Low];
+  Offset  = LShiftU64 (Chunk - Piece->FirstChunk, PARALLEL_MEMORY_CHUNK_SHIFT);
+  *Base   = Piece->Base + Offset;
+  *Length = MIN (Piece->Length - Offset, PARALLEL_MEMORY_CHUNK_SIZE);
+  return TRUE;
+}
+
+/**
+  Clear a chunk.
+
+  The chunk may start at address 0, which ZeroMem() does not take. The head of
+  the chunk up to the next cache line boundary is cleared one byte at a time.
+
+  @param[in]  Base    Start of the chunk.
+  @param[in]  Length  Length of the chunk.
+**/
+STATIC
+VOID
+ParallelMemoryClearChunk (
+  IN EFI_PHYSICAL_ADDRESS  Base,
+  IN UINT64                Length
+  )
+{
+  volatile UINT8  *Byte;
+  UINTN           Head;
+
+  Byte = (volatile UINT8 *)(UINTN)Base;
+  Head = (UINTN)MIN (ALIGN_VALUE (Base + 1, PARALLEL_MEMORY_CACHE_LINE_SIZE) - Base, Length);
+  for (Length -= Head; Head > 0; Head--) {
+    *Byte++ = 0;
+  }
+
+  if (Length > 0) {
+    ZeroMem ((VOID *)Byte, (UINTN)Length);
+  }
+}
+
+/**
+  Test a chunk.
+
+  @param[in, out]  Job     The job.
+  @param[in]       Base    Start of the chunk.
+  @param[in]       Length  Length of the chunk.
+**/
+STATIC
+VOID
+ParallelMemoryTestChunk (
+  IN OUT PARALLEL_MEMORY_JOB   *Job,
+  IN     EFI_PHYSICAL_ADDRESS  Base,
+  IN     UINT64                Length
+  )
+{
+  EFI_PHYSICAL_ADDRESS  First;
+  EFI_PHYSICAL_ADDRESS  Position;
+  EFI_PHYSICAL_ADDRESS  End;
+  UINT64                Remainder;
+  volatile UINT8        *Byte;
+  UINTN                 Index;
+
+  //
+  // First copy of the pattern starting in the chunk. Copies that straddle the
+  // end of the chunk belong to it.
+  //
+  DivU64x64Remainder (Base - Job->Address, Job->Span, &Remainder);
+  First = (Remainder == 0) ? Base : Base + (Job->Span - Remainder);
+  End   = Base + Length;
+
+  //
+  // The copies are flushed so that they are read back from memory. A copy at
+  // address 0, which CopyMem() does not take, is written one byte at a time.
+  //
+  for (Position = First; Position < End; Position += Job->Span) {
+    Byte = (volatile UINT8 *)(UINTN)Position;
+    if (Position != 0) {
+      CopyMem ((VOID *)(UINTN)Position, Job->Pattern, Job->PatternSize);
+    } else {
+      for (Index = 0; Index < Job->PatternSize; Index++) {
+        Byte[Index] = Job->Pattern[Index];
+      }
+    }
+
+    for (Index = 0; Index < Job->PatternSize; Index += PARALLEL_MEMORY_CACHE_LINE_SIZE) {
+      AsmFlushCacheLine ((VOID *)(Byte + Index));
+    }
+
+    AsmFlushCacheLine ((VOID *)(Byte + Job->PatternSize - 1));
+  }
+
+  for (Position = First; Position < End; Position += Job->Span) {
+    Byte = (volatile UINT8 *)(UINTN)Position;
+    for (Index = 0; Index < Job->PatternSize; Index++) {
+      if (Byte[Index] != Job->Pattern[Index]) {
+        InterlockedCompareExchange64 ((UINT64 *)&Job->ErrorAddress, MAX_UINT64, Position);
+        return;
+      }
+    }
+  }
+}
+
+/**
+  Take and run chunks of a job until they are all taken.
+
+  @param[in, out]  Job  The job.
+**/
+STATIC
+VOID
+ParallelMemoryDrain (
+  IN OUT PARALLEL_MEMORY_JOB  *Job
+  )
+{
+  PARALLEL_MEMORY_PRIVATE    *Private;
+  PARALLEL_MEMORY_NODE_WORK  *Work;
+  UINTN                      ProcessorNumber;
+  UINTN                      HomeNode;
+  UINTN                      Offset;
+  EFI_PHYSICAL_ADDRESS       Base;
+  UINT64                     Length;
+
+  Private  = Job->Private;
+  HomeNode = 0;
+  if ((Private->MpServices != NULL) &&
+      !EFI_ERROR (Private->MpServices->WhoAmI (Private->MpServices, &ProcessorNumber)) &&
+      (ProcessorNumber < Private->ProcessorCount))
+  {
+    HomeNode = Private->ProcessorNode[ProcessorNumber];
+  }
+
+  for (Offset = 0; Offset < Private->NodeCount; Offset++) {
+    Work = &Job->Work[(HomeNode + Offset) % Private->NodeCount];
+    while (Job->ErrorAddress == MAX_UINT64 && ParallelMemoryTakeChunk (Work, &Base, &Length)) {
+      if (Job->IsTest) {
+        ParallelMemoryTestChunk (Job, Base, Length);
+      } else {
+        ParallelMemoryClearChunk (Base, Length);
+      }
+
+      if (InterlockedIncrement (&Work->DoneChunks) == Work->ChunkCount) {
+        Work->EndTsc = AsmReadTsc ();
+      }
+    }
+  }
+}
+
+/**
+  Get the node of an address.
+
+  @param[in]   Private  The driver private data.
+  @param[in]   Address  The address.
+  @param[out]  End      End of the range of the same node containing Address,
+                        MAX_UINT64 if it extends to the end of the address space.
+
+  @return The node index.
+**/
+STATIC
+UINTN
+ParallelMemoryGetNode (
+  IN  PARALLEL_MEMORY_PRIVATE  *Private,
+  IN  EFI_PHYSICAL_ADDRESS     Address,
+  OUT EFI_PHYSICAL_ADDRESS     *End
+  )
+{
+  UINTN                     Index;
+  PARALLEL_MEMORY_AFFINITY  *Affinity;
+
+  //
+  // Memory not described by the SRAT is on the first node, up to the next range
+  // described by the SRAT.
+  //
+  *End = MAX_UINT64;
+  for (Index = 0; Index < Private->AffinityCount; Index++) {
+    Affinity = &Private->Affinity[Index];
+    if ((Address >= Affinity->Base) && (Address - Affinity->Base < Affinity->Length)) {
+      *End = (Affinity->Base + Affinity->Length < Affinity->Base) ? MAX_UINT64 : Affinity->Base + Affinity->Length;
+      return Affinity->Node;
+    }
+
+    if ((Affinity->Base > Address) && (Affinity->Base < *End)) {
+      *End = Affinity->Base;
+    }
+  }
+
+  return 0;
+}
+
+/**
+  Split a range by node.
+
+  @param[in, out]  Job      The job, with Work allocated.
+  @param[in]       Address  Start of the range.
+  @param[in]       Length   Length of the range, not 0.
+
+  @return The pieces, grouped by node and referenced by Job->Work, or NULL if
+          they cannot be allocated.
+**/
+STATIC
+PARALLEL_MEMORY_PIECE *
+ParallelMemorySplit (
+  IN OUT PARALLEL_MEMORY_JOB   *Job,
+  IN     EFI_PHYSICAL_ADDRESS  Address,
+  IN     UINT64                Length
+  )
+{
+  PARALLEL_MEMORY_PRIVATE    *Private;
+  PARALLEL_MEMORY_PIECE      *Piece;
+  PARALLEL_MEMORY_PIECE      *Sorted;
+  PARALLEL_MEMORY_NODE_WORK  *Work;
+  UINTN                      PieceCount;
+  UINTN                      MaxPieceCount;
+  EFI_PHYSICAL_ADDRESS       Current;
+  EFI_PHYSICAL_ADDRESS       Last;
+  EFI_PHYSICAL_ADDRESS       End;
+  UINTN                      Node;
+  UINTN                      Index;
+  UINTN                      Next;
+
+  Private = Job->Private;
+
+  //
+  // Each SRAT range ends at most one piece and starts at most one piece.
+  //
+  MaxPieceCount = 2 * Private->AffinityCount + 1;
+  Piece         = AllocatePool (2 * MaxPieceCount * sizeof (PARALLEL_MEMORY_PIECE));
+  if (Piece == NULL) {
+    return NULL;
+  }
+
+  Sorted     = Piece + MaxPieceCount;
+  PieceCount = 0;
+  Current    = Address;
+  Last       = Address + Length - 1;
+  while (TRUE) {
+    Node = ParallelMemoryGetNode (Private, Current, &End);
+    ASSERT (PieceCount < MaxPieceCount);
+    Piece[PieceCount].Base   = Current;
+    Piece[PieceCount].Length = MIN (End - 1, Last) - Current + 1;
+    Piece[PieceCount].Node   = Node;
+    PieceCount++;
+    Job->Work[Node].PieceCount++;
+    if (End - 1 >= Last) {
+      break;
+    }
+
+    Current = End;
+  }
+
+  //
+  // Group the pieces by node, keeping them in address order.
+  //
+  Next = 0;
+  for (Node = 0; Node < Private->NodeCount; Node++) {
+    Work             = &Job->Work[Node];
+    Work->Piece      = &Sorted[Next];
+    Next            += Work->PieceCount;
+    Work->PieceCount = 0;
+  }
+
+  for (Index = 0; Index < PieceCount; Index++) {
+    Work                            = &Job->Work[Piece[Index].Node];
+    Piece[Index].FirstChunk         = Work->ChunkCount;
+    Work->Piece[Work->PieceCount++] = Piece[Index];
+    Work->ChunkCount               += (UINT32)RShiftU64 (Piece[Index].Length + PARALLEL_MEMORY_CHUNK_SIZE - 1, PARALLEL_MEMORY_CHUNK_SHIFT);
+    Work->Bytes                    += Piece[Index].Length;
+  }
+
+  return Piece;
+}
+
+/**
+  Get the elapsed time since a performance counter value.
+
+  @param[in]  Start  The performance counter value.
+
+  @return The elapsed time in nanoseconds.
+**/
+STATIC
+UINT64
+ParallelMemoryElapsedNs (
+  IN UINT64  Start
+  )
+{
+  UINT64  End;
+  UINT64  StartValue;
+  UINT64  EndValue;
+
+  End = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&StartValue, &EndValue);
+  if (EndValue >= StartValue) {
+    return GetTimeInNanoSecond (End - Start);
+  }
+
+  return GetTimeInNanoSecond (Start - End);
+}
+
+/**
+  Compute Value * Numerator / Denominator, with Numerator not larger than
+  Denominator, without overflowing.
+
+  @param[in]  Value        The value.
+  @param[in]  Numerator    The numerator.
+  @param[in]  Denominator  The denominator.
+
+  @return The scaled value.
+**/
+STATIC
+UINT64
+ParallelMemoryScale (
+  IN UINT64  Value,
+  IN UINT64  Numerator,
+  IN UINT64  Denominator
+  )
+{
+  UINT64  Fraction;
+
+  while (Denominator > MAX_UINT32) {
+    Numerator   = RShiftU64 (Numerator, 1);
+    Denominator = RShiftU64 (Denominator, 1);
+  }
+
+  if ((Denominator == 0) || (Numerator >= Denominator)) {
+    return Value;
+  }
+
+  //
+  // Fraction is Numerator / Denominator in 32.32 fixed point.
+  //
+  Fraction = DivU64x64Remainder (LShiftU64 (Numerator, 32), Denominator, NULL);
+  if (Value <= MAX_UINT32) {
+    return RShiftU64 (MultU64x64 (Value, Fraction), 32);
+  }
+
+  return RShiftU64 (MultU64x64 (RShiftU64 (Value, 16), Fraction), 16);
+}
+
+/**
+  Task running the chunks of a job. TaskSchedulerParallelFor() runs it once per
+  worker, a worker that finds no chunk left returns at once.
+
+  @param[in]  Worker   The worker running the task.
+  @param[in]  Start    Unused.
+  @param[in]  End      Unused.
+  @param[in]  Context  The job.
+**/
+STATIC
+VOID
+EFIAPI
+ParallelMemoryTask (
+  IN TASK_WORKER  *Worker,
+  IN UINTN        Start,
+  IN UINTN        End,
+  IN VOID         *Context
+  )
+{
+  ParallelMemoryDrain ((PARALLEL_MEMORY_JOB *)Context);
+}
+
+/**
+  Run a job and measure the time its workers take.
+
+  The time is taken on the BSP around the section where the workers run, so that
+  it does not include the time needed to wake up the APs or to see them idle.
+
+  @param[in]  Worker   The BSP worker of TaskSchedulerRun(), or NULL to run the
+                       job on the BSP alone.
+  @param[in]  Context  The job.
+**/
+STATIC
+VOID
+EFIAPI
+ParallelMemoryRoot (
+  IN TASK_WORKER  *Worker  OPTIONAL,
+  IN VOID         *Context
+  )
+{
+  PARALLEL_MEMORY_JOB  *Job;
+  UINT64               StartCounter;
+
+  Job           = (PARALLEL_MEMORY_JOB *)Context;
+  StartCounter  = GetPerformanceCounter ();
+  Job->StartTsc = AsmReadTsc ();
+
+  if (Worker != NULL) {
+    TaskSchedulerParallelFor (Worker, 0, TaskSchedulerGetWorkerCount (Worker), 1, ParallelMemoryTask, Job);
+  } else {
+    ParallelMemoryDrain (Job);
+  }
+
+  Job->EndTsc    = AsmReadTsc ();
+  Job->ElapsedNs = ParallelMemoryElapsedNs (StartCounter);
+}
+
+/**
+  Run a job on the BSP and, when it is worth it, on the APs.
+
+  @param[in, out]  Job       The job.
+  @param[in]       Workload  Number of bytes of memory touched by the job.
+**/
+STATIC
+VOID
+ParallelMemoryRun (
+  IN OUT PARALLEL_MEMORY_JOB  *Job,
+  IN     UINT64               Workload
+  )
+{
+  PARALLEL_MEMORY_PRIVATE    *Private;
+  PARALLEL_MEMORY_NODE_WORK  *Work;
+  UINT64                     NodeNs;
+  UINTN                      Node;
+
+  Private = Job->Private;
+
+  //
+  // TaskSchedulerRun() runs the job on the BSP alone when the APs cannot be used.
+  // It hands the APs back to the MP services before it returns, so a memory test
+  // run block by block does not keep them from other StartupAllAPs() callers.
+  //
+  if (Workload >= PARALLEL_MEMORY_MIN_PARALLEL_SIZE) {
+    TaskSchedulerRun (ParallelMemoryRoot, Job);
+  } else {
+    ParallelMemoryRoot (NULL, Job);
+  }
+
+  //
+  // The time stamp counter is only used to split the elapsed time between the
+  // nodes, in case it does not run at the rate of the performance counter.
+  //
+  for (Node = 0; Node < Private->NodeCount; Node++) {
+    Work = &Job->Work[Node];
+    if (Work->Bytes == 0) {
+      continue;
+    }
+
+    NodeNs = Job->ElapsedNs;
+    if ((Work->EndTsc > Job->StartTsc) && (Job->EndTsc > Job->StartTsc)) {
+      NodeNs = ParallelMemoryScale (Job->ElapsedNs, Work->EndTsc - Job->StartTsc, Job->EndTsc - Job->StartTsc);
+    }
+
+    Private->Node[Node].Bytes     += Work->Bytes;
+    Private->Node[Node].ElapsedNs += NodeNs;
+
+    DEBUG ((
+      DEBUG_VERBOSE,
+      "ParallelMemory: %a node %d: %ld KB in %ld us, %ld MB/s\n",
+      Job->IsTest ? "test" : "clear",
+      Private->Node[Node].ProximityDomain,
+      RShiftU64 (Work->Bytes, 10),
+      DivU64x32 (NodeNs, 1000),
+      (NodeNs == 0) ? 0 : DivU64x64Remainder (MultU64x32 (Work->Bytes, 1000), NodeNs, NULL)
+      ));
+  }
+}
+
+/**
+  Check a range and prepare a job for it.
+
+  @param[in]   Private  The driver private data.
+  @param[in]   Address  Start of the range.
+  @param[in]   Length   Length of the range, not 0.
+  @param[out]  Job      The job.
+  @param[out]  Piece    The pieces of the range, to be freed with the job.
+
+  @retval EFI_SUCCESS            The job is prepared.
+  @retval EFI_INVALID_PARAMETER  The range wraps around the address space.
+  @retval EFI_UNSUPPORTED        The range is not addressable by the processor.
+  @retval EFI_OUT_OF_RESOURCES   The job cannot be allocated.
+**/
+STATIC
+EFI_STATUS
+ParallelMemoryPrepare (
+  IN  PARALLEL_MEMORY_PRIVATE  *Private,
+  IN  EFI_PHYSICAL_ADDRESS     Address,
+  IN  UINT64                   Length,
+  OUT PARALLEL_MEMORY_JOB      *Job,
+  OUT PARALLEL_MEMORY_PIECE    **Piece
+  )
+{
+  EFI_STATUS  Status;
+
+  if (Address + Length - 1 < Address) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Address + Length - 1 > MAX_ADDRESS) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = ParallelMemoryUpdateTopology (Private);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  ZeroMem (Job, sizeof (*Job));
+  Job->Private      = Private;
+  Job->Address      = Address;
+  Job->ErrorAddress = MAX_UINT64;
+  Job->Work         = AllocateZeroPool (Private->NodeCount * sizeof (PARALLEL_MEMORY_NODE_WORK));
+  if (Job->Work == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *Piece = ParallelMemorySplit (Job, Address, Length);
+  if (*Piece == NULL) {
+    FreePool (Job->Work);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Clear a range of memory.
+
+  @param[in]  This     The protocol instance.
+  @param[in]  Address  Start of the range.
+  @param[in]  Length   Length of the range in bytes.
+
+  @retval EFI_SUCCESS            The range is cleared.
+  @retval EFI_INVALID_PARAMETER  The range wraps around the address space.
+  @retval EFI_UNSUPPORTED        The range is not addressable by the processor.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+ParallelMemoryClear (
+  IN EDKII_PARALLEL_MEMORY_PROTOCOL  *This,
+  IN EFI_PHYSICAL_ADDRESS            Address,
+  IN UINT64                          Length
+  )
+{
+  EFI_STATUS             Status;
+  PARALLEL_MEMORY_JOB    Job;
+  PARALLEL_MEMORY_PIECE  *Piece;
+
+  if (Length == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Status = ParallelMemoryPrepare (PARALLEL_MEMORY_PRIVATE_FROM_THIS (This), Address, Length, &Job, &Piece);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  ParallelMemoryRun (&Job, Length);
+
+  FreePool (Piece);
+  FreePool (Job.Work);
+  return EFI_SUCCESS;
+}
+
+/**
+  Test a range of memory.
+
+  @param[in]  This          The protocol instance.
+  @param[in]  Address       Start of the range.
+  @param[in]  Length        Length of the range in bytes.
+  @param[in]  Pattern       The pattern to write.
+  @param[in]  PatternSize   Size of Pattern in bytes, not larger than Span.
+  @param[in]  Span          Distance in bytes between two copies of Pattern.
+  @param[out] ErrorAddress  Address of a copy of Pattern that did not read back
+                            correctly, when EFI_DEVICE_ERROR is returned.
+
+  @retval EFI_SUCCESS            All the copies of Pattern read back correctly.
+  @retval EFI_DEVICE_ERROR       A copy of Pattern did not read back correctly.
+  @retval EFI_INVALID_PARAMETER  Pattern is NULL, PatternSize is 0 or larger than
+                                 Span, or the range wraps around the address space.
+  @retval EFI_UNSUPPORTED        The range is not addressable by the processor.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+ParallelMemoryTest (
+  IN  EDKII_PARALLEL_MEMORY_PROTOCOL  *This,
+  IN  EFI_PHYSICAL_ADDRESS            Address,
+  IN  UINT64                          Length,
+  IN  CONST VOID                      *Pattern,
+  IN  UINTN                           PatternSize,
+  IN  UINTN                           Span,
+  OUT EFI_PHYSICAL_ADDRESS            *ErrorAddress OPTIONAL
+  )
+{
+  EFI_STATUS             Status;
+  PARALLEL_MEMORY_JOB    Job;
+  PARALLEL_MEMORY_PIECE  *Piece;
+
+  if ((Pattern == NULL) || (PatternSize == 0) || (PatternSize > Span)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Length == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Status = ParallelMemoryPrepare (PARALLEL_MEMORY_PRIVATE_FROM_THIS (This), Address, Length, &Job, &Piece);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Job.IsTest      = TRUE;
+  Job.Pattern     = Pattern;
+  Job.PatternSize = PatternSize;
+  Job.Span        = Span;
+
+  //
+  // Every copy of the pattern touches at least a cache line.
+  //
+  ParallelMemoryRun (&Job, MultU64x64 (DivU64x64Remainder (Length, Span, NULL), MAX (PatternSize, 64)));
+
+  FreePool (Piece);
+  FreePool (Job.Work);
+
+  if (Job.ErrorAddress != MAX_UINT64) {
+    if (ErrorAddress != NULL) {
+      *ErrorAddress = Job.ErrorAddress;
+    }
+
+    return EFI_DEVICE_ERROR;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the statistics of the NUMA nodes.
+
+  @param[in]      This        The protocol instance.
+  @param[in, out] NodeCount   On input, the number of entries of Statistics. On
+                              output, the number of NUMA nodes.
+  @param[out]     Statistics  The statistics of each node.
+
+  @retval EFI_SUCCESS            The statistics are returned.
+  @retval EFI_BUFFER_TOO_SMALL   NodeCount is too small, it is updated with the
+                                 number of NUMA nodes.
+  @retval EFI_INVALID_PARAMETER  NodeCount is NULL, or Statistics is NULL and
+                                 *NodeCount is not 0.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+ParallelMemoryGetStatistics (
+  IN     EDKII_PARALLEL_MEMORY_PROTOCOL         *This,
+  IN OUT UINTN                                  *NodeCount,
+  OUT    EDKII_PARALLEL_MEMORY_NODE_STATISTICS  *Statistics OPTIONAL
+  )
+{
+  PARALLEL_MEMORY_PRIVATE  *Private;
+
+  if ((NodeCount == NULL) || ((Statistics == NULL) && (*NodeCount != 0))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Private = PARALLEL_MEMORY_PRIVATE_FROM_THIS (This);
+  if (*NodeCount < Private->NodeCount) {
+    *NodeCount = Private->NodeCount;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  *NodeCount = Private->NodeCount;
+  CopyMem (Statistics, Private->Node, Private->NodeCount * sizeof (*Statistics));
+  return EFI_SUCCESS;
+}
+
+/**
+  The entry point of the Parallel Memory DXE driver.
+
+  @param[in]  ImageHandle  The firmware allocated handle for the EFI image.
+  @param[in]  SystemTable  A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS           The protocol is installed.
+  @retval EFI_OUT_OF_RESOURCES  The private data cannot be allocated.
+**/
+EFI_STATUS
+EFIAPI
+ParallelMemoryDxeEntryPoint (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS               Status;
+  PARALLEL_MEMORY_PRIVATE  *Private;
+
+  Private = AllocateZeroPool (sizeof (*Private));
+  if (Private == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Start with the BSP alone on a single node. MP services and the SRAT are
+  // looked up when the protocol is used, they may be installed later.
+  //
+  Private->Signature      = PARALLEL_MEMORY_PRIVATE_SIGNATURE;
+  Private->ProcessorCount = 1;
+  Private->NodeCount      = 1;
+  Private->ProcessorNode  = AllocateZeroPool (sizeof (UINTN));
+  Private->Node           = AllocateZeroPool (sizeof (EDKII_PARALLEL_MEMORY_NODE_STATISTICS));
+  if ((Private->ProcessorNode == NULL) || (Private->Node == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Error;
+  }
+
+  Private->Node[0].ProcessorCount       = 1;
+  Private->ParallelMemory.Revision      = EDKII_PARALLEL_MEMORY_PROTOCOL_REVISION;
+  Private->ParallelMemory.Clear         = ParallelMemoryClear;
+  Private->ParallelMemory.Test          = ParallelMemoryTest;
+  Private->ParallelMemory.GetStatistics = ParallelMemoryGetStatistics;
+
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &Private->Handle,
+                  &gEdkiiParallelMemoryProtocolGuid,
+                  &Private->ParallelMemory,
+                  NULL
+                  );
+  if (!EFI_ERROR (Status)) {
+    return EFI_SUCCESS;
+  }
+
+Error:
+  if (Private->ProcessorNode != NULL) {
+    FreePool (Private->ProcessorNode);
+  }
+
+  if (Private->Node != NULL) {
+    FreePool (Private->Node);
+  }
+
+  FreePool (Private);
+  return Status;
+}
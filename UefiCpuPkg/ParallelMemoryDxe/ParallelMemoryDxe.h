@@ -0,0 +1,89 @@
+/** @file
+  Internal definitions of the Parallel Memory DXE driver.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef PARALLEL_MEMORY_DXE_H_
+#define PARALLEL_MEMORY_DXE_H_
+
+#include <PiDxe.h>
+#include <IndustryStandard/Acpi.h>
+#include <Protocol/MpService.h>
+#include <Protocol/ParallelMemory.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/TaskSchedulerLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+
+//
+// Memory is handed to the processors in chunks of this size.
+//
+#define PARALLEL_MEMORY_CHUNK_SIZE  SIZE_1MB
+
+//
+// Operations smaller than this are run on the BSP, waking up the APs would cost
+// more than it saves.
+//
+#define PARALLEL_MEMORY_MIN_PARALLEL_SIZE  SIZE_16MB
+
+#define PARALLEL_MEMORY_PRIVATE_SIGNATURE  SIGNATURE_32 ('P', 'M', 'E', 'M')
+
+///
+/// Range of memory attached to a NUMA node, from the SRAT.
+///
+typedef struct {
+  EFI_PHYSICAL_ADDRESS    Base;
+  UINT64                  Length;
+  UINTN                   Node;
+} PARALLEL_MEMORY_AFFINITY;
+
+typedef struct {
+  UINTN                                    Signature;
+  EFI_HANDLE                               Handle;
+  EDKII_PARALLEL_MEMORY_PROTOCOL           ParallelMemory;
+
+  EFI_MP_SERVICES_PROTOCOL                 *MpServices;
+  UINTN                                    ProcessorCount;
+  //
+  // Node index of each processor, indexed by processor number.
+  //
+  UINTN                                    *ProcessorNode;
+  //
+  // TRUE once the topology was read from the SRAT. Until then all the memory and
+  // all the processors are in a single node.
+  //
+  BOOLEAN                                  TopologyFromSrat;
+  UINTN                                    NodeCount;
+  EDKII_PARALLEL_MEMORY_NODE_STATISTICS    *Node;
+  UINTN                                    AffinityCount;
+  PARALLEL_MEMORY_AFFINITY                 *Affinity;
+} PARALLEL_MEMORY_PRIVATE;
+
+#define PARALLEL_MEMORY_PRIVATE_FROM_THIS(a) \
+  CR (a, PARALLEL_MEMORY_PRIVATE, ParallelMemory, PARALLEL_MEMORY_PRIVATE_SIGNATURE)
+
+/**
+  Update the NUMA topology of the driver.
+
+  The topology is read once from the SRAT. Before the SRAT is installed, the
+  driver uses a single node holding all the memory and all the processors.
+
+  @param[in, out]  Private  The driver private data.
+
+  @retval EFI_SUCCESS           The topology is up to date.
+  @retval EFI_OUT_OF_RESOURCES  The topology cannot be allocated.
+**/
+EFI_STATUS
+ParallelMemoryUpdateTopology (
+  IN OUT PARALLEL_MEMORY_PRIVATE  *Private
+  );
+
+#endif
@@ -0,0 +1,545 @@
+/** @file
+  Unit tests of the Parallel Memory DXE driver.
+
+  A host buffer is split in NUMA nodes by hand made SRAT ranges whose boundaries
+  are not aligned on chunks, and the protocol is checked to clear or test exactly
+  the requested range, with every byte attributed to its node.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UnitTestLib.h>
+
+#include "../ParallelMemoryDxe.h"
+
+#define UNIT_TEST_APP_NAME     "Parallel Memory DXE Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_BUFFER_SIZE  (40 * SIZE_1MB)
+#define TEST_HEAD_SIZE    13
+#define TEST_TAIL_SIZE    29
+#define TEST_NODE_COUNT   3
+#define TEST_FILL         0xAA
+
+//
+// SRAT ranges, as offsets in the test buffer. The memory that is not described
+// is on node 0, and the last range extends past the end of the buffer.
+//
+typedef struct {
+  UINTN    Start;
+  UINTN    End;
+  UINTN    Node;
+} TEST_AFFINITY;
+
+TEST_AFFINITY  mTestAffinity[] = {
+  { 5 * SIZE_1MB + 7,   12 * SIZE_1MB + 3,  1 },
+  { 20 * SIZE_1MB + 1,  33 * SIZE_1MB + 5,  2 },
+  { 36 * SIZE_1MB + 11, 41 * SIZE_1MB,      1 }
+};
+
+EDKII_PARALLEL_MEMORY_PROTOCOL  *mParallelMemory;
+UINT8                           *mBuffer;
+UINTN                           mTaskSchedulerRunCount;
+UINT64                          mPerformanceCounter;
+
+//
+// Symbol Definitions
+// These are not directly under test - but required to link ParallelMemoryDxe.c.
+// The scheduler runs the root procedure on the test thread alone, which takes
+// the path of the BSP without APs.
+//
+
+EFI_STATUS
+EFIAPI
+TaskSchedulerRun (
+  IN TASK_PROCEDURE  Procedure,
+  IN VOID            *Context
+  )
+{
+  mTaskSchedulerRunCount++;
+  Procedure (NULL, Context);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+TaskSchedulerParallelFor (
+  IN TASK_WORKER           *Worker  OPTIONAL,
+  IN UINTN                 Start,
+  IN UINTN                 End,
+  IN UINTN                 Grain,
+  IN TASK_RANGE_PROCEDURE  Procedure,
+  IN VOID                  *Context
+  )
+{
+  Procedure (Worker, Start, End, Context);
+  return EFI_SUCCESS;
+}
+
+UINTN
+EFIAPI
+TaskSchedulerGetWorkerCount (
+  IN TASK_WORKER  *Worker
+  )
+{
+  return 1;
+}
+
+UINT64
+EFIAPI
+GetPerformanceCounter (
+  VOID
+  )
+{
+  return mPerformanceCounter += 1000;
+}
+
+UINT64
+EFIAPI
+GetPerformanceCounterProperties (
+  OUT UINT64  *StartValue OPTIONAL,
+  OUT UINT64  *EndValue OPTIONAL
+  )
+{
+  if (StartValue != NULL) {
+    *StartValue = 0;
+  }
+
+  if (EndValue != NULL) {
+    *EndValue = MAX_UINT64;
+  }
+
+  return 1000000000;
+}
+
+UINT64
+EFIAPI
+GetTimeInNanoSecond (
+  IN UINT64  Ticks
+  )
+{
+  return Ticks;
+}
+
+EFI_STATUS
+ParallelMemoryUpdateTopology (
+  IN OUT PARALLEL_MEMORY_PRIVATE  *Private
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  The entry point of the Parallel Memory DXE driver.
+
+  @param[in]  ImageHandle  The firmware allocated handle for the EFI image.
+  @param[in]  SystemTable  A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS           The protocol is installed.
+  @retval EFI_OUT_OF_RESOURCES  The private data cannot be allocated.
+**/
+EFI_STATUS
+EFIAPI
+ParallelMemoryDxeEntryPoint (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  );
+
+/**
+  Replacement of InstallMultipleProtocolInterfaces() keeping the protocol
+  installed by the driver.
+
+  @param[in, out]  Handle  The handle to install the protocol on.
+  @param[in]       ...     The GUID and interface of the protocol.
+
+  @retval EFI_SUCCESS  The protocol is kept.
+**/
+EFI_STATUS
+EFIAPI
+InstallParallelMemoryProtocol (
+  IN OUT EFI_HANDLE  *Handle,
+  ...
+  )
+{
+  VA_LIST   Args;
+  EFI_GUID  *Guid;
+
+  VA_START (Args, Handle);
+  Guid = VA_ARG (Args, EFI_GUID *);
+  if (CompareGuid (Guid, &gEdkiiParallelMemoryProtocolGuid)) {
+    mParallelMemory = VA_ARG (Args, EDKII_PARALLEL_MEMORY_PROTOCOL *);
+  }
+
+  VA_END (Args);
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the number of bytes of a range of the test buffer on a node.
+
+  @param[in]  Start  Offset of the range.
+  @param[in]  End    Offset following the range.
+  @param[in]  Node   The node.
+
+  @return The number of bytes.
+**/
+UINT64
+GetNodeBytes (
+  IN UINTN  Start,
+  IN UINTN  End,
+  IN UINTN  Node
+  )
+{
+  UINT64  Bytes;
+  UINT64  Described;
+  UINTN   Index;
+
+  Bytes     = 0;
+  Described = 0;
+  for (Index = 0; Index < ARRAY_SIZE (mTestAffinity); Index++) {
+    if ((mTestAffinity[Index].End <= Start) || (mTestAffinity[Index].Start >= End)) {
+      continue;
+    }
+
+    Described += MIN (mTestAffinity[Index].End, End) - MAX (mTestAffinity[Index].Start, Start);
+    if (mTestAffinity[Index].Node == Node) {
+      Bytes += MIN (mTestAffinity[Index].End, End) - MAX (mTestAffinity[Index].Start, Start);
+    }
+  }
+
+  if (Node == 0) {
+    Bytes += (End - Start) - Described;
+  }
+
+  return Bytes;
+}
+
+/**
+  Load the driver with three NUMA nodes over the test buffer.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED                      The driver is loaded.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  The driver cannot be loaded.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SetupDriver (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_INSTALL_MULTIPLE_PROTOCOL_INTERFACES  SavedInstall;
+  EFI_STATUS                                Status;
+  PARALLEL_MEMORY_PRIVATE                   *Private;
+  UINTN                                     Index;
+
+  mParallelMemory        = NULL;
+  mTaskSchedulerRunCount = 0;
+  mBuffer                = AllocatePool (TEST_BUFFER_SIZE);
+  if (mBuffer == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  SavedInstall                           = gBS->InstallMultipleProtocolInterfaces;
+  gBS->InstallMultipleProtocolInterfaces = InstallParallelMemoryProtocol;
+  Status                                 = ParallelMemoryDxeEntryPoint (NULL, NULL);
+  gBS->InstallMultipleProtocolInterfaces = SavedInstall;
+  if (EFI_ERROR (Status) || (mParallelMemory == NULL)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  Private = PARALLEL_MEMORY_PRIVATE_FROM_THIS (mParallelMemory);
+  FreePool (Private->Node);
+  Private->NodeCount     = TEST_NODE_COUNT;
+  Private->Node          = AllocateZeroPool (TEST_NODE_COUNT * sizeof (*Private->Node));
+  Private->AffinityCount = ARRAY_SIZE (mTestAffinity);
+  Private->Affinity      = AllocatePool (ARRAY_SIZE (mTestAffinity) * sizeof (*Private->Affinity));
+  if ((Private->Node == NULL) || (Private->Affinity == NULL)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  for (Index = 0; Index < ARRAY_SIZE (mTestAffinity); Index++) {
+    Private->Affinity[Index].Base   = (UINTN)mBuffer + mTestAffinity[Index].Start;
+    Private->Affinity[Index].Length = mTestAffinity[Index].End - mTestAffinity[Index].Start;
+    Private->Affinity[Index].Node   = mTestAffinity[Index].Node;
+  }
+
+  for (Index = 0; Index < TEST_NODE_COUNT; Index++) {
+    Private->Node[Index].ProximityDomain = (UINT32)(Index + 0x10);
+  }
+
+  Private->TopologyFromSrat = TRUE;
+  SetMem (mBuffer, TEST_BUFFER_SIZE, TEST_FILL);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Unload the driver.
+
+  @param[in]  Context  Unused.
+**/
+VOID
+EFIAPI
+CleanupDriver (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  PARALLEL_MEMORY_PRIVATE  *Private;
+
+  if (mParallelMemory != NULL) {
+    Private = PARALLEL_MEMORY_PRIVATE_FROM_THIS (mParallelMemory);
+    FreePool (Private->Affinity);
+    FreePool (Private->Node);
+    FreePool (Private->ProcessorNode);
+    FreePool (Private);
+    mParallelMemory = NULL;
+  }
+
+  FreePool (mBuffer);
+  mBuffer = NULL;
+}
+
+/**
+  Check that the statistics of every node hold the bytes of a range.
+
+  @param[in]  Start  Offset of the range in the test buffer.
+  @param[in]  End    Offset following the range.
+
+  @retval UNIT_TEST_PASSED             The statistics are right.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The statistics are wrong.
+**/
+UNIT_TEST_STATUS
+CheckStatistics (
+  IN UINTN  Start,
+  IN UINTN  End
+  )
+{
+  EDKII_PARALLEL_MEMORY_NODE_STATISTICS  Statistics[TEST_NODE_COUNT];
+  UINTN                                  NodeCount;
+  UINTN                                  Index;
+  UINT64                                 Total;
+
+  NodeCount = 1;
+  UT_ASSERT_STATUS_EQUAL (mParallelMemory->GetStatistics (mParallelMemory, &NodeCount, Statistics), EFI_BUFFER_TOO_SMALL);
+  UT_ASSERT_EQUAL (NodeCount, TEST_NODE_COUNT);
+  UT_ASSERT_NOT_EFI_ERROR (mParallelMemory->GetStatistics (mParallelMemory, &NodeCount, Statistics));
+
+  Total = 0;
+  for (Index = 0; Index < TEST_NODE_COUNT; Index++) {
+    UT_ASSERT_EQUAL (Statistics[Index].ProximityDomain, Index + 0x10);
+    UT_ASSERT_EQUAL (Statistics[Index].Bytes, GetNodeBytes (Start, End, Index));
+    Total += Statistics[Index].Bytes;
+  }
+
+  UT_ASSERT_EQUAL (Total, End - Start);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Clear a range whose start, end and node boundaries are not chunk aligned.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ClearUnalignedRange (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Start;
+  UINTN  End;
+  UINTN  Index;
+
+  Start = TEST_HEAD_SIZE;
+  End   = TEST_BUFFER_SIZE - TEST_TAIL_SIZE;
+  UT_ASSERT_NOT_EFI_ERROR (mParallelMemory->Clear (mParallelMemory, (UINTN)mBuffer + Start, End - Start));
+  UT_ASSERT_EQUAL (mTaskSchedulerRunCount, 1);
+
+  for (Index = 0; Index < Start; Index++) {
+    UT_ASSERT_EQUAL (mBuffer[Index], TEST_FILL);
+  }
+
+  UT_ASSERT_TRUE (IsZeroBuffer (mBuffer + Start, End - Start));
+  for (Index = End; Index < TEST_BUFFER_SIZE; Index++) {
+    UT_ASSERT_EQUAL (mBuffer[Index], TEST_FILL);
+  }
+
+  return CheckStatistics (Start, End);
+}
+
+/**
+  Clear a range too small to be run on the APs, inside a single node.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ClearSmallRange (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Start;
+  UINTN  End;
+
+  Start = 5 * SIZE_1MB + 9;
+  End   = 7 * SIZE_1MB + 17;
+  UT_ASSERT_NOT_EFI_ERROR (mParallelMemory->Clear (mParallelMemory, (UINTN)mBuffer + Start, End - Start));
+  UT_ASSERT_EQUAL (mTaskSchedulerRunCount, 0);
+
+  UT_ASSERT_EQUAL (mBuffer[Start - 1], TEST_FILL);
+  UT_ASSERT_TRUE (IsZeroBuffer (mBuffer + Start, End - Start));
+  UT_ASSERT_EQUAL (mBuffer[End], TEST_FILL);
+
+  return CheckStatistics (Start, End);
+}
+
+/**
+  Test a range whose start, end and node boundaries are not chunk aligned, and
+  check that a copy of the pattern is written at every span of the range only.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TestUnalignedRange (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST UINT8    Pattern[] = { 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0x5A };
+  UINTN                 Span;
+  UINTN                 Start;
+  UINTN                 End;
+  UINTN                 Offset;
+  UINTN                 Copies;
+  EFI_PHYSICAL_ADDRESS  ErrorAddress;
+
+  Span  = 4099;
+  Start = TEST_HEAD_SIZE;
+  End   = TEST_BUFFER_SIZE - TEST_TAIL_SIZE - Span;
+  UT_ASSERT_NOT_EFI_ERROR (
+    mParallelMemory->Test (mParallelMemory, (UINTN)mBuffer + Start, End - Start, Pattern, sizeof (Pattern), Span, &ErrorAddress)
+    );
+
+  Copies = 0;
+  for (Offset = 0; Offset < TEST_BUFFER_SIZE; Offset++) {
+    if ((Offset >= Start) && (Offset < End) && ((Offset - Start) % Span == 0)) {
+      UT_ASSERT_MEM_EQUAL (mBuffer + Offset, Pattern, sizeof (Pattern));
+      Offset += sizeof (Pattern) - 1;
+      Copies++;
+    } else {
+      UT_ASSERT_EQUAL (mBuffer[Offset], TEST_FILL);
+    }
+  }
+
+  UT_ASSERT_EQUAL (Copies, (End - Start + Span - 1) / Span);
+  return CheckStatistics (Start, End);
+}
+
+/**
+  Reject the ranges and patterns the protocol does not take.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RejectInvalidParameters (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8  Pattern;
+
+  Pattern = 0;
+  UT_ASSERT_STATUS_EQUAL (mParallelMemory->Clear (mParallelMemory, MAX_UINT64 - 1, 4), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (mParallelMemory->Test (mParallelMemory, (UINTN)mBuffer, 64, NULL, 1, 1, NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (mParallelMemory->Test (mParallelMemory, (UINTN)mBuffer, 64, &Pattern, 0, 1, NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (mParallelMemory->Test (mParallelMemory, (UINTN)mBuffer, 64, &Pattern, 2, 1, NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_NOT_EFI_ERROR (mParallelMemory->Clear (mParallelMemory, (UINTN)mBuffer, 0));
+  UT_ASSERT_EQUAL (mBuffer[0], TEST_FILL);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  Parallel Memory DXE driver and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UefiTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      RangeTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&RangeTests, Framework, "Range Split Tests", "ParallelMemoryDxe.Range", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for Range Split Tests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (RangeTests, "Clear an unaligned range over several nodes", "ClearUnalignedRange", ClearUnalignedRange, SetupDriver, CleanupDriver, NULL);
+  AddTestCase (RangeTests, "Clear a small range on the BSP", "ClearSmallRange", ClearSmallRange, SetupDriver, CleanupDriver, NULL);
+  AddTestCase (RangeTests, "Test an unaligned range over several nodes", "TestUnalignedRange", TestUnalignedRange, SetupDriver, CleanupDriver, NULL);
+  AddTestCase (RangeTests, "Reject invalid parameters", "RejectInvalidParameters", RejectInvalidParameters, SetupDriver, CleanupDriver, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param Argc  Number of arguments.
+  @param Argv  Array of arguments.
+
+  @return Test application exit code.
+**/
+INT32
+main (
+  INT32  Argc,
+  CHAR8  *Argv[]
+  )
+{
+  return UefiTestMain ();
+}
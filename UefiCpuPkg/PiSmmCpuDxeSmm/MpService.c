@@ -505,11 +505,20 @@ BSPHandler (
     //
     // Wait for APs to arrive
     //
+    PERF_CODE (
+      MpPerfBegin (CpuIndex, SMM_MP_PERF_PROCEDURE_ID (SmmWaitForApArrival));
+      );
     SmmWaitForApArrival ();
+    PERF_CODE (
+      MpPerfEnd (CpuIndex, SMM_MP_PERF_PROCEDURE_ID (SmmWaitForApArrival));
+      );
 
     //
     // Lock door for late coming CPU checkin and retrieve the Arrived number of APs
     //
+    PERF_CODE (
+      MpPerfBegin (CpuIndex, SMM_MP_PERF_PROCEDURE_ID (SmmApCheckIn));
+      );
     *mSmmMpSyncData->AllCpusInSync = TRUE;
 
     SmmCpuSyncLockDoor (mSmmMpSyncData->SyncContext, CpuIndex, &CpuCount);
@@ -520,6 +529,9 @@ BSPHandler (
     // Wait for all APs of arrival at this point
     //
     SmmCpuSyncWaitForAPs (mSmmMpSyncData->SyncContext, ApCount, CpuIndex); /// #1: Wait APs
+    PERF_CODE (
+      MpPerfEnd (CpuIndex, SMM_MP_PERF_PROCEDURE_ID (SmmApCheckIn));
+      );
 
     //
     // Signal all APs it's time for:
@@ -582,7 +594,13 @@ BSPHandler (
   //
   // Invoke SMM Foundation EntryPoint with the processor information context.
   //
+  PERF_CODE (
+    MpPerfBegin (CpuIndex, SMM_MP_PERF_PROCEDURE_ID (SmmMmiHandler));
+    );
   gSmmCpuPrivate->SmmCoreEntry (&gSmmCpuPrivate->SmmCoreEntryContext);
+  PERF_CODE (
+    MpPerfEnd (CpuIndex, SMM_MP_PERF_PROCEDURE_ID (SmmMmiHandler));
+    );
 
   //
   // Make sure all APs have completed their pending none-block tasks
@@ -629,6 +647,9 @@ BSPHandler (
   //
   // Notify all APs to exit
   //
+  PERF_CODE (
+    MpPerfBegin (CpuIndex, SMM_MP_PERF_PROCEDURE_ID (SmmApExit));
+    );
   *mSmmMpSyncData->InsideSmm = FALSE;
   ReleaseAllAPs (); /// #6: Signal APs
 
@@ -685,6 +706,9 @@ BSPHandler (
   // WaitForAllAps does not depend on the Present flag.
   //
   SmmCpuSyncWaitForAPs (mSmmMpSyncData->SyncContext, ApCount, CpuIndex); /// #11: Wait APs
+  PERF_CODE (
+    MpPerfEnd (CpuIndex, SMM_MP_PERF_PROCEDURE_ID (SmmApExit));
+    );
 
   //
   // At this point, all APs should have exited from APHandler().
@@ -18,6 +18,10 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
   _(SmmRendezvousEntry), \
   _(PlatformValidSmi), \
   _(SmmRendezvousExit), \
+  _(SmmWaitForApArrival), \
+  _(SmmApCheckIn), \
+  _(SmmMmiHandler), \
+  _(SmmApExit), \
   _(SmmMpProcedureMax) // Add new entries above this line
 
 //